@@ -49,7 +49,8 @@ public:
     DistortionRenderer(ovrRenderAPIType api, ovrHmd hmd,
                        FrameTimeManager& timeManager,              
                        const HMDRenderState& renderState)
-        : RenderAPI(api), HMD(hmd), TimeManager(timeManager), RState(renderState)
+        : RenderAPI(api), HMD(hmd), TimeManager(timeManager), RState(renderState),
+          LatencyQuadSubmitSeconds(0.0)
     { }
     virtual ~DistortionRenderer()
     { }
@@ -67,6 +68,21 @@ public:
     // eye can be scanned out before the other.
     virtual void SubmitEye(int eyeId, ovrTexture* eyeTexture) = 0;
 
+    // Submits the depth of the eye last submitted, and the projection it was
+    // rendered with, for positional timewarp. Renderers that don't support it
+    // ignore it.
+    virtual void SubmitEyeDepth(int eyeId, ovrTexture* depthTexture, const ovrMatrix4f& projection)
+    { OVR_UNUSED3(eyeId, depthTexture, projection); }
+
+    // Allocates textureSet->TextureCount eye render targets of the given size,
+    // kept set up for submission until DestroySwapTextureSet or the renderer's
+    // destruction, and describes them in textureSet->Textures. Renderers that
+    // don't support it return false.
+    virtual bool CreateSwapTextureSet(ovrSwapTextureSet* textureSet, Sizei size)
+    { OVR_UNUSED2(textureSet, size); return false; }
+    virtual void DestroySwapTextureSet(const ovrSwapTextureSet* textureSet)
+    { OVR_UNUSED(textureSet); }
+
     // Finish the frame, optionally swapping buffers.
     // Many implementations may actually apply the distortion here.
     virtual void EndFrame(bool swapBuffers, unsigned char* latencyTesterDrawColor,
@@ -78,6 +94,9 @@ public:
 	// Restores the saved graphics pipeline state.
 	void RestoreGraphicsState() { if (!(RState.EnabledHmdCaps & ovrHmdCap_NoRestore)) GfxState->Restore(); }
 
+    // Time the latency tester quad was last submitted, in ovr_GetTimeInSeconds; 0 if never.
+    double GetLatencyQuadSubmitSeconds() const { return LatencyQuadSubmitSeconds; }
+
     // *** Creation Factory logic
     
     ovrRenderAPIType GetRenderAPI() const { return RenderAPI; }
@@ -108,6 +127,7 @@ protected:
     FrameTimeManager&       TimeManager;
     const HMDRenderState&   RState;
     Ptr<GraphicsState>      GfxState;
+    double                  LatencyQuadSubmitSeconds;
 };
 
 }} // namespace OVR::CAPI
@@ -25,6 +25,9 @@ limitations under the License.
 ************************************************************************************/
 
 #include "CAPI_FrameTimeManager.h"
+#include "../Kernel/OVR_Alg.h"
+#include "../Kernel/OVR_PerfCounters.h"
+#include "../Kernel/OVR_Trace.h"
 
 
 namespace OVR { namespace CAPI {
@@ -42,20 +45,22 @@ FrameLatencyTracker::FrameLatencyTracker()
 void FrameLatencyTracker::Reset()
 {
     TrackerEnabled         = true;
-    WaitMode               = SampleWait_Zeroes;
     FrameIndex             = 0;    
-    MatchCount             = 0;
+    LastRecordTime         = 0.0;
+    LastReadbackIndex      = 0;
     RenderLatencySeconds   = 0.0;
     TimewarpLatencySeconds = 0.0;
-    
+    LatencyRecordTime      = 0.0;
+    PredictionCorrection   = 0.0;
+
+    memset(FrameEndTimes, 0, sizeof(FrameEndTimes));
     FrameDeltas.Clear();
 }
 
 
 unsigned char FrameLatencyTracker::GetNextDrawColor()
 {   
-    if (!TrackerEnabled || (WaitMode == SampleWait_Zeroes) ||
-        (FrameIndex >= FramesTracked))
+    if (!TrackerEnabled)
     {        
         return (unsigned char)Util::FrameTimeRecord::ReadbackIndexToColor(0);
     }
@@ -66,126 +71,94 @@ unsigned char FrameLatencyTracker::GetNextDrawColor()
 
 
 void FrameLatencyTracker::SaveDrawColor(unsigned char drawColor, double endFrameTime,
-                                        double renderIMUTime, double timewarpIMUTime )
+                                        double renderIMUTime, double timewarpIMUTime,
+                                        double predictedScanoutTime )
 {
-    if (!TrackerEnabled || (WaitMode == SampleWait_Zeroes))
+    if (!TrackerEnabled)
         return;
 
-    if (FrameIndex < FramesTracked)
-    {
-        OVR_ASSERT(Util::FrameTimeRecord::ReadbackIndexToColor(FrameIndex+1) == drawColor);
-        OVR_UNUSED(drawColor);
-
-        // saves {color, endFrame time}
-        FrameEndTimes[FrameIndex].ReadbackIndex         = FrameIndex + 1;
-        FrameEndTimes[FrameIndex].TimeSeconds           = endFrameTime;
-        FrameEndTimes[FrameIndex].RenderIMUTimeSeconds  = renderIMUTime;
-        FrameEndTimes[FrameIndex].TimewarpIMUTimeSeconds= timewarpIMUTime;
-        FrameEndTimes[FrameIndex].MatchedRecord         = false;
-        FrameIndex++;
-    }
-    else
-    {
-        // If the request was outstanding for too long, switch to zero mode to restart.
-        if (endFrameTime > (FrameEndTimes[FrameIndex-1].TimeSeconds + 0.15))
-        {
-            if (MatchCount == 0)
-            {
-                // If nothing was matched, we have no latency reading.
-                RenderLatencySeconds   = 0.0;
-                TimewarpLatencySeconds = 0.0;
-            }
-
-            WaitMode   =  SampleWait_Zeroes;
-            MatchCount = 0;
-            FrameIndex = 0;
-        }
-    }
+    OVR_ASSERT(Util::FrameTimeRecord::ReadbackIndexToColor(FrameIndex+1) == drawColor);
+    OVR_UNUSED(drawColor);
+
+    // saves {color, endFrame time}, replacing the frame drawn with the color before.
+    FrameEndTimes[FrameIndex].ReadbackIndex         = FrameIndex + 1;
+    FrameEndTimes[FrameIndex].TimeSeconds           = endFrameTime;
+    FrameEndTimes[FrameIndex].RenderIMUTimeSeconds  = renderIMUTime;
+    FrameEndTimes[FrameIndex].TimewarpIMUTimeSeconds= timewarpIMUTime;
+    FrameEndTimes[FrameIndex].PredictedScanoutSeconds= predictedScanoutTime;
+    FrameEndTimes[FrameIndex].MatchedRecord         = false;
+
+    FrameIndex = (FrameIndex + 1) % FramesTracked;
 }
 
 
+// Seconds between the measured scan-out of a frame and the one it was rendered for.
+static PerfCounter ScanoutPredictionErrorCounter("perf.latency.scanoutPredictionError");
+// Seconds from the sample of the pose a frame shows, timewarp's if it had one, to
+// the measured scan-out of the frame; the last of the "perf.latency.sampleTo*" stages.
+static PerfCounter SampleToScanoutCounter("perf.latency.sampleToScanout", PerfCounter::Option_Histogram);
+
+// PredictionCorrection moves by a fixed step per measured frame, which at 75 Hz
+// covers the whole range in about a second, and jitters by a step once converged.
+static const double PredictionCorrectionStep  = 0.0002;
+// A systematic error larger than a frame means the timing is broken, not biased.
+static const double PredictionCorrectionLimit = 0.02;
+
 void FrameLatencyTracker::MatchRecord(const Util::FrameTimeRecordSet &r)
 {
     if (!TrackerEnabled)
         return;
 
-    if (WaitMode == SampleWait_Zeroes)
-    {
-        // Do we have all zeros?
-        if (r.IsAllZeroes())
-        {
-            OVR_ASSERT(FrameIndex == 0);
-            WaitMode = SampleWait_Match;
-            MatchCount = 0;
-        }
-        return;
-    }
-
-    // We are in Match Mode. Wait until all colors are matched or timeout,
-    // at which point we go back to zeros.
-
-    for (int i = 0; i < FrameIndex; i++)
+    // Records are oldest first; the ones already looked at are skipped.
+    for (int i = 0; i < Util::FrameTimeRecordSet::RecordCount; i++)
     {
-        int recordIndex = 0;
-        int consecutiveMatch  = 0;
-
-        OVR_ASSERT(FrameEndTimes[i].ReadbackIndex != 0);
-
-        if (r.FindReadbackIndex(&recordIndex, FrameEndTimes[i].ReadbackIndex))
+        const Util::FrameTimeRecord& scanoutFrame = r[i];
+        if (scanoutFrame.TimeSeconds <= LastRecordTime)
+            continue;
+
+        int previousIndex = LastReadbackIndex;
+        LastRecordTime    = scanoutFrame.TimeSeconds;
+        LastReadbackIndex = scanoutFrame.ReadbackIndex;
+
+        int slot = scanoutFrame.ReadbackIndex - 1;
+        if ((slot < 0) || (slot >= FramesTracked))
+            continue;
+
+        // A pixel read halfway through the change from the last color to the first
+        // may look like any color between them, so a color only counts when it
+        // follows the color before it. Colors are drawn after 0 until the first match.
+        int expectedPrevious = (slot == 0) ? FramesTracked : slot;
+        if ((previousIndex != expectedPrevious) && (previousIndex != 0))
+            continue;
+
+        // The first scan-out of the frame is the one measured; reads of the same
+        // color before the frame ended were of the frame drawn with it the cycle before.
+        FrameTimeRecordEx& renderFrame  = FrameEndTimes[slot];
+        double             deltaSeconds = scanoutFrame.TimeSeconds - renderFrame.TimeSeconds;
+        if ((renderFrame.ReadbackIndex == 0) || renderFrame.MatchedRecord ||
+            (deltaSeconds <= 0.0) || (deltaSeconds > 0.15))
+            continue;
+
+        FrameDeltas.AddTimeDelta(deltaSeconds);
+        LatencyRecordTime      = scanoutFrame.TimeSeconds;
+        RenderLatencySeconds   = scanoutFrame.TimeSeconds - renderFrame.RenderIMUTimeSeconds;
+        TimewarpLatencySeconds = (renderFrame.TimewarpIMUTimeSeconds == 0.0)  ?  0.0 :
+                                 (scanoutFrame.TimeSeconds - renderFrame.TimewarpIMUTimeSeconds);
+        renderFrame.MatchedRecord = true;
+
+        double sampleTime = (renderFrame.TimewarpIMUTimeSeconds != 0.0) ?
+                            renderFrame.TimewarpIMUTimeSeconds : renderFrame.RenderIMUTimeSeconds;
+        if (sampleTime != 0.0)
+            SampleToScanoutCounter.Record(scanoutFrame.TimeSeconds - sampleTime);
+
+        if (renderFrame.PredictedScanoutSeconds != 0.0)
         {
-            // Advance forward to see that we have several more matches.
-            int  ri = recordIndex + 1;
-            int  j  = i + 1;
-
-            consecutiveMatch++;
-
-            for (; (j < FrameIndex) && (ri < Util::FrameTimeRecordSet::RecordCount); j++, ri++)
-            {
-                if (r[ri].ReadbackIndex != FrameEndTimes[j].ReadbackIndex)
-                    break;
-                consecutiveMatch++;
-            }
-
-            // Match at least 2 items in the row, to avoid accidentally matching color.
-            if (consecutiveMatch > 1)
-            {
-                // Record latency values for all but last samples. Keep last 2 samples
-                // for the future to simplify matching.
-                for (int q = 0; q < consecutiveMatch; q++)
-                {
-                    const Util::FrameTimeRecord &scanoutFrame = r[recordIndex+q];
-                    FrameTimeRecordEx           &renderFrame  = FrameEndTimes[i+q];
-                    
-                    if (!renderFrame.MatchedRecord)
-                    {
-                        double deltaSeconds = scanoutFrame.TimeSeconds - renderFrame.TimeSeconds;
-                        if (deltaSeconds > 0.0)
-                        {
-                            FrameDeltas.AddTimeDelta(deltaSeconds);
-                            LatencyRecordTime      = scanoutFrame.TimeSeconds;
-                            RenderLatencySeconds   = scanoutFrame.TimeSeconds - renderFrame.RenderIMUTimeSeconds;
-                            TimewarpLatencySeconds = (renderFrame.TimewarpIMUTimeSeconds == 0.0)  ?  0.0 :
-                                                     (scanoutFrame.TimeSeconds - renderFrame.TimewarpIMUTimeSeconds);
-                        }
-
-                        renderFrame.MatchedRecord = true;
-                        MatchCount++;
-                    }
-                }
-
-                // Exit for.
-                break;
-            }
+            double error = scanoutFrame.TimeSeconds - renderFrame.PredictedScanoutSeconds;
+            ScanoutPredictionErrorCounter.Record(error);
+            PredictionCorrection += (error > 0.0) ? PredictionCorrectionStep : -PredictionCorrectionStep;
+            PredictionCorrection  = Alg::Clamp(PredictionCorrection,
+                                               -PredictionCorrectionLimit, PredictionCorrectionLimit);
         }
-    } // for ( i => FrameIndex )
-
-
-    // If we matched all frames, start over.
-    if (MatchCount == FramesTracked)
-    {
-        WaitMode   =  SampleWait_Zeroes;
-        MatchCount = 0;
-        FrameIndex = 0;
     }
 }
 
@@ -208,12 +181,103 @@ void FrameLatencyTracker::GetLatencyTimings(float latencies[3])
     
     
 //-------------------------------------------------------------------------------------
+// ***** VsyncTracker
+
+VsyncTracker::VsyncTracker()
+    : NominalPeriod(0.0), Count(0), Newest(0)
+{
+}
+
+void VsyncTracker::Reset(double nominalPeriod)
+{
+    Lock::Locker lock(&TrackerLock);
+    NominalPeriod = nominalPeriod;
+    Count         = 0;
+    Newest        = 0;
+}
+
+void VsyncTracker::AddPresentTime(double time, SInt64 vsyncCount)
+{
+    Lock::Locker lock(&TrackerLock);
+
+    // Samples of the other kind don't mix with these.
+    if (Count > 0 && ((VsyncCounts[Newest] >= 0) != (vsyncCount >= 0)))
+        Count = 0;
+    // Nor do those of a vsync counter that went back, as it does on a mode change.
+    else if (Count > 0 && vsyncCount >= 0 && vsyncCount <= VsyncCounts[Newest])
+        Count = 0;
+
+    Newest              = (Count > 0) ? (Newest + 1) % Capacity : 0;
+    Times[Newest]       = time;
+    VsyncCounts[Newest] = vsyncCount;
+    if (Count < Capacity)
+        Count++;
+}
+
+bool VsyncTracker::GetModel(double* pVsyncTime, double* pPeriod) const
+{
+    Lock::Locker lock(&TrackerLock);
+
+    if (Count == 0)
+        return false;
+
+    double newestTime = Times[Newest];
+    double period     = NominalPeriod;
+
+    if (VsyncCounts[Newest] >= 0)
+    {
+        // Timestamps are of the vsyncs themselves.
+        int oldest = (Newest + Capacity - (Count - 1)) % Capacity;
+        if (VsyncCounts[Newest] > VsyncCounts[oldest])
+            period = (newestTime - Times[oldest]) / double(VsyncCounts[Newest] - VsyncCounts[oldest]);
+        *pVsyncTime = newestTime;
+        *pPeriod    = period;
+        return period > 0.0;
+    }
+
+    if (period <= 0.0)
+        return false;
+
+    // Presents that finished later than the earliest one, in the phase of the
+    // vsyncs, were held up after their vsync.
+    double earliest = 0.0;
+    for (int i = 0; i < Count; i++)
+    {
+        double delta = Times[i] - newestTime;
+        double phase = delta - floor(delta / period + 0.5) * period;
+        if (phase < earliest)
+            earliest = phase;
+    }
+
+    *pVsyncTime = newestTime + earliest;
+    *pPeriod    = period;
+    return true;
+}
+
+
+//-------------------------------------------------------------------------------------
+
+// Time on top of a frame's recent worst in which GetRecommendedFrameStart
+// plans it to be done ahead of its vsync.
+static const double FramePacingMarginSeconds = 0.002;
+
+// Dynamic resolution aims to keep the GPU busy for this part of a frame, and
+// raises the scale by at most RenderScaleStep a frame.
+static const double RenderScaleTargetLoad = 0.8;
+static const float  RenderScaleStep       = 0.01f;
 
 FrameTimeManager::FrameTimeManager(bool vsyncEnabled)
-    : VsyncEnabled(vsyncEnabled), DynamicPrediction(true), SdkRender(false),
+    : PresentTimesFromRenderer(false), FrameBeginTime(0.0),
+      RenderViewportScaleMin(1.0f), RenderViewportScale(1.0f),
+      TimewarpGpuSlack(0.0), HasTimewarpGpuSlack(false),
+      VsyncEnabled(vsyncEnabled), DynamicPrediction(true), SdkRender(false),
       FrameTiming()
 {    
+    memset(&FrameRecord, 0, sizeof(FrameRecord));
     RenderIMUTimeSeconds = 0.0;
+    RenderIMUTracked = false;
+    EyeRenderIMUTimeSeconds[0] = EyeRenderIMUTimeSeconds[1] = 0.0;
+    EyeRenderIMUTracked[0]     = EyeRenderIMUTracked[1]     = false;
     TimewarpIMUTimeSeconds = 0.0;
     
     // HACK: SyncToScanoutDelay observed close to 1 frame in video cards.
@@ -230,6 +294,8 @@ void FrameTimeManager::Init(HmdRenderInfo& renderInfo)
 
     ScreenSwitchingDelay = RenderInfo.Shutter.PixelSettleTime * 0.5f + 
                            RenderInfo.Shutter.PixelPersistence * 0.5f;
+
+    VsyncModel.Reset(RenderInfo.Shutter.VsyncToNextVsync);
 }
 
 void FrameTimeManager::ResetFrameTiming(unsigned frameIndex,
@@ -241,7 +307,12 @@ void FrameTimeManager::ResetFrameTiming(unsigned frameIndex,
 
     FrameTimeDeltas.Clear();
     DistortionRenderTimes.Clear();
+    FrameWorkTimes.Clear();
     ScreenLatencyTracker.Reset();
+    FrameHistory.Clear();
+    VsyncModel.Reset(RenderInfo.Shutter.VsyncToNextVsync);
+    PresentTimesFromRenderer = false;
+    FrameBeginTime           = 0.0;
 
     FrameTiming.FrameIndex               = frameIndex;
     FrameTiming.NextFrameTime            = 0.0;
@@ -284,7 +355,8 @@ double  FrameTimeManager::calcScreenDelay() const
     double  screenDelay = ScreenSwitchingDelay;
     double  measuredVSyncToScanout;
 
-    // Use real-time DK2 latency tester HW for prediction if its is working.
+    // Use real-time DK2 latency tester HW for prediction if its is working,
+    // corrected by the error of the predictions made with it.
     // Do sanity check under 60 ms
     if (!VsyncEnabled)
     {
@@ -295,7 +367,7 @@ double  FrameTimeManager::calcScreenDelay() const
               (measuredVSyncToScanout = ScreenLatencyTracker.FrameDeltas.GetMedianTimeDelta(),
                (measuredVSyncToScanout > 0.0001) && (measuredVSyncToScanout < 0.06)) ) 
     {
-        screenDelay += measuredVSyncToScanout;
+        screenDelay += measuredVSyncToScanout + ScreenLatencyTracker.PredictionCorrection;
     }
     else
     {
@@ -405,7 +477,11 @@ void FrameTimeManager::Timing::InitTimingFromInputs(const FrameTimeManager::Timi
 double FrameTimeManager::BeginFrame(unsigned frameIndex)
 {    
     RenderIMUTimeSeconds = 0.0;
+    RenderIMUTracked = false;
+    EyeRenderIMUTimeSeconds[0] = EyeRenderIMUTimeSeconds[1] = 0.0;
+    EyeRenderIMUTracked[0]     = EyeRenderIMUTracked[1]     = false;
     TimewarpIMUTimeSeconds = 0.0;
+    FrameBeginTime = ovr_GetTimeInSeconds();
 
     // ThisFrameTime comes from the end of last frame, unless it it changed.
     double thisFrameTime = (FrameTiming.NextFrameTime != 0.0) ?
@@ -415,28 +491,147 @@ double FrameTimeManager::BeginFrame(unsigned frameIndex)
     FrameTiming.InitTimingFromInputs(FrameTiming.Inputs, RenderInfo.Shutter.Type,
                                      thisFrameTime, frameIndex);
 
+    HasTimewarpGpuSlack = false;
+
+    memset(&FrameRecord, 0, sizeof(FrameRecord));
+    FrameRecord.FrameIndex              = frameIndex;
+    FrameRecord.BeginFrameSeconds       = FrameBeginTime;
+    FrameRecord.PredictedScanoutSeconds = FrameTiming.NextFrameTime + FrameTiming.Inputs.ScreenDelay;
+
     return FrameTiming.ThisFrameTime;
 }
 
 
+// Seconds between the frame time predicted from the previous frames and the
+// actual one.
+static PerfCounter PredictionErrorCounter("perf.frame.predictionError");
+// The 95th and 99th percentile of the recent frame times, at each frame.
+static PerfCounter FrameTimeP95Counter("perf.frame.timeP95");
+static PerfCounter FrameTimeP99Counter("perf.frame.timeP99");
+// Seconds the GPU took to render distortion, for the frames that measured it.
+static PerfCounter DistortionTimeCounter("perf.distortion.gpuTime");
+// Seconds from the sample of the pose a frame shows to the scan-out expected for
+// it when the frame ends, for every frame; sampleToScanout measures it on DK2.
+static PerfCounter SampleToPredictedScanoutCounter("perf.latency.sampleToPredictedScanout",
+                                                   PerfCounter::Option_Histogram);
+
 void FrameTimeManager::EndFrame()
 {
+    // The eye threads are done with this frame; the older of their samples is the
+    // one the frame is timed by.
+    for (int eye = 0; eye < 2; eye++)
+    {
+        if (EyeRenderIMUTimeSeconds[eye] != 0.0 &&
+            (RenderIMUTimeSeconds == 0.0 || EyeRenderIMUTimeSeconds[eye] < RenderIMUTimeSeconds))
+        {
+            RenderIMUTimeSeconds = EyeRenderIMUTimeSeconds[eye];
+            RenderIMUTracked     = EyeRenderIMUTracked[eye];
+        }
+    }
+
     // Record timing since last frame; must be called after Present & sync.
     FrameTiming.NextFrameTime = ovr_GetTimeInSeconds();    
     if (FrameTiming.ThisFrameTime > 0.0)
     {
-        FrameTimeDeltas.AddTimeDelta(FrameTiming.NextFrameTime - FrameTiming.ThisFrameTime);
+        double frameDelta = FrameTiming.NextFrameTime - FrameTiming.ThisFrameTime;
+        // The frame as it was predicted, against the vsync it actually ended on.
+        OVR_TRACE_SPAN("FrameTimeManager::PredictedFrame", FrameTiming.ThisFrameTime,
+                       FrameTiming.ThisFrameTime + FrameTiming.Inputs.FrameDelta);
+        OVR_TRACE_SPAN("FrameTimeManager::Frame", FrameTiming.ThisFrameTime, FrameTiming.NextFrameTime);
+        PredictionErrorCounter.Record(fabs(frameDelta - FrameTiming.Inputs.FrameDelta));
+        FrameTimeDeltas.AddTimeDelta(frameDelta);
+        updateRenderViewportScale(frameDelta);
+        FrameTimeP95Counter.Record(FrameTimeDeltas.GetPercentileTimeDelta(0.95));
+        FrameTimeP99Counter.Record(FrameTimeDeltas.GetPercentileTimeDelta(0.99));
         FrameTiming.Inputs.FrameDelta = calcFrameDelta();
     }
 
+    if (!PresentTimesFromRenderer)
+        VsyncModel.AddPresentTime(FrameTiming.NextFrameTime, -1);
+
+    if (FrameRecord.BeginFrameSeconds > 0.0)
+    {
+        FrameRecord.EndFrameSeconds = FrameTiming.NextFrameTime;
+        FrameRecord.ScanoutSeconds  = FrameTiming.NextFrameTime + calcScreenDelay();
+        double sampleTime = (TimewarpIMUTimeSeconds != 0.0) ? TimewarpIMUTimeSeconds : RenderIMUTimeSeconds;
+        if (RenderIMUTracked)
+            SampleToPredictedScanoutCounter.Record(FrameRecord.ScanoutSeconds - sampleTime);
+        ScreenLatencyTracker.GetLatencyTimings(FrameRecord.LatencySeconds);
+        FrameHistory.Push(FrameRecord);
+        FrameRecord.BeginFrameSeconds = 0.0;
+    }
+
     // Write to Lock-less
     LocklessTiming.SetState(FrameTiming);
 }
 
 
+void FrameTimeManager::SubmitFrame()
+{
+    if (FrameBeginTime > 0.0)
+        FrameWorkTimes.AddTimeDelta(ovr_GetTimeInSeconds() - FrameBeginTime);
+}
+
+
+void FrameTimeManager::AddPresentTime(double time, SInt64 vsyncCount)
+{
+    PresentTimesFromRenderer = true;
+    VsyncModel.AddPresentTime(time, vsyncCount);
+}
+
+
+double FrameTimeManager::GetRecommendedFrameStart(double time)
+{
+    double vsyncTime, period;
+    if (!VsyncEnabled || FrameWorkTimes.GetCount() < 3 ||
+        !VsyncModel.GetModel(&vsyncTime, &period))
+        return time;
+
+    // The frame has to be rendered, and distorted, before the vsync it shows at.
+    double workTime = FrameWorkTimes.GetMaxTimeDelta() + FramePacingMarginSeconds;
+    if (SdkRender && DistortionRenderTimes.GetCount() > 0)
+        workTime += DistortionRenderTimes.GetMedianTimeDelta();
+
+    // The first vsync the frame can make, and the latest start that makes it.
+    double targetVsync = vsyncTime + ceil((time + workTime - vsyncTime) / period) * period;
+    double frameStart  = targetVsync - workTime;
+    return (frameStart > time) ? frameStart : time;
+}
+
+
 
 // Thread-safe function to query timing for a future frame
 
+FrameTimeManager::Timing FrameTimeManager::GetTimingForVsync(double vsyncTime)
+{
+    Timing       timing = LocklessTiming.GetState();
+    TimingInputs inputs = timing.Inputs;
+
+    // Without vsync the frame delta is 0, but a thread timing its own frames
+    // still shows them at the display rate.
+    if (inputs.FrameDelta <= 0.0)
+        inputs.FrameDelta = RenderInfo.Shutter.VsyncToNextVsync;
+
+    timing.InitTimingFromInputs(inputs, RenderInfo.Shutter.Type,
+                                vsyncTime - inputs.FrameDelta, timing.FrameIndex);
+    return timing;
+}
+
+FrameTimeManager::Timing FrameTimeManager::GetTimingForVsyncAfter(double time)
+{
+    Timing timing     = LocklessTiming.GetState();
+    double frameDelta = (timing.Inputs.FrameDelta > 0.0) ?
+                        timing.Inputs.FrameDelta : RenderInfo.Shutter.VsyncToNextVsync;
+    double vsyncTime  = timing.NextFrameTime;
+
+    if (vsyncTime <= 0.0 || frameDelta <= 0.0)
+        vsyncTime = time;
+    else if (vsyncTime < time)
+        vsyncTime += ceil((time - vsyncTime) / frameDelta) * frameDelta;
+
+    return GetTimingForVsync(vsyncTime);
+}
+
 FrameTimeManager::Timing FrameTimeManager::GetFrameTiming(unsigned frameIndex)
 {
     Timing frameTiming = LocklessTiming.GetState();
@@ -475,6 +670,11 @@ double FrameTimeManager::GetEyePredictionTime(ovrEyeType eye)
     return ovr_GetTimeInSeconds() + ScreenSwitchingDelay + NoVSyncToScanoutDelay;
 }
 
+// Seconds from the newest sample to its pose being read for an eye, and being
+// sampled by timewarp.
+static PerfCounter SampleToPoseReadCounter("perf.latency.sampleToPoseRead", PerfCounter::Option_Histogram);
+static PerfCounter SampleToTimewarpCounter("perf.latency.sampleToTimewarp", PerfCounter::Option_Histogram);
+
 Transformf FrameTimeManager::GetEyePredictionPose(ovrHmd hmd, ovrEyeType eye)
 {
     double         eyeRenderTime = GetEyePredictionTime(eye);
@@ -482,9 +682,16 @@ Transformf FrameTimeManager::GetEyePredictionPose(ovrHmd hmd, ovrEyeType eye)
 
 //    EyeRenderPoses[eye] = eyeState.Predicted.Pose;
 
-    // Record view pose sampling time for Latency reporting.
-    if (RenderIMUTimeSeconds == 0.0)
-        RenderIMUTimeSeconds = eyeState.Recorded.TimeInSeconds;
+    // Record view pose sampling time for Latency reporting. The eyes may be
+    // rendered on threads of their own, so each only records its own slot.
+    bool tracked = (eyeState.StatusFlags & ovrStatus_OrientationTracked) != 0;
+    if (EyeRenderIMUTimeSeconds[eye] == 0.0)
+    {
+        EyeRenderIMUTimeSeconds[eye] = eyeState.Recorded.TimeInSeconds;
+        EyeRenderIMUTracked[eye]     = tracked;
+    }
+    if (tracked)
+        SampleToPoseReadCounter.Record(ovr_GetTimeInSeconds() - eyeState.Recorded.TimeInSeconds);
 
     return eyeState.Predicted.Pose;
 }
@@ -510,8 +717,22 @@ void FrameTimeManager::GetTimewarpPredictions(ovrEyeType eye, double timewarpSta
 }
 
 
-void FrameTimeManager::GetTimewarpMatrices(ovrHmd hmd, ovrEyeType eyeId,
-                                           ovrPosef renderPose, ovrMatrix4f twmOut[2])
+void FrameTimeManager::GetTimewarpOrientations(ovrHmd hmd, ovrEyeType eyeId,
+                                               ovrPosef renderPose, Quatf twqOut[2])
+{
+    GetTimewarpOrientations(hmd, eyeId, renderPose, twqOut, 2);
+}
+
+
+double FrameTimeManager::GetTimewarpOrientations(ovrHmd hmd, ovrPosef renderPose,
+                                                 const double timewarpStartEnd[2], Quatf twqOut[2]) const
+{
+    return GetTimewarpOrientations(hmd, renderPose, timewarpStartEnd, twqOut, 2);
+}
+
+
+void FrameTimeManager::GetTimewarpOrientations(ovrHmd hmd, ovrEyeType eyeId, ovrPosef renderPose,
+                                               Quatf* twqOut, unsigned count)
 {
     if (!hmd)
     {
@@ -520,28 +741,36 @@ void FrameTimeManager::GetTimewarpMatrices(ovrHmd hmd, ovrEyeType eyeId,
 
     double timewarpStartEnd[2] = { 0.0, 0.0 };    
     GetTimewarpPredictions(eyeId, timewarpStartEnd);
-      
-    ovrSensorState startState = ovrHmd_GetSensorState(hmd, timewarpStartEnd[0]);
-    ovrSensorState endState   = ovrHmd_GetSensorState(hmd, timewarpStartEnd[1]);
+
+    double imuTime = GetTimewarpOrientations(hmd, renderPose, timewarpStartEnd, twqOut, count);
 
     if (TimewarpIMUTimeSeconds == 0.0)
-        TimewarpIMUTimeSeconds = startState.Recorded.TimeInSeconds;
+        TimewarpIMUTimeSeconds = imuTime;
+}
 
-    Quatf quatFromStart = startState.Predicted.Pose.Orientation;
-    Quatf quatFromEnd   = endState.Predicted.Pose.Orientation;
-    Quatf quatFromEye   = renderPose.Orientation; //EyeRenderPoses[eyeId].Orientation;
-    quatFromEye.Invert();
-    
-    Quatf timewarpStartQuat = quatFromEye * quatFromStart;
-    Quatf timewarpEndQuat   = quatFromEye * quatFromEnd;
 
-    Matrix4f timewarpStart(timewarpStartQuat);
-    Matrix4f timewarpEnd(timewarpEndQuat);
-    
+double FrameTimeManager::GetTimewarpOrientations(ovrHmd hmd, ovrPosef renderPose, const double timewarpStartEnd[2],
+                                                 Quatf* twqOut, unsigned count) const
+{
+    enum { MaxSamples = 16 };
+    OVR_ASSERT(count >= 2 && count <= MaxSamples);
+    count = Alg::Clamp(count, 2u, (unsigned)MaxSamples);
+
+    double        times[MaxSamples];
+    ovrPoseStatef states[MaxSamples];
+    for (unsigned i = 0; i < count; i++)
+        times[i] = timewarpStartEnd[0] + (timewarpStartEnd[1] - timewarpStartEnd[0]) * i / (count - 1);
+
+    ovrSensorState startState = ovrHmd_GetSensorStateBatch(hmd, times, states, count);
+    if (startState.StatusFlags & ovrStatus_OrientationTracked)
+        SampleToTimewarpCounter.Record(ovr_GetTimeInSeconds() - startState.Recorded.TimeInSeconds);
+
+    Quatf quatFromEye = renderPose.Orientation; //EyeRenderPoses[eyeId].Orientation;
+    quatFromEye.Invert();
 
     // The real-world orientations have:                                  X=right, Y=up,   Z=backwards.
     // The vectors inside the mesh are in NDC to keep the shader simple: X=right, Y=down, Z=forwards.
-    // So we need to perform a similarity transform on this delta matrix.
+    // So we need to perform a similarity transform on this delta rotation.
     // The verbose code would look like this:
     /*
     Matrix4f matBasisChange;
@@ -552,24 +781,51 @@ void FrameTimeManager::GetTimewarpMatrices(ovrHmd hmd, ovrEyeType eyeId,
     Matrix4f matBasisChangeInv = matBasisChange.Inverted();
     matRenderFromNow = matBasisChangeInv * matRenderFromNow * matBasisChange;
     */
-    // ...but of course all the above is a constant transform and much more easily done.
-    // We flip the signs of the Y&Z row, then flip the signs of the Y&Z column,
-    // and of course most of the flips cancel:
+    // ...but the basis change is a half turn about X, and conjugating a quaternion
+    // by that just flips the signs of its Y and Z. In the matrix that flips the
+    // signs of the Y&Z row and the Y&Z column, and of course most of the flips cancel:
     // +++                        +--                     +--
     // +++ -> flip Y&Z columns -> +-- -> flip Y&Z rows -> -++
     // +++                        +--                     -++
-    timewarpStart.M[0][1] = -timewarpStart.M[0][1];
-    timewarpStart.M[0][2] = -timewarpStart.M[0][2];
-    timewarpStart.M[1][0] = -timewarpStart.M[1][0];
-    timewarpStart.M[2][0] = -timewarpStart.M[2][0];
+    for (unsigned i = 0; i < count; i++)
+    {
+        Quatf timewarpQuat = quatFromEye * Quatf(states[i].Pose.Orientation);
+        twqOut[i] = Quatf(timewarpQuat.x, -timewarpQuat.y, -timewarpQuat.z, timewarpQuat.w);
+    }
+
+    return startState.Recorded.TimeInSeconds;
+}
+
+
+Vector3f FrameTimeManager::GetTimewarpTranslation(ovrHmd hmd, ovrPosef renderPose,
+                                                  const double timewarpStartEnd[2],
+                                                  const Vector3f& eyeOffset) const
+{
+    double         midpointTime = (timewarpStartEnd[0] + timewarpStartEnd[1]) * 0.5;
+    ovrSensorState state        = ovrHmd_GetSensorState(hmd, midpointTime);
+
+    Transformf renderedFromWorld = Transformf(renderPose).Inverted();
+    Vector3f   eyePosition       = renderedFromWorld.Apply(Transformf(state.Predicted.Pose).Apply(eyeOffset));
+    Vector3f   translation       = eyePosition - eyeOffset;
+
+    // In the basis of the mesh, as the rotations are.
+    return Vector3f(translation.x, -translation.y, -translation.z);
+}
+
+
+void FrameTimeManager::GetTimewarpMatrices(ovrHmd hmd, ovrEyeType eyeId,
+                                           ovrPosef renderPose, ovrMatrix4f twmOut[2])
+{
+    if (!hmd)
+    {
+        return;
+    }
 
-    timewarpEnd  .M[0][1] = -timewarpEnd  .M[0][1];
-    timewarpEnd  .M[0][2] = -timewarpEnd  .M[0][2];
-    timewarpEnd  .M[1][0] = -timewarpEnd  .M[1][0];
-    timewarpEnd  .M[2][0] = -timewarpEnd  .M[2][0];
+    Quatf timewarpQuats[2];
+    GetTimewarpOrientations(hmd, eyeId, renderPose, timewarpQuats);
 
-    twmOut[0] = timewarpStart;
-    twmOut[1] = timewarpEnd;
+    twmOut[0] = Matrix4f(timewarpQuats[0]);
+    twmOut[1] = Matrix4f(timewarpQuats[1]);
 }
 
 
@@ -584,6 +840,8 @@ bool  FrameTimeManager::NeedDistortionTimeMeasurement() const
 
 void  FrameTimeManager::AddDistortionTimeMeasurement(double distortionTimeSeconds)
 {
+    FrameRecord.DistortionGpuSeconds = (float)distortionTimeSeconds;
+    DistortionTimeCounter.Record(distortionTimeSeconds);
     DistortionRenderTimes.AddTimeDelta(distortionTimeSeconds);
 
     // If timewarp timing changes based on this sample, update it.
@@ -596,15 +854,91 @@ void  FrameTimeManager::AddDistortionTimeMeasurement(double distortionTimeSecond
 }
 
 
+void FrameTimeManager::AddTimewarpWait(double timewarpPointTime, double gpuIdleTime, double waitEndTime)
+{
+    FrameRecord.TimewarpWaitErrorSeconds = (float)(waitEndTime - timewarpPointTime);
+    TimewarpGpuSlack    = timewarpPointTime - gpuIdleTime;
+    HasTimewarpGpuSlack = true;
+}
+
+
+void FrameTimeManager::SetDynamicResolution(float minScale)
+{
+    RenderViewportScaleMin = (minScale > 0.0f && minScale < 1.0f) ? minScale : 1.0f;
+    RenderViewportScale    = 1.0f;
+}
+
+
+void FrameTimeManager::updateRenderViewportScale(double frameDelta)
+{
+    double period = RenderInfo.Shutter.VsyncToNextVsync;
+    if (RenderViewportScaleMin >= 1.0f || !VsyncEnabled || period <= 0.0)
+        return;
+
+    // Part of the frame the GPU was busy for. Where the renderer waited for the
+    // timewarp point, that's until the GPU was done before it; otherwise it has
+    // to be told from the time the app took over the frame, with SDK distortion,
+    // and from nothing else with game distortion.
+    double load = 0.0;
+    if (HasTimewarpGpuSlack)
+        load = 1.0 - TimewarpGpuSlack / period;
+    else if (SdkRender && FrameWorkTimes.GetCount() > 0)
+        load = (FrameWorkTimes.GetNewestTimeDelta() + DistortionRenderTimes.GetMedianTimeDelta()) / period;
+
+    // A missed vsync is more than any estimate says.
+    if (frameDelta > period * 1.5 && load < 1.2)
+        load = 1.2;
+    if (load <= 0.0)
+        return;
+
+    // Pixels, which the GPU time goes by, shrink with the square of the scale.
+    float scale = (float)(RenderViewportScale * sqrt(RenderScaleTargetLoad / load));
+    if (scale > RenderViewportScale + RenderScaleStep)
+        scale = RenderViewportScale + RenderScaleStep;
+    // Changes too small to matter would only make the viewport jitter.
+    if (fabs(scale - RenderViewportScale) < RenderScaleStep * 0.5f)
+        return;
+
+    RenderViewportScale = Alg::Clamp(scale, RenderViewportScaleMin, 1.0f);
+}
+
+
+unsigned FrameTimeManager::GetFrameHistory(ovrFrameRecord* records, unsigned maxRecords) const
+{
+    UInt32 count  = 0;
+    UInt32 newest = FrameHistory.GetNewest(&count);
+    if (count > maxRecords)
+        count = maxRecords;
+
+    // Records the render thread overwrote while they were copied are skipped.
+    unsigned copied = 0;
+    for (UInt32 number = newest + 1 - count; number != newest + 1; number++)
+    {
+        if (FrameHistory.TryGet(number, &records[copied]))
+            copied++;
+    }
+    return copied;
+}
+
+
 void FrameTimeManager::UpdateFrameLatencyTrackingAfterEndFrame(
                                     unsigned char frameLatencyTestColor,
                                     const Util::FrameTimeRecordSet& rs)
 {    
     // FrameTiming.NextFrameTime in this context (after EndFrame) is the end frame time.
+    // The frame's predicted scan-out is only known if it went through BeginFrame,
+    // and is only corrected when the prediction uses the measurements; the pixel
+    // is read before the switching delay added for the eye.
+    double predictedScanoutTime = 0.0;
+    if (DynamicPrediction && VsyncEnabled &&
+        (FrameRecord.EndFrameSeconds == FrameTiming.NextFrameTime))
+        predictedScanoutTime = FrameRecord.PredictedScanoutSeconds - ScreenSwitchingDelay;
+
     ScreenLatencyTracker.SaveDrawColor(frameLatencyTestColor,
                                        FrameTiming.NextFrameTime,
                                        RenderIMUTimeSeconds,
-                                       TimewarpIMUTimeSeconds);
+                                       TimewarpIMUTimeSeconds,
+                                       predictedScanoutTime);
 
     ScreenLatencyTracker.MatchRecord(rs);
 
@@ -629,45 +963,36 @@ void TimeDeltaCollector::AddTimeDelta(double timeSeconds)
 
     if (Count == Capacity)
     {
-        for(int i=0; i< Count-1; i++)
-            TimeBufferSeconds[i] = TimeBufferSeconds[i+1];
+        // The new sample takes the place of the oldest, in both orders.
+        UPInt index = Alg::LowerBoundSized(SortedSeconds, Count, TimeBufferSeconds[Oldest]);
+        memmove(SortedSeconds + index, SortedSeconds + index + 1, (Count - index - 1) * sizeof(double));
         Count--;
-    }
-    TimeBufferSeconds[Count++] = timeSeconds;
-}
-
-double TimeDeltaCollector::GetMedianTimeDelta() const
-{
-    double  SortedList[Capacity];
-    bool    used[Capacity];
 
-    memset(used, 0, sizeof(used));
-    SortedList[0] = 0.0; // In case Count was 0...
-
-    // Probably the slowest way to find median...
-    for (int i=0; i<Count; i++)
+        TimeBufferSeconds[Oldest] = timeSeconds;
+        Oldest = (Oldest + 1) % Capacity;
+    }
+    else
     {
-        double smallestDelta = 1000000.0;
-        int    index = 0;
+        TimeBufferSeconds[(Oldest + Count) % Capacity] = timeSeconds;
+    }
 
-        for (int j = 0; j < Count; j++)
-        {
-            if (!used[j])
-            {                
-                if (TimeBufferSeconds[j] < smallestDelta)
-                {
-                    smallestDelta = TimeBufferSeconds[j];
-                    index = j;
-                }
-            }
-        }
+    UPInt index = Alg::LowerBoundSized(SortedSeconds, Count, timeSeconds);
+    memmove(SortedSeconds + index + 1, SortedSeconds + index, (Count - index) * sizeof(double));
+    SortedSeconds[index] = timeSeconds;
+    Count++;
+}
 
-        // Mark as used
-        used[index]   = true;
-        SortedList[i] = smallestDelta;
-    }
+double TimeDeltaCollector::GetPercentileTimeDelta(double fraction) const
+{
+    if (Count == 0)
+        return 0.0;
 
-    return SortedList[Count/2];
+    int rank = (int)ceil(fraction * Count);
+    if (rank < 1)
+        rank = 1;
+    else if (rank > Count)
+        rank = Count;
+    return SortedSeconds[rank - 1];
 }
       
 
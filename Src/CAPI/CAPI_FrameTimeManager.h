@@ -30,6 +30,8 @@ limitations under the License.
 #include "../OVR_CAPI.h"
 #include "../Kernel/OVR_Timer.h"
 #include "../Kernel/OVR_Math.h"
+#include "../Kernel/OVR_Threads.h"
+#include "../Kernel/OVR_Lockless.h"
 #include "../Util/Util_Render_Stereo.h"
 #include "../Util/Util_LatencyTest2.h"
 
@@ -38,22 +40,68 @@ namespace OVR { namespace CAPI {
 //-------------------------------------------------------------------------------------
 
 // Helper class to collect median times between frames, so that we know
-// how long to wait. 
+// how long to wait. The window of samples is also kept sorted as they are added,
+// so that the median and the other percentiles are read in constant time.
 struct TimeDeltaCollector
 {
-    TimeDeltaCollector() : Count(0) { }
+    TimeDeltaCollector() : Count(0), Oldest(0) { }
 
     void    AddTimeDelta(double timeSeconds);    
-    void    Clear() { Count = 0; }    
+    void    Clear() { Count = 0; Oldest = 0; }    
 
-    double  GetMedianTimeDelta() const;
+    double  GetMedianTimeDelta() const { return Count ? SortedSeconds[Count / 2] : 0.0; }
+    double  GetMaxTimeDelta() const    { return Count ? SortedSeconds[Count - 1] : 0.0; }
+    double  GetNewestTimeDelta() const
+    { return Count ? TimeBufferSeconds[(Oldest + Count - 1) % Capacity] : 0.0; }
+    // Nearest-rank percentile of the samples, for a fraction from 0 to 1.
+    double  GetPercentileTimeDelta(double fraction) const;
 
     double  GetCount() const { return Count; }
 
     enum { Capacity = 12 };
 private:    
     int     Count;
+    // Samples in the order they came, from Oldest on.
+    int     Oldest;
     double  TimeBufferSeconds[Capacity];
+    double  SortedSeconds[Capacity];
+};
+
+
+//-------------------------------------------------------------------------------------
+// ***** VsyncTracker
+
+// VsyncTracker models the display's vsync as a period and the time of a recent vsync,
+// from the times frames were presented at. Vsync timestamps from the graphics API,
+// with the display's count of vsyncs, give both exactly. Times that presenting a
+// frame was seen to finish at are only ever late, so the phase is taken from the
+// earliest of the recent ones and the period is the display's.
+// Thread-safe, so that renderers presenting on threads of their own can report.
+
+class VsyncTracker
+{
+public:
+    VsyncTracker();
+
+    void    Reset(double nominalPeriod);
+
+    // Records the time of a vsync with the display's count for it, or with a
+    // count of -1 the time a frame finished presenting at.
+    void    AddPresentTime(double time, SInt64 vsyncCount);
+
+    // Gets the time of a recent vsync and the vsync period; false until
+    // something was presented.
+    bool    GetModel(double* pVsyncTime, double* pPeriod) const;
+
+private:
+    enum { Capacity = 16 };
+
+    mutable Lock TrackerLock;
+    double  NominalPeriod;
+    int     Count;
+    int     Newest;
+    double  Times[Capacity];
+    SInt64  VsyncCounts[Capacity];
 };
 
 
@@ -67,7 +115,9 @@ private:
 //
 // The class operates by generating color values from GetNextDrawColor() that must
 // be rendered on the back end and then looking for matching values in FrameTimeRecordSet
-// structure as reported by HW.
+// structure as reported by HW. Frames cycle through the colors continuously; the
+// latest frame drawn with each color is kept in the color's slot, which a readback
+// record's color indexes directly.
 
 class FrameLatencyTracker
 {
@@ -80,8 +130,11 @@ public:
     // DrawColor == 0 is special in that it doesn't need saving of timestamp
     unsigned char GetNextDrawColor();
 
+    // predictedScanoutTime is when the frame's pixel was predicted to be read,
+    // or 0 if it wasn't predicted.
     void SaveDrawColor(unsigned char drawColor, double endFrameTime,
-                       double renderIMUTime, double timewarpIMUTime );
+                       double renderIMUTime, double timewarpIMUTime,
+                       double predictedScanoutTime );
 
     void MatchRecord(const Util::FrameTimeRecordSet &r);   
 
@@ -96,23 +149,25 @@ public:
         bool    MatchedRecord;
         double  RenderIMUTimeSeconds;
         double  TimewarpIMUTimeSeconds;
+        double  PredictedScanoutSeconds;
     };
 
     // True if rendering read-back is enabled.
     bool                  TrackerEnabled;
 
-    enum SampleWaitType {
-        SampleWait_Zeroes, // We are waiting for a record with all zeros.
-        SampleWait_Match   // We are issuing & matching colors.
-    };
-    
-    SampleWaitType        WaitMode;
-    int                   MatchCount;
-    // Records of frame timings that we are trying to measure.
+    // Records of frame timings that we are trying to measure, by readback index - 1.
     FrameTimeRecordEx     FrameEndTimes[FramesTracked];
+    // Slot of the next frame drawn.
     int                   FrameIndex;
+    // Newest readback record looked at, so that each is only matched once.
+    double                LastRecordTime;
+    int                   LastReadbackIndex;
     // Median filter for (ScanoutTimeSeconds - PostPresent frame time)
     TimeDeltaCollector    FrameDeltas;
+    // Seconds added to the predicted scan-out, so that the predictions converge on
+    // the measured scan-outs. It steps towards the median of the prediction errors,
+    // which the odd frame that misses its vsync moves by one step only.
+    double                PredictionCorrection;
     // Latency reporting results
     double                RenderLatencySeconds;
     double                TimewarpLatencySeconds;
@@ -183,23 +238,73 @@ public:
 
     void    SetVsync(bool enabled) { VsyncEnabled = enabled; }
 
+    // Renderers that know when frames were presented report it, with a vsync
+    // timestamp from the graphics API and its vsync count, or with a count of -1
+    // the time presenting was seen to finish at. Until they do, EndFrame times
+    // are taken as those. Thread-safe.
+    void    AddPresentTime(double time, SInt64 vsyncCount = -1);
+
     // BeginFrame returns time of the call
     // TBD: Should this be a predicted time value instead ?
     double  BeginFrame(unsigned frameIndex);
+    // Called when the app is done rendering a frame with SDK distortion, before
+    // the distortion of it, to learn how long the app takes over a frame.
+    void    SubmitFrame();
     void    EndFrame();    
 
+    // Latest time a frame started at the given time or later can start at and
+    // still show up at the first vsync it can make, as far as the vsync model and
+    // the time recent frames took tell. Returns the given time until there is
+    // enough to go by, or without vsync.
+    double  GetRecommendedFrameStart(double time);
+
     // Thread-safe function to query timing for a future frame
     Timing  GetFrameTiming(unsigned frameIndex);
+    // Thread-safe timing of a frame that is shown at the vsync at vsyncTime, for
+    // renderers that present on their own schedule rather than the app's frames.
+    Timing  GetTimingForVsync(double vsyncTime);
+    // Thread-safe timing of the first frame shown after the given time, at the
+    // vsync cadence the timing of the current frame was predicted with.
+    Timing  GetTimingForVsyncAfter(double time);
  
     double  GetEyePredictionTime(ovrEyeType eye);
     Transformf GetEyePredictionPose(ovrHmd hmd, ovrEyeType eye);
 
     void    GetTimewarpPredictions(ovrEyeType eye, double timewarpStartEnd[2]); 
     void    GetTimewarpMatrices(ovrHmd hmd, ovrEyeType eye, ovrPosef renderPose, ovrMatrix4f twmOut[2]);
+    // The rotations GetTimewarpMatrices makes, as quaternions, for renderers
+    // that apply them in the distortion shader.
+    void    GetTimewarpOrientations(ovrHmd hmd, ovrEyeType eye, ovrPosef renderPose, Quatf twqOut[2]);
+    // The same for given start and end prediction times; thread-safe. Returns the
+    // time of the IMU sample the predictions were made from.
+    double  GetTimewarpOrientations(ovrHmd hmd, ovrPosef renderPose,
+                                    const double timewarpStartEnd[2], Quatf twqOut[2]) const;
+    // The rotations for count times spread evenly from the start to the end of
+    // the eye's scan-out, predicted from one sensor reading, for renderers that
+    // warp each band of scanlines by the time it is shown; count is at least 2.
+    void    GetTimewarpOrientations(ovrHmd hmd, ovrEyeType eye, ovrPosef renderPose,
+                                    Quatf* twqOut, unsigned count);
+    double  GetTimewarpOrientations(ovrHmd hmd, ovrPosef renderPose, const double timewarpStartEnd[2],
+                                    Quatf* twqOut, unsigned count) const;
+    // Where the eye at eyeOffset from the head is predicted to be in the middle of
+    // its scan-out, relative to where it was rendered from, in the basis of the
+    // timewarp rotations; for positional timewarp. Thread-safe.
+    Vector3f GetTimewarpTranslation(ovrHmd hmd, ovrPosef renderPose, const double timewarpStartEnd[2],
+                                    const Vector3f& eyeOffset) const;
 
     // Used by renderer to determine if it should time distortion rendering.
     bool    NeedDistortionTimeMeasurement() const;
     void    AddDistortionTimeMeasurement(double distortionTimeSeconds);
+    // Called by renderers when a wait for the timewarp point is over, with the
+    // time the GPU was seen to be done with the frame before the wait.
+    void    AddTimewarpWait(double timewarpPointTime, double gpuIdleTime, double waitEndTime);
+
+    // Dynamic resolution; see ovrHmd_SetDynamicResolution.
+    void    SetDynamicResolution(float minScale);
+    float   GetRenderViewportScale() const { return RenderViewportScale; }
+
+    // Copies the records of the most recent frames, oldest first; thread-safe.
+    unsigned GetFrameHistory(ovrFrameRecord* records, unsigned maxRecords) const;
 
     
     // DK2 Lateny test interface
@@ -224,12 +329,39 @@ private:
     double  calcFrameDelta() const;
     double  calcScreenDelay() const;
     double  calcTimewarpWaitDelta() const;    
+    // Adjusts RenderViewportScale from how much of the last frame's time the GPU
+    // was busy for.
+    void    updateRenderViewportScale(double frameDelta);
     
     
     HmdRenderInfo       RenderInfo;
     // Timings are collected through a median filter, to avoid outliers.
     TimeDeltaCollector  FrameTimeDeltas;
     TimeDeltaCollector  DistortionRenderTimes;
+    // From BeginFrame to SubmitFrame, of recent frames.
+    TimeDeltaCollector  FrameWorkTimes;
+    VsyncTracker        VsyncModel;
+    // Set once a renderer reports presentation times.
+    bool                PresentTimesFromRenderer;
+    // Time BeginFrame was called at.
+    double              FrameBeginTime;
+
+    // Dynamic resolution; a minimum of 1 turns it off.
+    float               RenderViewportScaleMin;
+    float               RenderViewportScale;
+    // Time left before the timewarp point when the GPU was done with the frame,
+    // if known for this frame.
+    double              TimewarpGpuSlack;
+    bool                HasTimewarpGpuSlack;
+
+#if defined(OVR_COMPACT_HMD_STATE)
+    enum { FrameHistoryCapacity = 32 };
+#else
+    enum { FrameHistoryCapacity = 128 };
+#endif
+    // Record of the current frame, pushed to FrameHistory at EndFrame.
+    ovrFrameRecord      FrameRecord;
+    LocklessHistory<ovrFrameRecord, FrameHistoryCapacity> FrameHistory;
     FrameLatencyTracker ScreenLatencyTracker;
 
     // Timing changes if we have no Vsync (all prediction is reduced to fixed interval).
@@ -248,11 +380,18 @@ private:
     // Current (or last) frame timing info. Used as a source for LocklessTiming.
     Timing                  FrameTiming;
     // TBD: Don't we need NextFrame here as well?
-    LocklessUpdater<Timing> LocklessTiming;
+    LocklessSlotUpdater<Timing> LocklessTiming;
 
 
     // IMU Read timings
     double              RenderIMUTimeSeconds;
+    // Whether the sensor was tracking when RenderIMUTimeSeconds was read; without
+    // a sensor, poses are timed with the requested time, not a sample's.
+    bool                RenderIMUTracked;
+    // The first sample read for each eye; each is only written by the thread
+    // rendering that eye, and EndFrame merges them into the two above.
+    double              EyeRenderIMUTimeSeconds[2];
+    bool                EyeRenderIMUTracked[2];
     double              TimewarpIMUTimeSeconds;
 };
 
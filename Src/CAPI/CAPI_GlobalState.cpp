@@ -25,6 +25,9 @@ limitations under the License.
 ************************************************************************************/
 
 #include "CAPI_GlobalState.h"
+#include "../OVR_PoseService.h"
+#include "../OVR_Profile.h"
+#include <stdlib.h>
 
 namespace OVR { namespace CAPI {
 
@@ -50,48 +53,156 @@ namespace OVR { namespace CAPI {
 GlobalState* GlobalState::pInstance = 0;
 
 
-GlobalState::GlobalState()
+GlobalState::GlobalState(const Thread::SchedulingParams* sensorThreadScheduling,
+                         PoseService* poseService, bool deferDetection)
+  : Detected(0), pPoseService(poseService),
+    FusionThreadEnabled(false), HasFusionThreadScheduling(false)
 {
-    pManager = *DeviceManager::Create();
+#ifdef OVR_ENABLE_THREADS
+    pThreadPool = 0;
+#endif
+    pDistortionMeshCache = 0;
+    HMDsVersion = 0;
+
+    UInt64 start = Timer::GetTicksNanos();
+    pManager = *DeviceManager::Create(sensorThreadScheduling);
     // Handle the DeviceManager's messages
     pManager->AddMessageHandler( this );
-    EnumerateDevices();
+    LogText("OVR::GlobalState - device manager started in %.1f ms.\n",
+            (Timer::GetTicksNanos() - start) * 1e-6);
+
+    if (!deferDetection)
+        EnumerateDevices();
 
     // PhoneSensors::Init();
 }
 
+void GlobalState::SetFusionThread(const Thread::SchedulingParams* scheduling)
+{
+    FusionThreadEnabled       = true;
+    HasFusionThreadScheduling = (scheduling != 0);
+    if (scheduling)
+        FusionThreadScheduling = *scheduling;
+}
+
 GlobalState::~GlobalState()
 {
     RemoveHandlerFromDevices();
     OVR_ASSERT(HMDs.IsEmpty());
+#ifdef OVR_ENABLE_THREADS
+    delete pThreadPool;
+#endif
+    delete pDistortionMeshCache;
+    // The HMDs that used it are gone.
+    delete pPoseService;
+}
+
+#ifdef OVR_ENABLE_THREADS
+ThreadPool* GlobalState::GetThreadPool()
+{
+    Lock::Locker lock(&ThreadPoolLock);
+    if (!pThreadPool)
+        pThreadPool = new ThreadPool();
+    return pThreadPool;
+}
+#endif
+
+Util::Render::DistortionMeshCache* GlobalState::GetDistortionMeshCache()
+{
+    Lock::Locker lock(&DistortionMeshCacheLock);
+    if (!pDistortionMeshCache)
+    {
+        pDistortionMeshCache = new Util::Render::DistortionMeshCache();
+        const char* path = getenv("OVR_DISTORTION_MESH_CACHE");
+        if (path && *path)
+            pDistortionMeshCache->SetFile(path);
+    }
+    return pDistortionMeshCache;
 }
 
 int GlobalState::EnumerateDevices()
 {
-    // Need to use separate lock for device enumeration, as pManager->GetHandlerLock()
-    // would produce deadlocks here.
-    Lock::Locker lock(&EnumerationLock);
-    
-    EnumeratedDevices.Clear();        
+    return (int)getHMDs()->Devices.GetSize();
+}
+
+Ptr<GlobalState::HMDSnapshot> GlobalState::getHMDs()
+{
+    if (!Detected.Load_Acquire())
+    {
+        // Need to use separate lock for device enumeration, as pManager->GetHandlerLock()
+        // would produce deadlocks here.
+        Lock::Locker lock(&EnumerationLock);
+        if (!Detected.Load_Acquire())
+            detect();
+    }
+    Lock::Locker lock(&HMDsLock);
+    return pHMDs;
+}
+
+void GlobalState::detect()
+{
+    UInt64 start = Timer::GetTicksNanos();
+
+#ifdef OVR_ENABLE_THREADS
+    // Reading the profile database doesn't depend on the devices, so it overlaps
+    // with HID enumeration; HMDState reads profiles as soon as it is created.
+    TaskGroup profileTask(GetThreadPool());
+    profileTask.Run(&GlobalState::loadProfiles, pManager.GetPtr());
+#endif
+
+    publishHMDs();
+
+#ifdef OVR_ENABLE_THREADS
+    profileTask.Wait();
+#else
+    loadProfiles(pManager.GetPtr());
+#endif
+    Detected.Store_Release(1);
+    LogText("OVR::GlobalState - detected %d HMDs and loaded profiles in %.1f ms.\n",
+            (int)getHMDs()->Devices.GetSize(), (Timer::GetTicksNanos() - start) * 1e-6);
+}
+
+void GlobalState::publishHMDs()
+{
+    // The version is taken before enumerating, so a snapshot with a higher one
+    // includes every change made before an older one was started.
+    Ptr<HMDSnapshot> snapshot = *new HMDSnapshot;
+    snapshot->Version         = ++HMDsVersion;
 
     DeviceEnumerator<HMDDevice> e = pManager->EnumerateDevices<HMDDevice>();
     while(e.IsAvailable())
     {
-        EnumeratedDevices.PushBack(DeviceHandle(e));       
+        snapshot->Devices.PushBack(DeviceHandle(e));       
         e.Next();
     }
 
-    return (int)EnumeratedDevices.GetSize();
+    // The replaced snapshot is released after unlocking, as freeing its device
+    // handles may take the manager's lock.
+    Ptr<HMDSnapshot> replaced;
+    Lock::Locker     lock(&HMDsLock);
+    if (!pHMDs || pHMDs->Version < snapshot->Version)
+    {
+        replaced = pHMDs;
+        pHMDs    = snapshot;
+    }
+}
+
+void GlobalState::loadProfiles(void* manager)
+{
+    ProfileManager* profiles = ((DeviceManager*)manager)->GetProfileManager();
+    if (profiles)
+        profiles->GetUserCount();
 }
 
 
 HMDDevice* GlobalState::CreateDevice(int index)
 {
-    Lock::Locker lock(&EnumerationLock);
+    // Detection deferred by ovr_InitializeWithOptions happens on first use.
+    Ptr<HMDSnapshot> hmds = getHMDs();
 
-    if (index >= (int)EnumeratedDevices.GetSize())
+    if (index >= (int)hmds->Devices.GetSize())
         return 0;
-    return EnumeratedDevices[index].CreateDeviceTyped<HMDDevice>();
+    return hmds->Devices[index].CreateDeviceTyped<HMDDevice>();
 }
 
 
@@ -113,6 +224,20 @@ void GlobalState::NotifyHMDs_AddDevice(DeviceType deviceType)
         hmd->NotifyAddDevice(deviceType);
 }
 
+void GlobalState::NotifyHMDs_RemoveDevice(DeviceType deviceType)
+{
+    Lock::Locker lock(pManager->GetHandlerLock());
+    for(HMDState* hmd = HMDs.GetFirst(); !HMDs.IsNull(hmd); hmd = hmd->pNext)        
+        hmd->NotifyRemoveDevice(deviceType);
+}
+
+void GlobalState::NotifyHMDs_ProfileChanged()
+{
+    Lock::Locker lock(pManager->GetHandlerLock());
+    for(HMDState* hmd = HMDs.GetFirst(); !HMDs.IsNull(hmd); hmd = hmd->pNext)        
+        hmd->NotifyProfileChange();
+}
+
 void GlobalState::OnMessage(const Message& msg)
 {
     if (msg.Type == Message_DeviceAdded || msg.Type == Message_DeviceRemoved)
@@ -122,20 +247,31 @@ void GlobalState::OnMessage(const Message& msg)
             const MessageDeviceStatus& statusMsg =
                 static_cast<const MessageDeviceStatus&>(msg);
 
+            // HMDs may come with a sensor as well as by themselves.
+            publishHMDs();
+
             if (msg.Type == Message_DeviceAdded)
             {
                 //LogText("OnMessage DeviceAdded.\n");
 
                 // We may have added a sensor/other device; notify any HMDs that might
-                // need it to check for it later.
+                // need it. Sensors are created right here, on the device manager thread.
                 NotifyHMDs_AddDevice(statusMsg.Handle.GetType());
             }
             else
             {
                 //LogText("OnMessage DeviceRemoved.\n");
+
+                // HMDs release their sensor here once it has been unplugged.
+                NotifyHMDs_RemoveDevice(statusMsg.Handle.GetType());
             }
         }
     }
+    else if (msg.Type == Message_ProfileChanged && msg.pDevice == pManager)
+    {
+        // HMDs read their profile again on the application thread.
+        NotifyHMDs_ProfileChanged();
+    }
 }
 
 
@@ -31,9 +31,13 @@ limitations under the License.
 #include "../OVR_Device.h"
 #include "../Kernel/OVR_Timer.h"
 #include "../Kernel/OVR_Math.h"
+#include "../Kernel/OVR_ThreadPool.h"
+#include "../Util/Util_Render_Stereo.h"
 
 #include "CAPI_HMDState.h"
 
+namespace OVR { class PoseService; }
+
 namespace OVR { namespace CAPI {
 
 //-------------------------------------------------------------------------------------
@@ -44,7 +48,12 @@ namespace OVR { namespace CAPI {
 class GlobalState  : public MessageHandler,  public NewOverrideBase
 {  
 public:
-    GlobalState();
+    // sensorThreadScheduling is passed to DeviceManager::Create; may be null.
+    // poseService, if any, is owned and deleted by the GlobalState.
+    // If deferDetection, devices are first enumerated and profiles first loaded by
+    // EnumerateDevices or CreateDevice rather than here.
+    GlobalState(const Thread::SchedulingParams* sensorThreadScheduling = 0,
+                PoseService* poseService = 0, bool deferDetection = false);
     ~GlobalState();
 
     static GlobalState *pInstance;
@@ -59,6 +68,8 @@ public:
     void        AddHMD(HMDState* hmd);
     void        RemoveHMD(HMDState* hmd);
     void        NotifyHMDs_AddDevice(DeviceType deviceType);
+    void        NotifyHMDs_RemoveDevice(DeviceType deviceType);
+    void        NotifyHMDs_ProfileChanged();
 
     const char* GetLastError()
     {
@@ -67,14 +78,76 @@ public:
 
     DeviceManager* GetManager() { return pManager; }
 
-protected:
+    // The pose service set up by ovr_InitializeWithOptions, or null.
+    PoseService*   GetPoseService() { return pPoseService; }
 
-    Ptr<DeviceManager>  pManager;
-    Lock                EnumerationLock;
-    Array<DeviceHandle> EnumeratedDevices;
+    // Has the HMDs run sensor fusion on a thread of its own, with scheduling if not
+    // null (see SensorFusion::StartFusionThread). Called before HMDs are created.
+    void           SetFusionThread(const Thread::SchedulingParams* scheduling);
+    bool           IsFusionThreadEnabled() const { return FusionThreadEnabled; }
+    const Thread::SchedulingParams* GetFusionThreadScheduling() const
+    { return HasFusionThreadScheduling ? &FusionThreadScheduling : 0; }
+
+#ifdef OVR_ENABLE_THREADS
+    // Pool for splitting up work such as distortion mesh generation; its
+    // workers are started on first use.
+    ThreadPool*    GetThreadPool();
+#endif
+
+    // Distortion meshes made by ovrHmd_CreateDistortionMesh, shared by all HMDs.
+    // Setting the OVR_DISTORTION_MESH_CACHE environment variable to a file path
+    // keeps them in that file between runs.
+    Util::Render::DistortionMeshCache* GetDistortionMeshCache();
+
+protected:
+    // The HMDs found by an enumeration. Published snapshots are never changed, so
+    // readers only hold HMDsLock long enough to take a reference; a replaced one is
+    // freed once its last reader releases it. One is only made when devices come
+    // or go.
+    struct HMDSnapshot : public RefCountBase<HMDSnapshot>
+    {
+        UInt32              Version;
+        Array<DeviceHandle> Devices;
+    };
+
+    // Returns the current snapshot, detecting devices first if that was deferred.
+    Ptr<HMDSnapshot>    getHMDs();
+    // Called with EnumerationLock held, the first time devices are needed; profiles
+    // are loaded on the thread pool while devices are enumerated.
+    void                detect();
+    static void         loadProfiles(void* manager);
+    // Enumerates the HMDs into a new snapshot and publishes it, unless a newer one
+    // was published meanwhile. Called on application threads and on the device
+    // manager thread, which may hold the manager's lock, so it takes no lock while
+    // enumerating.
+    void                publishHMDs();
+
+    Ptr<DeviceManager>      pManager;
+    // Only serializes the first detection.
+    Lock                    EnumerationLock;
+    // Set with release semantics once the first snapshot is published.
+    AtomicInt<UInt32>       Detected;
+    // Only guards pHMDs itself, and is held for no other work.
+    Lock                    HMDsLock;
+    Ptr<HMDSnapshot>        pHMDs;
+    AtomicInt<UInt32>       HMDsVersion;
     
     // Currently created hmds; protected by Manager lock.
     List<HMDState>      HMDs;
+
+#ifdef OVR_ENABLE_THREADS
+    Lock                ThreadPoolLock;
+    ThreadPool*         pThreadPool;
+#endif
+
+    Lock                                DistortionMeshCacheLock;
+    Util::Render::DistortionMeshCache*  pDistortionMeshCache;
+
+    PoseService*        pPoseService;
+
+    bool                        FusionThreadEnabled;
+    bool                        HasFusionThreadScheduling;
+    Thread::SchedulingParams    FusionThreadScheduling;
 };
 
 }} // namespace OVR::CAPI
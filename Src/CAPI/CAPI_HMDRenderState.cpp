@@ -25,6 +25,7 @@ limitations under the License.
 ************************************************************************************/
 
 #include "CAPI_HMDRenderState.h"
+#include "CAPI_GlobalState.h"
 
 namespace OVR { namespace CAPI {
 
@@ -36,20 +37,30 @@ namespace OVR { namespace CAPI {
 HMDRenderState::HMDRenderState(ovrHmd hmd, Profile* userProfile, const OVR::HMDInfo& hmdInfo)
     : HMD(hmd), HMDInfo(hmdInfo)
 {
-	RenderInfo = GenerateHmdRenderInfoFromHmdInfo( HMDInfo, userProfile );
-
-    Distortion[0] = CalculateDistortionRenderDesc(StereoEye_Left,  RenderInfo, 0);
-    Distortion[1] = CalculateDistortionRenderDesc(StereoEye_Right, RenderInfo, 0);
+    SetProfile(userProfile);
 
     ClearColor[0] = ClearColor[1] = ClearColor[2] = ClearColor[3] =0.0f;
 
     EnabledHmdCaps = 0;
+    DistortionCaps = 0;
+    DistortionMeshGridSizeLog2 = Util::Render::DistortionMeshGridSizeLog2_Default;
+
+    EyeSubmissions[0].State.Store_Release(EyeSubmission::State_Idle);
+    EyeSubmissions[1].State.Store_Release(EyeSubmission::State_Idle);
 }
 
 HMDRenderState::~HMDRenderState()
 {
 }
 
+void HMDRenderState::SetProfile(Profile* userProfile)
+{
+	RenderInfo = GenerateHmdRenderInfoFromHmdInfo( HMDInfo, userProfile );
+
+    Distortion[0] = CalculateDistortionRenderDesc(StereoEye_Left,  RenderInfo, 0);
+    Distortion[1] = CalculateDistortionRenderDesc(StereoEye_Right, RenderInfo, 0);
+}
+
 ovrHmdDesc HMDRenderState::GetDesc()
 {
     ovrHmdDesc d;
@@ -139,5 +150,87 @@ void HMDRenderState::setupRenderDesc( ovrEyeRenderDesc eyeRenderDescOut[2],
 }
 
 
+unsigned HMDRenderState::GetDistortionMeshFlags(unsigned distortionCaps)
+{
+    // Only the mesh options are used now, but Chromatic flag or others could possibly be
+    // checked for in the future.
+    unsigned meshFlags = 0;
+    if (distortionCaps & ovrDistortionCap_AdaptiveMesh)
+        meshFlags |= DistortionMesh_Adaptive;
+    if (distortionCaps & ovrDistortionCap_TriangleStrip)
+        meshFlags |= DistortionMesh_TriangleStrip;
+    return meshFlags;
+}
+
+// The mesh rows are split across the global thread pool, and meshes made before
+// with the same lens, FOV and options are reused.
+static ThreadPool* distortionMeshPool()
+{
+    ThreadPool* pool = 0;
+#ifdef OVR_ENABLE_THREADS
+    if (GlobalState::pInstance)
+        pool = GlobalState::pInstance->GetThreadPool();
+#endif
+    return pool;
+}
+
+void HMDRenderState::CreateDistortionMesh(DistortionMeshVertexData** ppVertices, UInt16** ppIndices,
+                                          int* pNumVertices, int* pNumTriangles,
+                                          ovrEyeType eyeType, const ovrFovPort& fov, unsigned distortionCaps) const
+{
+    // Note that mesh distortion generation is invariant of RenderTarget UVs, allowing
+    // render target size and location to be changed after the fact dynamically. 
+    bool                        rightEye       = (eyeType == ovrEye_Right);
+    const DistortionRenderDesc& distortion     = Distortion[eyeType];
+    // Find the mapping from TanAngle space to target NDC space.
+    ScaleAndOffset2D            eyeToSourceNDC = CreateNDCScaleAndOffsetFromFov(fov);
+    unsigned                    meshFlags      = GetDistortionMeshFlags(distortionCaps);
+
+    if (GlobalState::pInstance)
+    {
+        GlobalState::pInstance->GetDistortionMeshCache()->Create(
+                              ppVertices, ppIndices, pNumVertices, pNumTriangles, rightEye,
+                              RenderInfo, distortion, eyeToSourceNDC,
+                              DistortionMeshGridSizeLog2, meshFlags, distortionMeshPool());
+    }
+    else
+    {
+        DistortionMeshCreate(ppVertices, ppIndices, pNumVertices, pNumTriangles, rightEye,
+                             RenderInfo, distortion, eyeToSourceNDC,
+                             DistortionMeshGridSizeLog2, meshFlags, distortionMeshPool());
+    }
+}
+
+void HMDRenderState::GetDistortionMeshSize(int* pNumVertices, int* pNumIndices, unsigned distortionCaps) const
+{
+    DistortionMeshGetSize(pNumVertices, pNumIndices,
+                          DistortionMeshGridSizeLog2, GetDistortionMeshFlags(distortionCaps));
+}
+
+void HMDRenderState::WriteDistortionMesh(void* pVertices, const DistortionMeshVertexLayout& layout,
+                                         UInt16* pIndices, UInt16 indexBase, DistortionMeshWriteInfo* pInfo,
+                                         ovrEyeType eyeType, const ovrFovPort& fov, unsigned distortionCaps) const
+{
+    bool                        rightEye       = (eyeType == ovrEye_Right);
+    const DistortionRenderDesc& distortion     = Distortion[eyeType];
+    ScaleAndOffset2D            eyeToSourceNDC = CreateNDCScaleAndOffsetFromFov(fov);
+    unsigned                    meshFlags      = GetDistortionMeshFlags(distortionCaps);
+
+    if (GlobalState::pInstance)
+    {
+        GlobalState::pInstance->GetDistortionMeshCache()->Write(
+                              pVertices, layout, pIndices, indexBase, pInfo, rightEye,
+                              RenderInfo, distortion, eyeToSourceNDC,
+                              DistortionMeshGridSizeLog2, meshFlags, distortionMeshPool());
+    }
+    else
+    {
+        DistortionMeshWrite(pVertices, layout, pIndices, indexBase, pInfo, rightEye,
+                            RenderInfo, distortion, eyeToSourceNDC,
+                            DistortionMeshGridSizeLog2, meshFlags, distortionMeshPool());
+    }
+}
+
+
 }} // namespace OVR::CAPI
 
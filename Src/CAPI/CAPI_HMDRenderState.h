@@ -29,6 +29,7 @@ limitations under the License.
 
 #include "../OVR_CAPI.h"
 #include "../Kernel/OVR_Math.h"
+#include "../Kernel/OVR_Atomic.h"
 #include "../Util/Util_Render_Stereo.h"
 
 
@@ -50,6 +51,9 @@ public:
     HMDRenderState(ovrHmd hmd, Profile* userProfile, const OVR::HMDInfo& hmdInfo);
     virtual ~HMDRenderState();
 
+    // Recomputes RenderInfo and Distortion for another user profile, which may be null.
+    void       SetProfile(Profile* userProfile);
+
 
     // *** Rendering Setup
 
@@ -61,6 +65,23 @@ public:
 
     void       setupRenderDesc(ovrEyeRenderDesc eyeRenderDescOut[2],
                                const ovrFovPort eyeFovIn[2]);
+
+
+    // *** Distortion Mesh
+
+    // Mesh options for distortionCaps, as DistortionMeshCreate's meshFlags.
+    static unsigned GetDistortionMeshFlags(unsigned distortionCaps);
+
+    // Makes the distortion mesh of an eye for ovrHmd_CreateDistortionMesh, from the
+    // global mesh cache and on the global thread pool when there are ones.
+    void       CreateDistortionMesh(DistortionMeshVertexData** ppVertices, UInt16** ppIndices,
+                                    int* pNumVertices, int* pNumTriangles,
+                                    ovrEyeType eyeType, const ovrFovPort& fov, unsigned distortionCaps) const;
+    // The same mesh, written into buffers of the caller instead; see DistortionMeshWrite.
+    void       GetDistortionMeshSize(int* pNumVertices, int* pNumIndices, unsigned distortionCaps) const;
+    void       WriteDistortionMesh(void* pVertices, const DistortionMeshVertexLayout& layout,
+                                   UInt16* pIndices, UInt16 indexBase, DistortionMeshWriteInfo* pInfo,
+                                   ovrEyeType eyeType, const ovrFovPort& fov, unsigned distortionCaps) const;
 public:
     
     // HMDInfo shouldn't change, as its string pointers are passed out.    
@@ -79,9 +100,35 @@ public:
     // Pose at which last time the eye was rendered, as submitted by EndEyeRender.
     ovrPosef                 EyeRenderPoses[2];
 
+    // What ovrHmd_EndEyeRender submitted for each eye in the current frame, handed
+    // to the distortion renderer by ovrHmd_EndFrame. A slot is only written by the
+    // thread rendering its eye, so that the eyes can be rendered on threads of their
+    // own; State publishes the slot to EndFrame.
+    struct EyeSubmission
+    {
+        enum
+        {
+            State_Idle,         // Not begun since the last EndFrame.
+            State_Rendering,    // Between BeginEyeRender and EndEyeRender.
+            State_Submitted     // Ended; the fields below are set.
+        };
+
+        AtomicInt<int>       State;
+        ovrPosef             RenderPose;
+        ovrTexture           Texture;
+        bool                 HasTexture;
+        ovrTexture           DepthTexture;
+        ovrMatrix4f          DepthProjection;
+        bool                 HasDepth;
+    };
+    EyeSubmission            EyeSubmissions[2];
+
     // Capabilities passed to Configure.
     unsigned                 EnabledHmdCaps;
     unsigned                 DistortionCaps;
+
+    // Distortion mesh grid size, as DistortionMeshCreate's gridSizeLog2.
+    int                      DistortionMeshGridSizeLog2;
 };
 
 
@@ -27,6 +27,10 @@ limitations under the License.
 #include "CAPI_HMDState.h"
 #include "CAPI_GlobalState.h"
 #include "../OVR_Profile.h"
+#include "../OVR_PoseService.h"
+#include "../Kernel/OVR_PerfCounters.h"
+#include "../Kernel/OVR_Trace.h"
+#include <stdlib.h>
 
 namespace OVR { namespace CAPI {
 
@@ -37,22 +41,23 @@ namespace OVR { namespace CAPI {
 HMDState::HMDState(HMDDevice* device)
     : pHMD(device), HMDInfoW(device), HMDInfo(HMDInfoW.h),    
       EnabledHmdCaps(0), HmdCapsAppliedToSensor(0),
-      SensorStarted(0), SensorCreated(0), SensorCaps(0),
-      AddSensorCount(0), AddLatencyTestCount(0), AddLatencyTestDisplayCount(0),
-      RenderState(getThis(), pHMD->GetProfile(), HMDInfoW.h),
-      LastFrameTimeSeconds(0.0f), LastGetFrameTimeSeconds(0.0),
-      LatencyTestActive(false),
-      LatencyTest2Active(false)
-{
-    pLastError = 0;
+      DevicesLockDepth(0), AddSensorCount(0), RemoveSensorCount(0), ProfileChangeCount(0),
+      ProfileLoaded(false), ProfileReload(false),
+      ProfileLoadDeferred(false), ProfileChangePending(false),
+      SensorStarted(0), SensorCreated(0), SensorShared(0), SensorPublished(false), SensorCaps(0),
+      AddLatencyTestCount(0), LatencyTestActive(false),
+      AddLatencyTestDisplayCount(0), LatencyTest2Active(false),
+      RenderState(getThis(), 0, HMDInfoW.h), // Defaults until the profile is read.
+      LastFrameTimeSeconds(0.0f), LastGetFrameTimeSeconds(0.0)
+{
+    pLastError   = 0;
+    pPoseStream  = 0;
+    pLatencyUtil = 0;
     GlobalState::pInstance->AddHMD(this);
     
     // Should be in renderer?
     TimeManager.Init(RenderState.RenderInfo);
 
-    EyeRenderActive[0] = false;
-    EyeRenderActive[1] = false;
-
     LatencyTestDrawColor[0] = 0;
     LatencyTestDrawColor[1] = 0;
     LatencyTestDrawColor[2] = 0;
@@ -63,46 +68,72 @@ HMDState::HMDState(HMDDevice* device)
     BeginFrameCalled    = false;
     BeginFrameThreadId  = 0;
     BeginFrameTimingCalled = false;
+
+#ifdef OVR_ENABLE_THREADS
+    // Tasks on a pool without workers only run when waited for, so without
+    // workers the profile is read by the first call that uses it instead.
+    ThreadPool* pool = GlobalState::pInstance->GetThreadPool();
+    pProfileTasks = pool->GetWorkerCount() ? new TaskGroup(pool) : 0;
+#endif
+    requestProfile(false);
+
+    float footprint[MemoryFootprintCount];
+    getMemoryFootprint(footprint);
+    LogText("OVR::HMDState - %u bytes, sensor fusion %u, frame timing %u, render state %u.\n",
+            (unsigned)footprint[0], (unsigned)footprint[1], (unsigned)footprint[7],
+            (unsigned)footprint[8]);
 }
 
 HMDState::HMDState(ovrHmdType hmdType)
   : pHMD(0), HMDInfoW(hmdType), HMDInfo(HMDInfoW.h),
     EnabledHmdCaps(0),
-    SensorStarted(0), SensorCreated(0), SensorCaps(0),
-    AddSensorCount(0), AddLatencyTestCount(0), AddLatencyTestDisplayCount(0),
+    DevicesLockDepth(0), AddSensorCount(0), RemoveSensorCount(0), ProfileChangeCount(0),
+    ProfileLoaded(false), ProfileReload(false),
+    ProfileLoadDeferred(false), ProfileChangePending(false),
+    SensorStarted(0), SensorCreated(0), SensorShared(0), SensorPublished(false), SensorCaps(0),
+    AddLatencyTestCount(0), AddLatencyTestDisplayCount(0),
     RenderState(getThis(), 0, HMDInfoW.h), // No profile. 
     LastFrameTimeSeconds(0.0), LastGetFrameTimeSeconds(0.0)
 {
     // TBD: We should probably be looking up the default profile for the given
     // device type + user.
 
-    pLastError = 0;
+    pLastError   = 0;
+    pPoseStream  = 0;
+    pLatencyUtil = 0;
     GlobalState::pInstance->AddHMD(this);
 
     // Should be in renderer?
     TimeManager.Init(RenderState.RenderInfo);
 
-    EyeRenderActive[0] = false;
-    EyeRenderActive[1] = false;
-
     OVR_CAPI_VISION_CODE( pPoseTracker = 0; )
 
     RenderingConfigured = false;
     BeginFrameCalled   = false;
     BeginFrameThreadId = 0;
     BeginFrameTimingCalled = false;
+
+#ifdef OVR_ENABLE_THREADS
+    pProfileTasks = 0;
+#endif
 }
 
 
 HMDState::~HMDState()
 {
     OVR_ASSERT(GlobalState::pInstance);
+
+#ifdef OVR_ENABLE_THREADS
+    // Waits for a profile read still in flight.
+    delete pProfileTasks;
+#endif
    
     StopSensor();
     ConfigureRendering(0,0,0,0);
 
     OVR_CAPI_VISION_CODE( OVR_ASSERT(pPoseTracker == 0); )
 
+    delete pLatencyUtil;
     GlobalState::pInstance->RemoveHMD(this);
 }
 
@@ -113,8 +144,12 @@ HMDState::~HMDState()
 
 bool HMDState::StartSensor(unsigned supportedCaps, unsigned requiredCaps)
 {
-    Lock::Locker lockScope(&DevicesLock);
+    DevicesLocker lockScope(this);
+    return startSensor_NeedsLock(supportedCaps, requiredCaps);
+}
 
+bool HMDState::startSensor_NeedsLock(unsigned supportedCaps, unsigned requiredCaps)
+{
     bool crystalCoveOrBetter = (HMDInfo.HmdType == HmdType_CrystalCoveProto) ||
                                (HMDInfo.HmdType == HmdType_DK2);
     bool sensorCreatedJustNow = false;
@@ -134,6 +169,22 @@ bool HMDState::StartSensor(unsigned supportedCaps, unsigned requiredCaps)
 
     supportedCaps |= requiredCaps;
 
+    // A subscriber leaves the sensor to the publishing process, and can't check
+    // which caps it was started with.
+    PoseService* poseService = GlobalState::pInstance->GetPoseService();
+    if (pHMD && poseService && poseService->GetMode() == PoseService::Mode_Subscribe)
+    {
+        if (!SensorShared)
+        {
+            SFusion.SetSharedState(poseService->GetFusionState(), false);
+            SensorShared = true;
+            LogText("Sensor shared from the pose service.\n");
+        }
+        SensorCaps    = supportedCaps;
+        SensorStarted = true;
+        return true;
+    }
+
     if (pHMD && !pSensor)
     {
         // Zero AddSensorCount before creation, in case it fails (or succeeds but then
@@ -145,8 +196,16 @@ bool HMDState::StartSensor(unsigned supportedCaps, unsigned requiredCaps)
         if (pSensor)
         {
             pSensor->SetReportRate(500);
+            // The fusion thread is started once, before the first sensor is attached,
+            // and kept as sensors come and go.
+            GlobalState* global = GlobalState::pInstance;
+            if (global->IsFusionThreadEnabled() && !SFusion.IsFusionThreadRunning() &&
+                !SFusion.StartFusionThread(global->GetFusionThreadScheduling()))
+                LogError("HMDState - failed to start the sensor fusion thread.\n");
             SFusion.AttachToSensor(pSensor);
             applyProfileToSensorFusion();
+            startSensorTrace();
+            startPoseStream();
         }
         else
         {
@@ -164,6 +223,8 @@ bool HMDState::StartSensor(unsigned supportedCaps, unsigned requiredCaps)
         pLastError = "ovrHmdCap_YawCorrection not available.";
         if (sensorCreatedJustNow)
         {
+            SensorTrace.Stop();
+            stopPoseStream();
             SFusion.AttachToSensor(0);
             SFusion.Reset();
             pSensor.Clear();
@@ -209,6 +270,14 @@ bool HMDState::StartSensor(unsigned supportedCaps, unsigned requiredCaps)
 
 #endif // OVR_CAPI_VISIONSUPPORT
 
+    // The first HMD started in the service process is the one published.
+    if (pHMD && poseService && !SensorPublished && poseService->ClaimFusionState(this))
+    {
+        SFusion.SetSharedState(poseService->GetFusionState(), true);
+        SensorPublished = true;
+        LogText("Sensor published to the pose service.\n");
+    }
+
     SensorCaps    = supportedCaps;
     SensorStarted = true;
 
@@ -219,7 +288,7 @@ bool HMDState::StartSensor(unsigned supportedCaps, unsigned requiredCaps)
 // Stops sensor sampling, shutting down internal resources.
 void HMDState::StopSensor()
 {
-    Lock::Locker lockScope(&DevicesLock);
+    DevicesLocker lockScope(this);
 
     if (SensorStarted)
     {
@@ -233,9 +302,19 @@ void HMDState::StopSensor()
         }        
 #endif // OVR_CAPI_VISION_CODE
 
+        SensorTrace.Stop();
+        stopPoseStream();
         SFusion.AttachToSensor(0);
         SFusion.Reset();
         pSensor.Clear();
+        if (SensorShared || SensorPublished)
+        {
+            SFusion.SetSharedState(0, false);
+            if (SensorPublished)
+                GlobalState::pInstance->GetPoseService()->ReleaseFusionState(this);
+            SensorShared    = false;
+            SensorPublished = false;
+        }
         HmdCapsAppliedToSensor = 0;
         AddSensorCount = 0;
         SensorCaps     = 0;
@@ -256,35 +335,28 @@ void HMDState::ResetSensor()
 // Returns prediction for time.
 ovrSensorState HMDState::PredictedSensorState(double absTime)
 {    
-    SensorState ss;
+    return PredictedSensorStateBatch(&absTime, 0, 1);
+}
 
-    // We are trying to keep this path lockless unless we are notified of new device
-    // creation while not having a sensor yet. It's ok to check SensorCreated volatile
-    // flag here, since GetSensorStateAtTime() is internally lockless and safe.
+// Returns predictions for a set of times, all based on the same sensor snapshot.
+ovrSensorState HMDState::PredictedSensorStateBatch(const double* absTimes,
+                                                   ovrPoseStatef* predictedStates, unsigned count)
+{
+    OVR_COMPILER_ASSERT(sizeof(PoseStatef) == sizeof(ovrPoseStatef));
 
-    if (SensorCreated || checkCreateSensor())
-    {   
-        ss = SFusion.GetSensorStateAtTime(absTime);
+    SensorState ss;
+    PoseStatef* states  = reinterpret_cast<PoseStatef*>(predictedStates);
+    double      absTime = count ? absTimes[0] : 0.0;
 
-        if (!(ss.StatusFlags & ovrStatus_OrientationTracked))
-        {
-            Lock::Locker lockScope(&DevicesLock);
+    // This path is lockless, so that any number of threads can query the sensor.
+    // The sensor is created and released on the device manager thread; it's ok to
+    // check SensorCreated volatile flag here, since GetSensorStateBatch() is
+    // internally lockless and safe.
 
-#ifdef OVR_CAPI_VISIONSUPPORT
-            if (pPoseTracker)
-            {
-                // TBD: Internals not thread safe - must fix!!
-                delete pPoseTracker;
-                pPoseTracker = 0;
-                LogText("Sensor Pose tracker destroyed.\n");
-            }        
-#endif // OVR_CAPI_VISION_CODE
-            // Not needed yet; SFusion.AttachToSensor(0);
-            // This seems to reset orientation anyway...
-            pSensor.Clear();
-            SensorCreated = false;         
-            HmdCapsAppliedToSensor = 0;
-        }
+    if (SensorCreated || SensorShared)
+    {   
+        SFusion.NotifyPoseRead();
+        ss = SFusion.GetSensorStateBatch(absTimes, states, count);
     }
     else
     {
@@ -298,6 +370,15 @@ ovrSensorState HMDState::PredictedSensorState(double absTime)
         // connected.
         ss.Recorded.TimeInSeconds  = absTime;
         ss.Predicted.TimeInSeconds = absTime;
+
+        if (states)
+        {
+            for (unsigned i = 0; i < count; i++)
+            {
+                states[i] = ss.Predicted;
+                states[i].TimeInSeconds = absTimes[i];
+            }
+        }
     }
 
     ss.StatusFlags |= ovrStatus_HmdConnected;
@@ -305,21 +386,53 @@ ovrSensorState HMDState::PredictedSensorState(double absTime)
 }
 
 
-bool  HMDState::checkCreateSensor()
+void HMDState::updateSensorDevice()
 {
-    if (!(SensorStarted && !SensorCreated && AddSensorCount))
-        return false;
+    // The counts are raised before the lock is tried, and read here with a full
+    // barrier after it is released, so either the device manager thread gets the
+    // lock or the thread that held it sees the counts.
+    while ((AddSensorCount.ExchangeAdd_Sync(0) || RemoveSensorCount.ExchangeAdd_Sync(0)) &&
+           DevicesLock.TryLock())
+    {
+        // If this thread held the lock already, it is in a DevicesLocker scope,
+        // which calls us again when it ends.
+        bool nested = (DevicesLockDepth != 0);
+        if (!nested)
+            updateSensor_NeedsLock();
+        DevicesLock.Unlock();
+        if (nested)
+            break;
+    }
+}
+
+void HMDState::updateSensor_NeedsLock()
+{
+    bool added   = AddSensorCount.Exchange_Sync(0) != 0;
+    bool removed = RemoveSensorCount.Exchange_Sync(0) != 0;
 
-    Lock::Locker lockScope(&DevicesLock);
+    if (removed && SensorCreated && !pSensor->IsConnected())
+    {
+#ifdef OVR_CAPI_VISIONSUPPORT
+        if (pPoseTracker)
+        {
+            // TBD: Internals not thread safe - must fix!!
+            delete pPoseTracker;
+            pPoseTracker = 0;
+            LogText("Sensor Pose tracker destroyed.\n");
+        }        
+#endif // OVR_CAPI_VISION_CODE
+        // Not needed yet; SFusion.AttachToSensor(0);
+        // This seems to reset orientation anyway...
+        SensorCreated = false;         
+        pSensor.Clear();
+        HmdCapsAppliedToSensor = 0;
+        LogText("Sensor released.\n");
+    }
 
-    // Re-check condition once in the lock, in case the state changed.
-    if (SensorStarted && !SensorCreated && AddSensorCount)
+    if (added && SensorStarted && !SensorCreated && !SensorShared)
     {        
         if (pHMD)
-        {
-            AddSensorCount = 0;
-            pSensor        = *pHMD->GetSensor();
-        }
+            pSensor = *pHMD->GetSensor();
 
         if (pSensor)
         {
@@ -327,6 +440,8 @@ bool  HMDState::checkCreateSensor()
             SFusion.AttachToSensor(pSensor);
             SFusion.SetYawCorrectionEnabled((SensorCaps & ovrSensorCap_YawCorrection) != 0);
             applyProfileToSensorFusion();
+            startSensorTrace();
+            startPoseStream();
 
 #ifdef OVR_CAPI_VISIONSUPPORT
             if (SensorCaps & ovrSensorCap_Position)
@@ -343,16 +458,13 @@ bool  HMDState::checkCreateSensor()
             LogText("Sensor created.\n");
 
             SensorCreated = true;
-            return true;
         }
     }
-
-    return SensorCreated;
 }
 
 bool HMDState::GetSensorDesc(ovrSensorDesc* descOut)
 {
-    Lock::Locker lockScope(&DevicesLock);
+    DevicesLocker lockScope(this);
 
     if (SensorCreated)
     {
@@ -369,17 +481,162 @@ bool HMDState::GetSensorDesc(ovrSensorDesc* descOut)
 }
 
 
-void HMDState::applyProfileToSensorFusion()
+void HMDState::startSensorTrace()
+{
+    const char* path = getenv("OVR_SENSOR_TRACE");
+    if (path && *path && pSensor)
+    {
+        if (SensorTrace.Start(pSensor, path))
+            LogText("OVR::HMDState - recording sensor trace to '%s'\n", path);
+    }
+}
+
+void HMDState::startPoseStream()
+{
+    const char* address = getenv("OVR_POSE_STREAM");
+    if (!address || !*address || pPoseStream)
+        return;
+
+    pPoseStream = new PoseStreamer;
+    if (pPoseStream->Open(address))
+    {
+        SFusion.SetPoseStreamer(pPoseStream);
+        LogText("OVR::HMDState - streaming poses to '%s'\n", address);
+    }
+    else
+    {
+        delete pPoseStream;
+        pPoseStream = 0;
+    }
+}
+
+void HMDState::stopPoseStream()
+{
+    SFusion.SetPoseStreamer(0);
+    delete pPoseStream;
+    pPoseStream = 0;
+}
+
+Util::LatencyTest* HMDState::getLatencyUtil()
+{
+    if (!pLatencyUtil)
+        pLatencyUtil = new Util::LatencyTest;
+    return pLatencyUtil;
+}
+
+void HMDState::getMemoryFootprint(float data[MemoryFootprintCount]) const
+{
+    SensorFusion::MemoryFootprint fusion;
+    SFusion.GetMemoryFootprint(&fusion);
+
+    UPInt latency    = pLatencyUtil ? sizeof(Util::LatencyTest) : 0;
+    UPInt poseStream = pPoseStream ? sizeof(PoseStreamer) : 0;
+    UPInt properties;
+    {
+        Lock::Locker lockScope(&PropertiesLock);
+        properties = Properties.GetCapacity() * sizeof(PropertyEntry) +
+                     PropertyIds.GetSize() * (sizeof(String) + sizeof(int));
+    }
+
+    data[0]  = (float)(sizeof(HMDState) + (fusion.Total - sizeof(SensorFusion)) +
+                       latency + poseStream + properties);
+    data[1]  = (float)fusion.Total;
+    data[2]  = (float)fusion.SharedState;
+    data[3]  = (float)fusion.Filters;
+    data[4]  = (float)fusion.ExposureHistory;
+    data[5]  = (float)fusion.FusionQueue;
+    data[6]  = (float)fusion.MagReferences;
+    data[7]  = (float)sizeof(FrameTimeManager);
+    data[8]  = (float)sizeof(HMDRenderState);
+    data[9]  = (float)latency;
+    data[10] = (float)poseStream;
+    data[11] = (float)properties;
+}
+
+void HMDState::updateProfile()
 {
     if (!pHMD)
         return;
-    Profile* profile = pHMD->GetProfile();
-    if (!profile)
+
+    // Any thread may get here, so the profile state is handled under DevicesLock,
+    // as the profile is read; replaced profiles are released after it.
+    Ptr<Profile>  oldProfile;
+    DevicesLocker lockScope(this);
+
+    if (ProfileChangeCount && ProfileChangeCount.Exchange_Sync(0) != 0)
+        ProfileChangePending = true;
+
+#ifdef OVR_ENABLE_THREADS
+    if (pProfileTasks && !pProfileTasks->IsDone())
+        return;
+#endif
+
+    if (ProfileLoaded)
+        applyLoadedProfile(&oldProfile);
+    if (ProfileChangePending)
+    {
+        ProfileChangePending = false;
+        requestProfile(true);
+    }
+    if (ProfileLoadDeferred)
+    {
+        ProfileLoadDeferred = false;
+        loadProfile();
+        applyLoadedProfile(&oldProfile);
+    }
+}
+
+void HMDState::requestProfile(bool reload)
+{
+    ProfileReload = reload;
+#ifdef OVR_ENABLE_THREADS
+    if (pProfileTasks)
     {
-        OVR_ASSERT(false);
+        pProfileTasks->Run(loadProfileTask, this);
         return;
     }
-    SFusion.SetUserHeadDimensions ( *profile, RenderState.RenderInfo );
+#endif
+    ProfileLoadDeferred = true;
+}
+
+void HMDState::loadProfile()
+{
+    // The profile name is kept when reloading; only its values are read again.
+    if (ProfileReload)
+        pHMD->ReloadProfile();
+    pLoadedProfile = pHMD->GetProfile();
+    ProfileLoaded  = true;
+}
+
+void HMDState::loadProfileTask(void* hmdState)
+{
+    ((HMDState*)hmdState)->loadProfile();
+}
+
+void HMDState::applyLoadedProfile(Ptr<Profile>* oldProfile)
+{
+    // Property entries see the new profile and drop their cached values.
+    *oldProfile = pProfile;
+    pProfile    = pLoadedProfile;
+    pLoadedProfile.Clear();
+    ProfileLoaded = false;
+    if (ProfileReload)
+        LogText("OVR::HMDState - profile reloaded.\n");
+
+    // Distortion set up by ConfigureRendering is left as it was.
+    if (!RenderingConfigured)
+        RenderState.SetProfile(pProfile);
+
+    if (SensorCreated)
+        applyProfileToSensorFusion();
+}
+
+void HMDState::applyProfileToSensorFusion()
+{
+    // Sensor fusion keeps its default head model until the profile is read.
+    if (!pProfile)
+        return;
+    SFusion.SetUserHeadDimensions ( *pProfile, RenderState.RenderInfo );
 }
 
 void HMDState::updateLowPersistenceMode(bool lowPersistence) const
@@ -423,7 +680,7 @@ void HMDState::updateLatencyTestForHmd(bool latencyTesting)
 
 void HMDState::updateDK2FeaturesTiedToSensor(bool sensorCreatedJustNow)
 {
-    Lock::Locker lockScope(&DevicesLock);
+    DevicesLocker lockScope(this);
 
     if (!SensorCreated || (HMDInfo.HmdType != HmdType_DK2))
         return;
@@ -482,40 +739,216 @@ void HMDState::SetEnabledHmdCaps(unsigned hmdCaps)
 
 // TBD: This all needs to be cleaned up and organized into namespaces.
 
+static const struct
+{
+    const char*             Name;
+    HMDState::PropertyKind  Kind;
+} BuiltInProperties[] =
+{
+    { "LensSeparation",             HMDState::Property_LensSeparation },
+    { "CenterPupilDepth",           HMDState::Property_CenterPupilDepth },
+    { "DistortionMeshGridSizeLog2", HMDState::Property_DistortionMeshGridSizeLog2 },
+    { "LatencyTestContinuous",      HMDState::Property_LatencyTestContinuous },
+    { "TraceWrite",                 HMDState::Property_TraceWrite },
+    { "ScreenSize",                 HMDState::Property_ScreenSize },
+    { "DistortionClearColor",       HMDState::Property_DistortionClearColor },
+    { "DK2Latency",                 HMDState::Property_DK2Latency },
+    { "LatencyTestStats",           HMDState::Property_LatencyTestStats },
+    { "LatencyTestHistogram",       HMDState::Property_LatencyTestHistogram },
+    { "TimeSyncStats",              HMDState::Property_TimeSyncStats },
+    { "IdleReadTimeout",            HMDState::Property_IdleReadTimeout },
+    { "IdleMotionTimeout",          HMDState::Property_IdleMotionTimeout },
+    { "PredictionModel",            HMDState::Property_PredictionModel },
+    { "PredictionFilterTime",       HMDState::Property_PredictionFilterTime },
+    { "MemoryFootprint",            HMDState::Property_MemoryFootprint }
+};
+
+Ptr<Profile> HMDState::getProfile()
+{
+    DevicesLocker lockScope(this);
+    return pProfile;
+}
+
+int HMDState::getPropertyId(const char* propertyName)
+{
+    if (!propertyName)
+        return -1;
+
+    updateProfile();
+    Lock::Locker lockScope(&PropertiesLock);
+    return getPropertyId_NeedsLock(propertyName);
+}
+
+int HMDState::getPropertyId_NeedsLock(const char* propertyName)
+{
+    if (!propertyName)
+        return -1;
+
+    int id;
+    if (PropertyIds.GetAlt(propertyName, &id))
+        return id;
+
+    PropertyEntry entry;
+    entry.Name              = propertyName;
+    entry.Kind              = Property_Profile;
+    entry.pCounter          = 0;
+    entry.CachedChangeCount = 0;
+    entry.FloatCached       = false;
+    entry.FloatDefault      = 0.0f;
+    entry.FloatValue        = 0.0f;
+    entry.ArrayCached       = false;
+
+    for (unsigned i = 0; i < sizeof(BuiltInProperties) / sizeof(BuiltInProperties[0]); i++)
+    {
+        if (OVR_strcmp(propertyName, BuiltInProperties[i].Name) == 0)
+        {
+            entry.Kind = BuiltInProperties[i].Kind;
+            break;
+        }
+    }
+
+    // Names that don't exist fail without being interned, so that probing names
+    // doesn't grow the table.
+    if (entry.Kind == Property_Profile && OVR_strncmp(propertyName, "perf.", 5) == 0)
+    {
+        entry.pCounter = PerfCounter::Find(propertyName);
+        if (!entry.pCounter)
+            return -1;
+        entry.Kind = Property_PerfCounter;
+    }
+    else if (entry.Kind == Property_Profile)
+    {
+        Ptr<Profile> p = getProfile();
+        if (!p || p->GetNumValues(propertyName) <= 0)
+            return -1;
+    }
+
+    id = (int)Properties.GetSize();
+    Properties.PushBack(entry);
+    PropertyIds.Set(entry.Name, id);
+    return id;
+}
+
+HMDState::PropertyEntry* HMDState::getProperty(int propertyId)
+{
+    if (propertyId < 0 || propertyId >= (int)Properties.GetSize())
+        return 0;
+
+    // Built-in properties aren't cached, but those read as another type
+    // than their own fall through to the profile.
+    PropertyEntry& entry   = Properties[propertyId];
+    Ptr<Profile>   profile = getProfile();
+    Profile*       p       = profile.GetPtr();
+    if (entry.pCachedProfile.GetPtr() != p ||
+        (p && entry.CachedChangeCount != p->GetChangeCount()))
+    {
+        entry.pCachedProfile    = p;
+        entry.CachedChangeCount = p ? p->GetChangeCount() : 0;
+        entry.FloatCached       = false;
+        entry.ArrayCached       = false;
+    }
+    return &entry;
+}
+
 float HMDState::getFloatValue(const char* propertyName, float defaultVal)
 {
-	if (OVR_strcmp(propertyName, "LensSeparation") == 0)
-	{
+    updateProfile();
+    Lock::Locker lockScope(&PropertiesLock);
+    return getFloatValue_NeedsLock(getPropertyId_NeedsLock(propertyName), defaultVal);
+}
+
+float HMDState::getFloatValueById(int propertyId, float defaultVal)
+{
+    updateProfile();
+    Lock::Locker lockScope(&PropertiesLock);
+    return getFloatValue_NeedsLock(propertyId, defaultVal);
+}
+
+float HMDState::getFloatValue_NeedsLock(int propertyId, float defaultVal)
+{
+    PropertyEntry* entry = getProperty(propertyId);
+    if (!entry)
+        return defaultVal;
+
+    switch(entry->Kind)
+    {
+    case Property_LensSeparation:
 		return HMDInfo.LensSeparationInMeters;
-	}
-    else if (OVR_strcmp(propertyName, "CenterPupilDepth") == 0)
-    {        
+    case Property_CenterPupilDepth:
         return SFusion.GetCenterPupilDepth();
+    case Property_DistortionMeshGridSizeLog2:
+        return (float)RenderState.DistortionMeshGridSizeLog2;
+    case Property_IdleReadTimeout:
+        return (float)SFusion.GetIdleReadTimeout();
+    case Property_IdleMotionTimeout:
+        return (float)SFusion.GetIdleMotionTimeout();
+    case Property_PredictionModel:
+        return (float)SFusion.GetPredictionModel();
+    case Property_PredictionFilterTime:
+        return (float)SFusion.GetPredictionFilterSeconds();
+
+    default:
+        if (!entry->pCachedProfile)
+            return defaultVal;
+        if (!entry->FloatCached || entry->FloatDefault != defaultVal)
+        {
+            entry->FloatValue   = entry->pCachedProfile->GetFloatValue(entry->Name, defaultVal);
+            entry->FloatDefault = defaultVal;
+            entry->FloatCached  = true;
+        }
+        return entry->FloatValue;
     }
-	else if (pHMD)
-	{
-		Profile* p = pHMD->GetProfile();
-		if (p)
-		{
-			return p->GetFloatValue(propertyName, defaultVal);
-		}
-	}
-	return defaultVal;
 }
 
 bool HMDState::setFloatValue(const char* propertyName, float value)
 {
-    if (OVR_strcmp(propertyName, "CenterPupilDepth") == 0)
+    updateProfile();
+    Lock::Locker   lockScope(&PropertiesLock);
+    PropertyEntry* entry = getProperty(getPropertyId_NeedsLock(propertyName));
+    if (!entry)
+        return false;
+
+    switch(entry->Kind)
     {
+    case Property_CenterPupilDepth:
         SFusion.SetCenterPupilDepth(value);
         return true;
+    case Property_LatencyTestContinuous:
+        // Turning it off needn't create the utility.
+        if (value != 0.0f || pLatencyUtil)
+            getLatencyUtil()->SetContinuous(value != 0.0f);
+        return true;
+    case Property_DistortionMeshGridSizeLog2:
+        RenderState.DistortionMeshGridSizeLog2 =
+            Alg::Clamp((int)value, (int)Util::Render::DistortionMeshGridSizeLog2_Min,
+                                   (int)Util::Render::DistortionMeshGridSizeLog2_Max);
+        return true;
+    case Property_TraceWrite:
+        OVR_UNUSED(value);
+        return OVR_TRACE_WRITE(NULL);
+    case Property_IdleReadTimeout:
+        SFusion.SetIdlePolicy(value, SFusion.GetIdleMotionTimeout());
+        return true;
+    case Property_IdleMotionTimeout:
+        SFusion.SetIdlePolicy(SFusion.GetIdleReadTimeout(), value);
+        return true;
+    case Property_PredictionModel:
+        SFusion.SetPredictionModel((SensorFusion::PredictionModel)
+                                   Alg::Clamp((int)value, (int)SensorFusion::Prediction_Adaptive,
+                                              (int)SensorFusion::Prediction_Count - 1),
+                                   SFusion.GetPredictionFilterSeconds());
+        return true;
+    case Property_PredictionFilterTime:
+        SFusion.SetPredictionModel(SFusion.GetPredictionModel(), value);
+        return true;
+    default:
+        return false;
     }
-    return false;
 }
 
 
 static unsigned CopyFloatArrayWithLimit(float dest[], unsigned destSize,
-                                        float source[], unsigned sourceSize)
+                                        const float source[], unsigned sourceSize)
 {
     unsigned count = Alg::Min(destSize, sourceSize);
     for (unsigned i = 0; i < count; i++)
@@ -526,19 +959,36 @@ static unsigned CopyFloatArrayWithLimit(float dest[], unsigned destSize,
 
 unsigned HMDState::getFloatArray(const char* propertyName, float values[], unsigned arraySize)
 {
-	if (arraySize)
-	{
-		if (OVR_strcmp(propertyName, "ScreenSize") == 0)
-		{
+    updateProfile();
+    Lock::Locker lockScope(&PropertiesLock);
+    return getFloatArray_NeedsLock(getPropertyId_NeedsLock(propertyName), values, arraySize);
+}
+
+unsigned HMDState::getFloatArrayById(int propertyId, float values[], unsigned arraySize)
+{
+    updateProfile();
+    Lock::Locker lockScope(&PropertiesLock);
+    return getFloatArray_NeedsLock(propertyId, values, arraySize);
+}
+
+unsigned HMDState::getFloatArray_NeedsLock(int propertyId, float values[], unsigned arraySize)
+{
+    PropertyEntry* entry = getProperty(propertyId);
+    if (!entry || !arraySize)
+        return 0;
+
+    switch(entry->Kind)
+    {
+    case Property_ScreenSize:
+        {
             float data[2] = { HMDInfo.ScreenSizeInMeters.w, HMDInfo.ScreenSizeInMeters.h };
 
             return CopyFloatArrayWithLimit(values, arraySize, data, 2);
-		}
-        else if (OVR_strcmp(propertyName, "DistortionClearColor") == 0)
-        {
-            return CopyFloatArrayWithLimit(values, arraySize, RenderState.ClearColor, 4);
         }
-        else if (OVR_strcmp(propertyName, "DK2Latency") == 0)
+    case Property_DistortionClearColor:
+        return CopyFloatArrayWithLimit(values, arraySize, RenderState.ClearColor, 4);
+
+    case Property_DK2Latency:
         {
             if (HMDInfo.HmdType != HmdType_DK2)
                 return 0;
@@ -548,32 +998,93 @@ unsigned HMDState::getFloatArray(const char* propertyName, float values[], unsig
             
             return CopyFloatArrayWithLimit(values, arraySize, data, 3);
         }
+    case Property_LatencyTestStats:
+        {
+            // Without the utility, no test has run yet.
+            Util::LatencyTestStats stats;
+            memset(&stats, 0, sizeof(stats));
+            if (pLatencyUtil)
+                pLatencyUtil->GetContinuousStats(&stats);
+
+            float data[7] = { (float)stats.Count, stats.MinMs, stats.MeanMs, stats.MedianMs,
+                              stats.Percentile99Ms, stats.MaxMs, stats.SubmitToPhotonMs };
+            return CopyFloatArrayWithLimit(values, arraySize, data, 7);
+        }
+    case Property_LatencyTestHistogram:
+        {
+            // Without the utility, no test has run yet.
+            Util::LatencyTestStats stats;
+            memset(&stats, 0, sizeof(stats));
+            if (pLatencyUtil)
+                pLatencyUtil->GetContinuousStats(&stats);
+
+            float data[Util::LatencyTestStats::HistogramBuckets];
+            for (unsigned i = 0; i < Util::LatencyTestStats::HistogramBuckets; i++)
+                data[i] = (float)stats.Buckets[i];
+            return CopyFloatArrayWithLimit(values, arraySize, data, Util::LatencyTestStats::HistogramBuckets);
+        }
+    case Property_TimeSyncStats:
+        {
+            Ptr<SensorDevice> sensor;
+            {
+                DevicesLocker lockScope(this);
+                sensor = pSensor;
+            }
+
+            SensorTimeSyncStats stats;
+            if (!sensor || !sensor->GetTimeSyncStats(&stats))
+                return 0;
 
-        /*
-        else if (OVR_strcmp(propertyName, "CenterPupilDepth") == 0)
+            float data[7] = { (float)stats.DriftPerSecond, (float)stats.CorrectionPerSecond,
+                              (float)stats.LastJitter, (float)stats.MeanJitter, (float)stats.MaxJitter,
+                              (float)stats.Windows, (float)stats.Resets };
+            return CopyFloatArrayWithLimit(values, arraySize, data, 7);
+        }
+    case Property_MemoryFootprint:
         {
-            if (arraySize >= 1)
+            float data[MemoryFootprintCount];
+            getMemoryFootprint(data);
+            return CopyFloatArrayWithLimit(values, arraySize, data, MemoryFootprintCount);
+        }
+    case Property_PerfCounter:
+        {
+            PerfCounterValue value = entry->pCounter->GetValue();
+            float data[3 + PerfCounterValue::HistogramBuckets] =
+                { (float)value.Count, (float)value.GetMean(), (float)value.Max };
+            unsigned count = 3;
+            if (entry->pCounter->HasHistogram())
             {
-                values[0] = SFusion.GetCenterPupilDepth();
-                return 1;
+                for (int i = 0; i < PerfCounterValue::HistogramBuckets; i++)
+                    data[count++] = (float)value.Buckets[i];
             }
-            return 0;
-        } */
-		else if (pHMD)
-		{        
-			Profile* p = pHMD->GetProfile();
-
-			// TBD: Not quite right. Should update profile interface, so that
-			//      we can return 0 in all conditions if property doesn't exist.
-			if (p)
-			{
-				unsigned count = p->GetFloatValues(propertyName, values, arraySize);
-				return count;
-			}
-		}
-	}
 
-	return 0;
+            return CopyFloatArrayWithLimit(values, arraySize, data, count);
+        }
+
+    default:
+        {
+            // TBD: Not quite right. Should update profile interface, so that
+            //      we can return 0 in all conditions if property doesn't exist.
+            Profile* p = entry->pCachedProfile;
+            if (!p)
+                return 0;
+
+            if (!entry->ArrayCached)
+            {
+                entry->ArrayValues.Resize(p->GetNumValues(entry->Name));
+                int count = 0;
+                if (entry->ArrayValues.GetSize())
+                    count = p->GetFloatValues(entry->Name, &entry->ArrayValues[0],
+                                              (int)entry->ArrayValues.GetSize());
+                entry->ArrayValues.Resize(count);
+                entry->ArrayCached = true;
+            }
+            if (entry->ArrayValues.IsEmpty())
+                return 0;
+            return CopyFloatArrayWithLimit(values, arraySize, &entry->ArrayValues[0],
+                                           (unsigned)entry->ArrayValues.GetSize());
+        }
+    }
 }
 
 bool HMDState::setFloatArray(const char* propertyName, float values[], unsigned arraySize)
@@ -581,7 +1092,10 @@ bool HMDState::setFloatArray(const char* propertyName, float values[], unsigned
     if (!arraySize)
         return false;
     
-    if (OVR_strcmp(propertyName, "DistortionClearColor") == 0)
+    updateProfile();
+    Lock::Locker   lockScope(&PropertiesLock);
+    PropertyEntry* entry = getProperty(getPropertyId_NeedsLock(propertyName));
+    if (entry && entry->Kind == Property_DistortionClearColor)
     {
         CopyFloatArrayWithLimit(RenderState.ClearColor, 4, values, arraySize);
         return true;
@@ -595,7 +1109,8 @@ const char* HMDState::getString(const char* propertyName, const char* defaultVal
 	if (pHMD)
 	{
 		// For now, just access the profile.
-		Profile* p = pHMD->GetProfile();
+		updateProfile();
+		Ptr<Profile> p = getProfile();
 
 		LastGetStringValue[0] = 0;
 		if (p && p->GetValue(propertyName, LastGetStringValue, sizeof(LastGetStringValue)))
@@ -621,8 +1136,8 @@ bool HMDState::ProcessLatencyTest(unsigned char rgbColorOut[3])
         {
             Color colorToDisplay;
 
-            LatencyUtil.ProcessInputs();
-            result = LatencyUtil.DisplayScreenColor(colorToDisplay);
+            pLatencyUtil->ProcessInputs();
+            result = pLatencyUtil->DisplayScreenColor(colorToDisplay);
             rgbColorOut[0] = colorToDisplay.R;
             rgbColorOut[1] = colorToDisplay.G;
             rgbColorOut[2] = colorToDisplay.B;
@@ -630,7 +1145,7 @@ bool HMDState::ProcessLatencyTest(unsigned char rgbColorOut[3])
         else
         {
             // Disconnect.
-            LatencyUtil.SetDevice(NULL);
+            pLatencyUtil->SetDevice(NULL);
             pLatencyTester = 0;
             LogText("LATENCY SENSOR disconnected.\n");
         }
@@ -644,7 +1159,7 @@ bool HMDState::ProcessLatencyTest(unsigned char rgbColorOut[3])
                             EnumerateDevices<LatencyTestDevice>().CreateDevice();
         if (pLatencyTester)
         {
-            LatencyUtil.SetDevice(pLatencyTester);
+            getLatencyUtil()->SetDevice(pLatencyTester);
             LogText("LATENCY TESTER connected\n");
         }        
     }
@@ -714,6 +1229,9 @@ bool HMDState::ConfigureRendering(ovrEyeRenderDesc eyeRenderDescOut[2],
         return true;
     }
 
+    // A profile read since creation is set up for rendering before it's configured.
+    updateProfile();
+
     if (pRenderer &&
         (apiConfig->Header.API != pRenderer->GetRenderAPI()))
     {
@@ -753,23 +1271,67 @@ bool HMDState::ConfigureRendering(ovrEyeRenderDesc eyeRenderDescOut[2],
     return true;
 }
 
+bool HMDState::CreateSwapTextureSet(Sizei size, int textureCount, ovrSwapTextureSet** outTextureSet)
+{
+    ThreadChecker::Scope checkScope(&RenderAPIThreadChecker, "ovrHmd_CreateSwapTextureSet");
+    checkRenderingConfigured("ovrHmd_CreateSwapTextureSet");
+
+    if (!pRenderer || textureCount <= 0 || size.w <= 0 || size.h <= 0)
+        return false;
+
+    ovrSwapTextureSet* textureSet = (ovrSwapTextureSet*)OVR_ALLOC(sizeof(ovrSwapTextureSet));
+    ovrTexture*        textures   = (ovrTexture*)OVR_ALLOC(sizeof(ovrTexture) * textureCount);
+    if (!textureSet || !textures)
+    {
+        OVR_FREE(textureSet);
+        OVR_FREE(textures);
+        return false;
+    }
+    memset(textures, 0, sizeof(ovrTexture) * textureCount);
+    textureSet->Textures     = textures;
+    textureSet->TextureCount = textureCount;
+    textureSet->CurrentIndex = 0;
+
+    if (!pRenderer->CreateSwapTextureSet(textureSet, size))
+    {
+        OVR_FREE(textures);
+        OVR_FREE(textureSet);
+        return false;
+    }
+
+    *outTextureSet = textureSet;
+    return true;
+}
+
+void HMDState::DestroySwapTextureSet(ovrSwapTextureSet* textureSet)
+{
+    ThreadChecker::Scope checkScope(&RenderAPIThreadChecker, "ovrHmd_DestroySwapTextureSet");
+
+    // The textures are already gone if the renderer they came from was.
+    if (pRenderer)
+        pRenderer->DestroySwapTextureSet(textureSet);
+    OVR_FREE(textureSet->Textures);
+    OVR_FREE(textureSet);
+}
+
 
 
 ovrPosef HMDState::BeginEyeRender(ovrEyeType eye)
 {
     // Debug checks.
-    checkBeginFrameScope("ovrHmd_BeginEyeRender");
-    ThreadChecker::Scope checkScope(&RenderAPIThreadChecker, "ovrHmd_BeginEyeRender");
+    checkEyeRenderScope("ovrHmd_BeginEyeRender");
 
     // Unknown eyeId provided in ovrHmd_BeginEyeRender
     OVR_ASSERT_LOG(eye == ovrEye_Left || eye == ovrEye_Right,
                    ("ovrHmd_BeginEyeRender eyeId out of range."));     
-    OVR_ASSERT_LOG(EyeRenderActive[eye] == false,
-                   ("Multiple calls to ovrHmd_BeginEyeRender for the same eye."));
 
-    EyeRenderActive[eye] = true;
+    HMDRenderState::EyeSubmission& slot = RenderState.EyeSubmissions[eye];
+    OVR_ASSERT_LOG(slot.State.Load_Acquire() != HMDRenderState::EyeSubmission::State_Rendering,
+                   ("Multiple calls to ovrHmd_BeginEyeRender for the same eye."));
+    slot.State.Store_Release(HMDRenderState::EyeSubmission::State_Rendering);
     
-    // Only process latency tester for drawing the left eye (assumes left eye is drawn first)
+    // Only process latency tester for drawing the left eye (assumes left eye is drawn first);
+    // EndFrame reads the result once that eye is submitted.
     if (pRenderer && eye == 0)
     {
         LatencyTestActive = ProcessLatencyTest(LatencyTestDrawColor);
@@ -779,25 +1341,58 @@ ovrPosef HMDState::BeginEyeRender(ovrEyeType eye)
 }
 
 
-void HMDState::EndEyeRender(ovrEyeType eye, ovrPosef renderPose, ovrTexture* eyeTexture)
+void HMDState::EndEyeRender(ovrEyeType eye, ovrPosef renderPose, ovrTexture* eyeTexture,
+                            ovrTexture* depthTexture, const ovrMatrix4f* projection)
 {
     // Debug checks.
-    checkBeginFrameScope("ovrHmd_EndEyeRender");
-    ThreadChecker::Scope checkScope(&RenderAPIThreadChecker, "ovrHmd_EndEyeRender");
+    checkEyeRenderScope("ovrHmd_EndEyeRender");
 
-    if (!EyeRenderActive[eye])
+    HMDRenderState::EyeSubmission& slot = RenderState.EyeSubmissions[eye];
+    if (slot.State.Load_Acquire() != HMDRenderState::EyeSubmission::State_Rendering)
     {
         OVR_ASSERT_LOG(false,
                        ("ovrHmd_EndEyeRender called without ovrHmd_BeginEyeRender."));
         return;
     }
 
-    RenderState.EyeRenderPoses[eye] = renderPose;
+    // The textures are copied, and only used by EndFrame, on the render API thread.
+    slot.RenderPose = renderPose;
+    slot.HasTexture = (eyeTexture != 0);
+    if (eyeTexture)
+        slot.Texture = *eyeTexture;
+    slot.HasDepth   = (depthTexture && projection);
+    if (slot.HasDepth)
+    {
+        slot.DepthTexture    = *depthTexture;
+        slot.DepthProjection = *projection;
+    }
 
-    if (pRenderer)
-        pRenderer->SubmitEye(eye, eyeTexture);
+    slot.State.Store_Release(HMDRenderState::EyeSubmission::State_Submitted);
+}
 
-    EyeRenderActive[eye] = false;
+void HMDState::SubmitEyes()
+{
+    for (int eye = 0; eye < 2; eye++)
+    {
+        HMDRenderState::EyeSubmission& slot = RenderState.EyeSubmissions[eye];
+
+        // An eye thread that hasn't reached EndEyeRender yet is waited for.
+        int state;
+        while ((state = slot.State.Load_Acquire()) == HMDRenderState::EyeSubmission::State_Rendering)
+            Thread::MSleep(0);
+        if (state != HMDRenderState::EyeSubmission::State_Submitted)
+            continue;
+
+        RenderState.EyeRenderPoses[eye] = slot.RenderPose;
+        if (pRenderer && slot.HasTexture)
+        {
+            pRenderer->SubmitEye(eye, &slot.Texture);
+            if (slot.HasDepth)
+                pRenderer->SubmitEyeDepth(eye, &slot.DepthTexture, slot.DepthProjection);
+        }
+
+        slot.State.Store_Release(HMDRenderState::EyeSubmission::State_Idle);
+    }
 }
 
 }} // namespace OVR::CAPI
@@ -32,6 +32,12 @@ limitations under the License.
 #include "../Kernel/OVR_Log.h"
 #include "../OVR_CAPI.h"
 #include "../OVR_SensorFusion.h"
+#include "../OVR_SensorTrace.h"
+#include "../OVR_PoseStreamer.h"
+#include "../OVR_Profile.h"
+#include "../Kernel/OVR_HashFlat.h"
+#include "../Kernel/OVR_PerfCounters.h"
+#include "../Kernel/OVR_ThreadPool.h"
 #include "../Util/Util_LatencyTest.h"
 #include "../Util/Util_LatencyTest2.h"
 
@@ -144,6 +150,9 @@ public:
     void            StopSensor();
     void            ResetSensor();
     ovrSensorState  PredictedSensorState(double absTime);
+    // Predicts poses for count absTimes from a single sensor snapshot; see ovrHmd_GetSensorStateBatch.
+    ovrSensorState  PredictedSensorStateBatch(const double* absTimes,
+                                              ovrPoseStatef* predictedStates, unsigned count);
     bool            GetSensorDesc(ovrSensorDesc* descOut);
 
     // Changes HMD Caps.
@@ -162,9 +171,18 @@ public:
                                   const ovrFovPort eyeFovIn[2],
                                   const ovrRenderAPIConfig* apiConfig,                                  
                                   unsigned distortionCaps);  
+
+    bool       CreateSwapTextureSet(Sizei size, int textureCount, ovrSwapTextureSet** outTextureSet);
+    void       DestroySwapTextureSet(ovrSwapTextureSet* textureSet);
     
+    // The eyes may be rendered on threads other than the one calling BeginFrame,
+    // at the same time; each eye is recorded in its RenderState.EyeSubmissions slot.
     ovrPosef    BeginEyeRender(ovrEyeType eye);
-    void        EndEyeRender(ovrEyeType eye, ovrPosef renderPose, ovrTexture* eyeTexture);
+    void        EndEyeRender(ovrEyeType eye, ovrPosef renderPose, ovrTexture* eyeTexture,
+                             ovrTexture* depthTexture = 0, const ovrMatrix4f* projection = 0);
+    // Called by EndFrame: waits for eyes still being rendered, then passes the
+    // submitted ones to the distortion renderer.
+    void        SubmitEyes();
 
 
     const char* GetLastError()
@@ -174,20 +192,66 @@ public:
         return p;
     }    
 
+    // Called on the device manager thread.
     void NotifyAddDevice(DeviceType deviceType)
     {
         if (deviceType == Device_Sensor)
+        {
             AddSensorCount++;
+            updateSensorDevice();
+        }
         else if (deviceType == Device_LatencyTester)
         {
             AddLatencyTestCount++;
             AddLatencyTestDisplayCount++;
         }
     }
+    void NotifyRemoveDevice(DeviceType deviceType)
+    {
+        if (deviceType == Device_Sensor)
+        {
+            RemoveSensorCount++;
+            updateSensorDevice();
+        }
+    }
+    // Called on the device manager thread when the profile database changed.
+    void NotifyProfileChange()
+    {
+        ProfileChangeCount++;
+    }
 
-    bool checkCreateSensor();
+    // Applies the HMD profile once it has been read, and has it read again after
+    // NotifyProfileChange. Called by the calls that use the profile, on any thread;
+    // takes DevicesLock, so it isn't called with PropertiesLock held.
+    void updateProfile();
+    // Has the profile read on the thread pool, or by the next updateProfile if
+    // the pool has no workers. No read may be in flight.
+    void requestProfile(bool reload);
+    // Reads the profile through the HMD device, into pLoadedProfile.
+    void loadProfile();
+    static void loadProfileTask(void* hmdState);
+    // Switches to pLoadedProfile, with DevicesLock held; the old profile is moved
+    // to oldProfile, for the caller to release once it unlocks.
+    void applyLoadedProfile(Ptr<Profile>* oldProfile);
+
+    // Handles sensors added or removed since the last call, unless another thread
+    // holds DevicesLock; that thread's DevicesLocker calls it again once it unlocks.
+    void updateSensorDevice();
+    void updateSensor_NeedsLock();
+    bool startSensor_NeedsLock(unsigned supportedCaps, unsigned requiredCaps);
 
     void applyProfileToSensorFusion();
+    // Starts recording the sensor if OVR_SENSOR_TRACE names a trace file.
+    void startSensorTrace();
+    // Starts streaming poses if OVR_POSE_STREAM names an address, and stops it.
+    void startPoseStream();
+    void stopPoseStream();
+    // Returns the DK1 latency test utility, creating it on first use.
+    Util::LatencyTest* getLatencyUtil();
+
+    // Bytes used by the HMD and its parts, in the order "MemoryFootprint" reports them.
+    enum { MemoryFootprintCount = 12 };
+    void getMemoryFootprint(float data[MemoryFootprintCount]) const;
 
     // INlines so that they can be easily compiled out.    
     // Does debug ASSERT checks for functions that require BeginFrame.
@@ -201,6 +265,15 @@ public:
                        ("%s called on a different thread then ovrHmd_BeginFrame.", functionName));
     }
 
+    // Like checkBeginFrameScope, for the eye functions, which may be called on
+    // other threads.
+    void checkEyeRenderScope(const char* functionName)
+    {
+        OVR_UNUSED1(functionName); // for Release build.
+        OVR_ASSERT_LOG(BeginFrameCalled == true,
+                       ("%s called outside ovrHmd_BeginFrame.", functionName));
+    }
+
     void checkRenderingConfigured(const char* functionName)
     {
         OVR_UNUSED1(functionName); // for Release build.
@@ -229,6 +302,13 @@ public:
 	unsigned getFloatArray(const char* propertyName, float values[], unsigned arraySize);
     bool     setFloatArray(const char* propertyName, float values[], unsigned arraySize);
 	const char* getString(const char* propertyName, const char* defaultVal);
+
+    // Get properties by the id returned by getPropertyId, which stays valid for
+    // the life of the HMD. Ids out of range read as missing properties; names that
+    // don't exist get -1, and aren't interned. Any thread may call these.
+    int      getPropertyId(const char* propertyName);
+    float    getFloatValueById(int propertyId, float defaultVal);
+    unsigned getFloatArrayById(int propertyId, float values[], unsigned arraySize);
 public:
     
     // Wrapper to support 'const'
@@ -267,24 +347,79 @@ public:
     
     // *** Sensor
 
-    // Lock used to support thread-safe lifetime access to sensor.
-    Lock                    DevicesLock;
+    // Lock used to support thread-safe lifetime access to sensor. Threads holding it
+    // may wait for the device manager thread, which therefore only tries to take it.
+    // It is only taken through DevicesLocker, so that sensor changes the device
+    // manager thread couldn't handle are handled as it is released.
+    Mutex                   DevicesLock;
+    // DevicesLocker scopes open on the thread holding DevicesLock.
+    int                     DevicesLockDepth;
 
-    // Atomic integer used as a flag that we should check the sensor device.
+    class DevicesLocker
+    {
+    public:
+        DevicesLocker(HMDState* hmd) : pState(hmd)
+        {
+            pState->DevicesLock.DoLock();
+            pState->DevicesLockDepth++;
+        }
+        ~DevicesLocker()
+        {
+            bool outermost = (--pState->DevicesLockDepth == 0);
+            pState->DevicesLock.Unlock();
+            if (outermost)
+                pState->updateSensorDevice();
+        }
+    private:
+        void operator = (const DevicesLocker&) { }
+        HMDState* pState;
+    };
+
+    // Atomic integers used as flags that we should check the sensor device; raised
+    // on the device manager thread as sensors are added and removed.
     AtomicInt<int>          AddSensorCount;    
+    AtomicInt<int>          RemoveSensorCount;
+    // Raised on the device manager thread as the profile database changes.
+    AtomicInt<int>          ProfileChangeCount;
+
+    // The HMD profile is read from disk after the HMD is created, rather than by
+    // its constructor; until it arrives, pProfile is null and defaults are used.
+    // While a read is in flight only its task uses the HMD device's profile and
+    // the loaded fields below; updateProfile takes them once it has finished.
+    Ptr<Profile>            pProfile;
+#ifdef OVR_ENABLE_THREADS
+    TaskGroup*              pProfileTasks;
+#endif
+    Ptr<Profile>            pLoadedProfile;
+    bool                    ProfileLoaded;
+    // The database changed, so the device's cached profile is dropped first.
+    bool                    ProfileReload;
+    // The read is left to updateProfile, as there are no pool workers.
+    bool                    ProfileLoadDeferred;
+    // A change was seen while a read was in flight.
+    bool                    ProfileChangePending;
 
     // All of Sensor variables may be modified/used with DevicesLock, with exception that
-    // the {SensorStarted, SensorCreated} can be read outside the lock to see
-    // if device creation check is necessary.
+    // the {SensorStarted, SensorCreated} can be read outside the lock. The sensor is
+    // created and released with the lock held, so that sensor state queries only read
+    // the lockless SensorFusion state.
     // Whether we called StartSensor() and requested sensor caps.    
     volatile bool           SensorStarted;
     volatile bool           SensorCreated;
+    // The sensor is tracked by the process publishing the pose service, and SFusion
+    // reads that fusion's state; pSensor stays null.
+    volatile bool           SensorShared;
+    // SFusion publishes its state through the pose service.
+    bool                    SensorPublished;
     // pSensor may still be null or non-running after start if it wasn't yet available
     Ptr<SensorDevice>       pSensor;	// Head
     unsigned                SensorCaps;    
 
     // SensorFusion state may be accessible without a lock.
     SensorFusion            SFusion;
+    SensorTraceWriter       SensorTrace;
+    // Created when OVR_POSE_STREAM asks for a stream.
+    PoseStreamer*           pPoseStream;
 
     
     // Vision pose tracker is currently new-allocated
@@ -294,7 +429,9 @@ public:
     
     // Latency tester
     Ptr<LatencyTestDevice>  pLatencyTester;
-    Util::LatencyTest	    LatencyUtil;
+    // Created by getLatencyUtil once a tester connects or continuous testing is
+    // turned on; null until then.
+    Util::LatencyTest*      pLatencyUtil;
     AtomicInt<int>          AddLatencyTestCount;
 
     bool                    LatencyTestActive;
@@ -322,6 +459,75 @@ public:
 
     // Last cached value returned by ovrHmd_GetString/ovrHmd_GetStringArray.
     char                    LastGetStringValue[256];
+
+
+    // *** Properties
+
+    // Property names are interned into ids on first use, and what each one reads
+    // is worked out then, so that reads by id don't compare strings. Only built-in
+    // properties, registered perf counters and values the profile has are interned.
+    // Values from the profile are cached until the profile or its change count
+    // changes. Properties and their entries are used with PropertiesLock held.
+    enum PropertyKind
+    {
+        Property_Profile,
+        Property_LensSeparation,
+        Property_CenterPupilDepth,
+        Property_DistortionMeshGridSizeLog2,
+        Property_LatencyTestContinuous,
+        Property_TraceWrite,
+        Property_ScreenSize,
+        Property_DistortionClearColor,
+        Property_DK2Latency,
+        Property_LatencyTestStats,
+        Property_LatencyTestHistogram,
+        Property_TimeSyncStats,
+        Property_PerfCounter,
+        Property_IdleReadTimeout,
+        Property_IdleMotionTimeout,
+        Property_PredictionModel,
+        Property_PredictionFilterTime,
+        Property_MemoryFootprint
+    };
+
+    struct PropertyEntry
+    {
+        String          Name;
+        PropertyKind    Kind;
+        PerfCounter*    pCounter;
+
+        // Profile the cached values were read from; held so that its address
+        // can't be reused by another profile.
+        Ptr<Profile>    pCachedProfile;
+        UInt32          CachedChangeCount;
+        // The float is only cached for the default value it was read with.
+        bool            FloatCached;
+        float           FloatDefault;
+        float           FloatValue;
+        bool            ArrayCached;
+        Array<float>    ArrayValues;
+    };
+
+    struct PropertyNameHash
+    {
+        UPInt operator()(const String& name) const
+        { return String::FastHashFunction(name.ToCStr(), name.GetSize()); }
+        UPInt operator()(const char* name) const
+        { return String::FastHashFunction(name, OVR_strlen(name)); }
+    };
+
+    // Returns the entry for propertyId with its profile values still valid, or null.
+    // Called with PropertiesLock held, after updateProfile.
+    PropertyEntry*          getProperty(int propertyId);
+    int                     getPropertyId_NeedsLock(const char* propertyName);
+    float                   getFloatValue_NeedsLock(int propertyId, float defaultVal);
+    unsigned                getFloatArray_NeedsLock(int propertyId, float values[], unsigned arraySize);
+    // The current profile, read under DevicesLock.
+    Ptr<Profile>            getProfile();
+
+    mutable Lock                                PropertiesLock;
+    Array<PropertyEntry>                        Properties;
+    HashFlat<String, int, PropertyNameHash>     PropertyIds;
    
 
     // Debug flag set after ovrHmd_ConfigureRendering succeeds.
@@ -333,9 +539,6 @@ public:
     ThreadChecker           RenderAPIThreadChecker;
     // 
     bool                    BeginFrameTimingCalled;
-    
-    // Flags set when we've called BeginEyeRender on a given eye.
-    bool                    EyeRenderActive[2];
 };
 
 
@@ -18,6 +18,7 @@ otherwise accompanies this software in either electronic or hard copy form.
 #include "CAPI_GL_DistortionShaders.h"
 
 #include "../../OVR_CAPI_GL.h"
+#include "../../Kernel/OVR_Trace.h"
 
 namespace OVR { namespace CAPI { namespace GL {
 
@@ -59,6 +60,13 @@ static ShaderInfo DistortionPixelShaderLookup[DistortionPixelShaderCount] =
     SI_NOREFL(DistortionChroma_fs)
 };
 
+// Per-pixel distortion has one vertex and one fragment shader, set up by defines.
+static ShaderInfo PixelDistortionShaderLookup[2] =
+{
+    SI_NOREFL(DistortionPixel_vs),
+    SI_NOREFL(DistortionPixel_fs)
+};
+
 void DistortionShaderBitIndexCheck()
 {
     OVR_COMPILER_ASSERT(ovrDistortionCap_Chromatic == 1);
@@ -74,6 +82,7 @@ struct DistortionVertex
     Vector2f TexG;
     Vector2f TexB;
     Color    Col;
+    float    EyeIndex;
 };
 
 
@@ -85,6 +94,89 @@ struct LatencyVertex
     LatencyVertex (const Vector3f& p) : Pos(p) {}
 };
 
+// Vertex attribute names, in the order of the locations they are bound to.
+static const char* const DistortionVertexAttribs[] =
+{
+    "Position", "Color", "TexCoord0", "TexCoord1", "TexCoord2", "EyeIndex"
+};
+
+static const char* const LatencyVertexAttribs[] =
+{
+    "Position"
+};
+
+// Per-eye uniforms of the shaders drawing an eye at a time, and both at once.
+static const char* const DistortionUniformNames[4] =
+{
+    "EyeToSourceUVScale", "EyeToSourceUVOffset", "EyeRotationStart", "EyeRotationEnd"
+};
+
+// Distortion programs shared by the renderers of HMDs with the same distortion caps,
+// such as several identical HMDs driven by one application, so that they are only
+// compiled once. Renderers set all uniforms of the distortion programs before each
+// draw, so sharing is safe while the renderers take turns on one context; programs
+// are therefore only shared on the context they were made on, and not with
+// renderers using asynchronous timewarp, which draw on threads of their own.
+struct SharedDistortionProgram
+{
+    void*           Context;
+    // Vertex and fragment shader sources.
+    String          Key;
+    Ptr<ShaderSet>  Shaders;
+};
+
+static Lock                             SharedDistortionProgramsLock;
+static Array<SharedDistortionProgram>   SharedDistortionPrograms;
+
+static void* getCurrentContext()
+{
+#if defined(OVR_OS_WIN32)
+    return wglGetCurrentContext();
+#elif defined(OVR_OS_MAC)
+    return CGLGetCurrentContext();
+#else
+    return glXGetCurrentContext();
+#endif
+}
+
+// Drops the renderer's reference to a distortion program, releasing a shared one
+// once no other renderer uses it.
+static void releaseDistortionShader(Ptr<ShaderSet>& shaders)
+{
+    if (!shaders)
+        return;
+
+    {
+        Lock::Locker lock(&SharedDistortionProgramsLock);
+        for (UPInt i = 0; i < SharedDistortionPrograms.GetSize(); i++)
+        {
+            if (SharedDistortionPrograms[i].Shaders != shaders)
+                continue;
+
+            // Held by the table and by us.
+            if (shaders->GetRefCount() > 2)
+            {
+                shaders.Clear();
+                return;
+            }
+            SharedDistortionPrograms.RemoveAt(i);
+            // Static, so free its memory before the allocator goes away.
+            if (SharedDistortionPrograms.IsEmpty())
+                SharedDistortionPrograms.ClearAndRelease();
+            break;
+        }
+    }
+
+    shaders->UnsetShader(Shader_Vertex);
+    shaders->UnsetShader(Shader_Pixel);
+    shaders.Clear();
+}
+
+static const char* const BothEyesUniformNames[4] =
+{
+    "EyeToSourceUVScales", "EyeToSourceUVOffsets", "EyeRotationStarts", "EyeRotationEnds"
+};
+
 
 //----------------------------------------------------------------------------
 // ***** GL::DistortionRenderer
@@ -92,10 +184,28 @@ struct LatencyVertex
 DistortionRenderer::DistortionRenderer(ovrHmd hmd, FrameTimeManager& timeManager,
                                        const HMDRenderState& renderState)
     : CAPI::DistortionRenderer(ovrRenderAPI_OpenGL, hmd, timeManager, renderState)
+	, BothEyesMeshVAO(0)
+	, TimewarpSampled(false)
+	, TimewarpSamplesUniform(-1)
+	, DistortionTableTexId(0)
+	, PixelDistortionVAO(0)
+	, EyeUniformBinding(0)
+	, LatchedPoseBinding(0)
+	, LatchedPoses(NULL)
+	, TimerSlot(0)
 	, LatencyVAO(0)
+	, PendingFrameValid(false)
+	, AsyncThreadFailed(false)
+#if defined(OVR_OS_LINUX)
+	, AsyncContext(0)
+	, SupportsSyncValues(false)
+#endif
 {
+    PendingFrame = AsyncFrame();
 	DistortionMeshVAOs[0] = 0;
 	DistortionMeshVAOs[1] = 0;
+    memset(TimerQueries, 0, sizeof(TimerQueries));
+    memset(TimerQueryPending, 0, sizeof(TimerQueryPending));
 }
 
 DistortionRenderer::~DistortionRenderer()
@@ -118,7 +228,11 @@ CAPI::DistortionRenderer* DistortionRenderer::Create(ovrHmd hmd,
 bool DistortionRenderer::Initialize(const ovrRenderAPIConfig* apiConfig,
 									unsigned distortionCaps)
 {
-	GfxState = *new GraphicsState();
+    // The threads use the state set up here.
+    stopAsyncTimewarp();
+    stopPoseLatching();
+
+	GfxState = *new GraphicsState((distortionCaps & ovrDistortionCap_CachedGraphicsState) != 0);
 
     const ovrGLConfig* config = (const ovrGLConfig*)apiConfig;
 
@@ -127,6 +241,9 @@ bool DistortionRenderer::Initialize(const ovrRenderAPIConfig* apiConfig,
         // Cleanup
         pEyeTextures[0].Clear();
         pEyeTextures[1].Clear();
+        pSubmittedEyeTextures[0].Clear();
+        pSubmittedEyeTextures[1].Clear();
+        SwapTextures.Clear();
         memset(&RParams, 0, sizeof(RParams));
         return true;
     }
@@ -143,17 +260,50 @@ bool DistortionRenderer::Initialize(const ovrRenderAPIConfig* apiConfig,
         int unused;
         XGetInputFocus(RParams.Disp, &RParams.Win, &unused);
     }
+
+    const char* glxExtensions = glXQueryExtensionsString(RParams.Disp, 0);
+    SupportsSyncValues = glxExtensions && strstr(glxExtensions, "GLX_OML_sync_control") && glXGetSyncValuesOML;
 #endif
 	
     DistortionCaps = distortionCaps;
+
+    // Per-pixel distortion needs GLSL 1.50 and float textures.
+    GraphicsState* glState = (GraphicsState*)GfxState.GetPtr();
+    if ((DistortionCaps & ovrDistortionCap_PixelDistortion) &&
+        (glState->GlMajorVersion < 3 || (glState->GlMajorVersion == 3 && glState->GlMinorVersion < 2)))
+    {
+        LogText("OVR::GL::DistortionRenderer - per-pixel distortion needs GL 3.2; drawing the distortion mesh\n");
+        DistortionCaps &= ~(unsigned)ovrDistortionCap_PixelDistortion;
+    }
+    glState->SavesTableTexture = (DistortionCaps & ovrDistortionCap_PixelDistortion) != 0;
+
+    // Positional timewarp reads the depth per pixel.
+    if ((DistortionCaps & ovrDistortionCap_PositionalTimeWarp) &&
+        (!(DistortionCaps & ovrDistortionCap_PixelDistortion) || !(DistortionCaps & ovrDistortionCap_TimeWarp)))
+    {
+        LogText("OVR::GL::DistortionRenderer - positional timewarp needs timewarp and per-pixel distortion\n");
+        DistortionCaps &= ~(unsigned)ovrDistortionCap_PositionalTimeWarp;
+    }
+    glState->SavesDepthTexture = (DistortionCaps & ovrDistortionCap_PositionalTimeWarp) != 0;
 	
     //DistortionWarper.SetVsync((hmdCaps & ovrHmdCap_NoVSync) ? false : true);
 
     pEyeTextures[0] = *new Texture(&RParams, 0, 0);
     pEyeTextures[1] = *new Texture(&RParams, 0, 0);
+    pSubmittedEyeTextures[0] = pEyeTextures[0];
+    pSubmittedEyeTextures[1] = pEyeTextures[1];
+
+    // The field of view may have changed.
+    eachEye[0].UVScaleOffsetValid = false;
+    eachEye[1].UVScaleOffsetValid = false;
 
     initBuffersAndShaders();
 
+    if (LatchedPoses)
+        startPoseLatching();
+    if ((DistortionCaps & ovrDistortionCap_AsyncTimeWarp) && (DistortionCaps & ovrDistortionCap_TimeWarp))
+        startAsyncTimewarp();
+
     return true;
 }
 
@@ -164,30 +314,167 @@ void DistortionRenderer::SubmitEye(int eyeId, ovrTexture* eyeTexture)
 	const ovrGLTexture* tex = (const ovrGLTexture*)eyeTexture;
 
 	// Write in values
-    eachEye[eyeId].texture = tex->OGL.TexId;
+    eachEye[eyeId].texture      = tex->OGL.TexId;
+    eachEye[eyeId].depthTexture = 0;
 
 	if (tex)
 	{
         // Its only at this point we discover what the viewport of the texture is.
 	    // because presumably we allow users to realtime adjust the resolution.
-        eachEye[eyeId].TextureSize    = tex->OGL.Header.TextureSize;
-        eachEye[eyeId].RenderViewport = tex->OGL.Header.RenderViewport;
+        Sizei textureSize    = tex->OGL.Header.TextureSize;
+        Recti renderViewport = tex->OGL.Header.RenderViewport;
+
+        if (!eachEye[eyeId].UVScaleOffsetValid ||
+            textureSize != eachEye[eyeId].TextureSize || renderViewport != eachEye[eyeId].RenderViewport)
+        {
+            eachEye[eyeId].TextureSize    = textureSize;
+            eachEye[eyeId].RenderViewport = renderViewport;
 
-        const ovrEyeRenderDesc& erd = RState.EyeRenderDesc[eyeId];
+            const ovrEyeRenderDesc& erd = RState.EyeRenderDesc[eyeId];
     
-        ovrHmd_GetRenderScaleAndOffset( erd.Fov,
-                                        eachEye[eyeId].TextureSize, eachEye[eyeId].RenderViewport,
-                                        eachEye[eyeId].UVScaleOffset );
+            ovrHmd_GetRenderScaleAndOffset( erd.Fov,
+                                            eachEye[eyeId].TextureSize, eachEye[eyeId].RenderViewport,
+                                            eachEye[eyeId].UVScaleOffset );
+            eachEye[eyeId].UVScaleOffsetValid = true;
+        }
 
-        pEyeTextures[eyeId]->UpdatePlaceholderTexture(tex->OGL.TexId,
-                                                      tex->OGL.Header.TextureSize);
+        // Swap textures are used as they are; others are wrapped each frame.
+        Texture* swapTexture = findSwapTexture(tex->OGL.TexId);
+        if (swapTexture)
+        {
+            if (pSubmittedEyeTextures[eyeId] != swapTexture)
+                pSubmittedEyeTextures[eyeId] = swapTexture;
+        }
+        else
+        {
+            pEyeTextures[eyeId]->UpdatePlaceholderTexture(tex->OGL.TexId,
+                                                          tex->OGL.Header.TextureSize);
+            if (pSubmittedEyeTextures[eyeId] != pEyeTextures[eyeId])
+                pSubmittedEyeTextures[eyeId] = pEyeTextures[eyeId];
+        }
 	}
 }
 
+bool DistortionRenderer::CreateSwapTextureSet(ovrSwapTextureSet* textureSet, Sizei size)
+{
+    // Created on the active unit, whose binding is put back after.
+    GLint boundTexture = 0;
+    glGetIntegerv(GL_TEXTURE_BINDING_2D, &boundTexture);
+
+    UPInt firstTexture = SwapTextures.GetSize();
+    bool  created      = true;
+    for (int i = 0; i < textureSet->TextureCount; i++)
+    {
+        SwapTexture swapTexture;
+        swapTexture.pSet     = textureSet;
+        swapTexture.pTexture = *new Texture(&RParams, size.w, size.h);
+        if (!swapTexture.pTexture->TexId)
+        {
+            created = false;
+            break;
+        }
+
+        // Only distortion samples them, once per pixel, so they have no mipmaps.
+        glBindTexture(GL_TEXTURE_2D, swapTexture.pTexture->TexId);
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, size.w, size.h, 0, GL_RGBA, GL_UNSIGNED_BYTE, 0);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+        SwapTextures.PushBack(swapTexture);
+
+        ovrGLTexture* tex = (ovrGLTexture*)&textureSet->Textures[i];
+        tex->OGL.Header.API            = ovrRenderAPI_OpenGL;
+        tex->OGL.Header.TextureSize    = size;
+        tex->OGL.Header.RenderViewport = Recti(size);
+        tex->OGL.TexId                 = swapTexture.pTexture->TexId;
+    }
+    glBindTexture(GL_TEXTURE_2D, (GLuint)boundTexture);
+
+    if (!created)
+        SwapTextures.Resize(firstTexture);
+    return created;
+}
+
+void DistortionRenderer::DestroySwapTextureSet(const ovrSwapTextureSet* textureSet)
+{
+    for (UPInt i = SwapTextures.GetSize(); i > 0; i--)
+    {
+        if (SwapTextures[i - 1].pSet != textureSet)
+            continue;
+        for (int eyeNum = 0; eyeNum < 2; eyeNum++)
+        {
+            if (pSubmittedEyeTextures[eyeNum] == SwapTextures[i - 1].pTexture)
+                pSubmittedEyeTextures[eyeNum] = pEyeTextures[eyeNum];
+        }
+        SwapTextures.RemoveAt(i - 1);
+    }
+}
+
+Texture* DistortionRenderer::findSwapTexture(GLuint texId) const
+{
+    if (!texId)
+        return 0;
+    for (UPInt i = 0; i < SwapTextures.GetSize(); i++)
+    {
+        if (SwapTextures[i].pTexture->TexId == texId)
+            return SwapTextures[i].pTexture;
+    }
+    return 0;
+}
+
+void DistortionRenderer::SubmitEyeDepth(int eyeId, ovrTexture* depthTexture, const ovrMatrix4f& projection)
+{
+    if (!(DistortionCaps & ovrDistortionCap_PositionalTimeWarp))
+        return;
+
+    // The shader gets view z from window depth as M23 / (ndc * M32 - M22).
+    const ovrGLTexture* tex = (const ovrGLTexture*)depthTexture;
+    eachEye[eyeId].depthTexture       = tex->OGL.TexId;
+    eachEye[eyeId].DepthProjection[0] = projection.M[2][2];
+    eachEye[eyeId].DepthProjection[1] = projection.M[2][3];
+    eachEye[eyeId].DepthProjection[2] = projection.M[3][2];
+}
+
 void DistortionRenderer::EndFrame(bool swapBuffers,
                                   unsigned char* latencyTesterDrawColor, unsigned char* latencyTester2DrawColor)
 {
-    if (!TimeManager.NeedDistortionTimeMeasurement())
+    OVR_TRACE_SCOPE("DistortionRenderer::EndFrame");
+    GraphicsState* glState = (GraphicsState*)GfxState.GetPtr();
+
+    if (AsyncThread)
+    {
+        // The timewarp thread draws and presents the frame.
+        submitAsyncFrame(latencyTesterDrawColor, latencyTester2DrawColor);
+        return;
+    }
+
+    EyeDrawParams eyes[2];
+    getEyeDrawParams(eyes);
+
+    if (glState->SupportsTimerQueries)
+    {
+        // Time the draw on the GPU, without waiting for it; the result is read
+        // when the same queries come round again.
+		if (RState.DistortionCaps & ovrDistortionCap_TimeWarp)
+		{
+			FlushGpuAndWaitTillTime(TimeManager.GetFrameTiming().TimewarpPointTime);
+		}
+
+        // Results of earlier frames, if the GPU has got to them.
+        for (int slot = 0; slot < TimerSlots; slot++)
+            readDistortionTimer(slot);
+
+        bool measure = TimeManager.NeedDistortionTimeMeasurement();
+        if (measure)
+            beginDistortionTimer();
+
+        renderDistortion(pSubmittedEyeTextures[0], pSubmittedEyeTextures[1], eyes);
+
+        if (measure)
+            endDistortionTimer();
+    }
+    else if (!TimeManager.NeedDistortionTimeMeasurement())
     {
 		if (RState.DistortionCaps & ovrDistortionCap_TimeWarp)
 		{
@@ -195,7 +482,7 @@ void DistortionRenderer::EndFrame(bool swapBuffers,
 			FlushGpuAndWaitTillTime(TimeManager.GetFrameTiming().TimewarpPointTime);
 		}
 
-        renderDistortion(pEyeTextures[0], pEyeTextures[1]);
+        renderDistortion(pSubmittedEyeTextures[0], pSubmittedEyeTextures[1], eyes);
     }
     else
     {
@@ -204,7 +491,7 @@ void DistortionRenderer::EndFrame(bool swapBuffers,
         WaitUntilGpuIdle();
         double  distortionStartTime = ovr_GetTimeInSeconds();
 
-        renderDistortion(pEyeTextures[0], pEyeTextures[1]);
+        renderDistortion(pSubmittedEyeTextures[0], pSubmittedEyeTextures[1], eyes);
 
         WaitUntilGpuIdle();
         TimeManager.AddDistortionTimeMeasurement(ovr_GetTimeInSeconds() - distortionStartTime);
@@ -223,8 +510,11 @@ void DistortionRenderer::EndFrame(bool swapBuffers,
     {
 		bool useVsync = ((RState.EnabledHmdCaps & ovrHmdCap_NoVSync) == 0);
 		int swapInterval = (useVsync) ? 1 : 0;
+        // With cached state, the interval is only read back when it is to change.
+        bool setSwapInterval = !glState->Cached || glState->SwapInterval != swapInterval;
+        glState->SwapInterval = swapInterval;
 #if defined(OVR_OS_WIN32)
-		if (wglGetSwapIntervalEXT() != swapInterval)
+		if (setSwapInterval && wglGetSwapIntervalEXT() != swapInterval)
             wglSwapIntervalEXT(swapInterval);
 
         HDC dc = GetDC(RParams.Window);
@@ -234,16 +524,19 @@ void DistortionRenderer::EndFrame(bool swapBuffers,
         OVR_UNUSED(success);
 #elif defined(OVR_OS_MAC)
         CGLContextObj context = CGLGetCurrentContext();
-        GLint currentSwapInterval = 0;
-        CGLGetParameter(context, kCGLCPSwapInterval, &currentSwapInterval);
-        if (currentSwapInterval != swapInterval)
-            CGLSetParameter(context, kCGLCPSwapInterval, &swapInterval);
+        if (setSwapInterval)
+        {
+            GLint currentSwapInterval = 0;
+            CGLGetParameter(context, kCGLCPSwapInterval, &currentSwapInterval);
+            if (currentSwapInterval != swapInterval)
+                CGLSetParameter(context, kCGLCPSwapInterval, &swapInterval);
+        }
         
         CGLFlushDrawable(context);
 #elif defined(OVR_OS_LINUX)
         static const char* extensions = glXQueryExtensionsString(RParams.Disp, 0);
         static bool supportsVSync = (extensions != NULL && strstr(extensions, "GLX_EXT_swap_control"));
-        if (supportsVSync)
+        if (supportsVSync && setSwapInterval)
         {
             GLuint currentSwapInterval = 0;
             glXQueryDrawable(RParams.Disp, RParams.Win, GLX_SWAP_INTERVAL_EXT, &currentSwapInterval);
@@ -251,44 +544,146 @@ void DistortionRenderer::EndFrame(bool swapBuffers,
                 glXSwapIntervalEXT(RParams.Disp, RParams.Win, swapInterval);
         }
 
+        OVR_TRACE_SCOPE("glXSwapBuffers");
         glXSwapBuffers(RParams.Disp, RParams.Win);
 #endif
+        // The swap may not be done yet, so only a vsync timestamp tells anything.
+        reportPresentTime(0.0);
+    }
+}
+
+double DistortionRenderer::reportPresentTime(double presentTime)
+{
+#if defined(OVR_OS_LINUX)
+    if (SupportsSyncValues)
+    {
+        int64_t ust = 0, msc = 0, sbc = 0;
+        if (glXGetSyncValuesOML(RParams.Disp, RParams.Win, &ust, &msc, &sbc) && ust > 0)
+        {
+            // UST is CLOCK_MONOTONIC microseconds with the usual drivers, like
+            // ovr_GetTimeInSeconds; a driver with a clock of its own is ignored.
+            double vsyncTime = (double)ust * 0.000001;
+            if (fabs(vsyncTime - ovr_GetTimeInSeconds()) < 1.0)
+            {
+                TimeManager.AddPresentTime(vsyncTime, (SInt64)msc);
+                return vsyncTime;
+            }
+            LogText("OVR::GL::DistortionRenderer - GLX_OML_sync_control timestamps aren't in CLOCK_MONOTONIC; not using them\n");
+            SupportsSyncValues = false;
+        }
     }
+#endif
+    if (presentTime > 0.0)
+        TimeManager.AddPresentTime(presentTime);
+    return presentTime;
 }
 
 void DistortionRenderer::WaitUntilGpuIdle()
 {
+	waitForGpu();
+}
+
+void DistortionRenderer::waitForGpu()
+{
+    GraphicsState* glState = (GraphicsState*)GfxState.GetPtr();
+
+    if (glState->SupportsSync)
+    {
+        // Unlike glFinish, this blocks only the calling thread, and doesn't
+        // drain the driver's queue of work for other contexts.
+        GLsync fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+        if (fence)
+        {
+            glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, GL_TIMEOUT_IGNORED);
+            glDeleteSync(fence);
+            return;
+        }
+    }
+
 	glFlush();
 	glFinish();
 }
 
+void DistortionRenderer::beginDistortionTimer()
+{
+    if (!TimerQueries[0][0])
+    {
+        for (int slot = 0; slot < TimerSlots; slot++)
+            glGenQueries(2, TimerQueries[slot]);
+    }
+
+    // The queries in this slot were issued TimerSlots frames ago; they're
+    // normally done by now, and reused only once read.
+    if (TimerQueryPending[TimerSlot])
+        return;
+
+    glQueryCounter(TimerQueries[TimerSlot][0], GL_TIMESTAMP);
+}
+
+void DistortionRenderer::endDistortionTimer()
+{
+    if (TimerQueryPending[TimerSlot])
+        return;
+
+    glQueryCounter(TimerQueries[TimerSlot][1], GL_TIMESTAMP);
+    TimerQueryPending[TimerSlot] = true;
+    TimerSlot = (TimerSlot + 1) % TimerSlots;
+}
+
+void DistortionRenderer::readDistortionTimer(int slot)
+{
+    if (!TimerQueryPending[slot])
+        return;
+
+    GLint available = 0;
+    glGetQueryObjectiv(TimerQueries[slot][1], GL_QUERY_RESULT_AVAILABLE, &available);
+    if (!available)
+        return;
+
+    GLuint64 start = 0, end = 0;
+    glGetQueryObjectui64v(TimerQueries[slot][0], GL_QUERY_RESULT, &start);
+    glGetQueryObjectui64v(TimerQueries[slot][1], GL_QUERY_RESULT, &end);
+    TimerQueryPending[slot] = false;
+
+    if (end > start)
+        TimeManager.AddDistortionTimeMeasurement((end - start) * 1e-9);
+}
+
 double DistortionRenderer::FlushGpuAndWaitTillTime(double absTime)
 {
+    OVR_TRACE_SCOPE("DistortionRenderer::FlushGpuAndWaitTillTime");
 	double       initialTime = ovr_GetTimeInSeconds();
 	if (initialTime >= absTime)
+    {
+        // Too late to wait; the GPU may be busier still.
+        if (absTime > 0.0)
+            TimeManager.AddTimewarpWait(absTime, initialTime, initialTime);
 		return 0.0;
+    }
 	
-	glFlush();
-	glFinish();
-
-	double newTime   = initialTime;
-	volatile int i;
+	waitForGpu();
+    double gpuIdleTime = ovr_GetTimeInSeconds();
 
-	while (newTime < absTime)
-	{
-		for (int j = 0; j < 50; j++)
-			i = 0;
+	Timer::WaitUntilSeconds(absTime);
 
-		newTime = ovr_GetTimeInSeconds();
-	}
+    double waitEndTime = ovr_GetTimeInSeconds();
+    TimeManager.AddTimewarpWait(absTime, gpuIdleTime, waitEndTime);
 
 	// How long we waited
-	return newTime - initialTime;
+	return waitEndTime - initialTime;
 }
     
     
-DistortionRenderer::GraphicsState::GraphicsState()
+DistortionRenderer::GraphicsState::GraphicsState(bool cached)
+    : SavesTableTexture(false), SavesDepthTexture(false), Cached(cached), Validate(false), SwapInterval(-1)
 {
+    if (Cached)
+    {
+        const char* setting = getenv("OVR_GL_VALIDATE_STATE");
+        Validate = setting && !strcmp(setting, "1");
+    }
+    memset(&Saved, 0, sizeof(Saved));
+
     const char* glVersionString = (const char*)glGetString(GL_VERSION);
     OVR_DEBUG_LOG(("GL_VERSION STRING: %s", (const char*)glVersionString));
     char prefix[64];
@@ -325,6 +720,27 @@ DistortionRenderer::GraphicsState::GraphicsState()
         const char* extensions = (const char*)glGetString(GL_EXTENSIONS);
         SupportsVao = (strstr("GL_ARB_vertex_array_object", extensions) != NULL);
     }
+
+    SupportsUniformBuffers = GlMajorVersion > 3 || (GlMajorVersion == 3 && GlMinorVersion >= 1);
+
+    // Fences are core in GL 3.2, timestamp queries in GL 3.3.
+    const char* extensions = (GlMajorVersion < 3 || (GlMajorVersion == 3 && GlMinorVersion < 3)) ?
+                             (const char*)glGetString(GL_EXTENSIONS) : NULL;
+    SupportsSync = GlMajorVersion > 3 || (GlMajorVersion == 3 && GlMinorVersion >= 2) ||
+                   (extensions && strstr(extensions, "GL_ARB_sync") != NULL);
+    SupportsTimerQueries = GlMajorVersion > 3 || (GlMajorVersion == 3 && GlMinorVersion >= 3) ||
+                           (extensions && strstr(extensions, "GL_ARB_timer_query") != NULL);
+    SupportsBufferStorage = GlMajorVersion > 4 || (GlMajorVersion == 4 && GlMinorVersion >= 4) ||
+                            (extensions && strstr(extensions, "GL_ARB_buffer_storage") != NULL);
+
+#if !defined(OVR_OS_MAC)
+    SupportsSync         = SupportsSync && glFenceSync && glClientWaitSync && glDeleteSync;
+    SupportsTimerQueries = SupportsTimerQueries && glGenQueries && glQueryCounter &&
+                           glGetQueryObjectiv && glGetQueryObjectui64v;
+    SupportsBufferStorage = SupportsBufferStorage && glBufferStorage && glMapBufferRange;
+#else
+    SupportsBufferStorage = false;
+#endif
 }
     
     
@@ -337,25 +753,59 @@ void DistortionRenderer::GraphicsState::ApplyBool(GLenum Name, GLint Value)
 }
     
     
-void DistortionRenderer::GraphicsState::Save()
+void DistortionRenderer::GraphicsState::query(Values* values) const
 {
-    glGetIntegerv(GL_VIEWPORT, Viewport);
-    glGetFloatv(GL_COLOR_CLEAR_VALUE, ClearColor);
-    glGetIntegerv(GL_DEPTH_TEST, &DepthTest);
-    glGetIntegerv(GL_CULL_FACE, &CullFace);
-    glGetIntegerv(GL_CURRENT_PROGRAM, &Program);
-    glGetIntegerv(GL_ACTIVE_TEXTURE, &ActiveTexture);
-    glGetIntegerv(GL_TEXTURE_BINDING_2D, &TextureBinding);
-    glGetIntegerv(GL_VERTEX_ARRAY_BINDING, &VertexArray);
-    glGetIntegerv(GL_FRAMEBUFFER_BINDING, &FrameBufferBinding);
-    glGetIntegerv(GL_BLEND, &Blend);
-    glGetIntegerv(GL_COLOR_WRITEMASK, ColorWritemask);
-    glGetIntegerv(GL_DITHER, &Dither);
-    glGetIntegerv(GL_RASTERIZER_DISCARD, &RasterizerDiscard);
+    glGetIntegerv(GL_VIEWPORT, values->Viewport);
+    glGetFloatv(GL_COLOR_CLEAR_VALUE, values->ClearColor);
+    glGetIntegerv(GL_DEPTH_TEST, &values->DepthTest);
+    glGetIntegerv(GL_CULL_FACE, &values->CullFace);
+    glGetIntegerv(GL_CURRENT_PROGRAM, &values->Program);
+    glGetIntegerv(GL_ACTIVE_TEXTURE, &values->ActiveTexture);
+    glGetIntegerv(GL_TEXTURE_BINDING_2D, &values->TextureBinding);
+    if (SavesTableTexture)
+    {
+        glActiveTexture(GL_TEXTURE1);
+        glGetIntegerv(GL_TEXTURE_BINDING_2D, &values->TableTextureBinding);
+        glActiveTexture(values->ActiveTexture);
+    }
+    if (SavesDepthTexture)
+    {
+        glActiveTexture(GL_TEXTURE2);
+        glGetIntegerv(GL_TEXTURE_BINDING_2D, &values->DepthTextureBinding);
+        glActiveTexture(values->ActiveTexture);
+    }
+    glGetIntegerv(GL_VERTEX_ARRAY_BINDING, &values->VertexArray);
+    glGetIntegerv(GL_FRAMEBUFFER_BINDING, &values->FrameBufferBinding);
+    if (SupportsUniformBuffers)
+        glGetIntegerv(GL_UNIFORM_BUFFER_BINDING, &values->UniformBufferBinding);
+    glGetIntegerv(GL_BLEND, &values->Blend);
+    glGetIntegerv(GL_COLOR_WRITEMASK, values->ColorWritemask);
+    glGetIntegerv(GL_DITHER, &values->Dither);
+    glGetIntegerv(GL_RASTERIZER_DISCARD, &values->RasterizerDiscard);
     if (GlMajorVersion >= 3 && GlMajorVersion >= 2)
-        glGetIntegerv(GL_SAMPLE_MASK, &SampleMask);
-	glGetIntegerv(GL_SCISSOR_TEST, &ScissorTest);
+        glGetIntegerv(GL_SAMPLE_MASK, &values->SampleMask);
+	glGetIntegerv(GL_SCISSOR_TEST, &values->ScissorTest);
+}
+
+void DistortionRenderer::GraphicsState::Save()
+{
+    if (Cached && IsValid)
+    {
+        if (Validate)
+        {
+            Values current;
+            memset(&current, 0, sizeof(current));
+            query(&current);
+            if (memcmp(&current, &Saved, sizeof(Saved)) != 0)
+            {
+                LogError("OVR::GL::DistortionRenderer - graphics state differs from the cached state\n");
+                Saved = current;
+            }
+        }
+        return;
+    }
 
+    query(&Saved);
 	IsValid = true;
 }
     
@@ -366,83 +816,206 @@ void DistortionRenderer::GraphicsState::Restore()
 	if (!IsValid)
 		return;
 
-    glViewport(Viewport[0], Viewport[1], Viewport[2], Viewport[3]);
-    glClearColor(ClearColor[0], ClearColor[1], ClearColor[2], ClearColor[3]);
+    glViewport(Saved.Viewport[0], Saved.Viewport[1], Saved.Viewport[2], Saved.Viewport[3]);
+    glClearColor(Saved.ClearColor[0], Saved.ClearColor[1], Saved.ClearColor[2], Saved.ClearColor[3]);
     
-    ApplyBool(GL_DEPTH_TEST, DepthTest);
-    ApplyBool(GL_CULL_FACE, CullFace);
+    ApplyBool(GL_DEPTH_TEST, Saved.DepthTest);
+    ApplyBool(GL_CULL_FACE, Saved.CullFace);
     
-    glUseProgram(Program);
-    glActiveTexture(ActiveTexture);
-    glBindTexture(GL_TEXTURE_2D, TextureBinding);
+    glUseProgram(Saved.Program);
+    if (SavesTableTexture)
+    {
+        glActiveTexture(GL_TEXTURE1);
+        glBindTexture(GL_TEXTURE_2D, Saved.TableTextureBinding);
+    }
+    if (SavesDepthTexture)
+    {
+        glActiveTexture(GL_TEXTURE2);
+        glBindTexture(GL_TEXTURE_2D, Saved.DepthTextureBinding);
+    }
+    glActiveTexture(Saved.ActiveTexture);
+    glBindTexture(GL_TEXTURE_2D, Saved.TextureBinding);
     if (SupportsVao)
-        glBindVertexArray(VertexArray);
-    glBindFramebuffer(GL_FRAMEBUFFER, FrameBufferBinding);
+        glBindVertexArray(Saved.VertexArray);
+    glBindFramebuffer(GL_FRAMEBUFFER, Saved.FrameBufferBinding);
+    if (SupportsUniformBuffers)
+        glBindBuffer(GL_UNIFORM_BUFFER, Saved.UniformBufferBinding);
     
-    ApplyBool(GL_BLEND, Blend);
+    ApplyBool(GL_BLEND, Saved.Blend);
     
-	glColorMask((GLboolean)ColorWritemask[0], (GLboolean)ColorWritemask[1], (GLboolean)ColorWritemask[2], (GLboolean)ColorWritemask[3]);
-    ApplyBool(GL_DITHER, Dither);
-    ApplyBool(GL_RASTERIZER_DISCARD, RasterizerDiscard);
+	glColorMask((GLboolean)Saved.ColorWritemask[0], (GLboolean)Saved.ColorWritemask[1],
+                (GLboolean)Saved.ColorWritemask[2], (GLboolean)Saved.ColorWritemask[3]);
+    ApplyBool(GL_DITHER, Saved.Dither);
+    ApplyBool(GL_RASTERIZER_DISCARD, Saved.RasterizerDiscard);
     if (GlMajorVersion >= 3 && GlMajorVersion >= 2)
-        ApplyBool(GL_SAMPLE_MASK, SampleMask);
-    ApplyBool(GL_SCISSOR_TEST, ScissorTest);
+        ApplyBool(GL_SAMPLE_MASK, Saved.SampleMask);
+    ApplyBool(GL_SCISSOR_TEST, Saved.ScissorTest);
+}
+
+
+// Returns the layout of DistortionVertex, for writing distortion meshes.
+static DistortionMeshVertexLayout distortionVertexLayout()
+{
+    // Shade goes to the RGB of Col, and TimewarpLerp to its A.
+    DistortionMeshVertexLayout layout;
+    layout.Stride           = sizeof(DistortionVertex);
+    layout.ScreenPosNDC     = offsetof(DistortionVertex, Pos);
+    layout.TanEyeAnglesR    = offsetof(DistortionVertex, TexR);
+    layout.TanEyeAnglesG    = offsetof(DistortionVertex, TexG);
+    layout.TanEyeAnglesB    = offsetof(DistortionVertex, TexB);
+    layout.Shade            = offsetof(DistortionVertex, Col);
+    layout.ShadeBytes       = 3;
+    layout.TimewarpLerp     = offsetof(DistortionVertex, Col) + 3;
+    layout.TimewarpLerpByte = true;
+    layout.EyeIndex         = offsetof(DistortionVertex, EyeIndex);
+    return layout;
+}
+
+// Writes the meshes of eyeCount eyes from firstEye on, one after the other, into
+// vertices and indices; strips are joined as for BothEyesMeshIB.
+static void writeDistortionMeshes(const HMDRenderState& rstate, DistortionVertex* pVertices, UInt16* pIndices,
+                                  int firstEye, int eyeCount, int eyeVertexCount, int eyeIndexCount, bool isStrip)
+{
+    DistortionMeshVertexLayout layout     = distortionVertexLayout();
+    UInt16                     lastIndex  = 0;
+    int                        indexCount = 0;
+
+    for (int i = 0; i < eyeCount; i++)
+    {
+        const ovrEyeRenderDesc& eyeDesc   = rstate.EyeRenderDesc[firstEye + i];
+        int                     joinCount = (i > 0 && isStrip) ? (2 + (indexCount & 1)) : 0;
+        DistortionMeshWriteInfo info;
+
+        rstate.WriteDistortionMesh(pVertices + i * eyeVertexCount, layout,
+                                   pIndices + indexCount + joinCount, (UInt16)(i * eyeVertexCount), &info,
+                                   eyeDesc.Eye, eyeDesc.Fov, rstate.DistortionCaps);
+        for (int j = 0; j < joinCount; j++)
+            pIndices[indexCount + j] = (j == joinCount - 1) ? info.FirstIndex : lastIndex;
+
+        OVR_ASSERT(info.NumVertices == eyeVertexCount && info.NumIndices == eyeIndexCount);
+        lastIndex   = info.LastIndex;
+        indexCount += joinCount + eyeIndexCount;
+    }
+}
+
+// Returns the number of indices writeDistortionMeshes writes.
+static int distortionMeshesIndexCount(int eyeCount, int eyeIndexCount, bool isStrip)
+{
+    int indexCount = eyeIndexCount;
+    for (int i = 1; i < eyeCount; i++)
+        indexCount += (isStrip ? (2 + (indexCount & 1)) : 0) + eyeIndexCount;
+    return indexCount;
 }
 
+// Sizes vb and ib and writes the meshes of writeDistortionMeshes into them, through
+// mappings of the buffers, so that the meshes are only written once; drivers that
+// can't map them get them from memory instead. Returns false if out of memory.
+static bool writeDistortionMeshBuffers(const HMDRenderState& rstate, Buffer* vb, Buffer* ib,
+                                       int firstEye, int eyeCount, int eyeVertexCount, int eyeIndexCount, bool isStrip)
+{
+    size_t vbSize = sizeof(DistortionVertex) * eyeVertexCount * eyeCount;
+    size_t ibSize = sizeof(UInt16) * distortionMeshesIndexCount(eyeCount, eyeIndexCount, isStrip);
+
+    vb->Data(Buffer_Vertex | Buffer_ReadOnly, NULL, vbSize);
+    ib->Data(Buffer_Index | Buffer_ReadOnly, NULL, ibSize);
+
+    DistortionVertex* pVertices = (DistortionVertex*)vb->Map(0, vbSize, Map_Discard);
+    UInt16*           pIndices  = (UInt16*)ib->Map(0, ibSize, Map_Discard);
+    if (pVertices && pIndices)
+    {
+        writeDistortionMeshes(rstate, pVertices, pIndices, firstEye, eyeCount, eyeVertexCount, eyeIndexCount, isStrip);
+        // Unmapping fails if the buffer contents were lost meanwhile.
+        bool vbUnmapped = vb->Unmap(pVertices);
+        bool ibUnmapped = ib->Unmap(pIndices);
+        if (vbUnmapped && ibUnmapped)
+            return true;
+    }
+    else
+    {
+        if (pVertices)
+            vb->Unmap(pVertices);
+        if (pIndices)
+            ib->Unmap(pIndices);
+    }
+
+    pVertices = (DistortionVertex*)OVR_SUBSYSTEM_ALLOC(AllocSubsystem_DistortionMesh, vbSize);
+    pIndices  = (UInt16*)OVR_SUBSYSTEM_ALLOC(AllocSubsystem_DistortionMesh, ibSize);
+    bool written = pVertices && pIndices;
+    if (written)
+    {
+        writeDistortionMeshes(rstate, pVertices, pIndices, firstEye, eyeCount, eyeVertexCount, eyeIndexCount, isStrip);
+        vb->Data(Buffer_Vertex | Buffer_ReadOnly, pVertices, vbSize);
+        ib->Data(Buffer_Index | Buffer_ReadOnly, pIndices, ibSize);
+    }
+    OVR_SUBSYSTEM_FREE(AllocSubsystem_DistortionMesh, pIndices);
+    OVR_SUBSYSTEM_FREE(AllocSubsystem_DistortionMesh, pVertices);
+    return written;
+}
 
 void DistortionRenderer::initBuffersAndShaders()
 {
-    for ( int eyeNum = 0; eyeNum < 2; eyeNum++ )
+    if (DistortionCaps & ovrDistortionCap_PixelDistortion)
     {
-        // Allocate & generate distortion mesh vertices.
-        ovrDistortionMesh meshData;
+        initPixelDistortion();
+        initShaders();
+        return;
+    }
 
-//        double startT = ovr_GetTimeInSeconds();
+    // The meshes are written straight into the vertex and index buffers. The merged
+    // mesh has the right eye's vertices after the left's. Its strips are joined by
+    // repeating the last and first indices, keeping the right eye's triangles on an
+    // even index so that their winding is unchanged. 16-bit indices limit it to 64K
+    // vertices; bigger meshes are drawn an eye at a time.
+    bool     isStrip       = (RState.DistortionCaps & ovrDistortionCap_TriangleStrip) != 0;
+    int      eyeVertexCount, eyeIndexCount;
+    RState.GetDistortionMeshSize(&eyeVertexCount, &eyeIndexCount, RState.DistortionCaps);
 
-        if (!ovrHmd_CreateDistortionMesh( HMD,
-                                          RState.EyeRenderDesc[eyeNum].Eye,
-                                          RState.EyeRenderDesc[eyeNum].Fov,
-                                          RState.DistortionCaps,
-                                          &meshData) )
+    bool     eyeWritten[2] = { false, false };
+    for ( int eyeNum = 0; eyeNum < 2; eyeNum++ )
+    {
+        DistortionMeshVBs[eyeNum] = *new Buffer(&RParams);
+        DistortionMeshIBs[eyeNum] = *new Buffer(&RParams);
+        eyeWritten[eyeNum] = writeDistortionMeshBuffers(RState, DistortionMeshVBs[eyeNum], DistortionMeshIBs[eyeNum],
+                                                        eyeNum, 1, eyeVertexCount, eyeIndexCount, isStrip);
+        if (!eyeWritten[eyeNum])
         {
             OVR_ASSERT(false);
-            continue;
+            DistortionMeshVBs[eyeNum].Clear();
+            DistortionMeshIBs[eyeNum].Clear();
         }
+    }
 
-        // Now parse the vertex data and create a render ready vertex buffer from it
-        DistortionVertex *   pVBVerts    = (DistortionVertex*)OVR_ALLOC ( sizeof(DistortionVertex) * meshData.VertexCount );
-        DistortionVertex *   pCurVBVert  = pVBVerts;
-        ovrDistortionVertex* pCurOvrVert = meshData.pVertexData;
-
-        for ( unsigned vertNum = 0; vertNum < meshData.VertexCount; vertNum++ )
+    if (eyeWritten[0] && eyeWritten[1] && eyeVertexCount * 2 <= 0x10000)
+    {
+        BothEyesMeshVB = *new Buffer(&RParams);
+        BothEyesMeshIB = *new Buffer(&RParams);
+        if (!writeDistortionMeshBuffers(RState, BothEyesMeshVB, BothEyesMeshIB,
+                                        0, 2, eyeVertexCount, eyeIndexCount, isStrip))
         {
-            pCurVBVert->Pos.x = pCurOvrVert->Pos.x;
-            pCurVBVert->Pos.y = pCurOvrVert->Pos.y;
-            pCurVBVert->TexR  = (*(Vector2f*)&pCurOvrVert->TexR);
-            pCurVBVert->TexG  = (*(Vector2f*)&pCurOvrVert->TexG);
-            pCurVBVert->TexB  = (*(Vector2f*)&pCurOvrVert->TexB);
-            // Convert [0.0f,1.0f] to [0,255]
-            pCurVBVert->Col.R = (OVR::UByte)( pCurOvrVert->VignetteFactor * 255.99f );
-            pCurVBVert->Col.G = pCurVBVert->Col.R;
-            pCurVBVert->Col.B = pCurVBVert->Col.R;
-            pCurVBVert->Col.A = (OVR::UByte)( pCurOvrVert->TimeWarpFactor * 255.99f );;
-            pCurOvrVert++;
-            pCurVBVert++;
+            BothEyesMeshVB.Clear();
+            BothEyesMeshIB.Clear();
         }
-
-        DistortionMeshVBs[eyeNum] = *new Buffer(&RParams);
-        DistortionMeshVBs[eyeNum]->Data ( Buffer_Vertex | Buffer_ReadOnly, pVBVerts, sizeof(DistortionVertex) * meshData.VertexCount );
-        DistortionMeshIBs[eyeNum] = *new Buffer(&RParams);
-        DistortionMeshIBs[eyeNum]->Data ( Buffer_Index | Buffer_ReadOnly, meshData.pIndexData, ( sizeof(SInt16) * meshData.IndexCount ) );
-
-        OVR_FREE ( pVBVerts );
-        ovrHmd_DestroyDistortionMesh( &meshData );
     }
 
     initShaders();
 }
 
-void DistortionRenderer::renderDistortion(Texture* leftEyeTexture, Texture* rightEyeTexture)
+void DistortionRenderer::getEyeDrawParams(EyeDrawParams eyes[2]) const
+{
+    for (int eyeNum = 0; eyeNum < 2; eyeNum++)
+    {
+        eyes[eyeNum].UVScaleOffset[0]    = eachEye[eyeNum].UVScaleOffset[0];
+        eyes[eyeNum].UVScaleOffset[1]    = eachEye[eyeNum].UVScaleOffset[1];
+        eyes[eyeNum].RenderPose          = RState.EyeRenderPoses[eyeNum];
+        eyes[eyeNum].TimewarpStartEnd[0] = 0.0;
+        eyes[eyeNum].TimewarpStartEnd[1] = 0.0;
+        eyes[eyeNum].DepthTexId          = eachEye[eyeNum].depthTexture;
+        memcpy(eyes[eyeNum].DepthProjection, eachEye[eyeNum].DepthProjection, sizeof(eyes[eyeNum].DepthProjection));
+    }
+}
+
+void DistortionRenderer::renderDistortion(Texture* leftEyeTexture, Texture* rightEyeTexture,
+                                          const EyeDrawParams eyes[2])
 {
     GraphicsState* glState = (GraphicsState*)GfxState.GetPtr();
 
@@ -468,51 +1041,369 @@ void DistortionRenderer::renderDistortion(Texture* leftEyeTexture, Texture* righ
 
     glClear(GL_COLOR_BUFFER_BIT);
 
+    if (LatchedPoseBuffer)
+        glBindBufferBase(GL_UNIFORM_BUFFER, LatchedPoseBinding, LatchedPoseBuffer->GetBuffer());
+
+    if (DistortionCaps & ovrDistortionCap_PixelDistortion)
+    {
+        renderPixelDistortion(leftEyeTexture, rightEyeTexture, eyes);
+        return;
+    }
+
+    // Eyes rendered side by side into one texture need a single draw.
+    if (BothEyesMeshVB && BothEyesDistortionShader &&
+        leftEyeTexture->TexId == rightEyeTexture->TexId)
+    {
+        renderDistortionBothEyes(leftEyeTexture, eyes);
+        return;
+    }
+
     for (int eyeNum = 0; eyeNum < 2; eyeNum++)
     {        
 		ShaderFill distortionShaderFill(DistortionShader);
         distortionShaderFill.SetTexture(0, eyeNum == 0 ? leftEyeTexture : rightEyeTexture);
 
-		DistortionShader->SetUniform2f("EyeToSourceUVScale",  eachEye[eyeNum].UVScaleOffset[0].x, eachEye[eyeNum].UVScaleOffset[0].y);
-		DistortionShader->SetUniform2f("EyeToSourceUVOffset", eachEye[eyeNum].UVScaleOffset[1].x, eachEye[eyeNum].UVScaleOffset[1].y);
+        PrimitiveType meshPrimitive = (DistortionCaps & ovrDistortionCap_TriangleStrip) ?
+                                      Prim_TriangleStrip : Prim_Triangles;
+
+		DistortionShader->SetUniform(DistortionShaderUniforms.EyeToSourceUVScale,  2, &eyes[eyeNum].UVScaleOffset[0].x);
+		DistortionShader->SetUniform(DistortionShaderUniforms.EyeToSourceUVOffset, 2, &eyes[eyeNum].UVScaleOffset[1].x);
         
 		if (DistortionCaps & ovrDistortionCap_TimeWarp)
 		{                       
-            ovrMatrix4f timeWarpMatrices[2];            
-            ovrHmd_GetEyeTimewarpMatrices(HMD, (ovrEyeType)eyeNum,
-                                          RState.EyeRenderPoses[eyeNum], timeWarpMatrices);
+            float rotationStart[16], rotationEnd[16];
+            int   rotationFloats = getTimewarpRotations(eyeNum, eyes[eyeNum], rotationStart, rotationEnd);
 
-            // Feed identity like matrices in until we get proper timewarp calculation going on
-			DistortionShader->SetUniform4x4f("EyeRotationStart", Matrix4f(timeWarpMatrices[0]).Transposed());
-			DistortionShader->SetUniform4x4f("EyeRotationEnd",   Matrix4f(timeWarpMatrices[1]).Transposed());
+			DistortionShader->SetUniform(DistortionShaderUniforms.EyeRotationStart, rotationFloats, rotationStart);
+			DistortionShader->SetUniform(DistortionShaderUniforms.EyeRotationEnd,   rotationFloats, rotationEnd);
+            if (TimewarpSampled)
+                setTimewarpSamples(eyeNum, eyes[eyeNum]);
 
             renderPrimitives(&distortionShaderFill, DistortionMeshVBs[eyeNum], DistortionMeshIBs[eyeNum],
-                            0, (int)DistortionMeshIBs[eyeNum]->GetSize()/2, Prim_Triangles, &DistortionMeshVAOs[eyeNum], true);
+                            0, (int)DistortionMeshIBs[eyeNum]->GetSize()/2, meshPrimitive, &DistortionMeshVAOs[eyeNum], true);
 		}
         else
         {
             renderPrimitives(&distortionShaderFill, DistortionMeshVBs[eyeNum], DistortionMeshIBs[eyeNum],
-                            0, (int)DistortionMeshIBs[eyeNum]->GetSize()/2, Prim_Triangles, &DistortionMeshVAOs[eyeNum], true);
+                            0, (int)DistortionMeshIBs[eyeNum]->GetSize()/2, meshPrimitive, &DistortionMeshVAOs[eyeNum], true);
         }
     }
 }
 
-void DistortionRenderer::createDrawQuad()
+void DistortionRenderer::renderDistortionBothEyes(Texture* eyeTexture, const EyeDrawParams eyes[2])
 {
-    const int numQuadVerts = 4;
-    LatencyTesterQuadVB = *new Buffer(&RParams);
-    if(!LatencyTesterQuadVB)
+    ShaderFill distortionShaderFill(BothEyesDistortionShader);
+    distortionShaderFill.SetTexture(0, eyeTexture);
+
+    PrimitiveType meshPrimitive = (DistortionCaps & ovrDistortionCap_TriangleStrip) ?
+                                  Prim_TriangleStrip : Prim_Triangles;
+
+    // Rotations of both eyes, one after the other.
+    float rotationStarts[32], rotationEnds[32];
+    int   rotationFloats = 0;
+    if (DistortionCaps & ovrDistortionCap_TimeWarp)
     {
-        return;
+        for (int eyeNum = 0; eyeNum < 2; eyeNum++)
+        {
+            float rotationStart[16], rotationEnd[16];
+            rotationFloats = getTimewarpRotations(eyeNum, eyes[eyeNum], rotationStart, rotationEnd);
+            memcpy(rotationStarts + rotationFloats * eyeNum, rotationStart, rotationFloats * sizeof(float));
+            memcpy(rotationEnds   + rotationFloats * eyeNum, rotationEnd,   rotationFloats * sizeof(float));
+        }
     }
 
-    LatencyTesterQuadVB->Data(Buffer_Vertex, NULL, numQuadVerts * sizeof(LatencyVertex));
-    LatencyVertex* vertices = (LatencyVertex*)LatencyTesterQuadVB->Map(0, numQuadVerts * sizeof(LatencyVertex), Map_Discard);
-    if(!vertices)
+    if (EyeUniformBuffer)
     {
-        OVR_ASSERT(false); // failed to lock vertex buffer
-        return;
-    }
+        // DistortionEyes block, std140: a vec4 of UV scale and offset per eye, then
+        // the start and end rotations of both eyes.
+        float blockData[DistortionEyesBlockFloats];
+        memset(blockData, 0, sizeof(blockData));
+        for (int eyeNum = 0; eyeNum < 2; eyeNum++)
+        {
+            float* uv = blockData + 4 * eyeNum;
+            uv[0] = eyes[eyeNum].UVScaleOffset[0].x;
+            uv[1] = eyes[eyeNum].UVScaleOffset[0].y;
+            uv[2] = eyes[eyeNum].UVScaleOffset[1].x;
+            uv[3] = eyes[eyeNum].UVScaleOffset[1].y;
+
+        }
+        memcpy(blockData + 8,                      rotationStarts, 2 * rotationFloats * sizeof(float));
+        memcpy(blockData + 8 + 2 * rotationFloats, rotationEnds,   2 * rotationFloats * sizeof(float));
+
+        EyeUniformBuffer->Data(Buffer_Uniform, blockData, sizeof(blockData));
+        glBindBufferBase(GL_UNIFORM_BUFFER, EyeUniformBinding, EyeUniformBuffer->GetBuffer());
+    }
+    else
+    {
+        // Parameters of both eyes go up in one call per uniform array.
+        const float uvScales[]  = { eyes[0].UVScaleOffset[0].x, eyes[0].UVScaleOffset[0].y,
+                                    eyes[1].UVScaleOffset[0].x, eyes[1].UVScaleOffset[0].y };
+        const float uvOffsets[] = { eyes[0].UVScaleOffset[1].x, eyes[0].UVScaleOffset[1].y,
+                                    eyes[1].UVScaleOffset[1].x, eyes[1].UVScaleOffset[1].y };
+        BothEyesDistortionShader->SetUniform(BothEyesShaderUniforms.EyeToSourceUVScale,  4, uvScales);
+        BothEyesDistortionShader->SetUniform(BothEyesShaderUniforms.EyeToSourceUVOffset, 4, uvOffsets);
+
+        if (DistortionCaps & ovrDistortionCap_TimeWarp)
+        {
+            BothEyesDistortionShader->SetUniform(BothEyesShaderUniforms.EyeRotationStart, 2 * rotationFloats, rotationStarts);
+            BothEyesDistortionShader->SetUniform(BothEyesShaderUniforms.EyeRotationEnd,   2 * rotationFloats, rotationEnds);
+        }
+    }
+
+    renderPrimitives(&distortionShaderFill, BothEyesMeshVB, BothEyesMeshIB,
+                     0, (int)BothEyesMeshIB->GetSize()/2, meshPrimitive, &BothEyesMeshVAO, true);
+}
+
+// Gets the timewarp start and end rotations of an eye as the shaders take them:
+// quaternions with ovrDistortionCap_TimeWarpQuaternions, which saves building the
+// matrices, and otherwise row-major matrices, which GL transposes on upload.
+// Returns the number of floats in each.
+int DistortionRenderer::getTimewarpRotations(int eyeNum, const EyeDrawParams& eye, float* start, float* end)
+{
+    // With latched poses, the shaders compose the inverse of the rendered
+    // orientation with the latched ones, in the basis of the mesh.
+    if (LatchedPoses)
+    {
+        Quatf quatFromEye = eye.RenderPose.Orientation;
+        quatFromEye.Invert();
+        Quatf flipped(quatFromEye.x, -quatFromEye.y, -quatFromEye.z, quatFromEye.w);
+        memcpy(start, &flipped.x, 4 * sizeof(float));
+        memcpy(end,   &flipped.x, 4 * sizeof(float));
+        return 4;
+    }
+
+    // The timewarp thread predicts for the vsync it draws for.
+    if (eye.TimewarpStartEnd[0] != 0.0)
+    {
+        Quatf timeWarpQuats[2];
+        TimeManager.GetTimewarpOrientations(HMD, eye.RenderPose, eye.TimewarpStartEnd, timeWarpQuats);
+        if (DistortionCaps & ovrDistortionCap_TimeWarpQuaternions)
+        {
+            memcpy(start, &timeWarpQuats[0].x, 4 * sizeof(float));
+            memcpy(end,   &timeWarpQuats[1].x, 4 * sizeof(float));
+            return 4;
+        }
+
+        Matrix4f timeWarpMatrices[2] = { Matrix4f(timeWarpQuats[0]), Matrix4f(timeWarpQuats[1]) };
+        memcpy(start, timeWarpMatrices[0].M, 16 * sizeof(float));
+        memcpy(end,   timeWarpMatrices[1].M, 16 * sizeof(float));
+        return 16;
+    }
+
+    if (DistortionCaps & ovrDistortionCap_TimeWarpQuaternions)
+    {
+        Quatf timeWarpQuats[2];
+        TimeManager.GetTimewarpOrientations(HMD, (ovrEyeType)eyeNum, eye.RenderPose, timeWarpQuats);
+        memcpy(start, &timeWarpQuats[0].x, 4 * sizeof(float));
+        memcpy(end,   &timeWarpQuats[1].x, 4 * sizeof(float));
+        return 4;
+    }
+
+    ovrMatrix4f timeWarpMatrices[2];
+    ovrHmd_GetEyeTimewarpMatrices(HMD, (ovrEyeType)eyeNum, eye.RenderPose, timeWarpMatrices);
+    memcpy(start, timeWarpMatrices[0].M, 16 * sizeof(float));
+    memcpy(end,   timeWarpMatrices[1].M, 16 * sizeof(float));
+    return 16;
+}
+
+Texture* DistortionRenderer::setPositionalTimewarp(int eyeNum, const EyeDrawParams& eye)
+{
+    // An eye submitted without depth is at a constant depth of 1, with no
+    // translation, which leaves the rotation alone; the table stands in for
+    // the depth texture so that the sampler has something to read.
+    if (!eye.DepthTexId)
+    {
+        const float noDepthProjection[3] = { -1.0f, 1.0f, 0.0f };
+        const float noTranslation[3]     = { 0.0f, 0.0f, 0.0f };
+        DistortionShader->SetUniform(PixelShaderUniforms.DepthProjection,     3, noDepthProjection);
+        DistortionShader->SetUniform(PixelShaderUniforms.TimewarpTranslation, 3, noTranslation);
+        return DistortionTable;
+    }
+
+    double timewarpStartEnd[2] = { eye.TimewarpStartEnd[0], eye.TimewarpStartEnd[1] };
+    if (timewarpStartEnd[0] == 0.0)
+        TimeManager.GetTimewarpPredictions((ovrEyeType)eyeNum, timewarpStartEnd);
+
+    // ViewAdjust moves the view the opposite way to the eye.
+    Vector3f eyeOffset   = -Vector3f(RState.EyeRenderDesc[eyeNum].ViewAdjust);
+    Vector3f translation = TimeManager.GetTimewarpTranslation(HMD, eye.RenderPose, timewarpStartEnd, eyeOffset);
+    DistortionShader->SetUniform(PixelShaderUniforms.DepthProjection,     3, eye.DepthProjection);
+    DistortionShader->SetUniform(PixelShaderUniforms.TimewarpTranslation, 3, &translation.x);
+
+    if (!EyeDepthTexture)
+        EyeDepthTexture = *new Texture(&RParams, 0, 0);
+    EyeDepthTexture->UpdatePlaceholderTexture(eye.DepthTexId, Sizei(0));
+    return EyeDepthTexture;
+}
+
+void DistortionRenderer::setTimewarpSamples(int eyeNum, const EyeDrawParams& eye)
+{
+    Quatf samples[TimewarpSampleCount];
+    if (eye.TimewarpStartEnd[0] != 0.0)
+        TimeManager.GetTimewarpOrientations(HMD, eye.RenderPose, eye.TimewarpStartEnd,
+                                            samples, TimewarpSampleCount);
+    else
+        TimeManager.GetTimewarpOrientations(HMD, (ovrEyeType)eyeNum, eye.RenderPose,
+                                            samples, TimewarpSampleCount);
+
+    // Quatf is four packed floats, as the vec4 array takes them.
+    DistortionShader->SetUniform(TimewarpSamplesUniform, 4 * TimewarpSampleCount, &samples[0].x);
+}
+
+void DistortionRenderer::initPixelDistortion()
+{
+    const int tableSize = PixelDistortionTableSize;
+    float*    table     = (float*)OVR_SUBSYSTEM_ALLOC(AllocSubsystem_DistortionMesh,
+                                                      sizeof(float) * tableSize * 2);
+
+    for (int eyeNum = 0; eyeNum < 2; eyeNum++)
+    {
+        ovrEyeType                  eyeType    = RState.EyeRenderDesc[eyeNum].Eye;
+        const DistortionRenderDesc& distortion = RState.Distortion[eyeType];
+        PixelDistortionEye&         eye        = PixelDistortionEyes[eyeNum];
+
+        // The largest squared radius is at a corner of the eye's half of the screen.
+        float maxRsq = 0.0f;
+        for (int corner = 0; corner < 4; corner++)
+        {
+            Vector2f tanEyeAngle((((corner & 1) ? 1.0f : -1.0f) - distortion.LensCenter.x) * distortion.TanEyeAngleScale.x,
+                                 (((corner & 2) ? 1.0f : -1.0f) - distortion.LensCenter.y) * distortion.TanEyeAngleScale.y);
+            maxRsq = Alg::Max(maxRsq, tanEyeAngle.LengthSq());
+        }
+
+        float* row = table + eyeNum * tableSize;
+        for (int i = 0; i < tableSize; i++)
+            row[i] = distortion.Lens.DistortionFnScaleRadiusSquared(maxRsq * (float)i / (float)(tableSize - 1));
+
+        // The samples are at the texel centers.
+        eye.TableCoords[0] = (float)(tableSize - 1) / ((float)tableSize * maxRsq);
+        eye.TableCoords[1] = 0.5f / (float)tableSize;
+        eye.TableCoords[2] = ((float)eyeNum + 0.5f) * 0.5f;
+
+        ScaleAndOffset2D eyeToSourceNDC = CreateNDCScaleAndOffsetFromFov(RState.EyeRenderDesc[eyeNum].Fov);
+        eye.LensCenterScale[0] = distortion.LensCenter.x;
+        eye.LensCenterScale[1] = distortion.LensCenter.y;
+        eye.LensCenterScale[2] = distortion.TanEyeAngleScale.x;
+        eye.LensCenterScale[3] = distortion.TanEyeAngleScale.y;
+        eye.EyeToSourceNDC[0]  = eyeToSourceNDC.Scale.x;
+        eye.EyeToSourceNDC[1]  = eyeToSourceNDC.Scale.y;
+        eye.EyeToSourceNDC[2]  = eyeToSourceNDC.Offset.x;
+        eye.EyeToSourceNDC[3]  = eyeToSourceNDC.Offset.y;
+        memcpy(eye.ChromaticAberration, distortion.Lens.ChromaticAberration, sizeof(eye.ChromaticAberration));
+
+        // The mesh's timewarp factor, which is linear in the screen position.
+        bool   rightEye = (eyeType == ovrEye_Right);
+        float* lerp     = eye.TimewarpLerp;
+        lerp[0] = lerp[1] = lerp[2] = 0.0f;
+        switch (RState.RenderInfo.Shutter.Type)
+        {
+        case HmdShutter_RollingLeftToRight:
+            lerp[0] = rightEye ? 0.75f : 0.25f;
+            lerp[1] = 0.25f;
+            break;
+        case HmdShutter_RollingRightToLeft:
+            lerp[0] = rightEye ? 0.25f : 0.75f;
+            lerp[1] = -0.25f;
+            break;
+        case HmdShutter_RollingTopToBottom:
+            lerp[0] = 0.5f;
+            lerp[2] = 0.5f;
+            break;
+        default:
+            break;
+        }
+    }
+
+    // Filled on the active unit, whose binding is put back after.
+    GLint boundTexture = 0;
+    glGetIntegerv(GL_TEXTURE_BINDING_2D, &boundTexture);
+
+    if (!DistortionTableTexId)
+        glGenTextures(1, &DistortionTableTexId);
+    glBindTexture(GL_TEXTURE_2D, DistortionTableTexId);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_R32F, tableSize, 2, 0, GL_RED, GL_FLOAT, table);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glBindTexture(GL_TEXTURE_2D, (GLuint)boundTexture);
+
+    OVR_SUBSYSTEM_FREE(AllocSubsystem_DistortionMesh, table);
+
+    if (!DistortionTable)
+        DistortionTable = *new Texture(&RParams, 0, 0);
+    DistortionTable->UpdatePlaceholderTexture(DistortionTableTexId, Sizei(tableSize, 2));
+}
+
+void DistortionRenderer::renderPixelDistortion(Texture* leftEyeTexture, Texture* rightEyeTexture,
+                                               const EyeDrawParams eyes[2])
+{
+    GraphicsState* glState = (GraphicsState*)GfxState.GetPtr();
+
+    // Core profiles draw nothing without a vertex array, even with no attributes.
+    if (!PixelDistortionVAO && glState->SupportsVao)
+        glGenVertexArrays(1, &PixelDistortionVAO);
+    if (PixelDistortionVAO)
+        glBindVertexArray(PixelDistortionVAO);
+
+    for (int eyeNum = 0; eyeNum < 2; eyeNum++)
+    {
+        const PixelDistortionEye& eye = PixelDistortionEyes[eyeNum];
+
+        ShaderFill distortionShaderFill(DistortionShader);
+        distortionShaderFill.SetTexture(0, eyeNum == 0 ? leftEyeTexture : rightEyeTexture);
+        distortionShaderFill.SetTexture(1, DistortionTable);
+        if (DistortionCaps & ovrDistortionCap_PositionalTimeWarp)
+            distortionShaderFill.SetTexture(2, setPositionalTimewarp(eyeNum, eyes[eyeNum]));
+        distortionShaderFill.Set();
+
+        const float eyeIndex = (float)eyeNum;
+        DistortionShader->SetUniform(DistortionShaderUniforms.EyeToSourceUVScale,  2, &eyes[eyeNum].UVScaleOffset[0].x);
+        DistortionShader->SetUniform(DistortionShaderUniforms.EyeToSourceUVOffset, 2, &eyes[eyeNum].UVScaleOffset[1].x);
+        DistortionShader->SetUniform(PixelShaderUniforms.LensCenterScale,     4, eye.LensCenterScale);
+        DistortionShader->SetUniform(PixelShaderUniforms.EyeToSourceNDC,      4, eye.EyeToSourceNDC);
+        DistortionShader->SetUniform(PixelShaderUniforms.ChromaticAberration, 4, eye.ChromaticAberration);
+        DistortionShader->SetUniform(PixelShaderUniforms.TableCoords,         3, eye.TableCoords);
+        DistortionShader->SetUniform(PixelShaderUniforms.TimewarpLerp,        3, eye.TimewarpLerp);
+        DistortionShader->SetUniform(PixelShaderUniforms.EyeIndex,            1, &eyeIndex);
+
+        if (DistortionCaps & ovrDistortionCap_TimeWarp)
+        {
+            float rotationStart[16], rotationEnd[16];
+            int   rotationFloats = getTimewarpRotations(eyeNum, eyes[eyeNum], rotationStart, rotationEnd);
+
+            DistortionShader->SetUniform(DistortionShaderUniforms.EyeRotationStart, rotationFloats, rotationStart);
+            DistortionShader->SetUniform(DistortionShaderUniforms.EyeRotationEnd,   rotationFloats, rotationEnd);
+            if (TimewarpSampled)
+                setTimewarpSamples(eyeNum, eyes[eyeNum]);
+        }
+
+        // Each eye has its half of the screen, as with the mesh.
+        int halfWidth = RParams.RTSize.w / 2;
+        setViewport(eyeNum == 0 ? Recti(0, 0, halfWidth, RParams.RTSize.h) :
+                                  Recti(halfWidth, 0, RParams.RTSize.w - halfWidth, RParams.RTSize.h));
+        glDrawArrays(GL_TRIANGLES, 0, 3);
+    }
+
+    setViewport(Recti(0, 0, RParams.RTSize.w, RParams.RTSize.h));
+}
+
+void DistortionRenderer::createDrawQuad()
+{
+    const int numQuadVerts = 4;
+    LatencyTesterQuadVB = *new Buffer(&RParams);
+    if(!LatencyTesterQuadVB)
+    {
+        return;
+    }
+
+    LatencyTesterQuadVB->Data(Buffer_Vertex, NULL, numQuadVerts * sizeof(LatencyVertex));
+    LatencyVertex* vertices = (LatencyVertex*)LatencyTesterQuadVB->Map(0, numQuadVerts * sizeof(LatencyVertex), Map_Discard);
+    if(!vertices)
+    {
+        OVR_ASSERT(false); // failed to lock vertex buffer
+        return;
+    }
 
     const float left   = -1.0f;
     const float top    = -1.0f;
@@ -552,6 +1443,8 @@ void DistortionRenderer::renderLatencyQuad(unsigned char* latencyTesterDrawColor
         SimpleQuadShader->SetUniform2f("PositionOffset", eyeNum == 0 ? -0.4f : 0.4f, 0.0f);    
         renderPrimitives(&quadFill, LatencyTesterQuadVB, NULL, 0, numQuadVerts, Prim_TriangleStrip, &LatencyVAO, false);
     }
+
+    LatencyQuadSubmitSeconds = ovr_GetTimeInSeconds();
 }
 
 void DistortionRenderer::renderLatencyPixel(unsigned char* latencyTesterPixelColor)
@@ -578,6 +1471,18 @@ void DistortionRenderer::renderLatencyPixel(unsigned char* latencyTesterPixelCol
 	renderPrimitives(&quadFill, LatencyTesterQuadVB, NULL, 0, numQuadVerts, Prim_TriangleStrip, &LatencyVAO, false);
 }
 
+// Sets up and enables a vertex attribute of the bound vertex buffer, unless the
+// shader doesn't use it.
+static void setVertexAttrib(GLint location, GLint size, GLenum type, bool normalized,
+                            GLsizei stride, size_t offset)
+{
+    if (location < 0)
+        return;
+
+    glVertexAttribPointer(location, size, type, normalized, stride, reinterpret_cast<char*>(offset));
+    glEnableVertexAttribArray(location);
+}
+
 void DistortionRenderer::renderPrimitives(
                           const ShaderFill* fill,
                           Buffer* vertices, Buffer* indices,
@@ -605,7 +1510,7 @@ void DistortionRenderer::renderPrimitives(
 
     fill->Set();
     
-    GLuint prog = fill->GetShaders()->Prog;
+    const ShaderSet* shaders = fill->GetShaders();
 
 	if (vao != NULL)
 	{
@@ -626,37 +1531,27 @@ void DistortionRenderer::renderPrimitives(
                 glBindVertexArray(*vao);
 			}
 
-			int attributeCount = (isDistortionMesh) ? 5 : 1;
-			int* locs = new int[attributeCount];
-
 			glBindBuffer(GL_ARRAY_BUFFER, ((Buffer*)vertices)->GLBuffer);
 
+            // Attribute locations were bound in the order of the vertex attribute
+            // tables when the shaders were linked.
 			if (isDistortionMesh)
 			{
 				glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ((Buffer*)indices)->GLBuffer);
 
-				locs[0] = glGetAttribLocation(prog, "Position");
-				locs[1] = glGetAttribLocation(prog, "Color");
-				locs[2] = glGetAttribLocation(prog, "TexCoord0");
-				locs[3] = glGetAttribLocation(prog, "TexCoord1");
-				locs[4] = glGetAttribLocation(prog, "TexCoord2");
-
-				glVertexAttribPointer(locs[0], 2, GL_FLOAT, false, sizeof(DistortionVertex), reinterpret_cast<char*>(offset)+offsetof(DistortionVertex, Pos));
-				glVertexAttribPointer(locs[1], 4, GL_UNSIGNED_BYTE, true, sizeof(DistortionVertex), reinterpret_cast<char*>(offset)+offsetof(DistortionVertex, Col));
-				glVertexAttribPointer(locs[2], 2, GL_FLOAT, false, sizeof(DistortionVertex), reinterpret_cast<char*>(offset)+offsetof(DistortionVertex, TexR));
-				glVertexAttribPointer(locs[3], 2, GL_FLOAT, false, sizeof(DistortionVertex), reinterpret_cast<char*>(offset)+offsetof(DistortionVertex, TexG));
-				glVertexAttribPointer(locs[4], 2, GL_FLOAT, false, sizeof(DistortionVertex), reinterpret_cast<char*>(offset)+offsetof(DistortionVertex, TexB));
+				setVertexAttrib(shaders->GetAttribLocation(0), 2, GL_FLOAT, false, sizeof(DistortionVertex), offset + offsetof(DistortionVertex, Pos));
+				setVertexAttrib(shaders->GetAttribLocation(1), 4, GL_UNSIGNED_BYTE, true, sizeof(DistortionVertex), offset + offsetof(DistortionVertex, Col));
+				setVertexAttrib(shaders->GetAttribLocation(2), 2, GL_FLOAT, false, sizeof(DistortionVertex), offset + offsetof(DistortionVertex, TexR));
+				setVertexAttrib(shaders->GetAttribLocation(3), 2, GL_FLOAT, false, sizeof(DistortionVertex), offset + offsetof(DistortionVertex, TexG));
+				setVertexAttrib(shaders->GetAttribLocation(4), 2, GL_FLOAT, false, sizeof(DistortionVertex), offset + offsetof(DistortionVertex, TexB));
+				// Only the shaders drawing both eyes at once read the eye index.
+				setVertexAttrib(shaders->GetAttribLocation(5), 1, GL_FLOAT, false, sizeof(DistortionVertex), offset + offsetof(DistortionVertex, EyeIndex));
 			}
 			else
 			{
-				locs[0] = glGetAttribLocation(prog, "Position");
-
-				glVertexAttribPointer(locs[0], 3, GL_FLOAT, false, sizeof(LatencyVertex), reinterpret_cast<char*>(offset)+offsetof(LatencyVertex, Pos));
+				setVertexAttrib(shaders->GetAttribLocation(0), 3, GL_FLOAT, false, sizeof(LatencyVertex), offset + offsetof(LatencyVertex, Pos));
 			}
 
-            for (int i = 0; i < attributeCount; ++i)
-                glEnableVertexAttribArray(locs[i]);
-            
 			if (isDistortionMesh)
 				glDrawElements(prim, count, GL_UNSIGNED_SHORT, NULL);
 			else
@@ -665,11 +1560,10 @@ void DistortionRenderer::renderPrimitives(
 
             if (!glState->SupportsVao)
             {
-				for (int i = 0; i < attributeCount; ++i)
-                    glDisableVertexAttribArray(locs[i]);
+				for (int i = 0; i < shaders->GetAttribCount(); ++i)
+                    if (shaders->GetAttribLocation(i) >= 0)
+                        glDisableVertexAttribArray(shaders->GetAttribLocation(i));
             }
-
-			delete[] locs;
 		}
 	}
 }
@@ -688,40 +1582,107 @@ void DistortionRenderer::initShaders()
         (glState->GlMajorVersion < 3 || (glState->GlMajorVersion == 3 && glState->GlMinorVersion < 2)) ?
             glsl2Prefix : glsl3Prefix;
 
-    {
-		ShaderInfo vsInfo = DistortionVertexShaderLookup[DistortionVertexShaderBitMask & DistortionCaps];
-
-		size_t vsSize = strlen(shaderPrefix)+vsInfo.ShaderSize;
-		char* vsSource = new char[vsSize];
-		OVR_strcpy(vsSource, vsSize, shaderPrefix);
-		OVR_strcat(vsSource, vsSize, vsInfo.ShaderData);
-
-        Ptr<GL::VertexShader> vs = *new GL::VertexShader(
-            &RParams,
-			(void*)vsSource, vsSize,
-			vsInfo.ReflectionData, vsInfo.ReflectionSize);
+    ProgramBinaries.Init(glState->GlMajorVersion, glState->GlMinorVersion);
 
-        DistortionShader = *new ShaderSet;
-        DistortionShader->SetShader(vs);
+    // Shaders take the timewarp rotations as quaternions when asked to.
+    bool   quaternions = (DistortionCaps & ovrDistortionCap_TimeWarp) &&
+                         (DistortionCaps & ovrDistortionCap_TimeWarpQuaternions);
+    String defines;
+    if (quaternions)
+        defines = glslTimewarpQuaternionsDefine;
+    if (DistortionCaps & ovrDistortionCap_PixelDistortion)
+    {
+        if (DistortionCaps & ovrDistortionCap_TimeWarp)
+            defines += glslTimewarpDefine;
+        if (DistortionCaps & ovrDistortionCap_Chromatic)
+            defines += glslChromaticDefine;
+        if (DistortionCaps & ovrDistortionCap_Vignette)
+            defines += glslVignetteDefine;
+        if (DistortionCaps & ovrDistortionCap_PositionalTimeWarp)
+            defines += glslPositionalTimewarpDefine;
+    }
 
-		delete[](vsSource);
+    // Latched poses go in a uniform block of their own, at the binding point
+    // below the one of the eye parameters.
+    LatchedPoseBuffer.Clear();
+    LatchedPoses = NULL;
+    if (DistortionCaps & ovrDistortionCap_LateLatchedPose)
+    {
+        if (quaternions && shaderPrefix == glsl3Prefix &&
+            glState->SupportsUniformBuffers && glState->SupportsBufferStorage)
+        {
+            LatchedPoseBuffer = *new Buffer(&RParams);
+            LatchedPoses = (float*)LatchedPoseBuffer->MapPersistent(Buffer_Uniform, LatchedPoseFloats * sizeof(float));
+        }
 
-		ShaderInfo psInfo = DistortionPixelShaderLookup[DistortionPixelShaderBitMask & DistortionCaps];
+        if (LatchedPoses)
+        {
+            // Identity until the thread writes the first prediction.
+            for (int i = 0; i < LatchedPoseFloats; i++)
+                LatchedPoses[i] = ((i % 4) == 3) ? 1.0f : 0.0f;
+
+            GLint bindingCount = 0;
+            glGetIntegerv(GL_MAX_UNIFORM_BUFFER_BINDINGS, &bindingCount);
+            LatchedPoseBinding = (bindingCount > 1) ? (GLuint)(bindingCount - 2) : 0;
+            defines += glslLateLatchedPoseDefine;
+        }
+        else
+        {
+            LogText("OVR::GL::DistortionRenderer - late-latched poses need timewarp quaternions and GL 4.4 or ARB_buffer_storage\n");
+            LatchedPoseBuffer.Clear();
+        }
+    }
 
-		size_t psSize = strlen(shaderPrefix)+psInfo.ShaderSize;
-		char* psSource = new char[psSize];
-		OVR_strcpy(psSource, psSize, shaderPrefix);
-		OVR_strcat(psSource, psSize, psInfo.ShaderData);
+    // Latched poses only have the start and end of each eye.
+    TimewarpSampled = quaternions && !LatchedPoses &&
+                      (DistortionCaps & ovrDistortionCap_TimeWarpSamples);
+    if (TimewarpSampled)
+        defines += glslTimewarpSamplesDefine;
+
+    releaseDistortionShader(DistortionShader);
+    releaseDistortionShader(BothEyesDistortionShader);
+    DistortionShader = *createDistortionShader(shaderPrefix, defines);
+    DistortionShaderUniforms.Init(DistortionShader, DistortionUniformNames,
+                                  (DistortionCaps & ovrDistortionCap_TimeWarp) != 0);
+    TimewarpSamplesUniform = TimewarpSampled ? DistortionShader->GetUniformHandle("TimewarpSamples") : -1;
+
+    // The shader drawing both eyes takes their parameters from a uniform buffer
+    // where GLSL 1.50 is used, bound to the last binding point to stay clear of
+    // the ones applications tend to use.
+    EyeUniformBuffer.Clear();
+    // Eyes are drawn one at a time with pixel distortion, whether they share a
+    // texture or not, and with timewarp samples, which only one eye's shader takes.
+    if (DistortionCaps & ovrDistortionCap_PixelDistortion)
+    {
+        PixelShaderUniforms.Init(DistortionShader);
+    }
+    else if (!TimewarpSampled && shaderPrefix == glsl3Prefix && glState->SupportsUniformBuffers)
+    {
+        BothEyesDistortionShader = *createDistortionShader(shaderPrefix, String(glslBothEyesUniformBlockDefine) + defines);
 
-        Ptr<GL::FragmentShader> ps  = *new GL::FragmentShader(
-            &RParams,
-			(void*)psSource, psSize,
-			psInfo.ReflectionData, psInfo.ReflectionSize);
+        GLint bindingCount = 0;
+        glGetIntegerv(GL_MAX_UNIFORM_BUFFER_BINDINGS, &bindingCount);
+        EyeUniformBinding = (bindingCount > 0) ? (GLuint)(bindingCount - 1) : 0;
 
-        DistortionShader->SetShader(ps);
+        if (BothEyesDistortionShader->SetUniformBlockBinding("DistortionEyes", EyeUniformBinding))
+            EyeUniformBuffer = *new Buffer(&RParams);
+        else
+            releaseDistortionShader(BothEyesDistortionShader);
+    }
+    else if (!TimewarpSampled)
+    {
+        BothEyesDistortionShader = *createDistortionShader(shaderPrefix, String(glslBothEyesDefine) + defines);
+        BothEyesShaderUniforms.Init(BothEyesDistortionShader, BothEyesUniformNames,
+                                    (DistortionCaps & ovrDistortionCap_TimeWarp) != 0);
+    }
 
-		delete[](psSource);
+    if (LatchedPoses)
+    {
+        DistortionShader->SetUniformBlockBinding("LatchedPose", LatchedPoseBinding);
+        if (BothEyesDistortionShader)
+            BothEyesDistortionShader->SetUniformBlockBinding("LatchedPose", LatchedPoseBinding);
     }
+
 	{
 		size_t vsSize = strlen(shaderPrefix)+sizeof(SimpleQuad_vs);
 		char* vsSource = new char[vsSize];
@@ -734,6 +1695,8 @@ void DistortionRenderer::initShaders()
 			SimpleQuad_vs_refl, sizeof(SimpleQuad_vs_refl) / sizeof(SimpleQuad_vs_refl[0]));
 
         SimpleQuadShader = *new ShaderSet;
+        SimpleQuadShader->SetAttribLocations(LatencyVertexAttribs,
+                                             sizeof(LatencyVertexAttribs) / sizeof(LatencyVertexAttribs[0]));
 		SimpleQuadShader->SetShader(vs);
 
 		delete[](vsSource);
@@ -755,30 +1718,557 @@ void DistortionRenderer::initShaders()
 }
 
 
-void DistortionRenderer::destroy()
+void DistortionRenderer::DistortionUniforms::Init(ShaderSet* shaders, const char* const names[4],
+                                                  bool timewarp)
+{
+    EyeToSourceUVScale  = shaders->GetUniformHandle(names[0]);
+    EyeToSourceUVOffset = shaders->GetUniformHandle(names[1]);
+    EyeRotationStart    = timewarp ? shaders->GetUniformHandle(names[2]) : -1;
+    EyeRotationEnd      = timewarp ? shaders->GetUniformHandle(names[3]) : -1;
+}
+
+void DistortionRenderer::PixelDistortionUniforms::Init(ShaderSet* shaders)
+{
+    LensCenterScale     = shaders->GetUniformHandle("LensCenterScale");
+    EyeToSourceNDC      = shaders->GetUniformHandle("EyeToSourceNDC");
+    ChromaticAberration = shaders->GetUniformHandle("ChromaticAberration");
+    TableCoords         = shaders->GetUniformHandle("TableCoords");
+    TimewarpLerp        = shaders->GetUniformHandle("TimewarpLerp");
+    // Only read with late-latched poses.
+    EyeIndex            = shaders->GetUniformHandle("EyeIndex");
+    // Only with positional timewarp.
+    DepthProjection     = shaders->GetUniformHandle("DepthProjection");
+    TimewarpTranslation = shaders->GetUniformHandle("TimewarpTranslation");
+}
+
+// Builds the distortion shaders for DistortionCaps, with the given defines
+// following the GLSL version prefix.
+ShaderSet* DistortionRenderer::createDistortionShader(const char* shaderPrefix, const String& defines)
+{
+    bool pixelDistortion = (DistortionCaps & ovrDistortionCap_PixelDistortion) != 0;
+
+	ShaderInfo vsInfo = pixelDistortion ? PixelDistortionShaderLookup[0] :
+                        DistortionVertexShaderLookup[DistortionVertexShaderBitMask & DistortionCaps];
+
+	size_t vsSize = strlen(shaderPrefix)+defines.GetSize()+vsInfo.ShaderSize;
+	char* vsSource = new char[vsSize];
+	OVR_strcpy(vsSource, vsSize, shaderPrefix);
+	OVR_strcat(vsSource, vsSize, defines.ToCStr());
+	OVR_strcat(vsSource, vsSize, vsInfo.ShaderData);
+
+	ShaderInfo psInfo = pixelDistortion ? PixelDistortionShaderLookup[1] :
+                        DistortionPixelShaderLookup[DistortionPixelShaderBitMask & DistortionCaps];
+
+	size_t psSize = strlen(shaderPrefix)+defines.GetSize()+psInfo.ShaderSize;
+	char* psSource = new char[psSize];
+	OVR_strcpy(psSource, psSize, shaderPrefix);
+	OVR_strcat(psSource, psSize, defines.ToCStr());
+	OVR_strcat(psSource, psSize, psInfo.ShaderData);
+
+    void*  context = (DistortionCaps & ovrDistortionCap_AsyncTimeWarp) ? 0 : getCurrentContext();
+    String key;
+    if (context)
+    {
+        key  = vsSource;
+        key += psSource;
+
+        Lock::Locker lock(&SharedDistortionProgramsLock);
+        for (UPInt i = 0; i < SharedDistortionPrograms.GetSize(); i++)
+        {
+            const SharedDistortionProgram& program = SharedDistortionPrograms[i];
+            if (program.Context == context && program.Key == key)
+            {
+                delete[](vsSource);
+                delete[](psSource);
+
+                program.Shaders->AddRef();
+                return program.Shaders;
+            }
+        }
+    }
+
+    ShaderSet* shaders = new ShaderSet;
+    shaders->SetAttribLocations(DistortionVertexAttribs,
+                                sizeof(DistortionVertexAttribs) / sizeof(DistortionVertexAttribs[0]));
+
+    // Compile only if there's no binary from an earlier run.
+    if (!ProgramBinaries.Load(shaders, vsSource, psSource))
+    {
+        Ptr<GL::VertexShader> vs = *new GL::VertexShader(
+            &RParams,
+            (void*)vsSource, vsSize,
+            vsInfo.ReflectionData, vsInfo.ReflectionSize);
+
+        shaders->SetShader(vs);
+
+        Ptr<GL::FragmentShader> ps  = *new GL::FragmentShader(
+            &RParams,
+            (void*)psSource, psSize,
+            psInfo.ReflectionData, psInfo.ReflectionSize);
+
+        shaders->SetShader(ps);
+
+        ProgramBinaries.Save(shaders, vsSource, psSource);
+    }
+
+	delete[](vsSource);
+	delete[](psSource);
+
+    if (context)
+    {
+        SharedDistortionProgram program;
+        program.Context = context;
+        program.Key     = key;
+        program.Shaders = shaders;
+
+        Lock::Locker lock(&SharedDistortionProgramsLock);
+        SharedDistortionPrograms.PushBack(program);
+    }
+
+    return shaders;
+}
+
+
+void DistortionRenderer::deleteVertexArrays()
 {
     GraphicsState* glState = (GraphicsState*)GfxState.GetPtr();
 
-	for(int eyeNum = 0; eyeNum < 2; eyeNum++)
-	{
-        if (glState->SupportsVao)
-            glDeleteVertexArrays(1, &DistortionMeshVAOs[eyeNum]);
+    if (glState->SupportsVao)
+    {
+        glDeleteVertexArrays(2, DistortionMeshVAOs);
+        glDeleteVertexArrays(1, &BothEyesMeshVAO);
+        glDeleteVertexArrays(1, &LatencyVAO);
+        glDeleteVertexArrays(1, &PixelDistortionVAO);
+    }
+
+	DistortionMeshVAOs[0] = 0;
+	DistortionMeshVAOs[1] = 0;
+	BothEyesMeshVAO = 0;
+	LatencyVAO = 0;
+	PixelDistortionVAO = 0;
+}
 
-		DistortionMeshVAOs[eyeNum] = 0;
+void DistortionRenderer::destroy()
+{
+    // With asynchronous timewarp, the thread deletes its vertex arrays.
+    stopAsyncTimewarp();
+    stopPoseLatching();
+    deleteVertexArrays();
 
+	for(int eyeNum = 0; eyeNum < 2; eyeNum++)
+	{
 		DistortionMeshVBs[eyeNum].Clear();
 		DistortionMeshIBs[eyeNum].Clear();
 	}
 
-	if (DistortionShader)
+	BothEyesMeshVB.Clear();
+	BothEyesMeshIB.Clear();
+
+    releaseDistortionShader(DistortionShader);
+    releaseDistortionShader(BothEyesDistortionShader);
+
+    EyeUniformBuffer.Clear();
+    LatchedPoseBuffer.Clear();
+    LatchedPoses = NULL;
+
+    DistortionTable.Clear();
+    EyeDepthTexture.Clear();
+    if (DistortionTableTexId)
+        glDeleteTextures(1, &DistortionTableTexId);
+    DistortionTableTexId = 0;
+
+    if (TimerQueries[0][0])
     {
-        DistortionShader->UnsetShader(Shader_Vertex);
-	    DistortionShader->UnsetShader(Shader_Pixel);
-	    DistortionShader.Clear();
+        for (int slot = 0; slot < TimerSlots; slot++)
+            glDeleteQueries(2, TimerQueries[slot]);
     }
+    memset(TimerQueries, 0, sizeof(TimerQueries));
+    memset(TimerQueryPending, 0, sizeof(TimerQueryPending));
+    TimerSlot = 0;
 
     LatencyTesterQuadVB.Clear();
-	LatencyVAO = 0;
+}
+
+
+//-------------------------------------------------------------------------------------
+// ***** Asynchronous timewarp
+
+const double DistortionRenderer::AsyncDefaultLeadSeconds = 0.004;
+
+#if defined(OVR_OS_LINUX)
+static int ignoreXError(Display*, XErrorEvent*)
+{
+    return 0;
+}
+#endif
+
+bool DistortionRenderer::startAsyncTimewarp()
+{
+#if defined(OVR_OS_LINUX)
+    GraphicsState* glState = (GraphicsState*)GfxState.GetPtr();
+
+    // The thread waits for the app's frames on fences.
+    if (!glState->SupportsSync || !glWaitSync)
+    {
+        LogError("OVR::GL::DistortionRenderer - asynchronous timewarp needs GL 3.2 or ARB_sync\n");
+        return false;
+    }
+
+    GLXContext appContext = glXGetCurrentContext();
+    if (!appContext || !RParams.Win)
+        return false;
+
+    // A context like the app's, on its frame buffer configuration, sharing its objects.
+    int fbConfigId = 0;
+    glXQueryContext(RParams.Disp, appContext, GLX_FBCONFIG_ID, &fbConfigId);
+    int          configAttribs[] = { GLX_FBCONFIG_ID, fbConfigId, None };
+    int          configCount     = 0;
+    GLXFBConfig* configs         = glXChooseFBConfig(RParams.Disp, DefaultScreen(RParams.Disp),
+                                                     configAttribs, &configCount);
+    if (!configs || !configCount)
+    {
+        if (configs)
+            XFree(configs);
+        LogError("OVR::GL::DistortionRenderer - can't find the frame buffer configuration of the app's context\n");
+        return false;
+    }
+
+    // Drivers report unsupported context attributes as X errors, which would
+    // otherwise end the process.
+    int (*oldHandler)(Display*, XErrorEvent*) = XSetErrorHandler(ignoreXError);
+
+    if (glXCreateContextAttribsARB && glState->GlMajorVersion >= 3)
+    {
+        // Same version and profile, so that the shaders built for the app's context work.
+        GLint profileMask = 0;
+        if (glState->GlMajorVersion > 3 || glState->GlMinorVersion >= 2)
+            glGetIntegerv(GL_CONTEXT_PROFILE_MASK, &profileMask);
+
+        int contextAttribs[] =
+        {
+            GLX_CONTEXT_MAJOR_VERSION_ARB, glState->GlMajorVersion,
+            GLX_CONTEXT_MINOR_VERSION_ARB, glState->GlMinorVersion,
+            profileMask ? GLX_CONTEXT_PROFILE_MASK_ARB : 0, profileMask,
+            None
+        };
+        AsyncContext = glXCreateContextAttribsARB(RParams.Disp, configs[0], appContext, True, contextAttribs);
+    }
+    if (!AsyncContext)
+        AsyncContext = glXCreateNewContext(RParams.Disp, configs[0], GLX_RGBA_TYPE, appContext, True);
+
+    XSync(RParams.Disp, False);
+    XSetErrorHandler(oldHandler);
+    XFree(configs);
+
+    if (!AsyncContext)
+    {
+        LogError("OVR::GL::DistortionRenderer - can't create the timewarp context\n");
+        return false;
+    }
+
+    // Objects made by this context are only visible to the other once done.
+    glFinish();
+
+    AsyncThreadFailed = false;
+    AsyncThreadStarted.ResetEvent();
+    AsyncThreadDone.ResetEvent();
+    AsyncThread = *new Thread(Thread::CreateParams(asyncTimewarpThreadFn, this, 128 * 1024, -1,
+                                                   Thread::NotRunning, Thread::HighestPriority));
+    if (AsyncThread->Start())
+    {
+        AsyncThreadStarted.Wait();
+        if (!AsyncThreadFailed)
+            return true;
+        AsyncThreadDone.Wait();
+    }
+
+    AsyncThread.Clear();
+    glXDestroyContext(RParams.Disp, AsyncContext);
+    AsyncContext = 0;
+    return false;
+#else
+    LogText("OVR::GL::DistortionRenderer - asynchronous timewarp isn't supported on this platform\n");
+    return false;
+#endif
+}
+
+void DistortionRenderer::stopAsyncTimewarp()
+{
+    if (!AsyncThread)
+        return;
+
+    AsyncThread->SetExitFlag(true);
+    FrameSubmitted.SetEvent();
+    AsyncThreadDone.Wait();
+    AsyncThread.Clear();
+
+    // A frame the thread didn't take still has its fence.
+    if (PendingFrameValid && PendingFrame.Fence)
+        glDeleteSync(PendingFrame.Fence);
+    PendingFrameValid = false;
+
+#if defined(OVR_OS_LINUX)
+    glXDestroyContext(RParams.Disp, AsyncContext);
+    AsyncContext = 0;
+#endif
+}
+
+void DistortionRenderer::submitAsyncFrame(unsigned char* latencyTesterDrawColor,
+                                          unsigned char* latencyTester2DrawColor)
+{
+    OVR_TRACE_SCOPE("DistortionRenderer::submitAsyncFrame");
+
+    AsyncFrame frame = AsyncFrame();
+    for (int eyeNum = 0; eyeNum < 2; eyeNum++)
+    {
+        frame.TexIds[eyeNum]       = eachEye[eyeNum].texture;
+        frame.TextureSizes[eyeNum] = eachEye[eyeNum].TextureSize;
+    }
+    getEyeDrawParams(frame.Eyes);
+
+    if (latencyTesterDrawColor)
+    {
+        frame.HasLatencyTesterColor = true;
+        memcpy(frame.LatencyTesterColor, latencyTesterDrawColor, 3);
+    }
+    if (latencyTester2DrawColor)
+    {
+        frame.HasLatencyTester2Color = true;
+        memcpy(frame.LatencyTester2Color, latencyTester2DrawColor, 3);
+    }
+
+    // Signalled once the app's rendering to the eye textures is done; the
+    // thread has the GPU wait for it, and doesn't wait itself.
+    frame.Fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    glFlush();
+
+    // Keep the app from getting more than a frame ahead of the display, but
+    // don't hold it up for long if the thread stalls.
+    bool wait;
+    {
+        Lock::Locker lockScope(&AsyncLock);
+        wait = PendingFrameValid;
+        if (wait)
+            PendingFrameTaken.ResetEvent();
+    }
+    if (wait)
+        PendingFrameTaken.Wait(AsyncSubmitWaitMs);
+
+    GLsync replacedFence = 0;
+    {
+        Lock::Locker lockScope(&AsyncLock);
+        if (PendingFrameValid)
+            replacedFence = PendingFrame.Fence;
+        PendingFrame      = frame;
+        PendingFrameValid = true;
+    }
+    if (replacedFence)
+        glDeleteSync(replacedFence);
+
+    FrameSubmitted.SetEvent();
+}
+
+// static
+int DistortionRenderer::asyncTimewarpThreadFn(Thread* thread, void* renderer)
+{
+    return ((DistortionRenderer*)renderer)->runAsyncTimewarp(thread);
+}
+
+int DistortionRenderer::runAsyncTimewarp(Thread* thread)
+{
+#if defined(OVR_OS_LINUX)
+    // Real-time scheduling usually needs privileges; without them the thread
+    // runs at normal priority.
+    Thread::SetCurrentThreadScheduling(Thread::SchedulingParams(Thread::Sched_FIFO, AsyncThreadRealTimePriority));
+
+    // Xlib must have been initialized with XInitThreads for this to be safe.
+    if (!glXMakeCurrent(RParams.Disp, RParams.Win, AsyncContext))
+    {
+        LogError("OVR::GL::DistortionRenderer - can't make the timewarp context current\n");
+        AsyncThreadFailed = true;
+        AsyncThreadStarted.SetEvent();
+        AsyncThreadDone.SetEvent();
+        return 1;
+    }
+    AsyncThreadStarted.SetEvent();
+
+    const char* extensions = glXQueryExtensionsString(RParams.Disp, 0);
+    if (extensions && strstr(extensions, "GLX_EXT_swap_control") && glXSwapIntervalEXT)
+        glXSwapIntervalEXT(RParams.Disp, RParams.Win, (RState.EnabledHmdCaps & ovrHmdCap_NoVSync) ? 0 : 1);
+
+    Ptr<Texture> eyeTextures[2];
+    eyeTextures[0] = *new Texture(&RParams, 0, 0);
+    eyeTextures[1] = *new Texture(&RParams, 0, 0);
+
+    AsyncFrame frame = AsyncFrame();
+    bool               haveFrame     = false;
+    double             lastVsyncTime = 0.0;
+    TimeDeltaCollector distortionTimes;
+
+    while (!thread->GetExitFlag())
+    {
+        bool newFrame = false;
+        {
+            Lock::Locker lockScope(&AsyncLock);
+            if (PendingFrameValid)
+            {
+                frame             = PendingFrame;
+                PendingFrameValid = false;
+                newFrame          = true;
+            }
+        }
+
+        if (newFrame)
+        {
+            PendingFrameTaken.SetEvent();
+
+            if (frame.Fence)
+            {
+                glWaitSync(frame.Fence, 0, GL_TIMEOUT_IGNORED);
+                glDeleteSync(frame.Fence);
+                frame.Fence = 0;
+            }
+            for (int eyeNum = 0; eyeNum < 2; eyeNum++)
+                eyeTextures[eyeNum]->UpdatePlaceholderTexture(frame.TexIds[eyeNum], frame.TextureSizes[eyeNum]);
+            haveFrame = true;
+        }
+
+        if (!haveFrame)
+        {
+            FrameSubmitted.Wait(AsyncIdleWaitMs);
+            FrameSubmitted.ResetEvent();
+            continue;
+        }
+
+        // Predict for the next vsync, counted on from the one the last swap
+        // finished at, and sample the sensor only as long before it as
+        // distortion takes.
+        double now        = ovr_GetTimeInSeconds();
+        double nextVsync  = now;
+        FrameTimeManager::Timing timing = TimeManager.GetTimingForVsync(nextVsync);
+        double frameDelta = timing.NextFrameTime - timing.ThisFrameTime;
+
+        if (lastVsyncTime > 0.0 && frameDelta > 0.0)
+        {
+            nextVsync = lastVsyncTime + frameDelta;
+            while (nextVsync < now)
+                nextVsync += frameDelta;
+            timing = TimeManager.GetTimingForVsync(nextVsync);
+
+            double lead = (distortionTimes.GetCount() >= 3) ?
+                          (distortionTimes.GetMedianTimeDelta() + 0.002) : AsyncDefaultLeadSeconds;
+            Timer::WaitUntilSeconds(nextVsync - lead);
+        }
+
+        EyeDrawParams eyes[2];
+        for (int eyeNum = 0; eyeNum < 2; eyeNum++)
+        {
+            eyes[eyeNum] = frame.Eyes[eyeNum];
+            eyes[eyeNum].TimewarpStartEnd[0] = timing.TimeWarpStartEndTimes[eyeNum][0];
+            eyes[eyeNum].TimewarpStartEnd[1] = timing.TimeWarpStartEndTimes[eyeNum][1];
+        }
+
+        double distortionStartTime = ovr_GetTimeInSeconds();
+
+        renderDistortion(eyeTextures[0], eyeTextures[1], eyes);
+        if (frame.HasLatencyTesterColor)
+            renderLatencyQuad(frame.LatencyTesterColor);
+        else if (frame.HasLatencyTester2Color)
+            renderLatencyPixel(frame.LatencyTester2Color);
+
+        waitForGpu();
+        distortionTimes.AddTimeDelta(ovr_GetTimeInSeconds() - distortionStartTime);
+
+        {
+            OVR_TRACE_SCOPE("glXSwapBuffers");
+            glXSwapBuffers(RParams.Disp, RParams.Win);
+        }
+        // The swap is done at the vsync it waited for, which the next frame's
+        // prediction counts on from.
+        waitForGpu();
+        lastVsyncTime = reportPresentTime(ovr_GetTimeInSeconds());
+    }
+
+    deleteVertexArrays();
+    eyeTextures[0].Clear();
+    eyeTextures[1].Clear();
+    glXMakeCurrent(RParams.Disp, None, NULL);
+
+    AsyncThreadDone.SetEvent();
+    return 0;
+#else
+    OVR_UNUSED(thread);
+    return 1;
+#endif
+}
+
+
+//-------------------------------------------------------------------------------------
+// ***** Late-latched poses
+
+const double DistortionRenderer::LatchLeadSeconds = 0.002;
+
+bool DistortionRenderer::startPoseLatching()
+{
+    PoseLatchThreadDone.ResetEvent();
+    PoseLatchThread = *new Thread(Thread::CreateParams(poseLatchThreadFn, this, 64 * 1024, -1,
+                                                       Thread::NotRunning, Thread::HighestPriority));
+    if (PoseLatchThread->Start())
+        return true;
+
+    LogError("OVR::GL::DistortionRenderer - can't start the pose latching thread\n");
+    PoseLatchThread.Clear();
+    return false;
+}
+
+void DistortionRenderer::stopPoseLatching()
+{
+    if (!PoseLatchThread)
+        return;
+
+    PoseLatchThread->SetExitFlag(true);
+    PoseLatchThreadDone.Wait();
+    PoseLatchThread.Clear();
+}
+
+// static
+int DistortionRenderer::poseLatchThreadFn(Thread* thread, void* renderer)
+{
+    return ((DistortionRenderer*)renderer)->runPoseLatching(thread);
+}
+
+int DistortionRenderer::runPoseLatching(Thread* thread)
+{
+    while (!thread->GetExitFlag())
+    {
+        // Predict for the vsync that a draw starting now is shown at.
+        FrameTimeManager::Timing timing =
+            TimeManager.GetTimingForVsyncAfter(ovr_GetTimeInSeconds() + LatchLeadSeconds);
+
+        // In the basis of the mesh, as GetTimewarpOrientations makes them.
+        float poses[LatchedPoseFloats];
+        for (int eyeNum = 0; eyeNum < 2; eyeNum++)
+        {
+            for (int i = 0; i < 2; i++)
+            {
+                ovrSensorState state = ovrHmd_GetSensorState(HMD, timing.TimeWarpStartEndTimes[eyeNum][i]);
+                const ovrQuatf& q    = state.Predicted.Pose.Orientation;
+                float*          pose = poses + 4 * (2 * eyeNum + i);
+                pose[0] =  q.x;
+                pose[1] = -q.y;
+                pose[2] = -q.z;
+                pose[3] =  q.w;
+            }
+        }
+
+        // The mapping is coherent, so the GPU sees this without a flush.
+        memcpy(LatchedPoses, poses, sizeof(poses));
+
+        Thread::MSleep(LatchIntervalMs);
+    }
+
+    PoseLatchThreadDone.SetEvent();
+    return 0;
 }
 
 }}} // OVR::CAPI::GL
@@ -19,7 +19,9 @@ otherwise accompanies this software in either electronic or hard copy form.
 #include "../CAPI_DistortionRenderer.h"
 
 #include "../../Kernel/OVR_Log.h"
+#include "../../Kernel/OVR_Threads.h"
 #include "CAPI_GL_Util.h"
+#include "CAPI_GL_ProgramCache.h"
 
 namespace OVR { namespace CAPI { namespace GL {
 
@@ -48,6 +50,10 @@ public:
                             unsigned distortionCaps);
 
     virtual void SubmitEye(int eyeId, ovrTexture* eyeTexture);
+    virtual void SubmitEyeDepth(int eyeId, ovrTexture* depthTexture, const ovrMatrix4f& projection);
+
+    virtual bool CreateSwapTextureSet(ovrSwapTextureSet* textureSet, Sizei size);
+    virtual void DestroySwapTextureSet(const ovrSwapTextureSet* textureSet);
 
     virtual void EndFrame(bool swapBuffers, unsigned char* latencyTesterDrawColor, unsigned char* latencyTester2DrawColor);
 
@@ -60,10 +66,15 @@ public:
 protected:
     
     
+    // With ovrDistortionCap_CachedGraphicsState, the state is only read the first
+    // time it is saved and restored from that copy afterwards, so that EndFrame
+    // makes no glGet calls, which are a pipeline sync on threaded GL drivers.
+    // Setting the OVR_GL_VALIDATE_STATE environment variable to 1 reads the state
+    // every frame anyway, and logs it when the app's state was not the cached one.
     class GraphicsState : public CAPI::DistortionRenderer::GraphicsState
     {
     public:
-        GraphicsState();
+        GraphicsState(bool cached);
         virtual void Save();
         virtual void Restore();
         
@@ -74,28 +85,45 @@ protected:
         GLint GlMajorVersion;
         GLint GlMinorVersion;
         bool SupportsVao;
-        
-        GLint Viewport[4];
-        GLfloat ClearColor[4];
-        GLint DepthTest;
-        GLint CullFace;
-        GLint Program;
-        GLint ActiveTexture;
-        GLint TextureBinding;
-        GLint VertexArray;
-        GLint FrameBufferBinding;
-        
-        GLint Blend;
-        GLint ColorWritemask[4];
-        GLint Dither;
-        GLint Fog;
-        GLint Lighting;
-        GLint RasterizerDiscard;
-        GLint RenderMode;
-        GLint SampleMask;
-        GLint ScissorTest;
-        GLfloat ZoomX;
-        GLfloat ZoomY;
+        bool SupportsUniformBuffers;
+        bool SupportsSync;
+        bool SupportsTimerQueries;
+        bool SupportsBufferStorage;
+        // Texture unit 1 is saved too, for the per-pixel distortion table, and
+        // unit 2 for the eye depth of positional timewarp.
+        bool SavesTableTexture;
+        bool SavesDepthTexture;
+
+        bool Cached;
+        bool Validate;
+        // Swap interval last set or read, or -1 if unknown.
+        GLint SwapInterval;
+
+        struct Values
+        {
+            GLint Viewport[4];
+            GLfloat ClearColor[4];
+            GLint DepthTest;
+            GLint CullFace;
+            GLint Program;
+            GLint ActiveTexture;
+            GLint TextureBinding;
+            GLint TableTextureBinding;
+            GLint DepthTextureBinding;
+            GLint VertexArray;
+            GLint FrameBufferBinding;
+            GLint UniformBufferBinding;
+
+            GLint Blend;
+            GLint ColorWritemask[4];
+            GLint Dither;
+            GLint RasterizerDiscard;
+            GLint SampleMask;
+            GLint ScissorTest;
+        }    Saved;
+
+    protected:
+        void query(Values* values) const;
     };
 
     // TBD: Should we be using oe from RState instead?
@@ -103,7 +131,7 @@ protected:
 
 	struct FOR_EACH_EYE
 	{
-        FOR_EACH_EYE() : TextureSize(0), RenderViewport(Sizei(0)) { }
+        FOR_EACH_EYE() : TextureSize(0), RenderViewport(Sizei(0)), UVScaleOffsetValid(false), depthTexture(0) { }
 
 #if 0
 		IDirect3DVertexBuffer9  * dxVerts;
@@ -117,6 +145,12 @@ protected:
 		ovrVector2f			 	  UVScaleOffset[2];
         Sizei                     TextureSize;
         Recti                     RenderViewport;
+        // UVScaleOffset is kept while the size and viewport submitted don't change.
+        bool                      UVScaleOffsetValid;
+
+        // Submitted with the eye for positional timewarp, or 0.
+        GLuint                    depthTexture;
+        float                     DepthProjection[3];
 	} eachEye[2];
 
     // GL context and utility variables.
@@ -125,12 +159,72 @@ protected:
 	// Helpers
     void initBuffersAndShaders();
     void initShaders();
+    ShaderSet* createDistortionShader(const char* shaderPrefix, const String& defines);
     void initFullscreenQuad();
     void destroy();
 	
     void setViewport(const Recti& vp);
 
-    void renderDistortion(Texture* leftEyeTexture, Texture* rightEyeTexture);
+    // What each eye is distorted with.
+    struct EyeDrawParams
+    {
+        ovrVector2f     UVScaleOffset[2];
+        ovrPosef        RenderPose;
+        // Times the timewarp rotations are predicted for; zeros for those of
+        // the current frame.
+        double          TimewarpStartEnd[2];
+        // The eye's depth for positional timewarp, or 0, and the terms of its
+        // projection the shader takes.
+        GLuint          DepthTexId;
+        float           DepthProjection[3];
+    };
+
+    void getEyeDrawParams(EyeDrawParams eyes[2]) const;
+    void renderDistortion(Texture* leftEyeTexture, Texture* rightEyeTexture,
+                          const EyeDrawParams eyes[2]);
+    // Draws both eyes with one call; used when they share a texture.
+    void renderDistortionBothEyes(Texture* eyeTexture, const EyeDrawParams eyes[2]);
+    int  getTimewarpRotations(int eyeNum, const EyeDrawParams& eye, float* start, float* end);
+    // Sets the eye's orientations when TimewarpSampled.
+    void setTimewarpSamples(int eyeNum, const EyeDrawParams& eye);
+
+    // With ovrDistortionCap_PixelDistortion, each eye is distorted by a fragment
+    // shader over its half of the screen, which reads the lens function from a
+    // table texture with a row per eye, sampled out to the farthest corner of the
+    // eye; no mesh is made, and the table only depends on the lens.
+    enum { PixelDistortionTableSize = 512 };
+
+    // What the shader needs of an eye besides EyeDrawParams, as its uniforms take it.
+    struct PixelDistortionEye
+    {
+        float LensCenterScale[4];
+        float EyeToSourceNDC[4];
+        float ChromaticAberration[4];
+        float TableCoords[3];
+        float TimewarpLerp[3];
+    };
+
+    void initPixelDistortion();
+    // Sets the positional timewarp uniforms of an eye; returns its depth texture.
+    Texture* setPositionalTimewarp(int eyeNum, const EyeDrawParams& eye);
+    void renderPixelDistortion(Texture* leftEyeTexture, Texture* rightEyeTexture,
+                               const EyeDrawParams eyes[2]);
+
+    // Gives TimeManager the time and count of the display's last vsync where
+    // GLX_OML_sync_control has them, and otherwise presentTime, the time a
+    // present was seen to finish at, if it isn't 0. Returns the time that was
+    // reported.
+    double reportPresentTime(double presentTime);
+
+    // Waits for the GPU to finish the commands issued so far, on a fence if
+    // there are fences and with glFinish otherwise.
+    void waitForGpu();
+    // Bracket the distortion draw with timestamp queries.
+    void beginDistortionTimer();
+    void endDistortionTimer();
+    // Hands the draw time measured by the queries in a slot to TimeManager,
+    // if they are done.
+    void readDistortionTimer(int slot);
 
     void renderPrimitives(const ShaderFill* fill, Buffer* vertices, Buffer* indices,
                           int offset, int count,
@@ -139,14 +233,138 @@ protected:
 	void createDrawQuad();
     void renderLatencyQuad(unsigned char* latencyTesterDrawColor);
     void renderLatencyPixel(unsigned char* latencyTesterPixelColor);
+
+    // With ovrDistortionCap_AsyncTimeWarp, distortion and swaps are done by a
+    // thread of its own, with a context sharing objects with the app's. Each
+    // EndFrame only hands it the frame's textures and poses, with a fence for the
+    // app's rendering of them, and the thread distorts the latest of them just
+    // before every vsync, whether the app has a new frame or not.
+    enum
+    {
+        // Longest an EndFrame waits for the thread to take the previous frame.
+        AsyncSubmitWaitMs           = 35,
+        // How often the thread checks for its exit until the first frame comes.
+        AsyncIdleWaitMs             = 10,
+        AsyncThreadRealTimePriority = 10
+    };
+    // Time the thread starts distortion before a vsync until it has measured it.
+    static const double AsyncDefaultLeadSeconds;
+
+    struct AsyncFrame
+    {
+        GLuint          TexIds[2];
+        Sizei           TextureSizes[2];
+        EyeDrawParams   Eyes[2];
+        GLsync          Fence;
+        bool            HasLatencyTesterColor;
+        bool            HasLatencyTester2Color;
+        unsigned char   LatencyTesterColor[3];
+        unsigned char   LatencyTester2Color[3];
+    };
+
+    bool startAsyncTimewarp();
+    void stopAsyncTimewarp();
+    void submitAsyncFrame(unsigned char* latencyTesterDrawColor, unsigned char* latencyTester2DrawColor);
+    static int asyncTimewarpThreadFn(Thread* thread, void* renderer);
+    int  runAsyncTimewarp(Thread* thread);
+    // Deletes the vertex arrays, which belong to the context that made them.
+    void deleteVertexArrays();
+
+    // With ovrDistortionCap_LateLatchedPose, a thread without a GL context keeps
+    // writing the orientations predicted for the next vsync into a persistently
+    // mapped uniform buffer, which the shaders read as they draw.
+    enum
+    {
+        // Start and end orientation of each eye, as quaternions.
+        LatchedPoseFloats       = 16,
+        LatchIntervalMs         = 1
+    };
+    // How long before a vsync the latched orientations are for it rather than
+    // for the vsync after; an estimate of the time distortion takes.
+    static const double LatchLeadSeconds;
+
+    bool startPoseLatching();
+    void stopPoseLatching();
+    static int poseLatchThreadFn(Thread* thread, void* renderer);
+    int  runPoseLatching(Thread* thread);
 	
+    // Wrap the application's eye textures; pSubmittedEyeTextures are these or
+    // swap textures, and are the ones distorted.
     Ptr<Texture>        pEyeTextures[2];
+    Ptr<Texture>        pSubmittedEyeTextures[2];
+
+    // Textures of the ovrSwapTextureSets created, set up when created.
+    struct SwapTexture
+    {
+        const ovrSwapTextureSet* pSet;
+        Ptr<Texture>             pTexture;
+    };
+    Array<SwapTexture>  SwapTextures;
+
+    Texture*            findSwapTexture(GLuint texId) const;
 
 	Ptr<Buffer>         DistortionMeshVBs[2];    // one per-eye
 	Ptr<Buffer>         DistortionMeshIBs[2];    // one per-eye
 	GLuint              DistortionMeshVAOs[2];   // one per-eye
 
+	// Both eye meshes in one buffer, each vertex tagged with its eye.
+	Ptr<Buffer>         BothEyesMeshVB;
+	Ptr<Buffer>         BothEyesMeshIB;
+	GLuint              BothEyesMeshVAO;
+
+	ProgramCache        ProgramBinaries;
 	Ptr<ShaderSet>      DistortionShader;
+	Ptr<ShaderSet>      BothEyesDistortionShader;
+
+    // Handles of the per-eye uniforms, found when the shaders are built.
+    struct DistortionUniforms
+    {
+        int EyeToSourceUVScale;
+        int EyeToSourceUVOffset;
+        int EyeRotationStart;
+        int EyeRotationEnd;
+
+        void Init(ShaderSet* shaders, const char* const names[4], bool timewarp);
+    }                   DistortionShaderUniforms, BothEyesShaderUniforms;
+
+    // True if DistortionShader takes the timewarp orientations of
+    // ovrDistortionCap_TimeWarpSamples, in the TimewarpSamples uniform.
+    bool                TimewarpSampled;
+    int                 TimewarpSamplesUniform;
+
+    PixelDistortionEye  PixelDistortionEyes[2];
+    GLuint              DistortionTableTexId;
+    Ptr<Texture>        DistortionTable;
+    // Bound for the draws, which have no vertex attributes.
+    GLuint              PixelDistortionVAO;
+
+    struct PixelDistortionUniforms
+    {
+        int LensCenterScale;
+        int EyeToSourceNDC;
+        int ChromaticAberration;
+        int TableCoords;
+        int TimewarpLerp;
+        int EyeIndex;
+        int DepthProjection;
+        int TimewarpTranslation;
+
+        void Init(ShaderSet* shaders);
+    }                   PixelShaderUniforms;
+    // Stands for each eye's depth texture in turn.
+    Ptr<Texture>        EyeDepthTexture;
+
+    // With GL 3.2, the shader drawing both eyes reads their parameters from
+    // this buffer instead.
+    Ptr<Buffer>         EyeUniformBuffer;
+    GLuint              EyeUniformBinding;
+
+    Ptr<Buffer>         LatchedPoseBuffer;
+    GLuint              LatchedPoseBinding;
+    // The buffer's mapping.
+    float*              LatchedPoses;
+    Ptr<Thread>         PoseLatchThread;
+    Event               PoseLatchThreadDone;
 
     struct StandardUniformData
     {
@@ -154,6 +372,13 @@ protected:
         Matrix4f  View;
     }                   StdUniforms;
 	
+    // Timestamps before and after the distortion draw, in two sets so that the
+    // queries of a frame are read the frame after, once the GPU is done with them.
+    enum { TimerSlots = 2 };
+    GLuint              TimerQueries[TimerSlots][2];
+    bool                TimerQueryPending[TimerSlots];
+    int                 TimerSlot;
+
 	GLuint              LatencyVAO;
     Ptr<Buffer>         LatencyTesterQuadVB;
     Ptr<ShaderSet>      SimpleQuadShader;
@@ -162,6 +387,22 @@ protected:
     Array<Ptr<Texture> >     DepthBuffers;
     GLuint                   CurrentFbo;
 
+    Ptr<Thread>         AsyncThread;
+    Lock                AsyncLock;
+    // Submitted and not yet taken by the thread.
+    AsyncFrame          PendingFrame;
+    bool                PendingFrameValid;
+    Event               PendingFrameTaken;
+    Event               FrameSubmitted;
+    Event               AsyncThreadStarted;
+    Event               AsyncThreadDone;
+    bool                AsyncThreadFailed;
+#if defined(OVR_OS_LINUX)
+    GLXContext          AsyncContext;
+    // GLX_OML_sync_control is there, and its timestamps are in our clock.
+    bool                SupportsSyncValues;
+#endif
+
 	GLint SavedViewport[4];
 	GLfloat SavedClearColor[4];
 	GLint SavedDepthTest;
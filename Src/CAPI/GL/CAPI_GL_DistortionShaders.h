@@ -74,9 +74,146 @@ namespace OVR { namespace CAPI { namespace GL {
     };
     
     
+    // Per-eye uniforms of the distortion vertex shaders. With _BOTH_EYES defined they
+    // become arrays indexed by the eye each vertex belongs to, so that a mesh holding
+    // both eyes can be drawn at once. With _EYE_UNIFORM_BLOCK as well, which needs
+    // GLSL 1.40, the arrays are members of a uniform block filled from one buffer.
+    // _TIMEWARP_QUATERNIONS makes the timewarp rotations quaternions instead of matrices.
+#define DISTORTION_EYE_UNIFORMS \
+    "#ifdef _TIMEWARP_QUATERNIONS\n" \
+    "#define _EYE_ROTATION vec4\n" \
+    "#else\n" \
+    "#define _EYE_ROTATION mat4\n" \
+    "#endif\n" \
+    "#if defined(_EYE_UNIFORM_BLOCK)\n" \
+    "layout(std140, row_major) uniform DistortionEyes\n" \
+    "{\n" \
+    "   vec4 EyeToSourceUVs[2];\n" \
+    "   _EYE_ROTATION EyeRotationStarts[2];\n" \
+    "   _EYE_ROTATION EyeRotationEnds[2];\n" \
+    "};\n" \
+    "_VS_IN float EyeIndex;\n" \
+    "#define EyeToSourceUVScale  EyeToSourceUVs[int(EyeIndex)].xy\n" \
+    "#define EyeToSourceUVOffset EyeToSourceUVs[int(EyeIndex)].zw\n" \
+    "#elif defined(_BOTH_EYES)\n" \
+    "uniform vec2 EyeToSourceUVScales[2];\n" \
+    "uniform vec2 EyeToSourceUVOffsets[2];\n" \
+    "_VS_IN float EyeIndex;\n" \
+    "#define EyeToSourceUVScale  EyeToSourceUVScales[int(EyeIndex)]\n" \
+    "#define EyeToSourceUVOffset EyeToSourceUVOffsets[int(EyeIndex)]\n" \
+    "#else\n" \
+    "uniform vec2 EyeToSourceUVScale;\n" \
+    "uniform vec2 EyeToSourceUVOffset;\n" \
+    "#endif\n"
+
+    // With _LATE_LATCHED_POSE, which needs _TIMEWARP_QUATERNIONS and GLSL 1.40, the
+    // rotation uniforms only undo the orientation an eye was rendered with, and the
+    // predicted orientations come from a block the CPU keeps writing while the GPU
+    // runs: the start and end of each eye, in turn. A write may be caught halfway,
+    // but consecutive orientations are so close that the normalized mix of two is
+    // still a good rotation.
+#define TIMEWARP_LATCHED_POSE \
+    "#ifdef _LATE_LATCHED_POSE\n" \
+    "#if !defined(_BOTH_EYES) && !defined(_EYE_INDEX_UNIFORM)\n" \
+    "_VS_IN float EyeIndex;\n" \
+    "#endif\n" \
+    "layout(std140) uniform LatchedPose\n" \
+    "{\n" \
+    "   vec4 LatchedOrientations[4];\n" \
+    "};\n" \
+    "vec4 QuatMul(vec4 a, vec4 b)\n" \
+    "{\n" \
+    "   return vec4(a.w * b.xyz + b.w * a.xyz + cross(a.xyz, b.xyz), a.w * b.w - dot(a.xyz, b.xyz));\n" \
+    "}\n" \
+    "#define TimewarpStart normalize(QuatMul(EyeRotationStart, LatchedOrientations[2 * int(EyeIndex)]))\n" \
+    "#define TimewarpEnd   normalize(QuatMul(EyeRotationEnd,   LatchedOrientations[2 * int(EyeIndex) + 1]))\n" \
+    "#else\n" \
+    "#define TimewarpStart EyeRotationStart\n" \
+    "#define TimewarpEnd   EyeRotationEnd\n" \
+    "#endif\n"
+
+    // With _TIMEWARP_SAMPLES, which needs _TIMEWARP_QUATERNIONS and one eye per
+    // draw, the eye has that many orientations spread evenly over its scan-out,
+    // and each point of the screen is rotated by the two around its timewarp
+    // factor, blended by its factor between them. Without it, the two are the
+    // start and end ones.
+#define TIMEWARP_SAMPLES \
+    "#if defined(_TIMEWARP_SAMPLES) && !defined(_LATE_LATCHED_POSE)\n" \
+    "uniform vec4 TimewarpSamples[_TIMEWARP_SAMPLES];\n" \
+    "#define TimewarpSegment(l)  int(clamp(floor((l) * float(_TIMEWARP_SAMPLES - 1)), 0.0, float(_TIMEWARP_SAMPLES - 2)))\n" \
+    "#define TimewarpStartAt(l)  TimewarpSamples[TimewarpSegment(l)]\n" \
+    "#define TimewarpEndAt(l)    TimewarpSamples[TimewarpSegment(l) + 1]\n" \
+    "#define TimewarpLerpAt(l)   ((l) * float(_TIMEWARP_SAMPLES - 1) - float(TimewarpSegment(l)))\n" \
+    "#else\n" \
+    "#define TimewarpStartAt(l)  TimewarpStart\n" \
+    "#define TimewarpEndAt(l)    TimewarpEnd\n" \
+    "#define TimewarpLerpAt(l)   (l)\n" \
+    "#endif\n"
+
+#define DISTORTION_TIMEWARP_EYE_UNIFORMS \
+    DISTORTION_EYE_UNIFORMS \
+    "#if defined(_BOTH_EYES)\n" \
+    "#if !defined(_EYE_UNIFORM_BLOCK)\n" \
+    "uniform _EYE_ROTATION EyeRotationStarts[2];\n" \
+    "uniform _EYE_ROTATION EyeRotationEnds[2];\n" \
+    "#endif\n" \
+    "#define EyeRotationStart EyeRotationStarts[int(EyeIndex)]\n" \
+    "#define EyeRotationEnd   EyeRotationEnds[int(EyeIndex)]\n" \
+    "#else\n" \
+    "uniform _EYE_ROTATION EyeRotationStart;\n" \
+    "uniform _EYE_ROTATION EyeRotationEnd;\n" \
+    "#endif\n" \
+    "#ifdef _TIMEWARP_QUATERNIONS\n" \
+    "vec3 TimewarpRotate(vec4 q, vec3 v)\n" \
+    "{\n" \
+    "   return v + 2.0 * cross(q.xyz, cross(q.xyz, v) + q.w * v);\n" \
+    "}\n" \
+    "#else\n" \
+    "vec3 TimewarpRotate(mat4 m, vec3 v)\n" \
+    "{\n" \
+    "   return (m * vec4(v, 0.0)).xyz;\n" \
+    "}\n" \
+    "#endif\n" \
+    TIMEWARP_LATCHED_POSE \
+    TIMEWARP_SAMPLES
+
+    static const char glslBothEyesDefine[] =
+    "#define _BOTH_EYES\n";
+
+    static const char glslBothEyesUniformBlockDefine[] =
+    "#define _BOTH_EYES\n"
+    "#define _EYE_UNIFORM_BLOCK\n";
+
+    static const char glslTimewarpQuaternionsDefine[] =
+    "#define _TIMEWARP_QUATERNIONS\n";
+
+    static const char glslLateLatchedPoseDefine[] =
+    "#define _LATE_LATCHED_POSE\n";
+
+    // The number of timewarp orientations per eye with _TIMEWARP_SAMPLES.
+    static const int TimewarpSampleCount = 8;
+
+    static const char glslTimewarpSamplesDefine[] =
+    "#define _TIMEWARP_SAMPLES 8\n";
+
+    static const char glslPositionalTimewarpDefine[] =
+    "#define _POSITIONAL_TIMEWARP\n";
+
+    static const char glslTimewarpDefine[] =
+    "#define _TIMEWARP\n";
+
+    static const char glslChromaticDefine[] =
+    "#define _CHROMATIC\n";
+
+    static const char glslVignetteDefine[] =
+    "#define _VIGNETTE\n";
+
+    // Size of the DistortionEyes block, in floats, with std140 layout and matrix
+    // rotations; quaternion rotations only take 4 floats each.
+    static const int DistortionEyesBlockFloats = 2 * 4 + 2 * 16 + 2 * 16;
+    
     static const char Distortion_vs[] =
-    "uniform vec2 EyeToSourceUVScale;\n"
-    "uniform vec2 EyeToSourceUVOffset;\n"
+    DISTORTION_EYE_UNIFORMS
     
     "_VS_IN vec2 Position;\n"
     "_VS_IN vec4 Color;\n"
@@ -120,10 +257,7 @@ namespace OVR { namespace CAPI { namespace GL {
     
     
     static const char DistortionTimewarp_vs[] =
-    "uniform vec2 EyeToSourceUVScale;\n"
-    "uniform vec2 EyeToSourceUVOffset;\n"
-    "uniform mat4 EyeRotationStart;\n"
-    "uniform mat4 EyeRotationEnd;\n"
+    DISTORTION_TIMEWARP_EYE_UNIFORMS
     
     "_VS_IN vec2 Position;\n"
     "_VS_IN vec4 Color;\n"
@@ -146,10 +280,10 @@ namespace OVR { namespace CAPI { namespace GL {
     // Accurate time warp lerp vs. faster
 #if 1
     // Apply the two 3x3 timewarp rotations to these vectors.
-	"   vec3 TransformedStart = (EyeRotationStart * vec4(TanEyeAngle, 0)).xyz;\n"
-	"   vec3 TransformedEnd   = (EyeRotationEnd * vec4(TanEyeAngle, 0)).xyz;\n"
+	"   vec3 TransformedStart = TimewarpRotate(TimewarpStartAt(Color.a), TanEyeAngle);\n"
+	"   vec3 TransformedEnd   = TimewarpRotate(TimewarpEndAt(Color.a), TanEyeAngle);\n"
     // And blend between them.
-    "   vec3 Transformed = mix ( TransformedStart, TransformedEnd, Color.a );\n"
+    "   vec3 Transformed = mix ( TransformedStart, TransformedEnd, TimewarpLerpAt(Color.a) );\n"
 #else
     "   mat4 EyeRotation = mix ( EyeRotationStart, EyeRotationEnd, Color.a );\n"
     "   vec3 Transformed   = EyeRotation * TanEyeAngle;\n"
@@ -175,8 +309,7 @@ namespace OVR { namespace CAPI { namespace GL {
     };
     
     static const char DistortionChroma_vs[] =
-    "uniform vec2 EyeToSourceUVScale;\n"
-    "uniform vec2 EyeToSourceUVOffset;\n"
+    DISTORTION_EYE_UNIFORMS
     
     "_VS_IN vec2 Position;\n"
     "_VS_IN vec4 Color;\n"
@@ -235,10 +368,7 @@ namespace OVR { namespace CAPI { namespace GL {
 
     
     static const char DistortionTimewarpChroma_vs[] =
-    "uniform vec2 EyeToSourceUVScale;\n"
-    "uniform vec2 EyeToSourceUVOffset;\n"
-    "uniform mat4 EyeRotationStart;\n"
-    "uniform mat4 EyeRotationEnd;\n"
+    DISTORTION_TIMEWARP_EYE_UNIFORMS
     
     "_VS_IN vec2 Position;\n"
     "_VS_IN vec4 Color;\n"
@@ -267,17 +397,17 @@ namespace OVR { namespace CAPI { namespace GL {
     // Accurate time warp lerp vs. faster
 #if 1
     // Apply the two 3x3 timewarp rotations to these vectors.
-	"   vec3 TransformedRStart = (EyeRotationStart * vec4(TanEyeAngleR, 0)).xyz;\n"
-	"   vec3 TransformedGStart = (EyeRotationStart * vec4(TanEyeAngleG, 0)).xyz;\n"
-	"   vec3 TransformedBStart = (EyeRotationStart * vec4(TanEyeAngleB, 0)).xyz;\n"
-	"   vec3 TransformedREnd   = (EyeRotationEnd * vec4(TanEyeAngleR, 0)).xyz;\n"
-	"   vec3 TransformedGEnd   = (EyeRotationEnd * vec4(TanEyeAngleG, 0)).xyz;\n"
-	"   vec3 TransformedBEnd   = (EyeRotationEnd * vec4(TanEyeAngleB, 0)).xyz;\n"
+	"   vec3 TransformedRStart = TimewarpRotate(TimewarpStartAt(Color.a), TanEyeAngleR);\n"
+	"   vec3 TransformedGStart = TimewarpRotate(TimewarpStartAt(Color.a), TanEyeAngleG);\n"
+	"   vec3 TransformedBStart = TimewarpRotate(TimewarpStartAt(Color.a), TanEyeAngleB);\n"
+	"   vec3 TransformedREnd   = TimewarpRotate(TimewarpEndAt(Color.a), TanEyeAngleR);\n"
+	"   vec3 TransformedGEnd   = TimewarpRotate(TimewarpEndAt(Color.a), TanEyeAngleG);\n"
+	"   vec3 TransformedBEnd   = TimewarpRotate(TimewarpEndAt(Color.a), TanEyeAngleB);\n"
     
     // And blend between them.
-    "   vec3 TransformedR = mix ( TransformedRStart, TransformedREnd, Color.a );\n"
-    "   vec3 TransformedG = mix ( TransformedGStart, TransformedGEnd, Color.a );\n"
-    "   vec3 TransformedB = mix ( TransformedBStart, TransformedBEnd, Color.a );\n"
+    "   vec3 TransformedR = mix ( TransformedRStart, TransformedREnd, TimewarpLerpAt(Color.a) );\n"
+    "   vec3 TransformedG = mix ( TransformedGStart, TransformedGEnd, TimewarpLerpAt(Color.a) );\n"
+    "   vec3 TransformedB = mix ( TransformedBStart, TransformedBEnd, TimewarpLerpAt(Color.a) );\n"
 #else
     "   mat3 EyeRotation;\n"
     "   EyeRotation[0] = mix ( EyeRotationStart[0], EyeRotationEnd[0], Color.a ).xyz;\n"
@@ -320,7 +450,112 @@ namespace OVR { namespace CAPI { namespace GL {
         { "EyeRotationStart",    OVR::CAPI::GL::ShaderBase::VARTYPE_FLOAT, 16, 64 },
         { "EyeRotationEnd",      OVR::CAPI::GL::ShaderBase::VARTYPE_FLOAT, 80, 64 },
     };
-    
+
+
+    // Per-pixel distortion, for ovrDistortionCap_PixelDistortion; needs GLSL 1.50.
+    // One triangle covers the viewport of an eye, and the fragment shader runs the
+    // mesh generation's mapping from screen to eye texture for every pixel, with
+    // the lens' scale for a squared radius read from the eye's row of Texture1.
+    // _TIMEWARP, _CHROMATIC and _VIGNETTE follow the distortion caps.
+    static const char DistortionPixel_vs[] =
+    "_VS_OUT vec2 oScreenNDC;\n"
+
+    "void main()\n"
+    "{\n"
+    "   vec2 Position = vec2(float((gl_VertexID & 1) * 4 - 1), float((gl_VertexID & 2) * 2 - 1));\n"
+    "   gl_Position = vec4(Position, 0.5, 1.0);\n"
+    // The screen NDC of the distortion functions has y going down.
+    "   oScreenNDC = vec2(Position.x, -Position.y);\n"
+    "}\n";
+
+    static const char DistortionPixel_fs[] =
+    "#define _EYE_INDEX_UNIFORM\n"
+    "uniform float EyeIndex;\n"
+    DISTORTION_TIMEWARP_EYE_UNIFORMS
+
+    "uniform sampler2D Texture0;\n"
+    "uniform sampler2D Texture1;\n"
+    // The eye's LensCenter and TanEyeAngleScale, and its FOV's EyeToSourceNDC.
+    "uniform vec4 LensCenterScale;\n"
+    "uniform vec4 EyeToSourceNDC;\n"
+    "uniform vec4 ChromaticAberration;\n"
+    // Scale and offset from squared radius to table coordinate, and the eye's row.
+    "uniform vec3 TableCoords;\n"
+    // Timewarp factor at the center of the eye, and its change with screen x and y.
+    "uniform vec3 TimewarpLerp;\n"
+
+    // With _POSITIONAL_TIMEWARP, Texture2 is the depth the eye was rendered with,
+    // DepthProjection the terms of its projection that give the depth of view z,
+    // and TimewarpTranslation where the eye is relative to where it rendered from.
+    "#ifdef _POSITIONAL_TIMEWARP\n"
+    "uniform sampler2D Texture2;\n"
+    "uniform vec3 DepthProjection;\n"
+    "uniform vec3 TimewarpTranslation;\n"
+    "#endif\n"
+
+    "_FS_IN vec2 oScreenNDC;\n"
+
+    "_FRAGCOLOR_DECLARATION\n"
+
+    "vec2 SourceUVOf(vec2 TanEyeAngle)\n"
+    "{\n"
+    "   vec2 UV = TanEyeAngle * EyeToSourceUVScale + EyeToSourceUVOffset;\n"
+    "   return vec2(UV.x, 1.0 - UV.y);\n"
+    "}\n"
+
+    "vec2 SourceUV(vec2 TanEyeAngle, float Lerp)\n"
+    "{\n"
+    "#ifdef _TIMEWARP\n"
+    "   vec3 Direction = vec3(TanEyeAngle, 1.0);\n"
+    "   vec3 Transformed = mix(TimewarpRotate(TimewarpStartAt(Lerp), Direction),\n"
+    "                          TimewarpRotate(TimewarpEndAt(Lerp), Direction), TimewarpLerpAt(Lerp));\n"
+    "#ifdef _POSITIONAL_TIMEWARP\n"
+    // The point seen along the ray from the eye is taken to be as deep as the
+    // rendered one in the direction the rotation alone gives, and then as the one
+    // in the direction found from that; two steps follow all but sharp edges.
+    "   vec3 Ray = Transformed;\n"
+    "   for (int i = 0; i < 2; i++)\n"
+    "   {\n"
+    "       float Ndc = _TEXTURELOD(Texture2, SourceUVOf(Transformed.xy / Transformed.z), 0.0).r * 2.0 - 1.0;\n"
+    "       float Depth = abs(DepthProjection.y / (Ndc * DepthProjection.z - DepthProjection.x));\n"
+    "       Transformed = Ray * ((Depth - TimewarpTranslation.z) / Ray.z) + TimewarpTranslation;\n"
+    "   }\n"
+    "#endif\n"
+    "   TanEyeAngle = Transformed.xy / Transformed.z;\n"
+    "#endif\n"
+    "   return SourceUVOf(TanEyeAngle);\n"
+    "}\n"
+
+    "void main()\n"
+    "{\n"
+    "   vec2 TanEyeAngleDistorted = (oScreenNDC - LensCenterScale.xy) * LensCenterScale.zw;\n"
+    "   float RadiusSquared = dot(TanEyeAngleDistorted, TanEyeAngleDistorted);\n"
+    "   float Scale = _TEXTURELOD(Texture1, vec2(RadiusSquared * TableCoords.x + TableCoords.y, TableCoords.z), 0.0).r;\n"
+    "   vec2 TanEyeAngleG = TanEyeAngleDistorted * Scale;\n"
+    "   float Lerp = TimewarpLerp.x + dot(TimewarpLerp.yz, oScreenNDC);\n"
+
+    "#ifdef _CHROMATIC\n"
+    "   vec2 TanEyeAngleR = TanEyeAngleG * (1.0 + ChromaticAberration.x + RadiusSquared * ChromaticAberration.y);\n"
+    "   vec2 TanEyeAngleB = TanEyeAngleG * (1.0 + ChromaticAberration.z + RadiusSquared * ChromaticAberration.w);\n"
+    "   vec3 Result = vec3(_TEXTURELOD(Texture0, SourceUV(TanEyeAngleR, Lerp), 0.0).r,\n"
+    "                      _TEXTURELOD(Texture0, SourceUV(TanEyeAngleG, Lerp), 0.0).g,\n"
+    "                      _TEXTURELOD(Texture0, SourceUV(TanEyeAngleB, Lerp), 0.0).b);\n"
+    "#else\n"
+    "   vec3 Result = _TEXTURELOD(Texture0, SourceUV(TanEyeAngleG, Lerp), 0.0).rgb;\n"
+    "#endif\n"
+
+    // Fade out at the edges of the rendered view and of the screen, as the mesh does.
+    "#ifdef _VIGNETTE\n"
+    "   vec2 SourceNDC = abs(TanEyeAngleG * EyeToSourceNDC.xy + EyeToSourceNDC.zw);\n"
+    "   vec2 ScreenNDC = abs(oScreenNDC);\n"
+    "   float EdgeFadeIn = min((1.0 - max(SourceNDC.x, SourceNDC.y)) * (1.0 / 0.075),\n"
+    "                          (1.0 - max(ScreenNDC.x, ScreenNDC.y)) * (2.0 / 0.075));\n"
+    "   Result *= clamp(EdgeFadeIn, 0.0, 1.0);\n"
+    "#endif\n"
+
+    "   _FRAGCOLOR = vec4(Result, 1.0);\n"
+    "}\n";
+
 }}} // OVR::CAPI::GL
 
 #endif // OVR_CAPI_GL_Shaders_h
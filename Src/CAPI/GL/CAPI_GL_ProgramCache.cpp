@@ -0,0 +1,226 @@
+/************************************************************************************
+
+Filename    :   CAPI_GL_ProgramCache.cpp
+Content     :   On-disk cache of linked GL program binaries
+Created     :   October 14, 2026
+
+Copyright   :   Copyright 2014 Oculus VR, Inc. All Rights reserved.
+
+Licensed under the Oculus VR Rift SDK License Version 3.1 (the "License");
+you may not use the Oculus VR Rift SDK except in compliance with the License,
+which is provided at the time of installation or download, or which
+otherwise accompanies this software in either electronic or hard copy form.
+
+You may obtain a copy of the License at
+
+http://www.oculusvr.com/licenses/LICENSE-3.1
+
+Unless required by applicable law or agreed to in writing, the Oculus VR SDK
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+*************************************************************************************/
+
+#include "CAPI_GL_ProgramCache.h"
+
+#include "../../OVR_Profile.h"
+#include "../../Kernel/OVR_MappedFile.h"
+#include "../../Kernel/OVR_SysFile.h"
+#include "../../Kernel/OVR_Alg.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+namespace OVR { namespace CAPI { namespace GL {
+
+// "OVRP", little-endian.
+static const UInt32 ProgramCacheMagic = 0x5052564F;
+
+static void appendBytes(Array<UByte>* data, const void* bytes, UPInt size)
+{
+    UPInt pos = data->GetSize();
+    data->Resize(pos + size);
+    if (size)
+        memcpy(&(*data)[pos], bytes, size);
+}
+
+static void appendString(Array<UByte>* data, const char* s)
+{
+    // With the terminator, so that neighbouring strings can't run together.
+    appendBytes(data, s, strlen(s) + 1);
+}
+
+static void appendUInt32(Array<UByte>* data, UInt32 value)
+{
+    UByte bytes[4];
+    Alg::EncodeUInt32(bytes, value);
+    appendBytes(data, bytes, 4);
+}
+
+ProgramCache::ProgramCache()
+    : Enabled(false)
+{
+}
+
+void ProgramCache::Init(int glMajorVersion, int glMinorVersion)
+{
+    Enabled = false;
+    Driver.Clear();
+
+    const char* setting = getenv("OVR_GL_PROGRAM_CACHE");
+    if (setting && !strcmp(setting, "0"))
+        return;
+
+#if !defined(OVR_OS_MAC)
+    if (!glGetProgramBinary || !glProgramBinary || !glProgramParameteri)
+        return;
+#endif
+
+    // Core contexts have no extension string; they need GL 4.1 here.
+    const char* extensions = (const char*)glGetString(GL_EXTENSIONS);
+    bool        supported  = (glMajorVersion > 4 || (glMajorVersion == 4 && glMinorVersion >= 1)) ||
+                             (extensions && strstr(extensions, "GL_ARB_get_program_binary"));
+    GLint       formatCount = 0;
+    if (supported)
+        glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formatCount);
+    if (formatCount <= 0)
+        return;
+
+    const char* vendor   = (const char*)glGetString(GL_VENDOR);
+    const char* renderer = (const char*)glGetString(GL_RENDERER);
+    const char* version  = (const char*)glGetString(GL_VERSION);
+    if (!vendor || !renderer || !version)
+        return;
+
+    Driver  = vendor;
+    Driver += "\n";
+    Driver += renderer;
+    Driver += "\n";
+    Driver += version;
+    Enabled = true;
+}
+
+void ProgramCache::makeKey(Array<UByte>* key, const ShaderSet* shaders,
+                           const char* vsSource, const char* fsSource) const
+{
+    appendString(key, Driver.ToCStr());
+    appendString(key, vsSource);
+    appendString(key, fsSource);
+    // Attribute bindings are linked into the binary.
+    for (int i = 0; i < shaders->GetAttribCount(); i++)
+        appendString(key, shaders->GetAttribName(i));
+}
+
+String ProgramCache::getPath(const Array<UByte>& key) const
+{
+    // FNV-1a; the file holds the whole key, so collisions only cost a compile.
+    UInt32 hash = 2166136261u;
+    for (UPInt i = 0; i < key.GetSize(); i++)
+        hash = (hash ^ key[i]) * 16777619u;
+
+    char name[32];
+    OVR_sprintf(name, sizeof(name), "/GLProgram_%08x.bin", hash);
+
+    String path = GetBaseOVRPath(true);
+    path += name;
+    return path;
+}
+
+// File layout, little-endian: magic, file version, key size and bytes, binary
+// format, binary size and bytes.
+bool ProgramCache::Load(ShaderSet* shaders, const char* vsSource, const char* fsSource)
+{
+    if (!Enabled)
+        return false;
+
+    // Binaries can only be retrieved from programs linked with this set.
+    glProgramParameteri(shaders->Prog, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+
+    Array<UByte> key;
+    makeKey(&key, shaders, vsSource, fsSource);
+
+    MappedFile file;
+    if (!file.Open(getPath(key)))
+        return false;
+
+    const UByte* data = file.GetData();
+    UPInt        size = (UPInt)file.GetLength();
+    if (size < 12 ||
+        Alg::DecodeUInt32(data) != ProgramCacheMagic ||
+        Alg::DecodeUInt32(data + 4) != FileVersion ||
+        Alg::DecodeUInt32(data + 8) != key.GetSize())
+        return false;
+
+    UPInt pos = 12;
+    if (size - pos < key.GetSize() + 8 ||
+        memcmp(data + pos, &key[0], key.GetSize()) != 0)
+        return false;
+    pos += key.GetSize();
+
+    GLenum format     = (GLenum)Alg::DecodeUInt32(data + pos);
+    UPInt  binarySize = Alg::DecodeUInt32(data + pos + 4);
+    pos += 8;
+    if (binarySize == 0 || size - pos < binarySize)
+        return false;
+
+    // A driver update that kept its version string may still reject it.
+    if (!shaders->SetProgramBinary(format, data + pos, (int)binarySize))
+    {
+        LogText("OVR::CAPI::GL::ProgramCache - driver rejected cached program, recompiling\n");
+        return false;
+    }
+    return true;
+}
+
+bool ProgramCache::Save(ShaderSet* shaders, const char* vsSource, const char* fsSource)
+{
+    if (!Enabled || !shaders->IsLinked())
+        return false;
+
+    GLenum       format = 0;
+    Array<UByte> binary;
+    if (!shaders->GetProgramBinary(&format, &binary))
+        return false;
+
+    Array<UByte> key;
+    makeKey(&key, shaders, vsSource, fsSource);
+
+    Array<UByte> data;
+    appendUInt32(&data, ProgramCacheMagic);
+    appendUInt32(&data, FileVersion);
+    appendUInt32(&data, (UInt32)key.GetSize());
+    appendBytes(&data, &key[0], key.GetSize());
+    appendUInt32(&data, (UInt32)format);
+    appendUInt32(&data, (UInt32)binary.GetSize());
+    appendBytes(&data, &binary[0], binary.GetSize());
+
+    // Write a new file and move it over the old one, so that a renderer reading
+    // it meanwhile never sees it half written.
+    String path     = getPath(key);
+    String tempPath = path + ".tmp";
+
+    SysFile file;
+    if (!file.Open(tempPath, File::Open_Write | File::Open_Create | File::Open_Truncate))
+    {
+        LogError("OVR::CAPI::GL::ProgramCache - can't write '%s'\n", tempPath.ToCStr());
+        return false;
+    }
+    bool written = file.Write(&data[0], (int)data.GetSize()) == (int)data.GetSize();
+    file.Close();
+
+#if defined(OVR_OS_WIN32)
+    // rename doesn't replace existing files on Windows.
+    if (written)
+        remove(path.ToCStr());
+#endif
+    if (!written || rename(tempPath.ToCStr(), path.ToCStr()) != 0)
+    {
+        remove(tempPath.ToCStr());
+        return false;
+    }
+    return true;
+}
+
+}}} // OVR::CAPI::GL
@@ -0,0 +1,74 @@
+/************************************************************************************
+
+Filename    :   CAPI_GL_ProgramCache.h
+Content     :   On-disk cache of linked GL program binaries
+Created     :   October 14, 2026
+
+Copyright   :   Copyright 2014 Oculus VR, Inc. All Rights reserved.
+
+Licensed under the Oculus VR Rift SDK License Version 3.1 (the "License");
+you may not use the Oculus VR Rift SDK except in compliance with the License,
+which is provided at the time of installation or download, or which
+otherwise accompanies this software in either electronic or hard copy form.
+
+You may obtain a copy of the License at
+
+http://www.oculusvr.com/licenses/LICENSE-3.1
+
+Unless required by applicable law or agreed to in writing, the Oculus VR SDK
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+*************************************************************************************/
+
+#ifndef OVR_CAPI_GL_ProgramCache_h
+#define OVR_CAPI_GL_ProgramCache_h
+
+#include "CAPI_GL_Util.h"
+
+namespace OVR { namespace CAPI { namespace GL {
+
+//-------------------------------------------------------------------------------------
+// ***** ProgramCache
+
+// Keeps the binaries of linked programs next to the profiles, one file per program,
+// so that later renderers load them instead of compiling and linking the shaders.
+// A file is keyed by the GL vendor, renderer and version strings, the shader
+// sources and the attribute bindings, and is only used if all of them match.
+// Drivers may still reject a binary, in which case the shaders are compiled as usual.
+//
+// Needs GL 4.1 or ARB_get_program_binary; otherwise nothing is cached. Setting the
+// OVR_GL_PROGRAM_CACHE environment variable to 0 turns the cache off.
+
+class ProgramCache
+{
+public:
+    enum { FileVersion = 1 };
+
+    ProgramCache();
+
+    // Checks what the current context supports.
+    void Init(int glMajorVersion, int glMinorVersion);
+
+    // Loads the program for these sources into the set, which must have its
+    // attribute locations but no shaders yet. If it isn't cached, marks the program
+    // so that its binary can be saved once it is linked, and returns false.
+    bool Load(ShaderSet* shaders, const char* vsSource, const char* fsSource);
+    // Writes the binary of the linked program.
+    bool Save(ShaderSet* shaders, const char* vsSource, const char* fsSource);
+
+private:
+    void   makeKey(Array<UByte>* key, const ShaderSet* shaders,
+                   const char* vsSource, const char* fsSource) const;
+    String getPath(const Array<UByte>& key) const;
+
+    bool   Enabled;
+    // GL vendor, renderer and version.
+    String Driver;
+};
+
+}}} // OVR::CAPI::GL
+
+#endif // OVR_CAPI_GL_ProgramCache_h
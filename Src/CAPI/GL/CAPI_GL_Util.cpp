@@ -48,6 +48,7 @@ PFNGLCLEARDEPTHPROC                      glClearDepth;
 PFNGLVIEWPORTPROC                        glViewport;
 PFNGLDRAWELEMENTSPROC                    glDrawElements;
 PFNGLTEXPARAMETERIPROC                   glTexParameteri;
+PFNGLTEXIMAGE2DPROC                      glTexImage2D;
 PFNGLFLUSHPROC                           glFlush;
 PFNGLFINISHPROC                          glFinish;
 PFNGLDRAWARRAYSPROC                      glDrawArrays;
@@ -61,6 +62,8 @@ PFNWGLSWAPINTERVALEXTPROC                wglSwapIntervalEXT;
 #elif defined(OVR_OS_LINUX)
 
 PFNGLXSWAPINTERVALEXTPROC                glXSwapIntervalEXT;
+PFNGLXCREATECONTEXTATTRIBSARBPROC        glXCreateContextAttribsARB;
+PFNGLXGETSYNCVALUESOMLPROC               glXGetSyncValuesOML;
 
 #endif
 
@@ -103,6 +106,23 @@ PFNGLUNIFORM1FVPROC                      glUniform1fv;
 PFNGLGENVERTEXARRAYSPROC                 glGenVertexArrays;
 PFNGLDELETEVERTEXARRAYSPROC              glDeleteVertexArrays;
 PFNGLBINDVERTEXARRAYPROC                 glBindVertexArray;
+PFNGLBINDBUFFERBASEPROC                  glBindBufferBase;
+PFNGLGETUNIFORMBLOCKINDEXPROC            glGetUniformBlockIndex;
+PFNGLUNIFORMBLOCKBINDINGPROC             glUniformBlockBinding;
+PFNGLGETPROGRAMBINARYPROC                glGetProgramBinary;
+PFNGLPROGRAMBINARYPROC                   glProgramBinary;
+PFNGLPROGRAMPARAMETERIPROC               glProgramParameteri;
+PFNGLGENQUERIESPROC                      glGenQueries;
+PFNGLDELETEQUERIESPROC                   glDeleteQueries;
+PFNGLQUERYCOUNTERPROC                    glQueryCounter;
+PFNGLGETQUERYOBJECTIVPROC                glGetQueryObjectiv;
+PFNGLGETQUERYOBJECTUI64VPROC             glGetQueryObjectui64v;
+PFNGLFENCESYNCPROC                       glFenceSync;
+PFNGLCLIENTWAITSYNCPROC                  glClientWaitSync;
+PFNGLWAITSYNCPROC                        glWaitSync;
+PFNGLDELETESYNCPROC                      glDeleteSync;
+PFNGLMAPBUFFERRANGEPROC                  glMapBufferRange;
+PFNGLBUFFERSTORAGEPROC                   glBufferStorage;
 
 
 #if defined(OVR_OS_WIN32)
@@ -149,6 +169,7 @@ void InitGLExtensions()
     glDeleteTextures =                  (PFNGLDELETETEXTURESPROC)                  GetProcAddress(hInst,"glDeleteTextures");
     glBindTexture =                     (PFNGLBINDTEXTUREPROC)                     GetProcAddress(hInst,"glBindTexture");
 	glTexParameteri =                   (PFNGLTEXPARAMETERIPROC)                   GetProcAddress(hInst, "glTexParameteri");
+	glTexImage2D =                      (PFNGLTEXIMAGE2DPROC)                      GetProcAddress(hInst, "glTexImage2D");
 
     wglGetProcAddress =                 (PFNWGLGETPROCADDRESS)                     GetProcAddress(hInst, "wglGetProcAddress");
 
@@ -156,12 +177,31 @@ void InitGLExtensions()
     wglSwapIntervalEXT =                (PFNWGLSWAPINTERVALEXTPROC)                GetFunction("wglSwapIntervalEXT");
 #elif defined(OVR_OS_LINUX)
     glXSwapIntervalEXT =                (PFNGLXSWAPINTERVALEXTPROC)                GetFunction("glXSwapIntervalEXT");
+    glXCreateContextAttribsARB =        (PFNGLXCREATECONTEXTATTRIBSARBPROC)        GetFunction("glXCreateContextAttribsARB");
+    glXGetSyncValuesOML =               (PFNGLXGETSYNCVALUESOMLPROC)               GetFunction("glXGetSyncValuesOML");
 #endif
 
     glBindFramebuffer =                 (PFNGLBINDFRAMEBUFFERPROC)                 GetFunction("glBindFramebufferEXT");
     glGenVertexArrays =                 (PFNGLGENVERTEXARRAYSPROC)                 GetFunction("glGenVertexArrays");
     glDeleteVertexArrays =              (PFNGLDELETEVERTEXARRAYSPROC)              GetFunction("glDeleteVertexArrays");
     glBindVertexArray =                 (PFNGLBINDVERTEXARRAYPROC)                 GetFunction("glBindVertexArray");
+    glBindBufferBase =                  (PFNGLBINDBUFFERBASEPROC)                  GetFunction("glBindBufferBase");
+    glGetUniformBlockIndex =            (PFNGLGETUNIFORMBLOCKINDEXPROC)            GetFunction("glGetUniformBlockIndex");
+    glUniformBlockBinding =             (PFNGLUNIFORMBLOCKBINDINGPROC)             GetFunction("glUniformBlockBinding");
+    glGetProgramBinary =                (PFNGLGETPROGRAMBINARYPROC)                GetFunction("glGetProgramBinary");
+    glProgramBinary =                   (PFNGLPROGRAMBINARYPROC)                   GetFunction("glProgramBinary");
+    glProgramParameteri =               (PFNGLPROGRAMPARAMETERIPROC)               GetFunction("glProgramParameteri");
+    glGenQueries =                      (PFNGLGENQUERIESPROC)                      GetFunction("glGenQueries");
+    glDeleteQueries =                   (PFNGLDELETEQUERIESPROC)                   GetFunction("glDeleteQueries");
+    glQueryCounter =                    (PFNGLQUERYCOUNTERPROC)                    GetFunction("glQueryCounter");
+    glGetQueryObjectiv =                (PFNGLGETQUERYOBJECTIVPROC)                GetFunction("glGetQueryObjectiv");
+    glGetQueryObjectui64v =             (PFNGLGETQUERYOBJECTUI64VPROC)             GetFunction("glGetQueryObjectui64v");
+    glFenceSync =                       (PFNGLFENCESYNCPROC)                       GetFunction("glFenceSync");
+    glClientWaitSync =                  (PFNGLCLIENTWAITSYNCPROC)                  GetFunction("glClientWaitSync");
+    glWaitSync =                        (PFNGLWAITSYNCPROC)                        GetFunction("glWaitSync");
+    glDeleteSync =                      (PFNGLDELETESYNCPROC)                      GetFunction("glDeleteSync");
+    glMapBufferRange =                  (PFNGLMAPBUFFERRANGEPROC)                  GetFunction("glMapBufferRange");
+    glBufferStorage =                   (PFNGLBUFFERSTORAGEPROC)                   GetFunction("glBufferStorage");
     glGenBuffers =                      (PFNGLGENBUFFERSPROC)                      GetFunction("glGenBuffers");
     glDeleteBuffers =                   (PFNGLDELETEBUFFERSPROC)                   GetFunction("glDeleteBuffers");
     glBindBuffer =                      (PFNGLBINDBUFFERPROC)                      GetFunction("glBindBuffer");	
@@ -219,6 +259,7 @@ bool Buffer::Data(int use, const void* buffer, size_t size)
     switch (use & Buffer_TypeMask)
     {
     case Buffer_Index:     Use = GL_ELEMENT_ARRAY_BUFFER; break;
+    case Buffer_Uniform:   Use = GL_UNIFORM_BUFFER; break;
     default:               Use = GL_ARRAY_BUFFER; break;
     }
 
@@ -245,6 +286,33 @@ void* Buffer::Map(size_t, size_t, int)
     return v;
 }
 
+void* Buffer::MapPersistent(int use, size_t size)
+{
+#if !defined(OVR_OS_MAC)
+    if (!glBufferStorage || !glMapBufferRange || GLBuffer)
+        return NULL;
+
+    Size = size;
+
+    switch (use & Buffer_TypeMask)
+    {
+    case Buffer_Index:     Use = GL_ELEMENT_ARRAY_BUFFER; break;
+    case Buffer_Uniform:   Use = GL_UNIFORM_BUFFER; break;
+    default:               Use = GL_ARRAY_BUFFER; break;
+    }
+
+    const GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+
+    glGenBuffers(1, &GLBuffer);
+    glBindBuffer(Use, GLBuffer);
+    glBufferStorage(Use, size, NULL, flags);
+    return glMapBufferRange(Use, 0, size, flags);
+#else
+    OVR_UNUSED2(use, size);
+    return NULL;
+#endif
+}
+
 bool Buffer::Unmap(void*)
 {
     glBindBuffer(Use, GLBuffer);
@@ -253,6 +321,7 @@ bool Buffer::Unmap(void*)
 }
 
 ShaderSet::ShaderSet()
+    : AttribNames(NULL), AttribCount(0), Linked(false)
 {
     Prog = glCreateProgram();
 }
@@ -300,27 +369,61 @@ void ShaderSet::UnsetShader(int stage)
 }
 
 bool ShaderSet::SetUniform(const char* name, int n, const float* v)
+{
+    return SetUniform(GetUniformHandle(name), n, v);
+}
+
+int ShaderSet::GetUniformHandle(const char* name) const
 {
     for (unsigned int i = 0; i < UniformInfo.GetSize(); i++)
         if (!strcmp(UniformInfo[i].Name.ToCStr(), name))
-        {
-            OVR_ASSERT(UniformInfo[i].Location >= 0);
-            glUseProgram(Prog);
-            switch (UniformInfo[i].Type)
-            {
-            case 1:   glUniform1fv(UniformInfo[i].Location, n, v); break;
-            case 2:   glUniform2fv(UniformInfo[i].Location, n/2, v); break;
-            case 3:   glUniform3fv(UniformInfo[i].Location, n/3, v); break;
-            case 4:   glUniform4fv(UniformInfo[i].Location, n/4, v); break;
-            case 12:  glUniformMatrix3fv(UniformInfo[i].Location, 1, 1, v); break;
-            case 16:  glUniformMatrix4fv(UniformInfo[i].Location, 1, 1, v); break;
-            default: OVR_ASSERT(0);
-            }
-            return 1;
-        }
+            return (int)i;
 
     OVR_DEBUG_LOG(("Warning: uniform %s not present in selected shader", name));
-    return 0;
+    return -1;
+}
+
+bool ShaderSet::SetUniform(int handle, int n, const float* v)
+{
+    if (handle < 0)
+        return 0;
+
+    const Uniform& u = UniformInfo[handle];
+    OVR_ASSERT(u.Location >= 0);
+    glUseProgram(Prog);
+    switch (u.Type)
+    {
+    case 1:   glUniform1fv(u.Location, n, v); break;
+    case 2:   glUniform2fv(u.Location, n/2, v); break;
+    case 3:   glUniform3fv(u.Location, n/3, v); break;
+    case 4:   glUniform4fv(u.Location, n/4, v); break;
+    case 12:  glUniformMatrix3fv(u.Location, 1, 1, v); break;
+    case 16:  glUniformMatrix4fv(u.Location, n/16, 1, v); break;
+    default: OVR_ASSERT(0);
+    }
+    return 1;
+}
+
+bool ShaderSet::SetUniformBlockBinding(const char* blockName, GLuint binding)
+{
+    GLuint index = glGetUniformBlockIndex(Prog, blockName);
+    if (index == GL_INVALID_INDEX)
+        return 0;
+
+    glUniformBlockBinding(Prog, index, binding);
+    return 1;
+}
+
+void ShaderSet::SetAttribLocations(const char* const* names, int count)
+{
+    OVR_ASSERT(count <= MaxAttribs);
+    AttribNames = names;
+    AttribCount = count;
+    for (int i = 0; i < count; i++)
+    {
+        glBindAttribLocation(Prog, i, names[i]);
+        AttribLocs[i] = -1;
+    }
 }
 
 bool ShaderSet::Link()
@@ -336,8 +439,47 @@ bool ShaderSet::Link()
         if (!r)
             return 0;
     }
+
+    initProgram();
+    return 1;
+}
+
+bool ShaderSet::SetProgramBinary(GLenum format, const void* data, int size)
+{
+    glProgramBinary(Prog, format, data, size);
+    GLint r;
+    glGetProgramiv(Prog, GL_LINK_STATUS, &r);
+    if (!r)
+        return 0;
+
+    initProgram();
+    return 1;
+}
+
+bool ShaderSet::GetProgramBinary(GLenum* format, Array<UByte>* data) const
+{
+    GLint size = 0;
+    if (Linked)
+        glGetProgramiv(Prog, GL_PROGRAM_BINARY_LENGTH, &size);
+    if (size <= 0)
+        return 0;
+
+    data->Resize(size);
+    GLsizei length = 0;
+    glGetProgramBinary(Prog, size, &length, format, &(*data)[0]);
+    data->Resize(length);
+    return length > 0;
+}
+
+void ShaderSet::initProgram()
+{
+    Linked = true;
     glUseProgram(Prog);
 
+    // Attributes the program doesn't use keep -1.
+    for (int i = 0; i < AttribCount; i++)
+        AttribLocs[i] = glGetAttribLocation(Prog, AttribNames[i]);
+
     UniformInfo.Clear();
     LightingVer = 0;
     UsesLighting = 0;
@@ -401,7 +543,6 @@ bool ShaderSet::Link()
     }
     if (UsesLighting)
         OVR_ASSERT(ProjLoc >= 0 && ViewLoc >= 0);
-    return 1;
 }
 
 bool ShaderBase::SetUniform(const char* name, int n, const float* v)
@@ -454,7 +595,7 @@ void ShaderBase::InitUniforms(const Uniform* refl, size_t reflSize)
     UniformData = (unsigned char*)OVR_ALLOC(UniformsSize);
 }
 
-Texture::Texture(RenderParams* rp, int w, int h) : IsUserAllocated(true), pParams(rp), TexId(0), Width(w), Height(h)
+Texture::Texture(RenderParams* rp, int w, int h) : IsUserAllocated(!(w && h)), pParams(rp), TexId(0), Width(w), Height(h)
 {
 	if (w && h)
 		glGenTextures(1, &TexId);
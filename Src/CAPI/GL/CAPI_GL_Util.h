@@ -78,6 +78,7 @@ typedef void (__stdcall *PFNGLBINDTEXTUREPROC) (GLenum target, GLuint texture);
 typedef void (__stdcall *PFNGLCLEARCOLORPROC) (GLfloat r, GLfloat g, GLfloat b, GLfloat a);
 typedef void (__stdcall *PFNGLCLEARDEPTHPROC) (GLclampd depth);
 typedef void (__stdcall *PFNGLTEXPARAMETERIPROC) (GLenum target, GLenum pname, GLint param);
+typedef void (__stdcall *PFNGLTEXIMAGE2DPROC) (GLenum target, GLint level, GLint internalformat, GLsizei width, GLsizei height, GLint border, GLenum format, GLenum type, const GLvoid *pixels);
 typedef void (__stdcall *PFNGLVIEWPORTPROC) (GLint x, GLint y, GLsizei width, GLsizei height);
 
 extern PFNWGLGETPROCADDRESS                     wglGetProcAddress;
@@ -100,12 +101,15 @@ extern PFNGLGENTEXTURESPROC                     glGenTextures;
 extern PFNGLDELETETEXTURESPROC                  glDeleteTextures;
 extern PFNGLBINDTEXTUREPROC                     glBindTexture;
 extern PFNGLTEXPARAMETERIPROC                   glTexParameteri;
+extern PFNGLTEXIMAGE2DPROC                      glTexImage2D;
 extern PFNGLFLUSHPROC                           glFlush;
 extern PFNGLFINISHPROC                          glFinish;
 
 #elif defined(OVR_OS_LINUX)
 
 extern PFNGLXSWAPINTERVALEXTPROC                glXSwapIntervalEXT;
+extern PFNGLXCREATECONTEXTATTRIBSARBPROC        glXCreateContextAttribsARB;
+extern PFNGLXGETSYNCVALUESOMLPROC               glXGetSyncValuesOML;
 
 #endif // defined(OVR_OS_WIN32)
 
@@ -147,6 +151,23 @@ extern PFNGLUNIFORM1FVPROC                      glUniform1fv;
 extern PFNGLGENVERTEXARRAYSPROC                 glGenVertexArrays;
 extern PFNGLDELETEVERTEXARRAYSPROC              glDeleteVertexArrays;
 extern PFNGLBINDVERTEXARRAYPROC                 glBindVertexArray;
+extern PFNGLBINDBUFFERBASEPROC                  glBindBufferBase;
+extern PFNGLGETUNIFORMBLOCKINDEXPROC            glGetUniformBlockIndex;
+extern PFNGLUNIFORMBLOCKBINDINGPROC             glUniformBlockBinding;
+extern PFNGLGETPROGRAMBINARYPROC                glGetProgramBinary;
+extern PFNGLPROGRAMBINARYPROC                   glProgramBinary;
+extern PFNGLPROGRAMPARAMETERIPROC               glProgramParameteri;
+extern PFNGLGENQUERIESPROC                      glGenQueries;
+extern PFNGLDELETEQUERIESPROC                   glDeleteQueries;
+extern PFNGLQUERYCOUNTERPROC                    glQueryCounter;
+extern PFNGLGETQUERYOBJECTIVPROC                glGetQueryObjectiv;
+extern PFNGLGETQUERYOBJECTUI64VPROC             glGetQueryObjectui64v;
+extern PFNGLFENCESYNCPROC                       glFenceSync;
+extern PFNGLCLIENTWAITSYNCPROC                  glClientWaitSync;
+extern PFNGLWAITSYNCPROC                        glWaitSync;
+extern PFNGLDELETESYNCPROC                      glDeleteSync;
+extern PFNGLMAPBUFFERRANGEPROC                  glMapBufferRange;
+extern PFNGLBUFFERSTORAGEPROC                   glBufferStorage;
 
 extern void InitGLExtensions();
 
@@ -251,6 +272,9 @@ public:
     virtual void*  Map(size_t start, size_t size, int flags = 0);
     virtual bool   Unmap(void *m);
     virtual bool   Data(int use, const void* buffer, size_t size);
+    // Allocates storage that stays mapped for writing, coherently, until the buffer
+    // is deleted; needs GL 4.4 or ARB_buffer_storage. Returns the mapping, or null.
+    void*          MapPersistent(int use, size_t size);
 };
 
 class Texture : public RefCountBase<Texture>
@@ -262,6 +286,7 @@ public:
     GLuint        TexId;
     int           Width, Height;
 
+    // Given a size, creates a texture of its own, deleted with it.
     Texture(RenderParams* rp, int w, int h);
     ~Texture();
 
@@ -316,6 +341,11 @@ protected:
         int    Type; // currently number of floats in vector
     };
     Array<Uniform> UniformInfo;
+
+    enum { MaxAttribs = 8 };
+    const char* const* AttribNames;
+    int                AttribCount;
+    GLint              AttribLocs[MaxAttribs];
 	
 public:
 	GLuint    Prog;
@@ -344,6 +374,36 @@ public:
     // uniforms from one shader occupy the same space as those in other shaders
     // (unless a buffer is used, then each buffer is independent).     
     virtual bool SetUniform(const char* name, int n, const float* v);
+
+    // Uniforms can also be found once, after the shaders are set, and then set by
+    // handle, without looking up their name. Returns -1 for uniforms the program
+    // doesn't have; setting those does nothing.
+    int  GetUniformHandle(const char* name) const;
+    bool SetUniform(int handle, int n, const float* v);
+
+    // Attaches the uniform block to a uniform buffer binding point; returns false if
+    // the program has no such block. Needs GL 3.1.
+    bool SetUniformBlockBinding(const char* blockName, GLuint binding);
+
+    // Binds the attributes to locations 0 to count-1 when the shaders are linked,
+    // so that the vertex layout can be set up without querying them; call this
+    // before SetShader. The names must outlive the ShaderSet.
+    void SetAttribLocations(const char* const* names, int count);
+    int  GetAttribCount() const { return AttribCount; }
+    const char* GetAttribName(int i) const { return AttribNames[i]; }
+    // Location of an attribute given to SetAttribLocations, or -1 if the program
+    // doesn't use it.
+    GLint GetAttribLocation(int i) const { return AttribLocs[i]; }
+
+    // True once the shaders are linked or a program binary is loaded.
+    bool IsLinked() const { return Linked; }
+
+    // Program binaries, as made by glGetProgramBinary (GL 4.1 or
+    // ARB_get_program_binary). SetProgramBinary stands in for setting and linking
+    // the shaders; it returns false if the driver rejects the binary, after which
+    // the shaders can still be set.
+    bool SetProgramBinary(GLenum format, const void* data, int size);
+    bool GetProgramBinary(GLenum* format, Array<UByte>* data) const;
     bool SetUniform1f(const char* name, float x)
     {
         const float v[] = {x};
@@ -380,6 +440,10 @@ public:
 protected:
 	GLint GetGLShader(Shader* s);
     bool Link();
+    // Reads the locations of uniforms and attributes of the linked program.
+    void initProgram();
+
+    bool Linked;
 };
 
 
@@ -29,6 +29,7 @@ limitations under the License.
 #define OVR_Alg_h
 
 #include "OVR_Types.h"
+#include "OVR_Allocator.h"
 #include <string.h>
 
 namespace OVR { namespace Alg {
@@ -433,26 +434,457 @@ void InsertionSort(Array& arr)
     InsertionSortSliced(arr, 0, arr.GetSize(), OperatorLess<ValueType>::Compare);
 }
 
+//-----------------------------------------------------------------------------------
+// ***** HeapSortSliced
+//
+// Sort any part of any array: plain, Array, ArrayPaged, ArrayUnsafe.
+// The range is specified with start, end, where "end" is exclusive!
+// The comparison predicate must be specified.
+// Slower than Quick Sort on average, but O(N*log(N)) in the worst case
+// and needs no extra memory. Used by IntroSort to bound its worst case.
+template<class Array, class Less> 
+void HeapSiftDown(Array& arr, UPInt start, UPInt root, UPInt size, Less less)
+{
+    UPInt child;
+    while((child = 2 * root + 1) < size)
+    {
+        if(child + 1 < size && less(arr[start + child], arr[start + child + 1]))
+        {
+            child++;
+        }
+        if(!less(arr[start + root], arr[start + child]))
+        {
+            return;
+        }
+        Swap(arr[start + root], arr[start + child]);
+        root = child;
+    }
+}
+
+template<class Array, class Less> 
+void HeapSortSliced(Array& arr, UPInt start, UPInt end, Less less)
+{
+    UPInt size = end - start;
+    if(size < 2) return;
+
+    for(UPInt i = size / 2; i-- > 0; )
+    {
+        HeapSiftDown(arr, start, i, size, less);
+    }
+    for(UPInt i = size - 1; i > 0; i--)
+    {
+        Swap(arr[start], arr[start + i]);
+        HeapSiftDown(arr, start, 0, i, less);
+    }
+}
+
+
+//-----------------------------------------------------------------------------------
+// ***** HeapSortSliced
+//
+// Sort any part of any array: plain, Array, ArrayPaged, ArrayUnsafe.
+// The range is specified with start, end, where "end" is exclusive!
+// The data type must have a defined "<" operator.
+template<class Array> 
+void HeapSortSliced(Array& arr, UPInt start, UPInt end)
+{
+    typedef typename Array::ValueType ValueType;
+    HeapSortSliced(arr, start, end, OperatorLess<ValueType>::Compare);
+}
+
+
+//-----------------------------------------------------------------------------------
+// ***** IntroSortSliced
+//
+// Sort any part of any array: plain, Array, ArrayPaged, ArrayUnsafe.
+// The range is specified with start, end, where "end" is exclusive!
+// The comparison predicate must be specified.
+// Quick Sort with a median-of-three pivot, which switches to Heap Sort
+// when the partitions get too deep, so it's O(N*log(N)) even on inputs
+// that make plain Quick Sort quadratic. Short partitions are left for a
+// single Insertion Sort pass over the whole range at the end.
+template<class Array, class Less> 
+void IntroSortPartition(Array& arr, UPInt start, UPInt end, UPInt depth, Less less)
+{
+    enum 
+    {
+        Threshold = 16
+    };
+
+    while(end - start > Threshold)
+    {
+        if(depth == 0)
+        {
+            HeapSortSliced(arr, start, end, less);
+            return;
+        }
+        depth--;
+
+        // Order the first, middle and last elements, then move the median to
+        // the start. The two others then bound both scans below.
+        UPInt mid  = start + (end - start) / 2;
+        UPInt last = end - 1;
+        if(less(arr[mid],  arr[start])) Swap(arr[mid],  arr[start]);
+        if(less(arr[last], arr[mid]))   Swap(arr[last], arr[mid]);
+        if(less(arr[mid],  arr[start])) Swap(arr[mid],  arr[start]);
+        Swap(arr[start], arr[mid]);
+
+        UPInt i = start;
+        UPInt j = end;
+        for(;;)
+        {
+            do i++; while(less(arr[i], arr[start]));
+            do j--; while(less(arr[start], arr[j]));
+            if(i >= j)
+            {
+                break;
+            }
+            Swap(arr[i], arr[j]);
+        }
+        Swap(arr[start], arr[j]);
+
+        // Recurse into the smaller side, so the stack stays O(log(N)) deep
+        if(j - start < end - j - 1)
+        {
+            IntroSortPartition(arr, start, j, depth, less);
+            start = j + 1;
+        }
+        else
+        {
+            IntroSortPartition(arr, j + 1, end, depth, less);
+            end = j;
+        }
+    }
+}
+
+template<class Array, class Less> 
+void IntroSortSliced(Array& arr, UPInt start, UPInt end, Less less)
+{
+    if(end - start < 2) return;
+
+    UPInt depth = 0;
+    for(UPInt size = end - start; size > 1; size >>= 1)
+    {
+        depth += 2;
+    }
+    IntroSortPartition(arr, start, end, depth, less);
+    InsertionSortSliced(arr, start, end, less);
+}
+
+
+//-----------------------------------------------------------------------------------
+// ***** IntroSortSliced
+//
+// Sort any part of any array: plain, Array, ArrayPaged, ArrayUnsafe.
+// The range is specified with start, end, where "end" is exclusive!
+// The data type must have a defined "<" operator.
+template<class Array> 
+void IntroSortSliced(Array& arr, UPInt start, UPInt end)
+{
+    typedef typename Array::ValueType ValueType;
+    IntroSortSliced(arr, start, end, OperatorLess<ValueType>::Compare);
+}
+
+
+//-----------------------------------------------------------------------------------
+// ***** IntroSort
+//
+// Sort an array Array, ArrayPaged, ArrayUnsafe.
+// The array must have GetSize() function.
+// The comparison predicate must be specified.
+template<class Array, class Less> 
+void IntroSort(Array& arr, Less less)
+{
+    IntroSortSliced(arr, 0, arr.GetSize(), less);
+}
+
+//-----------------------------------------------------------------------------------
+// ***** IntroSort
+//
+// Sort an array Array, ArrayPaged, ArrayUnsafe.
+// The array must have GetSize() function.
+// The data type must have a defined "<" operator.
+template<class Array> 
+void IntroSort(Array& arr)
+{
+    typedef typename Array::ValueType ValueType;
+    IntroSortSliced(arr, 0, arr.GetSize(), OperatorLess<ValueType>::Compare);
+}
+
+
+//-----------------------------------------------------------------------------------
+// ***** RadixKey
+//
+// Maps a sort key to an unsigned integer of the same size whose order is the
+// key's order, so RadixSort can sort it by its bytes. Signed integers get
+// their sign bit flipped; floats get all bits flipped when negative and the
+// sign bit set otherwise. NaNs sort after everything else (or before it for
+// negative NaNs).
+template<class T> struct RadixKey;
+
+template<> struct RadixKey<UInt16>
+{
+    typedef UInt16 UnsignedType;
+    static UnsignedType Get(UInt16 k) { return k; }
+};
+template<> struct RadixKey<SInt16>
+{
+    typedef UInt16 UnsignedType;
+    static UnsignedType Get(SInt16 k) { return UnsignedType((UInt16)k ^ 0x8000u); }
+};
+template<> struct RadixKey<UInt32>
+{
+    typedef UInt32 UnsignedType;
+    static UnsignedType Get(UInt32 k) { return k; }
+};
+template<> struct RadixKey<SInt32>
+{
+    typedef UInt32 UnsignedType;
+    static UnsignedType Get(SInt32 k) { return (UInt32)k ^ 0x80000000u; }
+};
+template<> struct RadixKey<UInt64>
+{
+    typedef UInt64 UnsignedType;
+    static UnsignedType Get(UInt64 k) { return k; }
+};
+template<> struct RadixKey<SInt64>
+{
+    typedef UInt64 UnsignedType;
+    static UnsignedType Get(SInt64 k) { return (UInt64)k ^ (UInt64(1) << 63); }
+};
+template<> struct RadixKey<float>
+{
+    typedef UInt32 UnsignedType;
+    static UnsignedType Get(float k)
+    {
+        UInt32 u;
+        memcpy(&u, &k, sizeof(u));
+        return (u & 0x80000000u) ? ~u : (u | 0x80000000u);
+    }
+};
+template<> struct RadixKey<double>
+{
+    typedef UInt64 UnsignedType;
+    static UnsignedType Get(double k)
+    {
+        const UInt64 signBit = UInt64(1) << 63;
+        UInt64 u;
+        memcpy(&u, &k, sizeof(u));
+        return (u & signBit) ? ~u : (u | signBit);
+    }
+};
+
+// Key function sorting the values themselves.
+template<class T> struct RadixIdentity
+{
+    static T Get(const T& v) { return v; }
+};
+
+// Compares values by their keys, for short ranges and for when RadixSort can't
+// get its buffer.
+template<class T, class K> struct RadixKeyLess
+{
+    K (*KeyOf)(const T&);
+    RadixKeyLess(K (*keyOf)(const T&)) : KeyOf(keyOf) {}
+    bool operator()(const T& a, const T& b) const
+    {
+        return RadixKey<K>::Get(KeyOf(a)) < RadixKey<K>::Get(KeyOf(b));
+    }
+};
+
+
+//-----------------------------------------------------------------------------------
+// ***** RadixSortSliced
+//
+// Sort any part of any array: plain, Array, ArrayPaged, ArrayUnsafe.
+// The range is specified with start, end, where "end" is exclusive!
+// keyOf returns the key of a value; the key type must have a RadixKey.
+// Stable LSD radix sort, one pass per key byte, in O(N) time for a given key
+// size. The counts for all passes are taken in one read of the keys, and a
+// pass is skipped when every key has the same byte there, so small integer
+// keys cost only one or two passes. Needs a temporary copy of the range, so
+// ValueType must be POD (it's copied by assignment into raw memory). Best for
+// large arrays of numeric keys; for short ones IntroSort is faster, and ranges
+// up to RadixSortMinSize are sorted in place by Insertion Sort, which is
+// stable too.
+enum { RadixSortMinSize = 32 };
+
+template<class Array, class K> 
+void RadixSortSliced(Array& arr, UPInt start, UPInt end,
+                     K (*keyOf)(const typename Array::ValueType&))
+{
+    typedef typename Array::ValueType         ValueType;
+    typedef typename RadixKey<K>::UnsignedType UnsignedType;
+    enum 
+    {
+        Passes = sizeof(UnsignedType)
+    };
+
+    UPInt size = end - start;
+    if(size < 2) return;
+    if(size <= RadixSortMinSize)
+    {
+        InsertionSortSliced(arr, start, end, RadixKeyLess<ValueType, K>(keyOf));
+        return;
+    }
+
+    ValueType* temp = (ValueType*)OVR_ALLOC(size * sizeof(ValueType));
+    if(!temp)
+    {
+        IntroSortSliced(arr, start, end, RadixKeyLess<ValueType, K>(keyOf));
+        return;
+    }
+
+    UPInt counts[Passes][256];
+    memset(counts, 0, sizeof(counts));
+    for(UPInt i = 0; i < size; i++)
+    {
+        UnsignedType key = RadixKey<K>::Get(keyOf(arr[start + i]));
+        for(unsigned pass = 0; pass < Passes; pass++)
+        {
+            counts[pass][(key >> (pass * 8)) & 0xFF]++;
+        }
+    }
+
+    bool inTemp = false;
+    for(unsigned pass = 0; pass < Passes; pass++)
+    {
+        unsigned shift = pass * 8;
+        UPInt*   count = counts[pass];
+
+        // All keys share this byte, so the pass wouldn't move anything
+        UnsignedType first = RadixKey<K>::Get(keyOf(inTemp ? temp[0] : arr[start]));
+        if(count[(first >> shift) & 0xFF] == size)
+        {
+            continue;
+        }
+
+        UPInt offset = 0;
+        for(unsigned digit = 0; digit < 256; digit++)
+        {
+            UPInt n      = count[digit];
+            count[digit] = offset;
+            offset      += n;
+        }
+
+        if(inTemp)
+        {
+            for(UPInt i = 0; i < size; i++)
+            {
+                UnsignedType key = RadixKey<K>::Get(keyOf(temp[i]));
+                arr[start + count[(key >> shift) & 0xFF]++] = temp[i];
+            }
+        }
+        else
+        {
+            for(UPInt i = 0; i < size; i++)
+            {
+                UnsignedType key = RadixKey<K>::Get(keyOf(arr[start + i]));
+                temp[count[(key >> shift) & 0xFF]++] = arr[start + i];
+            }
+        }
+        inTemp = !inTemp;
+    }
+
+    if(inTemp)
+    {
+        for(UPInt i = 0; i < size; i++)
+        {
+            arr[start + i] = temp[i];
+        }
+    }
+    OVR_FREE(temp);
+}
+
+
+//-----------------------------------------------------------------------------------
+// ***** RadixSortSliced
+//
+// Sort any part of any array: plain, Array, ArrayPaged, ArrayUnsafe.
+// The range is specified with start, end, where "end" is exclusive!
+// The values are their own keys; the data type must have a RadixKey.
+template<class Array> 
+void RadixSortSliced(Array& arr, UPInt start, UPInt end)
+{
+    typedef typename Array::ValueType ValueType;
+    RadixSortSliced(arr, start, end, RadixIdentity<ValueType>::Get);
+}
+
+
+//-----------------------------------------------------------------------------------
+// ***** RadixSort
+//
+// Sort an array Array, ArrayPaged, ArrayUnsafe.
+// The array must have GetSize() function.
+// keyOf returns the key of a value; the key type must have a RadixKey.
+template<class Array, class K> 
+void RadixSort(Array& arr, K (*keyOf)(const typename Array::ValueType&))
+{
+    RadixSortSliced(arr, 0, arr.GetSize(), keyOf);
+}
+
+//-----------------------------------------------------------------------------------
+// ***** RadixSort
+//
+// Sort an array Array, ArrayPaged, ArrayUnsafe.
+// The array must have GetSize() function.
+// The values are their own keys; the data type must have a RadixKey.
+template<class Array> 
+void RadixSort(Array& arr)
+{
+    typedef typename Array::ValueType ValueType;
+    RadixSortSliced(arr, 0, arr.GetSize(), RadixIdentity<ValueType>::Get);
+}
+
 //-----------------------------------------------------------------------------------
 // ***** Median
-// Returns a median value of the input array.
+// Returns a median value of the input array (the lower one for even sizes).
 // Caveats: partially sorts the array, returns a reference to the array element
-// TBD: This needs to be optimized and generalized
+// Selects in place (Hoare's quickselect), in linear time on average.
 //
 template<class Array> 
 typename Array::ValueType& Median(Array& arr)
 {
+    typedef typename Array::ValueType ValueType;
+
     UPInt count = arr.GetSize();
     UPInt mid = (count - 1) / 2;
     OVR_ASSERT(count > 0);
 
-	for (UPInt j = 0; j <= mid; j++)
+    UPInt left  = 0;
+    UPInt right = count - 1;
+    while (left < right)
     {
-		UPInt min = j;
-		for (UPInt k = j + 1; k < count; k++)
-            if (arr[k] < arr[min]) 
-                min = k;
-        Swap(arr[j], arr[min]);
+        // Median of three as the pivot, which keeps sorted input linear.
+        UPInt center = left + (right - left) / 2;
+        if (arr[center] < arr[left])   Swap(arr[center], arr[left]);
+        if (arr[right]  < arr[left])   Swap(arr[right],  arr[left]);
+        if (arr[right]  < arr[center]) Swap(arr[right],  arr[center]);
+        ValueType pivot = arr[center];
+
+        UPInt i = left;
+        UPInt j = right;
+        while (i <= j)
+        {
+            while (arr[i] < pivot) i++;
+            while (pivot < arr[j]) j--;
+            if (i <= j)
+            {
+                Swap(arr[i], arr[j]);
+                i++;
+                if (j == 0)
+                    break;
+                j--;
+            }
+        }
+
+        // Elements [left, j] are <= pivot, [i, right] are >= pivot.
+        if (mid <= j)
+            right = j;
+        else if (mid >= i)
+            left = i;
+        else
+            break;
     }
     return arr[mid];
 }
@@ -1014,6 +1446,17 @@ inline float DecodeFloat(const UByte* buffer)
     return F;
 }
 
+inline double DecodeDouble(const UByte* buffer)
+{
+    union {
+        UInt64 U;
+        double D;
+    };
+
+    U = ByteUtil::LEToSystem ( *(const UInt64*)buffer );
+    return D;
+}
+
 inline void EncodeUInt16(UByte* buffer, UInt16 val)
 {
     *(UInt16*)buffer = ByteUtil::SystemToLE ( val );
@@ -1045,6 +1488,17 @@ inline void EncodeFloat(UByte* buffer, float val)
     EncodeUInt32(buffer, U);
 }
 
+inline void EncodeDouble(UByte* buffer, double val)
+{
+    union {
+        UInt64 U;
+        double D;
+    };
+
+    D = val;
+    *(UInt64*)buffer = ByteUtil::SystemToLE ( U );
+}
+
 // Converts an 8-bit binary-coded decimal
 inline SByte DecodeBCD(UByte byte)
 {
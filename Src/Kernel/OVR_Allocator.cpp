@@ -25,18 +25,30 @@ limitations under the License.
 ************************************************************************************/
 
 #include "OVR_Allocator.h"
+#include <string.h>
 #ifdef OVR_OS_MAC
  #include <stdlib.h>
 #else
  #include <malloc.h>
 #endif
 
+#ifdef OVR_ALLOC_STATS
+#include "OVR_Atomic.h"
+
+#if defined(OVR_CC_MSVC)
+#define OVR_ALLOC_THREAD_LOCAL __declspec(thread)
+#else
+#define OVR_ALLOC_THREAD_LOCAL __thread
+#endif
+#endif
+
 namespace OVR {
 
 //-----------------------------------------------------------------------------------
 // ***** Allocator
 
 Allocator* Allocator::pInstance = 0;
+Allocator* Allocator::pSubsystemInstances[AllocSubsystem_Count] = { 0 };
 
 // Default AlignedAlloc implementation will delegate to Alloc/Free after doing rounding.
 void* Allocator::AllocAligned(UPInt size, UPInt align)
@@ -68,6 +80,159 @@ void Allocator::FreeAligned(void* p)
 // This allocator is created and used if no other allocator is installed.
 // Default allocator delegates to system malloc.
 
+#ifdef OVR_ALLOC_STATS
+
+// Precedes each allocation; 16 bytes keeps the alignment malloc gives.
+union AllocStatsHeader
+{
+    struct
+    {
+        UPInt   Size;
+        UPInt   Subsystem;
+    }       Info;
+    UInt64  Align[2];
+};
+
+// Statistics recorded by one thread. Only the owning thread writes a block;
+// GetStats adds up the blocks of all threads without locking.
+struct AllocStatsBlock
+{
+    struct Slot
+    {
+        volatile SInt64 LiveBytes;
+        volatile SInt64 LiveCount;
+        volatile UInt64 TotalBytes;
+        volatile UInt64 TotalCount;
+    };
+
+    Slot                Slots[AllocSubsystem_Count];
+    AllocStatsBlock*    pNext;
+};
+
+static AllocStatsBlock* volatile AllocStatsBlocks = 0;
+
+static OVR_ALLOC_THREAD_LOCAL AllocStatsBlock* pThreadAllocStats = 0;
+
+// Blocks come from malloc and are kept until the process exits, as with
+// PerfCounter, since their totals must survive the threads that recorded them.
+static AllocStatsBlock::Slot* getThreadAllocStats(UPInt subsystem)
+{
+    AllocStatsBlock* block = pThreadAllocStats;
+    if (!block)
+    {
+        block = (AllocStatsBlock*)malloc(sizeof(AllocStatsBlock));
+        if (!block)
+            return 0;
+        memset(block, 0, sizeof(AllocStatsBlock));
+
+        do {
+            block->pNext = AtomicOps<AllocStatsBlock*>::Load_Acquire(&AllocStatsBlocks);
+        } while (!AtomicOps<AllocStatsBlock*>::CompareAndSet_Sync(&AllocStatsBlocks, block->pNext, block));
+
+        pThreadAllocStats = block;
+    }
+    return &block->Slots[subsystem];
+}
+
+static void recordAlloc(UPInt subsystem, UPInt size)
+{
+    if (AllocStatsBlock::Slot* slot = getThreadAllocStats(subsystem))
+    {
+        slot->LiveBytes  = slot->LiveBytes + (SInt64)size;
+        slot->LiveCount  = slot->LiveCount + 1;
+        slot->TotalBytes = slot->TotalBytes + size;
+        slot->TotalCount = slot->TotalCount + 1;
+    }
+}
+
+static void recordRealloc(UPInt subsystem, UPInt oldSize, UPInt newSize)
+{
+    if (AllocStatsBlock::Slot* slot = getThreadAllocStats(subsystem))
+    {
+        slot->LiveBytes  = slot->LiveBytes + (SInt64)newSize - (SInt64)oldSize;
+        slot->TotalBytes = slot->TotalBytes + newSize;
+    }
+}
+
+static void recordFree(UPInt subsystem, UPInt size)
+{
+    if (AllocStatsBlock::Slot* slot = getThreadAllocStats(subsystem))
+    {
+        slot->LiveBytes = slot->LiveBytes - (SInt64)size;
+        slot->LiveCount = slot->LiveCount - 1;
+    }
+}
+
+void* DefaultAllocator::Alloc(UPInt size)
+{
+    return AllocTagged(size, AllocSubsystem_General, 0, 0);
+}
+void* DefaultAllocator::AllocDebug(UPInt size, const char* file, unsigned line)
+{
+    return AllocTagged(size, AllocSubsystem_General, file, line);
+}
+void* DefaultAllocator::AllocTagged(UPInt size, AllocSubsystem subsystem, const char* file, unsigned line)
+{
+    OVR_ASSERT(subsystem < AllocSubsystem_Count);
+#if defined(OVR_CC_MSVC) && defined(_CRTDBG_MAP_ALLOC)
+    AllocStatsHeader* header = (AllocStatsHeader*)_malloc_dbg(sizeof(AllocStatsHeader) + size,
+                                                              _NORMAL_BLOCK, file, line);
+#else
+    OVR_UNUSED2(file, line);
+    AllocStatsHeader* header = (AllocStatsHeader*)malloc(sizeof(AllocStatsHeader) + size);
+#endif
+    if (!header)
+        return 0;
+    header->Info.Size      = size;
+    header->Info.Subsystem = subsystem;
+    recordAlloc(subsystem, size);
+    return header + 1;
+}
+
+void* DefaultAllocator::Realloc(void* p, UPInt newSize)
+{
+    if (!p)
+        return Alloc(newSize);
+
+    AllocStatsHeader* header    = ((AllocStatsHeader*)p) - 1;
+    UPInt             oldSize   = header->Info.Size;
+    UPInt             subsystem = header->Info.Subsystem;
+
+    header = (AllocStatsHeader*)realloc(header, sizeof(AllocStatsHeader) + newSize);
+    if (!header)
+        return 0;
+    header->Info.Size = newSize;
+    recordRealloc(subsystem, oldSize, newSize);
+    return header + 1;
+}
+void DefaultAllocator::Free(void *p)
+{
+    if (!p)
+        return;
+    AllocStatsHeader* header = ((AllocStatsHeader*)p) - 1;
+    recordFree(header->Info.Subsystem, header->Info.Size);
+    free(header);
+}
+
+bool DefaultAllocator::GetStats(AllocSubsystem subsystem, AllocStats* stats) const
+{
+    OVR_ASSERT(subsystem < AllocSubsystem_Count);
+    *stats = AllocStats();
+
+    for (AllocStatsBlock* block = AtomicOps<AllocStatsBlock*>::Load_Acquire(&AllocStatsBlocks);
+         block; block = block->pNext)
+    {
+        const AllocStatsBlock::Slot& slot = block->Slots[subsystem];
+        stats->LiveBytes  += slot.LiveBytes;
+        stats->LiveCount  += slot.LiveCount;
+        stats->TotalBytes += slot.TotalBytes;
+        stats->TotalCount += slot.TotalCount;
+    }
+    return true;
+}
+
+#else // OVR_ALLOC_STATS
+
 void* DefaultAllocator::Alloc(UPInt size)
 {
     return malloc(size);
@@ -91,5 +256,210 @@ void DefaultAllocator::Free(void *p)
     return free(p);
 }
 
+#endif // OVR_ALLOC_STATS
+
+
+//------------------------------------------------------------------------
+// ***** Linear Allocator
+
+// Blocks form a singly linked list; data follows the header, aligned.
+struct LinearAllocator::Block
+{
+    Block* pNext;
+    UPInt  Size;        // Usable bytes after the header.
+    UPInt  Offset;      // Bytes used.
+
+    UByte* GetData() { return ((UByte*)this) + HeaderSize; }
+
+    enum { HeaderSize = (sizeof(void*) + 2 * sizeof(UPInt) + Alignment - 1) & ~(Alignment - 1) };
+};
+
+// Every allocation is preceded by its size so Realloc can copy the right amount, and
+// by the allocation made before it, so that nested frees can keep rewinding.
+struct LinearAllocHeader
+{
+    UPInt Size;
+    void* pPrevious;
+};
+
+static const UPInt LinearAllocHeaderSize = (sizeof(LinearAllocHeader) + LinearAllocator::Alignment - 1) &
+                                           ~UPInt(LinearAllocator::Alignment - 1);
+
+static inline UPInt linearAllocRound(UPInt size)
+{
+    return (size + LinearAllocator::Alignment - 1) & ~UPInt(LinearAllocator::Alignment - 1);
+}
+
+static inline LinearAllocHeader& linearAllocHeader(void* p)
+{
+    return *(LinearAllocHeader*)(((UByte*)p) - LinearAllocHeaderSize);
+}
+
+static inline UPInt& linearAllocSize(void* p)
+{
+    return linearAllocHeader(p).Size;
+}
+
+
+LinearAllocator::LinearAllocator(UPInt blockSize, Allocator* backing)
+  : BlockSize(blockSize), pBacking(backing),
+    pFirst(0), pCurrent(0), pLast(0), ReservedSize(0)
+{
+}
+
+LinearAllocator::~LinearAllocator()
+{
+    ReleaseBlocks();
+}
+
+LinearAllocator::Block* LinearAllocator::allocBlock(UPInt minSize)
+{
+    UPInt size   = (minSize > BlockSize) ? linearAllocRound(minSize) : BlockSize;
+    Block* block = (Block*)getBacking()->AllocAligned(Block::HeaderSize + size, Alignment);
+    if (!block)
+        return 0;
+    block->pNext  = 0;
+    block->Size   = size;
+    block->Offset = 0;
+    ReservedSize += size;
+    return block;
+}
+
+void* LinearAllocator::Alloc(UPInt size)
+{
+    UPInt need = LinearAllocHeaderSize + linearAllocRound(size ? size : 1);
+
+    // Walk forward through already reserved blocks (left over from Pop/Reset)
+    // before reserving a new one.
+    while (!pCurrent || (pCurrent->Offset + need > pCurrent->Size))
+    {
+        if (pCurrent && pCurrent->pNext)
+        {
+            pCurrent = pCurrent->pNext;
+            pCurrent->Offset = 0;
+            continue;
+        }
+
+        Block* block = allocBlock(need);
+        if (!block)
+            return 0;
+        if (pCurrent)
+        {
+            // Keep later blocks reachable; insert after the current one.
+            block->pNext    = pCurrent->pNext;
+            pCurrent->pNext = block;
+        }
+        else
+        {
+            pFirst = block;
+        }
+        pCurrent = block;
+    }
+
+    UByte* p = pCurrent->GetData() + pCurrent->Offset + LinearAllocHeaderSize;
+    pCurrent->Offset += need;
+    linearAllocSize(p) = size;
+    // Frees only rewind within the current block.
+    linearAllocHeader(p).pPrevious = (pLast && ((UByte*)pLast > pCurrent->GetData()) && ((UByte*)pLast < p)) ? pLast : 0;
+    pLast = p;
+    return p;
+}
+
+void* LinearAllocator::Realloc(void* p, UPInt newSize)
+{
+    if (!p)
+        return Alloc(newSize);
+
+    UPInt oldSize = linearAllocSize(p);
+
+    // Grow or shrink the most recent allocation in place if it still fits.
+    if (p == pLast)
+    {
+        UPInt start = (UByte*)p - LinearAllocHeaderSize - pCurrent->GetData();
+        UPInt need  = LinearAllocHeaderSize + linearAllocRound(newSize ? newSize : 1);
+        if (start + need <= pCurrent->Size)
+        {
+            pCurrent->Offset = start + need;
+            linearAllocSize(p) = newSize;
+            return p;
+        }
+    }
+    else if (newSize <= oldSize)
+    {
+        linearAllocSize(p) = newSize;
+        return p;
+    }
+
+    void* pnew = Alloc(newSize);
+    if (pnew)
+        memcpy(pnew, p, (oldSize < newSize) ? oldSize : newSize);
+    return pnew;
+}
+
+void LinearAllocator::Free(void *p)
+{
+    // Only the most recent allocation can be returned, after which the one before
+    // it can; the rest is reclaimed by Pop/Reset.
+    if (p && (p == pLast))
+    {
+        pCurrent->Offset = (UByte*)p - LinearAllocHeaderSize - pCurrent->GetData();
+        pLast = linearAllocHeader(p).pPrevious;
+    }
+}
+
+LinearAllocator::Marker LinearAllocator::Push() const
+{
+    Marker m;
+    m.pBlock = pCurrent;
+    m.Offset = pCurrent ? pCurrent->Offset : 0;
+    return m;
+}
+
+void LinearAllocator::Pop(const Marker& marker)
+{
+    if (!marker.pBlock)
+    {
+        Reset();
+        return;
+    }
+    pCurrent         = (Block*)marker.pBlock;
+    pCurrent->Offset = marker.Offset;
+    pLast            = 0;
+}
+
+void LinearAllocator::Reset()
+{
+    pCurrent = pFirst;
+    if (pCurrent)
+        pCurrent->Offset = 0;
+    pLast = 0;
+}
+
+void LinearAllocator::ReleaseBlocks()
+{
+    Block* block = pFirst;
+    while (block)
+    {
+        Block* next = block->pNext;
+        getBacking()->FreeAligned(block);
+        block = next;
+    }
+    pFirst = pCurrent = 0;
+    pLast        = 0;
+    ReservedSize = 0;
+}
+
+UPInt LinearAllocator::GetUsedSize() const
+{
+    UPInt used = 0;
+    for (Block* block = pFirst; block; block = block->pNext)
+    {
+        used += block->Offset;
+        if (block == pCurrent)
+            break;
+    }
+    return used;
+}
+
 
 } // OVR
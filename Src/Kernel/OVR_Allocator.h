@@ -30,6 +30,10 @@ limitations under the License.
 
 #include "OVR_Types.h"
 
+// Define to have DefaultAllocator keep the statistics of each AllocSubsystem; see
+// Allocator::GetStats. Each allocation then carries a header of 16 bytes.
+//#define OVR_ALLOC_STATS
+
 //-----------------------------------------------------------------------------------
 
 // ***** Disable template-unfriendly MS VC++ warnings
@@ -91,6 +95,18 @@ limitations under the License.
 #define OVR_MEMORY_REDEFINE_NEW(class_name) \
     OVR_MEMORY_REDEFINE_NEW_IMPL(class_name, OVR_MEMORY_CHECK_DELETE_NONE)
 
+// Redefines the new/delete operators of a class so that its objects are tagged
+// with an AllocSubsystem, as OVR_ALLOC_TAGGED does.
+#define OVR_MEMORY_REDEFINE_NEW_TAGGED(subsystem)                                       \
+    void*   operator new(UPInt sz)                                                      \
+    { return OVR_ALLOC_TAGGED_DEBUG(subsystem, sz, __FILE__, __LINE__); }               \
+    void*   operator new(UPInt sz, const char* file, int line)                          \
+    { return OVR_ALLOC_TAGGED_DEBUG(subsystem, sz, file, line); }                       \
+    void    operator delete(void *p)                                                    \
+    { OVR_FREE(p); }                                                                    \
+    void    operator delete(void *p, const char*, int)                                  \
+    { OVR_FREE(p); }
+
 
 namespace OVR {
 
@@ -126,6 +142,49 @@ OVR_FORCE_INLINE T*  ConstructAlt(void *p, const S1& src1, const S2& src2)
     return ::new(p) T(src1, src2);
 }
 
+#ifdef OVR_CPP_RVALUE_REFERENCES
+
+// RemoveReference, Move and Forward are equivalents of the <utility>
+// facilities, so that Kernel containers don't depend on the STL.
+template<class T> struct RemoveReference        { typedef T Type; };
+template<class T> struct RemoveReference<T&>    { typedef T Type; };
+template<class T> struct RemoveReference<T&&>   { typedef T Type; };
+
+template <class T>
+OVR_FORCE_INLINE typename RemoveReference<T>::Type&&  Move(T&& t)
+{
+    return static_cast<typename RemoveReference<T>::Type&&>(t);
+}
+
+template <class T>
+OVR_FORCE_INLINE T&&  Forward(typename RemoveReference<T>::Type& t)
+{
+    return static_cast<T&&>(t);
+}
+
+#endif
+
+// Constructs from source, leaving source in a valid but unspecified state.
+// Falls back to copy-construction on compilers without rvalue references.
+template <class T>
+OVR_FORCE_INLINE T*  ConstructMove(void *p, T& source)
+{
+#ifdef OVR_CPP_RVALUE_REFERENCES
+    return ::new(p) T(Move(source));
+#else
+    return ::new(p) T(source);
+#endif
+}
+
+#ifdef OVR_CPP_VARIADIC_TEMPLATES
+// Constructs T in place from an arbitrary argument list.
+template <class T, class... Args>
+OVR_FORCE_INLINE T*  ConstructEmplace(void *p, Args&&... args)
+{
+    return ::new(p) T(Forward<Args>(args)...);
+}
+#endif
+
 template <class T>
 OVR_FORCE_INLINE void ConstructArray(void *p, UPInt count)
 {
@@ -161,6 +220,42 @@ OVR_FORCE_INLINE void DestructArray(T *pobj, UPInt count)
 }
 
 
+//-----------------------------------------------------------------------------------
+// ***** AllocSubsystem
+
+// Subsystems that can be given their own Allocator through
+// System::SetSubsystemAllocator. Allocations made with OVR_SUBSYSTEM_ALLOC/FREE
+// go to the subsystem allocator if one is installed, and to the global allocator
+// otherwise. The allocator of a subsystem must not change while it has live
+// allocations, since they are freed through the same lookup.
+//
+// The subsystem is also the tag that allocations are accounted to (AllocTagged,
+// GetStats). OVR_SUBSYSTEM_ALLOC tags what it routes, while OVR_ALLOC_TAGGED tags
+// an allocation from the global allocator without routing it. Untagged
+// allocations count as AllocSubsystem_General.
+enum AllocSubsystem
+{
+    AllocSubsystem_General = 0,     // Everything else; always the global allocator.
+    AllocSubsystem_JSON,            // JSON trees and file loading scratch buffers.
+    AllocSubsystem_DistortionMesh,  // Distortion/heightmap mesh data and GPU upload staging.
+    AllocSubsystem_Profile,         // Profiles and the profile manager.
+    AllocSubsystem_HID,             // HID devices and their report buffers.
+    AllocSubsystem_Fusion,          // Sensor fusion and its filters' scratch buffers.
+    AllocSubsystem_Count
+};
+
+// Statistics of the allocations of one subsystem, summed over all threads.
+struct AllocStats
+{
+    SInt64  LiveBytes;      // Requested bytes not yet freed.
+    SInt64  LiveCount;      // Allocations not yet freed.
+    UInt64  TotalBytes;     // Bytes requested since the process started, by Alloc and Realloc.
+    UInt64  TotalCount;     // Allocations made since the process started.
+
+    AllocStats() : LiveBytes(0), LiveCount(0), TotalBytes(0), TotalCount(0) { }
+};
+
+
 //-----------------------------------------------------------------------------------
 // ***** Allocator
 
@@ -188,6 +283,10 @@ public:
     // Same as Alloc, but provides an option of passing debug data.
     virtual void*   AllocDebug(UPInt size, const char* file, unsigned line)
     { OVR_UNUSED2(file, line); return Alloc(size); }
+    // Same as AllocDebug, with the subsystem the allocation is made for; memory is
+    // freed with Free and resized with Realloc as usual.
+    virtual void*   AllocTagged(UPInt size, AllocSubsystem subsystem, const char* file, unsigned line)
+    { OVR_UNUSED(subsystem); return AllocDebug(size, file, line); }
 
     // Reallocate memory block to a new size, copying data if necessary. Returns the pointer to
     // new memory block, which may be the same as original pointer. Will return 0 if reallocation
@@ -210,11 +309,25 @@ public:
     virtual void*   AllocAligned(UPInt size, UPInt align);    
     // Frees memory allocated with AllocAligned.
     virtual void    FreeAligned(void* p);
+
+    // Gets the statistics of the allocations made through this allocator for a
+    // subsystem. Returns false, leaving stats zero, if the allocator keeps none;
+    // DefaultAllocator keeps them when built with OVR_ALLOC_STATS.
+    virtual bool    GetStats(AllocSubsystem subsystem, AllocStats* stats) const
+    { OVR_UNUSED(subsystem); *stats = AllocStats(); return false; }
     
     // Returns the pointer to the current globally installed Allocator instance.
     // This pointer is used for most of the memory allocations.
     static Allocator* GetInstance() { return pInstance; }
 
+    // Returns the allocator installed for a subsystem, falling back on the global one.
+    static Allocator* GetInstance(AllocSubsystem subsystem)
+    {
+        OVR_ASSERT(subsystem < AllocSubsystem_Count);
+        Allocator* palloc = pSubsystemInstances[subsystem];
+        return palloc ? palloc : pInstance;
+    }
+
 
 protected:
     // onSystemShutdown is called on the allocator during System::Shutdown.
@@ -228,9 +341,16 @@ public:
         pInstance = palloc;
     }
 
+    static  void    setSubsystemInstance(AllocSubsystem subsystem, Allocator* palloc)
+    {
+        OVR_ASSERT((subsystem > AllocSubsystem_General) && (subsystem < AllocSubsystem_Count));
+        pSubsystemInstances[subsystem] = palloc;
+    }
+
 private:
 
     static Allocator* pInstance;
+    static Allocator* pSubsystemInstances[AllocSubsystem_Count];
 };
 
 
@@ -299,6 +419,78 @@ public:
     virtual void*   AllocDebug(UPInt size, const char* file, unsigned line);
     virtual void*   Realloc(void* p, UPInt newSize);
     virtual void    Free(void *p);
+
+#ifdef OVR_ALLOC_STATS
+    // The statistics are kept per thread, without locks or atomic operations, and
+    // added up by GetStats; a thread freeing another's allocation subtracts it
+    // from its own. Each allocation's header records its size and subsystem.
+    virtual void*   AllocTagged(UPInt size, AllocSubsystem subsystem, const char* file, unsigned line);
+    virtual bool    GetStats(AllocSubsystem subsystem, AllocStats* stats) const;
+#endif
+};
+
+
+//------------------------------------------------------------------------
+// ***** Linear Allocator
+
+// LinearAllocator is a bump-pointer arena for scratch and bulk-lifetime data.
+// Allocation is a pointer increment; memory is reclaimed by rewinding to a Marker
+// returned by Push(), or by Reset(). Free() reclaims the most recent allocation
+// in the current block, so memory freed in reverse allocation order is recycled,
+// and Realloc() grows the most recent allocation in place when it fits.
+//
+// Memory is obtained in blocks from the backing allocator (the global allocator
+// if none is given) and kept for reuse until the arena is destroyed or
+// ReleaseBlocks() is called. LinearAllocator is not thread-safe; install it only
+// for subsystems that are used from a single thread at a time.
+
+class LinearAllocator : public Allocator
+{
+public:
+    enum { DefaultBlockSize = 64 * 1024, Alignment = 16 };
+
+    // Arena position returned by Push and consumed by Pop.
+    struct Marker
+    {
+        void* pBlock;
+        UPInt Offset;
+        Marker() : pBlock(0), Offset(0) { }
+    };
+
+    LinearAllocator(UPInt blockSize = DefaultBlockSize, Allocator* backing = 0);
+    virtual ~LinearAllocator();
+
+    virtual void*   Alloc(UPInt size);
+    virtual void*   Realloc(void* p, UPInt newSize);
+    virtual void    Free(void *p);
+
+    // Saves the current position; Pop(marker) releases everything allocated since.
+    Marker          Push() const;
+    void            Pop(const Marker& marker);
+    // Rewinds the arena to empty, keeping its blocks for reuse.
+    void            Reset();
+    // Resets and returns all blocks to the backing allocator.
+    void            ReleaseBlocks();
+
+    // Bytes currently handed out (including per-allocation headers) and reserved in blocks.
+    UPInt           GetUsedSize() const;
+    UPInt           GetReservedSize() const     { return ReservedSize; }
+
+protected:
+    virtual void    onSystemShutdown()          { ReleaseBlocks(); }
+
+private:
+    struct Block;
+
+    Allocator*      getBacking() const          { return pBacking ? pBacking : Allocator::GetInstance(); }
+    Block*          allocBlock(UPInt minSize);
+
+    UPInt           BlockSize;
+    Allocator*      pBacking;
+    Block*          pFirst;
+    Block*          pCurrent;
+    void*           pLast;          // Most recent allocation, for Free/Realloc fast paths.
+    UPInt           ReservedSize;
 };
 
 
@@ -314,6 +506,14 @@ public:
 #define OVR_ALLOC_ALIGNED(s,a)  OVR::Allocator::GetInstance()->AllocAligned((s),(a))
 #define OVR_FREE_ALIGNED(p)     OVR::Allocator::GetInstance()->FreeAligned((p))
 
+// Subsystem-routed versions, tagged with the subsystem; see AllocSubsystem.
+#define OVR_SUBSYSTEM_ALLOC(sub,s)  OVR::Allocator::GetInstance(sub)->AllocTagged((s), (sub), __FILE__, __LINE__)
+#define OVR_SUBSYSTEM_FREE(sub,p)   OVR::Allocator::GetInstance(sub)->Free((p))
+
+// Allocates from the global allocator, accounted to a subsystem; free with OVR_FREE.
+#define OVR_ALLOC_TAGGED(sub,s)             OVR::Allocator::GetInstance()->AllocTagged((s), (sub), __FILE__, __LINE__)
+#define OVR_ALLOC_TAGGED_DEBUG(sub,s,f,l)   OVR::Allocator::GetInstance()->AllocTagged((s), (sub), f, l)
+
 #ifdef OVR_BUILD_DEBUG
 #define OVR_ALLOC(s)            OVR::Allocator::GetInstance()->AllocDebug((s), __FILE__, __LINE__)
 #define OVR_ALLOC_DEBUG(s,f,l)  OVR::Allocator::GetInstance()->AllocDebug((s), f, l)
@@ -97,6 +97,11 @@ struct ArrayDataBase
     ArrayDataBase(const SizePolicy& p)
         : Data(0), Size(0), Policy(p) {}
 
+#ifdef OVR_CPP_RVALUE_REFERENCES
+    ArrayDataBase(SelfType&& a)
+        : Data(0), Size(0), Policy(a.Policy) { MoveFrom(a); }
+#endif
+
     ~ArrayDataBase() 
     {
         Allocator::DestructArray(Data, Size);
@@ -117,6 +122,20 @@ struct ArrayDataBase
         Policy.SetCapacity(0);
     }
 
+    // Releases our contents and takes over the buffer of a, leaving it empty.
+    void MoveFrom(SelfType& a)
+    {
+        if (&a == this)
+            return;
+        ClearAndRelease();
+        Data = a.Data;
+        Size = a.Size;
+        Policy.SetCapacity(a.Policy.GetCapacity());
+        a.Data = 0;
+        a.Size = 0;
+        a.Policy.SetCapacity(0);
+    }
+
     void Reserve(UPInt newCapacity)
     {
         if (Policy.NeverShrinking() && newCapacity < GetCapacity())
@@ -152,7 +171,7 @@ struct ArrayDataBase
                     s = (Size < newCapacity) ? Size : newCapacity;
                     for (i = 0; i < s; ++i)
                     {
-                        Allocator::Construct(&newData[i], Data[i]);
+                        Allocator::ConstructMove(&newData[i], Data[i]);
                         Allocator::Destruct(&Data[i]);
                     }
                     for (i = s; i < Size; ++i)
@@ -190,7 +209,9 @@ struct ArrayDataBase
         }
         else if(newSize >= Policy.GetCapacity())
         {
-            Reserve(newSize + (newSize >> 2));
+            // Grow by half, so that filling an array one element at a time
+            // reallocates it a logarithmic number of times.
+            Reserve(newSize + (newSize >> 1));
         }
         //! IMPORTANT to modify Size only after Reserve completes, because garbage collectable
         // array may use this array and may traverse it during Reserve (in the case, if 
@@ -228,6 +249,11 @@ struct ArrayData : ArrayDataBase<T, Allocator, SizePolicy>
     ArrayData(const SelfType& a)
         : BaseType(a.Policy) { Append(a.Data, a.Size); }
 
+#ifdef OVR_CPP_RVALUE_REFERENCES
+    ArrayData(SelfType&& a)
+        : BaseType(Move(a)) { }
+#endif
+
 
     void Resize(UPInt newSize)
     {
@@ -243,6 +269,23 @@ struct ArrayData : ArrayDataBase<T, Allocator, SizePolicy>
         Allocator::Construct(this->Data + this->Size - 1, val);
     }
 
+#ifdef OVR_CPP_RVALUE_REFERENCES
+    void PushBack(ValueType&& val)
+    {
+        BaseType::ResizeNoConstruct(this->Size + 1);
+        Allocator::ConstructMove(this->Data + this->Size - 1, val);
+    }
+#endif
+
+#ifdef OVR_CPP_VARIADIC_TEMPLATES
+    template<class... Args>
+    void EmplaceBack(Args&&... args)
+    {
+        BaseType::ResizeNoConstruct(this->Size + 1);
+        Allocator::ConstructEmplace(this->Data + this->Size - 1, Forward<Args>(args)...);
+    }
+#endif
+
     template<class S>
     void PushBackAlt(const S& val)
     {
@@ -287,6 +330,20 @@ struct ArrayDataCC : ArrayDataBase<T, Allocator, SizePolicy>
     ArrayDataCC(const SelfType& a)
         : BaseType(a.Policy), DefaultValue(a.DefaultValue) { Append(a.Data, a.Size); }
 
+#ifdef OVR_CPP_RVALUE_REFERENCES
+    ArrayDataCC(SelfType&& a)
+        : BaseType(Move(a)), DefaultValue(a.DefaultValue) { }
+#endif
+
+    // Takes over the buffer of a as ArrayDataBase::MoveFrom does, and its DefaultValue.
+    void MoveFrom(SelfType& a)
+    {
+        if (&a == this)
+            return;
+        BaseType::MoveFrom(a);
+        DefaultValue = a.DefaultValue;
+    }
+
 
     void Resize(UPInt newSize)
     {
@@ -302,6 +359,23 @@ struct ArrayDataCC : ArrayDataBase<T, Allocator, SizePolicy>
         Allocator::Construct(this->Data + this->Size - 1, val);
     }
 
+#ifdef OVR_CPP_RVALUE_REFERENCES
+    void PushBack(ValueType&& val)
+    {
+        BaseType::ResizeNoConstruct(this->Size + 1);
+        Allocator::ConstructMove(this->Data + this->Size - 1, val);
+    }
+#endif
+
+#ifdef OVR_CPP_VARIADIC_TEMPLATES
+    template<class... Args>
+    void EmplaceBack(Args&&... args)
+    {
+        BaseType::ResizeNoConstruct(this->Size + 1);
+        Allocator::ConstructEmplace(this->Data + this->Size - 1, Forward<Args>(args)...);
+    }
+#endif
+
     template<class S>
     void PushBackAlt(const S& val)
     {
@@ -327,6 +401,227 @@ struct ArrayDataCC : ArrayDataBase<T, Allocator, SizePolicy>
 
 
 
+//-----------------------------------------------------------------------------------
+// ***** ArrayDataInline
+//
+// A modification of ArrayData that keeps storage for up to N elements inside
+// the object and only allocates from the heap once the array grows past N.
+// Capacity never drops below N; shrinking back to N or fewer elements moves
+// them back into the inline buffer. For internal use only in ArrayInline.
+template<class T, unsigned N, class Allocator, class SizePolicy>
+struct ArrayDataInline
+{
+    typedef T                                               ValueType;
+    typedef Allocator                                       AllocatorType;
+    typedef SizePolicy                                      SizePolicyType;
+    typedef ArrayDataInline<T, N, Allocator, SizePolicy>    SelfType;
+
+    ArrayDataInline()
+        : Data(getInline()), Size(0), Policy() { Policy.SetCapacity(N); }
+
+    ArrayDataInline(UPInt size)
+        : Data(getInline()), Size(0), Policy() { Policy.SetCapacity(N); Resize(size); }
+
+    ArrayDataInline(const SelfType& a)
+        : Data(getInline()), Size(0), Policy(a.Policy) { Policy.SetCapacity(N); Append(a.Data, a.Size); }
+
+#ifdef OVR_CPP_RVALUE_REFERENCES
+    ArrayDataInline(SelfType&& a)
+        : Data(getInline()), Size(0), Policy(a.Policy) { Policy.SetCapacity(N); MoveFrom(a); }
+#endif
+
+    ~ArrayDataInline()
+    {
+        Allocator::DestructArray(Data, Size);
+        if (!IsInline())
+            Allocator::Free(Data);
+    }
+
+    UPInt GetCapacity() const   { return Policy.GetCapacity(); }
+    bool  IsInline() const      { return Data == getInline(); }
+
+    void ClearAndRelease()
+    {
+        Allocator::DestructArray(Data, Size);
+        if (!IsInline())
+            Allocator::Free(Data);
+        Data = getInline();
+        Size = 0;
+        Policy.SetCapacity(N);
+    }
+
+    // Releases our contents and takes over the elements of a, leaving it empty.
+    // A heap buffer is stolen; inline elements are moved one by one.
+    void MoveFrom(SelfType& a)
+    {
+        if (&a == this)
+            return;
+        ClearAndRelease();
+        if (a.IsInline())
+        {
+            moveElements(Data, a.Data, a.Size, N);
+            Size   = a.Size;
+            a.Size = 0;
+        }
+        else
+        {
+            Data = a.Data;
+            Size = a.Size;
+            Policy.SetCapacity(a.Policy.GetCapacity());
+            a.Data = a.getInline();
+            a.Size = 0;
+            a.Policy.SetCapacity(N);
+        }
+    }
+
+    void Reserve(UPInt newCapacity)
+    {
+        if (Policy.NeverShrinking() && newCapacity < GetCapacity())
+            return;
+
+        if (newCapacity < Policy.GetMinCapacity())
+            newCapacity = Policy.GetMinCapacity();
+
+        if (newCapacity <= N)
+        {
+            // Move back into the inline buffer.
+            if (!IsInline())
+            {
+                T* heapData = Data;
+                Data = getInline();
+                moveElements(Data, heapData, Size, newCapacity);
+                Allocator::Free(heapData);
+            }
+            Policy.SetCapacity(N);
+            return;
+        }
+
+        UPInt gran = Policy.GetGranularity();
+        newCapacity = (newCapacity + gran - 1) / gran * gran;
+
+        if (!IsInline() && Allocator::IsMovable())
+        {
+            Data = (T*)Allocator::Realloc(Data, sizeof(T) * newCapacity);
+        }
+        else
+        {
+            T* newData = (T*)Allocator::Alloc(sizeof(T) * newCapacity);
+            T* oldData = Data;
+            moveElements(newData, oldData, Size, newCapacity);
+            if (oldData != getInline())
+                Allocator::Free(oldData);
+            Data = newData;
+        }
+        Policy.SetCapacity(newCapacity);
+    }
+
+    // This version of Resize DOES NOT construct the elements; see ArrayDataBase.
+    void ResizeNoConstruct(UPInt newSize)
+    {
+        UPInt oldSize = Size;
+
+        if (newSize < oldSize)
+        {
+            Allocator::DestructArray(Data + newSize, oldSize - newSize);
+            if (newSize < (Policy.GetCapacity() >> 1))
+            {
+                Size = newSize;
+                Reserve(newSize);
+            }
+        }
+        else if(newSize > Policy.GetCapacity())
+        {
+            Reserve(newSize + (newSize >> 1));
+        }
+        Size = newSize;
+    }
+
+    void Resize(UPInt newSize)
+    {
+        UPInt oldSize = Size;
+        ResizeNoConstruct(newSize);
+        if(newSize > oldSize)
+            Allocator::ConstructArray(Data + oldSize, newSize - oldSize);
+    }
+
+    void PushBack(const ValueType& val)
+    {
+        ResizeNoConstruct(Size + 1);
+        Allocator::Construct(Data + Size - 1, val);
+    }
+
+#ifdef OVR_CPP_RVALUE_REFERENCES
+    void PushBack(ValueType&& val)
+    {
+        ResizeNoConstruct(Size + 1);
+        Allocator::ConstructMove(Data + Size - 1, val);
+    }
+#endif
+
+#ifdef OVR_CPP_VARIADIC_TEMPLATES
+    template<class... Args>
+    void EmplaceBack(Args&&... args)
+    {
+        ResizeNoConstruct(Size + 1);
+        Allocator::ConstructEmplace(Data + Size - 1, Forward<Args>(args)...);
+    }
+#endif
+
+    template<class S>
+    void PushBackAlt(const S& val)
+    {
+        ResizeNoConstruct(Size + 1);
+        Allocator::ConstructAlt(Data + Size - 1, val);
+    }
+
+    // Append the given data to the array.
+    void Append(const ValueType other[], UPInt count)
+    {
+        if (count)
+        {
+            UPInt oldSize = Size;
+            ResizeNoConstruct(Size + count);
+            Allocator::ConstructArray(Data + oldSize, count, other);
+        }
+    }
+
+    ValueType*  Data;
+    UPInt       Size;
+    SizePolicy  Policy;
+
+private:
+    // Moves up to capacity of the size live elements from src to dest and
+    // destroys the rest; src and dest never overlap.
+    static void moveElements(T* dest, T* src, UPInt size, UPInt capacity)
+    {
+        UPInt i, s = (size < capacity) ? size : capacity;
+        for (i = 0; i < s; ++i)
+        {
+            Allocator::ConstructMove(&dest[i], src[i]);
+            Allocator::Destruct(&src[i]);
+        }
+        for (i = s; i < size; ++i)
+            Allocator::Destruct(&src[i]);
+    }
+
+    T*       getInline()        { return (T*)Buffer.Data; }
+    const T* getInline() const  { return (const T*)Buffer.Data; }
+
+    union
+    {
+        UByte   Data[sizeof(T) * N];
+        UInt64  AlignInt;
+        double  AlignDouble;
+        void*   AlignPtr;
+    } Buffer;
+
+    // Data may point into Buffer, so plain assignment is not allowed;
+    // ArrayBase::operator = copies element-wise.
+    void operator = (const SelfType&);
+};
+
+
+
 //-----------------------------------------------------------------------------------
 // ***** ArrayBase
 //
@@ -363,6 +658,10 @@ public:
         : Data(size) {}
     ArrayBase(const SelfType& a)
         : Data(a.Data) {}
+#ifdef OVR_CPP_RVALUE_REFERENCES
+    ArrayBase(SelfType&& a)
+        : Data(Move(a.Data)) {}
+#endif
 
     ArrayBase(const ValueType& defval)
         : Data(defval) {}
@@ -380,6 +679,13 @@ public:
 
     void    ClearAndRelease()           { Data.ClearAndRelease(); }
     void    Clear()                     { Data.Resize(0); }
+    // Clear may release the buffer; this keeps it, for arrays that are emptied
+    // and refilled over and over.
+    void    ClearKeepCapacity()
+    {
+        AllocatorType::DestructArray(Data.Data, Data.Size);
+        Data.Size = 0;
+    }
     void    Resize(UPInt newSize)       { Data.Resize(newSize); }
 
     // Reserve can only increase the capacity
@@ -433,6 +739,22 @@ public:
         Data.PushBack(val);
     }
 
+#ifdef OVR_CPP_RVALUE_REFERENCES
+    void    PushBack(ValueType&& val)
+    {
+        Data.PushBack(Move(val));
+    }
+#endif
+
+#ifdef OVR_CPP_VARIADIC_TEMPLATES
+    // Constructs a new element at the end of the array from args.
+    template<class... Args>
+    void    EmplaceBack(Args&&... args)
+    {
+        Data.EmplaceBack(Forward<Args>(args)...);
+    }
+#endif
+
     template<class S>
     void PushBackAlt(const S& val)
     {
@@ -478,6 +800,15 @@ public:
         return *this;
     }
 
+#ifdef OVR_CPP_RVALUE_REFERENCES
+    // Array move. Takes over the contents of a, leaving it empty.
+    const SelfType& operator = (SelfType&& a)
+    {
+        Data.MoveFrom(a.Data);
+        return *this;
+    }
+#endif
+
     // Removing multiple elements from the array.
     void    RemoveMultipleAt(UPInt index, UPInt num)
     {
@@ -539,7 +870,7 @@ public:
             if (index < lastElemIndex)
             {
                 AllocatorType::Destruct(Data.Data + index);
-                AllocatorType::Construct(Data.Data + index, Data.Data[lastElemIndex]);
+                AllocatorType::ConstructMove(Data.Data + index, Data.Data[lastElemIndex]);
             }
             AllocatorType::Destruct(Data.Data + lastElemIndex);
             --Data.Size;
@@ -758,6 +1089,10 @@ public:
     Array(const SizePolicyType& p) : BaseType() { SetSizePolicy(p); }
     Array(const SelfType& a) : BaseType(a) {}
     const SelfType& operator=(const SelfType& a) { BaseType::operator=(a); return *this; }
+#ifdef OVR_CPP_RVALUE_REFERENCES
+    Array(SelfType&& a) : BaseType(Move(a)) {}
+    const SelfType& operator=(SelfType&& a) { BaseType::operator=(Move(a)); return *this; }
+#endif
 };
 
 // ***** ArrayPOD
@@ -780,6 +1115,10 @@ public:
     ArrayPOD(const SizePolicyType& p) : BaseType() { SetSizePolicy(p); }
     ArrayPOD(const SelfType& a) : BaseType(a) {}
     const SelfType& operator=(const SelfType& a) { BaseType::operator=(a); return *this; }
+#ifdef OVR_CPP_RVALUE_REFERENCES
+    ArrayPOD(SelfType&& a) : BaseType(Move(a)) {}
+    const SelfType& operator=(SelfType&& a) { BaseType::operator=(Move(a)); return *this; }
+#endif
 };
 
 
@@ -802,6 +1141,10 @@ public:
     ArrayCPP(const SizePolicyType& p) : BaseType() { SetSizePolicy(p); }
     ArrayCPP(const SelfType& a) : BaseType(a) {}
     const SelfType& operator=(const SelfType& a) { BaseType::operator=(a); return *this; }
+#ifdef OVR_CPP_RVALUE_REFERENCES
+    ArrayCPP(SelfType&& a) : BaseType(Move(a)) {}
+    const SelfType& operator=(SelfType&& a) { BaseType::operator=(Move(a)); return *this; }
+#endif
 };
 
 
@@ -826,6 +1169,40 @@ public:
     ArrayCC(const ValueType& defval, const SizePolicyType& p) : BaseType(defval) { SetSizePolicy(p); }
     ArrayCC(const SelfType& a) : BaseType(a) {}
     const SelfType& operator=(const SelfType& a) { BaseType::operator=(a); return *this; }
+#ifdef OVR_CPP_RVALUE_REFERENCES
+    ArrayCC(SelfType&& a) : BaseType(Move(a)) {}
+    const SelfType& operator=(SelfType&& a) { BaseType::operator=(Move(a)); return *this; }
+#endif
+};
+
+
+// ***** ArrayInline
+//
+// General purpose array for movable objects that keeps up to N elements
+// inline and spills to the global heap past that. Use it for containers that
+// almost always stay small to avoid allocations on hot paths; the object is
+// sizeof(T) * N bytes larger than Array.
+template<class T, unsigned N, class SizePolicy=ArrayDefaultPolicy>
+class ArrayInline : public ArrayBase<ArrayDataInline<T, N, ContainerAllocator<T>, SizePolicy> >
+{
+public:
+    typedef T                                                                       ValueType;
+    typedef ContainerAllocator<T>                                                   AllocatorType;
+    typedef SizePolicy                                                              SizePolicyType;
+    typedef ArrayInline<T, N, SizePolicy>                                           SelfType;
+    typedef ArrayBase<ArrayDataInline<T, N, ContainerAllocator<T>, SizePolicy> >    BaseType;
+
+    ArrayInline() : BaseType() {}
+    ArrayInline(UPInt size) : BaseType(size) {}
+    ArrayInline(const SelfType& a) : BaseType(a) {}
+    const SelfType& operator=(const SelfType& a) { BaseType::operator=(a); return *this; }
+#ifdef OVR_CPP_RVALUE_REFERENCES
+    ArrayInline(SelfType&& a) : BaseType(Move(a)) {}
+    const SelfType& operator=(SelfType&& a) { BaseType::operator=(Move(a)); return *this; }
+#endif
+
+    // Returns true while the elements live in the inline buffer.
+    bool    IsInline() const    { return this->Data.IsInline(); }
 };
 
 } // OVR
@@ -0,0 +1,231 @@
+/************************************************************************************
+
+Filename    :   OVR_AsyncLog.cpp
+Content     :   Log implementation that writes output on a background thread.
+Created     :   October 14, 2026
+Notes       :
+
+Copyright   :   Copyright 2014 Oculus VR, Inc. All Rights reserved.
+
+Licensed under the Oculus VR Rift SDK License Version 3.1 (the "License");
+you may not use the Oculus VR Rift SDK except in compliance with the License,
+which is provided at the time of installation or download, or which
+otherwise accompanies this software in either electronic or hard copy form.
+
+You may obtain a copy of the License at
+
+http://www.oculusvr.com/licenses/LICENSE-3.1
+
+Unless required by applicable law or agreed to in writing, the Oculus VR SDK
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+************************************************************************************/
+
+#include "OVR_AsyncLog.h"
+#include "OVR_Allocator.h"
+
+namespace OVR {
+
+
+//-----------------------------------------------------------------------------------
+// ***** AsyncLogThread
+
+class AsyncLogThread : public Thread
+{
+public:
+    AsyncLogThread(AsyncLog* log) : Thread(64 * 1024), pLog(log) { }
+
+    virtual int Run()
+    {
+        SetThreadName("OVR::AsyncLog");
+
+        while (!GetExitFlag())
+        {
+            if (pLog->drain() == 0)
+                Thread::MSleep(AsyncLog::PollIntervalMs);
+        }
+        return 0;
+    }
+
+private:
+    AsyncLog* pLog;
+};
+
+
+//-----------------------------------------------------------------------------------
+// ***** AsyncLog
+
+AsyncLog::AsyncLog(unsigned logMask, unsigned queueSize)
+  : Log(logMask), QueueMask(1), pRecords(0), DequeuePos(0)
+{
+    while (QueueMask + 1 < queueSize)
+        QueueMask = (QueueMask << 1) | 1;
+
+    EnqueuePos      = 0;
+    State           = Queue_Idle;
+    ActiveProducers = 0;
+    DroppedCount    = 0;
+}
+
+AsyncLog::~AsyncLog()
+{
+    stopQueue();
+}
+
+void AsyncLog::LogMessageVarg(LogMessageType messageType, const char* fmt, va_list argList)
+{
+    if ((messageType & GetLoggingMask()) == 0)
+        return;
+#ifndef OVR_BUILD_DEBUG
+    if (IsDebugMessage(messageType))
+        return;
+#endif
+
+    if (State.Load_Acquire() == Queue_Idle)
+        startQueue();
+
+    // ActiveProducers lets stopQueue wait for producers that already saw the
+    // queue running; both sides use full-sync operations on the two counters.
+    ActiveProducers.ExchangeAdd_Sync(1);
+    if (State.ExchangeAdd_Sync(0) == Queue_Running)
+    {
+        bool queued = push(messageType, fmt, argList);
+        ActiveProducers.ExchangeAdd_Sync((UInt32)0 - 1);
+        if (!queued)
+            DroppedCount.Increment_NoSync();
+        return;
+    }
+    ActiveProducers.ExchangeAdd_Sync((UInt32)0 - 1);
+
+    // Queue is not available (System not initialized, or shut down).
+    char buffer[MaxLogBufferMessageSize];
+    FormatLog(buffer, MaxLogBufferMessageSize, messageType, fmt, argList);
+    OutputMessage(buffer, IsDebugMessage(messageType));
+}
+
+void AsyncLog::OutputMessage(const char* formattedText, bool debug)
+{
+    DefaultLogOutput(formattedText, debug);
+}
+
+void AsyncLog::OnSystemShutdown()
+{
+    stopQueue();
+}
+
+
+bool AsyncLog::startQueue()
+{
+    // Memory and threads are only available after System::Init.
+    if (!Allocator::GetInstance() || !State.CompareAndSet_Sync(Queue_Idle, Queue_Starting))
+        return false;
+
+    pRecords = (Record*)OVR_ALLOC(sizeof(Record) * (QueueMask + 1));
+    if (pRecords)
+    {
+        for (unsigned i = 0; i <= QueueMask; i++)
+            pRecords[i].Sequence = i;
+
+        pThread = *new AsyncLogThread(this);
+        if (pThread && pThread->Start())
+        {
+            State.Store_Release(Queue_Running);
+            return true;
+        }
+        pThread.Clear();
+        OVR_FREE(pRecords);
+        pRecords = 0;
+    }
+
+    State.Store_Release(Queue_Stopped);
+    return false;
+}
+
+// Bounded multi-producer queue: each record's Sequence equals the enqueue position
+// that may claim it, and position + 1 once its text is ready to be written.
+bool AsyncLog::push(LogMessageType messageType, const char* fmt, va_list argList)
+{
+    UInt32  pos = EnqueuePos.Load_Relaxed();
+    Record* record;
+
+    for (;;)
+    {
+        record = &pRecords[pos & QueueMask];
+        SInt32 diff = (SInt32)(record->Sequence.Load_Acquire() - pos);
+
+        if (diff == 0)
+        {
+            if (EnqueuePos.CompareAndSet_NoSync(pos, pos + 1))
+                break;
+        }
+        else if (diff < 0)
+        {
+            // Record still holds a message from the previous lap; queue is full.
+            return false;
+        }
+        pos = EnqueuePos.Load_Relaxed();
+    }
+
+    FormatLog(record->Text, MaxMessageSize, messageType, fmt, argList);
+    record->Debug = IsDebugMessage(messageType);
+    record->Sequence.Store_Release(pos + 1);
+    return true;
+}
+
+unsigned AsyncLog::drain()
+{
+    unsigned count = 0;
+
+    for (;;)
+    {
+        Record* record = &pRecords[DequeuePos & QueueMask];
+        if (record->Sequence.Load_Acquire() != DequeuePos + 1)
+            break;
+
+        OutputMessage(record->Text, record->Debug);
+        // Hand the record to the producer one lap ahead.
+        record->Sequence.Store_Release(DequeuePos + QueueMask + 1);
+        DequeuePos++;
+        count++;
+    }
+    return count;
+}
+
+void AsyncLog::stopQueue()
+{
+    UInt32 state;
+    for (;;)
+    {
+        state = State.Load_Acquire();
+        if (state == Queue_Stopped)
+            return;
+        if (state == Queue_Starting)
+        {
+            Thread::MSleep(1);
+            continue;
+        }
+        if (State.CompareAndSet_Sync(state, Queue_Stopped))
+            break;
+    }
+    if (state == Queue_Idle)
+        return;
+
+    // New messages are now written synchronously; wait for the ones being queued.
+    while (ActiveProducers.ExchangeAdd_Sync(0) != 0)
+        Thread::MSleep(1);
+
+    pThread->SetExitFlag(true);
+    while (!pThread->IsFinished())
+        Thread::MSleep(1);
+    pThread.Clear();
+
+    drain();
+    OVR_FREE(pRecords);
+    pRecords = 0;
+}
+
+
+} // OVR
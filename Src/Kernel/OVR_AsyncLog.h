@@ -0,0 +1,125 @@
+/************************************************************************************
+
+PublicHeader:   OVR.h
+Filename    :   OVR_AsyncLog.h
+Content     :   Log implementation that writes output on a background thread.
+Created     :   October 14, 2026
+Notes       :
+
+Copyright   :   Copyright 2014 Oculus VR, Inc. All Rights reserved.
+
+Licensed under the Oculus VR Rift SDK License Version 3.1 (the "License");
+you may not use the Oculus VR Rift SDK except in compliance with the License,
+which is provided at the time of installation or download, or which
+otherwise accompanies this software in either electronic or hard copy form.
+
+You may obtain a copy of the License at
+
+http://www.oculusvr.com/licenses/LICENSE-3.1
+
+Unless required by applicable law or agreed to in writing, the Oculus VR SDK
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+************************************************************************************/
+
+#ifndef OVR_AsyncLog_h
+#define OVR_AsyncLog_h
+
+#include "OVR_Log.h"
+#include "OVR_Atomic.h"
+#include "OVR_Threads.h"
+
+namespace OVR {
+
+class AsyncLogThread;
+
+
+//-----------------------------------------------------------------------------------
+// ***** AsyncLog
+
+// AsyncLog is a Log that never performs output on the calling thread, so that
+// time-critical threads such as DeviceManagerThread are not stalled by a slow
+// console or debugger. Each message is formatted into a fixed-size record of a
+// lock-free multi-producer queue and written by a background thread. If the
+// queue is full the message is dropped and counted (GetDroppedCount) instead
+// of blocking the caller.
+//
+// The queue and thread are created on the first logged message, once System has
+// been initialized. System::Destroy stops the thread and flushes the queue; any
+// later messages are written synchronously.
+//
+// Usage:
+//   static AsyncLog asyncLog(LogMask_All);
+//   System::Init(&asyncLog);
+
+class AsyncLog : public Log
+{
+    friend class AsyncLogThread;
+public:
+    // Messages longer than MaxMessageSize - 1 characters are truncated.
+    enum
+    {
+        MaxMessageSize   = 512,
+        DefaultQueueSize = 256,
+        PollIntervalMs   = 10
+    };
+
+    // queueSize is rounded up to a power of two.
+    AsyncLog(unsigned logMask = LogMask_Debug, unsigned queueSize = DefaultQueueSize);
+    virtual ~AsyncLog();
+
+    virtual void    LogMessageVarg(LogMessageType messageType, const char* fmt, va_list argList);
+
+    // Number of messages discarded because the queue was full.
+    UInt32          GetDroppedCount() const { return DroppedCount; }
+
+protected:
+    // Receives each formatted message on the background thread (or the calling
+    // thread once the log has shut down). Override to redirect output.
+    virtual void    OutputMessage(const char* formattedText, bool debug);
+
+    virtual void    OnSystemShutdown();
+
+private:
+    struct Record
+    {
+        AtomicInt<UInt32>   Sequence;
+        bool                Debug;
+        char                Text[MaxMessageSize];
+    };
+
+    enum QueueState
+    {
+        Queue_Idle,
+        Queue_Starting,
+        Queue_Running,
+        Queue_Stopped
+    };
+
+    bool            startQueue();
+    bool            push(LogMessageType messageType, const char* fmt, va_list argList);
+    // Writes all queued messages; returns the number written. Writer thread only.
+    unsigned        drain();
+    void            stopQueue();
+
+    unsigned                QueueMask;
+    Record*                 pRecords;
+    AtomicInt<UInt32>       EnqueuePos;
+    UInt32                  DequeuePos;
+
+    AtomicInt<UInt32>       State;
+    AtomicInt<UInt32>       ActiveProducers;
+    AtomicInt<UInt32>       DroppedCount;
+
+    // The writer thread polls the queue every PollIntervalMs, so producers
+    // never have to signal it.
+    Ptr<AsyncLogThread>     pThread;
+};
+
+
+} // OVR
+
+#endif
@@ -69,6 +69,12 @@ class   Lock;
 //  - Acquire. Further memory reads are forced to wait until atomic op
 //             executes, guaranteeing that the right values will be seen.
 //  - Sync.    A combination of Release and Acquire.
+//
+// Plain loads and stores are available as Load_Acquire / Store_Release, and as
+// Load_Relaxed / Store_Relaxed when only atomicity (no ordering) is required.
+// When OVR_CPP_ATOMIC_BUILTINS is defined all operations map directly onto the
+// compiler's __atomic builtins with the matching memory order; otherwise the
+// per-platform implementations below are used.
 
 
 // *** AtomicOpsRaw
@@ -534,12 +540,66 @@ struct AtomicOpsRaw_DefImpl : public O
     inline static void  Store_Release(volatile O_T* p, O_T val)  { O_ReleaseSync sync; OVR_UNUSED(sync); *p = val; }
 #endif
     inline static O_T   Load_Acquire(const volatile O_T* p)      { O_AcquireSync sync; OVR_UNUSED(sync); return *p; }
+    // Aligned volatile accesses of native size are atomic on all supported CPUs.
+    inline static void  Store_Relaxed(volatile O_T* p, O_T val)  { *p = val; }
+    inline static O_T   Load_Relaxed(const volatile O_T* p)      { return *p; }
+};
+
+
+#if defined(OVR_ENABLE_THREADS) && defined(OVR_CPP_ATOMIC_BUILTINS)
+
+// AtomicOpsRaw implementation on top of the compiler __atomic builtins. Each
+// sync version maps to one memory order (NoSync -> relaxed, Sync -> seq_cst),
+// so the compiler emits exactly the fences the target CPU needs; on X86, for
+// example, Store_Release and Load_Acquire are plain moves.
+
+template<class OT>
+struct AtomicOpsRaw_BuiltinImpl : public AtomicOpsRawBase
+{
+    typedef OT T;
+
+    inline static T     Exchange_Sync(volatile T* p, T val)               { return __atomic_exchange_n(p, val, __ATOMIC_SEQ_CST); }
+    inline static T     Exchange_Release(volatile T* p, T val)            { return __atomic_exchange_n(p, val, __ATOMIC_RELEASE); }
+    inline static T     Exchange_Acquire(volatile T* p, T val)            { return __atomic_exchange_n(p, val, __ATOMIC_ACQUIRE); }
+    inline static T     Exchange_NoSync(volatile T* p, T val)             { return __atomic_exchange_n(p, val, __ATOMIC_RELAXED); }
+    inline static T     ExchangeAdd_Sync(volatile T* p, T val)            { return __atomic_fetch_add(p, val, __ATOMIC_SEQ_CST); }
+    inline static T     ExchangeAdd_Release(volatile T* p, T val)         { return __atomic_fetch_add(p, val, __ATOMIC_RELEASE); }
+    inline static T     ExchangeAdd_Acquire(volatile T* p, T val)         { return __atomic_fetch_add(p, val, __ATOMIC_ACQUIRE); }
+    inline static T     ExchangeAdd_NoSync(volatile T* p, T val)          { return __atomic_fetch_add(p, val, __ATOMIC_RELAXED); }
+    inline static bool  CompareAndSet_Sync(volatile T* p, T c, T val)     { return __atomic_compare_exchange_n(p, &c, val, false, __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST); }
+    inline static bool  CompareAndSet_Release(volatile T* p, T c, T val)  { return __atomic_compare_exchange_n(p, &c, val, false, __ATOMIC_RELEASE, __ATOMIC_RELAXED); }
+    inline static bool  CompareAndSet_Acquire(volatile T* p, T c, T val)  { return __atomic_compare_exchange_n(p, &c, val, false, __ATOMIC_ACQUIRE, __ATOMIC_ACQUIRE); }
+    inline static bool  CompareAndSet_NoSync(volatile T* p, T c, T val)   { return __atomic_compare_exchange_n(p, &c, val, false, __ATOMIC_RELAXED, __ATOMIC_RELAXED); }
+
+    inline static void  Store_Release(volatile T* p, T val)   { __atomic_store_n(p, val, __ATOMIC_RELEASE); }
+    inline static T     Load_Acquire(const volatile T* p)       { return __atomic_load_n(p, __ATOMIC_ACQUIRE); }
+    inline static void  Store_Relaxed(volatile T* p, T val)   { __atomic_store_n(p, val, __ATOMIC_RELAXED); }
+    inline static T     Load_Relaxed(const volatile T* p)       { return __atomic_load_n(p, __ATOMIC_RELAXED); }
 };
 
+#endif
+
 
 template<int size>
 struct AtomicOpsRaw : public AtomicOpsRawBase { };
 
+#if defined(OVR_ENABLE_THREADS) && defined(OVR_CPP_ATOMIC_BUILTINS)
+
+template<>
+struct AtomicOpsRaw<4> : public AtomicOpsRaw_BuiltinImpl<UInt32> { };
+
+// As with the platform versions, 8-byte atomics are only provided on systems with
+// 64-bit pointers, where they don't need a library call.
+#if defined(OVR_64BIT_POINTERS)
+template<>
+struct AtomicOpsRaw<8> : public AtomicOpsRaw_BuiltinImpl<UInt64> { };
+#else
+template<>
+struct AtomicOpsRaw<8> : public AtomicOpsRaw_DefImpl<AtomicOpsRaw_8ByteImpl> { };
+#endif
+
+#else
+
 template<>
 struct AtomicOpsRaw<4> : public AtomicOpsRaw_DefImpl<AtomicOpsRaw_4ByteImpl>
 {   
@@ -554,6 +614,8 @@ struct AtomicOpsRaw<8> : public AtomicOpsRaw_DefImpl<AtomicOpsRaw_8ByteImpl>
     { OVR_COMPILER_ASSERT(sizeof(AtomicOpsRaw_DefImpl<AtomicOpsRaw_8ByteImpl>::T) == 8); }
 };
 
+#endif
+
 
 // *** AtomicOps - implementation of atomic Ops for specified class
 
@@ -588,9 +650,48 @@ public:
     // Loads and stores with memory fence. These have only the relevant versions.    
     inline static void  Store_Release(volatile C* p, C val)             { C2T_union u; u.c = val; Ops::Store_Release((PT)p, u.t); }    
     inline static C     Load_Acquire(const volatile C* p)               { C2T_union u; u.t = Ops::Load_Acquire((PT)p); return u.c; }
+    inline static void  Store_Relaxed(volatile C* p, C val)             { C2T_union u; u.c = val; Ops::Store_Relaxed((PT)p, u.t); }
+    inline static C     Load_Relaxed(const volatile C* p)               { C2T_union u; u.t = Ops::Load_Relaxed((PT)p); return u.c; }
 };
 
 
+// ***** Memory fences
+
+// Standalone fences for ordering plain (non-atomic) data accesses around relaxed
+// atomic loads and stores, as in the LocklessUpdater sequence protocol.
+//  - AtomicFence_Acquire: loads before the fence complete before any later load or store.
+//  - AtomicFence_Release: loads and stores before the fence complete before any later store.
+//  - AtomicFence_Full: all accesses before the fence complete before any later access,
+//    including a store followed by a load of a different location.
+
+#if !defined(OVR_ENABLE_THREADS)
+inline void AtomicFence_Acquire() { }
+inline void AtomicFence_Release() { }
+inline void AtomicFence_Full()    { }
+#elif defined(OVR_CPP_ATOMIC_BUILTINS)
+inline void AtomicFence_Acquire() { __atomic_thread_fence(__ATOMIC_ACQUIRE); }
+inline void AtomicFence_Release() { __atomic_thread_fence(__ATOMIC_RELEASE); }
+inline void AtomicFence_Full()    { __atomic_thread_fence(__ATOMIC_SEQ_CST); }
+#elif defined(OVR_OS_WIN32) && (defined(OVR_CPU_X86) || defined(OVR_CPU_X86_64))
+// X86 doesn't reorder loads with loads or stores with stores; only the compiler must be stopped.
+inline void AtomicFence_Acquire() { _ReadWriteBarrier(); }
+inline void AtomicFence_Release() { _ReadWriteBarrier(); }
+inline void AtomicFence_Full()    { MemoryBarrier(); }
+#elif defined(OVR_OS_WIN32)
+inline void AtomicFence_Acquire() { MemoryBarrier(); }
+inline void AtomicFence_Release() { MemoryBarrier(); }
+inline void AtomicFence_Full()    { MemoryBarrier(); }
+#elif defined(OVR_CC_GNU) && (defined(OVR_CPU_X86) || defined(OVR_CPU_X86_64))
+inline void AtomicFence_Acquire() { asm volatile("" ::: "memory"); }
+inline void AtomicFence_Release() { asm volatile("" ::: "memory"); }
+inline void AtomicFence_Full()    { asm volatile("mfence" ::: "memory"); }
+#else
+inline void AtomicFence_Acquire() { __sync_synchronize(); }
+inline void AtomicFence_Release() { __sync_synchronize(); }
+inline void AtomicFence_Full()    { __sync_synchronize(); }
+#endif
+
+
 
 // Atomic value base class - implements operations shared for integers and pointers.
 template<class T>
@@ -621,6 +722,8 @@ public:
     // Load & Store.
     inline void  Store_Release(T val)               { Ops::Store_Release(&Value, val); }
     inline T     Load_Acquire() const               { return Ops::Load_Acquire(&Value);  }
+    inline void  Store_Relaxed(T val)               { Ops::Store_Relaxed(&Value, val); }
+    inline T     Load_Relaxed() const               { return Ops::Load_Relaxed(&Value);  }
 };
 
 
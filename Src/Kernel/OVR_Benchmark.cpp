@@ -0,0 +1,758 @@
+/************************************************************************************
+
+Filename    :   OVR_Benchmark.cpp
+Content     :   Micro-benchmark harness and the Kernel benchmark suite
+Created     :   October 14, 2026
+Notes       :
+
+Copyright   :   Copyright 2014 Oculus VR, Inc. All Rights reserved.
+
+Licensed under the Oculus VR Rift SDK License Version 3.1 (the "License");
+you may not use the Oculus VR Rift SDK except in compliance with the License,
+which is provided at the time of installation or download, or which
+otherwise accompanies this software in either electronic or hard copy form.
+
+You may obtain a copy of the License at
+
+http://www.oculusvr.com/licenses/LICENSE-3.1
+
+Unless required by applicable law or agreed to in writing, the Oculus VR SDK
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+************************************************************************************/
+
+#include "OVR_Benchmark.h"
+
+#ifdef OVR_KERNEL_BENCHMARK
+
+#include "OVR_Alg.h"
+#include "OVR_Atomic.h"
+#include "OVR_Deque.h"
+#include "OVR_Hash.h"
+#include "OVR_HashFlat.h"
+#include "OVR_List.h"
+#include "OVR_Lockless.h"
+#include "OVR_Log.h"
+#include "OVR_Math.h"
+#include "OVR_Std.h"
+#include "OVR_String.h"
+#include "OVR_Threads.h"
+
+#if defined(OVR_OS_LINUX)
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <string.h>
+#include <unistd.h>
+#endif
+
+namespace OVR {
+
+
+//-----------------------------------------------------------------------------------
+// ***** BenchmarkCounters
+
+BenchmarkCounters::BenchmarkCounters()
+{
+    for (int c = 0; c < Counter_Count; c++)
+        Fds[c] = -1;
+
+#if defined(OVR_OS_LINUX)
+    static const UInt64 configs[Counter_Count] =
+    {
+        PERF_COUNT_HW_CPU_CYCLES,
+        PERF_COUNT_HW_INSTRUCTIONS,
+        PERF_COUNT_HW_CACHE_MISSES,
+        PERF_COUNT_HW_BRANCH_MISSES
+    };
+
+    // One group, led by the cycle counter, so that all are enabled together.
+    for (int c = 0; c < Counter_Count; c++)
+    {
+        perf_event_attr attr;
+        memset(&attr, 0, sizeof(attr));
+        attr.size           = sizeof(attr);
+        attr.type           = PERF_TYPE_HARDWARE;
+        attr.config         = configs[c];
+        attr.disabled       = (c == 0);
+        attr.exclude_kernel = 1;
+        attr.exclude_hv     = 1;
+
+        int fd = (int)syscall(__NR_perf_event_open, &attr, 0, -1, (c == 0) ? -1 : Fds[0], 0);
+        if (fd < 0)
+        {
+            for (int i = 0; i < c; i++)
+            {
+                close(Fds[i]);
+                Fds[i] = -1;
+            }
+            break;
+        }
+        Fds[c] = fd;
+    }
+#endif
+}
+
+BenchmarkCounters::~BenchmarkCounters()
+{
+#if defined(OVR_OS_LINUX)
+    for (int c = 0; c < Counter_Count; c++)
+        if (Fds[c] >= 0)
+            close(Fds[c]);
+#endif
+}
+
+void BenchmarkCounters::Start()
+{
+#if defined(OVR_OS_LINUX)
+    if (IsValid())
+    {
+        ioctl(Fds[0], PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+        ioctl(Fds[0], PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+    }
+#endif
+}
+
+void BenchmarkCounters::Stop(UInt64 counts[Counter_Count])
+{
+    for (int c = 0; c < Counter_Count; c++)
+        counts[c] = 0;
+
+#if defined(OVR_OS_LINUX)
+    if (IsValid())
+    {
+        ioctl(Fds[0], PERF_EVENT_IOC_DISABLE, PERF_IOC_FLAG_GROUP);
+        for (int c = 0; c < Counter_Count; c++)
+        {
+            UInt64 value = 0;
+            if (read(Fds[c], &value, sizeof(value)) == (ssize_t)sizeof(value))
+                counts[c] = value;
+        }
+    }
+#endif
+}
+
+const char* BenchmarkCounters::GetName(CounterType type)
+{
+    switch(type)
+    {
+    case Counter_Cycles:        return "cycles";
+    case Counter_Instructions:  return "instructions";
+    case Counter_CacheMisses:   return "cacheMisses";
+    case Counter_BranchMisses:  return "branchMisses";
+    default:                    return "";
+    }
+}
+
+
+//-----------------------------------------------------------------------------------
+// ***** Benchmark
+
+volatile UPInt Benchmark::Sink = 0;
+
+Benchmark::Benchmark(int warmupReps, int reps)
+    : WarmupReps(warmupReps), Reps(Alg::Max(reps, 1))
+{
+}
+
+BenchmarkResult Benchmark::report(const char* name, UPInt opsPerRep)
+{
+    BenchmarkResult result;
+    const double    perOp = 1.0 / (double)Alg::Max<UPInt>(opsPerRep, 1);
+    const UPInt     count = RepTimes.GetSize();
+    // Nearest rank.
+    const UPInt     p99   = (count * 99 + 99) / 100 - 1;
+
+    Alg::QuickSort(RepTimes);
+    result.MinNs    = RepTimes[0] * perOp;
+    result.MedianNs = RepTimes[count / 2] * perOp;
+    result.P99Ns    = RepTimes[p99] * perOp;
+
+    result.HasCounters = Counters.IsValid();
+    for (int c = 0; c < BenchmarkCounters::Counter_Count; c++)
+    {
+        Alg::QuickSort(RepCounts[c]);
+        result.Counters[c] = RepCounts[c][count / 2] * perOp;
+    }
+
+    if (result.HasCounters)
+    {
+        LogText("Benchmark %-36s min %9.2f  median %9.2f  p99 %9.2f ns/op  "
+                "cycles %.1f  instructions %.1f  cacheMisses %.3f  branchMisses %.3f\n",
+                name, result.MinNs, result.MedianNs, result.P99Ns,
+                result.Counters[BenchmarkCounters::Counter_Cycles],
+                result.Counters[BenchmarkCounters::Counter_Instructions],
+                result.Counters[BenchmarkCounters::Counter_CacheMisses],
+                result.Counters[BenchmarkCounters::Counter_BranchMisses]);
+    }
+    else
+    {
+        LogText("Benchmark %-36s min %9.2f  median %9.2f  p99 %9.2f ns/op\n",
+                name, result.MinNs, result.MedianNs, result.P99Ns);
+    }
+    return result;
+}
+
+
+//-----------------------------------------------------------------------------------
+// ***** Kernel suite
+
+namespace KernelBenchmark {
+
+enum
+{
+    ElementCount = 4096,
+    // Size of the short sorts, as in the latency tester's window.
+    ShortSortCount = 128,
+    // Inputs of the math operations, cycled through.
+    MathSampleCount = 64
+};
+
+static UInt32 nextRandom(UInt32& seed)
+{
+    seed = seed * 1664525u + 1013904223u;
+    return seed >> 1;
+}
+
+static float nextFloat(UInt32& seed)
+{
+    return (float)(nextRandom(seed) >> 7) / (float)(1 << 24) * 2.0f - 1.0f;
+}
+
+
+// *** Containers
+
+struct ArrayPushBack
+{
+    void operator()()
+    {
+        Array<int> a;
+        for (int i = 0; i < ElementCount; i++)
+            a.PushBack(i);
+        Benchmark::Consume(a.GetSize());
+    }
+};
+
+struct ArrayPODPushBack
+{
+    void operator()()
+    {
+        ArrayPOD<int> a;
+        for (int i = 0; i < ElementCount; i++)
+            a.PushBack(i);
+        Benchmark::Consume(a.GetSize());
+    }
+};
+
+// Empties and refills the same array, as per-frame buffers do.
+struct ArrayPODRefill
+{
+    ArrayPOD<int>* Values;
+
+    void operator()()
+    {
+        ArrayPOD<int>& a = *Values;
+        a.ClearKeepCapacity();
+        for (int i = 0; i < ElementCount; i++)
+            a.PushBack(i);
+        Benchmark::Consume(a.GetSize());
+    }
+};
+
+struct ArrayIndex
+{
+    const Array<int>* Values;
+
+    void operator()()
+    {
+        const Array<int>& values = *Values;
+        UPInt sum = 0;
+        for (UPInt i = 0; i < values.GetSize(); i++)
+            sum += values[i];
+        Benchmark::Consume(sum);
+    }
+};
+
+// Inserts at the front and removes from the front, moving every element.
+struct ArrayInsertRemoveFront
+{
+    enum { Count = 256 };
+
+    void operator()()
+    {
+        Array<int> a;
+        for (int i = 0; i < Count; i++)
+            a.InsertAt(0, i);
+        for (int i = 0; i < Count; i++)
+            a.RemoveAt(0);
+        Benchmark::Consume(a.GetSize());
+    }
+};
+
+template<class Table, class K>
+struct TableSet
+{
+    const Array<K>* Keys;
+
+    void operator()()
+    {
+        Table table;
+        for (UPInt i = 0; i < Keys->GetSize(); i++)
+            table.Set((*Keys)[i], (int)i);
+        Benchmark::Consume(table.GetSize());
+    }
+};
+
+template<class Table, class K>
+struct TableGet
+{
+    const Table*    pTable;
+    const Array<K>* Keys;
+
+    void operator()()
+    {
+        UPInt sum = 0;
+        for (UPInt i = 0; i < Keys->GetSize(); i++)
+        {
+            const int* pvalue = pTable->Get((*Keys)[i]);
+            if (pvalue)
+                sum += *pvalue;
+        }
+        Benchmark::Consume(sum);
+    }
+};
+
+template<class Table, class K>
+struct TableSetRemove
+{
+    const Array<K>* Keys;
+
+    void operator()()
+    {
+        Table table;
+        for (UPInt i = 0; i < Keys->GetSize(); i++)
+            table.Set((*Keys)[i], (int)i);
+        for (UPInt i = 0; i < Keys->GetSize(); i++)
+            table.Remove((*Keys)[i]);
+        Benchmark::Consume(table.GetSize());
+    }
+};
+
+template<class Table, class K>
+static void runTable(Benchmark& bench, const char* tableName, const Array<K>& keys)
+{
+    char name[64];
+
+    TableSet<Table, K> set = { &keys };
+    OVR_sprintf(name, sizeof(name), "%s.Set", tableName);
+    bench.Run(name, keys.GetSize(), set);
+
+    Table table;
+    for (UPInt i = 0; i < keys.GetSize(); i++)
+        table.Set(keys[i], (int)i);
+    TableGet<Table, K> get = { &table, &keys };
+    OVR_sprintf(name, sizeof(name), "%s.Get", tableName);
+    bench.Run(name, keys.GetSize(), get);
+
+    TableSetRemove<Table, K> setRemove = { &keys };
+    OVR_sprintf(name, sizeof(name), "%s.Set+Remove", tableName);
+    bench.Run(name, keys.GetSize() * 2, setRemove);
+}
+
+template <class D>
+struct DequePushPop
+{
+    void operator()()
+    {
+        D d(ElementCount);
+        for (int i = 0; i < ElementCount; i++)
+            d.PushBack(i);
+        UPInt sum = 0;
+        for (int i = 0; i < ElementCount; i++)
+            sum += d.PopFront();
+        Benchmark::Consume(sum);
+    }
+};
+
+struct ListElement : public ListNode<ListElement>
+{
+    int Value;
+};
+
+struct ListPushRemove
+{
+    ListElement* Elements;
+
+    void operator()()
+    {
+        List<ListElement> list;
+        for (int i = 0; i < ElementCount; i++)
+            list.PushBack(&Elements[i]);
+        UPInt sum = 0;
+        for (int i = 0; i < ElementCount; i++)
+        {
+            sum += Elements[i].Value;
+            List<ListElement>::Remove(&Elements[i]);
+        }
+        Benchmark::Consume(sum + list.IsEmpty());
+    }
+};
+
+
+// *** Sorts; each repetition also copies the unsorted input.
+
+struct SortBody
+{
+    enum SortType { Sort_Quick, Sort_Intro, Sort_Radix };
+
+    const Array<int>* Input;
+    SortType          Type;
+    Array<int>        Values;
+
+    void operator()()
+    {
+        Values = *Input;
+        switch(Type)
+        {
+        case Sort_Quick: Alg::QuickSort(Values); break;
+        case Sort_Intro: Alg::IntroSort(Values); break;
+        case Sort_Radix: Alg::RadixSort(Values); break;
+        }
+        Benchmark::Consume(Values[Values.GetSize() / 2]);
+    }
+};
+
+
+// *** Atomics
+
+struct AtomicBody
+{
+    enum OpType { Op_ExchangeAddSync, Op_ExchangeAddNoSync, Op_CompareAndSetSync, Op_LockUnlock };
+
+    OpType          Type;
+    AtomicInt<int>  Value;
+    Lock            ValueLock;
+
+    void operator()()
+    {
+        switch(Type)
+        {
+        case Op_ExchangeAddSync:
+            for (int i = 0; i < ElementCount; i++)
+                Value.ExchangeAdd_Sync(1);
+            break;
+        case Op_ExchangeAddNoSync:
+            for (int i = 0; i < ElementCount; i++)
+                Value.ExchangeAdd_NoSync(1);
+            break;
+        case Op_CompareAndSetSync:
+            for (int i = 0; i < ElementCount; i++)
+                Value.CompareAndSet_Sync(Value, Value + 1);
+            break;
+        case Op_LockUnlock:
+            for (int i = 0; i < ElementCount; i++)
+            {
+                ValueLock.DoLock();
+                Value.ExchangeAdd_NoSync(1);
+                ValueLock.Unlock();
+            }
+            break;
+        }
+        Benchmark::Consume((UPInt)(int)Value);
+    }
+};
+
+
+// *** Math
+
+struct MathSamples
+{
+    Quatf       Quats[MathSampleCount];
+    Vector3f    Vecs[MathSampleCount];
+    Matrix4f    Mats[MathSampleCount];
+
+    MathSamples()
+    {
+        UInt32 seed = 0x12345678;
+        for (int i = 0; i < MathSampleCount; i++)
+        {
+            Vector3f axis(nextFloat(seed), nextFloat(seed), nextFloat(seed) + 1.5f);
+            Quats[i] = Quatf(axis.Normalized(), nextFloat(seed) * 3.0f);
+            Vecs[i]  = Vector3f(nextFloat(seed), nextFloat(seed), nextFloat(seed));
+            // Rotation and translation, so that Inverted has a well conditioned input.
+            Mats[i]  = Matrix4f::Translation(Vecs[i]) * Matrix4f(Quats[i]);
+        }
+    }
+};
+
+struct MathBody
+{
+    enum OpType { Op_QuatMultiply, Op_QuatRotate, Op_MatrixMultiply, Op_MatrixInverted, Op_MatrixFromQuat };
+
+    const MathSamples* Samples;
+    OpType             Type;
+
+    void operator()()
+    {
+        const MathSamples& s = *Samples;
+        float sum = 0;
+        for (int i = 0; i < ElementCount; i++)
+        {
+            int a = i & (MathSampleCount - 1);
+            int b = (i + 7) & (MathSampleCount - 1);
+            switch(Type)
+            {
+            case Op_QuatMultiply:    sum += (s.Quats[a] * s.Quats[b]).w;        break;
+            case Op_QuatRotate:      sum += s.Quats[a].Rotate(s.Vecs[b]).x;     break;
+            case Op_MatrixMultiply:  sum += (s.Mats[a] * s.Mats[b]).M[0][3];    break;
+            case Op_MatrixInverted:  sum += s.Mats[a].Inverted().M[0][3];       break;
+            case Op_MatrixFromQuat:  sum += Matrix4f(s.Quats[a]).M[0][1];       break;
+            }
+        }
+        Benchmark::Consume((UPInt)(SPInt)(sum * 1000.0f));
+    }
+};
+
+
+// *** String hashing
+
+struct StringHashBody
+{
+    enum HashType { Hash_Bernstein, Hash_BernsteinCIS, Hash_Fast, Hash_FastCIS };
+
+    const Array<String>* Keys;
+    HashType             Type;
+
+    void operator()()
+    {
+        UPInt sum = 0;
+        for (UPInt i = 0; i < Keys->GetSize(); i++)
+        {
+            const String& key = (*Keys)[i];
+            switch(Type)
+            {
+            case Hash_Bernstein:    sum += String::BernsteinHashFunction(key.ToCStr(), key.GetSize());      break;
+            case Hash_BernsteinCIS: sum += String::BernsteinHashFunctionCIS(key.ToCStr(), key.GetSize());   break;
+            case Hash_Fast:         sum += String::FastHashFunction(key.ToCStr(), key.GetSize());           break;
+            case Hash_FastCIS:      sum += String::FastHashFunctionCIS(key.ToCStr(), key.GetSize());        break;
+            }
+        }
+        Benchmark::Consume(sum);
+    }
+};
+
+
+#ifdef OVR_ENABLE_THREADS
+
+// *** Lockless contention
+
+// About the size of the pose and timing state read every frame.
+struct UpdaterState
+{
+    float Values[32];
+};
+
+// The calling thread reads the updater while a writer thread updates it as fast as
+// it can and readers - 1 other threads read it.
+template<class Updater>
+struct LocklessRead
+{
+    enum { Reads = 1024 };
+
+    Updater         State;
+    AtomicInt<int>  Stop;
+
+    void operator()()
+    {
+        UPInt sum = 0;
+        for (int i = 0; i < Reads; i++)
+            sum += readState(State);
+        Benchmark::Consume(sum);
+    }
+
+    // Uses both ends of the state, so that the whole copy is made.
+    static UPInt readState(const Updater& updater)
+    {
+        UpdaterState state = updater.GetState();
+        return (UPInt)(state.Values[0] + state.Values[31]);
+    }
+
+    static int WriterFn(Thread*, void* h)
+    {
+        LocklessRead* self = (LocklessRead*)h;
+        UpdaterState  state;
+        memset(&state, 0, sizeof(state));
+        while (!self->Stop.Load_Acquire())
+        {
+            state.Values[0]  += 1.0f;
+            state.Values[31] += 1.0f;
+            self->State.SetState(state);
+        }
+        return 0;
+    }
+
+    static int ReaderFn(Thread*, void* h)
+    {
+        LocklessRead* self = (LocklessRead*)h;
+        UPInt         sum  = 0;
+        while (!self->Stop.Load_Acquire())
+            sum += readState(self->State);
+        Benchmark::Consume(sum);
+        return 0;
+    }
+};
+
+template<class Updater>
+static void runLocklessRead(Benchmark& bench, const char* updaterName, int maxReaders)
+{
+    typedef LocklessRead<Updater> Body;
+
+    for (int readers = 1; readers <= maxReaders; readers++)
+    {
+        Body body;
+        body.Stop = 0;
+
+        Array<Ptr<Thread> > threads;
+        threads.PushBack(*new Thread(Body::WriterFn, &body));
+        for (int i = 1; i < readers; i++)
+            threads.PushBack(*new Thread(Body::ReaderFn, &body));
+        for (UPInt i = 0; i < threads.GetSize(); i++)
+            threads[i]->Start();
+
+        char name[64];
+        OVR_sprintf(name, sizeof(name), "%s.GetState/%dr", updaterName, readers);
+        bench.Run(name, Body::Reads, body);
+
+        body.Stop.Store_Release(1);
+        for (UPInt i = 0; i < threads.GetSize(); i++)
+            while (!threads[i]->IsFinished())
+                Thread::MSleep(0);
+    }
+}
+
+#endif // OVR_ENABLE_THREADS
+
+} // KernelBenchmark
+
+
+void RunKernelBenchmarks(int maxReaders)
+{
+    using namespace KernelBenchmark;
+
+    Benchmark bench;
+    if (!bench.HasCounters())
+        LogText("Benchmark: hardware counters unavailable.\n");
+
+    // Keys and inputs are the same from run to run.
+    UInt32        seed = 0x2545F491;
+    Array<int>    intKeys;
+    Array<String> stringKeys;
+    for (int i = 0; i < ElementCount; i++)
+    {
+        UInt32 r = nextRandom(seed);
+        intKeys.PushBack((int)r);
+        char key[32];
+        OVR_sprintf(key, sizeof(key), "Profile.Key.%u", r >> 8);
+        stringKeys.PushBack(String(key));
+    }
+
+    // Containers
+    ArrayPushBack          arrayPushBack;
+    ArrayPODPushBack       arrayPODPushBack;
+    ArrayPOD<int>          refillValues;
+    ArrayPODRefill         arrayPODRefill = { &refillValues };
+    ArrayIndex             arrayIndex = { &intKeys };
+    ArrayInsertRemoveFront arrayInsertRemove;
+    bench.Run("Array.PushBack",            ElementCount, arrayPushBack);
+    bench.Run("ArrayPOD.PushBack",         ElementCount, arrayPODPushBack);
+    bench.Run("ArrayPOD.ClearKeepCapacity+PushBack", ElementCount, arrayPODRefill);
+    bench.Run("Array.Index",               ElementCount, arrayIndex);
+    bench.Run("Array.InsertAt+RemoveAt(0)", ArrayInsertRemoveFront::Count * 2, arrayInsertRemove);
+
+    runTable<Hash<int, int>, int>(bench, "Hash<int>", intKeys);
+    runTable<HashFlat<int, int>, int>(bench, "HashFlat<int>", intKeys);
+    runTable<Hash<String, int, String::HashFunctor>, String>(bench, "Hash<String>", stringKeys);
+    runTable<HashFlat<String, int, String::HashFunctor>, String>(bench, "HashFlat<String>", stringKeys);
+
+    DequePushPop<Deque<int> > dequePushPop;
+    bench.Run("Deque.PushBack+PopFront", ElementCount * 2, dequePushPop);
+    DequePushPop<DequeFixed<int, ElementCount> > dequeFixedPushPop;
+    bench.Run("DequeFixed.PushBack+PopFront", ElementCount * 2, dequeFixedPushPop);
+
+    Array<ListElement> listElements;
+    listElements.Resize(ElementCount);
+    for (int i = 0; i < ElementCount; i++)
+        listElements[i].Value = i;
+    ListPushRemove listPushRemove = { &listElements[0] };
+    bench.Run("List.PushBack+Remove", ElementCount * 2, listPushRemove);
+
+    // Sorts
+    SortBody sort;
+    sort.Input = &intKeys;
+    sort.Type  = SortBody::Sort_Quick;
+    bench.Run("Alg.QuickSort", ElementCount, sort);
+    sort.Type  = SortBody::Sort_Intro;
+    bench.Run("Alg.IntroSort", ElementCount, sort);
+    sort.Type  = SortBody::Sort_Radix;
+    bench.Run("Alg.RadixSort", ElementCount, sort);
+
+    Array<int> shortKeys;
+    shortKeys.Append(&intKeys[0], ShortSortCount);
+    sort.Input = &shortKeys;
+    sort.Type  = SortBody::Sort_Quick;
+    bench.Run("Alg.QuickSort(128)", ShortSortCount, sort);
+    sort.Type  = SortBody::Sort_Intro;
+    bench.Run("Alg.IntroSort(128)", ShortSortCount, sort);
+    sort.Type  = SortBody::Sort_Radix;
+    bench.Run("Alg.RadixSort(128)", ShortSortCount, sort);
+
+    // Atomics
+    AtomicBody atomic;
+    atomic.Value = 0;
+    atomic.Type  = AtomicBody::Op_ExchangeAddSync;
+    bench.Run("AtomicInt.ExchangeAdd_Sync", ElementCount, atomic);
+    atomic.Type  = AtomicBody::Op_ExchangeAddNoSync;
+    bench.Run("AtomicInt.ExchangeAdd_NoSync", ElementCount, atomic);
+    atomic.Type  = AtomicBody::Op_CompareAndSetSync;
+    bench.Run("AtomicInt.CompareAndSet_Sync", ElementCount, atomic);
+    atomic.Type  = AtomicBody::Op_LockUnlock;
+    bench.Run("Lock.DoLock+Unlock", ElementCount, atomic);
+
+    // Math
+    MathSamples samples;
+    MathBody    math = { &samples, MathBody::Op_QuatMultiply };
+    bench.Run("Quatf.operator*", ElementCount, math);
+    math.Type = MathBody::Op_QuatRotate;
+    bench.Run("Quatf.Rotate", ElementCount, math);
+    math.Type = MathBody::Op_MatrixMultiply;
+    bench.Run("Matrix4f.operator*", ElementCount, math);
+    math.Type = MathBody::Op_MatrixInverted;
+    bench.Run("Matrix4f.Inverted", ElementCount, math);
+    math.Type = MathBody::Op_MatrixFromQuat;
+    bench.Run("Matrix4f(Quatf)", ElementCount, math);
+
+    // String hashing
+    StringHashBody stringHash = { &stringKeys, StringHashBody::Hash_Bernstein };
+    bench.Run("String.BernsteinHashFunction", ElementCount, stringHash);
+    stringHash.Type = StringHashBody::Hash_BernsteinCIS;
+    bench.Run("String.BernsteinHashFunctionCIS", ElementCount, stringHash);
+    stringHash.Type = StringHashBody::Hash_Fast;
+    bench.Run("String.FastHashFunction", ElementCount, stringHash);
+    stringHash.Type = StringHashBody::Hash_FastCIS;
+    bench.Run("String.FastHashFunctionCIS", ElementCount, stringHash);
+
+#ifdef OVR_ENABLE_THREADS
+    // Lockless contention
+    runLocklessRead<LocklessUpdater<UpdaterState> >(bench, "LocklessUpdater", maxReaders);
+    runLocklessRead<LocklessSlotUpdater<UpdaterState> >(bench, "LocklessSlotUpdater", maxReaders);
+#else
+    OVR_UNUSED(maxReaders);
+#endif
+}
+
+} // OVR
+
+#endif // OVR_KERNEL_BENCHMARK
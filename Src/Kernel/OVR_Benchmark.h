@@ -0,0 +1,171 @@
+/************************************************************************************
+
+PublicHeader:   Kernel
+Filename    :   OVR_Benchmark.h
+Content     :   Micro-benchmark harness and the Kernel benchmark suite
+Created     :   October 14, 2026
+Notes       :
+
+Copyright   :   Copyright 2014 Oculus VR, Inc. All Rights reserved.
+
+Licensed under the Oculus VR Rift SDK License Version 3.1 (the "License");
+you may not use the Oculus VR Rift SDK except in compliance with the License,
+which is provided at the time of installation or download, or which
+otherwise accompanies this software in either electronic or hard copy form.
+
+You may obtain a copy of the License at
+
+http://www.oculusvr.com/licenses/LICENSE-3.1
+
+Unless required by applicable law or agreed to in writing, the Oculus VR SDK
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+************************************************************************************/
+
+#ifndef OVR_Benchmark_h
+#define OVR_Benchmark_h
+
+#include "OVR_Types.h"
+#include "OVR_Array.h"
+#include "OVR_Timer.h"
+
+// Define to build the Benchmark harness and RunKernelBenchmarks, which times the
+// containers, atomics, math and string hashing of the Kernel, along with
+// RunSensorDecodeBenchmarks in OVR_SensorImpl_Common.h.
+//#define OVR_KERNEL_BENCHMARK
+
+#ifdef OVR_KERNEL_BENCHMARK
+
+namespace OVR {
+
+
+//-----------------------------------------------------------------------------------
+// ***** BenchmarkCounters
+
+// Hardware counters of the calling thread, read through perf_event on Linux.
+// Elsewhere, or where perf_event_paranoid doesn't allow them, IsValid is false
+// and Stop reads zeros.
+
+class BenchmarkCounters
+{
+public:
+    enum CounterType
+    {
+        Counter_Cycles,
+        Counter_Instructions,
+        Counter_CacheMisses,
+        Counter_BranchMisses,
+        Counter_Count
+    };
+
+    BenchmarkCounters();
+    ~BenchmarkCounters();
+
+    bool        IsValid() const { return Fds[0] >= 0; }
+
+    // Starts counting from zero.
+    void        Start();
+    // Stops counting and reads the counts since Start.
+    void        Stop(UInt64 counts[Counter_Count]);
+
+    static const char* GetName(CounterType type);
+
+private:
+    int         Fds[Counter_Count];
+};
+
+
+//-----------------------------------------------------------------------------------
+// ***** Benchmark
+
+// Times a body the same way for every benchmark: WarmupReps untimed runs, then
+// Reps timed runs, each of which performs opsPerRep operations. The result is the
+// minimum, median and 99th percentile of the runs, divided per operation, with
+// the median of each hardware counter per operation. Run also logs it on one line.
+//
+// Body is a functor; body() runs one repetition. Its results should reach
+// Consume, so that the compiler can't drop the work:
+//
+//     struct SumBody
+//     {
+//         const Array<int>* Values;
+//         void operator()() { ... Benchmark::Consume(sum); }
+//     };
+//     SumBody body = { &values };
+//     bench.Run("Array.Index", values.GetSize(), body);
+//
+// The counters count the thread that created the Benchmark, which must be the
+// one calling Run.
+
+struct BenchmarkResult
+{
+    double  MinNs;
+    double  MedianNs;
+    double  P99Ns;
+    // Medians per operation; zero unless HasCounters.
+    double  Counters[BenchmarkCounters::Counter_Count];
+    bool    HasCounters;
+};
+
+class Benchmark
+{
+public:
+    Benchmark(int warmupReps = 3, int reps = 31);
+
+    template<class Body>
+    BenchmarkResult Run(const char* name, UPInt opsPerRep, Body& body)
+    {
+        for (int i = 0; i < WarmupReps; i++)
+            body();
+
+        RepTimes.Clear();
+        for (int c = 0; c < BenchmarkCounters::Counter_Count; c++)
+            RepCounts[c].Clear();
+
+        for (int i = 0; i < Reps; i++)
+        {
+            UInt64 counts[BenchmarkCounters::Counter_Count];
+            Counters.Start();
+            UInt64 start = Timer::GetTicksNanos();
+            body();
+            UInt64 time  = Timer::GetTicksNanos() - start;
+            Counters.Stop(counts);
+
+            RepTimes.PushBack((double)time);
+            for (int c = 0; c < BenchmarkCounters::Counter_Count; c++)
+                RepCounts[c].PushBack((double)counts[c]);
+        }
+        return report(name, opsPerRep);
+    }
+
+    bool HasCounters() const { return Counters.IsValid(); }
+
+    static void Consume(UPInt value) { Sink = Sink + value; }
+
+private:
+    BenchmarkResult report(const char* name, UPInt opsPerRep);
+
+    static volatile UPInt Sink;
+
+    int                 WarmupReps;
+    int                 Reps;
+    BenchmarkCounters   Counters;
+    Array<double>       RepTimes;
+    Array<double>       RepCounts[BenchmarkCounters::Counter_Count];
+};
+
+
+// Runs the Kernel suite: each container operation, atomics and Lock, sorts,
+// quaternion and matrix operations, string hashing, and LocklessUpdater and
+// LocklessSlotUpdater reads with 1 to maxReaders reader threads against a writer.
+// Call after System::Init.
+void RunKernelBenchmarks(int maxReaders = 4);
+
+} // OVR
+
+#endif // OVR_KERNEL_BENCHMARK
+
+#endif // OVR_Benchmark_h
@@ -0,0 +1,381 @@
+/************************************************************************************
+
+Filename    :   OVR_BinaryLog.cpp
+Content     :   Binary log records holding a format id and raw arguments.
+Created     :   October 14, 2026
+Notes       :
+
+Copyright   :   Copyright 2014 Oculus VR, Inc. All Rights reserved.
+
+Licensed under the Oculus VR Rift SDK License Version 3.1 (the "License");
+you may not use the Oculus VR Rift SDK except in compliance with the License,
+which is provided at the time of installation or download, or which
+otherwise accompanies this software in either electronic or hard copy form.
+
+You may obtain a copy of the License at
+
+http://www.oculusvr.com/licenses/LICENSE-3.1
+
+Unless required by applicable law or agreed to in writing, the Oculus VR SDK
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+************************************************************************************/
+
+#include "OVR_BinaryLog.h"
+#include "OVR_Std.h"
+#include "OVR_Timer.h"
+#include <string.h>
+
+namespace OVR {
+
+// Global binary log pointer and last assigned site id.
+static BinaryLog* volatile OVR_GlobalBinaryLog = 0;
+static volatile UInt32     BinaryLogLastSiteId = 0;
+
+#if defined(OVR_CC_MSVC)
+#  define OVR_BINARY_LOG_INT64_PREFIX "I64"
+#else
+#  define OVR_BINARY_LOG_INT64_PREFIX "ll"
+#endif
+
+
+//-----------------------------------------------------------------------------------
+// ***** Formatting
+
+// Formats args according to a printf-style format without a va_list, since the
+// arguments may come from a decoded record. Length modifiers in the format are
+// ignored; each conversion uses the stored argument at its full width.
+static void formatMessage(char* buffer, UPInt bufferSize, const char* format,
+                          const BinaryLogArg* args, unsigned argCount)
+{
+    UPInt       out      = 0;
+    unsigned    argIndex = 0;
+    const char* p        = format;
+
+    while (*p && (out + 1 < bufferSize))
+    {
+        if (*p != '%')
+        {
+            buffer[out++] = *p++;
+            continue;
+        }
+        if (p[1] == '%')
+        {
+            buffer[out++] = '%';
+            p += 2;
+            continue;
+        }
+
+        // Copy flags, width and precision; skip length modifiers.
+        char  spec[32];
+        UPInt specLength = 0;
+        spec[specLength++] = *p++;
+        while (*p && strchr("-+ #0123456789.", *p) && (specLength < 16))
+            spec[specLength++] = *p++;
+        while (*p && strchr("hlLqjzt", *p))
+            p++;
+        const char conversion = *p;
+        if (!conversion)
+            break;
+        p++;
+
+        const BinaryLogArg* arg = (argIndex < argCount) ? &args[argIndex++] : 0;
+        char  piece[BinaryLog::MaxStringArgSize + 64];
+        piece[0] = 0;
+
+        if (!arg)
+        {
+            OVR_strcpy(piece, sizeof(piece), "<?>");
+        }
+        else switch (conversion)
+        {
+        case 'd': case 'i':
+        case 'u': case 'x': case 'X': case 'o':
+            {
+                OVR_strcpy(spec + specLength, sizeof(spec) - specLength, OVR_BINARY_LOG_INT64_PREFIX);
+                UPInt length = OVR_strlen(spec);
+                spec[length] = conversion;
+                spec[length + 1] = 0;
+                UInt64 value = (arg->Type == BinaryLogArg::Arg_Double) ?
+                               (UInt64)(SInt64)arg->Value.Double : arg->Value.UInt;
+                OVR_sprintf(piece, sizeof(piece), spec, value);
+            }
+            break;
+
+        case 'c':
+            spec[specLength] = 'c'; spec[specLength + 1] = 0;
+            OVR_sprintf(piece, sizeof(piece), spec, (int)arg->Value.UInt);
+            break;
+
+        case 'f': case 'F': case 'e': case 'E': case 'g': case 'G': case 'a': case 'A':
+            {
+                spec[specLength] = conversion; spec[specLength + 1] = 0;
+                double value = arg->Value.Double;
+                if (arg->Type == BinaryLogArg::Arg_Int)
+                    value = (double)(SInt64)arg->Value.UInt;
+                else if (arg->Type != BinaryLogArg::Arg_Double)
+                    value = (double)arg->Value.UInt;
+                OVR_sprintf(piece, sizeof(piece), spec, value);
+            }
+            break;
+
+        case 's':
+            spec[specLength] = 's'; spec[specLength + 1] = 0;
+            OVR_sprintf(piece, sizeof(piece), spec,
+                        (arg->Type == BinaryLogArg::Arg_String && arg->Value.String) ?
+                        arg->Value.String : "<?>");
+            break;
+
+        case 'p':
+            spec[specLength] = 'p'; spec[specLength + 1] = 0;
+            OVR_sprintf(piece, sizeof(piece), spec, (void*)(UPInt)arg->Value.UInt);
+            break;
+
+        default:
+            OVR_strcpy(piece, sizeof(piece), "<?>");
+            break;
+        }
+
+        for (const char* s = piece; *s && (out + 1 < bufferSize); s++)
+            buffer[out++] = *s;
+    }
+
+    buffer[out] = 0;
+}
+
+
+//-----------------------------------------------------------------------------------
+// ***** BinaryLog
+
+BinaryLog::BinaryLog()
+{
+    for (unsigned i = 0; i < MaxSites / 32; i++)
+        DefinedSites[i] = 0;
+}
+
+BinaryLog::~BinaryLog()
+{
+    if (this == OVR_GlobalBinaryLog)
+        OVR_GlobalBinaryLog = 0;
+}
+
+void BinaryLog::SetGlobalBinaryLog(BinaryLog* log)
+{
+    OVR_GlobalBinaryLog = log;
+}
+
+BinaryLog* BinaryLog::GetGlobalBinaryLog()
+{
+    return OVR_GlobalBinaryLog;
+}
+
+
+static UInt32 getSiteId(BinaryLogSite& site)
+{
+    UInt32 id = AtomicOps<UInt32>::Load_Acquire(&site.Id);
+    if (id == 0)
+    {
+        UInt32 newId = AtomicOps<UInt32>::ExchangeAdd_Sync(&BinaryLogLastSiteId, 1) + 1;
+        if (AtomicOps<UInt32>::CompareAndSet_Sync(&site.Id, 0, newId))
+            id = newId;
+        else
+            id = AtomicOps<UInt32>::Load_Acquire(&site.Id);
+    }
+    return id;
+}
+
+void BinaryLog::defineSite(const BinaryLogSite& site)
+{
+    const UInt32 mask = 1u << (site.Id & 31);
+    AtomicInt<UInt32>& word = DefinedSites[site.Id / 32];
+
+    for (;;)
+    {
+        UInt32 defined = word.Load_Acquire();
+        if (defined & mask)
+            return;
+        if (word.CompareAndSet_Sync(defined, defined | mask))
+            break;
+    }
+
+    UByte        record[MaxRecordSize];
+    RecordHeader header;
+    UInt32       messageType = (UInt32)site.MessageType;
+    UPInt        formatSize  = OVR_strlen(site.Format);
+    const UPInt  maxFormat   = MaxRecordSize - sizeof(header) - sizeof(messageType) - 1;
+    if (formatSize > maxFormat)
+        formatSize = maxFormat;
+
+    header.Size     = (UInt16)(sizeof(header) + sizeof(messageType) + formatSize + 1);
+    header.Kind     = Record_Format;
+    header.ArgCount = 0;
+    header.Id       = site.Id;
+
+    memcpy(record, &header, sizeof(header));
+    memcpy(record + sizeof(header), &messageType, sizeof(messageType));
+    memcpy(record + sizeof(header) + sizeof(messageType), site.Format, formatSize);
+    record[header.Size - 1] = 0;
+
+    WriteRecord(record, header.Size);
+}
+
+void BinaryLog::LogMessage(BinaryLogSite& site, const BinaryLogArg* args, unsigned argCount)
+{
+    BinaryLog* binaryLog = OVR_GlobalBinaryLog;
+
+    if (!binaryLog || (getSiteId(site) >= MaxSites))
+    {
+        // No binary log; format as text for the regular log.
+        Log* log = Log::GetGlobalLog();
+        if (!log || !(log->GetLoggingMask() & site.MessageType))
+            return;
+
+        char buffer[Log::MaxLogBufferMessageSize];
+        formatMessage(buffer, sizeof(buffer), site.Format, args, argCount);
+        log->LogMessage(site.MessageType, "%s", buffer);
+        return;
+    }
+
+    binaryLog->defineSite(site);
+
+    UByte        record[MaxRecordSize];
+    RecordHeader header;
+    UInt64       timeNanos = Timer::GetTicksNanos();
+    UPInt        pos       = sizeof(header);
+
+    memcpy(record + pos, &timeNanos, sizeof(timeNanos));
+    pos += sizeof(timeNanos);
+
+    unsigned i;
+    for (i = 0; i < argCount; i++)
+    {
+        const BinaryLogArg& arg = args[i];
+
+        if (arg.Type == BinaryLogArg::Arg_String)
+        {
+            const char* s      = arg.Value.String ? arg.Value.String : "(null)";
+            UPInt       length = OVR_strlen(s);
+            if (length > MaxStringArgSize)
+                length = MaxStringArgSize;
+            if (pos + 2 + length > MaxRecordSize)
+                break;
+            record[pos++] = (UByte)arg.Type;
+            record[pos++] = (UByte)length;
+            memcpy(record + pos, s, length);
+            pos += length;
+        }
+        else
+        {
+            if (pos + 1 + sizeof(UInt64) > MaxRecordSize)
+                break;
+            record[pos++] = (UByte)arg.Type;
+            memcpy(record + pos, &arg.Value, sizeof(UInt64));
+            pos += sizeof(UInt64);
+        }
+    }
+
+    header.Size     = (UInt16)pos;
+    header.Kind     = Record_Message;
+    header.ArgCount = (UByte)i;
+    header.Id       = site.Id;
+    memcpy(record, &header, sizeof(header));
+
+    binaryLog->WriteRecord(record, (unsigned)pos);
+}
+
+
+int BinaryLog::Decode(const UByte* data, UPInt size, Log* log)
+{
+    struct FormatEntry
+    {
+        const char*     Format;
+        LogMessageType  MessageType;
+    };
+
+    FormatEntry  formats[MaxSites];
+    RecordHeader header;
+    UPInt        pos;
+
+    memset(formats, 0, sizeof(formats));
+
+    // First pass: validate record framing and collect format strings.
+    for (pos = 0; pos < size; pos += header.Size)
+    {
+        if (size - pos < sizeof(header))
+            return -1;
+        memcpy(&header, data + pos, sizeof(header));
+        if ((header.Size < sizeof(header)) || (header.Size > size - pos))
+            return -1;
+
+        if ((header.Kind == Record_Format) && (header.Id < MaxSites) &&
+            (header.Size > sizeof(header) + sizeof(UInt32)) && (data[pos + header.Size - 1] == 0))
+        {
+            UInt32 messageType;
+            memcpy(&messageType, data + pos + sizeof(header), sizeof(messageType));
+            formats[header.Id].Format      = (const char*)(data + pos + sizeof(header) + sizeof(messageType));
+            formats[header.Id].MessageType = (LogMessageType)messageType;
+        }
+    }
+
+    // Second pass: format messages.
+    int messageCount = 0;
+
+    for (pos = 0; pos < size; pos += header.Size)
+    {
+        memcpy(&header, data + pos, sizeof(header));
+        if ((header.Kind != Record_Message) || (header.Id >= MaxSites) || !formats[header.Id].Format)
+            continue;
+
+        const UByte* record = data + pos;
+        const UPInt  end    = header.Size;
+        UPInt        rpos   = sizeof(header);
+        UInt64       timeNanos;
+
+        if (rpos + sizeof(timeNanos) > end)
+            return -1;
+        memcpy(&timeNanos, record + rpos, sizeof(timeNanos));
+        rpos += sizeof(timeNanos);
+
+        BinaryLogArg args[MaxArgs];
+        char         strings[MaxArgs][MaxStringArgSize + 1];
+        unsigned     argCount = (header.ArgCount < (unsigned)MaxArgs) ? header.ArgCount : (unsigned)MaxArgs;
+
+        for (unsigned i = 0; i < argCount; i++)
+        {
+            if (rpos >= end)
+                return -1;
+            args[i].Type = (BinaryLogArg::ArgType)record[rpos++];
+
+            if (args[i].Type == BinaryLogArg::Arg_String)
+            {
+                if (rpos >= end || rpos + 1 + record[rpos] > end)
+                    return -1;
+                UPInt length = record[rpos++];
+                memcpy(strings[i], record + rpos, length);
+                strings[i][length] = 0;
+                args[i].Value.String = strings[i];
+                rpos += length;
+            }
+            else
+            {
+                if (rpos + sizeof(UInt64) > end)
+                    return -1;
+                memcpy(&args[i].Value, record + rpos, sizeof(UInt64));
+                rpos += sizeof(UInt64);
+            }
+        }
+
+        char buffer[Log::MaxLogBufferMessageSize];
+        formatMessage(buffer, sizeof(buffer), formats[header.Id].Format, args, argCount);
+        log->LogMessage(formats[header.Id].MessageType, "[%.6f] %s", (double)timeNanos * 1.0e-9, buffer);
+        messageCount++;
+    }
+
+    return messageCount;
+}
+
+
+} // OVR
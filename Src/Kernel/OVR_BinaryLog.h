@@ -0,0 +1,209 @@
+/************************************************************************************
+
+PublicHeader:   OVR.h
+Filename    :   OVR_BinaryLog.h
+Content     :   Binary log records holding a format id and raw arguments.
+Created     :   October 14, 2026
+Notes       :
+
+Copyright   :   Copyright 2014 Oculus VR, Inc. All Rights reserved.
+
+Licensed under the Oculus VR Rift SDK License Version 3.1 (the "License");
+you may not use the Oculus VR Rift SDK except in compliance with the License,
+which is provided at the time of installation or download, or which
+otherwise accompanies this software in either electronic or hard copy form.
+
+You may obtain a copy of the License at
+
+http://www.oculusvr.com/licenses/LICENSE-3.1
+
+Unless required by applicable law or agreed to in writing, the Oculus VR SDK
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+************************************************************************************/
+
+#ifndef OVR_BinaryLog_h
+#define OVR_BinaryLog_h
+
+#include "OVR_Log.h"
+#include "OVR_Atomic.h"
+
+namespace OVR {
+
+
+//-----------------------------------------------------------------------------------
+// ***** Binary Logging
+
+// The OVR_BINARY_LOG_* macros log printf-style messages without formatting them.
+// Each call site gets a static BinaryLogSite whose format string is registered
+// once with the installed BinaryLog; after that a message is a small record with
+// the site id, a timestamp, and the raw arguments. BinaryLog::Decode turns a
+// stream of such records back into text offline.
+//
+// Arguments must be integers, floats, pointers or C strings (strings are copied,
+// up to MaxStringArgSize characters). Up to six arguments are supported:
+//
+//   OVR_BINARY_LOG_TEXT("Timestamp %d rollover, was: %u\n", (i, lowMks));
+//
+// If no BinaryLog is installed the message is formatted and sent to the global
+// Log as usual. Call sites below OVR_LOG_LEVEL compile to nothing.
+
+struct BinaryLogSite
+{
+    const char*         Format;
+    LogMessageType      MessageType;
+    volatile UInt32     Id;         // Assigned on first use; 0 before that.
+};
+
+
+// Captures one argument by value, tagged with its type.
+class BinaryLogArg
+{
+public:
+    enum ArgType
+    {
+        Arg_None,
+        Arg_Int,
+        Arg_UInt,
+        Arg_Double,
+        Arg_Pointer,
+        Arg_String
+    };
+
+    BinaryLogArg() : Type(Arg_None) { Value.UInt = 0; }
+
+    template<class T>
+    BinaryLogArg(T v)                   { Type = (-(T)1 < (T)0) ? Arg_Int : Arg_UInt; Value.UInt = (UInt64)(SInt64)v; }
+    BinaryLogArg(float v)               : Type(Arg_Double)  { Value.Double = v; }
+    BinaryLogArg(double v)              : Type(Arg_Double)  { Value.Double = v; }
+    BinaryLogArg(const char* v)         : Type(Arg_String)  { Value.String = v; }
+    BinaryLogArg(char* v)               : Type(Arg_String)  { Value.String = v; }
+    template<class T>
+    BinaryLogArg(T* v)                  : Type(Arg_Pointer) { Value.UInt = (UInt64)(UPInt)v; }
+
+    ArgType Type;
+    union
+    {
+        UInt64      UInt;
+        double      Double;
+        const char* String;
+    } Value;
+};
+
+
+// Base class for binary log sinks. WriteRecord receives each encoded record and
+// may be called from several threads at once; implementations typically append
+// to a lock-free buffer or file that is decoded later.
+
+class BinaryLog
+{
+public:
+    enum
+    {
+        MaxRecordSize       = 512,
+        MaxStringArgSize    = 255,
+        MaxArgs             = 6,
+        // Sites with ids at or above this are formatted as text instead.
+        MaxSites            = 1024
+    };
+
+    // Record kinds; every record starts with a RecordHeader.
+    enum RecordKind
+    {
+        Record_Format   = 1,    // UInt32 MessageType, NUL-terminated format string.
+        Record_Message  = 2     // UInt64 time in ns, then ArgCount (UByte type, payload) pairs.
+    };
+
+    struct RecordHeader
+    {
+        UInt16  Size;           // Including header.
+        UByte   Kind;
+        UByte   ArgCount;
+        UInt32  Id;
+    };
+
+    BinaryLog();
+    virtual ~BinaryLog();
+
+    virtual void    WriteRecord(const UByte* data, unsigned size) = 0;
+
+    // Logs a message for the site; used by the OVR_BINARY_LOG macros.
+    static void     LogMessage(BinaryLogSite& site, const BinaryLogArg* args, unsigned argCount);
+
+    // Decodes a stream of whole records, sending each message to log as text.
+    // Format records may appear anywhere in the stream. Returns the number of
+    // messages decoded, or -1 if the stream is malformed.
+    static int      Decode(const UByte* data, UPInt size, Log* log);
+
+    // Binary log used by the macros; none by default.
+    static void         SetGlobalBinaryLog(BinaryLog* log);
+    static BinaryLog*   GetGlobalBinaryLog();
+
+private:
+    // Writes the site's format record if this log hasn't seen it yet.
+    void            defineSite(const BinaryLogSite& site);
+
+    AtomicInt<UInt32>   DefinedSites[MaxSites / 32];
+};
+
+
+// Helper returned by the macros so that the parenthesized argument list can
+// be applied to it as a call; overloads cover zero to BinaryLog::MaxArgs arguments.
+class BinaryLogCall
+{
+public:
+    BinaryLogCall(BinaryLogSite& site) : Site(site) { }
+
+    void operator () () const
+    { BinaryLog::LogMessage(Site, 0, 0); }
+    void operator () (const BinaryLogArg& a0) const
+    { BinaryLog::LogMessage(Site, &a0, 1); }
+    void operator () (const BinaryLogArg& a0, const BinaryLogArg& a1) const
+    { BinaryLogArg a[] = { a0, a1 }; BinaryLog::LogMessage(Site, a, 2); }
+    void operator () (const BinaryLogArg& a0, const BinaryLogArg& a1, const BinaryLogArg& a2) const
+    { BinaryLogArg a[] = { a0, a1, a2 }; BinaryLog::LogMessage(Site, a, 3); }
+    void operator () (const BinaryLogArg& a0, const BinaryLogArg& a1, const BinaryLogArg& a2,
+                      const BinaryLogArg& a3) const
+    { BinaryLogArg a[] = { a0, a1, a2, a3 }; BinaryLog::LogMessage(Site, a, 4); }
+    void operator () (const BinaryLogArg& a0, const BinaryLogArg& a1, const BinaryLogArg& a2,
+                      const BinaryLogArg& a3, const BinaryLogArg& a4) const
+    { BinaryLogArg a[] = { a0, a1, a2, a3, a4 }; BinaryLog::LogMessage(Site, a, 5); }
+    void operator () (const BinaryLogArg& a0, const BinaryLogArg& a1, const BinaryLogArg& a2,
+                      const BinaryLogArg& a3, const BinaryLogArg& a4, const BinaryLogArg& a5) const
+    { BinaryLogArg a[] = { a0, a1, a2, a3, a4, a5 }; BinaryLog::LogMessage(Site, a, 6); }
+
+private:
+    BinaryLogSite& Site;
+    void operator = (const BinaryLogCall&);
+};
+
+
+#define OVR_BINARY_LOG_IMPL(type, fmt, args) \
+    do { static OVR::BinaryLogSite ovrBinaryLogSite_ = { fmt, type, 0 }; \
+         (OVR::BinaryLogCall(ovrBinaryLogSite_)) args; } while(0)
+
+#if OVR_LOG_LEVEL >= OVR_LOG_LEVEL_ERROR
+    #define OVR_BINARY_LOG_ERROR(fmt, args)     OVR_BINARY_LOG_IMPL(OVR::Log_Error, fmt, args)
+#else
+    #define OVR_BINARY_LOG_ERROR(fmt, args)     ((void)0)
+#endif
+#if OVR_LOG_LEVEL >= OVR_LOG_LEVEL_TEXT
+    #define OVR_BINARY_LOG_TEXT(fmt, args)      OVR_BINARY_LOG_IMPL(OVR::Log_Text, fmt, args)
+#else
+    #define OVR_BINARY_LOG_TEXT(fmt, args)      ((void)0)
+#endif
+// Unlike OVR_DEBUG_LOG this is also available in release builds that set
+// OVR_LOG_LEVEL to OVR_LOG_LEVEL_DEBUG; the text fallback still drops it there.
+#if OVR_LOG_LEVEL >= OVR_LOG_LEVEL_DEBUG
+    #define OVR_BINARY_LOG_DEBUG(fmt, args)     OVR_BINARY_LOG_IMPL(OVR::Log_Debug, fmt, args)
+#else
+    #define OVR_BINARY_LOG_DEBUG(fmt, args)     ((void)0)
+#endif
+
+
+} // OVR
+
+#endif
@@ -66,6 +66,19 @@ public:
         *(T*)p = source;
     }
 
+    static void ConstructMove(void *p, T& source)
+    {
+        *(T*)p = source;
+    }
+
+#ifdef OVR_CPP_VARIADIC_TEMPLATES
+    template <class... Args>
+    static void ConstructEmplace(void *p, Args&&... args)
+    {
+        OVR::ConstructEmplace<T>(p, Forward<Args>(args)...);
+    }
+#endif
+
     // Same as above, but allows for a different type of constructor.
     template <class S> 
     static void ConstructAlt(void *p, const S& source)
@@ -122,6 +135,27 @@ public:
         OVR::Construct<T>(p, source);
     }
 
+    // Moves source into p; used when elements are relocated.
+    static void ConstructMove(void* p, T& source)
+    {
+        OVR::ConstructMove<T>(p, source);
+    }
+
+#ifdef OVR_CPP_RVALUE_REFERENCES
+    static void Construct(void* p, T&& source)
+    {
+        OVR::ConstructMove<T>(p, source);
+    }
+#endif
+
+#ifdef OVR_CPP_VARIADIC_TEMPLATES
+    template <class... Args>
+    static void ConstructEmplace(void* p, Args&&... args)
+    {
+        OVR::ConstructEmplace<T>(p, Forward<Args>(args)...);
+    }
+#endif
+
     // Same as above, but allows for a different type of constructor.
     template <class S> 
     static void ConstructAlt(void* p, const S& source)
@@ -195,6 +229,27 @@ public:
         OVR::Construct<T>(p, source);        
     }
 
+    // Moves source into p; used when elements are relocated.
+    static void ConstructMove(void* p, T& source)
+    {
+        OVR::ConstructMove<T>(p, source);
+    }
+
+#ifdef OVR_CPP_RVALUE_REFERENCES
+    static void Construct(void* p, T&& source)
+    {
+        OVR::ConstructMove<T>(p, source);
+    }
+#endif
+
+#ifdef OVR_CPP_VARIADIC_TEMPLATES
+    template <class... Args>
+    static void ConstructEmplace(void* p, Args&&... args)
+    {
+        OVR::ConstructEmplace<T>(p, Forward<Args>(args)...);
+    }
+#endif
+
     // Same as above, but allows for a different type of constructor.
     template <class S> 
     static void ConstructAlt(void* p, const S& source)
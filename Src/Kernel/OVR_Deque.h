@@ -33,12 +33,17 @@ template <class Elem>
 class Deque
 {
 public:
+    typedef Elem ValueType;
+
     enum
     {
         DefaultCapacity = 500
     };
 
     Deque(int capacity = DefaultCapacity);
+    // Uses capacity elements at storage, already constructed and owned by the
+    // caller, instead of allocating them; see DequeInline.
+    Deque(Elem* storage, int capacity);
     virtual ~Deque(void);
 
     virtual void         PushBack   (const Elem &Item);    // Adds Item to the end
@@ -64,6 +69,15 @@ protected:
     // is much more convenient.
     int         ElemCount;
 
+    // False if Data was given to the constructor.
+    bool        OwnsData;
+
+    // Index in Data of idx, for idx in [-Capacity, 2 * Capacity).
+    int         wrapIndex(int idx) const
+    {
+        return (idx < 0) ? idx + Capacity : ((idx >= Capacity) ? idx - Capacity : idx);
+    }
+
 private:
     Deque&      operator= (const Deque& q) { }; // forbidden
     Deque(const Deque<Elem> &OtherDeque) { };
@@ -74,6 +88,7 @@ class InPlaceMutableDeque : public Deque<Elem>
 {
 public:
     InPlaceMutableDeque( int capacity = Deque<Elem>::DefaultCapacity ) : Deque<Elem>( capacity ) {}
+    InPlaceMutableDeque( Elem* storage, int capacity ) : Deque<Elem>( storage, capacity ) {}
 	virtual ~InPlaceMutableDeque() {};
 
     using Deque<Elem>::PeekBack;
@@ -89,6 +104,7 @@ class CircularBuffer : public InPlaceMutableDeque<Elem>
 {
 public:
     CircularBuffer(int MaxSize = Deque<Elem>::DefaultCapacity) : InPlaceMutableDeque<Elem>(MaxSize) { };
+    CircularBuffer(Elem* storage, int MaxSize) : InPlaceMutableDeque<Elem>(storage, MaxSize) { };
 
     // The following methods are inline as a workaround for a VS bug causing erroneous C4505 warnings
     // See: http://stackoverflow.com/questions/3051992/compiler-warning-at-c-template-base-class
@@ -96,23 +112,170 @@ public:
     inline virtual void PushFront (const Elem &Item);    // Adds Item to the beginning, overwriting the oldest element at the end if necessary
 };
 
+// Element storage of DequeInline; a separate base so that it is constructed
+// before the container that uses it.
+template <class Elem, int N>
+struct DequeInlineStorage
+{
+    Elem InlineData[N];
+};
+
+// Any Deque-based container, such as CircularBuffer or the sensor filters, with
+// its N elements kept inside the object, so that creating and clearing it never
+// touches the heap. Container must have a (storage, capacity) constructor.
+template <class Container, int N>
+class DequeInline : private DequeInlineStorage<typename Container::ValueType, N>, public Container
+{
+public:
+    DequeInline() : Container(this->InlineData, N) { }
+};
+
+// A Deque with its N elements inside the object and no virtual functions, for
+// the buffers that every sensor sample goes through. N must be a power of two, so
+// that indices wrap with a mask. It keeps at most capacity <= N elements, so that
+// rounding the storage up to a power of two doesn't change how much is kept.
+// Popped elements stay in their slots until overwritten, so Elem should be a
+// plain value.
+template <class Elem, int N>
+class DequeFixed
+{
+public:
+    typedef Elem ValueType;
+
+    enum
+    {
+        DefaultCapacity = N
+    };
+
+    DequeFixed(int capacity = N) : Capacity(capacity), Beginning(0), End(0), ElemCount(0)
+    {
+        OVR_COMPILER_ASSERT((N & (N - 1)) == 0);
+        OVR_ASSERT(capacity > 0 && capacity <= N);
+    }
+
+    void PushBack(const Elem &Item)
+    {
+        OVR_ASSERT( ElemCount < Capacity );
+        Data[ End ] = Item;
+        End = (End + 1) & Mask;
+        ++ElemCount;
+    }
+
+    void PushFront(const Elem &Item)
+    {
+        OVR_ASSERT( ElemCount < Capacity );
+        Beginning = (Beginning - 1) & Mask;
+        Data[ Beginning ] = Item;
+        ++ElemCount;
+    }
+
+    Elem PopBack()
+    {
+        OVR_ASSERT( ElemCount > 0 );
+        End = (End - 1) & Mask;
+        --ElemCount;
+        return Data[ End ];
+    }
+
+    Elem PopFront()
+    {
+        OVR_ASSERT( ElemCount > 0 );
+        int idx   = Beginning;
+        Beginning = (Beginning + 1) & Mask;
+        --ElemCount;
+        return Data[ idx ];
+    }
+
+    const Elem& PeekBack(int count = 0) const
+    {
+        OVR_ASSERT( ElemCount > count );
+        return Data[ (End - count - 1) & Mask ];
+    }
+    const Elem& PeekFront(int count = 0) const
+    {
+        OVR_ASSERT( ElemCount > count );
+        return Data[ (Beginning + count) & Mask ];
+    }
+    Elem& PeekBack(int count = 0)
+    {
+        OVR_ASSERT( ElemCount > count );
+        return Data[ (End - count - 1) & Mask ];
+    }
+    Elem& PeekFront(int count = 0)
+    {
+        OVR_ASSERT( ElemCount > count );
+        return Data[ (Beginning + count) & Mask ];
+    }
+
+    UPInt GetSize() const     { return ElemCount; }
+    UPInt GetCapacity() const { return Capacity; }
+    void  Clear()             { Beginning = 0; End = 0; ElemCount = 0; }
+    bool  IsEmpty() const     { return ElemCount == 0; }
+    bool  IsFull() const      { return ElemCount == Capacity; }
+
+protected:
+    enum { Mask = N - 1 };
+
+    // Index in Data of idx, for any idx; the same as Deque's.
+    int         wrapIndex(int idx) const { return idx & Mask; }
+
+    Elem        Data[N];
+    int         Capacity;
+    int         Beginning;
+    int         End;
+    int         ElemCount;
+};
+
+// CircularBuffer on a DequeFixed.
+template <class Elem, int N>
+class CircularBufferFixed : public DequeFixed<Elem, N>
+{
+public:
+    CircularBufferFixed(int capacity = N) : DequeFixed<Elem, N>(capacity) { }
+
+    // Adds Item to the end, overwriting the oldest element at the beginning if necessary
+    void PushBack(const Elem &Item)
+    {
+        if (this->IsFull())
+            this->PopFront();
+        DequeFixed<Elem, N>::PushBack(Item);
+    }
+
+    // Adds Item to the beginning, overwriting the oldest element at the end if necessary
+    void PushFront(const Elem &Item)
+    {
+        if (this->IsFull())
+            this->PopBack();
+        DequeFixed<Elem, N>::PushFront(Item);
+    }
+};
+
 //----------------------------------------------------------------------------------
 
 // Deque Constructor function
 template <class Elem>
 Deque<Elem>::Deque(int capacity) :
-Capacity( capacity ), Beginning(0), End(0), ElemCount(0)
+Capacity( capacity ), Beginning(0), End(0), ElemCount(0), OwnsData(true)
 {
     Data = (Elem*) OVR_ALLOC(Capacity * sizeof(Elem));
     ConstructArray<Elem>(Data, Capacity);
 }
 
+template <class Elem>
+Deque<Elem>::Deque(Elem* storage, int capacity) :
+Data( storage ), Capacity( capacity ), Beginning(0), End(0), ElemCount(0), OwnsData(false)
+{
+}
+
 // Deque Destructor function
 template <class Elem>
 Deque<Elem>::~Deque(void)
 {
-    DestructArray<Elem>(Data, Capacity);
-    OVR_FREE(Data);
+    if (OwnsData)
+    {
+        DestructArray<Elem>(Data, Capacity);
+        OVR_FREE(Data);
+    }
 }
 
 template <class Elem>
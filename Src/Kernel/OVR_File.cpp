@@ -34,6 +34,25 @@ limitations under the License.
 
 namespace OVR {
 
+// ***** File
+
+// Default gather write, for files that have nothing better than Write
+int     File::WriteGather(const FileIOVec* pvecs, int count)
+{
+    int total = 0;
+    for (int i = 0; i < count; i++)
+    {
+        int sz = Write(pvecs[i].pData, pvecs[i].Size);
+        if (sz < 0)
+            return total ? total : -1;
+        total += sz;
+        if (sz < pvecs[i].Size)
+            break;
+    }
+    return total;
+}
+
+
 // Buffered file adds buffering to an existing file
 // FILEBUFFER_SIZE defines the size of internal buffer, while
 // FILEBUFFER_TOLERANCE controls the amount of data we'll effectively try to buffer
@@ -268,6 +287,41 @@ int     BufferedFile::Write(const UByte *psourceBuffer, int numBytes)
     return sz;
 }
 
+int     BufferedFile::WriteGather(const FileIOVec* pvecs, int count)
+{
+    if ( (BufferMode==WriteBuffer) || SetBufferMode(WriteBuffer))
+    {
+        int totalBytes = 0;
+        for (int i = 0; i < count; i++)
+            totalBytes += pvecs[i].Size;
+
+        if ((FILEBUFFER_SIZE-(int)Pos)<totalBytes)
+        {
+            FlushBuffer();
+            // Large gathers go straight through, so that the file can write
+            // them without copying
+            if (totalBytes>FILEBUFFER_TOLERANCE)
+            {
+                int sz = pFile->WriteGather(pvecs,count);
+                if (sz > 0)
+                    FilePos += sz;
+                return sz;
+            }
+        }
+
+        for (int i = 0; i < count; i++)
+        {
+            memcpy(pBuffer+Pos, pvecs[i].pData, pvecs[i].Size);
+            Pos += pvecs[i].Size;
+        }
+        return totalBytes;
+    }
+    int sz = pFile->WriteGather(pvecs,count);
+    if (sz > 0)
+        FilePos += sz;
+    return sz;
+}
+
 int     BufferedFile::Read(UByte *pdestBuffer, int numBytes)
 {
     if ( (BufferMode==ReadBuffer) || SetBufferMode(ReadBuffer))
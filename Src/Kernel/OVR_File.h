@@ -77,7 +77,11 @@ public:
         Open_CreateOnly = 24,
 
         // Open file with buffering
-        Open_Buffered    = 32
+        Open_Buffered    = 32,
+
+        // Queue writes and perform them on a background thread (see WriteBehindFile)
+        // - ignored unless the file is opened for writing
+        Open_WriteBehind = 64
     };
 
     // *** File Mode flags
@@ -109,6 +113,17 @@ public:
 };
 
 
+//-----------------------------------------------------------------------------------
+// ***** FileIOVec
+
+// One buffer of a gather write; see File::WriteGather.
+struct FileIOVec
+{
+    const UByte*    pData;
+    int             Size;
+};
+
+
 //-----------------------------------------------------------------------------------
 // ***** File Class
 
@@ -157,6 +172,11 @@ public:
     // Returns : -1 for error
     //           Otherwise number of bytes read 
     virtual int         Write(const UByte *pbufer, int numBytes) = 0;
+    // Gather write, writes the given buffers in order as if by consecutive Write calls,
+    // but lets the implementation hand them to the system in one request
+    // Returns : -1 for error
+    //           Otherwise total number of bytes written
+    virtual int         WriteGather(const FileIOVec* pvecs, int count);
     // Blocking read, will read in the given number of bytes or less from the stream
     // Returns : -1 for error
     //           Otherwise number of bytes read,
@@ -305,6 +325,7 @@ public:
     
     // ** Stream implementation & I/O
     virtual int         Write(const UByte *pbuffer, int numBytes)   { return pFile->Write(pbuffer,numBytes); }  
+    virtual int         WriteGather(const FileIOVec* pvecs, int count) { return pFile->WriteGather(pvecs,count); }
     virtual int         Read(UByte *pbuffer, int numBytes)          { return pFile->Read(pbuffer,numBytes); }   
     
     virtual int         SkipBytes(int numBytes)                     { return pFile->SkipBytes(numBytes); }      
@@ -384,6 +405,7 @@ public:
 //  virtual bool        Stat(GFileStats *pfs);  
 
     virtual int         Write(const UByte *pbufer, int numBytes);
+    virtual int         WriteGather(const FileIOVec* pvecs, int count);
     virtual int         Read(UByte *pbufer, int numBytes);
 
     virtual int         SkipBytes(int numBytes);
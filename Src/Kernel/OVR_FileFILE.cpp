@@ -42,6 +42,13 @@ limitations under the License.
 #include <errno.h>
 #endif
 
+#if !defined(OVR_OS_WIN32) && !defined(OVR_OS_WINCE)
+#define OVR_FILE_WRITEV
+#include <sys/types.h>
+#include <sys/uio.h>
+#include <unistd.h>
+#endif
+
 namespace OVR {
 
 // ***** File interface
@@ -166,6 +173,9 @@ public:
 
     // ** Stream implementation & I/O
     virtual int         Write(const UByte *pbuffer, int numBytes);
+#ifdef OVR_FILE_WRITEV
+    virtual int         WriteGather(const FileIOVec* pvecs, int count);
+#endif
     virtual int         Read(UByte *pbuffer, int numBytes);
     virtual int         SkipBytes(int numBytes);
     virtual int         BytesAvailable();
@@ -349,6 +359,59 @@ int     FILEFile::Write(const UByte *pbuffer, int numBytes)
     return written;
 }
 
+#ifdef OVR_FILE_WRITEV
+// Gathers go to the descriptor with writev; the stream is flushed first and
+// re-seeked after, so that its buffer and position stay consistent.
+int     FILEFile::WriteGather(const FileIOVec* pvecs, int count)
+{
+#ifdef OVR_FILE_VERIFY_SEEK_ERRORS
+    return File::WriteGather(pvecs, count);
+#else
+    LastOp = Open_Write;
+    if (fflush(fs) != 0)
+    {
+        ErrorCode = SFerror();
+        return -1;
+    }
+
+    int fd      = fileno(fs);
+    int total   = 0;
+    int written = 0;
+    for (int i = 0; i < count; )
+    {
+        struct iovec iov[64];
+        int          batch      = 0;
+        int          batchBytes = 0;
+        for (; batch < 64 && i < count; batch++, i++)
+        {
+            iov[batch].iov_base = (void*)pvecs[i].pData;
+            iov[batch].iov_len  = pvecs[i].Size;
+            batchBytes         += pvecs[i].Size;
+        }
+
+        do {
+            written = (int)::writev(fd, iov, batch);
+        } while (written < 0 && errno == EINTR);
+        if (written < 0)
+        {
+            ErrorCode = SFerror();
+            break;
+        }
+        total += written;
+        if (written < batchBytes)
+        {
+            // Regular files only write short when out of space.
+            ErrorCode = Error_DiskFull;
+            break;
+        }
+    }
+
+    fseeko(fs, lseek(fd, 0, SEEK_CUR), SEEK_SET);
+    return (written < 0 && total == 0) ? -1 : total;
+#endif
+}
+#endif // OVR_FILE_WRITEV
+
 int     FILEFile::Read(UByte *pbuffer, int numBytes)
 {
     if (LastOp && LastOp != Open_Read)
@@ -204,6 +204,9 @@ public:
     HashSetBase() : pTable(NULL)                       {   }
     HashSetBase(int sizeHint) : pTable(NULL)           { SetCapacity(this, sizeHint);  }
     HashSetBase(const SelfType& src) : pTable(NULL)    { Assign(this, src); }
+#ifdef OVR_CPP_RVALUE_REFERENCES
+    HashSetBase(SelfType&& src) : pTable(src.pTable)  { src.pTable = NULL; }
+#endif
 
     ~HashSetBase()                                     
     { 
@@ -223,6 +226,18 @@ public:
     }
 
 
+#ifdef OVR_CPP_RVALUE_REFERENCES
+    // Takes over the table of src, leaving it empty.
+    void Assign(SelfType&& src)
+    {
+        if (&src == this)
+            return;
+        Clear();
+        pTable     = src.pTable;
+        src.pTable = NULL;
+    }
+#endif
+
     void Assign(const SelfType& src)
     {
         Clear();
@@ -919,9 +934,15 @@ public:
     HashSet()                                      {   }
     HashSet(int sizeHint) : BaseType(sizeHint)     {   }
     HashSet(const SelfType& src) : BaseType(src)   {   }
+#ifdef OVR_CPP_RVALUE_REFERENCES
+    HashSet(SelfType&& src) : BaseType(Move(src))  {   }
+#endif
     ~HashSet()                                     {   }
 
     void operator = (const SelfType& src)   { BaseType::Assign(src); }
+#ifdef OVR_CPP_RVALUE_REFERENCES
+    void operator = (SelfType&& src)        { BaseType::Assign(Move(src)); }
+#endif
 
     // Set a new or existing value under the key, to the value.
     // Pass a different class of 'key' so that assignment reference object
@@ -1009,10 +1030,29 @@ struct HashNode
         operator const C& () const              { return *pFirst; }
     };
 
+#ifdef OVR_CPP_RVALUE_REFERENCES
+    // NodeMoveRef is a NodeRef whose value is moved into the node;
+    // the key is still copied since it may be needed after insertion.
+    struct NodeMoveRef
+    {
+        const C*   pFirst;
+        U*         pSecond;
+
+        NodeMoveRef(const C& f, U& s)       : pFirst(&f), pSecond(&s) { }
+
+        inline UPInt GetHash() const            { return HashF()(*pFirst); }
+        operator const C& () const              { return *pFirst; }
+    };
+#endif
+
     // Note: No default constructor is necessary.
      HashNode(const HashNode& src) : First(src.First), Second(src.Second)    { }
      HashNode(const NodeRef& src) : First(*src.pFirst), Second(*src.pSecond)  { }
     void operator = (const NodeRef& src)  { First  = *src.pFirst; Second = *src.pSecond; }
+#ifdef OVR_CPP_RVALUE_REFERENCES
+     HashNode(const NodeMoveRef& src) : First(*src.pFirst), Second(Move(*src.pSecond)) { }
+    void operator = (const NodeMoveRef& src)  { First  = *src.pFirst; Second = Move(*src.pSecond); }
+#endif
 
     template<class K>
     bool operator == (const K& src) const   { return (First == src); }
@@ -1061,6 +1101,10 @@ public:
         : NextInChain(next), Value(key) { }    
     HashsetNodeEntry(const typename C::NodeRef& keyRef, SPInt next)
         : NextInChain(next), Value(keyRef) { }
+#ifdef OVR_CPP_RVALUE_REFERENCES
+    HashsetNodeEntry(const typename C::NodeMoveRef& keyRef, SPInt next)
+        : NextInChain(next), Value(keyRef) { }
+#endif
 
     bool    IsEmpty() const             { return NextInChain == -2;  }
     bool    IsEndOfChain() const        { return NextInChain == -1;  }
@@ -1096,6 +1140,10 @@ public:
         : NextInChain(next), Value(key) { }
     HashsetCachedNodeEntry(const typename C::NodeRef& keyRef, SPInt next)
         : NextInChain(next), Value(keyRef) { }
+#ifdef OVR_CPP_RVALUE_REFERENCES
+    HashsetCachedNodeEntry(const typename C::NodeMoveRef& keyRef, SPInt next)
+        : NextInChain(next), Value(keyRef) { }
+#endif
 
     bool    IsEmpty() const            { return NextInChain == -2;  }
     bool    IsEndOfChain() const       { return NextInChain == -1;  }
@@ -1138,9 +1186,15 @@ public:
     Hash()     {  }
     Hash(int sizeHint) : mHash(sizeHint)                        { }
     Hash(const SelfType& src) : mHash(src.mHash)                { }
+#ifdef OVR_CPP_RVALUE_REFERENCES
+    Hash(SelfType&& src) : mHash(Move(src.mHash))               { }
+#endif
     ~Hash()                                                     { }
 
     void    operator = (const SelfType& src)    { mHash = src.mHash; }
+#ifdef OVR_CPP_RVALUE_REFERENCES
+    void    operator = (SelfType&& src)         { mHash = Move(src.mHash); }
+#endif
 
     // Remove all entries from the Hash table.
     inline void    Clear() { mHash.Clear(); }
@@ -1159,6 +1213,20 @@ public:
         mHash.Add(e);
     }
 
+#ifdef OVR_CPP_RVALUE_REFERENCES
+    // Rvalue versions move the value into the table; the key is copied.
+    inline void    Set(const C& key, U&& value)
+    {
+        typename HashNode::NodeMoveRef e(key, value);
+        mHash.Set(e);
+    }
+    inline void    Add(const C& key, U&& value)
+    {
+        typename HashNode::NodeMoveRef e(key, value);
+        mHash.Add(e);
+    }
+#endif
+
     // Removes an element by clearing its Entry.
     inline void     Remove(const C& key)
     {   
@@ -0,0 +1,137 @@
+/************************************************************************************
+
+Filename    :   OVR_HashFlat.cpp
+Content     :   HashFlat benchmark against Hash.
+Created     :   October 14, 2026
+
+Copyright   :   Copyright 2014 Oculus VR, Inc. All Rights reserved.
+
+Licensed under the Oculus VR Rift SDK License Version 3.1 (the "License");
+you may not use the Oculus VR Rift SDK except in compliance with the License,
+which is provided at the time of installation or download, or which
+otherwise accompanies this software in either electronic or hard copy form.
+
+You may obtain a copy of the License at
+
+http://www.oculusvr.com/licenses/LICENSE-3.1
+
+Unless required by applicable law or agreed to in writing, the Oculus VR SDK
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+*************************************************************************************/
+
+#include "OVR_HashFlat.h"
+
+#ifdef OVR_HASHFLAT_BENCHMARK
+
+#include "OVR_Array.h"
+#include "OVR_Log.h"
+#include "OVR_Std.h"
+#include "OVR_String.h"
+#include "OVR_Timer.h"
+
+namespace OVR {
+
+
+//-------------------------------------------------------------------------------------
+// ***** HashFlat Benchmark
+
+namespace HashFlatBenchmark {
+
+struct Times
+{
+    double Insert, Lookup, Iterate;
+    UPInt  Checksum;
+};
+
+static UPInt valueOf(int v)            { return (UPInt)v; }
+static UPInt valueOf(const String& v)  { return v.GetSize(); }
+
+// Table is either Hash or HashFlat; both expose the same API.
+template<class Table, class K>
+static Times timeTable(const Array<K>& keys, int lookupPasses)
+{
+    Times  t;
+    UPInt  checksum = 0;
+    Table  table;
+    int    count = (int)keys.GetSize();
+
+    double start = Timer::GetSeconds();
+    for (int i = 0; i < count; i++)
+        table.Set(keys[i], i);
+    t.Insert = Timer::GetSeconds() - start;
+
+    start = Timer::GetSeconds();
+    for (int pass = 0; pass < lookupPasses; pass++)
+    {
+        for (int i = 0; i < count; i++)
+        {
+            const int* pvalue = table.Get(keys[i]);
+            if (pvalue)
+                checksum += *pvalue;
+        }
+    }
+    t.Lookup = Timer::GetSeconds() - start;
+
+    start = Timer::GetSeconds();
+    for (int pass = 0; pass < lookupPasses; pass++)
+    {
+        for (typename Table::ConstIterator it = table.Begin(); it != table.End(); ++it)
+            checksum += valueOf(it->First) + it->Second;
+    }
+    t.Iterate = Timer::GetSeconds() - start;
+
+    t.Checksum = checksum;
+    return t;
+}
+
+template<class HashTable, class FlatTable, class K>
+static void runForKeys(const char* name, const Array<K>& keys, int lookupPasses)
+{
+    Times h = timeTable<HashTable>(keys, lookupPasses);
+    Times f = timeTable<FlatTable>(keys, lookupPasses);
+
+    const double count   = (double)keys.GetSize();
+    const double lookups = count * lookupPasses;
+
+    LogText("HashFlat %-6s x%d: insert %6.1f/%6.1f ns  lookup %6.1f/%6.1f ns  "
+            "iterate %6.1f/%6.1f ns (Hash/HashFlat)%s\n",
+            name, (int)keys.GetSize(),
+            h.Insert * 1.0e9 / count,   f.Insert * 1.0e9 / count,
+            h.Lookup * 1.0e9 / lookups, f.Lookup * 1.0e9 / lookups,
+            h.Iterate * 1.0e9 / lookups, f.Iterate * 1.0e9 / lookups,
+            (h.Checksum == f.Checksum) ? "" : "  CHECKSUM MISMATCH");
+}
+
+} // namespace HashFlatBenchmark
+
+
+void RunHashFlatBenchmark(int count, int lookupPasses)
+{
+    using namespace HashFlatBenchmark;
+
+    Array<int>    intKeys;
+    Array<String> stringKeys;
+    UInt32        seed = 0x2545F491;
+
+    for (int i = 0; i < count; i++)
+    {
+        seed = seed * 1664525u + 1013904223u;
+        intKeys.PushBack((int)(seed >> 1));
+        char key[32];
+        OVR_sprintf(key, sizeof(key), "Profile.Key.%u", seed >> 8);
+        stringKeys.PushBack(String(key));
+    }
+
+    runForKeys<Hash<int, int>, HashFlat<int, int> >("int", intKeys, lookupPasses);
+    runForKeys<Hash<String, int, String::HashFunctor>,
+               HashFlat<String, int, String::HashFunctor> >("String", stringKeys, lookupPasses);
+}
+
+
+} // OVR
+
+#endif // OVR_HASHFLAT_BENCHMARK
@@ -0,0 +1,489 @@
+/************************************************************************************
+
+PublicHeader:   OVR.h
+Filename    :   OVR_HashFlat.h
+Content     :   Open-addressing hash table with Robin Hood probing.
+Created     :   October 14, 2026
+Notes       :   HashFlat offers the same Set/Get/Remove/iterator API as Hash,
+                but stores entries in a single flat array.
+
+Copyright   :   Copyright 2014 Oculus VR, Inc. All Rights reserved.
+
+Licensed under the Oculus VR Rift SDK License Version 3.1 (the "License");
+you may not use the Oculus VR Rift SDK except in compliance with the License,
+which is provided at the time of installation or download, or which
+otherwise accompanies this software in either electronic or hard copy form.
+
+You may obtain a copy of the License at
+
+http://www.oculusvr.com/licenses/LICENSE-3.1
+
+Unless required by applicable law or agreed to in writing, the Oculus VR SDK
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+************************************************************************************/
+
+#ifndef OVR_HashFlat_h
+#define OVR_HashFlat_h
+
+#include "OVR_Hash.h"
+
+// Uncomment to compile RunHashFlatBenchmark, which compares HashFlat
+// against Hash for insertion, lookup and iteration.
+//#define OVR_HASHFLAT_BENCHMARK
+
+#undef new
+
+namespace OVR {
+
+
+//-----------------------------------------------------------------------------------
+// ***** HashFlat
+
+// HashFlat is a key/value map using open addressing with Robin Hood linear
+// probing. Each slot stores the cached hash, its probe distance and the
+// key/value node inline, so a lookup walks adjacent memory instead of
+// following chain indices. Lookups stop as soon as they reach a slot that
+// is closer to its home than the probe would be, and Remove uses backward
+// shifting, so no tombstones are left behind.
+//
+// The API mirrors Hash: Set/Add/Get/GetAlt/Remove/RemoveAlt, Find/FindAlt
+// and Iterator with node First/Second access. Like any open-addressing
+// table, inserts and removes may move other entries, so element pointers
+// and iterators are invalidated by modification (except Iterator::Remove).
+
+template<class C, class U,
+         class HashF = FixedSizeHash<C>,
+         class Allocator = ContainerAllocator<C> >
+class HashFlat
+{
+public:
+    OVR_MEMORY_REDEFINE_NEW(HashFlat)
+
+    typedef U                                       ValueType;
+    typedef HashFlat<C, U, HashF, Allocator>        SelfType;
+
+    // Key/value pair stored by the table; matches HashNode member naming.
+    struct Node
+    {
+        C   First;
+        U   Second;
+
+        Node(const C& key, const U& value) : First(key), Second(value) { }
+    };
+
+    enum { HashMinSize = 8 };
+
+    HashFlat() : pTable(NULL)                         { }
+    HashFlat(int sizeHint) : pTable(NULL)             { SetCapacity(sizeHint); }
+    HashFlat(const SelfType& src) : pTable(NULL)      { assign(src); }
+    ~HashFlat()                                       { Clear(); }
+
+    void    operator = (const SelfType& src)          { assign(src); }
+
+    // Remove all entries and free the table.
+    void    Clear()
+    {
+        if (pTable)
+        {
+            for (UPInt i = 0, n = pTable->SizeMask; i <= n; i++)
+            {
+                Entry& e = E(i);
+                if (!e.IsEmpty())
+                    Destruct<Node>(e.GetNode());
+            }
+            Allocator::Free(pTable);
+            pTable = NULL;
+        }
+    }
+
+    bool    IsEmpty() const                 { return GetSize() == 0; }
+    UPInt   GetSize() const                 { return pTable ? pTable->EntryCount : 0; }
+
+    // Set a new or existing value under the key.
+    void    Set(const C& key, const U& value)
+    {
+        UPInt hashValue = hashOf(key);
+        SPInt index     = findIndexCore(key, hashValue);
+        if (index >= 0)
+            E(index).GetNode()->Second = value;
+        else
+            add(key, value, hashValue);
+    }
+
+    // Add a key that is known not to be present.
+    void    Add(const C& key, const U& value)
+    {
+        OVR_ASSERT(findIndexCore(key, hashOf(key)) < 0);
+        add(key, value, hashOf(key));
+    }
+
+    void    Remove(const C& key)            { RemoveAlt(key); }
+
+    template<class K>
+    void    RemoveAlt(const K& key)
+    {
+        SPInt index = findIndexCore(key, hashOf(key));
+        if (index >= 0)
+            removeAt((UPInt)index);
+    }
+
+    // Retrieve the value under the given key; returns false if not found.
+    bool    Get(const C& key, U* pvalue) const      { return GetAlt(key, pvalue); }
+
+    template<class K>
+    bool    GetAlt(const K& key, U* pvalue) const
+    {
+        SPInt index = findIndexCore(key, hashOf(key));
+        if (index < 0)
+            return false;
+        if (pvalue)
+            *pvalue = E(index).GetNode()->Second;
+        return true;
+    }
+
+    // Pointer-returning variety; the pointer is valid until the table is modified.
+    U*          Get(const C& key)                   { return GetAlt(key); }
+    const U*    Get(const C& key) const             { return GetAlt(key); }
+
+    template<class K>
+    U*      GetAlt(const K& key)
+    {
+        SPInt index = findIndexCore(key, hashOf(key));
+        return (index >= 0) ? &E(index).GetNode()->Second : 0;
+    }
+    template<class K>
+    const U* GetAlt(const K& key) const
+    {
+        return const_cast<SelfType*>(this)->GetAlt(key);
+    }
+
+    // Size the table so that it can hold newSize elements without growing.
+    void    SetCapacity(UPInt newSize)
+    {
+        UPInt newRawSize = newSize * 2;
+        if (newRawSize <= GetSize())
+            return;
+        setRawCapacity(newRawSize);
+    }
+    void    Resize(UPInt n)                 { SetCapacity(n); }
+
+
+    // Iterator API, like Hash.
+    struct ConstIterator
+    {
+        const Node& operator * () const
+        {
+            OVR_ASSERT(Index >= 0 && Index <= (SPInt)pHash->pTable->SizeMask);
+            return *pHash->E(Index).GetNode();
+        }
+        const Node* operator -> () const    { return &operator*(); }
+
+        void    operator ++ ()
+        {
+            // Find next occupied entry.
+            if (Index <= (SPInt)pHash->pTable->SizeMask)
+            {
+                Index++;
+                while ((UPInt)Index <= pHash->pTable->SizeMask && pHash->E(Index).IsEmpty())
+                    Index++;
+            }
+        }
+
+        bool    operator == (const ConstIterator& it) const
+        {
+            if (IsEnd() && it.IsEnd())
+                return true;
+            return (pHash == it.pHash) && (Index == it.Index);
+        }
+        bool    operator != (const ConstIterator& it) const { return !(*this == it); }
+
+        bool    IsEnd() const
+        {
+            return (pHash == NULL) || (pHash->pTable == NULL) ||
+                   (Index > (SPInt)pHash->pTable->SizeMask);
+        }
+
+        ConstIterator() : pHash(NULL), Index(0) { }
+        ConstIterator(const SelfType* h, SPInt index) : pHash(h), Index(index) { }
+
+        const SelfType* GetContainer() const    { return pHash; }
+        SPInt           GetIndex() const        { return Index; }
+
+    protected:
+        const SelfType* pHash;
+        SPInt           Index;
+    };
+
+    struct Iterator : public ConstIterator
+    {
+        Node&   operator * () const
+        {
+            OVR_ASSERT(ConstIterator::Index >= 0 &&
+                       ConstIterator::Index <= (SPInt)ConstIterator::pHash->pTable->SizeMask);
+            return *const_cast<SelfType*>(ConstIterator::pHash)->E(ConstIterator::Index).GetNode();
+        }
+        Node*   operator -> () const    { return &operator*(); }
+
+        Iterator() : ConstIterator(NULL, 0) { }
+        Iterator(SelfType* h, SPInt index) : ConstIterator(h, index) { }
+
+        // Removes current element; the next operator ++ moves to the element
+        // following it. As with Hash, removal while iterating may shift a
+        // wrapped-around entry from the table start into the last slot, where
+        // it is visited again.
+        void    Remove()
+        {
+            SelfType* phash = const_cast<SelfType*>(ConstIterator::pHash);
+            UPInt     index = (UPInt)ConstIterator::Index;
+            phash->removeAt(index);
+            // Backward shift moved the next entry into this slot; revisit it.
+            if (index < phash->pTable->SizeMask && !phash->E(index).IsEmpty())
+                ConstIterator::Index--;
+        }
+    };
+
+    friend struct ConstIterator;
+    friend struct Iterator;
+
+    Iterator        Begin()
+    {
+        if (pTable == NULL)
+            return Iterator(NULL, 0);
+        UPInt i0 = 0;
+        while (i0 <= pTable->SizeMask && E(i0).IsEmpty())
+            i0++;
+        return Iterator(this, i0);
+    }
+    Iterator        End()                       { return Iterator(NULL, 0); }
+    ConstIterator   Begin() const               { return const_cast<SelfType*>(this)->Begin(); }
+    ConstIterator   End() const                 { return const_cast<SelfType*>(this)->End(); }
+
+    Iterator        Find(const C& key)          { return FindAlt(key); }
+    ConstIterator   Find(const C& key) const    { return FindAlt(key); }
+
+    template<class K>
+    Iterator        FindAlt(const K& key)
+    {
+        SPInt index = findIndexCore(key, hashOf(key));
+        return (index >= 0) ? Iterator(this, index) : End();
+    }
+    template<class K>
+    ConstIterator   FindAlt(const K& key) const { return const_cast<SelfType*>(this)->FindAlt(key); }
+
+private:
+
+    // Probe distance is stored biased by one so that 0 marks an empty slot.
+    struct Entry
+    {
+        UPInt   HashValue;
+        UPInt   Distance;
+        union
+        {
+            UByte   NodeData[sizeof(Node)];
+            UInt64  AlignInt;
+            double  AlignDouble;
+            void*   AlignPtr;
+        };
+
+        bool        IsEmpty() const     { return Distance == 0; }
+        Node*       GetNode()           { return (Node*)NodeData; }
+        const Node* GetNode() const     { return (const Node*)NodeData; }
+    };
+
+    struct TableType
+    {
+        UPInt EntryCount;
+        UPInt SizeMask;
+        // Entry array follows this structure in memory.
+    };
+
+    Entry&       E(UPInt index)
+    {
+        OVR_ASSERT(index <= pTable->SizeMask);
+        return ((Entry*)(pTable + 1))[index];
+    }
+    const Entry& E(UPInt index) const
+    {
+        OVR_ASSERT(index <= pTable->SizeMask);
+        return ((Entry*)(pTable + 1))[index];
+    }
+
+    // Linear probing clusters badly on weak low bits (e.g. SDBM on small
+    // integers), so the user hash is mixed before masking.
+    template<class K>
+    static UPInt hashOf(const K& key)
+    {
+        UPInt h = HashF()(key);
+        h ^= h >> 16;
+        h *= 0x45D9F3B;
+        h ^= h >> 16;
+        return h;
+    }
+
+    template<class K>
+    SPInt   findIndexCore(const K& key, UPInt hashValue) const
+    {
+        if (!pTable)
+            return -1;
+
+        UPInt mask     = pTable->SizeMask;
+        UPInt index    = hashValue & mask;
+        UPInt distance = 1;
+
+        for (;;)
+        {
+            const Entry& e = E(index);
+            // An empty slot or an entry closer to its home ends the probe.
+            if (e.Distance < distance)
+                return -1;
+            if (e.HashValue == hashValue && e.GetNode()->First == key)
+                return (SPInt)index;
+            index = (index + 1) & mask;
+            distance++;
+        }
+    }
+
+    void    add(const C& key, const U& value, UPInt hashValue)
+    {
+        // Keep load factor at or below 1/2; linear probe lengths, and with
+        // them branch mispredictions, grow quickly past that.
+        if (!pTable)
+            setRawCapacity(HashMinSize);
+        else if ((pTable->EntryCount + 1) * 2 > (pTable->SizeMask + 1))
+            setRawCapacity((pTable->SizeMask + 1) * 2);
+
+        Node  node(key, value);
+        UPInt mask     = pTable->SizeMask;
+        UPInt index    = hashValue & mask;
+        UPInt distance = 1;
+
+        for (;;)
+        {
+            Entry& e = E(index);
+            if (e.IsEmpty())
+            {
+                e.HashValue = hashValue;
+                e.Distance  = distance;
+                Construct<Node>(e.NodeData, node);
+                pTable->EntryCount++;
+                return;
+            }
+            // Robin Hood: take the slot from an entry closer to its home.
+            if (e.Distance < distance)
+            {
+                Alg::Swap(*e.GetNode(), node);
+                Alg::Swap(e.HashValue, hashValue);
+                Alg::Swap(e.Distance, distance);
+            }
+            index = (index + 1) & mask;
+            distance++;
+        }
+    }
+
+    void    removeAt(UPInt index)
+    {
+        UPInt  mask = pTable->SizeMask;
+        Entry* e    = &E(index);
+        Destruct<Node>(e->GetNode());
+
+        // Backward-shift the following displaced entries into the hole.
+        for (;;)
+        {
+            UPInt  nextIndex = (index + 1) & mask;
+            Entry* next      = &E(nextIndex);
+            if (next->Distance <= 1)
+                break;
+            e->HashValue = next->HashValue;
+            e->Distance  = next->Distance - 1;
+            Construct<Node>(e->NodeData, *next->GetNode());
+            Destruct<Node>(next->GetNode());
+            e     = next;
+            index = nextIndex;
+        }
+
+        e->Distance = 0;
+        pTable->EntryCount--;
+    }
+
+    void    setRawCapacity(UPInt newSize)
+    {
+        if (newSize == 0)
+        {
+            Clear();
+            return;
+        }
+
+        if (newSize < HashMinSize)
+            newSize = HashMinSize;
+        else
+        {
+            // Force newSize to be a power of two.
+            int bits = Alg::UpperBit(newSize - 1) + 1;
+            newSize  = UPInt(1) << bits;
+        }
+
+        TableType* newTable = (TableType*)
+            Allocator::Alloc(sizeof(TableType) + sizeof(Entry) * newSize);
+        OVR_ASSERT(newTable);
+
+        newTable->EntryCount = 0;
+        newTable->SizeMask   = newSize - 1;
+        Entry* entries = (Entry*)(newTable + 1);
+        for (UPInt i = 0; i < newSize; i++)
+            entries[i].Distance = 0;
+
+        TableType* oldTable = pTable;
+        pTable = newTable;
+
+        if (oldTable)
+        {
+            Entry* oldEntries = (Entry*)(oldTable + 1);
+            for (UPInt i = 0, n = oldTable->SizeMask; i <= n; i++)
+            {
+                Entry& e = oldEntries[i];
+                if (!e.IsEmpty())
+                {
+                    Node* node = e.GetNode();
+                    add(node->First, node->Second, e.HashValue);
+                    Destruct<Node>(node);
+                }
+            }
+            Allocator::Free(oldTable);
+        }
+    }
+
+    void    assign(const SelfType& src)
+    {
+        if (&src == this)
+            return;
+        Clear();
+        if (src.IsEmpty())
+            return;
+        SetCapacity(src.GetSize());
+        for (ConstIterator it = src.Begin(); it != src.End(); ++it)
+            add(it->First, it->Second, hashOf(it->First));
+    }
+
+    TableType*  pTable;
+};
+
+
+#ifdef OVR_HASHFLAT_BENCHMARK
+// Times insertion, lookup and iteration of HashFlat against Hash for integer
+// and String keys and logs the results through LogText.
+void RunHashFlatBenchmark(int count = 10000, int lookupPasses = 50);
+#endif
+
+
+} // OVR
+
+
+#ifdef OVR_DEFINE_NEW
+#define new OVR_DEFINE_NEW
+#endif
+
+#endif
@@ -226,6 +226,79 @@ void StartLocklessTest()
 }
 
 
+//-------------------------------------------------------------------------------------
+// ***** LocklessRingBuffer Test
+
+namespace LocklessRingBufferTest {
+
+// Producer pushes a dense sequence of TestData blocks; consumer verifies that
+// each block is internally consistent and that none were lost or reordered.
+
+LocklessRingBuffer<LocklessTest::TestData, 256> TestBuffer;
+
+class Consumer : public Thread
+{
+    virtual int Run()
+    {
+        LogText("LocklessRingBufferTest::Consumer::Run started.\n");
+
+        LocklessTest::TestData d;
+        int expected = 0;
+
+        while (expected < LocklessTest::TestIterations)
+        {
+            if (!TestBuffer.Pop(&d))
+                continue;
+
+            int value = d.ReadAndCheckConsistency(expected - 1);
+            if (value != expected)
+            {
+                LogText("LocklessRingBufferTest Fail - got %d, expected %d\n", value, expected);
+                expected = value;
+            }
+            expected++;
+        }
+
+        LogText("LocklessRingBufferTest::Consumer::Run exiting.\n");
+        return 0;
+    }
+};
+
+class Producer : public Thread
+{
+    virtual int Run()
+    {
+        LogText("LocklessRingBufferTest::Producer::Run started.\n");
+
+        UInt32 fullCount = 0;
+        for (int testVal = 0; testVal < LocklessTest::TestIterations; testVal++)
+        {
+            LocklessTest::TestData d;
+            d.Set(testVal);
+
+            while (!TestBuffer.Push(d))
+                fullCount++;
+        }
+
+        LogText("LocklessRingBufferTest::Producer::Run exiting, buffer was full %u times.\n",
+                fullCount);
+        return 0;
+    }
+};
+
+} // namespace LocklessRingBufferTest
+
+
+void StartLocklessRingBufferTest()
+{
+    Ptr<LocklessRingBufferTest::Producer> producerThread = *new LocklessRingBufferTest::Producer;
+    Ptr<LocklessRingBufferTest::Consumer> consumerThread = *new LocklessRingBufferTest::Consumer;
+
+    producerThread->Start();
+    consumerThread->Start();
+}
+
+
 } // namespace OVR
 
 #endif // OVR_LOCKLESS_TEST
@@ -29,6 +29,7 @@ limitations under the License.
 #define OVR_Lockless_h
 
 #include "OVR_Atomic.h"
+#include "OVR_Allocator.h"
 
 // Define this to compile-in Lockless test logic
 //#define OVR_LOCKLESS_TEST
@@ -59,11 +60,13 @@ public:
 
 		for(;;)
 		{
-			// We are adding 0, only using these as atomic memory barriers, so it
-			// is ok to cast off the const, allowing GetState() to remain const.
-            end   = UpdateEnd.ExchangeAdd_Sync(0);
+			// Only plain loads and fences are needed here; the acquire fences keep
+			// the slot copy from being satisfied after the UpdateBegin load that
+			// validates it.
+            end   = UpdateEnd.Load_Acquire();
             state = Slots[ end & 1 ];
-            begin = UpdateBegin.ExchangeAdd_Sync(0);
+            AtomicFence_Acquire();
+            begin = UpdateBegin.Load_Acquire();
 			if ( begin == end ) {
 				break;
 			}
@@ -71,7 +74,8 @@ public:
 			// The producer is potentially blocked while only having partially
 			// written the update, so copy out the other slot.
             state = Slots[ (begin & 1) ^ 1 ];
-            final = UpdateBegin.ExchangeAdd_NoSync(0);
+            AtomicFence_Acquire();
+            final = UpdateBegin.Load_Relaxed();
 			if ( final == begin ) {
 				break;
 			}
@@ -84,20 +88,297 @@ public:
 
 	void	SetState( T state )
 	{
-        const int slot = UpdateBegin.ExchangeAdd_Sync(1) & 1;
-        // Write to (slot ^ 1) because ExchangeAdd returns 'previous' value before add.
-        Slots[slot ^ 1] = state;
-        UpdateEnd.ExchangeAdd_Sync(1);
+        // There is a single producer, so the counters can be advanced with
+        // plain stores instead of read-modify-write operations.
+        const int begin = UpdateBegin.Load_Relaxed();
+        UpdateBegin.Store_Release(begin + 1);
+        // Keep the slot writes from becoming visible before the new UpdateBegin.
+        AtomicFence_Release();
+        // Write to (slot ^ 1) because begin is the value before the increment.
+        Slots[(begin & 1) ^ 1] = state;
+        UpdateEnd.Store_Release(begin + 1);
 	}
 
-    mutable AtomicInt<int> UpdateBegin;
-    mutable AtomicInt<int> UpdateEnd;
+    AtomicInt<int> UpdateBegin;
+    AtomicInt<int> UpdateEnd;
     T		               Slots[2];
 };
 
 
+// ***** LocklessSlotUpdater
+
+// Seqlock-style variant of LocklessUpdater for hot single-producer state that is
+// read every frame (SensorFusion and timing state). The producer cycles through
+// SlotCount slots, so a reader only has to retry if the producer laps it
+// SlotCount - 1 times during one copy; normally every read copies T exactly once.
+//
+// Each slot carries the sequence number of the update it holds (0 while being
+// written). Slots and the Latest counter are each followed by a cache line of
+// padding, so the producer writing one slot doesn't invalidate lines that readers
+// are copying from another.
+//
+// Single producer, multiple consumer safe.
+
+template<class T, unsigned SlotCount = 4>
+class LocklessSlotUpdater
+{
+    enum { BusyVersion = 0 };
+
+    struct Slot
+    {
+        AtomicInt<UInt32>   Version;
+        T                   Data;
+        UByte               Pad[OVR_CACHE_LINE_SIZE];
+    };
+
+public:
+    LocklessSlotUpdater()
+    {
+        OVR_COMPILER_ASSERT(SlotCount >= 2);
+        for (unsigned i = 0; i < SlotCount; i++)
+            Slots[i].Version = BusyVersion;
+        // Start with a default-constructed state published as update 1.
+        Slots[1 % SlotCount].Version = 1;
+        Latest = 1;
+    }
+
+    // Returns the most recent state; retries until a consistent copy is made.
+    T       GetState() const
+    {
+        T state;
+        while (!TryGetState(&state, 0))
+        { }
+        return state;
+    }
+
+    // Copies the most recent state into *pstate, making at most maxRetries
+    // further attempts if the producer overwrites the slot during the copy.
+    // Returns false, with *pstate unspecified, if no consistent copy was made.
+    bool    TryGetState(T* pstate, int maxRetries = 2) const
+    {
+        for (int attempt = 0; attempt <= maxRetries; attempt++)
+        {
+            const UInt32 version = Latest.Load_Acquire();
+            const Slot&  slot    = Slots[version % SlotCount];
+
+            if (slot.Version.Load_Acquire() != version)
+                continue;
+            *pstate = slot.Data;
+            // Keep the copy from being satisfied after the validating load.
+            AtomicFence_Acquire();
+            if (slot.Version.Load_Relaxed() == version)
+                return true;
+        }
+        return false;
+    }
+
+    // Producer only.
+    void    SetState(const T& state)
+    {
+        UInt32 version = Latest.Load_Relaxed() + 1;
+        if (version == BusyVersion)
+            version++;
+        Slot& slot = Slots[version % SlotCount];
+
+        slot.Version.Store_Relaxed(BusyVersion);
+        // Keep the data writes from becoming visible before the busy marker.
+        AtomicFence_Release();
+        slot.Data = state;
+        slot.Version.Store_Release(version);
+        Latest.Store_Release(version);
+    }
+
+private:
+    AtomicInt<UInt32>   Latest;
+    UByte               PadLatest[OVR_CACHE_LINE_SIZE];
+    Slot                Slots[SlotCount];
+};
+
+
+// ***** LocklessRingBuffer
+
+// Fixed-capacity FIFO for exactly one producer thread and one consumer thread,
+// used where every item must be delivered (device sample streams). Push and Pop
+// never block or allocate; Push fails when the buffer is full.
+//
+// Head is written only by the producer and Tail only by the consumer; each is
+// followed by a cache line of padding so the two threads don't false-share. Indices run freely
+// and are masked on access, so Capacity must be a power of two.
+
+template<class T, unsigned Capacity>
+class LocklessRingBuffer
+{
+    enum
+    {
+        IndexMask     = Capacity - 1
+    };
+
+    union Slot
+    {
+        UByte   Data[sizeof(T)];
+        UInt64  AlignInt;
+        double  AlignDouble;
+        void*   AlignPtr;
+    };
+
+public:
+    LocklessRingBuffer()
+    {
+        OVR_COMPILER_ASSERT(Capacity > 1 && (Capacity & (Capacity - 1)) == 0);
+        Head = 0;
+        Tail = 0;
+    }
+    ~LocklessRingBuffer()
+    {
+        UInt32 head = Head;
+        for (UInt32 tail = Tail; tail != head; tail++)
+            Destruct<T>(slotAt(tail));
+    }
+
+    // Producer only. Returns false without modifying the buffer if it is full.
+    bool    Push(const T& item)
+    {
+        const UInt32 head = Head.Load_Relaxed();
+        if (head - Tail.Load_Acquire() >= (UInt32)Capacity)
+            return false;
+        ConstructAlt<T,T>(slotAt(head), item);
+        Head.Store_Release(head + 1);
+        return true;
+    }
+
+    // Consumer only. Copies the oldest item to *pitem and removes it;
+    // returns false if the buffer is empty.
+    bool    Pop(T* pitem)
+    {
+        const UInt32 tail = Tail.Load_Relaxed();
+        if (tail == Head.Load_Acquire())
+            return false;
+        T* p = slotAt(tail);
+        *pitem = *p;
+        Destruct<T>(p);
+        Tail.Store_Release(tail + 1);
+        return true;
+    }
+
+    // Only a snapshot while the other thread is active.
+    UInt32  GetCount() const    { return Head.Load_Acquire() - Tail.Load_Acquire(); }
+    bool    IsEmpty() const     { return GetCount() == 0; }
+    UInt32  GetCapacity() const { return Capacity; }
+
+private:
+    T*      slotAt(UInt32 index) { return (T*)Slots[index & IndexMask].Data; }
+
+    AtomicInt<UInt32>   Head;
+    UByte               PadHead[OVR_CACHE_LINE_SIZE];
+    AtomicInt<UInt32>   Tail;
+    UByte               PadTail[OVR_CACHE_LINE_SIZE];
+    Slot                Slots[Capacity];
+
+    LocklessRingBuffer(const LocklessRingBuffer&);
+    void operator = (const LocklessRingBuffer&);
+};
+
+
+// ***** LocklessHistory
+
+// Keeps the last Capacity - 1 items pushed by a single producer, which any number
+// of readers can read by sequence number while it is pushing (recent sensor
+// states). Reading never blocks the producer; a read fails instead if the item
+// has been overwritten, or is being overwritten, during the copy.
+//
+// Items are numbered from 1 as they are pushed. Each slot carries the number of
+// the item it holds (0 while being written), like the slots of LocklessSlotUpdater.
+// Number 0 is skipped when the count wraps, so the item before it can't be read.
+// Capacity must be a power of two.
+
+template<class T, unsigned Capacity>
+class LocklessHistory
+{
+    enum
+    {
+        BusyVersion = 0,
+        IndexMask   = Capacity - 1
+    };
+
+    struct Slot
+    {
+        AtomicInt<UInt32>   Version;
+        T                   Data;
+    };
+
+public:
+    LocklessHistory()
+    {
+        OVR_COMPILER_ASSERT(Capacity > 1 && (Capacity & (Capacity - 1)) == 0);
+        for (unsigned i = 0; i < Capacity; i++)
+            Slots[i].Version = BusyVersion;
+        Newest = 0;
+        First  = 1;
+    }
+
+    // Producer only.
+    void    Push(const T& item)
+    {
+        UInt32 version = Newest.Load_Relaxed() + 1;
+        if (version == BusyVersion)
+            version++;
+        Slot& slot = Slots[version & IndexMask];
+
+        slot.Version.Store_Relaxed(BusyVersion);
+        // Keep the data writes from becoming visible before the busy marker.
+        AtomicFence_Release();
+        slot.Data = item;
+        slot.Version.Store_Release(version);
+        Newest.Store_Release(version);
+    }
+
+    // Producer only. Forgets the items pushed so far.
+    void    Clear()
+    {
+        First.Store_Release(Newest.Load_Relaxed() + 1);
+    }
+
+    // Number of the most recent item, and how many items up to it may be read;
+    // a snapshot while the producer is pushing.
+    UInt32  GetNewest(UInt32* pcount) const
+    {
+        const UInt32 newest = Newest.Load_Acquire();
+        const UInt32 first  = First.Load_Acquire();
+        // The oldest slot may be the one being overwritten next.
+        UInt32 count = newest + 1 - first;
+        if (count > Capacity - 1)
+            count = Capacity - 1;
+        *pcount = count;
+        return newest;
+    }
+
+    // Copies the item with the given number into *pitem; returns false if it is
+    // no longer (or not yet) in the history.
+    bool    TryGet(UInt32 number, T* pitem) const
+    {
+        const Slot& slot = Slots[number & IndexMask];
+        if (number == BusyVersion || slot.Version.Load_Acquire() != number)
+            return false;
+        *pitem = slot.Data;
+        // Keep the copy from being satisfied after the validating load.
+        AtomicFence_Acquire();
+        return slot.Version.Load_Relaxed() == number;
+    }
+
+private:
+    AtomicInt<UInt32>   Newest;
+    AtomicInt<UInt32>   First;
+    UByte               PadCounters[OVR_CACHE_LINE_SIZE];
+    Slot                Slots[Capacity];
+
+    LocklessHistory(const LocklessHistory&);
+    void operator = (const LocklessHistory&);
+};
+
+
 #ifdef OVR_LOCKLESS_TEST
 void StartLocklessTest();
+void StartLocklessRingBufferTest();
 #endif
 
 
@@ -94,9 +94,10 @@ void Log::FormatLog(char* buffer, unsigned bufferSize, LogMessageType messageTyp
         break;
     }
 
+    // Leave room for the new line so that truncated messages still fit.
     UPInt prefixLength = OVR_strlen(buffer);
     char *buffer2      = buffer + prefixLength;
-    OVR_vsprintf(buffer2, bufferSize - prefixLength, fmt, argList);
+    OVR_vsprintf(buffer2, bufferSize - prefixLength - (addNewline ? 1 : 0), fmt, argList);
 
     if (addNewline)
         OVR_strcat(buffer, bufferSize, "\n");
@@ -161,12 +161,41 @@ public:
         return log;
     }
 
+protected:
+    // Called by System::Destroy before threads are finished and the allocator is
+    // released; logs that own threads or memory must release them here.
+    virtual void    OnSystemShutdown() { }
+
 private:
     // Logging mask described by LogMaskConstants.
     unsigned    LoggingMask;
 };
 
 
+//-----------------------------------------------------------------------------------
+// ***** Compile-time Log Level
+
+// OVR_LOG_LEVEL selects which logging macro call sites are compiled in; the
+// others expand to nothing, so neither their varargs nor LoggingMask are evaluated.
+//  OVR_LOG_LEVEL_NONE  - No macro logging.
+//  OVR_LOG_LEVEL_ERROR - OVR_LOG_ERROR only.
+//  OVR_LOG_LEVEL_TEXT  - OVR_LOG_ERROR and OVR_LOG_TEXT; the release build default.
+//  OVR_LOG_LEVEL_DEBUG - Everything, including OVR_DEBUG_LOG; the debug build default.
+// The LogText / LogError functions themselves are always available.
+#define OVR_LOG_LEVEL_NONE      0
+#define OVR_LOG_LEVEL_ERROR     1
+#define OVR_LOG_LEVEL_TEXT      2
+#define OVR_LOG_LEVEL_DEBUG     3
+
+#ifndef OVR_LOG_LEVEL
+#  ifdef OVR_BUILD_DEBUG
+#    define OVR_LOG_LEVEL       OVR_LOG_LEVEL_DEBUG
+#  else
+#    define OVR_LOG_LEVEL       OVR_LOG_LEVEL_TEXT
+#  endif
+#endif
+
+
 //-----------------------------------------------------------------------------------
 // ***** Global Logging Functions and Debug Macros
 
@@ -175,6 +204,18 @@ private:
 void LogText(const char* fmt, ...) OVR_LOG_VAARG_ATTRIBUTE(1,2);
 void LogError(const char* fmt, ...) OVR_LOG_VAARG_ATTRIBUTE(1,2);
 
+// Level-gated versions of the above; use as OVR_LOG_TEXT(("Value %d\n", 2)).
+#if OVR_LOG_LEVEL >= OVR_LOG_LEVEL_TEXT
+    #define OVR_LOG_TEXT(args)          do { OVR::LogText args; } while(0)
+#else
+    #define OVR_LOG_TEXT(args)          ((void)0)
+#endif
+#if OVR_LOG_LEVEL >= OVR_LOG_LEVEL_ERROR
+    #define OVR_LOG_ERROR(args)         do { OVR::LogError args; } while(0)
+#else
+    #define OVR_LOG_ERROR(args)         ((void)0)
+#endif
+
 #ifdef OVR_BUILD_DEBUG
 
     // Debug build only logging.
@@ -182,20 +223,27 @@ void LogError(const char* fmt, ...) OVR_LOG_VAARG_ATTRIBUTE(1,2);
     void LogDebug(const char* fmt, ...) OVR_LOG_VAARG_ATTRIBUTE(1,2);
     void LogAssert(const char* fmt, ...) OVR_LOG_VAARG_ATTRIBUTE(1,2);
 
+    #define OVR_ASSERT_LOG(c, args)   do { if (!(c)) { OVR::LogAssert args; OVR_DEBUG_BREAK; } } while(0)
+
+#else
+
+    #define OVR_ASSERT_LOG(c, args)     ((void)0)
+
+#endif
+
+#if defined(OVR_BUILD_DEBUG) && (OVR_LOG_LEVEL >= OVR_LOG_LEVEL_DEBUG)
+
     // Macro to do debug logging, printf-style.
     // An extra set of set of parenthesis must be used around arguments,
     // as in: OVR_LOG_DEBUG(("Value %d", 2)).
     #define OVR_DEBUG_LOG(args)       do { OVR::LogDebug args; } while(0)
     #define OVR_DEBUG_LOG_TEXT(args)  do { OVR::LogDebugText args; } while(0)
 
-    #define OVR_ASSERT_LOG(c, args)   do { if (!(c)) { OVR::LogAssert args; OVR_DEBUG_BREAK; } } while(0)
-
 #else
 
-    // If not in debug build, macros do nothing.
+    // If not in debug build (or below OVR_LOG_LEVEL_DEBUG), macros do nothing.
     #define OVR_DEBUG_LOG(args)         ((void)0)
     #define OVR_DEBUG_LOG_TEXT(args)    ((void)0)
-    #define OVR_ASSERT_LOG(c, args)     ((void)0)
 
 #endif
 
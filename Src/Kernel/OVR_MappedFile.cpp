@@ -0,0 +1,270 @@
+/************************************************************************************
+
+Filename    :   OVR_MappedFile.cpp
+Content     :   Read-only memory-mapped file
+Created     :   October 14, 2026
+Notes       :
+
+Copyright   :   Copyright 2014 Oculus VR, Inc. All Rights reserved.
+
+Licensed under the Oculus VR Rift SDK License Version 3.1 (the "License");
+you may not use the Oculus VR Rift SDK except in compliance with the License,
+which is provided at the time of installation or download, or which
+otherwise accompanies this software in either electronic or hard copy form.
+
+You may obtain a copy of the License at
+
+http://www.oculusvr.com/licenses/LICENSE-3.1
+
+Unless required by applicable law or agreed to in writing, the Oculus VR SDK
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+************************************************************************************/
+
+#include "OVR_MappedFile.h"
+#include "OVR_SysFile.h"
+#include "OVR_Alg.h"
+#include <string.h>
+
+#if !defined(OVR_OS_WIN32)
+#define OVR_MAPPEDFILE_MMAP
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <errno.h>
+#endif
+
+namespace OVR {
+
+
+MappedFile::MappedFile()
+  : pData(0), Length(0), Position(0), ErrorCode(0), MappedSize(0)
+{
+}
+
+MappedFile::MappedFile(const char* path)
+  : pData(0), Length(0), Position(0), ErrorCode(0), MappedSize(0)
+{
+    Open(path);
+}
+
+MappedFile::~MappedFile()
+{
+    Close();
+}
+
+
+#if defined(OVR_MAPPEDFILE_MMAP)
+
+static int MappedFile_Error()
+{
+    if (errno == ENOENT)
+        return FileConstants::Error_FileNotFound;
+    else if (errno == EACCES || errno == EPERM)
+        return FileConstants::Error_Access;
+    else
+        return FileConstants::Error_IOError;
+}
+
+bool MappedFile::Open(const char* path)
+{
+    Close();
+    FilePath  = path;
+    ErrorCode = 0;
+
+    int fd = ::open(path, O_RDONLY);
+    if (fd < 0)
+    {
+        ErrorCode = MappedFile_Error();
+        return false;
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size < 0 || st.st_size >= 0x7FFFFFFF)
+    {
+        ErrorCode = Error_IOError;
+        ::close(fd);
+        return false;
+    }
+
+    // Pipes and devices report no size; read those instead.
+    if (!S_ISREG(st.st_mode) || st.st_size == 0)
+    {
+        ::close(fd);
+        return readIntoBuffer();
+    }
+
+    // Reserve one page more than the file needs, then map the file over the
+    // start of it. What follows the data is then always zero filled, either the
+    // rest of the file's last page or the extra anonymous page.
+    UPInt pageSize = (UPInt)sysconf(_SC_PAGESIZE);
+    UPInt fileSize = (UPInt)st.st_size;
+    UPInt mapSize  = ((fileSize + pageSize - 1) / pageSize + 1) * pageSize;
+
+    void* reserved = mmap(0, mapSize, PROT_READ, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    void* mapped   = MAP_FAILED;
+    if (reserved != MAP_FAILED)
+    {
+        mapped = mmap(reserved, fileSize, PROT_READ, MAP_PRIVATE | MAP_FIXED, fd, 0);
+        if (mapped == MAP_FAILED)
+            munmap(reserved, mapSize);
+    }
+    ::close(fd);
+
+    if (mapped == MAP_FAILED)
+        return readIntoBuffer();
+
+    pData      = (const UByte*)mapped;
+    Length     = (int)fileSize;
+    MappedSize = mapSize;
+    return true;
+}
+
+bool MappedFile::Close()
+{
+    if (pData)
+    {
+        if (MappedSize)
+            munmap((void*)pData, MappedSize);
+        else
+            OVR_FREE((void*)pData);
+    }
+    pData      = 0;
+    Length     = 0;
+    Position   = 0;
+    MappedSize = 0;
+    return true;
+}
+
+#else   // !OVR_MAPPEDFILE_MMAP
+
+bool MappedFile::Open(const char* path)
+{
+    Close();
+    FilePath  = path;
+    ErrorCode = 0;
+    return readIntoBuffer();
+}
+
+bool MappedFile::Close()
+{
+    if (pData)
+        OVR_FREE((void*)pData);
+    pData    = 0;
+    Length   = 0;
+    Position = 0;
+    return true;
+}
+
+#endif  // OVR_MAPPEDFILE_MMAP
+
+
+// Fallback for files that can't be mapped; FilePath is already set.
+bool MappedFile::readIntoBuffer()
+{
+    SysFile f;
+    if (!f.Open(FilePath, Open_Read, Mode_Read))
+    {
+        ErrorCode = f.GetErrorCode() ? f.GetErrorCode() : (int)Error_IOError;
+        return false;
+    }
+
+    // Files without a known length are read in growing chunks.
+    int    capacity = Alg::Max(f.GetLength(), 0) + 1;
+    int    size     = 0;
+    UByte* buffer   = (UByte*)OVR_ALLOC(capacity);
+    while (buffer)
+    {
+        int bytes = f.Read(buffer + size, capacity - 1 - size);
+        if (bytes <= 0)
+            break;
+        size += bytes;
+        if (size == capacity - 1)
+        {
+            UByte* grown = (UByte*)OVR_REALLOC(buffer, capacity * 2);
+            if (!grown)
+            {
+                OVR_FREE(buffer);
+                buffer = 0;
+                break;
+            }
+            buffer    = grown;
+            capacity *= 2;
+        }
+    }
+    f.Close();
+
+    if (!buffer)
+    {
+        ErrorCode = Error_IOError;
+        return false;
+    }
+
+    buffer[size] = 0;
+    pData        = buffer;
+    Length       = size;
+    MappedSize   = 0;
+    return true;
+}
+
+
+int MappedFile::Write(const UByte *pbuffer, int numBytes)
+{
+    OVR_UNUSED2(pbuffer, numBytes);
+    ErrorCode = Error_Access;
+    return -1;
+}
+
+int MappedFile::Read(UByte *pbuffer, int numBytes)
+{
+    numBytes = Alg::Min(numBytes, Length - Position);
+    if (numBytes <= 0)
+        return 0;
+    memcpy(pbuffer, pData + Position, numBytes);
+    Position += numBytes;
+    return numBytes;
+}
+
+int MappedFile::SkipBytes(int numBytes)
+{
+    numBytes = Alg::Min(numBytes, Length - Position);
+    if (numBytes <= 0)
+        return 0;
+    Position += numBytes;
+    return numBytes;
+}
+
+int MappedFile::Seek(int offset, int origin)
+{
+    return (int)LSeek(offset, origin);
+}
+
+SInt64 MappedFile::LSeek(SInt64 offset, int origin)
+{
+    SInt64 position = Position;
+    switch (origin)
+    {
+    case Seek_Set : position  = offset;          break;
+    case Seek_Cur : position += offset;          break;
+    case Seek_End : position  = Length + offset; break;
+    }
+    if (position < 0 || position > Length)
+        return -1;
+    Position = (int)position;
+    return Position;
+}
+
+int MappedFile::CopyFromStream(File *pstream, int byteSize)
+{
+    OVR_UNUSED2(pstream, byteSize);
+    ErrorCode = Error_Access;
+    return -1;
+}
+
+
+} // OVR
@@ -0,0 +1,102 @@
+/************************************************************************************
+
+PublicHeader:   Kernel
+Filename    :   OVR_MappedFile.h
+Content     :   Read-only memory-mapped file
+Created     :   October 14, 2026
+Notes       :
+
+Copyright   :   Copyright 2014 Oculus VR, Inc. All Rights reserved.
+
+Licensed under the Oculus VR Rift SDK License Version 3.1 (the "License");
+you may not use the Oculus VR Rift SDK except in compliance with the License,
+which is provided at the time of installation or download, or which
+otherwise accompanies this software in either electronic or hard copy form.
+
+You may obtain a copy of the License at
+
+http://www.oculusvr.com/licenses/LICENSE-3.1
+
+Unless required by applicable law or agreed to in writing, the Oculus VR SDK
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+************************************************************************************/
+
+#ifndef OVR_MappedFile_h
+#define OVR_MappedFile_h
+
+#include "OVR_File.h"
+
+namespace OVR {
+
+
+//-----------------------------------------------------------------------------------
+// ***** MappedFile
+
+// MappedFile maps a whole file read-only into memory, so that its contents can be
+// used in place through GetData() instead of being copied with Read. The data is
+// always followed by a zero byte, so text files can be given directly to parsers
+// that expect null-terminated input, such as JSON::Parse.
+//
+// On POSIX systems the file is mmap-ed. Elsewhere, and for files that can't be
+// mapped, the contents are read into an allocated buffer instead; GetData()
+// behaves the same either way.
+
+class MappedFile : public File
+{
+public:
+    MappedFile();
+    // The path should be encoded as UTF-8 to support international file names.
+    MappedFile(const char* path);
+    ~MappedFile();
+
+    // Maps the file, closing any previously opened one. Returns false on failure,
+    // with the reason in GetErrorCode().
+    bool                Open(const char* path);
+
+    // File contents, followed by a zero byte; null if not open.
+    const UByte*        GetData() const     { return pData; }
+
+    // ** File implementation
+    virtual const char* GetFilePath()       { return FilePath.ToCStr(); }
+
+    virtual bool        IsValid()           { return pData != 0; }
+    virtual bool        IsWritable()        { return false; }
+
+    virtual int         Tell()              { return Position; }
+    virtual SInt64      LTell()             { return Position; }
+    virtual int         GetLength()         { return Length; }
+    virtual SInt64      LGetLength()        { return Length; }
+
+    virtual int         GetErrorCode()      { return ErrorCode; }
+
+    virtual int         Write(const UByte *pbuffer, int numBytes);
+    virtual int         Read(UByte *pbuffer, int numBytes);
+    virtual int         SkipBytes(int numBytes);
+    virtual int         BytesAvailable()    { return Length - Position; }
+    virtual bool        Flush()             { return true; }
+    virtual int         Seek(int offset, int origin = Seek_Set);
+    virtual SInt64      LSeek(SInt64 offset, int origin = Seek_Set);
+
+    virtual int         CopyFromStream(File *pstream, int byteSize);
+    virtual bool        Close();
+
+private:
+    bool                readIntoBuffer();
+
+    String              FilePath;
+    const UByte*        pData;
+    int                 Length;
+    int                 Position;
+    int                 ErrorCode;
+    // Size of the mapping, or 0 if pData was allocated.
+    UPInt               MappedSize;
+};
+
+
+} // OVR
+
+#endif
@@ -26,6 +26,7 @@ limitations under the License.
 
 #include "OVR_Math.h"
 #include "OVR_Log.h"
+#include "OVR_Timer.h"
 
 #include <float.h>
 
@@ -88,4 +89,150 @@ const Matrix4<double> Matrix4<double>::IdentityValue = Matrix4<double>(1.0, 0.0,
 
 
 
+#ifdef OVR_MATH_SIMD_BENCHMARK
+
+//-------------------------------------------------------------------------------------
+// ***** MathSIMD Benchmark
+
+namespace MathBenchmark {
+
+enum { SampleCount = 64 };
+
+template<class T>
+struct Samples
+{
+    T  Quats[SampleCount][4];
+    T  Vecs[SampleCount][3];
+    T  Mats[SampleCount][4][4];
+
+    Samples()
+    {
+        // Deterministic pseudo-random inputs so runs are comparable.
+        UInt32 seed = 0x12345678;
+        for (int i = 0; i < SampleCount; i++)
+        {
+            Quat<T> q(Vector3<T>(next(seed), next(seed), next(seed) + T(0.1)), next(seed) * T(3));
+            Quats[i][0] = q.x; Quats[i][1] = q.y; Quats[i][2] = q.z; Quats[i][3] = q.w;
+            Vecs[i][0]  = next(seed); Vecs[i][1] = next(seed); Vecs[i][2] = next(seed);
+            for (int r = 0; r < 4; r++)
+                for (int c = 0; c < 4; c++)
+                    Mats[i][r][c] = next(seed);
+        }
+    }
+
+    static T next(UInt32& seed)
+    {
+        seed = seed * 1664525u + 1013904223u;
+        return T(seed >> 8) / T(1 << 24) * T(2) - T(1);
+    }
+};
+
+template<class T>
+static T maxDiff(const T* a, const T* b, int count)
+{
+    T m = T(0);
+    for (int i = 0; i < count; i++)
+    {
+        T d = fabs(a[i] - b[i]);
+        if (d > m)
+            m = d;
+    }
+    return m;
+}
+
+template<class T, class K>
+static double timeQuatMul(const Samples<T>& s, int iterations, T* out)
+{
+    volatile T sink;
+    double     start = Timer::GetSeconds();
+    for (int i = 0; i < iterations; i++)
+    {
+        K::QuatMul(out, s.Quats[i % SampleCount], s.Quats[(i + 1) % SampleCount]);
+        sink = out[0]; // Keep every iteration observable.
+    }
+    OVR_UNUSED(sink);
+    return Timer::GetSeconds() - start;
+}
+
+template<class T, class K>
+static double timeQuatRotate(const Samples<T>& s, int iterations, T* out)
+{
+    volatile T sink;
+    double     start = Timer::GetSeconds();
+    for (int i = 0; i < iterations; i++)
+    {
+        K::QuatRotate(out, s.Quats[i % SampleCount], s.Vecs[(i + 3) % SampleCount]);
+        sink = out[1];
+    }
+    OVR_UNUSED(sink);
+    return Timer::GetSeconds() - start;
+}
+
+template<class T, class K>
+static double timeMatrixMul(const Samples<T>& s, int iterations, T (*out)[4])
+{
+    volatile T sink;
+    double     start = Timer::GetSeconds();
+    for (int i = 0; i < iterations; i++)
+    {
+        K::Matrix4Mul(out, s.Mats[i % SampleCount], s.Mats[(i + 5) % SampleCount]);
+        sink = out[2][2];
+    }
+    OVR_UNUSED(sink);
+    return Timer::GetSeconds() - start;
+}
+
+template<class T>
+static void runForType(const char* typeName, int iterations)
+{
+    typedef MathScalar<T> Scalar;
+    typedef MathSIMD<T>   Simd;
+
+    Samples<T> s;
+    T          qa[4], qb[4], va[3], vb[3], ma[4][4], mb[4][4];
+    T          errQ = 0, errV = 0, errM = 0;
+
+    // Accuracy over every sample pair.
+    for (int i = 0; i < SampleCount; i++)
+    {
+        int j = (i + 1) % SampleCount;
+        Scalar::QuatMul(qa, s.Quats[i], s.Quats[j]);
+        Simd::QuatMul(qb, s.Quats[i], s.Quats[j]);
+        errQ = Alg::Max(errQ, maxDiff(qa, qb, 4));
+        Scalar::QuatRotate(va, s.Quats[i], s.Vecs[j]);
+        Simd::QuatRotate(vb, s.Quats[i], s.Vecs[j]);
+        errV = Alg::Max(errV, maxDiff(va, vb, 3));
+        Scalar::Matrix4Mul(ma, s.Mats[i], s.Mats[j]);
+        Simd::Matrix4Mul(mb, s.Mats[i], s.Mats[j]);
+        errM = Alg::Max(errM, maxDiff(&ma[0][0], &mb[0][0], 16));
+    }
+
+    const double nsPerOp = 1.0e9 / iterations;
+    double tqs = timeQuatMul<T, Scalar>(s, iterations, qa);
+    double tqv = timeQuatMul<T, Simd>(s, iterations, qb);
+    double trs = timeQuatRotate<T, Scalar>(s, iterations, va);
+    double trv = timeQuatRotate<T, Simd>(s, iterations, vb);
+    double tms = timeMatrixMul<T, Scalar>(s, iterations, ma);
+    double tmv = timeMatrixMul<T, Simd>(s, iterations, mb);
+
+    LogText("MathSIMD %-6s (%s): QuatMul %6.2f/%6.2f ns  QuatRotate %6.2f/%6.2f ns  "
+            "Matrix4Mul %6.2f/%6.2f ns (scalar/simd)\n",
+            typeName, Simd::IsSIMD ? "vector" : "scalar fallback",
+            tqs * nsPerOp, tqv * nsPerOp, trs * nsPerOp, trv * nsPerOp, tms * nsPerOp, tmv * nsPerOp);
+    LogText("MathSIMD %-6s max abs error: QuatMul %g  QuatRotate %g  Matrix4Mul %g\n",
+            typeName, (double)errQ, (double)errV, (double)errM);
+}
+
+} // namespace MathBenchmark
+
+
+void RunMathSIMDBenchmark(int iterations)
+{
+    MathBenchmark::runForType<float>("float", iterations);
+    MathBenchmark::runForType<double>("double", iterations);
+}
+
+#endif // OVR_MATH_SIMD_BENCHMARK
+
+
 } // Namespace OVR
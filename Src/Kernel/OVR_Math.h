@@ -37,6 +37,7 @@ limitations under the License.
 #include "OVR_RefCount.h"
 #include "OVR_Std.h"
 #include "OVR_Alg.h"
+#include "OVR_MathSIMD.h"
 
 
 namespace OVR {
@@ -924,10 +925,12 @@ public:
 
     // Quaternion multiplication. Combines quaternion rotations, performing the one on the 
     // right hand side first.
-    Quat  operator* (const Quat& b) const   { return Quat(w * b.x + x * b.w + y * b.z - z * b.y,
-                                                          w * b.y - x * b.z + y * b.w + z * b.x,
-                                                          w * b.z + x * b.y - y * b.x + z * b.w,
-                                                          w * b.w - x * b.x - y * b.y - z * b.z); }
+    Quat  operator* (const Quat& b) const
+    {
+        Quat result;
+        MathSIMD<T>::QuatMul(&result.x, &x, &b.x);
+        return result;
+    }
 
     // 
     // this^p normalized; same as rotating by this p times.
@@ -950,7 +953,9 @@ public:
     // assuming negative direction of the axis). Standard formula: q(t) * V * q(t)^-1. 
     Vector3<T> Rotate(const Vector3<T>& v) const
     {
-        return ((*this * Quat<T>(v.x, v.y, v.z, T(0))) * Inverted()).Imag();
+        Vector3<T> result;
+        MathSIMD<T>::QuatRotate(&result.x, &x, &v.x);
+        return result;
     }
     
     // Inversed quaternion rotates in the opposite direction.
@@ -1348,14 +1353,7 @@ public:
     static Matrix4& Multiply(Matrix4* d, const Matrix4& a, const Matrix4& b)
     {
         OVR_ASSERT((d != &a) && (d != &b));
-        int i = 0;
-        do {
-            d->M[i][0] = a.M[i][0] * b.M[0][0] + a.M[i][1] * b.M[1][0] + a.M[i][2] * b.M[2][0] + a.M[i][3] * b.M[3][0];
-            d->M[i][1] = a.M[i][0] * b.M[0][1] + a.M[i][1] * b.M[1][1] + a.M[i][2] * b.M[2][1] + a.M[i][3] * b.M[3][1];
-            d->M[i][2] = a.M[i][0] * b.M[0][2] + a.M[i][1] * b.M[1][2] + a.M[i][2] * b.M[2][2] + a.M[i][3] * b.M[3][2];
-            d->M[i][3] = a.M[i][0] * b.M[0][3] + a.M[i][1] * b.M[1][3] + a.M[i][2] * b.M[2][3] + a.M[i][3] * b.M[3][3];
-        } while((++i) < 4);
-
+        MathSIMD<T>::Matrix4Mul(d->M, a.M, b.M);
         return *d;
     }
 
@@ -1884,6 +1882,14 @@ public:
 		M[1][0] = m21; M[1][1] = m22; M[1][2] = m23;
 		M[2][0] = m31; M[2][1] = m32; M[2][2] = m33;
 	}
+
+	// Declared alongside operator=, which is user-provided.
+	Matrix3(const Matrix3& b)
+	{
+		for (int i = 0; i < 3; i++)
+			for (int j = 0; j < 3; j++)
+				M[i][j] = b.M[i][j];
+	}
 	
 	/*
 	explicit Matrix3(const Quat<T>& q)
@@ -2521,6 +2527,16 @@ public:
 
 typedef Plane<float> Planef;
 
+
+// Define this to compile-in the MathScalar vs. MathSIMD micro-benchmark.
+//#define OVR_MATH_SIMD_BENCHMARK
+
+#ifdef OVR_MATH_SIMD_BENCHMARK
+// Times Quat multiply/rotate and Matrix4 multiply through both kernel sets for float
+// and double, logging per-operation cost and the largest deviation from scalar.
+void RunMathSIMDBenchmark(int iterations = 1000000);
+#endif
+
 } // Namespace OVR
 
 #endif
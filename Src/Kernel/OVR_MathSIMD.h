@@ -0,0 +1,381 @@
+/************************************************************************************
+
+PublicHeader:   OVR.h
+Filename    :   OVR_MathSIMD.h
+Content     :   Scalar and SIMD (SSE/NEON) kernels backing Quat, Matrix4 and
+                filter math
+Created     :   October 14, 2026
+Notes       :   Included by OVR_Math.h; not intended to be used directly.
+
+Copyright   :   Copyright 2014 Oculus VR, Inc. All Rights reserved.
+
+Licensed under the Oculus VR Rift SDK License Version 3.1 (the "License");
+you may not use the Oculus VR Rift SDK except in compliance with the License,
+which is provided at the time of installation or download, or which
+otherwise accompanies this software in either electronic or hard copy form.
+
+You may obtain a copy of the License at
+
+http://www.oculusvr.com/licenses/LICENSE-3.1
+
+Unless required by applicable law or agreed to in writing, the Oculus VR SDK
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+*************************************************************************************/
+
+#ifndef OVR_MathSIMD_h
+#define OVR_MathSIMD_h
+
+#include "OVR_Types.h"
+
+// SIMD math is opt-in: define OVR_MATH_SIMD before including OVR.h (or in the
+// project settings) to route Quat<float/double>, Matrix4<float/double> and the
+// Vector3 sensor filter sums through the vector kernels below. Without it,
+// MathSIMD<T> is plain MathScalar<T>.
+//
+//  OVR_MATH_SIMD_SSE  - float via SSE, double via SSE2 (x86 / x86_64).
+//  OVR_MATH_SIMD_NEON - float via NEON; double stays scalar.
+//
+// The vector kernels evaluate the same products as the scalar code but sum them in
+// a different order, so results are not bit-identical. They agree with MathScalar
+// within 4 ULP of the largest term (about 5e-7 relative for float, 1e-15 for double).
+
+#if defined(OVR_MATH_SIMD)
+#  if defined(OVR_CPU_SSE) && (defined(__SSE2__) || defined(OVR_CPU_X86_64) || defined(OVR_OS_WIN32))
+#    define OVR_MATH_SIMD_SSE
+#    include <emmintrin.h>
+#  elif defined(OVR_CPU_ARM_NEON)
+#    define OVR_MATH_SIMD_NEON
+#    include <arm_neon.h>
+#  endif
+#endif
+
+
+namespace OVR {
+
+//-------------------------------------------------------------------------------------
+// ***** MathScalar
+
+// Reference kernels shared by all element types. Quaternions are laid out as
+// {x, y, z, w}; matrices are 4x4 row-major, matching Quat<T> and Matrix4<T>.
+// Vector3 arrays are packed {x, y, z} triples.
+
+template<class T>
+struct MathScalar
+{
+    enum { IsSIMD = 0 };
+
+    // r = a * b (Hamilton product, right-hand side applied first).
+    static void QuatMul(T* r, const T* a, const T* b)
+    {
+        const T x = a[3] * b[0] + a[0] * b[3] + a[1] * b[2] - a[2] * b[1];
+        const T y = a[3] * b[1] - a[0] * b[2] + a[1] * b[3] + a[2] * b[0];
+        const T z = a[3] * b[2] + a[0] * b[1] - a[1] * b[0] + a[2] * b[3];
+        const T w = a[3] * b[3] - a[0] * b[0] - a[1] * b[1] - a[2] * b[2];
+        r[0] = x; r[1] = y; r[2] = z; r[3] = w;
+    }
+
+    // r = q * (v, 0) * q^-1; r may alias v.
+    static void QuatRotate(T* r, const T* q, const T* v)
+    {
+        T qv[4], qc[4], tmp[4];
+        qv[0] = v[0]; qv[1] = v[1]; qv[2] = v[2]; qv[3] = T(0);
+        qc[0] = -q[0]; qc[1] = -q[1]; qc[2] = -q[2]; qc[3] = q[3];
+        QuatMul(tmp, q, qv);
+        QuatMul(tmp, tmp, qc);
+        r[0] = tmp[0]; r[1] = tmp[1]; r[2] = tmp[2];
+    }
+
+    // d = a * b; d must not alias a or b.
+    static void Matrix4Mul(T (*d)[4], const T (*a)[4], const T (*b)[4])
+    {
+        int i = 0;
+        do {
+            d[i][0] = a[i][0] * b[0][0] + a[i][1] * b[1][0] + a[i][2] * b[2][0] + a[i][3] * b[3][0];
+            d[i][1] = a[i][0] * b[0][1] + a[i][1] * b[1][1] + a[i][2] * b[2][1] + a[i][3] * b[3][1];
+            d[i][2] = a[i][0] * b[0][2] + a[i][1] * b[1][2] + a[i][2] * b[2][2] + a[i][3] * b[3][2];
+            d[i][3] = a[i][0] * b[0][3] + a[i][1] * b[1][3] + a[i][2] * b[2][3] + a[i][3] * b[3][3];
+        } while((++i) < 4);
+    }
+
+    // r += w[0]*v[0] + w[1]*v[-1] + ... + w[n-1]*v[-(n-1)], for the Vector3 at v and
+    // the n-1 before it; w may be null for unit weights.
+    static void Vector3SumBack(T* r, const T* v, const float* w, int n)
+    {
+        T x = T(0), y = T(0), z = T(0);
+        for (int i = 0; i < n; i++, v -= 3)
+        {
+            const T s = w ? T(w[i]) : T(1);
+            x += s * v[0]; y += s * v[1]; z += s * v[2];
+        }
+        r[0] += x; r[1] += y; r[2] += z;
+    }
+};
+
+
+//-------------------------------------------------------------------------------------
+// ***** MathSIMD
+
+// MathSIMD<T> is what Quat and Matrix4 call. The primary template is the scalar
+// reference; float/double are specialized below when a vector unit is enabled.
+
+template<class T>
+struct MathSIMD : public MathScalar<T> { };
+
+
+#if defined(OVR_MATH_SIMD_SSE)
+
+// Quaternion product written as a sum of a's components times permutations of b:
+//   r = a.x*( bw,-bz, by,-bx) + a.y*( bz, bw,-bx,-by)
+//     + a.z*(-by, bx, bw,-bz) + a.w*( bx, by, bz, bw)
+
+template<>
+struct MathSIMD<float>
+{
+    enum { IsSIMD = 1 };
+
+    static OVR_FORCE_INLINE __m128 quatMul(__m128 a, __m128 b)
+    {
+        const __m128 signX = _mm_set_ps(-1.0f,  1.0f, -1.0f,  1.0f);
+        const __m128 signY = _mm_set_ps(-1.0f, -1.0f,  1.0f,  1.0f);
+        const __m128 signZ = _mm_set_ps(-1.0f,  1.0f,  1.0f, -1.0f);
+
+        __m128 r =           _mm_mul_ps(_mm_shuffle_ps(a, a, _MM_SHUFFLE(3,3,3,3)), b);
+        r = _mm_add_ps(r,    _mm_mul_ps(_mm_mul_ps(_mm_shuffle_ps(a, a, _MM_SHUFFLE(0,0,0,0)),
+                                                   _mm_shuffle_ps(b, b, _MM_SHUFFLE(0,1,2,3))), signX));
+        r = _mm_add_ps(r,    _mm_mul_ps(_mm_mul_ps(_mm_shuffle_ps(a, a, _MM_SHUFFLE(1,1,1,1)),
+                                                   _mm_shuffle_ps(b, b, _MM_SHUFFLE(1,0,3,2))), signY));
+        r = _mm_add_ps(r,    _mm_mul_ps(_mm_mul_ps(_mm_shuffle_ps(a, a, _MM_SHUFFLE(2,2,2,2)),
+                                                   _mm_shuffle_ps(b, b, _MM_SHUFFLE(2,3,0,1))), signZ));
+        return r;
+    }
+
+    static void QuatMul(float* r, const float* a, const float* b)
+    {
+        _mm_storeu_ps(r, quatMul(_mm_loadu_ps(a), _mm_loadu_ps(b)));
+    }
+
+    static void QuatRotate(float* r, const float* q, const float* v)
+    {
+        const __m128 conj = _mm_set_ps(1.0f, -1.0f, -1.0f, -1.0f);
+        __m128 qq  = _mm_loadu_ps(q);
+        __m128 vv  = _mm_set_ps(0.0f, v[2], v[1], v[0]);
+        float  out[4];
+        _mm_storeu_ps(out, quatMul(quatMul(qq, vv), _mm_mul_ps(qq, conj)));
+        r[0] = out[0]; r[1] = out[1]; r[2] = out[2];
+    }
+
+    static void Matrix4Mul(float (*d)[4], const float (*a)[4], const float (*b)[4])
+    {
+        const __m128 b0 = _mm_loadu_ps(b[0]);
+        const __m128 b1 = _mm_loadu_ps(b[1]);
+        const __m128 b2 = _mm_loadu_ps(b[2]);
+        const __m128 b3 = _mm_loadu_ps(b[3]);
+        for (int i = 0; i < 4; i++)
+        {
+            __m128 r = _mm_mul_ps(_mm_set1_ps(a[i][0]), b0);
+            r = _mm_add_ps(r, _mm_mul_ps(_mm_set1_ps(a[i][1]), b1));
+            r = _mm_add_ps(r, _mm_mul_ps(_mm_set1_ps(a[i][2]), b2));
+            r = _mm_add_ps(r, _mm_mul_ps(_mm_set1_ps(a[i][3]), b3));
+            _mm_storeu_ps(d[i], r);
+        }
+    }
+
+    static void Vector3SumBack(float* r, const float* v, const float* w, int n)
+    {
+        // Loads (x, y) and z separately, so as not to read past the array.
+        __m128 sum = _mm_setzero_ps();
+        for (int i = 0; i < n; i++, v -= 3)
+        {
+            __m128 xyz = _mm_movelh_ps(_mm_castpd_ps(_mm_load_sd((const double*)v)), _mm_load_ss(v + 2));
+            sum = _mm_add_ps(sum, w ? _mm_mul_ps(_mm_set1_ps(w[i]), xyz) : xyz);
+        }
+        float out[4];
+        _mm_storeu_ps(out, sum);
+        r[0] += out[0]; r[1] += out[1]; r[2] += out[2];
+    }
+};
+
+// Double precision uses pairs of SSE2 registers: lo = (x,y), hi = (z,w).
+template<>
+struct MathSIMD<double>
+{
+    enum { IsSIMD = 1 };
+
+    static OVR_FORCE_INLINE void quatMul(__m128d* rlo, __m128d* rhi,
+                                         __m128d alo, __m128d ahi, __m128d blo, __m128d bhi)
+    {
+        const __m128d pn = _mm_set_pd(-1.0,  1.0);
+        const __m128d np = _mm_set_pd( 1.0, -1.0);
+        const __m128d nn = _mm_set_pd(-1.0, -1.0);
+
+        const __m128d ax = _mm_unpacklo_pd(alo, alo);
+        const __m128d ay = _mm_unpackhi_pd(alo, alo);
+        const __m128d az = _mm_unpacklo_pd(ahi, ahi);
+        const __m128d aw = _mm_unpackhi_pd(ahi, ahi);
+        const __m128d bswlo = _mm_shuffle_pd(blo, blo, 1); // (by, bx)
+        const __m128d bswhi = _mm_shuffle_pd(bhi, bhi, 1); // (bw, bz)
+
+        __m128d lo = _mm_mul_pd(aw, blo);
+        lo = _mm_add_pd(lo, _mm_mul_pd(_mm_mul_pd(ax, bswhi), pn));
+        lo = _mm_add_pd(lo, _mm_mul_pd(ay, bhi));
+        lo = _mm_add_pd(lo, _mm_mul_pd(_mm_mul_pd(az, bswlo), np));
+
+        __m128d hi = _mm_mul_pd(aw, bhi);
+        hi = _mm_add_pd(hi, _mm_mul_pd(_mm_mul_pd(ax, bswlo), pn));
+        hi = _mm_add_pd(hi, _mm_mul_pd(_mm_mul_pd(ay, blo), nn));
+        hi = _mm_add_pd(hi, _mm_mul_pd(_mm_mul_pd(az, bswhi), pn));
+
+        *rlo = lo;
+        *rhi = hi;
+    }
+
+    static void QuatMul(double* r, const double* a, const double* b)
+    {
+        __m128d lo, hi;
+        quatMul(&lo, &hi, _mm_loadu_pd(a), _mm_loadu_pd(a + 2), _mm_loadu_pd(b), _mm_loadu_pd(b + 2));
+        _mm_storeu_pd(r, lo);
+        _mm_storeu_pd(r + 2, hi);
+    }
+
+    static void QuatRotate(double* r, const double* q, const double* v)
+    {
+        const __m128d nn = _mm_set_pd(-1.0, -1.0);
+        const __m128d np = _mm_set_pd( 1.0, -1.0);
+        __m128d qlo = _mm_loadu_pd(q);
+        __m128d qhi = _mm_loadu_pd(q + 2);
+        __m128d tlo, thi;
+        quatMul(&tlo, &thi, qlo, qhi, _mm_loadu_pd(v), _mm_set_pd(0.0, v[2]));
+        quatMul(&tlo, &thi, tlo, thi, _mm_mul_pd(qlo, nn), _mm_mul_pd(qhi, np));
+        _mm_storeu_pd(r, tlo);
+        _mm_store_sd(r + 2, thi);
+    }
+
+    static void Matrix4Mul(double (*d)[4], const double (*a)[4], const double (*b)[4])
+    {
+        const __m128d b0lo = _mm_loadu_pd(b[0]), b0hi = _mm_loadu_pd(b[0] + 2);
+        const __m128d b1lo = _mm_loadu_pd(b[1]), b1hi = _mm_loadu_pd(b[1] + 2);
+        const __m128d b2lo = _mm_loadu_pd(b[2]), b2hi = _mm_loadu_pd(b[2] + 2);
+        const __m128d b3lo = _mm_loadu_pd(b[3]), b3hi = _mm_loadu_pd(b[3] + 2);
+        for (int i = 0; i < 4; i++)
+        {
+            const __m128d s0 = _mm_set1_pd(a[i][0]);
+            const __m128d s1 = _mm_set1_pd(a[i][1]);
+            const __m128d s2 = _mm_set1_pd(a[i][2]);
+            const __m128d s3 = _mm_set1_pd(a[i][3]);
+            __m128d lo = _mm_mul_pd(s0, b0lo);
+            __m128d hi = _mm_mul_pd(s0, b0hi);
+            lo = _mm_add_pd(lo, _mm_mul_pd(s1, b1lo));
+            hi = _mm_add_pd(hi, _mm_mul_pd(s1, b1hi));
+            lo = _mm_add_pd(lo, _mm_mul_pd(s2, b2lo));
+            hi = _mm_add_pd(hi, _mm_mul_pd(s2, b2hi));
+            lo = _mm_add_pd(lo, _mm_mul_pd(s3, b3lo));
+            hi = _mm_add_pd(hi, _mm_mul_pd(s3, b3hi));
+            _mm_storeu_pd(d[i], lo);
+            _mm_storeu_pd(d[i] + 2, hi);
+        }
+    }
+
+    static void Vector3SumBack(double* r, const double* v, const float* w, int n)
+    {
+        __m128d xy = _mm_setzero_pd();
+        __m128d z  = _mm_setzero_pd();
+        for (int i = 0; i < n; i++, v -= 3)
+        {
+            if (w)
+            {
+                const __m128d s = _mm_set1_pd((double)w[i]);
+                xy = _mm_add_pd(xy, _mm_mul_pd(s, _mm_loadu_pd(v)));
+                z  = _mm_add_sd(z,  _mm_mul_sd(s, _mm_load_sd(v + 2)));
+            }
+            else
+            {
+                xy = _mm_add_pd(xy, _mm_loadu_pd(v));
+                z  = _mm_add_sd(z,  _mm_load_sd(v + 2));
+            }
+        }
+        double out[3];
+        _mm_storeu_pd(out, xy);
+        _mm_store_sd(out + 2, z);
+        r[0] += out[0]; r[1] += out[1]; r[2] += out[2];
+    }
+};
+
+#elif defined(OVR_MATH_SIMD_NEON)
+
+template<>
+struct MathSIMD<float>
+{
+    enum { IsSIMD = 1 };
+
+    static OVR_FORCE_INLINE float32x4_t quatMul(float32x4_t a, float32x4_t b)
+    {
+        static const float signX[4] = {  1.0f, -1.0f,  1.0f, -1.0f };
+        static const float signY[4] = {  1.0f,  1.0f, -1.0f, -1.0f };
+        static const float signZ[4] = { -1.0f,  1.0f,  1.0f, -1.0f };
+
+        float32x4_t brev = vrev64q_f32(b);                                          // (by,bx,bw,bz)
+        float32x4_t bx   = vcombine_f32(vget_high_f32(brev), vget_low_f32(brev));   // (bw,bz,by,bx)
+        float32x4_t by   = vextq_f32(b, b, 2);                                      // (bz,bw,bx,by)
+
+        float32x4_t r = vmulq_lane_f32(b, vget_high_f32(a), 1);
+        r = vmlaq_lane_f32(r, vmulq_f32(bx,   vld1q_f32(signX)), vget_low_f32(a),  0);
+        r = vmlaq_lane_f32(r, vmulq_f32(by,   vld1q_f32(signY)), vget_low_f32(a),  1);
+        r = vmlaq_lane_f32(r, vmulq_f32(brev, vld1q_f32(signZ)), vget_high_f32(a), 0);
+        return r;
+    }
+
+    static void QuatMul(float* r, const float* a, const float* b)
+    {
+        vst1q_f32(r, quatMul(vld1q_f32(a), vld1q_f32(b)));
+    }
+
+    static void QuatRotate(float* r, const float* q, const float* v)
+    {
+        static const float conj[4] = { -1.0f, -1.0f, -1.0f, 1.0f };
+        float       vin[4] = { v[0], v[1], v[2], 0.0f };
+        float       out[4];
+        float32x4_t qq = vld1q_f32(q);
+        vst1q_f32(out, quatMul(quatMul(qq, vld1q_f32(vin)), vmulq_f32(qq, vld1q_f32(conj))));
+        r[0] = out[0]; r[1] = out[1]; r[2] = out[2];
+    }
+
+    static void Matrix4Mul(float (*d)[4], const float (*a)[4], const float (*b)[4])
+    {
+        const float32x4_t b0 = vld1q_f32(b[0]);
+        const float32x4_t b1 = vld1q_f32(b[1]);
+        const float32x4_t b2 = vld1q_f32(b[2]);
+        const float32x4_t b3 = vld1q_f32(b[3]);
+        for (int i = 0; i < 4; i++)
+        {
+            float32x4_t r = vmulq_n_f32(b0, a[i][0]);
+            r = vmlaq_n_f32(r, b1, a[i][1]);
+            r = vmlaq_n_f32(r, b2, a[i][2]);
+            r = vmlaq_n_f32(r, b3, a[i][3]);
+            vst1q_f32(d[i], r);
+        }
+    }
+
+    static void Vector3SumBack(float* r, const float* v, const float* w, int n)
+    {
+        float32x2_t xy = vdup_n_f32(0.0f);
+        float       z  = 0.0f;
+        for (int i = 0; i < n; i++, v -= 3)
+        {
+            const float s = w ? w[i] : 1.0f;
+            xy = vmla_n_f32(xy, vld1_f32(v), s);
+            z += s * v[2];
+        }
+        r[0] += vget_lane_f32(xy, 0); r[1] += vget_lane_f32(xy, 1); r[2] += z;
+    }
+};
+
+#endif // OVR_MATH_SIMD_SSE / OVR_MATH_SIMD_NEON
+
+
+} // OVR
+
+#endif // OVR_MathSIMD_h
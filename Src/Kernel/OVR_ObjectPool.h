@@ -0,0 +1,156 @@
+/************************************************************************************
+
+PublicHeader:   OVR.h
+Filename    :   OVR_ObjectPool.h
+Content     :   Fixed-capacity lock-free object pool.
+Created     :   October 14, 2026
+Notes       :
+
+Copyright   :   Copyright 2014 Oculus VR, Inc. All Rights reserved.
+
+Licensed under the Oculus VR Rift SDK License Version 3.1 (the "License");
+you may not use the Oculus VR Rift SDK except in compliance with the License,
+which is provided at the time of installation or download, or which
+otherwise accompanies this software in either electronic or hard copy form.
+
+You may obtain a copy of the License at
+
+http://www.oculusvr.com/licenses/LICENSE-3.1
+
+Unless required by applicable law or agreed to in writing, the Oculus VR SDK
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+************************************************************************************/
+
+#ifndef OVR_ObjectPool_h
+#define OVR_ObjectPool_h
+
+#include "OVR_Allocator.h"
+#include "OVR_Atomic.h"
+
+namespace OVR {
+
+
+//-----------------------------------------------------------------------------------
+// ***** ObjectPool
+
+// ObjectPool keeps storage for Capacity objects of type T inline and hands it
+// out through a lock-free free list, so steady-state New/Delete pairs never
+// reach the heap. When all slots are in use New falls back to OVR_ALLOC; such
+// overflow allocations are counted by GetHeapAllocCount, which lets callers
+// verify that a code path runs allocation-free.
+//
+// The free list head packs a slot index in its low 16 bits and a change tag in
+// its high 16 bits; the tag guards the compare-and-set against ABA reuse.
+// New and Delete may be called from any thread.
+
+template<class T, unsigned Capacity>
+class ObjectPool
+{
+    enum
+    {
+        IndexMask  = 0xFFFF,
+        EmptyIndex = IndexMask,
+        TagUnit    = 0x10000
+    };
+
+    union Slot
+    {
+        UByte   Data[sizeof(T)];
+        UInt64  AlignInt;
+        double  AlignDouble;
+        void*   AlignPtr;
+    };
+
+public:
+    ObjectPool()
+    {
+        OVR_COMPILER_ASSERT(Capacity > 0 && Capacity < EmptyIndex);
+        for (unsigned i = 0; i < Capacity; i++)
+            Next[i] = (i + 1 < Capacity) ? (i + 1) : (UInt32)EmptyIndex;
+        Head            = 0;
+        AllocCount      = 0;
+        HeapAllocCount  = 0;
+    }
+
+    // Objects must all be returned before the pool is destroyed.
+    ~ObjectPool() { }
+
+    T*      New()                   { return Construct<T>(allocSlot()); }
+    template<class S>
+    T*      NewAlt(const S& source) { return ConstructAlt<T,S>(allocSlot(), source); }
+
+    void    Delete(T* p)
+    {
+        if (!p)
+            return;
+        Destruct<T>(p);
+        freeSlot(p);
+    }
+
+    // Returns true if p points into the pool's inline storage.
+    bool    Owns(const void* p) const
+    {
+        return (p >= (const void*)Slots) && (p < (const void*)(Slots + Capacity));
+    }
+
+    // Total number of New calls and the number of them that overflowed
+    // to the heap because all inline slots were taken.
+    UInt32  GetAllocCount() const       { return AllocCount; }
+    UInt32  GetHeapAllocCount() const   { return HeapAllocCount; }
+
+private:
+    void*   allocSlot()
+    {
+        AllocCount.Increment_NoSync();
+
+        UInt32 head, next;
+        do {
+            head = Head.Load_Acquire();
+            UInt32 index = head & IndexMask;
+            if (index == EmptyIndex)
+            {
+                HeapAllocCount.Increment_NoSync();
+                return OVR_ALLOC(sizeof(Slot));
+            }
+            next = ((head + TagUnit) & ~(UInt32)IndexMask) | Next[index];
+        } while (!Head.CompareAndSet_Sync(head, next));
+
+        return Slots[head & IndexMask].Data;
+    }
+
+    void    freeSlot(void* p)
+    {
+        if (!Owns(p))
+        {
+            OVR_FREE(p);
+            return;
+        }
+
+        UInt32 index = (UInt32)((Slot*)p - Slots);
+        UInt32 head, next;
+        do {
+            head        = Head.Load_Acquire();
+            Next[index] = head & IndexMask;
+            next        = ((head + TagUnit) & ~(UInt32)IndexMask) | index;
+        } while (!Head.CompareAndSet_Sync(head, next));
+    }
+
+    Slot                Slots[Capacity];
+    volatile UInt32     Next[Capacity];
+    AtomicInt<UInt32>   Head;
+    AtomicInt<UInt32>   AllocCount;
+    AtomicInt<UInt32>   HeapAllocCount;
+
+    // Pool storage is address-identified; copying is not allowed.
+    ObjectPool(const ObjectPool&);
+    void operator = (const ObjectPool&);
+};
+
+
+} // OVR
+
+#endif
@@ -0,0 +1,170 @@
+/************************************************************************************
+
+Filename    :   OVR_PerfCounters.cpp
+Content     :   Always-on performance counters with per-thread storage
+Created     :   October 14, 2026
+Notes       :
+
+Copyright   :   Copyright 2014 Oculus VR, Inc. All Rights reserved.
+
+Licensed under the Oculus VR Rift SDK License Version 3.1 (the "License");
+you may not use the Oculus VR Rift SDK except in compliance with the License,
+which is provided at the time of installation or download, or which
+otherwise accompanies this software in either electronic or hard copy form.
+
+You may obtain a copy of the License at
+
+http://www.oculusvr.com/licenses/LICENSE-3.1
+
+Unless required by applicable law or agreed to in writing, the Oculus VR SDK
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+************************************************************************************/
+
+#include "OVR_PerfCounters.h"
+#include "OVR_Atomic.h"
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(OVR_CC_MSVC)
+#define OVR_PERF_THREAD_LOCAL __declspec(thread)
+#else
+#define OVR_PERF_THREAD_LOCAL __thread
+#endif
+
+namespace OVR {
+
+// Samples of all counters recorded by one thread. Only the owning thread writes
+// a block; readers add up the blocks of all threads without locking.
+struct PerfCounterBlock
+{
+    struct Slot
+    {
+        volatile UInt32 Count;
+        volatile double Sum;
+        volatile double Max;
+        volatile UInt32 Buckets[PerfCounterValue::HistogramBuckets];
+    };
+
+    Slot                Slots[PerfCounter::MaxCounters];
+    PerfCounterBlock*   pNext;
+};
+
+// Plain data, so that counters constructed during static initialization of
+// other files find them zeroed.
+static PerfCounter* volatile        PerfCounterList  = 0;
+static volatile UInt32              PerfCounterCount = 0;
+static PerfCounterBlock* volatile   PerfCounterBlocks = 0;
+
+static OVR_PERF_THREAD_LOCAL PerfCounterBlock* pThreadPerfBlock = 0;
+
+// Blocks come from malloc rather than the OVR allocator, since threads may record
+// before System::Init or after System::Destroy. They are kept until the process
+// exits, as their totals must survive the threads that recorded them.
+static PerfCounterBlock* getThreadPerfBlock()
+{
+    PerfCounterBlock* block = pThreadPerfBlock;
+    if (block)
+        return block;
+
+    block = (PerfCounterBlock*)malloc(sizeof(PerfCounterBlock));
+    if (!block)
+        return 0;
+    memset(block, 0, sizeof(PerfCounterBlock));
+
+    do {
+        block->pNext = AtomicOps<PerfCounterBlock*>::Load_Acquire(&PerfCounterBlocks);
+    } while (!AtomicOps<PerfCounterBlock*>::CompareAndSet_Sync(&PerfCounterBlocks, block->pNext, block));
+
+    pThreadPerfBlock = block;
+    return block;
+}
+
+
+//-----------------------------------------------------------------------------------
+// ***** PerfCounter
+
+PerfCounter::PerfCounter(const char* name, Options options)
+    : Name(name), Index(-1), Histogram((options & Option_Histogram) != 0), pNext(0)
+{
+    UInt32 index = AtomicOps<UInt32>::ExchangeAdd_Sync(&PerfCounterCount, 1);
+    if (index < (UInt32)MaxCounters)
+        Index = (int)index;
+
+    do {
+        pNext = AtomicOps<PerfCounter*>::Load_Acquire(&PerfCounterList);
+    } while (!AtomicOps<PerfCounter*>::CompareAndSet_Sync(&PerfCounterList, pNext, this));
+}
+
+void PerfCounter::Record(double value)
+{
+    if (Index < 0)
+        return;
+    PerfCounterBlock* block = getThreadPerfBlock();
+    if (!block)
+        return;
+
+    PerfCounterBlock::Slot& slot = block->Slots[Index];
+    slot.Sum = slot.Sum + value;
+    if (slot.Count == 0 || value > slot.Max)
+        slot.Max = value;
+    if (Histogram)
+    {
+        // Bucket bounds double from 1/16 ms, so the bucket is the bit length of
+        // the sample in those units.
+        double units  = value * 16000.0;
+        int    bucket = 0;
+        while (bucket < PerfCounterValue::HistogramBuckets - 1 && units >= 1.0)
+        {
+            units *= 0.5;
+            bucket++;
+        }
+        slot.Buckets[bucket] = slot.Buckets[bucket] + 1;
+    }
+    // Count is published last, so a reader seeing it also sees the sum.
+    AtomicOps<UInt32>::Store_Release(&slot.Count, slot.Count + 1);
+}
+
+PerfCounterValue PerfCounter::GetValue() const
+{
+    PerfCounterValue value;
+    if (Index < 0)
+        return value;
+
+    for (PerfCounterBlock* block = AtomicOps<PerfCounterBlock*>::Load_Acquire(&PerfCounterBlocks);
+         block; block = block->pNext)
+    {
+        const PerfCounterBlock::Slot& slot = block->Slots[Index];
+        UInt32 count = AtomicOps<UInt32>::Load_Acquire(&slot.Count);
+        if (count == 0)
+            continue;
+        double max = slot.Max;
+        if (value.Count == 0 || max > value.Max)
+            value.Max = max;
+        value.Count += count;
+        value.Sum   += slot.Sum;
+        if (Histogram)
+        {
+            for (int i = 0; i < PerfCounterValue::HistogramBuckets; i++)
+                value.Buckets[i] += slot.Buckets[i];
+        }
+    }
+    return value;
+}
+
+PerfCounter* PerfCounter::Find(const char* name)
+{
+    for (PerfCounter* counter = AtomicOps<PerfCounter*>::Load_Acquire(&PerfCounterList);
+         counter; counter = counter->pNext)
+    {
+        if (strcmp(counter->Name, name) == 0)
+            return counter;
+    }
+    return 0;
+}
+
+
+} // OVR
@@ -0,0 +1,131 @@
+/************************************************************************************
+
+PublicHeader:   Kernel
+Filename    :   OVR_PerfCounters.h
+Content     :   Always-on performance counters with per-thread storage
+Created     :   October 14, 2026
+Notes       :
+
+Copyright   :   Copyright 2014 Oculus VR, Inc. All Rights reserved.
+
+Licensed under the Oculus VR Rift SDK License Version 3.1 (the "License");
+you may not use the Oculus VR Rift SDK except in compliance with the License,
+which is provided at the time of installation or download, or which
+otherwise accompanies this software in either electronic or hard copy form.
+
+You may obtain a copy of the License at
+
+http://www.oculusvr.com/licenses/LICENSE-3.1
+
+Unless required by applicable law or agreed to in writing, the Oculus VR SDK
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+************************************************************************************/
+
+#ifndef OVR_PerfCounters_h
+#define OVR_PerfCounters_h
+
+#include "OVR_Types.h"
+#include "OVR_Timer.h"
+
+namespace OVR {
+
+
+//-----------------------------------------------------------------------------------
+// ***** PerfCounter
+
+// PerfCounter accumulates samples of a value on hot paths, such as a duration in
+// seconds or a queue depth, keeping their count, sum and maximum. Samples go to a
+// block owned by the recording thread, so Record takes no lock and shares no cache
+// line with other threads; GetValue adds up the blocks of all threads. A value read
+// while another thread records may be one sample behind.
+//
+// Counters are static objects, named "perf.<area>.<name>", that register
+// themselves when constructed and can then be looked up by name:
+//
+//     static PerfCounter FusionTime("perf.fusion.handleMessage");
+//     ...
+//     PerfCounterScope scope(FusionTime);
+//
+// No more than MaxCounters can exist; records to the ones past that are dropped.
+//
+// Counters of latencies can also keep a histogram of their samples, in buckets of
+// seconds whose bounds double from 1/16 ms: bucket 0 counts samples under 1/16 ms,
+// bucket i those from 2^(i-1)/16 ms to 2^i/16 ms, and the last also longer ones.
+//
+//     static PerfCounter SampleToFusion("perf.latency.sampleToFusion", PerfCounter::Option_Histogram);
+
+struct PerfCounterValue
+{
+    enum { HistogramBuckets = 16 };
+
+    UInt32  Count;
+    double  Sum;
+    double  Max;
+    // Zero unless the counter keeps a histogram.
+    UInt32  Buckets[HistogramBuckets];
+
+    PerfCounterValue() : Count(0), Sum(0), Max(0)
+    { for (int i = 0; i < HistogramBuckets; i++) Buckets[i] = 0; }
+
+    double  GetMean() const { return Count ? Sum / Count : 0.0; }
+    // Upper bound of a bucket, in seconds; the last bucket has none.
+    static double GetBucketBound(int bucket) { return (double)(1 << bucket) / 16000.0; }
+};
+
+class PerfCounter
+{
+public:
+    enum { MaxCounters = 32 };
+
+    enum Options
+    {
+        Option_None      = 0,
+        Option_Histogram = 1
+    };
+
+    // Name must stay valid as long as the counter; normally it is a literal.
+    explicit PerfCounter(const char* name, Options options = Option_None);
+
+    void                Record(double value);
+
+    // Totals over all threads since the process started.
+    PerfCounterValue    GetValue() const;
+    const char*         GetName() const     { return Name; }
+    bool                HasHistogram() const { return Histogram; }
+
+    // Returns the counter with the given name, or null.
+    static PerfCounter* Find(const char* name);
+
+private:
+    const char*         Name;
+    // Slot in the per-thread blocks; -1 if there were too many counters.
+    int                 Index;
+    bool                Histogram;
+    PerfCounter*        pNext;
+};
+
+
+// Records the time spent in a scope, in seconds.
+class PerfCounterScope
+{
+public:
+    PerfCounterScope(PerfCounter& counter)
+        : Counter(counter), Start(Timer::GetSeconds()) { }
+    ~PerfCounterScope()
+    { Counter.Record(Timer::GetSeconds() - Start); }
+
+private:
+    void operator = (const PerfCounterScope&) { }
+
+    PerfCounter&        Counter;
+    double              Start;
+};
+
+
+} // OVR
+
+#endif
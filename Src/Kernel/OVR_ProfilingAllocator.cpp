@@ -0,0 +1,302 @@
+/************************************************************************************
+
+Filename    :   OVR_ProfilingAllocator.cpp
+Content     :   Allocator that finds allocation hot sites
+Created     :   October 14, 2026
+Notes       :
+
+Copyright   :   Copyright 2014 Oculus VR, Inc. All Rights reserved.
+
+Licensed under the Oculus VR Rift SDK License Version 3.1 (the "License");
+you may not use the Oculus VR Rift SDK except in compliance with the License,
+which is provided at the time of installation or download, or which
+otherwise accompanies this software in either electronic or hard copy form.
+
+You may obtain a copy of the License at
+
+http://www.oculusvr.com/licenses/LICENSE-3.1
+
+Unless required by applicable law or agreed to in writing, the Oculus VR SDK
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+************************************************************************************/
+
+#include "OVR_ProfilingAllocator.h"
+#include "OVR_Alg.h"
+#include "OVR_Log.h"
+#include "OVR_Std.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(OVR_OS_LINUX) || defined(OVR_OS_MAC)
+#include <execinfo.h>
+#define OVR_PROFILING_ALLOCATOR_STACKS
+#elif defined(OVR_OS_WIN32)
+#include <windows.h>
+#define OVR_PROFILING_ALLOCATOR_STACKS
+#endif
+
+#if defined(OVR_CC_MSVC)
+#define OVR_PROFILING_THREAD_LOCAL __declspec(thread)
+#else
+#define OVR_PROFILING_THREAD_LOCAL __thread
+#endif
+
+namespace OVR {
+
+// State of the calling thread.
+static OVR_PROFILING_THREAD_LOCAL int      CurrentThreadRole = ProfilingAllocator::ThreadRole_App;
+static OVR_PROFILING_THREAD_LOCAL bool     ThreadInFrame     = false;
+static OVR_PROFILING_THREAD_LOCAL unsigned ThreadAllocCount  = 0;
+// Set while recording, so that allocations made by capturing a stack, if any,
+// aren't recorded in turn.
+static OVR_PROFILING_THREAD_LOCAL bool     ThreadRecording   = false;
+
+static int captureStack(void** frames, int maxFrames)
+{
+#if defined(OVR_OS_WIN32)
+    return (int)CaptureStackBackTrace(0, (DWORD)maxFrames, frames, 0);
+#elif defined(OVR_PROFILING_ALLOCATOR_STACKS)
+    return backtrace(frames, maxFrames);
+#else
+    OVR_UNUSED2(frames, maxFrames);
+    return 0;
+#endif
+}
+
+
+//-----------------------------------------------------------------------------------
+// ***** ProfilingAllocator
+
+ProfilingAllocator::ProfilingAllocator()
+    : SiteCount(0), DroppedCount(0), SampleInterval(DefaultSampleInterval)
+{
+    // The table comes from malloc, since it is needed while the allocator is the
+    // one being installed.
+    Sites = (Site*)malloc(sizeof(Site) * MaxSites);
+    memset(SiteBuckets, 0, sizeof(SiteBuckets));
+}
+
+ProfilingAllocator::~ProfilingAllocator()
+{
+    free(Sites);
+}
+
+void* ProfilingAllocator::Alloc(UPInt size)
+{
+    record(size, 0, 0);
+    return malloc(size);
+}
+
+void* ProfilingAllocator::AllocDebug(UPInt size, const char* file, unsigned line)
+{
+    record(size, file, line);
+    return malloc(size);
+}
+
+void* ProfilingAllocator::AllocTagged(UPInt size, AllocSubsystem subsystem, const char* file, unsigned line)
+{
+    OVR_UNUSED(subsystem);
+    record(size, file, line);
+    return malloc(size);
+}
+
+void* ProfilingAllocator::Realloc(void* p, UPInt newSize)
+{
+    record(newSize, 0, 0);
+    return realloc(p, newSize);
+}
+
+void ProfilingAllocator::Free(void *p)
+{
+    free(p);
+}
+
+void ProfilingAllocator::SetSampleInterval(unsigned interval)
+{
+    SampleInterval = interval ? interval : 1;
+}
+
+void ProfilingAllocator::Reset()
+{
+    Lock::Locker lock(&SitesLock);
+    SiteCount    = 0;
+    DroppedCount = 0;
+    memset(SiteBuckets, 0, sizeof(SiteBuckets));
+}
+
+void ProfilingAllocator::SetThreadRole(ThreadRole role)
+{
+    CurrentThreadRole = role;
+}
+
+void ProfilingAllocator::SetFrameScope(bool inFrame)
+{
+    ThreadInFrame = inFrame;
+}
+
+void ProfilingAllocator::record(UPInt size, const char* file, unsigned line)
+{
+    // The sample counter is per thread, so that profiling doesn't add contention
+    // of its own.
+    bool sampled = (++ThreadAllocCount % SampleInterval) == 0;
+    bool inFrame = ThreadInFrame;
+    if ((!sampled && !inFrame) || ThreadRecording || !Sites)
+        return;
+    ThreadRecording = true;
+
+    void* frames[MaxStackFrames + 2];
+    int   frameCount = captureStack(frames, MaxStackFrames + 2);
+    // Skip record and the Alloc that called it.
+    int   skip       = Alg::Min(frameCount, 2);
+    frameCount -= skip;
+
+    UPInt hash = (UPInt)file * 31 + line;
+    for (int i = 0; i < frameCount; i++)
+        hash = (hash ^ (UPInt)frames[skip + i]) * 0x9E3779B1u;
+
+    {
+        Lock::Locker lock(&SitesLock);
+
+        // Buckets hold site index + 1; probing stops at an empty one.
+        Site*    site   = 0;
+        unsigned bucket = (unsigned)(hash >> 7) & (SiteBucketCount - 1);
+        for (;; bucket = (bucket + 1) & (SiteBucketCount - 1))
+        {
+            if (!SiteBuckets[bucket])
+                break;
+            Site& s = Sites[SiteBuckets[bucket] - 1];
+            if (s.Hash == hash && s.File == file && s.Line == line && s.FrameCount == frameCount &&
+                memcmp(s.Frames, frames + skip, sizeof(void*) * frameCount) == 0)
+            {
+                site = &s;
+                break;
+            }
+        }
+
+        if (!site && SiteCount < (unsigned)MaxSites)
+        {
+            site = &Sites[SiteCount++];
+            memset(site, 0, sizeof(Site));
+            site->Hash       = hash;
+            site->FrameCount = frameCount;
+            site->File       = file;
+            site->Line       = line;
+            memcpy(site->Frames, frames + skip, sizeof(void*) * frameCount);
+            SiteBuckets[bucket] = (UInt16)SiteCount;
+        }
+
+        if (site)
+        {
+            if (sampled)
+            {
+                site->Sampled[CurrentThreadRole]++;
+                site->SampledBytes += size;
+            }
+            if (inFrame)
+                site->InFrame++;
+        }
+        else
+        {
+            DroppedCount++;
+        }
+    }
+
+    ThreadRecording = false;
+}
+
+struct ProfilingAllocator::SiteLess
+{
+    bool ByInFrame;
+
+    bool operator()(const Site& a, const Site& b) const
+    {
+        if (ByInFrame)
+            return a.InFrame > b.InFrame;
+        return (a.Sampled[ThreadRole_App] + a.Sampled[ThreadRole_Device]) >
+               (b.Sampled[ThreadRole_App] + b.Sampled[ThreadRole_Device]);
+    }
+};
+
+void ProfilingAllocator::logSite(const char* kind, const Site& site, unsigned sampleInterval)
+{
+    char at[256] = "";
+    if (site.File)
+        OVR_sprintf(at, sizeof(at), ", at %s:%u", site.File, site.Line);
+
+    LogText("ProfilingAllocator: %s: %u in frames, ~%u on app threads, ~%u on the device thread, "
+            "~%u bytes%s\n",
+            kind, (unsigned)site.InFrame,
+            (unsigned)(site.Sampled[ThreadRole_App] * sampleInterval),
+            (unsigned)(site.Sampled[ThreadRole_Device] * sampleInterval),
+            (unsigned)(site.SampledBytes * sampleInterval), at);
+
+#if defined(OVR_PROFILING_ALLOCATOR_STACKS) && !defined(OVR_OS_WIN32)
+    char** symbols = backtrace_symbols(site.Frames, site.FrameCount);
+    for (int i = 0; i < site.FrameCount; i++)
+        LogText("    %s\n", symbols ? symbols[i] : "?");
+    free(symbols);
+#else
+    for (int i = 0; i < site.FrameCount; i++)
+        LogText("    %p\n", site.Frames[i]);
+#endif
+}
+
+void ProfilingAllocator::LogReport(unsigned maxSites)
+{
+    // Work on a copy, since logging allocates.
+    unsigned siteCount;
+    UInt64   droppedCount;
+    Site*    sites;
+    {
+        Lock::Locker lock(&SitesLock);
+        siteCount    = SiteCount;
+        droppedCount = DroppedCount;
+        sites        = (Site*)malloc(sizeof(Site) * (siteCount ? siteCount : 1));
+        if (sites)
+            memcpy(sites, Sites, sizeof(Site) * siteCount);
+    }
+    if (!sites)
+        return;
+
+    unsigned interval = SampleInterval;
+    UInt64   inFrame  = 0;
+    UInt64   sampled[ThreadRole_Count] = { 0, 0 };
+    for (unsigned i = 0; i < siteCount; i++)
+    {
+        inFrame += sites[i].InFrame;
+        for (int role = 0; role < ThreadRole_Count; role++)
+            sampled[role] += sites[i].Sampled[role];
+    }
+
+    LogText("ProfilingAllocator: %u sites; %u allocations in frames; sampling 1 in %u: "
+            "~%u on app threads, ~%u on the device thread; %u dropped\n",
+            siteCount, (unsigned)inFrame, interval,
+            (unsigned)(sampled[ThreadRole_App] * interval),
+            (unsigned)(sampled[ThreadRole_Device] * interval), (unsigned)droppedCount);
+
+    Alg::ArrayAdaptor<Site> siteArray(sites, siteCount);
+    SiteLess                less;
+
+    less.ByInFrame = true;
+    Alg::QuickSort(siteArray, less);
+    for (unsigned i = 0; i < siteCount && sites[i].InFrame; i++)
+        logSite("in frame", sites[i], interval);
+
+    less.ByInFrame = false;
+    Alg::QuickSort(siteArray, less);
+    for (unsigned i = 0; i < siteCount && i < maxSites; i++)
+    {
+        if (!sites[i].Sampled[ThreadRole_App] && !sites[i].Sampled[ThreadRole_Device])
+            break;
+        logSite("hot", sites[i], interval);
+    }
+
+    free(sites);
+}
+
+} // OVR
@@ -0,0 +1,134 @@
+/************************************************************************************
+
+PublicHeader:   Kernel
+Filename    :   OVR_ProfilingAllocator.h
+Content     :   Allocator that finds allocation hot sites
+Created     :   October 14, 2026
+Notes       :
+
+Copyright   :   Copyright 2014 Oculus VR, Inc. All Rights reserved.
+
+Licensed under the Oculus VR Rift SDK License Version 3.1 (the "License");
+you may not use the Oculus VR Rift SDK except in compliance with the License,
+which is provided at the time of installation or download, or which
+otherwise accompanies this software in either electronic or hard copy form.
+
+You may obtain a copy of the License at
+
+http://www.oculusvr.com/licenses/LICENSE-3.1
+
+Unless required by applicable law or agreed to in writing, the Oculus VR SDK
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+************************************************************************************/
+
+#ifndef OVR_ProfilingAllocator_h
+#define OVR_ProfilingAllocator_h
+
+#include "OVR_Allocator.h"
+#include "OVR_Atomic.h"
+
+namespace OVR {
+
+
+//-----------------------------------------------------------------------------------
+// ***** ProfilingAllocator
+
+// ProfilingAllocator finds the code that allocates, to remove per-frame
+// allocations and allocator contention. It takes memory from malloc like
+// DefaultAllocator, and records the call stack of allocations in a table of
+// sites (call stacks, with the file and line of tagged and debug allocations):
+//
+//  - Every SampleInterval-th allocation of each thread, counted by the role of the
+//    thread: the device thread, which sets its role, or application threads.
+//  - Every allocation made on a thread between ovrHmd_BeginFrame and
+//    ovrHmd_EndFrame, which should be none.
+//
+// It is installed in place of the default allocator:
+//
+//     ProfilingAllocator* profiler = ProfilingAllocator::InitSystemSingleton();
+//     System::Init(Log::ConfigureDefaultLog(LogMask_All), profiler);
+//     ...
+//     profiler->LogReport();
+//
+// Call stacks are captured on Linux, Mac and Windows; elsewhere sites are told
+// apart by file and line only.
+
+class ProfilingAllocator : public Allocator_SingletonSupport<ProfilingAllocator>
+{
+public:
+    enum
+    {
+        MaxStackFrames        = 12,
+        // Sites past this many are counted as dropped.
+        MaxSites              = 1024,
+        DefaultSampleInterval = 64
+    };
+
+    enum ThreadRole
+    {
+        ThreadRole_App,
+        ThreadRole_Device,
+        ThreadRole_Count
+    };
+
+    ProfilingAllocator();
+    ~ProfilingAllocator();
+
+    virtual void*   Alloc(UPInt size);
+    virtual void*   AllocDebug(UPInt size, const char* file, unsigned line);
+    virtual void*   AllocTagged(UPInt size, AllocSubsystem subsystem, const char* file, unsigned line);
+    virtual void*   Realloc(void* p, UPInt newSize);
+    virtual void    Free(void *p);
+
+    // Samples one allocation in interval on each thread; 1 records all of them.
+    // Counts are scaled by the current interval, so Reset after changing it.
+    void            SetSampleInterval(unsigned interval);
+    // Forgets the sites recorded so far.
+    void            Reset();
+
+    // Logs the sites with allocations inside frames, then the maxSites sites with
+    // the most sampled allocations, each with its call stack.
+    void            LogReport(unsigned maxSites = 20);
+
+    // Marks the calling thread; cheap, and kept whether or not a ProfilingAllocator
+    // is installed.
+    static void     SetThreadRole(ThreadRole role);
+    // Called by ovrHmd_BeginFrame (true) and ovrHmd_EndFrame (false).
+    static void     SetFrameScope(bool inFrame);
+
+private:
+    struct Site
+    {
+        UPInt       Hash;
+        void*       Frames[MaxStackFrames];
+        int         FrameCount;
+        const char* File;
+        unsigned    Line;
+        UInt64      Sampled[ThreadRole_Count];
+        UInt64      SampledBytes;
+        UInt64      InFrame;
+    };
+
+    struct SiteLess;
+
+    void            record(UPInt size, const char* file, unsigned line);
+    static void     logSite(const char* kind, const Site& site, unsigned sampleInterval);
+
+    // Open addressing index of Sites; a power of two, larger than MaxSites.
+    enum { SiteBucketCount = 2048 };
+
+    Lock            SitesLock;
+    Site*           Sites;
+    unsigned        SiteCount;
+    UInt16          SiteBuckets[SiteBucketCount];
+    UInt64          DroppedCount;
+    volatile unsigned SampleInterval;
+};
+
+} // OVR
+
+#endif // OVR_ProfilingAllocator_h
@@ -98,14 +98,5 @@ void    RefCountVImpl::Release()
         delete this;
 }
 
-// *** NON-Thread-Safe RefCountImpl
-
-void    RefCountNTSImpl::Release() const
-{
-    RefCount--;
-    if (RefCount == 0)
-        delete this;
-}
-
 
 } // OVR
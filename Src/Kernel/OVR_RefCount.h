@@ -39,7 +39,14 @@ namespace OVR {
 // There are three types of reference counting base classes:
 //
 //  RefCountBase     - Provides thread-safe reference counting (Default).
+//  RefCountBaseV    - Thread-safe, with virtual AddRef and Release.
 //  RefCountBaseNTS  - Non Thread Safe version of reference counting.
+//
+// RefCountBaseNTS avoids the locked instructions of every AddRef and Release, but
+// a type may only use it when all the pointers to an object are used by one
+// thread at a time, such as data structures only reached under one lock. Such a
+// type says so, and why, where it derives from RefCountBaseNTS, so that the uses
+// can be found and checked by searching for it.
 
 
 // ***** Declared classes
@@ -161,7 +168,11 @@ class RefCountNTSImpl : public RefCountNTSImplCore
 {
 public:
     OVR_FORCE_INLINE void    AddRef() const { RefCount++; }
-    void    Release() const;   
+    OVR_FORCE_INLINE void    Release() const
+    {
+        if (--RefCount == 0)
+            delete this;
+    }
 };
 
 
@@ -0,0 +1,162 @@
+/************************************************************************************
+
+Filename    :   OVR_SharedMemory.cpp
+Content     :   Named memory regions shared between processes
+Created     :   October 14, 2026
+Notes       :
+
+Copyright   :   Copyright 2014 Oculus VR, Inc. All Rights reserved.
+
+Licensed under the Oculus VR Rift SDK License Version 3.1 (the "License");
+you may not use the Oculus VR Rift SDK except in compliance with the License,
+which is provided at the time of installation or download, or which
+otherwise accompanies this software in either electronic or hard copy form.
+
+You may obtain a copy of the License at
+
+http://www.oculusvr.com/licenses/LICENSE-3.1
+
+Unless required by applicable law or agreed to in writing, the Oculus VR SDK
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+************************************************************************************/
+
+#include "OVR_SharedMemory.h"
+#include "OVR_Log.h"
+
+#if !defined(OVR_OS_WIN32)
+#define OVR_SHAREDMEMORY_SHM
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <errno.h>
+#include <string.h>
+#endif
+
+namespace OVR {
+
+
+SharedMemory::SharedMemory()
+  : pData(0), Size(0), Creator(false)
+{
+}
+
+SharedMemory::~SharedMemory()
+{
+    Close();
+}
+
+
+#if defined(OVR_SHAREDMEMORY_SHM)
+
+bool SharedMemory::Create(const char* name, UPInt size)
+{
+    Close();
+
+    int fd = shm_open(name, O_RDWR | O_CREAT | O_EXCL, 0600);
+    if (fd < 0)
+    {
+        if (errno == EEXIST)
+            return false;
+        LogError("SharedMemory - Failed to create %s: %s\n", name, strerror(errno));
+        return false;
+    }
+    if (ftruncate(fd, (off_t)size) != 0 || !mapRegion(fd, size))
+    {
+        LogError("SharedMemory - Failed to size %s: %s\n", name, strerror(errno));
+        ::close(fd);
+        shm_unlink(name);
+        return false;
+    }
+    ::close(fd);
+
+    Name    = name;
+    Creator = true;
+    return true;
+}
+
+bool SharedMemory::Open(const char* name, UPInt size)
+{
+    Close();
+
+    int fd = shm_open(name, O_RDWR, 0);
+    if (fd < 0)
+        return false;
+
+    struct stat st;
+    bool        mapped = false;
+    if (fstat(fd, &st) == 0 && st.st_size >= (off_t)size)
+        mapped = mapRegion(fd, size);
+    ::close(fd);
+    if (!mapped)
+        return false;
+
+    Name    = name;
+    Creator = false;
+    return true;
+}
+
+bool SharedMemory::mapRegion(int fd, UPInt size)
+{
+    void* data = mmap(0, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (data == MAP_FAILED)
+        return false;
+    pData = data;
+    Size  = size;
+    return true;
+}
+
+void SharedMemory::Close()
+{
+    if (pData)
+    {
+        munmap(pData, Size);
+        if (Creator)
+            shm_unlink(Name.ToCStr());
+    }
+    pData   = 0;
+    Size    = 0;
+    Creator = false;
+    Name.Clear();
+}
+
+bool SharedMemory::Remove(const char* name)
+{
+    return shm_unlink(name) == 0;
+}
+
+#else // OVR_SHAREDMEMORY_SHM
+
+bool SharedMemory::Create(const char*, UPInt)
+{
+    return false;
+}
+
+bool SharedMemory::Open(const char*, UPInt)
+{
+    return false;
+}
+
+bool SharedMemory::mapRegion(int, UPInt)
+{
+    return false;
+}
+
+void SharedMemory::Close()
+{
+}
+
+bool SharedMemory::Remove(const char*)
+{
+    return false;
+}
+
+#endif // OVR_SHAREDMEMORY_SHM
+
+
+} // OVR
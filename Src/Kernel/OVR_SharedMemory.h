@@ -0,0 +1,84 @@
+/************************************************************************************
+
+Filename    :   OVR_SharedMemory.h
+Content     :   Named memory regions shared between processes
+Created     :   October 14, 2026
+Notes       :
+
+Copyright   :   Copyright 2014 Oculus VR, Inc. All Rights reserved.
+
+Licensed under the Oculus VR Rift SDK License Version 3.1 (the "License");
+you may not use the Oculus VR Rift SDK except in compliance with the License,
+which is provided at the time of installation or download, or which
+otherwise accompanies this software in either electronic or hard copy form.
+
+You may obtain a copy of the License at
+
+http://www.oculusvr.com/licenses/LICENSE-3.1
+
+Unless required by applicable law or agreed to in writing, the Oculus VR SDK
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+************************************************************************************/
+
+#ifndef OVR_SharedMemory_h
+#define OVR_SharedMemory_h
+
+#include "OVR_String.h"
+
+namespace OVR {
+
+
+//-----------------------------------------------------------------------------------
+// ***** SharedMemory
+
+// SharedMemory maps a named region of memory that other processes can map too,
+// through POSIX shm_open. One process creates the region and removes its name
+// when it closes it; others open it by name while it exists. A region left by a
+// process that exited without closing it stays until Remove is called; only the
+// user of the region can tell whether it is stale. Anything placed in
+// the region must not hold pointers, as each process maps it at its own address.
+//
+// Not supported on Windows, where Create and Open fail.
+
+class SharedMemory : public NewOverrideBase
+{
+public:
+    SharedMemory();
+    ~SharedMemory();
+
+    // Creates a zero-filled region of the given size; fails if the name exists. The
+    // name should start with '/'.
+    bool        Create(const char* name, UPInt size);
+    // Maps an existing region for reading and writing; fails if it doesn't exist
+    // or is smaller than size.
+    bool        Open(const char* name, UPInt size);
+    // Unmaps the region, and removes its name if this object created it.
+    void        Close();
+    // Removes the name of a region, so that it can be created again; processes that
+    // mapped it keep their mapping.
+    static bool Remove(const char* name);
+
+    void*       GetData() const     { return pData; }
+    UPInt       GetSize() const     { return Size; }
+    bool        IsCreator() const   { return Creator; }
+
+private:
+    bool        mapRegion(int fd, UPInt size);
+
+    String      Name;
+    void*       pData;
+    UPInt       Size;
+    bool        Creator;
+
+    SharedMemory(const SharedMemory&);
+    void operator = (const SharedMemory&);
+};
+
+
+} // OVR
+
+#endif
@@ -27,7 +27,7 @@ limitations under the License.
 #include "OVR_Std.h"
 #include "OVR_Alg.h"
 
-// localeconv() call in OVR_strtod()
+// localeconv() call in strtodCurrentLocale()
 #include <locale.h>
 
 namespace OVR {
@@ -192,8 +192,21 @@ int OVR_CDECL OVR_wcsicmp(const wchar_t* a, const wchar_t* b)
 #endif
 }
 
-// This function is not inline because of dependency on <locale.h>
-double OVR_CDECL OVR_strtod(const char* string, char** tailptr)
+// Floating point text is always written and read with '.', whatever the locale.
+
+static const double StrtodExactPowersOfTen[] =
+{
+    1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,  1e8,  1e9,  1e10, 1e11,
+    1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+};
+
+static inline bool strtodIsDigit(char c)
+{
+    return c >= '0' && c <= '9';
+}
+
+// Converts with the C runtime, whose decimal point is that of the locale.
+static double strtodCurrentLocale(const char* string, char** tailptr)
 {
 #if !defined(OVR_OS_ANDROID)
     const char s = *localeconv()->decimal_point;
@@ -213,13 +226,467 @@ double OVR_CDECL OVR_strtod(const char* string, char** tailptr)
             }
         }
 
-        return strtod(buffer, tailptr);
+        double result = strtod(buffer, tailptr);
+        // The tail points into the copy; move it to the string.
+        if (tailptr)
+            *tailptr = (char*)string + (*tailptr - buffer);
+        return result;
     }
 #endif
 
     return strtod(string, tailptr);
 }
 
+// Decimal numbers are read into a mantissa of up to 19 digits and an exponent.
+// When the mantissa fits a double exactly and the exponent is within the exact
+// powers of ten, one multiply or divide gives the correctly rounded result
+// (Clinger's fast path), which covers the numbers we write. Anything else,
+// including hex, infinities and NaN, is converted by the C runtime.
+double OVR_CDECL OVR_strtod(const char* string, char** tailptr)
+{
+    const char* p        = string;
+    bool        negative = false;
+    bool        anyDigit = false;
+    UInt64      mantissa = 0;
+    int         digits   = 0;       // significant digits in mantissa
+    int         exponent = 0;       // decimal exponent of mantissa
+    bool        dropped  = false;   // non-zero digits didn't fit in mantissa
+
+    while (*p == ' ' || (*p >= '\t' && *p <= '\r'))
+        p++;
+    if (*p == '-' || *p == '+')
+        negative = (*p++ == '-');
+
+    for (; strtodIsDigit(*p); p++)
+    {
+        int d = *p - '0';
+        anyDigit = true;
+        if (digits < 19)
+        {
+            mantissa = mantissa * 10 + d;
+            if (mantissa)
+                digits++;   // leading zeros aren't significant
+        }
+        else
+        {
+            exponent++;
+            dropped |= (d != 0);
+        }
+    }
+
+    if (*p == 'x' || *p == 'X')
+        return strtodCurrentLocale(string, tailptr);
+
+    if (*p == '.')
+    {
+        for (p++; strtodIsDigit(*p); p++)
+        {
+            int d = *p - '0';
+            anyDigit = true;
+            if (digits < 19)
+            {
+                mantissa = mantissa * 10 + d;
+                exponent--;
+                if (mantissa)
+                    digits++;
+            }
+            else
+            {
+                dropped |= (d != 0);
+            }
+        }
+    }
+
+    if (!anyDigit)
+        return strtodCurrentLocale(string, tailptr);
+
+    if (*p == 'e' || *p == 'E')
+    {
+        const char* e        = p + 1;
+        bool        negScale = false;
+        int         scale    = 0;
+
+        if (*e == '+' || *e == '-')
+            negScale = (*e++ == '-');
+        if (strtodIsDigit(*e))
+        {
+            for (; strtodIsDigit(*e); e++)
+            {
+                if (scale < 100000)     // far past the range of doubles
+                    scale = scale * 10 + (*e - '0');
+            }
+            exponent += negScale ? -scale : scale;
+            p = e;
+        }
+    }
+
+    double n;
+    if (mantissa == 0)
+    {
+        n = 0.0;
+    }
+    else if (!dropped && mantissa <= (UInt64(1) << 53) && exponent >= -22 && exponent <= 22)
+    {
+        n = (double)mantissa;
+        n = (exponent < 0) ? n / StrtodExactPowersOfTen[-exponent] : n * StrtodExactPowersOfTen[exponent];
+    }
+    else
+    {
+        return strtodCurrentLocale(string, tailptr);
+    }
+
+    if (tailptr)
+        *tailptr = (char*)p;
+    return negative ? -n : n;
+}
+
+
+// Reads a decimal number of 1 to 9 digits, which can't overflow a long, after the
+// whitespace and sign strtol takes. Returns false for anything else.
+static bool strtolDecimal(const char* string, bool allowMinus, long* value, char** tailptr)
+{
+    const char* p        = string;
+    bool        negative = false;
+
+    while (*p == ' ' || (*p >= '\t' && *p <= '\r'))
+        p++;
+    if (*p == '+' || (allowMinus && *p == '-'))
+        negative = (*p++ == '-');
+
+    const char* digits = p;
+    long        n      = 0;
+    for (; strtodIsDigit(*p); p++)
+    {
+        if (p - digits == 9)
+            return false;
+        n = n * 10 + (*p - '0');
+    }
+    if (p == digits)
+        return false;
+
+    *value = negative ? -n : n;
+    if (tailptr)
+        *tailptr = (char*)p;
+    return true;
+}
+
+long OVR_CDECL OVR_strtol(const char* string, char** tailptr, int radix)
+{
+    long value;
+    if (radix == 10 && strtolDecimal(string, true, &value, tailptr))
+        return value;
+    return strtol(string, tailptr, radix);
+}
+
+long OVR_CDECL OVR_strtoul(const char* string, char** tailptr, int radix)
+{
+    // Negated unsigned values wrap around, so they go to the C runtime.
+    long value;
+    if (radix == 10 && strtolDecimal(string, false, &value, tailptr))
+        return value;
+    return strtoul(string, tailptr, radix);
+}
+
+
+// OVR_dtoa uses Grisu2 (Loitsch, "Printing Floating-Point Numbers Quickly and
+// Accurately with Integers"): the value and the halfway points to its neighbors
+// are scaled by a cached power of ten into 64-bit fixed point, and digits are
+// generated until they are within the neighbors' interval. The result always
+// reads back as the same double, and is the shortest that does for all but a
+// tiny fraction of values, which get one digit more.
+
+// Normalized 64-bit significands and binary exponents of 10^-348, 10^-340, ... 10^340.
+static const UInt64 DtoaCachedPowerSignificands[] =
+{
+    0xfa8fd5a0081c0288ULL, 0xbaaee17fa23ebf76ULL, 0x8b16fb203055ac76ULL, 0xcf42894a5dce35eaULL,
+    0x9a6bb0aa55653b2dULL, 0xe61acf033d1a45dfULL, 0xab70fe17c79ac6caULL, 0xff77b1fcbebcdc4fULL,
+    0xbe5691ef416bd60cULL, 0x8dd01fad907ffc3cULL, 0xd3515c2831559a83ULL, 0x9d71ac8fada6c9b5ULL,
+    0xea9c227723ee8bcbULL, 0xaecc49914078536dULL, 0x823c12795db6ce57ULL, 0xc21094364dfb5637ULL,
+    0x9096ea6f3848984fULL, 0xd77485cb25823ac7ULL, 0xa086cfcd97bf97f4ULL, 0xef340a98172aace5ULL,
+    0xb23867fb2a35b28eULL, 0x84c8d4dfd2c63f3bULL, 0xc5dd44271ad3cdbaULL, 0x936b9fcebb25c996ULL,
+    0xdbac6c247d62a584ULL, 0xa3ab66580d5fdaf6ULL, 0xf3e2f893dec3f126ULL, 0xb5b5ada8aaff80b8ULL,
+    0x87625f056c7c4a8bULL, 0xc9bcff6034c13053ULL, 0x964e858c91ba2655ULL, 0xdff9772470297ebdULL,
+    0xa6dfbd9fb8e5b88fULL, 0xf8a95fcf88747d94ULL, 0xb94470938fa89bcfULL, 0x8a08f0f8bf0f156bULL,
+    0xcdb02555653131b6ULL, 0x993fe2c6d07b7facULL, 0xe45c10c42a2b3b06ULL, 0xaa242499697392d3ULL,
+    0xfd87b5f28300ca0eULL, 0xbce5086492111aebULL, 0x8cbccc096f5088ccULL, 0xd1b71758e219652cULL,
+    0x9c40000000000000ULL, 0xe8d4a51000000000ULL, 0xad78ebc5ac620000ULL, 0x813f3978f8940984ULL,
+    0xc097ce7bc90715b3ULL, 0x8f7e32ce7bea5c70ULL, 0xd5d238a4abe98068ULL, 0x9f4f2726179a2245ULL,
+    0xed63a231d4c4fb27ULL, 0xb0de65388cc8ada8ULL, 0x83c7088e1aab65dbULL, 0xc45d1df942711d9aULL,
+    0x924d692ca61be758ULL, 0xda01ee641a708deaULL, 0xa26da3999aef774aULL, 0xf209787bb47d6b85ULL,
+    0xb454e4a179dd1877ULL, 0x865b86925b9bc5c2ULL, 0xc83553c5c8965d3dULL, 0x952ab45cfa97a0b3ULL,
+    0xde469fbd99a05fe3ULL, 0xa59bc234db398c25ULL, 0xf6c69a72a3989f5cULL, 0xb7dcbf5354e9beceULL,
+    0x88fcf317f22241e2ULL, 0xcc20ce9bd35c78a5ULL, 0x98165af37b2153dfULL, 0xe2a0b5dc971f303aULL,
+    0xa8d9d1535ce3b396ULL, 0xfb9b7cd9a4a7443cULL, 0xbb764c4ca7a44410ULL, 0x8bab8eefb6409c1aULL,
+    0xd01fef10a657842cULL, 0x9b10a4e5e9913129ULL, 0xe7109bfba19c0c9dULL, 0xac2820d9623bf429ULL,
+    0x80444b5e7aa7cf85ULL, 0xbf21e44003acdd2dULL, 0x8e679c2f5e44ff8fULL, 0xd433179d9c8cb841ULL,
+    0x9e19db92b4e31ba9ULL, 0xeb96bf6ebadf77d9ULL, 0xaf87023b9bf0ee6bULL,
+};
+
+static const short DtoaCachedPowerExponents[] =
+{
+    -1220, -1193, -1166, -1140, -1113, -1087, -1060, -1034, -1007, -980, -954,
+    -927, -901, -874, -847, -821, -794, -768, -741, -715, -688, -661,
+    -635, -608, -582, -555, -529, -502, -475, -449, -422, -396, -369,
+    -343, -316, -289, -263, -236, -210, -183, -157, -130, -103, -77,
+    -50, -24, 3, 30, 56, 83, 109, 136, 162, 189, 216,
+    242, 269, 295, 322, 348, 375, 402, 428, 455, 481, 508,
+    534, 561, 588, 614, 641, 667, 694, 720, 747, 774, 800,
+    827, 853, 880, 907, 933, 960, 986, 1013, 1039, 1066,
+};
+
+// Significand f times 2^e.
+struct DtoaFp
+{
+    UInt64 F;
+    int    E;
+
+    DtoaFp(UInt64 f, int e) : F(f), E(e) { }
+
+    DtoaFp operator-(const DtoaFp& b) const
+    {
+        return DtoaFp(F - b.F, E);
+    }
+
+    // The high 64 bits of the product, rounded.
+    DtoaFp operator*(const DtoaFp& b) const
+    {
+        const UInt64 mask32 = 0xFFFFFFFFu;
+        UInt64 a = F >> 32, c = b.F >> 32;
+        UInt64 l = F & mask32, d = b.F & mask32;
+        UInt64 ac = a * c, ad = a * d, lc = l * c, ld = l * d;
+        UInt64 mid = (ld >> 32) + (ad & mask32) + (lc & mask32) + (UInt64(1) << 31);
+        return DtoaFp(ac + (ad >> 32) + (lc >> 32) + (mid >> 32), E + b.E + 64);
+    }
+
+    DtoaFp Normalize() const
+    {
+        DtoaFp r = *this;
+        while (!(r.F & (UInt64(1) << 63)))
+        {
+            r.F <<= 1;
+            r.E--;
+        }
+        return r;
+    }
+};
+
+static unsigned dtoaDigitCount(UInt32 n)
+{
+    unsigned count = 1;
+    while (n >= 10 && count < 10)
+    {
+        n /= 10;
+        count++;
+    }
+    return count;
+}
+
+// Moves the last digit down while that brings it nearer the value and stays in
+// the interval.
+static void dtoaRound(char* buffer, int length, UInt64 delta, UInt64 rest, UInt64 tenKappa, UInt64 distance)
+{
+    while (rest < distance && delta - rest >= tenKappa &&
+           (rest + tenKappa < distance || distance - rest > rest + tenKappa - distance))
+    {
+        buffer[length - 1]--;
+        rest += tenKappa;
+    }
+}
+
+// Writes the digits of positive finite value to buffer, at least 20 chars, as
+// value = digits * 10^exponent; returns their count.
+static int dtoaGrisu2(double value, char* buffer, int* exponent)
+{
+    static const UInt64 powersOfTen[] =
+    {
+        1ULL, 10ULL, 100ULL, 1000ULL, 10000ULL, 100000ULL, 1000000ULL, 10000000ULL,
+        100000000ULL, 1000000000ULL, 10000000000ULL, 100000000000ULL, 1000000000000ULL,
+        10000000000000ULL, 100000000000000ULL, 1000000000000000ULL, 10000000000000000ULL,
+        100000000000000000ULL, 1000000000000000000ULL, 10000000000000000000ULL
+    };
+
+    union { double D; UInt64 U; } bits;
+    bits.D = value;
+    const UInt64 hiddenBit = UInt64(1) << 52;
+    int          biased    = (int)((bits.U >> 52) & 0x7FF);
+    UInt64       fraction  = bits.U & (hiddenBit - 1);
+    DtoaFp       v         = biased ? DtoaFp(fraction + hiddenBit, biased - 1075) : DtoaFp(fraction, -1074);
+
+    // Halfway points to the neighbors; the lower one is nearer at powers of two.
+    DtoaFp plus  = DtoaFp((v.F << 1) + 1, v.E - 1).Normalize();
+    DtoaFp minus = (v.F == hiddenBit && biased > 1) ? DtoaFp((v.F << 2) - 1, v.E - 2)
+                                                    : DtoaFp((v.F << 1) - 1, v.E - 1);
+    minus.F <<= minus.E - plus.E;
+    minus.E   = plus.E;
+
+    // A power of ten c = 10^-k bringing the exponent of plus * c into [-60, -32].
+    double dk    = (-61 - plus.E) * 0.30102999566398114 + 347;
+    int    k     = (int)dk;
+    if (dk - k > 0.0)
+        k++;
+    unsigned index = (unsigned)((k >> 3) + 1);
+    int      decimalExponent = 348 - (int)(index << 3);
+    DtoaFp   cached(DtoaCachedPowerSignificands[index], DtoaCachedPowerExponents[index]);
+
+    DtoaFp w  = v.Normalize() * cached;
+    DtoaFp wp = plus * cached;
+    DtoaFp wm = minus * cached;
+    // The products are within an ulp; keep inside the interval.
+    wm.F++;
+    wp.F--;
+
+    UInt64 delta    = wp.F - wm.F;
+    UInt64 distance = (wp - w).F;
+    int    shift    = -wp.E;
+    UInt64 one      = UInt64(1) << shift;
+    UInt32 p1       = (UInt32)(wp.F >> shift);
+    UInt64 p2       = wp.F & (one - 1);
+    int    kappa    = (int)dtoaDigitCount(p1);
+    int    length   = 0;
+
+    while (kappa > 0)
+    {
+        UInt32 divisor = (UInt32)powersOfTen[kappa - 1];
+        UInt32 d       = p1 / divisor;
+        p1 %= divisor;
+        if (d || length)
+            buffer[length++] = (char)('0' + d);
+        kappa--;
+
+        UInt64 rest = ((UInt64)p1 << shift) + p2;
+        if (rest <= delta)
+        {
+            *exponent = decimalExponent + kappa;
+            dtoaRound(buffer, length, delta, rest, powersOfTen[kappa] << shift, distance);
+            return length;
+        }
+    }
+
+    for (;;)
+    {
+        p2    *= 10;
+        delta *= 10;
+        char d = (char)(p2 >> shift);
+        if (d || length)
+            buffer[length++] = (char)('0' + d);
+        p2 &= one - 1;
+        kappa--;
+
+        if (p2 < delta)
+        {
+            *exponent = decimalExponent + kappa;
+            dtoaRound(buffer, length, delta, p2, one,
+                      (-kappa < 20) ? distance * powersOfTen[-kappa] : 0);
+            return length;
+        }
+    }
+}
+
+UPInt OVR_CDECL OVR_dtoa(double value, char* dest, UPInt destsize)
+{
+    char  buffer[OVR_DtoaBufferSize];
+    char* p = buffer;
+
+    if (value != value)
+    {
+        OVR_strcpy(buffer, sizeof(buffer), "nan");
+        p += 3;
+    }
+    else
+    {
+        union { double D; UInt64 U; } bits;
+        bits.D = value;
+        if (bits.U >> 63)
+        {
+            *p++  = '-';
+            value = -value;
+        }
+
+        if (value == 0.0)
+        {
+            *p++ = '0';
+        }
+        else if (value > 1.7976931348623157e308)
+        {
+            memcpy(p, "inf", 3);
+            p += 3;
+        }
+        else if (value < 9007199254740992.0 && value == (double)(UInt64)value)
+        {
+            // Integers are exact, and the digits of their own.
+            char   digits[16];
+            int    count = 0;
+            UInt64 n     = (UInt64)value;
+            for (; n; n /= 10)
+                digits[count++] = (char)('0' + n % 10);
+            while (count)
+                *p++ = digits[--count];
+        }
+        else
+        {
+            char digits[20];
+            int  exponent;
+            int  count = dtoaGrisu2(value, digits, &exponent);
+            // Position of the decimal point: 10^(point-1) <= value < 10^point.
+            int  point = count + exponent;
+
+            if (count <= point && point <= 21)
+            {
+                memcpy(p, digits, count);
+                p += count;
+                for (int i = count; i < point; i++)
+                    *p++ = '0';
+            }
+            else if (0 < point && point <= 21)
+            {
+                memcpy(p, digits, point);
+                p += point;
+                *p++ = '.';
+                memcpy(p, digits + point, count - point);
+                p += count - point;
+            }
+            else if (-6 < point && point <= 0)
+            {
+                *p++ = '0';
+                *p++ = '.';
+                for (int i = point; i < 0; i++)
+                    *p++ = '0';
+                memcpy(p, digits, count);
+                p += count;
+            }
+            else
+            {
+                *p++ = digits[0];
+                if (count > 1)
+                {
+                    *p++ = '.';
+                    memcpy(p, digits + 1, count - 1);
+                    p += count - 1;
+                }
+                int e = point - 1;
+                *p++ = 'e';
+                *p++ = (e < 0) ? '-' : '+';
+                if (e < 0)
+                    e = -e;
+                if (e >= 100)
+                    *p++ = (char)('0' + e / 100);
+                if (e >= 10)
+                    *p++ = (char)('0' + e / 10 % 10);
+                *p++ = (char)('0' + e % 10);
+            }
+        }
+    }
+
+    UPInt length = (UPInt)(p - buffer);
+    if (!destsize)
+        return length;
+    if (length >= destsize)
+        length = destsize - 1;
+    memcpy(dest, buffer, length);
+    dest[length] = 0;
+    return length;
+}
+
 
 #ifndef OVR_NO_WCTYPE
 
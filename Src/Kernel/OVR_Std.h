@@ -222,17 +222,21 @@ inline char* OVR_CDECL OVR_strrchr(char* str, char c)
 }
 
 
+// Reads '.' as the decimal point whatever the locale; the common case of up to 15
+// significant digits and small exponents doesn't go through the C runtime.
 double OVR_CDECL OVR_strtod(const char* string, char** tailptr);
 
-inline long OVR_CDECL OVR_strtol(const char* string, char** tailptr, int radix)
-{
-    return strtol(string, tailptr, radix);
-}
-
-inline long OVR_CDECL OVR_strtoul(const char* string, char** tailptr, int radix)
-{
-    return strtoul(string, tailptr, radix);
-}
+// Writes the shortest text that OVR_strtod reads back as value, with '.' whatever
+// the locale and in JavaScript's notation: "0.1", "-12", "5e-7", "1.5e+300".
+// Infinities and NaN are written "inf", "-inf" and "nan". Returns the length of
+// the text, which is cut to fit destsize; OVR_DtoaBufferSize chars always hold it.
+enum { OVR_DtoaBufferSize = 32 };
+UPInt OVR_CDECL OVR_dtoa(double value, char* dest, UPInt destsize);
+
+// Decimal numbers of up to 9 digits are read without the C runtime, which handles
+// other radixes, longer numbers and their overflow.
+long OVR_CDECL OVR_strtol(const char* string, char** tailptr, int radix);
+long OVR_CDECL OVR_strtoul(const char* string, char** tailptr, int radix);
 
 inline int OVR_CDECL OVR_strncmp(const char* ws1, const char* ws2, UPInt size)
 {
@@ -86,6 +86,15 @@ String::String(const String& src)
     pData->AddRef();
 }
 
+#ifdef OVR_CPP_RVALUE_REFERENCES
+String::String(String&& src)
+{
+    pData = src.GetData();
+    src.SetData(&NullData);
+    NullData.AddRef();
+}
+#endif
+
 String::String(const StringBuffer& src)
 {
     pData = AllocDataCopy1(src.GetSize(), 0, src.ToCStr(), src.GetSize());
@@ -305,6 +314,17 @@ void    String::operator = (const String& src)
 }
 
 
+#ifdef OVR_CPP_RVALUE_REFERENCES
+void    String::operator = (String&& src)
+{
+    // Swap buffers without touching reference counts; src releases
+    // our old data when it is destroyed.
+    DataDesc*    psdata = src.GetData();
+    src.SetData(GetData());
+    SetData(psdata);
+}
+#endif
+
 void    String::operator = (const StringBuffer& src)
 { 
     DataDesc* polddata = GetData();    
@@ -549,6 +569,101 @@ UPInt String::BernsteinHashFunctionCIS(const void* pdataIn, UPInt size, UPInt se
 }
 
 
+// Fast hash: one xxHash64 lane over 8 byte words, the last word zero padded.
+// Words are read in native byte order, so values differ between platforms.
+
+static const UInt64 FastHash_Prime1 = 0x9E3779B185EBCA87;
+static const UInt64 FastHash_Prime2 = 0xC2B2AE3D27D4EB4F;
+static const UInt64 FastHash_Prime3 = 0x165667B19E3779F9;
+static const UInt64 FastHash_Prime4 = 0x85EBCA77C2B2AE63;
+static const UInt64 FastHash_Prime5 = 0x27D4EB2F165667C5;
+
+static inline UInt64 FastHash_Rotl(UInt64 x, int r)
+{
+    return (x << r) | (x >> (64 - r));
+}
+
+static inline UInt64 FastHash_Step(UInt64 h, UInt64 word)
+{
+    word *= FastHash_Prime2;
+    word  = FastHash_Rotl(word, 31) * FastHash_Prime1;
+    h    ^= word;
+    return FastHash_Rotl(h, 27) * FastHash_Prime1 + FastHash_Prime4;
+}
+
+static inline UInt64 FastHash_Final(UInt64 h)
+{
+    h ^= h >> 33;
+    h *= FastHash_Prime2;
+    h ^= h >> 29;
+    h *= FastHash_Prime3;
+    h ^= h >> 32;
+    return h;
+}
+
+// Lowers the ASCII letters in each byte of the word.
+static inline UInt64 FastHash_ToLower(UInt64 word)
+{
+    const UInt64 ones  = 0x0101010101010101;
+    const UInt64 highs = 0x8080808080808080;
+    UInt64 low7     = word & ~highs;
+    UInt64 atLeastA = low7 + ones * (0x80 - 'A');
+    UInt64 aboveZ   = low7 + ones * (0x80 - 'Z' - 1);
+    UInt64 upper    = atLeastA & ~aboveZ & ~word & highs;
+    return word | (upper >> 2);
+}
+
+template<bool NoCase>
+static inline UPInt FastHash_Compute(const void* pdataIn, UPInt size, UPInt seed)
+{
+    const UByte* pdata = (const UByte*)pdataIn;
+    UInt64       h     = (UInt64)seed + FastHash_Prime5 + (UInt64)size;
+    UInt64       word;
+
+    for (; size >= 8; size -= 8, pdata += 8)
+    {
+        memcpy(&word, pdata, 8);
+        h = FastHash_Step(h, NoCase ? FastHash_ToLower(word) : word);
+    }
+    if (size > 0)
+    {
+        // Assemble the tail without a variable length memcpy.
+        int shift = 0;
+        word = 0;
+        if (size & 4)
+        {
+            UInt32 v;
+            memcpy(&v, pdata, 4);
+            word   = v;
+            shift  = 32;
+            pdata += 4;
+        }
+        if (size & 2)
+        {
+            UInt16 v;
+            memcpy(&v, pdata, 2);
+            word  |= (UInt64)v << shift;
+            shift += 16;
+            pdata += 2;
+        }
+        if (size & 1)
+            word |= (UInt64)*pdata << shift;
+        h = FastHash_Step(h, NoCase ? FastHash_ToLower(word) : word);
+    }
+    return (UPInt)FastHash_Final(h);
+}
+
+UPInt String::FastHashFunction(const void* pdataIn, UPInt size, UPInt seed)
+{
+    return FastHash_Compute<false>(pdataIn, size, seed);
+}
+
+UPInt String::FastHashFunctionCIS(const void* pdataIn, UPInt size, UPInt seed)
+{
+    return FastHash_Compute<true>(pdataIn, size, seed);
+}
+
+
 
 // ***** String Buffer used for Building Strings
 
@@ -556,49 +671,56 @@ UPInt String::BernsteinHashFunctionCIS(const void* pdataIn, UPInt size, UPInt se
 #define OVR_SBUFF_DEFAULT_GROW_SIZE 512
 // Constructors / Destructor.
 StringBuffer::StringBuffer()
-    : pData(NULL), Size(0), BufferSize(0), GrowSize(OVR_SBUFF_DEFAULT_GROW_SIZE), LengthIsSize(false)
+    : pData(NULL), Size(0), BufferSize(0), GrowSize(OVR_SBUFF_DEFAULT_GROW_SIZE), LengthIsSize(false), DataIsInline(false)
 {
 }
 
 StringBuffer::StringBuffer(UPInt growSize)
-    : pData(NULL), Size(0), BufferSize(0), GrowSize(OVR_SBUFF_DEFAULT_GROW_SIZE), LengthIsSize(false)
+    : pData(NULL), Size(0), BufferSize(0), GrowSize(OVR_SBUFF_DEFAULT_GROW_SIZE), LengthIsSize(false), DataIsInline(false)
 {
     SetGrowSize(growSize);
 }
 
 StringBuffer::StringBuffer(const char* data)
-    : pData(NULL), Size(0), BufferSize(0), GrowSize(OVR_SBUFF_DEFAULT_GROW_SIZE), LengthIsSize(false)
+    : pData(NULL), Size(0), BufferSize(0), GrowSize(OVR_SBUFF_DEFAULT_GROW_SIZE), LengthIsSize(false), DataIsInline(false)
 {
     AppendString(data);
 }
 
 StringBuffer::StringBuffer(const char* data, UPInt dataSize)
-    : pData(NULL), Size(0), BufferSize(0), GrowSize(OVR_SBUFF_DEFAULT_GROW_SIZE), LengthIsSize(false)
+    : pData(NULL), Size(0), BufferSize(0), GrowSize(OVR_SBUFF_DEFAULT_GROW_SIZE), LengthIsSize(false), DataIsInline(false)
 {
     AppendString(data, dataSize);
 }
 
 StringBuffer::StringBuffer(const String& src)
-    : pData(NULL), Size(0), BufferSize(0), GrowSize(OVR_SBUFF_DEFAULT_GROW_SIZE), LengthIsSize(false)
+    : pData(NULL), Size(0), BufferSize(0), GrowSize(OVR_SBUFF_DEFAULT_GROW_SIZE), LengthIsSize(false), DataIsInline(false)
 {
     AppendString(src.ToCStr(), src.GetSize());
 }
 
 StringBuffer::StringBuffer(const StringBuffer& src)
-    : pData(NULL), Size(0), BufferSize(0), GrowSize(OVR_SBUFF_DEFAULT_GROW_SIZE), LengthIsSize(false)
+    : pData(NULL), Size(0), BufferSize(0), GrowSize(OVR_SBUFF_DEFAULT_GROW_SIZE), LengthIsSize(false), DataIsInline(false)
 {
     AppendString(src.ToCStr(), src.GetSize());
 }
 
 StringBuffer::StringBuffer(const wchar_t* data)
-    : pData(NULL), Size(0), BufferSize(0), GrowSize(OVR_SBUFF_DEFAULT_GROW_SIZE), LengthIsSize(false)
+    : pData(NULL), Size(0), BufferSize(0), GrowSize(OVR_SBUFF_DEFAULT_GROW_SIZE), LengthIsSize(false), DataIsInline(false)
 {
     *this = data;
 }
 
+StringBuffer::StringBuffer(char* inlineBuffer, UPInt inlineSize)
+    : pData(inlineBuffer), Size(0), BufferSize(inlineSize), GrowSize(OVR_SBUFF_DEFAULT_GROW_SIZE),
+      LengthIsSize(false), DataIsInline(true)
+{
+    pData[0] = 0;
+}
+
 StringBuffer::~StringBuffer()
 {
-    if (pData)
+    if (pData && !DataIsInline)
         OVR_FREE(pData);
 }
 void StringBuffer::SetGrowSize(UPInt growSize) 
@@ -631,7 +753,14 @@ void    StringBuffer::Reserve(UPInt _size)
     if (_size >= BufferSize) // >= because of trailing zero! (!AB)
     {
         BufferSize = (_size + 1 + GrowSize - 1)& ~(GrowSize-1);
-        if (!pData)
+        if (DataIsInline)
+        {
+            char* inlineData = pData;
+            pData = (char*)OVR_ALLOC(BufferSize);
+            memcpy(pData, inlineData, Size + 1);
+            DataIsInline = false;
+        }
+        else if (!pData)
             pData = (char*)OVR_ALLOC(BufferSize);
         else 
             pData = (char*)OVR_REALLOC(pData, BufferSize);
@@ -765,4 +894,80 @@ UPInt     StringBuffer::InsertCharAt(UInt32 c, UPInt posAt)
     return (UPInt)len;
 }
 
+
+//-----------------------------------------------------------------------------------
+// ***** Benchmark
+
+#ifdef OVR_STRING_BENCHMARK
+
+} // OVR
+
+#include "OVR_Timer.h"
+#include "OVR_Log.h"
+
+namespace OVR {
+
+void RunStringBenchmark()
+{
+    static const char* keys[] =
+    {
+        "Name", "Gender", "PlayerHeight", "EyeHeight", "IPD", "NeckEyeDistance",
+        "EyeRelief", "EyeReliefDial", "EyeToNeckDistance", "LensSeparation",
+        "DistortionK", "ChromaticAberrationCoefficients", "LastUsedOculusUser",
+        "RiftDK2-WMHD2001000001", "Default"
+    };
+    const int keyCount = sizeof(keys) / sizeof(keys[0]);
+    const int rounds   = 20000;
+
+    String text;
+    for (int i = 0; i < 64; i++)
+        text += keys[i % keyCount];
+
+    UPInt  check = 0;
+    UInt64 start = Timer::GetTicksNanos();
+    for (int r = 0; r < rounds; r++)
+    {
+        // Same loop UTF8Util::GetLength used to run for every byte.
+        const char* p = text.ToCStr();
+        SPInt       n = 0;
+        while (p < text.ToCStr() + text.GetSize())
+        {
+            UTF8Util::DecodeNextChar_Advance0(&p);
+            n++;
+        }
+        check += (UPInt)n;
+    }
+    UInt64 decodeTime = Timer::GetTicksNanos() - start;
+
+    start = Timer::GetTicksNanos();
+    for (int r = 0; r < rounds; r++)
+        check += (UPInt)UTF8Util::GetLength(text.ToCStr(), (SPInt)text.GetSize());
+    UInt64 lengthTime = Timer::GetTicksNanos() - start;
+
+    UPInt sizes[keyCount];
+    for (int i = 0; i < keyCount; i++)
+        sizes[i] = OVR_strlen(keys[i]);
+
+    start = Timer::GetTicksNanos();
+    for (int r = 0; r < rounds; r++)
+        for (int i = 0; i < keyCount; i++)
+            check += String::BernsteinHashFunctionCIS(keys[i], sizes[i]);
+    UInt64 bernsteinTime = Timer::GetTicksNanos() - start;
+
+    start = Timer::GetTicksNanos();
+    for (int r = 0; r < rounds; r++)
+        for (int i = 0; i < keyCount; i++)
+            check += String::FastHashFunctionCIS(keys[i], sizes[i]);
+    UInt64 fastTime = Timer::GetTicksNanos() - start;
+
+    double perByte = 1.0 / ((double)rounds * text.GetSize());
+    double perKey  = 1.0 / ((double)rounds * keyCount);
+    LogText("StringBenchmark: length per-char %.2f ns/byte, scanned %.2f ns/byte; "
+            "no-case hash Bernstein %.1f ns/key, fast %.1f ns/key (check %u)\n",
+            decodeTime * perByte, lengthTime * perByte,
+            bernsteinTime * perKey, fastTime * perKey, (unsigned)check);
+}
+
+#endif // OVR_STRING_BENCHMARK
+
 } // OVR
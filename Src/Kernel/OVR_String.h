@@ -36,6 +36,10 @@ limitations under the License.
 #include "OVR_Std.h"
 #include "OVR_Alg.h"
 
+// Define to build RunStringBenchmark, which times UTF-8 length computation and
+// the Bernstein and fast string hashes.
+//#define OVR_STRING_BENCHMARK
+
 namespace OVR {
 
 // ***** Classes
@@ -162,6 +166,10 @@ public:
     String(const char* data1, const char* pdata2, const char* pdata3 = 0);
     String(const char* data, UPInt buflen);
     String(const String& src);
+#ifdef OVR_CPP_RVALUE_REFERENCES
+    // Takes over the buffer of src, leaving it empty.
+    String(String&& src);
+#endif
     String(const StringBuffer& src);
     String(const InitStruct& src, UPInt size);
     explicit String(const wchar_t* data);      
@@ -249,6 +257,12 @@ public:
     // Hash function, case-sensitive
     static UPInt OVR_STDCALL BernsteinHashFunction(const void* pdataIn, UPInt size, UPInt seed = 5381);
 
+    // Faster hash functions in the style of xxHash, consuming 8 bytes per step.
+    // The case-insensitive version lowers ASCII letters only, like OVR_tolower,
+    // and gives the same value as FastHashFunction of the lowered string.
+    static UPInt OVR_STDCALL FastHashFunction(const void* pdataIn, UPInt size, UPInt seed = 0);
+    static UPInt OVR_STDCALL FastHashFunctionCIS(const void* pdataIn, UPInt size, UPInt seed = 0);
+
 
     // ***** File path parsing helper functions.
     // Implemented in OVR_String_FilePath.cpp.
@@ -281,6 +295,9 @@ public:
     void        operator =  (const wchar_t* str);
     void        operator =  (const String& src);
     void        operator =  (const StringBuffer& src);
+#ifdef OVR_CPP_RVALUE_REFERENCES
+    void        operator =  (String&& src);
+#endif
 
     // Addition
     void        operator += (const String& src);
@@ -395,6 +412,32 @@ public:
         }
     };
 
+    // Versions of the above built on the fast hash functions.
+    struct FastHashFunctor
+    {    
+        UPInt  operator()(const String& data) const
+        {
+            return String::FastHashFunction((const char*)data, data.GetSize());
+        }        
+        // Lets a hash keyed by String be searched by C string through GetAlt,
+        // without constructing a String for the key.
+        UPInt  operator()(const char* data) const
+        {
+            return String::FastHashFunction(data, OVR_strlen(data));
+        }
+    };
+    struct FastNoCaseHashFunctor
+    {    
+        UPInt  operator()(const String& data) const
+        {
+            return String::FastHashFunctionCIS((const char*)data, data.GetSize());
+        }
+        UPInt  operator()(const NoCaseKey& data) const
+        {       
+            return String::FastHashFunctionCIS(data.pStr->ToCStr(), data.pStr->GetSize());
+        }
+    };
+
 };
 
 
@@ -408,6 +451,12 @@ class StringBuffer
     UPInt           BufferSize;
     UPInt           GrowSize;    
     mutable bool    LengthIsSize;    
+    // pData is a buffer of StringBufferInline until it grows past it.
+    bool            DataIsInline;
+
+protected:
+    // Starts in inlineBuffer, of inlineSize chars, which is never freed.
+    StringBuffer(char* inlineBuffer, UPInt inlineSize);
 
 public:
 
@@ -460,6 +509,7 @@ public:
     // Append a string
     void        AppendString(const wchar_t* pstr, SPInt len = -1);
     void        AppendString(const char* putf8str, SPInt utf8StrSz = -1);
+    // Formats into the spare capacity, growing only if the text doesn't fit.
     void        AppendFormat(const char* format, ...);
 
     // Assigned a string with dynamic data (copied through initializer).
@@ -509,6 +559,29 @@ public:
 };
 
 
+// StringBuffer holding up to N - 1 chars in a buffer of its own, so that building
+// a short string, such as a log line on the stack, doesn't allocate. Longer
+// strings move to the heap as StringBuffer's grow.
+template<UPInt N>
+class StringBufferInline : public StringBuffer
+{
+    char InlineBuffer[N];
+
+public:
+    StringBufferInline() : StringBuffer(InlineBuffer, N) { }
+    StringBufferInline(const char* data) : StringBuffer(InlineBuffer, N)
+    { AppendString(data); }
+    StringBufferInline(const StringBuffer& src) : StringBuffer(InlineBuffer, N)
+    { AppendString(src.ToCStr(), src.GetSize()); }
+    StringBufferInline(const StringBufferInline& src) : StringBuffer(InlineBuffer, N)
+    { AppendString(src.ToCStr(), src.GetSize()); }
+
+    using StringBuffer::operator =;
+    // Only the text is copied; the implicit copy would also copy InlineBuffer.
+    void operator = (const StringBufferInline& src) { StringBuffer::operator = (src); }
+};
+
+
 //
 // Wrapper for string data. The data must have a guaranteed 
 // lifespan throughout the usage of the wrapper. Not intended for 
@@ -652,6 +725,13 @@ protected:
     UPInt       Size;
 };
 
+
+#ifdef OVR_STRING_BENCHMARK
+// Logs the time taken to measure and hash a set of profile-like keys. Call after
+// System::Init.
+void RunStringBenchmark();
+#endif
+
 } // OVR
 
 #endif
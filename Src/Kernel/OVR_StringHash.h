@@ -40,14 +40,16 @@ namespace OVR {
 // This is a custom string hash table that supports case-insensitive
 // searches through special functions such as GetCaseInsensitive, etc.
 // This class is used for Flash labels, exports and other case-insensitive tables.
+// HashF must be case-insensitive; String::FastNoCaseHashFunctor can be given
+// for a faster hash than the default.
 
-template<class U, class Allocator = ContainerAllocator<U> >
-class StringHash : public Hash<String, U, String::NoCaseHashFunctor, Allocator>
+template<class U, class Allocator = ContainerAllocator<U>, class HashF = String::NoCaseHashFunctor>
+class StringHash : public Hash<String, U, HashF, Allocator>
 {
 public:
     typedef U                                                        ValueType;
-    typedef StringHash<U, Allocator>                                 SelfType;
-    typedef Hash<String, U, String::NoCaseHashFunctor, Allocator>    BaseType;
+    typedef StringHash<U, Allocator, HashF>                          SelfType;
+    typedef Hash<String, U, HashF, Allocator>                        BaseType;
 
 public:    
 
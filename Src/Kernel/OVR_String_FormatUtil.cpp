@@ -29,25 +29,49 @@ limitations under the License.
 
 namespace OVR {
 
+// Formats into dest, of space chars, and returns the size of the whole text
+// as C99 vsnprintf does; the text was cut if that is space or more.
+static UPInt formatTo(char* dest, UPInt space, const char* format, va_list argList)
+{
+#if defined(OVR_CC_MSVC)
+    // _vsnprintf returns -1 for text that doesn't fit, without its size. MSVC's
+    // va_list is a pointer, which the first call leaves for the second.
+    int result = space ? _vsnprintf(dest, space, format, argList) : -1;
+    if (result < 0)
+        result = _vscprintf(format, argList);
+#else
+    int result = vsnprintf(dest, space, format, argList);
+#endif
+    // Nothing is appended for a format that fails.
+    return (result < 0) ? 0 : (UPInt)result;
+}
+
 void StringBuffer::AppendFormat(const char* format, ...)
 {       
     va_list argList;
+    UPInt   origSize = GetSize();
+    UPInt   space    = pData ? (BufferSize - origSize) : 0;
 
+    // The format is only parsed again when the text didn't fit.
     va_start(argList, format);
-    UPInt size = OVR_vscprintf(format, argList);
+    UPInt size = formatTo(pData ? pData + origSize : 0, space, format, argList);
     va_end(argList);
 
-    char* buffer = (char*) OVR_ALLOC(sizeof(char) * (size+1));
-
-    va_start(argList, format);
-    UPInt result = OVR_vsprintf(buffer, size+1, format, argList);
-    OVR_UNUSED1(result);
-    va_end(argList);
-    OVR_ASSERT_LOG(result == size, ("Error in OVR_vsprintf"));
-
-    AppendString(buffer);
-
-    OVR_FREE(buffer);
+    if (size >= space)
+    {
+        Reserve(origSize + size);
+
+        va_start(argList, format);
+        UPInt result = formatTo(pData + origSize, BufferSize - origSize, format, argList);
+        OVR_UNUSED1(result);
+        va_end(argList);
+        OVR_ASSERT_LOG(result == size, ("Error in OVR_vsprintf"));
+    }
+
+    Size         = origSize + size;
+    LengthIsSize = false;
+    if (pData)
+        pData[Size] = 0;
 }
 
 } // OVR
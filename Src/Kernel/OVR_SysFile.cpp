@@ -31,6 +31,7 @@ limitations under the License.
 #include <stdio.h>
 
 #include "OVR_SysFile.h"
+#include "OVR_WriteBehindFile.h"
 #include "OVR_Log.h"
 
 namespace OVR {
@@ -105,6 +106,11 @@ bool SysFile::Open(const String& path, int flags, int mode)
         return 0;
     }
     //pFile = *OVR_NEW DelegatedFile(pFile); // MA Testing
+#ifdef OVR_ENABLE_THREADS
+    // Under the buffer, so that the queue receives whole buffers of small writes
+    if ((flags & Open_WriteBehind) && (flags & Open_Write))
+        pFile = *new WriteBehindFile(pFile);
+#endif
     if (flags & Open_Buffered)
         pFile = *new BufferedFile(pFile);
     return 1;
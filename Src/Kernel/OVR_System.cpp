@@ -48,16 +48,38 @@ void System::Init(Log* log, Allocator *palloc)
     }
 }
 
+void System::SetSubsystemAllocator(AllocSubsystem subsystem, Allocator* palloc)
+{
+    OVR_ASSERT(Allocator::GetInstance());
+    Allocator::setSubsystemInstance(subsystem, palloc);
+}
+
 void System::Destroy()
 {    
     if (Allocator::GetInstance())
     {
+        // Let the log stop any threads it owns before we wait for them.
+        if (Log* log = Log::GetGlobalLog())
+            log->OnSystemShutdown();
+
         // Wait for all threads to finish; this must be done so that memory
         // allocator and all destructors finalize correctly.
 #ifdef OVR_ENABLE_THREADS
         Thread::FinishAllThreads();
 #endif
 
+        // Subsystem allocators may be backed by the global one, so release them first.
+        for (int i = AllocSubsystem_General + 1; i < AllocSubsystem_Count; i++)
+        {
+            AllocSubsystem subsystem = (AllocSubsystem)i;
+            Allocator*     palloc    = Allocator::GetInstance(subsystem);
+            if (palloc != Allocator::GetInstance())
+            {
+                palloc->onSystemShutdown();
+                Allocator::setSubsystemInstance(subsystem, 0);
+            }
+        }
+
         // Shutdown heap and destroy SysAlloc singleton, if any.
         Allocator::GetInstance()->onSystemShutdown();
         Allocator::setInstance(0);
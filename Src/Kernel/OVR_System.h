@@ -68,6 +68,12 @@ public:
     static void OVR_CDECL Init(Log* log = Log::ConfigureDefaultLog(LogMask_Debug),
                                Allocator *palloc = DefaultAllocator::InitSystemSingleton());
 
+    // Installs an allocator for one subsystem, such as a LinearAllocator for scratch
+    // buffers; pass 0 to return the subsystem to the global allocator. Must be called
+    // after Init and while the subsystem has no live allocations. Installed allocators
+    // are released (onSystemShutdown) and detached by Destroy.
+    static void OVR_CDECL SetSubsystemAllocator(AllocSubsystem subsystem, Allocator* palloc);
+
     // De-initializes System more, finalizing the threading system and destroying
     // the global memory allocator.
     static void OVR_CDECL Destroy();    
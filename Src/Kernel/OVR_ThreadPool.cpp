@@ -0,0 +1,386 @@
+/************************************************************************************
+
+Filename    :   OVR_ThreadPool.cpp
+Content     :   Work-stealing thread pool with task groups and ParallelFor.
+Created     :   October 14, 2026
+Notes       :
+
+Copyright   :   Copyright 2014 Oculus VR, Inc. All Rights reserved.
+
+Licensed under the Oculus VR Rift SDK License Version 3.1 (the "License");
+you may not use the Oculus VR Rift SDK except in compliance with the License,
+which is provided at the time of installation or download, or which
+otherwise accompanies this software in either electronic or hard copy form.
+
+You may obtain a copy of the License at
+
+http://www.oculusvr.com/licenses/LICENSE-3.1
+
+Unless required by applicable law or agreed to in writing, the Oculus VR SDK
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+************************************************************************************/
+
+#include "OVR_ThreadPool.h"
+
+#ifdef OVR_ENABLE_THREADS
+
+namespace OVR {
+
+
+//-----------------------------------------------------------------------------------
+// ***** ThreadPoolWorker
+
+// Worker thread and the deque of tasks it owns. The deque is a bounded Chase-Lev
+// deque: only the owner moves Bottom (Push, Pop), while any thread may take the
+// task at Top (Steal), racing for it with a compare-and-set on Top.
+
+class ThreadPoolWorker : public Thread
+{
+public:
+    typedef ThreadPool::Task Task;
+
+    ThreadPoolWorker(ThreadPool* pool, int processor)
+      : Thread(128 * 1024, processor), pPool(pool), WorkerThreadId(0)
+    {
+        Top    = 0;
+        Bottom = 0;
+    }
+
+    virtual int Run()
+    {
+        SetThreadName("OVR::ThreadPool");
+        WorkerThreadId = GetCurrentThreadId();
+
+        Task task;
+        for (;;)
+        {
+            if (pPool->findTask(this, &task))
+                ThreadPool::runTask(task);
+            else if (pPool->Stopping)
+                break;
+            else
+                pPool->waitForWork();
+        }
+        return 0;
+    }
+
+    // Owner only; returns false if the deque is full.
+    bool Push(const Task& task)
+    {
+        SInt32 b = Bottom.Load_Relaxed();
+        SInt32 t = Top.Load_Acquire();
+        if (b - t >= ThreadPool::WorkerQueueCapacity)
+            return false;
+
+        Tasks[b & Mask] = task;
+        Bottom.Store_Release(b + 1);
+        return true;
+    }
+
+    // Owner only; takes the most recently pushed task.
+    bool Pop(Task* task)
+    {
+        SInt32 b = Bottom.Load_Relaxed() - 1;
+        // Reserve the bottom task before looking at Top; the store must be
+        // visible to thieves before Top is read.
+        Bottom.Store_Relaxed(b);
+        AtomicFence_Full();
+        SInt32 t = Top.Load_Relaxed();
+
+        if (t > b)
+        {
+            // Deque was empty.
+            Bottom.Store_Relaxed(b + 1);
+            return false;
+        }
+
+        *task = Tasks[b & Mask];
+        if (t == b)
+        {
+            // Last task; race thieves for it.
+            bool won = Top.CompareAndSet_Sync(t, t + 1);
+            Bottom.Store_Relaxed(b + 1);
+            return won;
+        }
+        return true;
+    }
+
+    // Any thread; takes the oldest task.
+    bool Steal(Task* task)
+    {
+        SInt32 t = Top.Load_Acquire();
+        AtomicFence_Full();
+        SInt32 b = Bottom.Load_Acquire();
+        if (t >= b)
+            return false;
+
+        // Read before claiming; the slot can't be reused until Top moves past it.
+        *task = Tasks[t & Mask];
+        return Top.CompareAndSet_Sync(t, t + 1);
+    }
+
+    ThreadId GetWorkerThreadId() const { return WorkerThreadId; }
+
+private:
+    enum { Mask = ThreadPool::WorkerQueueCapacity - 1 };
+
+    ThreadPool*         pPool;
+    volatile ThreadId   WorkerThreadId;
+
+    // Top is written by thieves and Bottom by the owner; keep them on separate lines.
+    AtomicInt<SInt32>   Top;
+    char                PadTop[OVR_CACHE_LINE_SIZE];
+    AtomicInt<SInt32>   Bottom;
+    char                PadBottom[OVR_CACHE_LINE_SIZE];
+    Task                Tasks[ThreadPool::WorkerQueueCapacity];
+};
+
+
+//-----------------------------------------------------------------------------------
+// ***** TaskGroup
+
+void TaskGroup::Run(TaskFunction fn, void* data)
+{
+    pPool->Submit(fn, data, this);
+}
+
+void TaskGroup::Wait()
+{
+    while (Pending.Load_Acquire() != 0)
+    {
+        // Help with queued work; the tasks left may be running on other threads.
+        if (!pPool->RunPendingTask())
+            Thread::MSleep(0);
+    }
+}
+
+
+//-----------------------------------------------------------------------------------
+// ***** ThreadPool
+
+ThreadPool::ThreadPool(int workerCount, int firstProcessor)
+  : StartedCount(0), InjectedHead(0), Stopping(false)
+{
+    OVR_COMPILER_ASSERT((WorkerQueueCapacity & (WorkerQueueCapacity - 1)) == 0);
+
+    QueuedCount   = 0;
+    SleepingCount = 0;
+
+    int cpuCount = Thread::GetCPUCount();
+    if (workerCount < 0)
+        workerCount = cpuCount - 1;
+
+    // Workers look each other up in Workers, so it must not change once they run.
+    for (int i = 0; i < workerCount; i++)
+    {
+        int processor = (firstProcessor >= 0) ? (firstProcessor + i) % cpuCount : -1;
+        Workers.PushBack(*new ThreadPoolWorker(this, processor));
+    }
+    while (StartedCount < workerCount && Workers[StartedCount]->Start())
+        StartedCount++;
+}
+
+ThreadPool::~ThreadPool()
+{
+    {
+        Mutex::Locker lock(&SleepMutex);
+        Stopping = true;
+        SleepCondition.NotifyAll();
+    }
+
+    // Workers run everything queued before they exit.
+    for (int i = 0; i < StartedCount; i++)
+    {
+        while (!Workers[i]->IsFinished())
+            Thread::MSleep(1);
+    }
+    StartedCount = 0;
+    Workers.Clear();
+
+    while (RunPendingTask())
+        { }
+}
+
+
+void ThreadPool::Submit(TaskFunction fn, void* data, TaskGroup* group)
+{
+    Task task;
+    task.Function = fn;
+    task.Data     = data;
+    task.pGroup   = group;
+
+    if (group)
+        group->Pending.ExchangeAdd_NoSync(1);
+
+    ThreadPoolWorker* self = getCurrentWorker();
+    if (!self || !self->Push(task))
+    {
+        Lock::Locker lock(&InjectedLock);
+        Injected.PushBack(task);
+    }
+
+    // Pairs with waitForWork: either the sleeping worker sees the new count,
+    // or we see it sleeping and wake it.
+    QueuedCount.ExchangeAdd_Sync(1);
+    if (SleepingCount.ExchangeAdd_Sync(0) > 0)
+        wakeWorker();
+}
+
+bool ThreadPool::RunPendingTask()
+{
+    Task task;
+    if (!findTask(getCurrentWorker(), &task))
+        return false;
+    runTask(task);
+    return true;
+}
+
+
+void ThreadPool::runTask(const Task& task)
+{
+    task.Function(task.Data);
+    if (task.pGroup)
+        task.pGroup->Pending.ExchangeAdd_Sync(-1);
+}
+
+ThreadPoolWorker* ThreadPool::getCurrentWorker() const
+{
+    ThreadId id = GetCurrentThreadId();
+    for (int i = 0; i < StartedCount; i++)
+    {
+        if (Workers[i]->GetWorkerThreadId() == id)
+            return Workers[i];
+    }
+    return 0;
+}
+
+bool ThreadPool::findTask(ThreadPoolWorker* self, Task* task)
+{
+    if (QueuedCount.Load_Acquire() <= 0)
+        return false;
+
+    bool found = (self && self->Pop(task)) || popInjected(task);
+
+    // Steal starting after our own index so that thieves spread out.
+    int count = StartedCount;
+    int start = 0;
+    for (int i = 0; self && i < count; i++)
+    {
+        if (Workers[i] == self)
+            start = i + 1;
+    }
+    for (int i = 0; !found && i < count; i++)
+    {
+        ThreadPoolWorker* victim = Workers[(start + i) % count];
+        if (victim != self)
+            found = victim->Steal(task);
+    }
+
+    if (found)
+        QueuedCount.ExchangeAdd_NoSync(-1);
+    return found;
+}
+
+bool ThreadPool::popInjected(Task* task)
+{
+    Lock::Locker lock(&InjectedLock);
+    if (InjectedHead >= Injected.GetSize())
+        return false;
+
+    *task = Injected[InjectedHead++];
+    if (InjectedHead == Injected.GetSize())
+    {
+        Injected.Clear();
+        InjectedHead = 0;
+    }
+    return true;
+}
+
+void ThreadPool::wakeWorker()
+{
+    Mutex::Locker lock(&SleepMutex);
+    SleepCondition.Notify();
+}
+
+void ThreadPool::waitForWork()
+{
+    Mutex::Locker lock(&SleepMutex);
+    SleepingCount.ExchangeAdd_Sync(1);
+    if (QueuedCount.ExchangeAdd_Sync(0) <= 0 && !Stopping)
+        SleepCondition.Wait(&SleepMutex);
+    SleepingCount.ExchangeAdd_Sync(-1);
+}
+
+
+//-----------------------------------------------------------------------------------
+// ***** Benchmark
+
+#ifdef OVR_THREADPOOL_BENCHMARK
+
+} // OVR
+
+#include "OVR_Timer.h"
+#include "OVR_Log.h"
+
+namespace OVR {
+
+namespace ThreadPoolBenchmark {
+
+const int JobCount = 1000;
+
+AtomicInt<SInt32> JobsRun;
+
+void EmptyJob(void*)
+{
+    JobsRun.ExchangeAdd_NoSync(1);
+}
+
+int EmptyJobThreadFn(Thread*, void*)
+{
+    EmptyJob(0);
+    return 0;
+}
+
+} // ThreadPoolBenchmark
+
+void RunThreadPoolBenchmark()
+{
+    using namespace ThreadPoolBenchmark;
+
+    ThreadPool pool;
+    JobsRun = 0;
+
+    UInt64 poolStart = Timer::GetTicksNanos();
+    {
+        TaskGroup group(&pool);
+        for (int i = 0; i < JobCount; i++)
+            group.Run(EmptyJob, 0);
+        group.Wait();
+    }
+    UInt64 poolTime = Timer::GetTicksNanos() - poolStart;
+
+    UInt64 threadStart = Timer::GetTicksNanos();
+    for (int i = 0; i < JobCount; i++)
+    {
+        Ptr<Thread> thread = *new Thread(EmptyJobThreadFn);
+        thread->Start();
+        while (!thread->IsFinished())
+            Thread::MSleep(0);
+    }
+    UInt64 threadTime = Timer::GetTicksNanos() - threadStart;
+
+    LogText("ThreadPoolBenchmark: %d jobs, %d workers: pool %.2f us/job, thread per job %.2f us/job (%d run)\n",
+            JobCount, pool.GetWorkerCount(),
+            poolTime * 0.001 / JobCount, threadTime * 0.001 / JobCount, (int)JobsRun);
+}
+
+#endif // OVR_THREADPOOL_BENCHMARK
+
+
+} // OVR
+
+#endif // OVR_ENABLE_THREADS
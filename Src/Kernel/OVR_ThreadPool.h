@@ -0,0 +1,227 @@
+/************************************************************************************
+
+PublicHeader:   OVR.h
+Filename    :   OVR_ThreadPool.h
+Content     :   Work-stealing thread pool with task groups and ParallelFor.
+Created     :   October 14, 2026
+Notes       :
+
+Copyright   :   Copyright 2014 Oculus VR, Inc. All Rights reserved.
+
+Licensed under the Oculus VR Rift SDK License Version 3.1 (the "License");
+you may not use the Oculus VR Rift SDK except in compliance with the License,
+which is provided at the time of installation or download, or which
+otherwise accompanies this software in either electronic or hard copy form.
+
+You may obtain a copy of the License at
+
+http://www.oculusvr.com/licenses/LICENSE-3.1
+
+Unless required by applicable law or agreed to in writing, the Oculus VR SDK
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+************************************************************************************/
+
+#ifndef OVR_ThreadPool_h
+#define OVR_ThreadPool_h
+
+#include "OVR_Threads.h"
+#include "OVR_Array.h"
+
+// Define to build RunThreadPoolBenchmark, which compares the cost of running
+// small jobs on a ThreadPool against starting a Thread for each job.
+//#define OVR_THREADPOOL_BENCHMARK
+
+#ifdef OVR_ENABLE_THREADS
+
+namespace OVR {
+
+class ThreadPool;
+class ThreadPoolWorker;
+
+
+//-----------------------------------------------------------------------------------
+// ***** TaskGroup
+
+// TaskGroup tracks a set of tasks submitted to a ThreadPool so that they can be
+// waited on together. Wait runs queued tasks on the calling thread while it waits,
+// so it is safe to call from inside a task and with a pool that has no workers.
+// The destructor waits for any tasks still pending.
+
+class TaskGroup
+{
+    friend class ThreadPool;
+public:
+    typedef void (*TaskFunction)(void* data);
+
+    TaskGroup(ThreadPool* pool) : pPool(pool), Pending(0) { }
+    ~TaskGroup() { Wait(); }
+
+    // Queues fn(data) on the pool as part of this group.
+    void    Run(TaskFunction fn, void* data);
+    // Returns once every task run in this group has finished.
+    void    Wait();
+
+    bool    IsDone() const { return Pending.Load_Acquire() == 0; }
+
+private:
+    ThreadPool*         pPool;
+    AtomicInt<SInt32>   Pending;
+
+    TaskGroup(const TaskGroup&);
+    void operator = (const TaskGroup&);
+};
+
+
+//-----------------------------------------------------------------------------------
+// ***** ThreadPool
+
+// ThreadPool runs short tasks on a fixed set of worker threads. Each worker owns a
+// deque of tasks: tasks submitted from a worker go to the bottom of its own deque
+// and are taken back from there, so nested work stays on the same core, while idle
+// workers steal from the top of other workers' deques. Tasks submitted from other
+// threads go to a shared queue. Workers sleep when no tasks are queued.
+//
+// Tasks are plain function/data pairs and must not throw or block on each other
+// except through TaskGroup::Wait.
+//
+//   ThreadPool pool;
+//   pool.ParallelFor(0, height, rowBuilder);   // Calls rowBuilder(y) for each row.
+
+class ThreadPool : public NewOverrideBase
+{
+    friend class ThreadPoolWorker;
+    friend class TaskGroup;
+public:
+    typedef TaskGroup::TaskFunction TaskFunction;
+
+    enum
+    {
+        // Tasks beyond this many in one worker's deque go to the shared queue.
+        WorkerQueueCapacity = 256,
+        // ParallelFor splits a range into at most this many tasks per thread.
+        ParallelForChunksPerThread = 4,
+        MaxParallelForChunks = 64
+    };
+
+    // workerCount < 0 creates one worker per CPU less one, leaving a core for the
+    // thread that submits work; 0 workers runs every task in TaskGroup::Wait.
+    // If firstProcessor >= 0, worker i is asked to run on processor
+    // (firstProcessor + i) modulo the CPU count (see Thread constructor).
+    ThreadPool(int workerCount = -1, int firstProcessor = -1);
+    // Runs any tasks still queued, then stops the workers.
+    ~ThreadPool();
+
+    int     GetWorkerCount() const { return StartedCount; }
+
+    // Queues fn(data). If group is not null the task is counted in it.
+    void    Submit(TaskFunction fn, void* data, TaskGroup* group = 0);
+
+    // Runs one queued task on the calling thread; returns false if none was found.
+    bool    RunPendingTask();
+
+    // Calls body(i) for each i in [begin, end), splitting the range into tasks of
+    // at least grainSize indices. Returns once all calls have completed; one of the
+    // tasks runs on the calling thread.
+    template<class Body>
+    void    ParallelFor(int begin, int end, Body& body, int grainSize = 1);
+
+private:
+    struct Task
+    {
+        TaskFunction    Function;
+        void*           Data;
+        TaskGroup*      pGroup;
+    };
+
+    template<class Body>
+    struct ParallelForRange
+    {
+        Body*   pBody;
+        int     Begin, End;
+
+        static void Run(void* data)
+        {
+            ParallelForRange* range = (ParallelForRange*)data;
+            for (int i = range->Begin; i < range->End; i++)
+                (*range->pBody)(i);
+        }
+    };
+
+    static void         runTask(const Task& task);
+    ThreadPoolWorker*   getCurrentWorker() const;
+    // Finds a task for the calling thread, preferring its own deque.
+    bool                findTask(ThreadPoolWorker* self, Task* task);
+    bool                popInjected(Task* task);
+    void                wakeWorker();
+    // Blocks worker until a task may be available or the pool is stopping.
+    void                waitForWork();
+
+    // Workers[0, StartedCount) are running; any others failed to start.
+    Array<Ptr<ThreadPoolWorker> > Workers;
+    volatile int        StartedCount;
+
+    // Shared queue for tasks submitted from outside the workers.
+    Lock                InjectedLock;
+    Array<Task>         Injected;
+    UPInt               InjectedHead;
+
+    // Tasks queued anywhere in the pool but not yet started.
+    AtomicInt<SInt32>   QueuedCount;
+    AtomicInt<SInt32>   SleepingCount;
+    Mutex               SleepMutex;
+    WaitCondition       SleepCondition;
+    volatile bool       Stopping;
+
+    ThreadPool(const ThreadPool&);
+    void operator = (const ThreadPool&);
+};
+
+
+template<class Body>
+void ThreadPool::ParallelFor(int begin, int end, Body& body, int grainSize)
+{
+    if (end <= begin)
+        return;
+    if (grainSize < 1)
+        grainSize = 1;
+
+    int count      = end - begin;
+    int chunkCount = (count + grainSize - 1) / grainSize;
+    int maxChunks  = (GetWorkerCount() + 1) * ParallelForChunksPerThread;
+    if (maxChunks > MaxParallelForChunks)
+        maxChunks = MaxParallelForChunks;
+    if (chunkCount > maxChunks)
+        chunkCount = maxChunks;
+
+    ParallelForRange<Body> ranges[MaxParallelForChunks];
+    for (int i = 0; i < chunkCount; i++)
+    {
+        ranges[i].pBody = &body;
+        ranges[i].Begin = begin + (int)(((SInt64)count * i) / chunkCount);
+        ranges[i].End   = begin + (int)(((SInt64)count * (i + 1)) / chunkCount);
+    }
+
+    TaskGroup group(this);
+    for (int i = 1; i < chunkCount; i++)
+        group.Run(&ParallelForRange<Body>::Run, &ranges[i]);
+    ParallelForRange<Body>::Run(&ranges[0]);
+    group.Wait();
+}
+
+
+#ifdef OVR_THREADPOOL_BENCHMARK
+// Logs the time taken to run a batch of empty jobs on a ThreadPool and on a
+// Thread per job. Call after System::Init.
+void RunThreadPoolBenchmark();
+#endif
+
+
+} // OVR
+
+#endif // OVR_ENABLE_THREADS
+
+#endif
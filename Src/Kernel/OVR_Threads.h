@@ -38,6 +38,13 @@ limitations under the License.
 // To be defined in the project configuration options
 #ifdef OVR_ENABLE_THREADS
 
+// Mutex and Event are built directly on futexes (Linux) or umtx (FreeBSD) where
+// available instead of pthread mutexes and condition variables; they spin briefly
+// before sleeping on multi-core systems. Define OVR_THREADS_NO_FUTEX to disable.
+#if (defined(OVR_OS_LINUX) || defined(__FreeBSD__)) && !defined(OVR_THREADS_NO_FUTEX)
+#define OVR_THREADS_FUTEX
+#endif
+
 
 namespace OVR {
 
@@ -140,16 +147,26 @@ public:
 
 class Event
 {
+#if defined(OVR_THREADS_FUTEX)
+    // State and Temporary flags, plus the number of waiters in the upper bits;
+    // waiters sleep on this word. No memory is allocated.
+    AtomicInt<UInt32> StateWord;
+#else
     // Event state, its mutex and the wait condition
     volatile bool   State;
     volatile bool   Temporary;  
     mutable Mutex   StateMutex;
     WaitCondition   StateWaitCondition;
+#endif
 
     void updateState(bool newState, bool newTemp, bool mustNotify);
 
 public:    
+#if defined(OVR_THREADS_FUTEX)
+    Event(bool setInitially = 0) : StateWord(setInitially ? 1 : 0) { }
+#else
     Event(bool setInitially = 0) : State(setInitially), Temporary(false) { }
+#endif
     ~Event() { }
 
     // Wait on an event condition until it is set
@@ -246,17 +263,38 @@ public:
         ThreadPriority priority;         // Thread priority
     };
 
+    // Scheduling policy for SetCurrentThreadScheduling
+    enum SchedulingPolicy
+    {
+        Sched_Normal,       // Default time-sharing scheduling
+        Sched_FIFO,         // Real-time; runs until it blocks or a higher priority thread is ready
+        Sched_RoundRobin    // Real-time; time-sliced among threads of the same priority
+    };
+
+    // Scheduling options applied to a running thread
+    struct SchedulingParams
+    {
+        SchedulingParams(SchedulingPolicy policy = Sched_Normal, int priority = 1,
+                         UInt64 processorMask = 0, bool lockStack = false)
+                         : Policy(policy), RealTimePriority(priority),
+                           ProcessorMask(processorMask), LockStack(lockStack) {}
+        SchedulingPolicy Policy;
+        int              RealTimePriority; // Priority for real-time policies, 1 (lowest) to 99 on Linux
+        UInt64           ProcessorMask;    // Bit i allows processor i; 0 leaves affinity unchanged
+        bool             LockStack;        // Lock the thread's stack in memory so it can't page fault
+    };
+
     // *** Constructors
 
     // A default constructor always creates a thread in NotRunning state, because
     // the derived class has not yet been initialized. The derived class can call Start explicitly.
     // "processor" parameter specifies which hardware processor this thread will be run on. 
-    // -1 means OS decides this. Implemented only on Win32
+    // -1 means OS decides this. Implemented on Win32 and Linux.
     Thread(UPInt stackSize = 128 * 1024, int processor = -1);
     // Constructors that initialize the thread with a pointer to function.
     // An option to start a thread is available, but it should not be used if classes are derived from Thread.
     // "processor" parameter specifies which hardware processor this thread will be run on. 
-    // -1 means OS decides this. Implemented only on Win32
+    // -1 means OS decides this. Implemented on Win32 and Linux.
     Thread(ThreadFn threadFunction, void*  userHandle = 0, UPInt stackSize = 128 * 1024,
            int processor = -1, ThreadState initialState = NotRunning);
     // Constructors that initialize the thread with a create parameters structure.
@@ -317,6 +355,12 @@ public:
     // Returns the number of available CPUs on the system 
     static int    GetCPUCount();
 
+    // Applies scheduling options to the calling thread. Real-time policies and stack
+    // locking usually need privileges (CAP_SYS_NICE or RLIMIT_RTPRIO, RLIMIT_MEMLOCK).
+    // Returns false if any option failed; the others are still applied.
+    // Processor masks are only supported on Linux.
+    static bool   SetCurrentThreadScheduling(const SchedulingParams& params);
+
     // Returns the thread exit code. Exit code is initialized to 0,
     // and set to the return value if Run function after the thread is finished.
     inline int    GetExitCode() const { return ExitCode; }
@@ -340,6 +384,8 @@ public:
     static bool    Sleep(unsigned secs);
     // Sleep msecs milliseconds
     static bool    MSleep(unsigned msecs);
+    // Gives up the rest of the time slice to any other thread ready to run.
+    static void    YieldCurrentThread();
 
 
     // *** Debugging functionality
@@ -33,14 +33,79 @@ limitations under the License.
 #include "OVR_Log.h"
 
 #include <pthread.h>
+#include <sched.h>
 #include <time.h>
 #include <unistd.h>
 #include <sys/time.h>
+#include <sys/mman.h>
 #include <errno.h>
 
+#if defined(OVR_THREADS_FUTEX) && defined(OVR_OS_LINUX)
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#elif defined(OVR_THREADS_FUTEX)
+#include <sys/types.h>
+#include <sys/umtx.h>
+#endif
+
 
 namespace OVR {
 
+#if defined(OVR_THREADS_FUTEX)
+
+// ***** Futex helpers
+
+// Sleeps while *address == value, for at most timeoutMs unless it is OVR_WAIT_INFINITE.
+// May return early or spuriously; callers re-check their condition.
+static void Futex_Wait(volatile UInt32* address, UInt32 value, unsigned timeoutMs = OVR_WAIT_INFINITE)
+{
+    timespec  ts;
+    timespec* pts = 0;
+    if (timeoutMs != OVR_WAIT_INFINITE)
+    {
+        ts.tv_sec  = timeoutMs / 1000;
+        ts.tv_nsec = (timeoutMs % 1000) * 1000000;
+        pts = &ts;
+    }
+#if defined(OVR_OS_LINUX)
+    syscall(SYS_futex, address, FUTEX_WAIT_PRIVATE, value, pts, 0, 0);
+#else
+    _umtx_op((void*)address, UMTX_OP_WAIT_UINT_PRIVATE, value,
+             pts ? (void*)sizeof(ts) : 0, pts);
+#endif
+}
+
+// Wakes up to count threads sleeping in Futex_Wait on address.
+static void Futex_Wake(volatile UInt32* address, int count)
+{
+#if defined(OVR_OS_LINUX)
+    syscall(SYS_futex, address, FUTEX_WAKE_PRIVATE, count, 0, 0, 0);
+#else
+    _umtx_op((void*)address, UMTX_OP_WAKE_PRIVATE, count, 0, 0);
+#endif
+}
+
+static inline void Futex_SpinPause()
+{
+#if defined(OVR_CPU_X86) || defined(OVR_CPU_X86_64)
+    asm volatile("pause" ::: "memory");
+#else
+    asm volatile("" ::: "memory");
+#endif
+}
+
+// Spinning only helps if the thread we wait for can run at the same time.
+static bool Futex_ShouldSpin()
+{
+    static int cpuCount = 0;
+    if (cpuCount == 0)
+        cpuCount = Thread::GetCPUCount();
+    return cpuCount > 1;
+}
+
+#endif // OVR_THREADS_FUTEX
+
+
 // ***** Mutex implementation
 
 
@@ -48,11 +113,22 @@ namespace OVR {
 
 class MutexImpl : public NewOverrideBase
 {
+#if defined(OVR_THREADS_FUTEX)
+    // 0 - unlocked, 1 - locked, 2 - locked with possible sleepers.
+    AtomicInt<UInt32>   Word;
+    // Running average of spins needed to acquire, as in glibc's adaptive mutex.
+    int                 SpinAverage;
+    enum { MaxSpinCount = 200 };
+
+    void                lockWord();
+    void                unlockWord();
+#else
     // System mutex or semaphore
     pthread_mutex_t   SMutex;
+#endif
     bool          Recursive;
     unsigned      LockCount;
-    pthread_t     LockedBy;
+    volatile pthread_t LockedBy;
 
     friend class WaitConditionImpl;
 
@@ -73,6 +149,84 @@ public:
 pthread_mutexattr_t Lock::RecursiveAttr;
 bool Lock::RecursiveAttrInit = 0;
 
+#if defined(OVR_THREADS_FUTEX)
+
+MutexImpl::MutexImpl(Mutex* pmutex, bool recursive)
+  : Word(0), SpinAverage(0), Recursive(recursive), LockCount(0), LockedBy(0)
+{
+    OVR_UNUSED(pmutex);
+}
+
+MutexImpl::~MutexImpl()
+{
+}
+
+void MutexImpl::lockWord()
+{
+    if (Word.CompareAndSet_Acquire(0, 1))
+        return;
+
+    if (Futex_ShouldSpin())
+    {
+        int maxSpins = Alg::Min(SpinAverage * 2 + 10, (int)MaxSpinCount);
+        for (int spins = 0; spins < maxSpins; spins++)
+        {
+            Futex_SpinPause();
+            if (Word.Load_Relaxed() == 0 && Word.CompareAndSet_Acquire(0, 1))
+            {
+                SpinAverage += (spins - SpinAverage) / 8;
+                return;
+            }
+        }
+        SpinAverage += (maxSpins - SpinAverage) / 8;
+    }
+
+    // Mark contended, so the owner knows to wake us, until we get it unlocked.
+    while (Word.Exchange_Acquire(2) != 0)
+        Futex_Wait(&Word.Value, 2);
+}
+
+void MutexImpl::unlockWord()
+{
+    if (Word.Exchange_Release(0) == 2)
+        Futex_Wake(&Word.Value, 1);
+}
+
+void MutexImpl::DoLock()
+{
+    pthread_t self = pthread_self();
+    // LockedBy is only ever equal to self while this thread holds the lock.
+    if (!(Recursive && LockCount && pthread_equal(LockedBy, self)))
+        lockWord();
+    LockCount++;
+    LockedBy = self;
+}
+
+bool MutexImpl::TryLock()
+{
+    pthread_t self = pthread_self();
+    if (!(Recursive && LockCount && pthread_equal(LockedBy, self)) &&
+        !Word.CompareAndSet_Acquire(0, 1))
+        return 0;
+    LockCount++;
+    LockedBy = self;
+    return 1;
+}
+
+void MutexImpl::Unlock(Mutex* pmutex)
+{
+    OVR_UNUSED(pmutex);
+    OVR_ASSERT(pthread_self() == LockedBy && LockCount > 0);
+
+    if (--LockCount == 0)
+    {
+        LockedBy = 0;
+        unlockWord();
+    }
+}
+
+#else   // !OVR_THREADS_FUTEX
+
 // *** Constructor/destructor
 MutexImpl::MutexImpl(Mutex* pmutex, bool recursive)
 {   
@@ -134,6 +288,8 @@ void MutexImpl::Unlock(Mutex* pmutex)
     pthread_mutex_unlock(&SMutex);
 }
 
+#endif  // OVR_THREADS_FUTEX
+
 bool    MutexImpl::IsLockedByAnotherThread(Mutex* pmutex)
 {
     OVR_UNUSED(pmutex);
@@ -190,6 +346,78 @@ bool    Mutex::IsLockedByAnotherThread()
 //-----------------------------------------------------------------------------------
 // ***** Event
 
+#if defined(OVR_THREADS_FUTEX)
+
+// StateWord layout: bit 0 - set, bit 1 - temporary (pulsed), the rest counts waiters.
+enum
+{
+    Event_Set       = 1,
+    Event_Temporary = 2,
+    Event_Waiter    = 4,
+    Event_SpinCount = 100
+};
+
+bool Event::Wait(unsigned delay)
+{
+    UInt64 deadline = (delay == OVR_WAIT_INFINITE) ? 0 :
+                      Timer::GetTicksNanos() + (UInt64)delay * 1000000;
+    int    spins    = (delay && Futex_ShouldSpin()) ? (int)Event_SpinCount : 0;
+
+    for (;;)
+    {
+        UInt32 state = StateWord.Load_Acquire();
+
+        if (state & Event_Set)
+        {
+            // A pulse releases only the first waiter.
+            if (!(state & Event_Temporary))
+                return true;
+            if (StateWord.CompareAndSet_Acquire(state, state & ~(UInt32)(Event_Set | Event_Temporary)))
+                return true;
+            continue;
+        }
+
+        unsigned waitMs = OVR_WAIT_INFINITE;
+        if (delay != OVR_WAIT_INFINITE)
+        {
+            UInt64 now = Timer::GetTicksNanos();
+            if (now >= deadline)
+                return false;
+            waitMs = (unsigned)((deadline - now + 999999) / 1000000);
+        }
+
+        if (spins > 0)
+        {
+            spins--;
+            Futex_SpinPause();
+            continue;
+        }
+
+        // Register as a waiter so that setters know to wake us, then sleep
+        // unless the word changed in the meantime.
+        if (!StateWord.CompareAndSet_NoSync(state, state + Event_Waiter))
+            continue;
+        Futex_Wait(&StateWord.Value, state + Event_Waiter, waitMs);
+        StateWord.ExchangeAdd_NoSync((UInt32)0 - Event_Waiter);
+    }
+}
+
+void Event::updateState(bool newState, bool newTemp, bool mustNotify)
+{
+    UInt32 flags = (newState ? Event_Set : 0) | (newTemp ? Event_Temporary : 0);
+    UInt32 state;
+    do
+    {
+        state = StateWord.Load_Relaxed();
+    } while (!StateWord.CompareAndSet_Sync(state, (state & ~(UInt32)(Event_Set | Event_Temporary)) | flags));
+
+    // A pulse is consumed by one waiter; SetEvent releases them all.
+    if (mustNotify && state >= Event_Waiter)
+        Futex_Wake(&StateWord.Value, newTemp ? 1 : 0x7FFFFFFF);
+}
+
+#else   // !OVR_THREADS_FUTEX
+
 bool Event::Wait(unsigned delay)
 {
     Mutex::Locker lock(&StateMutex);
@@ -225,6 +453,8 @@ void Event::updateState(bool newState, bool newTemp, bool mustNotify)
         StateWaitCondition.NotifyAll();    
 }
 
+#endif  // OVR_THREADS_FUTEX
+
 
 
 // ***** Wait Condition Implementation
@@ -275,6 +505,11 @@ bool    WaitConditionImpl::Wait(Mutex *pmutex, unsigned delay)
     pthread_mutex_lock(&SMutex);
 
     // Finally, release a mutex or semaphore
+#if defined(OVR_THREADS_FUTEX)
+    pmutex->pImpl->LockCount = 0;
+    pmutex->pImpl->LockedBy  = 0;
+    pmutex->pImpl->unlockWord();
+#else
     if (pmutex->pImpl->Recursive)
     {
         // Release the recursive mutex N times
@@ -287,6 +522,7 @@ bool    WaitConditionImpl::Wait(Mutex *pmutex, unsigned delay)
         pmutex->pImpl->LockCount = 0;
         pthread_mutex_unlock(&pmutex->pImpl->SMutex);
     }
+#endif
 
     // Note that there is a gap here between mutex.Unlock() and Wait().
     // The other mutex protects this gap.
@@ -698,7 +934,7 @@ bool    Thread::Start(ThreadState initialState)
     ThreadList::AddRunningThread(this);
 
     int result;
-    if (StackSize != 128 * 1024 || Priority != NormalPriority)
+    if (StackSize != 128 * 1024 || Priority != NormalPriority || Processor >= 0)
     {
         pthread_attr_t attr;
 
@@ -708,6 +944,18 @@ bool    Thread::Start(ThreadState initialState)
         sched_param sparam;
         sparam.sched_priority = Thread::GetOSPriority(Priority);
         pthread_attr_setschedparam(&attr, &sparam);
+#if defined(OVR_OS_LINUX)
+        // The processor is only a hint; pthread_create would fail if it were
+        // outside the set of processors this process may run on, so skip it then.
+        cpu_set_t cpuSet;
+        if (Processor >= 0 && Processor < CPU_SETSIZE &&
+            sched_getaffinity(0, sizeof(cpuSet), &cpuSet) == 0 && CPU_ISSET(Processor, &cpuSet))
+        {
+            CPU_ZERO(&cpuSet);
+            CPU_SET(Processor, &cpuSet);
+            pthread_attr_setaffinity_np(&attr, sizeof(cpuSet), &cpuSet);
+        }
+#endif
         result = pthread_create(&ThreadHandle, &attr, Thread_PthreadStartFn, this);
         pthread_attr_destroy(&attr);
     }
@@ -775,10 +1023,92 @@ bool    Thread::MSleep(unsigned msecs)
     usleep(msecs*1000);
     return 1;
 }
+/* static */
+void    Thread::YieldCurrentThread()
+{
+    sched_yield();
+}
+
+/* static */
+bool    Thread::SetCurrentThreadScheduling(const SchedulingParams& params)
+{
+    bool      result = true;
+    pthread_t self   = pthread_self();
+
+    sched_param sparam;
+    int         policy = SCHED_OTHER;
+    sparam.sched_priority = 0;
+    if (params.Policy != Sched_Normal)
+    {
+        policy = (params.Policy == Sched_FIFO) ? SCHED_FIFO : SCHED_RR;
+        sparam.sched_priority = Alg::Clamp(params.RealTimePriority,
+                                           sched_get_priority_min(policy),
+                                           sched_get_priority_max(policy));
+    }
+    int err = pthread_setschedparam(self, policy, &sparam);
+    if (err)
+    {
+        LogError("OVR::Thread - Failed to set scheduling policy %d, priority %d (error %d).\n",
+                 (int)params.Policy, sparam.sched_priority, err);
+        result = false;
+    }
+
+    if (params.ProcessorMask)
+    {
+#if defined(OVR_OS_LINUX)
+        cpu_set_t cpuSet;
+        CPU_ZERO(&cpuSet);
+        for (int i = 0; i < 64 && i < CPU_SETSIZE; i++)
+        {
+            if (params.ProcessorMask & ((UInt64)1 << i))
+                CPU_SET(i, &cpuSet);
+        }
+        err = pthread_setaffinity_np(self, sizeof(cpuSet), &cpuSet);
+        if (err)
+        {
+            LogError("OVR::Thread - Failed to set processor mask 0x%llx (error %d).\n",
+                     (unsigned long long)params.ProcessorMask, err);
+            result = false;
+        }
+#else
+        result = false;
+#endif
+    }
+
+    if (params.LockStack)
+    {
+#if defined(OVR_OS_LINUX)
+        // Locks the whole stack mapping, which also pre-faults it.
+        pthread_attr_t attr;
+        void*          stackAddr = 0;
+        size_t         stackSize = 0;
+        if (pthread_getattr_np(self, &attr) == 0)
+        {
+            pthread_attr_getstack(&attr, &stackAddr, &stackSize);
+            pthread_attr_destroy(&attr);
+        }
+        if (!stackAddr || mlock(stackAddr, stackSize) != 0)
+        {
+            LogError("OVR::Thread - Failed to lock %u byte stack in memory (errno %d).\n",
+                     (unsigned)stackSize, errno);
+            result = false;
+        }
+#else
+        result = false;
+#endif
+    }
+
+    return result;
+}
 
 /* static */
 int     Thread::GetCPUCount()
 {
+#if defined(_SC_NPROCESSORS_ONLN)
+    long count = sysconf(_SC_NPROCESSORS_ONLN);
+    if (count > 0)
+        return (int)count;
+#endif
     return 1;
 }
 
@@ -26,15 +26,30 @@ limitations under the License.
 
 #include "OVR_Timer.h"
 #include "OVR_Log.h"
+#include "OVR_Atomic.h"
+#include "OVR_Alg.h"
+#include <string.h>
 
 #if defined (OVR_OS_WIN32)
 #include <windows.h>
 #elif defined(OVR_OS_ANDROID)
 #include <time.h>
+#include <errno.h>
 #include <android/log.h>
 
 #else
 #include <sys/time.h>
+#include <time.h>
+#include <errno.h>
+#endif
+
+// On x86 Linux GetTicksNanos reads the TSC when the CPU reports it as invariant,
+// instead of calling clock_gettime. Define OVR_TIMER_NO_TSC to always use the clock.
+#if defined(OVR_OS_LINUX) && defined(OVR_CC_GNU) && \
+    (defined(OVR_CPU_X86) || defined(OVR_CPU_X86_64)) && !defined(OVR_TIMER_NO_TSC)
+#define OVR_TIMER_TSC
+#include "OVR_Lockless.h"
+#include <cpuid.h>
 #endif
 
 namespace OVR {
@@ -57,9 +72,9 @@ double Timer::GetSeconds()
 }
 
 
-#ifndef OVR_OS_WIN32
+#if !defined(OVR_OS_WIN32) && !defined(OVR_TIMER_TSC)
 
-// Unused on OSs other then Win32.
+// Unused on OSs other then Win32 and TSC-capable Linux.
 void Timer::initializeTimerSystem()
 {
 }
@@ -257,15 +272,216 @@ void Timer::shutdownTimerSystem()
 #else   // !OVR_OS_WIN32 && !OVR_OS_ANDROID
 
 
+//------------------------------------------------------------------------
+// *** Linux Timer
+
+#if defined(OVR_OS_LINUX)
+
+static UInt64 Timer_MonotonicNanos()
+{
+    struct timespec tp;
+    clock_gettime(CLOCK_MONOTONIC, &tp);
+    return (UInt64)tp.tv_sec * Timer::NanosPerSecond + UInt64(tp.tv_nsec);
+}
+
+#if defined(OVR_TIMER_TSC)
+
+// The TSC is converted to CLOCK_MONOTONIC time with a base point and a rate that
+// are calibrated in initializeTimerSystem. Once per CheckIntervalNanos the next
+// caller compares against the clock: the rate is refined over the whole time since
+// calibration and the remaining error is steered out over the next interval. If
+// the TSC drifts too far (suspend, VM migration, or it isn't really invariant) it
+// is re-synchronized, and after MaxResyncs of those the clock is used instead.
+
+struct TscTimerState
+{
+    UInt64  BaseTicks;
+    UInt64  BaseNanos;
+    double  NanosPerTick;
+};
+
+struct TscTimer
+{
+    enum
+    {
+        CalibrationNanos    = 2000000,
+        CheckIntervalNanos  = 500000000,
+        MaxDriftNanos       = 1000000,
+        MaxResyncs          = 3
+    };
+
+    AtomicInt<UInt32>   Enabled;
+    UInt64              CheckIntervalTicks;
+    // Only the thread that holds CheckBusy touches the fields below.
+    AtomicInt<UInt32>   CheckBusy;
+    UInt64              CalTicks;
+    UInt64              CalNanos;
+    UInt32              ResyncCount;
+
+    LocklessSlotUpdater<TscTimerState> State;
+};
+
+static TscTimer Timer_Tsc;
+
+static inline UInt64 Timer_ReadTsc()
+{
+    UInt32 lo, hi;
+    asm volatile("rdtsc" : "=a"(lo), "=d"(hi));
+    return ((UInt64)hi << 32) | lo;
+}
+
+// Reads the TSC and the clock at (nearly) the same instant.
+static void Timer_ReadTscAndClock(UInt64* ticks, UInt64* nanos)
+{
+    UInt64 before = Timer_ReadTsc();
+    *nanos        = Timer_MonotonicNanos();
+    UInt64 after  = Timer_ReadTsc();
+    *ticks        = before + (after - before) / 2;
+}
+
+static bool Timer_HasInvariantTsc()
+{
+    unsigned eax, ebx, ecx, edx;
+    if (!__get_cpuid(0x80000000, &eax, &ebx, &ecx, &edx) || eax < 0x80000007)
+        return false;
+    __get_cpuid(0x80000007, &eax, &ebx, &ecx, &edx);
+    return (edx & (1 << 8)) != 0;
+}
+
+void Timer::initializeTimerSystem()
+{
+    if (!Timer_HasInvariantTsc())
+    {
+        OVR_DEBUG_LOG(("Timer: TSC is not invariant, using CLOCK_MONOTONIC."));
+        return;
+    }
+
+    UInt64 ticks0, nanos0, ticks1, nanos1;
+    Timer_ReadTscAndClock(&ticks0, &nanos0);
+    do
+    {
+        Timer_ReadTscAndClock(&ticks1, &nanos1);
+    } while (nanos1 - nanos0 < TscTimer::CalibrationNanos);
+
+    if (ticks1 <= ticks0)
+        return;
+
+    TscTimerState state;
+    state.BaseTicks    = ticks1;
+    state.BaseNanos    = nanos1;
+    state.NanosPerTick = double(nanos1 - nanos0) / double(ticks1 - ticks0);
+
+    Timer_Tsc.CheckIntervalTicks = UInt64(TscTimer::CheckIntervalNanos / state.NanosPerTick);
+    Timer_Tsc.CalTicks           = ticks0;
+    Timer_Tsc.CalNanos           = nanos0;
+    Timer_Tsc.ResyncCount        = 0;
+    Timer_Tsc.State.SetState(state);
+    Timer_Tsc.Enabled.Store_Release(1);
+}
+
+void Timer::shutdownTimerSystem()
+{
+    Timer_Tsc.Enabled.Store_Release(0);
+}
+
+// Called when a reader finds the state older than CheckIntervalTicks; returns
+// the time for a reader that saw state and ticks.
+static UInt64 Timer_CheckTsc(const TscTimerState& state, UInt64 ticks)
+{
+    UInt64 nanos = state.BaseNanos + UInt64(double(ticks - state.BaseTicks) * state.NanosPerTick);
+    if (!Timer_Tsc.CheckBusy.CompareAndSet_Sync(0, 1))
+        return nanos;
+
+    UInt64 clockTicks, clockNanos;
+    Timer_ReadTscAndClock(&clockTicks, &clockNanos);
+
+    // Another thread may have finished a check since state was read.
+    TscTimerState current = Timer_Tsc.State.GetState();
+    TscTimerState next;
+    SInt64        error = 0;
+    bool          resync = clockTicks < current.BaseTicks;
+
+    if (!resync)
+    {
+        UInt64 tscNanos = current.BaseNanos +
+                          UInt64(double(clockTicks - current.BaseTicks) * current.NanosPerTick);
+        error  = (SInt64)(tscNanos - clockNanos);
+        resync = (error > TscTimer::MaxDriftNanos) || (error < -TscTimer::MaxDriftNanos);
+
+        next.BaseTicks    = clockTicks;
+        next.BaseNanos    = tscNanos;
+        next.NanosPerTick = double(clockNanos - Timer_Tsc.CalNanos) /
+                            double(clockTicks - Timer_Tsc.CalTicks);
+        next.NanosPerTick *= 1.0 - double(error) / TscTimer::CheckIntervalNanos;
+    }
+
+    if (resync)
+    {
+        // Time may step here, possibly backwards; this only happens after the TSC
+        // itself has jumped.
+        if (++Timer_Tsc.ResyncCount > TscTimer::MaxResyncs)
+        {
+            Timer_Tsc.Enabled.Store_Release(0);
+            Timer_Tsc.CheckBusy.Store_Release(0);
+            LogText("Timer: TSC drift of %lld ns, using CLOCK_MONOTONIC.\n", (long long)error);
+            return clockNanos;
+        }
+        Timer_Tsc.CalTicks = clockTicks;
+        Timer_Tsc.CalNanos = clockNanos;
+        next.BaseTicks     = clockTicks;
+        next.BaseNanos     = clockNanos;
+        next.NanosPerTick  = current.NanosPerTick;
+    }
+
+    Timer_Tsc.State.SetState(next);
+    Timer_Tsc.CheckBusy.Store_Release(0);
+    return next.BaseNanos;
+}
+
+UInt64 Timer::GetTicksNanos()
+{
+    if (useFakeSeconds)
+        return (UInt64) (FakeSeconds * NanosPerSecond);
+
+    if (Timer_Tsc.Enabled.Load_Acquire())
+    {
+        TscTimerState state = Timer_Tsc.State.GetState();
+        UInt64        ticks = Timer_ReadTsc();
+
+        // TSCs of different cores may differ slightly; never go before the base.
+        if (ticks < state.BaseTicks)
+            return state.BaseNanos;
+        if (ticks - state.BaseTicks >= Timer_Tsc.CheckIntervalTicks)
+            return Timer_CheckTsc(state, ticks);
+        return state.BaseNanos + UInt64(double(ticks - state.BaseTicks) * state.NanosPerTick);
+    }
+
+    return Timer_MonotonicNanos();
+}
+
+#else   // !OVR_TIMER_TSC
+
+UInt64 Timer::GetTicksNanos()
+{
+    if (useFakeSeconds)
+        return (UInt64) (FakeSeconds * NanosPerSecond);
+
+    return Timer_MonotonicNanos();
+}
+
+#endif  // OVR_TIMER_TSC
+
+
 //------------------------------------------------------------------------
 // *** Standard OS Timer     
 
+#else   // !OVR_OS_LINUX
+
 UInt64 Timer::GetTicksNanos()
 {
     if (useFakeSeconds)
         return (UInt64) (FakeSeconds * NanosPerSecond);
 
-    // TODO: prefer rdtsc when available?
 	UInt64 result;
 
     // Return microseconds.
@@ -279,9 +495,145 @@ UInt64 Timer::GetTicksNanos()
     return result * 1000;
 }
 
+#endif  // OVR_OS_LINUX
+
 #endif  // OS-specific
 
 
 
+//------------------------------------------------------------------------
+// *** Hybrid sleep/spin wait
+
+// Spinning starts SleepMarginNanos before the deadline. The margin grows quickly
+// when a sleep overshoots and shrinks slowly towards twice the typical wake-up
+// latency otherwise, staying within these limits.
+enum
+{
+    MinSleepMarginNanos     = 100000,
+    MaxSleepMarginNanos     = 4000000,
+    InitialSleepMarginNanos = 1000000
+};
+
+static Lock             Timer_WaitStatsLock;
+static Timer::WaitStats Timer_WaitStats = { 0, 0, 0, 0, 0, 0, InitialSleepMarginNanos };
+
+// Sleeps until about targetNanos (GetTicksNanos time); may return early or late.
+static void Timer_SleepUntil(UInt64 targetNanos, UInt64 nowNanos)
+{
+#if defined(OVR_OS_WIN32)
+    // Timer system requests 1 ms resolution with timeBeginPeriod.
+    DWORD ms = (DWORD)((targetNanos - nowNanos) / 1000000);
+    if (ms)
+        ::Sleep(ms);
+
+#elif defined(OVR_OS_MAC)
+    UInt64   delta = targetNanos - nowNanos;
+    timespec ts;
+    ts.tv_sec  = (time_t)(delta / Timer::NanosPerSecond);
+    ts.tv_nsec = (long)(delta % Timer::NanosPerSecond);
+    while (nanosleep(&ts, &ts) == -1 && errno == EINTR)
+        { }
+
+#else
+    // Sleep on the same clock GetTicksNanos reads, with an absolute deadline,
+    // so that interruptions and preemption before the call don't add to it.
+  #if defined(OVR_OS_ANDROID) || defined(OVR_OS_LINUX)
+    const clockid_t clock = CLOCK_MONOTONIC;
+  #else
+    const clockid_t clock = CLOCK_REALTIME;
+  #endif
+    OVR_UNUSED(nowNanos);
+    timespec ts;
+    ts.tv_sec  = (time_t)(targetNanos / Timer::NanosPerSecond);
+    ts.tv_nsec = (long)(targetNanos % Timer::NanosPerSecond);
+    while (clock_nanosleep(clock, TIMER_ABSTIME, &ts, 0) == EINTR)
+        { }
+#endif
+}
+
+UInt64 Timer::WaitUntilNanos(UInt64 deadlineNanos)
+{
+    UInt64 startNanos = GetTicksNanos();
+    if (startNanos >= deadlineNanos)
+        return 0;
+
+    UInt64 margin;
+    {
+        Lock::Locker lock(&Timer_WaitStatsLock);
+        margin = Timer_WaitStats.SleepMarginNanos;
+    }
+
+    // Sleeping is pointless when time comes from playback.
+    UInt64 nowNanos   = startNanos;
+    UInt64 sleepNanos = 0;
+    bool   slept      = false;
+    if (!useFakeSeconds && deadlineNanos - startNanos > margin)
+    {
+        UInt64 wakeTarget = deadlineNanos - margin;
+        Timer_SleepUntil(wakeTarget, startNanos);
+        nowNanos   = GetTicksNanos();
+        sleepNanos = nowNanos - startNanos;
+        slept      = true;
+
+        // Adapt to how late the OS woke us.
+        UInt64 wakeLatency = (nowNanos > wakeTarget) ? (nowNanos - wakeTarget) : 0;
+        if (nowNanos > deadlineNanos)
+            margin *= 2;
+        else
+            margin = (UInt64)((SInt64)margin - ((SInt64)margin - (SInt64)(wakeLatency * 2)) / 16);
+        margin = Alg::Clamp<UInt64>(margin, MinSleepMarginNanos, MaxSleepMarginNanos);
+    }
+
+    UInt64 spinStartNanos = nowNanos;
+    volatile int i;
+    while (nowNanos < deadlineNanos)
+    {
+        for (int j = 0; j < 50; j++)
+            i = 0;
+        nowNanos = GetTicksNanos();
+    }
+    OVR_UNUSED(i);
+
+    UInt64 lateNanos = nowNanos - deadlineNanos;
+    {
+        Lock::Locker lock(&Timer_WaitStatsLock);
+        WaitStats& stats = Timer_WaitStats;
+        stats.WaitCount++;
+        if (slept && spinStartNanos > deadlineNanos)
+            stats.LateCount++;
+        if (lateNanos > stats.MaxLateNanos)
+            stats.MaxLateNanos = lateNanos;
+        stats.TotalLateNanos  += lateNanos;
+        stats.TotalSleepNanos += sleepNanos;
+        stats.TotalSpinNanos  += (spinStartNanos < deadlineNanos) ? (deadlineNanos - spinStartNanos) : 0;
+        if (slept)
+            stats.SleepMarginNanos = margin;
+    }
+
+    return nowNanos - startNanos;
+}
+
+double Timer::WaitUntilSeconds(double absTime)
+{
+    if (absTime <= 0.0)
+        return 0.0;
+    return double(WaitUntilNanos(UInt64(absTime * NanosPerSecond))) * 0.000000001;
+}
+
+void Timer::GetWaitStats(WaitStats* stats)
+{
+    Lock::Locker lock(&Timer_WaitStatsLock);
+    *stats = Timer_WaitStats;
+}
+
+void Timer::ResetWaitStats()
+{
+    Lock::Locker lock(&Timer_WaitStatsLock);
+    UInt64 margin = Timer_WaitStats.SleepMarginNanos;
+    memset(&Timer_WaitStats, 0, sizeof(Timer_WaitStats));
+    Timer_WaitStats.SleepMarginNanos = margin;
+}
+
+
 } // OVR
 
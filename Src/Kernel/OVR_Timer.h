@@ -64,6 +64,33 @@ public:
     static UInt32  OVR_STDCALL GetTicksMs()
     { return  UInt32(GetTicksNanos() / 1000000); }
 
+
+    // ***** Waiting
+
+    // Waits until GetTicksNanos() reaches deadlineNanos. The thread sleeps until
+    // shortly before the deadline and spins for the rest, so the wake-up is as
+    // precise as a busy wait while using little CPU. The sleep margin adapts to how
+    // late the OS wakes the thread. Returns the number of nanoseconds waited.
+    static UInt64  WaitUntilNanos(UInt64 deadlineNanos);
+
+    // Same as WaitUntilNanos, in GetSeconds() time; returns seconds waited.
+    static double  WaitUntilSeconds(double absTime);
+
+    // Statistics collected by the Wait functions since the last reset.
+    struct WaitStats
+    {
+        UInt32  WaitCount;          // Waits that had to wait at all.
+        UInt32  LateCount;          // Waits where the sleep alone overshot the deadline.
+        UInt64  MaxLateNanos;       // Largest overshoot of the deadline on return.
+        UInt64  TotalLateNanos;     // Sum of overshoots, for an average with WaitCount.
+        UInt64  TotalSleepNanos;    // Time spent asleep.
+        UInt64  TotalSpinNanos;     // Time spent spinning before the deadline.
+        UInt64  SleepMarginNanos;   // Current margin before the deadline at which sleep ends.
+    };
+
+    static void    GetWaitStats(WaitStats* stats);
+    static void    ResetWaitStats();
+
     // for recorded data playback
     static void SetFakeSeconds(double fakeSeconds) 
     { 
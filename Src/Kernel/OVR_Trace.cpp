@@ -0,0 +1,218 @@
+/************************************************************************************
+
+Filename    :   OVR_Trace.cpp
+Content     :   Timeline tracing of SDK internal events, written as Chrome trace JSON
+Created     :   October 14, 2026
+Notes       :   Built only when OVR_ENABLE_TRACE is defined.
+
+Copyright   :   Copyright 2014 Oculus VR, Inc. All Rights reserved.
+
+Licensed under the Oculus VR Rift SDK License Version 3.1 (the "License");
+you may not use the Oculus VR Rift SDK except in compliance with the License,
+which is provided at the time of installation or download, or which
+otherwise accompanies this software in either electronic or hard copy form.
+
+You may obtain a copy of the License at
+
+http://www.oculusvr.com/licenses/LICENSE-3.1
+
+Unless required by applicable law or agreed to in writing, the Oculus VR SDK
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+************************************************************************************/
+
+#include "OVR_Trace.h"
+
+#ifdef OVR_ENABLE_TRACE
+
+#include "OVR_Alg.h"
+#include "OVR_Atomic.h"
+#include "OVR_Log.h"
+#include "OVR_Std.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(OVR_CC_MSVC)
+#define OVR_TRACE_THREAD_LOCAL __declspec(thread)
+#else
+#define OVR_TRACE_THREAD_LOCAL __thread
+#endif
+
+namespace OVR {
+
+// Events of one thread. Only the owning thread writes a buffer; Count is the
+// number of events ever recorded, published after each one is complete.
+struct TraceBuffer
+{
+    struct Event
+    {
+        const char* Name;
+        double      Start;
+        // Negative for instant events.
+        double      End;
+    };
+
+    Event           Events[Trace::BufferEvents];
+    volatile UInt32 Count;
+    UInt32          ThreadIndex;
+    char            ThreadName[32];
+    TraceBuffer*    pNext;
+};
+
+static TraceBuffer* volatile    TraceBuffers     = 0;
+static volatile UInt32          TraceThreadCount = 0;
+
+static OVR_TRACE_THREAD_LOCAL TraceBuffer* pThreadTraceBuffer = 0;
+
+// Buffers come from malloc and are never freed, like the per-thread blocks of
+// PerfCounter, so that events survive the threads that recorded them.
+static TraceBuffer* getThreadTraceBuffer()
+{
+    TraceBuffer* buffer = pThreadTraceBuffer;
+    if (buffer)
+        return buffer;
+
+    buffer = (TraceBuffer*)malloc(sizeof(TraceBuffer));
+    if (!buffer)
+        return 0;
+    memset(buffer, 0, sizeof(TraceBuffer));
+    buffer->ThreadIndex = AtomicOps<UInt32>::ExchangeAdd_Sync(&TraceThreadCount, 1) + 1;
+
+    do {
+        buffer->pNext = AtomicOps<TraceBuffer*>::Load_Acquire(&TraceBuffers);
+    } while (!AtomicOps<TraceBuffer*>::CompareAndSet_Sync(&TraceBuffers, buffer->pNext, buffer));
+
+    pThreadTraceBuffer = buffer;
+    return buffer;
+}
+
+static void addTraceEvent(const char* name, double start, double end)
+{
+    TraceBuffer* buffer = getThreadTraceBuffer();
+    if (!buffer)
+        return;
+
+    UInt32 count = buffer->Count;
+    TraceBuffer::Event& event = buffer->Events[count % Trace::BufferEvents];
+    event.Name  = name;
+    event.Start = start;
+    event.End   = end;
+    AtomicOps<UInt32>::Store_Release(&buffer->Count, count + 1);
+}
+
+
+//-----------------------------------------------------------------------------------
+// ***** Trace
+
+void Trace::AddEvent(const char* name, double startSeconds, double endSeconds)
+{
+    addTraceEvent(name, startSeconds, Alg::Max(endSeconds, startSeconds));
+}
+
+void Trace::AddInstant(const char* name, double seconds)
+{
+    addTraceEvent(name, seconds, -1.0);
+}
+
+void Trace::SetThreadName(const char* name)
+{
+    TraceBuffer* buffer = getThreadTraceBuffer();
+    if (buffer)
+        OVR_strcpy(buffer->ThreadName, sizeof(buffer->ThreadName), name);
+}
+
+static void writeTraceString(FILE* file, const char* str)
+{
+    fputc('"', file);
+    for (; *str; str++)
+    {
+        if (*str == '"' || *str == '\\')
+            fputc('\\', file);
+        if ((unsigned char)*str >= 0x20)
+            fputc(*str, file);
+    }
+    fputc('"', file);
+}
+
+bool Trace::Write(const char* path)
+{
+    if (!path || !*path)
+        path = getenv("OVR_TRACE_FILE");
+    if (!path || !*path)
+        path = "ovr_trace.json";
+
+    FILE* file = fopen(path, "w");
+    if (!file)
+    {
+        LogError("OVR::Trace - can't write '%s'\n", path);
+        return false;
+    }
+
+    // Copied out in chunks while the threads keep recording.
+    TraceBuffer::Event* events = (TraceBuffer::Event*)malloc(sizeof(TraceBuffer::Event) * BufferEvents);
+    if (!events)
+    {
+        fclose(file);
+        return false;
+    }
+
+    fputs("{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n", file);
+    bool first = true;
+
+    for (TraceBuffer* buffer = AtomicOps<TraceBuffer*>::Load_Acquire(&TraceBuffers);
+         buffer; buffer = buffer->pNext)
+    {
+        UInt32 end    = AtomicOps<UInt32>::Load_Acquire(&buffer->Count);
+        UInt32 copied = (end > (UInt32)BufferEvents) ? end - BufferEvents : 0;
+        for (UInt32 i = copied; i < end; i++)
+            events[i - copied] = buffer->Events[i % BufferEvents];
+
+        // Drop the events the thread may have overwritten while they were copied,
+        // including the slot of the one it may be recording now.
+        UInt32 after = AtomicOps<UInt32>::Load_Acquire(&buffer->Count) + 1;
+        UInt32 begin = (after > (UInt32)BufferEvents) ? after - BufferEvents : 0;
+        begin = Alg::Min(Alg::Max(begin, copied), end);
+
+        if (buffer->ThreadName[0])
+        {
+            fprintf(file, "%s{\"ph\":\"M\",\"name\":\"thread_name\",\"pid\":1,\"tid\":%u,\"args\":{\"name\":",
+                    first ? "" : ",\n", (unsigned)buffer->ThreadIndex);
+            writeTraceString(file, buffer->ThreadName);
+            fputs("}}", file);
+            first = false;
+        }
+
+        for (UInt32 i = begin; i < end; i++)
+        {
+            const TraceBuffer::Event& event = events[i - copied];
+            fputs(first ? "{\"name\":" : ",\n{\"name\":", file);
+            writeTraceString(file, event.Name);
+            if (event.End < 0.0)
+                fprintf(file, ",\"ph\":\"i\",\"s\":\"t\",\"pid\":1,\"tid\":%u,\"ts\":%.3f}",
+                        (unsigned)buffer->ThreadIndex, event.Start * 1000000.0);
+            else
+                fprintf(file, ",\"ph\":\"X\",\"pid\":1,\"tid\":%u,\"ts\":%.3f,\"dur\":%.3f}",
+                        (unsigned)buffer->ThreadIndex, event.Start * 1000000.0,
+                        (event.End - event.Start) * 1000000.0);
+            first = false;
+        }
+    }
+
+    fputs("\n]}\n", file);
+    free(events);
+
+    bool written = (ferror(file) == 0);
+    if (fclose(file) != 0)
+        written = false;
+    if (!written)
+        LogError("OVR::Trace - error writing '%s'\n", path);
+    return written;
+}
+
+} // OVR
+
+#endif // OVR_ENABLE_TRACE
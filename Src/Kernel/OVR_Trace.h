@@ -0,0 +1,105 @@
+/************************************************************************************
+
+PublicHeader:   Kernel
+Filename    :   OVR_Trace.h
+Content     :   Timeline tracing of SDK internal events, written as Chrome trace JSON
+Created     :   October 14, 2026
+Notes       :   Built only when OVR_ENABLE_TRACE is defined.
+
+Copyright   :   Copyright 2014 Oculus VR, Inc. All Rights reserved.
+
+Licensed under the Oculus VR Rift SDK License Version 3.1 (the "License");
+you may not use the Oculus VR Rift SDK except in compliance with the License,
+which is provided at the time of installation or download, or which
+otherwise accompanies this software in either electronic or hard copy form.
+
+You may obtain a copy of the License at
+
+http://www.oculusvr.com/licenses/LICENSE-3.1
+
+Unless required by applicable law or agreed to in writing, the Oculus VR SDK
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+************************************************************************************/
+
+#ifndef OVR_Trace_h
+#define OVR_Trace_h
+
+#include "OVR_Types.h"
+#include "OVR_Timer.h"
+
+// Trace macros, for use on the paths whose timing matters:
+//
+//  OVR_TRACE_SCOPE(name)                   - records the time spent in the enclosing scope.
+//  OVR_TRACE_SPAN(name, start, end)        - records a span between two Timer::GetSeconds times.
+//  OVR_TRACE_INSTANT(name)                 - records a point in time.
+//  OVR_TRACE_THREAD_NAME(name)             - names the calling thread in the timeline.
+//  OVR_TRACE_WRITE(path)                   - writes the recorded events; returns true on success.
+//
+// Names must be string literals, or otherwise outlive the process. Unless
+// OVR_ENABLE_TRACE is defined the macros compile to nothing, and OVR_TRACE_WRITE
+// to false.
+
+#ifdef OVR_ENABLE_TRACE
+
+namespace OVR {
+
+//-----------------------------------------------------------------------------------
+// ***** Trace
+
+// Each thread records events into its own ring buffer, which holds the latest
+// BufferEvents of them; recording takes no lock. Write takes a snapshot of all
+// buffers and writes it in the Chrome trace event format, which chrome://tracing
+// and the Perfetto UI open directly. Events overwritten while they are copied
+// are left out of the snapshot.
+
+class Trace
+{
+public:
+    enum { BufferEvents = 8192 };
+
+    static void AddEvent(const char* name, double startSeconds, double endSeconds);
+    static void AddInstant(const char* name, double seconds);
+    static void SetThreadName(const char* name);
+
+    // Writes all buffered events to the file; a null or empty path means the
+    // OVR_TRACE_FILE environment variable, or "ovr_trace.json" if it isn't set.
+    static bool Write(const char* path);
+};
+
+class TraceScope
+{
+public:
+    TraceScope(const char* name) : Name(name), Start(Timer::GetSeconds()) { }
+    ~TraceScope() { Trace::AddEvent(Name, Start, Timer::GetSeconds()); }
+
+private:
+    const char* Name;
+    double      Start;
+};
+
+} // OVR
+
+#define OVR_TRACE_JOIN_(a, b)   a##b
+#define OVR_TRACE_JOIN(a, b)    OVR_TRACE_JOIN_(a, b)
+
+#define OVR_TRACE_SCOPE(name)                   OVR::TraceScope OVR_TRACE_JOIN(ovrTraceScope_, __LINE__)(name)
+#define OVR_TRACE_SPAN(name, start, end)        OVR::Trace::AddEvent(name, start, end)
+#define OVR_TRACE_INSTANT(name)                 OVR::Trace::AddInstant(name, OVR::Timer::GetSeconds())
+#define OVR_TRACE_THREAD_NAME(name)             OVR::Trace::SetThreadName(name)
+#define OVR_TRACE_WRITE(path)                   OVR::Trace::Write(path)
+
+#else
+
+#define OVR_TRACE_SCOPE(name)                   ((void)0)
+#define OVR_TRACE_SPAN(name, start, end)        ((void)0)
+#define OVR_TRACE_INSTANT(name)                 ((void)0)
+#define OVR_TRACE_THREAD_NAME(name)             ((void)0)
+#define OVR_TRACE_WRITE(path)                   false
+
+#endif // OVR_ENABLE_TRACE
+
+#endif
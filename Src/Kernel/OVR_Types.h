@@ -113,6 +113,12 @@ limitations under the License.
 #  define OVR_CPU_ARM_NEON
 #endif // __ARM_NEON__
 
+// Cache line size used for padding data shared between threads, so that
+// independently written fields don't false-share.
+#ifndef OVR_CACHE_LINE_SIZE
+#  define OVR_CACHE_LINE_SIZE 64
+#endif
+
 
 //-----------------------------------------------------------------------------------
 // ***** Compiler
@@ -172,6 +178,37 @@ limitations under the License.
 
 
 
+//-----------------------------------------------------------------------------------
+// ***** Compiler Capabilities
+
+// OVR_CPP_RVALUE_REFERENCES is defined if the compiler supports C++11 rvalue
+// references; containers and String then provide move constructors and
+// rvalue overloads. OVR_CPP_VARIADIC_TEMPLATES additionally enables the
+// EmplaceBack family. Either can be predefined to force the setting.
+#if !defined(OVR_CPP_RVALUE_REFERENCES) && !defined(OVR_CPP_NO_RVALUE_REFERENCES)
+#  if (defined(__cplusplus) && (__cplusplus >= 201103L)) || defined(__GXX_EXPERIMENTAL_CXX0X__) || \
+      (defined(OVR_CC_MSVC) && (OVR_CC_MSVC >= 1600))
+#    define OVR_CPP_RVALUE_REFERENCES
+#  endif
+#endif
+
+#if !defined(OVR_CPP_VARIADIC_TEMPLATES) && !defined(OVR_CPP_NO_VARIADIC_TEMPLATES)
+#  if (defined(__cplusplus) && (__cplusplus >= 201103L)) || defined(__GXX_EXPERIMENTAL_CXX0X__) || \
+      (defined(OVR_CC_MSVC) && (OVR_CC_MSVC >= 1800))
+#    define OVR_CPP_VARIADIC_TEMPLATES
+#  endif
+#endif
+
+// OVR_CPP_ATOMIC_BUILTINS is defined if the compiler provides the C++11 memory
+// model __atomic builtins (GCC 4.7+, Clang); AtomicOps then uses them instead
+// of inline assembly and honors each operation's exact ordering.
+#if !defined(OVR_CPP_ATOMIC_BUILTINS) && !defined(OVR_CPP_NO_ATOMIC_BUILTINS)
+#  if defined(OVR_CC_GNU) && defined(__ATOMIC_ACQUIRE)
+#    define OVR_CPP_ATOMIC_BUILTINS
+#  endif
+#endif
+
+
 // *** Linux Unicode - must come before Standard Includes
 
 #ifdef OVR_OS_LINUX
@@ -27,9 +27,52 @@ limitations under the License.
 ************************************************************************************/
 
 #include "OVR_UTF8Util.h"
+#include <string.h>
+
+#if defined(OVR_CPU_SSE) && (defined(__SSE2__) || defined(OVR_CPU_X86_64) || defined(OVR_OS_WIN32))
+#define OVR_UTF8_SSE2
+#include <emmintrin.h>
+#if defined(__AVX2__)
+#define OVR_UTF8_AVX2
+#include <immintrin.h>
+#endif
+#endif
 
 namespace OVR { namespace UTF8Util {
 
+// Returns the number of bytes at the start of buf, up to size, below 0x80. Each
+// of those is one character, zeros included, in the length-limited functions.
+static UPInt ScanASCII(const char* buf, UPInt size)
+{
+    UPInt i = 0;
+#if defined(OVR_UTF8_AVX2)
+    for (; i + 32 <= size; i += 32)
+    {
+        if (_mm256_movemask_epi8(_mm256_loadu_si256((const __m256i*)(buf + i))))
+            break;
+    }
+#endif
+#if defined(OVR_UTF8_SSE2)
+    for (; i + 16 <= size; i += 16)
+    {
+        if (_mm_movemask_epi8(_mm_loadu_si128((const __m128i*)(buf + i))))
+            break;
+    }
+#else
+    for (; i + 8 <= size; i += 8)
+    {
+        UInt64 word;
+        memcpy(&word, buf + i, 8);
+        if (word & 0x8080808080808080)
+            break;
+    }
+#endif
+    // Finish within the block that stopped the scan.
+    while (i < size && !(buf[i] & 0x80))
+        i++;
+    return i;
+}
+
 SPInt OVR_STDCALL GetLength(const char* buf, SPInt buflen)
 {
     const char* p = buf;
@@ -39,6 +82,12 @@ SPInt OVR_STDCALL GetLength(const char* buf, SPInt buflen)
     {
         while (p - buf < buflen)
         {
+            SPInt ascii = (SPInt)ScanASCII(p, (UPInt)(buflen - (p - buf)));
+            p      += ascii;
+            length += ascii;
+            if (p - buf >= buflen)
+                break;
+
             // We should be able to have ASStrings with 0 in the middle.
             UTF8Util::DecodeNextChar_Advance0(&p);
             length++;
@@ -62,6 +111,18 @@ UInt32 OVR_STDCALL GetCharAt(SPInt index, const char* putf8str, SPInt length)
     {
         while (buf - putf8str < length)
         {           
+            SPInt ascii = (SPInt)ScanASCII(buf, (UPInt)(length - (buf - putf8str)));
+            if (ascii > index)
+                return (UInt32)buf[index];
+            if (ascii > 0)
+            {
+                buf   += ascii;
+                index -= ascii;
+                c      = (UInt32)buf[-1];
+                if (buf - putf8str >= length)
+                    break;
+            }
+
             c = UTF8Util::DecodeNextChar_Advance0(&buf);
             if (index == 0)
                 return c;
@@ -95,6 +156,13 @@ SPInt OVR_STDCALL GetByteIndex(SPInt index, const char *putf8str, SPInt length)
     {
         while ((buf - putf8str) < length && index > 0)
         {
+            SPInt left  = length - (buf - putf8str);
+            SPInt ascii = (SPInt)ScanASCII(buf, (UPInt)((index < left) ? index : left));
+            buf   += ascii;
+            index -= ascii;
+            if (index == 0 || (buf - putf8str) >= length)
+                break;
+
             UTF8Util::DecodeNextChar_Advance0(&buf);
             index--;
         }
@@ -349,6 +417,14 @@ UPInt OVR_STDCALL DecodeString(wchar_t *pbuff, const char* putf8str, SPInt bytes
         const char* p = putf8str;
         while ((p - putf8str) < bytesLen)
         {
+            UPInt ascii = ScanASCII(p, (UPInt)(bytesLen - (p - putf8str)));
+            for (UPInt i = 0; i < ascii; i++)
+                pbuff[i] = wchar_t(p[i]);
+            pbuff += ascii;
+            p     += ascii;
+            if ((p - putf8str) >= bytesLen)
+                break;
+
             UInt32 ch = DecodeNextChar_Advance0(&p);
             if (ch >= 0xFFFF)
                 ch = 0xFFFD;
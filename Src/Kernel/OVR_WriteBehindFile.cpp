@@ -0,0 +1,313 @@
+/************************************************************************************
+
+Filename    :   OVR_WriteBehindFile.cpp
+Content     :   File wrapper that performs writes on a background thread
+Created     :   October 14, 2026
+Notes       :
+
+Copyright   :   Copyright 2014 Oculus VR, Inc. All Rights reserved.
+
+Licensed under the Oculus VR Rift SDK License Version 3.1 (the "License");
+you may not use the Oculus VR Rift SDK except in compliance with the License,
+which is provided at the time of installation or download, or which
+otherwise accompanies this software in either electronic or hard copy form.
+
+You may obtain a copy of the License at
+
+http://www.oculusvr.com/licenses/LICENSE-3.1
+
+Unless required by applicable law or agreed to in writing, the Oculus VR SDK
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+************************************************************************************/
+
+#include "OVR_WriteBehindFile.h"
+#include "OVR_Alg.h"
+#include <string.h>
+
+#ifdef OVR_ENABLE_THREADS
+
+namespace OVR {
+
+
+WriteBehindFile::WriteBehindFile(File *pfile, int queueSize, bool blockWhenFull)
+  : DelegatedFile(pfile), pQueue(0), QueueSize(0), BlockWhenFull(blockWhenFull),
+    QueueHead(0), QueuedBytes(0), FullCount(0), WriteErrorCode(0), Stopping(false)
+{
+    if (queueSize > 0)
+        pQueue = (UByte*)OVR_ALLOC(queueSize);
+    if (pQueue)
+    {
+        QueueSize = queueSize;
+        pWriter   = *new Thread(writerThreadFn, this, 64 * 1024);
+        if (!pWriter->Start())
+            pWriter.Clear();
+    }
+}
+
+WriteBehindFile::~WriteBehindFile()
+{
+    stopWriter();
+    if (pQueue)
+        OVR_FREE(pQueue);
+}
+
+
+int WriteBehindFile::writerThreadFn(Thread* pthread, void* h)
+{
+    pthread->SetThreadName("OVR::WriteBehindFile");
+    ((WriteBehindFile*)h)->writerThread();
+    return 0;
+}
+
+void WriteBehindFile::writerThread()
+{
+    QueueMutex.DoLock();
+    for (;;)
+    {
+        while (QueuedBytes == 0 && !Stopping)
+            DataQueued.Wait(&QueueMutex);
+        if (QueuedBytes == 0)
+            break;
+
+        // Write the contiguous part at the head; the queued bytes stay counted until
+        // they are written, so an empty queue means nothing is in flight.
+        int head  = QueueHead;
+        int count = Alg::Min(QueuedBytes, QueueSize - head);
+        bool failed = (WriteErrorCode != 0);
+        QueueMutex.Unlock();
+
+        // After a failure the rest of the queue is dropped.
+        int errorCode = 0;
+        if (!failed && pFile->Write(pQueue + head, count) != count)
+        {
+            errorCode = pFile->GetErrorCode();
+            if (!errorCode)
+                errorCode = Error_IOError;
+        }
+
+        QueueMutex.DoLock();
+        if (errorCode)
+            WriteErrorCode = errorCode;
+        QueueHead    = (head + count) % QueueSize;
+        QueuedBytes -= count;
+        SpaceFreed.NotifyAll();
+    }
+    QueueMutex.Unlock();
+}
+
+void WriteBehindFile::stopWriter()
+{
+    if (!pWriter)
+        return;
+
+    QueueMutex.DoLock();
+    Stopping = true;
+    DataQueued.Notify();
+    QueueMutex.Unlock();
+
+    // The writer empties the queue before it exits.
+    while (!pWriter->IsFinished())
+        Thread::MSleep(1);
+    pWriter.Clear();
+}
+
+
+int WriteBehindFile::queueBytes(const UByte *pbuffer, int numBytes)
+{
+    int queued = 0;
+    bool wasFull = false;
+    while (queued < numBytes)
+    {
+        int space = QueueSize - QueuedBytes;
+        if (space == 0)
+        {
+            if (!wasFull)
+                FullCount++;
+            wasFull = true;
+            if (!BlockWhenFull || WriteErrorCode)
+                break;
+            SpaceFreed.Wait(&QueueMutex);
+            continue;
+        }
+
+        // Copy to the tail, wrapping around the end of the queue.
+        int tail  = (QueueHead + QueuedBytes) % QueueSize;
+        int count = Alg::Min(Alg::Min(space, numBytes - queued), QueueSize - tail);
+        memcpy(pQueue + tail, pbuffer + queued, count);
+
+        if (QueuedBytes == 0)
+            DataQueued.Notify();
+        QueuedBytes += count;
+        queued      += count;
+    }
+    return queued;
+}
+
+int WriteBehindFile::GetQueuedBytes()
+{
+    Mutex::Locker lock(&QueueMutex);
+    return QueuedBytes;
+}
+
+int WriteBehindFile::GetFullCount()
+{
+    Mutex::Locker lock(&QueueMutex);
+    return FullCount;
+}
+
+bool WriteBehindFile::WaitForQueue()
+{
+    if (!pWriter)
+        return true;
+
+    Mutex::Locker lock(&QueueMutex);
+    while (QueuedBytes > 0)
+        SpaceFreed.Wait(&QueueMutex);
+    return WriteErrorCode == 0;
+}
+
+
+// ** Overridden functions
+
+// Everything except writing needs the wrapped file to be up to date first.
+int WriteBehindFile::Tell()
+{
+    WaitForQueue();
+    return pFile->Tell();
+}
+
+SInt64 WriteBehindFile::LTell()
+{
+    WaitForQueue();
+    return pFile->LTell();
+}
+
+int WriteBehindFile::GetLength()
+{
+    WaitForQueue();
+    return pFile->GetLength();
+}
+
+SInt64 WriteBehindFile::LGetLength()
+{
+    WaitForQueue();
+    return pFile->LGetLength();
+}
+
+int WriteBehindFile::GetErrorCode()
+{
+    {
+        Mutex::Locker lock(&QueueMutex);
+        if (WriteErrorCode)
+            return WriteErrorCode;
+    }
+    return pFile->GetErrorCode();
+}
+
+int WriteBehindFile::Write(const UByte *pbuffer, int numBytes)
+{
+    if (!pWriter)
+        return pFile->Write(pbuffer, numBytes);
+
+    Mutex::Locker lock(&QueueMutex);
+    if (WriteErrorCode)
+        return -1;
+    return queueBytes(pbuffer, numBytes);
+}
+
+int WriteBehindFile::WriteGather(const FileIOVec* pvecs, int count)
+{
+    if (!pWriter)
+        return pFile->WriteGather(pvecs, count);
+
+    Mutex::Locker lock(&QueueMutex);
+    if (WriteErrorCode)
+        return -1;
+
+    int total = 0;
+    for (int i = 0; i < count; i++)
+    {
+        int queued = queueBytes(pvecs[i].pData, pvecs[i].Size);
+        total += queued;
+        if (queued < pvecs[i].Size)
+            break;
+    }
+    return total;
+}
+
+int WriteBehindFile::Read(UByte *pbuffer, int numBytes)
+{
+    WaitForQueue();
+    return pFile->Read(pbuffer, numBytes);
+}
+
+int WriteBehindFile::SkipBytes(int numBytes)
+{
+    WaitForQueue();
+    return pFile->SkipBytes(numBytes);
+}
+
+int WriteBehindFile::BytesAvailable()
+{
+    WaitForQueue();
+    return pFile->BytesAvailable();
+}
+
+bool WriteBehindFile::Flush()
+{
+    bool written = WaitForQueue();
+    return pFile->Flush() && written;
+}
+
+int WriteBehindFile::Seek(int offset, int origin)
+{
+    WaitForQueue();
+    return pFile->Seek(offset, origin);
+}
+
+SInt64 WriteBehindFile::LSeek(SInt64 offset, int origin)
+{
+    WaitForQueue();
+    return pFile->LSeek(offset, origin);
+}
+
+int WriteBehindFile::CopyFromStream(File *pstream, int byteSize)
+{
+    // Same as BufferedFile; the delegated CopyFromStream would bypass the queue.
+    UByte   buff[0x4000];
+    int     count = 0;
+    int     szRequest, szRead, szWritten;
+
+    while(byteSize)
+    {
+        szRequest = (byteSize > int(sizeof(buff))) ? int(sizeof(buff)) : byteSize;
+
+        szRead    = pstream->Read(buff,szRequest);
+        szWritten = 0;
+        if (szRead > 0)
+            szWritten = Write(buff,szRead);
+        if (szWritten < 0)
+            break;
+
+        count   +=szWritten;
+        byteSize-=szWritten;
+        if (szWritten < szRequest)
+            break;
+    }
+    return count;
+}
+
+bool WriteBehindFile::Close()
+{
+    stopWriter();
+    return pFile->Close();
+}
+
+
+} // OVR
+
+#endif // OVR_ENABLE_THREADS
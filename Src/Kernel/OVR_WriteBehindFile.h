@@ -0,0 +1,131 @@
+/************************************************************************************
+
+PublicHeader:   Kernel
+Filename    :   OVR_WriteBehindFile.h
+Content     :   File wrapper that performs writes on a background thread
+Created     :   October 14, 2026
+Notes       :
+
+Copyright   :   Copyright 2014 Oculus VR, Inc. All Rights reserved.
+
+Licensed under the Oculus VR Rift SDK License Version 3.1 (the "License");
+you may not use the Oculus VR Rift SDK except in compliance with the License,
+which is provided at the time of installation or download, or which
+otherwise accompanies this software in either electronic or hard copy form.
+
+You may obtain a copy of the License at
+
+http://www.oculusvr.com/licenses/LICENSE-3.1
+
+Unless required by applicable law or agreed to in writing, the Oculus VR SDK
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+************************************************************************************/
+
+#ifndef OVR_WriteBehindFile_h
+#define OVR_WriteBehindFile_h
+
+#include "OVR_File.h"
+#include "OVR_Threads.h"
+
+#ifdef OVR_ENABLE_THREADS
+
+namespace OVR {
+
+
+//-----------------------------------------------------------------------------------
+// ***** WriteBehindFile
+
+// WriteBehindFile copies written data into a bounded queue and returns, leaving a
+// background thread to write it to the wrapped file. It lets threads that can't
+// afford to block on the disk, such as the device thread, record data.
+//
+// When the queue is full, Write either waits for space or, if the file was created
+// with blockWhenFull = false, queues only what fits and returns that count, so that
+// a short count reports the back-pressure; GetFullCount tells how often that
+// happened. Errors from the background writes are reported by later calls.
+//
+// Every other operation (Read, Seek, Tell, Flush...) first waits for the queue to
+// be written out, so it is only cheap for files that are mostly appended to.
+// SysFile uses this wrapper for files opened with Open_WriteBehind.
+
+class WriteBehindFile : public DelegatedFile
+{
+public:
+    enum { DefaultQueueSize = 256 * 1024 };
+
+    // Takes the file to write to; if the queue or the thread can't be created
+    // writes are done directly.
+    WriteBehindFile(File *pfile, int queueSize = DefaultQueueSize, bool blockWhenFull = true);
+    ~WriteBehindFile();
+
+    // Bytes waiting in the queue, including those being written.
+    int                 GetQueuedBytes();
+    int                 GetQueueSize() const    { return QueueSize; }
+    // Number of writes that found the queue full.
+    int                 GetFullCount();
+
+    // Waits until every queued byte has been written; returns false if any failed.
+    bool                WaitForQueue();
+
+    // ** Overridden functions
+    virtual int         Tell();
+    virtual SInt64      LTell();
+
+    virtual int         GetLength();
+    virtual SInt64      LGetLength();
+
+    virtual int         GetErrorCode();
+
+    virtual int         Write(const UByte *pbuffer, int numBytes);
+    virtual int         WriteGather(const FileIOVec* pvecs, int count);
+    virtual int         Read(UByte *pbuffer, int numBytes);
+
+    virtual int         SkipBytes(int numBytes);
+
+    virtual int         BytesAvailable();
+
+    virtual bool        Flush();
+
+    virtual int         Seek(int offset, int origin=Seek_Set);
+    virtual SInt64      LSeek(SInt64 offset, int origin=Seek_Set);
+
+    virtual int         CopyFromStream(File *pstream, int byteSize);
+
+    virtual bool        Close();
+
+private:
+    static int          writerThreadFn(Thread* pthread, void* h);
+    void                writerThread();
+    // Copies as much of the buffer as the queue allows; QueueMutex must be held.
+    int                 queueBytes(const UByte *pbuffer, int numBytes);
+    void                stopWriter();
+
+    Ptr<Thread>         pWriter;
+    UByte*              pQueue;
+    int                 QueueSize;
+    bool                BlockWhenFull;
+
+    // Guarded by QueueMutex.
+    Mutex               QueueMutex;
+    WaitCondition       DataQueued;
+    WaitCondition       SpaceFreed;
+    int                 QueueHead;
+    int                 QueuedBytes;
+    int                 FullCount;
+    int                 WriteErrorCode;
+    bool                Stopping;
+
+    WriteBehindFile(const WriteBehindFile&);
+    void operator = (const WriteBehindFile&);
+};
+
+
+} // OVR
+
+#endif // OVR_ENABLE_THREADS
+
+#endif
@@ -27,9 +27,12 @@ limitations under the License.
 #include "OVR_CAPI.h"
 #include "Kernel/OVR_Timer.h"
 #include "Kernel/OVR_Math.h"
+#include "Kernel/OVR_ProfilingAllocator.h"
 #include "Kernel/OVR_System.h"
+#include "Kernel/OVR_Trace.h"
 #include "OVR_Stereo.h"
 #include "OVR_Profile.h"
+#include "OVR_PoseService.h"
 
 #include "CAPI/CAPI_GlobalState.h"
 #include "CAPI/CAPI_HMDState.h"
@@ -187,19 +190,8 @@ OVR_EXPORT double ovr_GetTimeInSeconds()
 // Waits until the specified absolute time.
 OVR_EXPORT double ovr_WaitTillTime(double absTime)
 {
-    volatile int i;
-    double       initialTime = ovr_GetTimeInSeconds();
-    double       newTime     = initialTime;
-    
-    while(newTime < absTime)
-    {
-        for (int j = 0; j < 50; j++)
-            i = 0;
-        newTime = ovr_GetTimeInSeconds();
-    }
-
-    // How long we waited
-    return newTime - initialTime;
+    // Sleeps most of the way and spins for the rest; returns how long we waited.
+    return Timer::WaitUntilSeconds(absTime);
 }
 
 //-------------------------------------------------------------------------------------
@@ -209,10 +201,35 @@ OVR_EXPORT double ovr_WaitTillTime(double absTime)
 static ovrBool CAPI_SystemInitCalled = 0;
 
 OVR_EXPORT ovrBool ovr_Initialize()
+{
+    return ovr_InitializeWithOptions(0);
+}
+
+// Converts thread options of ovrInitOptions; returns false if they leave the
+// scheduling as it is.
+static bool getSchedulingParams(ovrThreadSchedPolicy policy, int priority, uint64_t cpuMask,
+                                bool lockStack, Thread::SchedulingParams* params)
+{
+    switch(policy)
+    {
+    case ovrThreadSched_FIFO:       params->Policy = Thread::Sched_FIFO;       break;
+    case ovrThreadSched_RoundRobin: params->Policy = Thread::Sched_RoundRobin; break;
+    default:                        params->Policy = Thread::Sched_Normal;     break;
+    }
+    params->RealTimePriority = priority;
+    params->ProcessorMask    = cpuMask;
+    params->LockStack        = lockStack;
+
+    return params->Policy != Thread::Sched_Normal || params->ProcessorMask || params->LockStack;
+}
+
+OVR_EXPORT ovrBool ovr_InitializeWithOptions(const ovrInitOptions* options)
 {
     if (OVR::CAPI::GlobalState::pInstance)
         return 1;
 
+    UInt64 start = Timer::GetTicksNanos();
+
     // We must set up the system for the plugin to work
     if (!OVR::System::IsInitialized())
     {        
@@ -220,8 +237,44 @@ OVR_EXPORT ovrBool ovr_Initialize()
         CAPI_SystemInitCalled = 1;
     }
 
-    // Constructor detects devices
-    GlobalState::pInstance = new GlobalState;
+    Thread::SchedulingParams  sensorScheduling;
+    Thread::SchedulingParams* pSensorScheduling = 0;
+    if (options && getSchedulingParams(options->SensorThreadPolicy, options->SensorThreadPriority,
+                                       options->SensorThreadCpuMask,
+                                       options->SensorThreadLockStack != 0, &sensorScheduling))
+        pSensorScheduling = &sensorScheduling;
+
+    PoseService* poseService = 0;
+    if (options && options->PoseService == ovrPoseService_Publish)
+    {
+        poseService = PoseService::Create(PoseService::Mode_Publish);
+        if (!poseService)
+            LogError("ovr_Initialize - Failed to start the pose service.\n");
+    }
+    else if (options && options->PoseService == ovrPoseService_Subscribe)
+    {
+        poseService = PoseService::Create(PoseService::Mode_Subscribe);
+        if (!poseService)
+            LogText("ovr_Initialize - No pose service is running; tracking locally.\n");
+    }
+
+    // Constructor detects devices, unless deferred
+    bool deferDetection = options && options->DeferDetection;
+    GlobalState::pInstance = new GlobalState(pSensorScheduling, poseService, deferDetection);
+
+    if (options && options->FusionThread)
+    {
+        Thread::SchedulingParams fusionScheduling;
+        bool hasScheduling = getSchedulingParams(options->FusionThreadPolicy,
+                                                 options->FusionThreadPriority,
+                                                 options->FusionThreadCpuMask, false,
+                                                 &fusionScheduling);
+        GlobalState::pInstance->SetFusionThread(hasScheduling ? &fusionScheduling : 0);
+    }
+
+    LogText("ovr_Initialize - initialized in %.1f ms%s.\n",
+            (Timer::GetTicksNanos() - start) * 1e-6,
+            deferDetection ? ", detection deferred" : "");
     return 1;
 }
 
@@ -230,6 +283,11 @@ OVR_EXPORT void ovr_Shutdown()
     if (!GlobalState::pInstance)
        return;
 
+#ifdef OVR_ENABLE_TRACE
+    if (getenv("OVR_TRACE_FILE"))
+        OVR_TRACE_WRITE(NULL);
+#endif
+
     delete GlobalState::pInstance;
     GlobalState::pInstance = 0;
 
@@ -243,6 +301,29 @@ OVR_EXPORT void ovr_Shutdown()
 }
 
 
+OVR_EXPORT ovrBool ovr_GetPoseServiceFrameTiming(ovrFrameTiming* timing)
+{
+    if (!GlobalState::pInstance || !timing)
+        return 0;
+    PoseService* poseService = GlobalState::pInstance->GetPoseService();
+    if (!poseService || poseService->GetMode() != PoseService::Mode_Subscribe)
+        return 0;
+
+    PoseServiceFrameTiming shared;
+    if (!poseService->GetFrameTiming(&shared))
+        return 0;
+
+    timing->DeltaSeconds           = shared.DeltaSeconds;
+    timing->ThisFrameSeconds       = shared.ThisFrameSeconds;
+    timing->TimewarpPointSeconds   = shared.TimewarpPointSeconds;
+    timing->NextFrameSeconds       = shared.NextFrameSeconds;
+    timing->ScanoutMidpointSeconds = shared.ScanoutMidpointSeconds;
+    timing->EyeScanoutSeconds[0]   = shared.EyeScanoutSeconds[0];
+    timing->EyeScanoutSeconds[1]   = shared.EyeScanoutSeconds[1];
+    return 1;
+}
+
+
 // There is a thread safety issue with ovrHmd_Detect in that multiple calls from different
 // threads can corrupt the global array state. This would lead to two problems:
 //  a) Create(index) enumerator may miss or overshoot items. Probably not a big deal
@@ -380,6 +461,26 @@ OVR_EXPORT ovrSensorState ovrHmd_GetSensorState(ovrHmd hmd, double absTime)
     return p->PredictedSensorState(absTime);
 }
 
+OVR_EXPORT ovrSensorState ovrHmd_GetSensorStateBatch(ovrHmd hmd, const double* absTimes,
+                                                     ovrPoseStatef* predictedStatesOut,
+                                                     unsigned int count)
+{
+    HMDState* p = (HMDState*)hmd;
+    return p->PredictedSensorStateBatch(absTimes, predictedStatesOut, count);
+}
+
+OVR_EXPORT void ovrHmd_GetSensorStates(const ovrHmd* hmds, unsigned int count,
+                                       double absTime, ovrSensorState* statesOut)
+{
+    // Queries are lockless, so this costs no more than the calls made one by one,
+    // but all HMDs are predicted for the same time.
+    for (unsigned i = 0; i < count; i++)
+    {
+        HMDState* p = (HMDState*)hmds[i];
+        statesOut[i] = p->PredictedSensorState(absTime);
+    }
+}
+
 // Returns information about a sensor. Only valid after SensorStart.
 OVR_EXPORT ovrBool ovrHmd_GetSensorDesc(ovrHmd hmd, ovrSensorDesc* descOut)
 {
@@ -428,6 +529,22 @@ ovrBool ovrHmd_ConfigureRendering( ovrHmd hmd,
 
 
 
+OVR_EXPORT ovrBool ovrHmd_CreateSwapTextureSet(ovrHmd hmd, ovrSizei size, int textureCount,
+                                               ovrSwapTextureSet** outTextureSet)
+{
+    if (!outTextureSet) return 0;
+    *outTextureSet = 0;
+    if (!hmd) return 0;
+    return ((HMDState*)hmd)->CreateSwapTextureSet(size, textureCount, outTextureSet);
+}
+
+OVR_EXPORT void ovrHmd_DestroySwapTextureSet(ovrHmd hmd, ovrSwapTextureSet* textureSet)
+{
+    if (!hmd || !textureSet) return;
+    ((HMDState*)hmd)->DestroySwapTextureSet(textureSet);
+}
+
+
 // TBD: MA - Deprecated, need alternative
 void ovrHmd_SetVsync(ovrHmd hmd, ovrBool vsync)
 {
@@ -448,12 +565,14 @@ OVR_EXPORT ovrFrameTiming ovrHmd_BeginFrame(ovrHmd hmd, unsigned int frameIndex)
     }
 
     // Check: Proper configure and threading state for the call.
+    OVR_TRACE_SCOPE("ovrHmd_BeginFrame");
     hmds->checkRenderingConfigured("ovrHmd_BeginFrame");
     OVR_ASSERT_LOG(hmds->BeginFrameCalled == false, ("ovrHmd_BeginFrame called multiple times."));
     ThreadChecker::Scope checkScope(&hmds->RenderAPIThreadChecker, "ovrHmd_BeginFrame");
     
     hmds->BeginFrameCalled   = true;
     hmds->BeginFrameThreadId = OVR::GetCurrentThreadId();
+    ProfilingAllocator::SetFrameScope(true);
 
     return ovrHmd_BeginFrameTiming(hmd, frameIndex);
 }
@@ -465,10 +584,14 @@ OVR_EXPORT void ovrHmd_EndFrame(ovrHmd hmd)
     HMDState* hmds = (HMDState*)hmd;
     if (!hmds) return;
 
+    OVR_TRACE_SCOPE("ovrHmd_EndFrame");
     // Debug state checks: Must be in BeginFrame, on the same thread.
     hmds->checkBeginFrameScope("ovrHmd_EndFrame");
     ThreadChecker::Scope checkScope(&hmds->RenderAPIThreadChecker, "ovrHmd_EndFrame");  
 
+    // Eyes rendered on other threads are synchronized with here.
+    hmds->SubmitEyes();
+
     // TBD: Move directly into renderer
     bool dk2LatencyTest = (hmds->HMDInfo.HmdType == HmdType_DK2) &&
                            (hmds->EnabledHmdCaps & ovrHmdCap_LatencyTest);
@@ -481,6 +604,8 @@ OVR_EXPORT void ovrHmd_EndFrame(ovrHmd hmd)
 
     if (hmds->pRenderer)
 	{
+        hmds->TimeManager.SubmitFrame();
+
 		hmds->pRenderer->SaveGraphicsState();
         hmds->pRenderer->EndFrame(true,
                                   hmds->LatencyTestActive ? hmds->LatencyTestDrawColor : NULL,
@@ -490,6 +615,9 @@ OVR_EXPORT void ovrHmd_EndFrame(ovrHmd hmd)
                                   //hmds->LatencyTest2Active ? hmds->LatencyTest2DrawColor : NULL
 								  );
 		hmds->pRenderer->RestoreGraphicsState();
+
+        if (hmds->LatencyTestActive)
+            hmds->pLatencyUtil->OnColorSubmitted(hmds->pRenderer->GetLatencyQuadSubmitSeconds());
     }
     // Call after present
     ovrHmd_EndFrameTiming(hmd);
@@ -503,6 +631,7 @@ OVR_EXPORT void ovrHmd_EndFrame(ovrHmd hmd)
     // Out of BeginFrame
     hmds->BeginFrameThreadId = 0;
     hmds->BeginFrameCalled   = false;
+    ProfilingAllocator::SetFrameScope(false);
 }
 
 
@@ -521,6 +650,15 @@ OVR_EXPORT void ovrHmd_EndEyeRender(ovrHmd hmd, ovrEyeType eye,
     hmds->EndEyeRender(eye, renderPose, eyeTexture);
 }
 
+OVR_EXPORT void ovrHmd_EndEyeRenderDepth(ovrHmd hmd, ovrEyeType eye,
+                                         ovrPosef renderPose, ovrTexture* eyeTexture,
+                                         ovrTexture* depthTexture, const ovrMatrix4f* projection)
+{
+    HMDState* hmds = (HMDState*)hmd;
+    if (!hmds) return;
+    hmds->EndEyeRender(eye, renderPose, eyeTexture, depthTexture, projection);
+}
+
 
 //-------------------------------------------------------------------------------------
 // ***** Frame Timing logic
@@ -567,6 +705,9 @@ OVR_EXPORT ovrFrameTiming ovrHmd_BeginFrameTiming(ovrHmd hmd, unsigned int frame
                     ("ovrHmd_BeginFrameTiming called multiple times."));    
     hmds->BeginFrameTimingCalled = true;
 
+    // Picks up profile changes once a frame, for apps that don't read properties.
+    hmds->updateProfile();
+
     double thisFrameTime = hmds->TimeManager.BeginFrame(frameIndex);        
 
     const FrameTimeManager::Timing &frameTiming = hmds->TimeManager.GetFrameTiming();
@@ -585,6 +726,22 @@ OVR_EXPORT ovrFrameTiming ovrHmd_BeginFrameTiming(ovrHmd hmd, unsigned int frame
     if (f.DeltaSeconds > 1.0f)
         f.DeltaSeconds = 1.0f;
 
+    // Lets the other subscribers of the pose service follow our frames.
+    PoseService* poseService = GlobalState::pInstance->GetPoseService();
+    if (poseService && poseService->GetMode() == PoseService::Mode_Subscribe)
+    {
+        PoseServiceFrameTiming shared;
+        shared.FrameIndex             = frameIndex;
+        shared.DeltaSeconds           = f.DeltaSeconds;
+        shared.ThisFrameSeconds       = f.ThisFrameSeconds;
+        shared.TimewarpPointSeconds   = f.TimewarpPointSeconds;
+        shared.NextFrameSeconds       = f.NextFrameSeconds;
+        shared.ScanoutMidpointSeconds = f.ScanoutMidpointSeconds;
+        shared.EyeScanoutSeconds[0]   = f.EyeScanoutSeconds[0];
+        shared.EyeScanoutSeconds[1]   = f.EyeScanoutSeconds[1];
+        poseService->PublishFrameTiming(shared);
+    }
+
     return f;
 }
 
@@ -618,6 +775,44 @@ OVR_EXPORT void ovrHmd_ResetFrameTiming(ovrHmd hmd,  unsigned int frameIndex)
 
 
 
+OVR_EXPORT double ovrHmd_GetRecommendedFrameStart(ovrHmd hmd)
+{
+    HMDState* hmds = (HMDState*)hmd;
+    double    now  = ovr_GetTimeInSeconds();
+    if (!hmds) return now;
+
+    return hmds->TimeManager.GetRecommendedFrameStart(now);
+}
+
+
+OVR_EXPORT unsigned int ovrHmd_GetFrameHistory(ovrHmd hmd, ovrFrameRecord* records,
+                                               unsigned int maxRecords)
+{
+    HMDState* hmds = (HMDState*)hmd;
+    if (!hmds || !records) return 0;
+
+    return hmds->TimeManager.GetFrameHistory(records, maxRecords);
+}
+
+
+OVR_EXPORT void ovrHmd_SetDynamicResolution(ovrHmd hmd, float minScale)
+{
+    HMDState* hmds = (HMDState*)hmd;
+    if (!hmds) return;
+
+    hmds->TimeManager.SetDynamicResolution(minScale);
+}
+
+
+OVR_EXPORT float ovrHmd_GetRenderViewportScale(ovrHmd hmd)
+{
+    HMDState* hmds = (HMDState*)hmd;
+    if (!hmds) return 1.0f;
+
+    return hmds->TimeManager.GetRenderViewportScale();
+}
+
+
 OVR_EXPORT ovrPosef ovrHmd_GetEyePose(ovrHmd hmd, ovrEyeType eye)
 {
     HMDState* hmds = (HMDState*)hmd;
@@ -685,9 +880,6 @@ OVR_EXPORT ovrBool ovrHmd_CreateDistortionMesh( ovrHmd hmd,
         return 0;
     HMDState* hmds = (HMDState*)hmd;
 
-    // Not used now, but Chromatic flag or others could possibly be checked for in the future.
-    OVR_UNUSED1(distortionCaps); 
-    
 #if defined (OVR_OS_WIN32)
     // TBD: We should probably be sharing some C API structures with C++ to avoid this mess...
     OVR_COMPILER_ASSERT(sizeof(DistortionMeshVertexData)                       == sizeof(ovrDistortionVertex));
@@ -700,33 +892,18 @@ OVR_EXPORT ovrBool ovrHmd_CreateDistortionMesh( ovrHmd hmd,
 #endif
 
 
-    // *** Calculate a part of "StereoParams" needed for mesh generation
-
-    // Note that mesh distortion generation is invariant of RenderTarget UVs, allowing
-    // render target size and location to be changed after the fact dynamically. 
-    // eyeToSourceUV is computed here for convenience, so that users don't need
-    // to call ovrHmd_GetRenderScaleAndOffset unless changing RT dynamically.
-
-    const HmdRenderInfo&  hmdri          = hmds->RenderState.RenderInfo;    
-    StereoEye             stereoEye      = (eyeType == ovrEye_Left) ? StereoEye_Left : StereoEye_Right;
-
-    const DistortionRenderDesc& distortion = hmds->RenderState.Distortion[eyeType];
-
-    // Find the mapping from TanAngle space to target NDC space.
-    ScaleAndOffset2D      eyeToSourceNDC = CreateNDCScaleAndOffsetFromFov(fov);
-
     int triangleCount = 0;
     int vertexCount = 0;
 
-    DistortionMeshCreate((DistortionMeshVertexData**)&meshData->pVertexData, (UInt16**)&meshData->pIndexData,
-                          &vertexCount, &triangleCount,
-                          (stereoEye == StereoEye_Right),
-                          hmdri, distortion, eyeToSourceNDC);
+    hmds->RenderState.CreateDistortionMesh((DistortionMeshVertexData**)&meshData->pVertexData,
+                                           (UInt16**)&meshData->pIndexData,
+                                           &vertexCount, &triangleCount, eyeType, fov, distortionCaps);
 
     if (meshData->pVertexData)
     {
         // Convert to index
-        meshData->IndexCount = triangleCount * 3;
+        meshData->IndexCount = (distortionCaps & ovrDistortionCap_TriangleStrip) ?
+                               triangleCount + 2 : triangleCount * 3;
         meshData->VertexCount = vertexCount;
         return 1;
     }
@@ -783,7 +960,7 @@ OVR_EXPORT ovrBool ovrHmd_GetLatencyTestDrawColor(ovrHmd hmd, unsigned char rgbC
 OVR_EXPORT const char*  ovrHmd_GetLatencyTestResult(ovrHmd hmd)
 {
     HMDState* p = (HMDState*)hmd;
-    return p->LatencyUtil.GetResultsString();
+    return p->pLatencyUtil ? p->pLatencyUtil->GetResultsString() : NULL;
 }
 
 OVR_EXPORT double ovrHmd_GetMeasuredLatencyTest2(ovrHmd hmd)
@@ -897,7 +1074,8 @@ OVR_EXPORT unsigned int ovrHmd_GetArraySize(ovrHmd hmd, const char* propertyName
     if (hmds && hmds->pHMD)
     {
         // For now, just access the profile.
-        Profile* p = hmds->pHMD->GetProfile();
+        hmds->updateProfile();
+        Profile* p = hmds->pProfile;
         
         if (p)
             return p->GetNumValues(propertyName);
@@ -905,6 +1083,37 @@ OVR_EXPORT unsigned int ovrHmd_GetArraySize(ovrHmd hmd, const char* propertyName
     return 0;
 }
 
+OVR_EXPORT int ovrHmd_GetPropertyId(ovrHmd hmd, const char* propertyName)
+{
+    HMDState* hmds = (HMDState*)hmd;
+    if (hmds)
+    {
+        return hmds->getPropertyId(propertyName);
+    }
+    return -1;
+}
+
+OVR_EXPORT float ovrHmd_GetFloatById(ovrHmd hmd, int propertyId, float defaultVal)
+{
+    HMDState* hmds = (HMDState*)hmd;
+    if (hmds)
+    {
+        return hmds->getFloatValueById(propertyId, defaultVal);
+    }
+    return defaultVal;
+}
+
+OVR_EXPORT unsigned int ovrHmd_GetFloatArrayById(ovrHmd hmd, int propertyId,
+                                                 float values[], unsigned int arraySize)
+{
+    HMDState* hmds = (HMDState*)hmd;
+    if (hmds)
+    {
+        return hmds->getFloatArrayById(propertyId, values, arraySize);
+    }
+    return 0;
+}
+
 
 #ifdef __cplusplus 
 } // extern "C"
@@ -167,7 +167,57 @@ typedef enum
 {        
     ovrDistortionCap_Chromatic	= 0x01,		//	Supports chromatic aberration correction.
     ovrDistortionCap_TimeWarp	= 0x02,		//	Supports timewarp.
-    ovrDistortionCap_Vignette	= 0x08		//	Supports vignetting around the edges of the view.
+    ovrDistortionCap_Vignette	= 0x08,		//	Supports vignetting around the edges of the view.
+
+    // Distortion mesh generation options. The mesh grid size is the "DistortionMeshGridSizeLog2"
+    // float property (2 to 7, 6 by default), read when the mesh is created.
+    ovrDistortionCap_AdaptiveMesh   = 0x20, // Spaces the mesh grid by the curvature of the distortion.
+    ovrDistortionCap_TriangleStrip  = 0x40, // Mesh indices form one triangle strip instead of a list.
+
+    // With ovrDistortionCap_TimeWarp, the SDK distortion renderer passes the timewarp
+    // rotations to its shader as quaternions and rotates by them there, instead of
+    // building matrices on the CPU. Renderers that don't support it ignore it.
+    ovrDistortionCap_TimeWarpQuaternions = 0x80,
+
+    // Tells the SDK distortion renderer the graphics state the app has when calling
+    // ovrHmd_EndFrame is the same every frame, so it reads the state to restore only
+    // once instead of on every frame. Renderers that don't support it ignore it.
+    ovrDistortionCap_CachedGraphicsState = 0x100,
+
+    // With ovrDistortionCap_TimeWarp, the SDK distortion renderer distorts and
+    // presents on a thread of its own, just before every vsync, with the latest
+    // eye textures submitted and the latest sensor data; ovrHmd_EndFrame only
+    // hands the frame over. GL on Linux only, where the app must have called
+    // XInitThreads; elsewhere it is ignored.
+    ovrDistortionCap_AsyncTimeWarp = 0x200,
+
+    // With ovrDistortionCap_TimeWarp and ovrDistortionCap_TimeWarpQuaternions, a
+    // thread of the SDK distortion renderer keeps writing the predicted orientations
+    // into a persistently mapped buffer that the distortion shaders read when they
+    // run, instead of the renderer sampling them when it issues the draw. GL 4.4 or
+    // ARB_buffer_storage only; elsewhere it is ignored.
+    ovrDistortionCap_LateLatchedPose = 0x400,
+
+    // The SDK distortion renderer distorts every pixel in a fragment shader drawn
+    // over each eye's half of the screen, reading the lens function from a table
+    // texture, instead of drawing a distortion mesh; the mesh options are ignored.
+    // GL 3.2 only; elsewhere the mesh is drawn as usual.
+    ovrDistortionCap_PixelDistortion = 0x800,
+
+    // With ovrDistortionCap_TimeWarp and ovrDistortionCap_TimeWarpQuaternions, the
+    // SDK distortion renderer predicts several orientations over each eye's
+    // scan-out, instead of only its start and end, and rotates each band of
+    // scanlines by the ones around the time it is shown; this follows fast head
+    // turns on rolling-scan displays more closely. Eyes are then drawn one at a
+    // time. GL only, and not with ovrDistortionCap_LateLatchedPose; elsewhere it
+    // is ignored.
+    ovrDistortionCap_TimeWarpSamples = 0x1000,
+
+    // With ovrDistortionCap_TimeWarp and ovrDistortionCap_PixelDistortion, eyes
+    // submitted with their depth by ovrHmd_EndEyeRenderDepth are also reprojected
+    // for the head having moved since they were rendered, not just turned. GL
+    // only; elsewhere it is ignored.
+    ovrDistortionCap_PositionalTimeWarp = 0x2000
 } ovrDistortionCaps;
 
 
@@ -309,6 +359,31 @@ typedef struct ovrFrameTiming_
 } ovrFrameTiming;
 
 
+// Record of a past frame, as returned by ovrHmd_GetFrameHistory(). Times are
+// absolute, in ovr_GetTimeInSeconds().
+typedef struct ovrFrameRecord_
+{
+    // Index passed to ovrHmd_BeginFrame or ovrHmd_BeginFrameTiming.
+    unsigned int    FrameIndex;
+    // When the frame began, and when ovrHmd_EndFrame or ovrHmd_EndFrameTiming
+    // recorded it as presented.
+    double          BeginFrameSeconds;
+    double          EndFrameSeconds;
+    // When the frame was predicted to start scanning out as it began, and when it
+    // did going by its end and the measured screen delay.
+    double          PredictedScanoutSeconds;
+    double          ScanoutSeconds;
+    // GPU time of the SDK distortion rendering measured during the frame, or 0.
+    float           DistortionGpuSeconds;
+    // How much later than the timewarp point the wait for it ended, or 0 if
+    // there was no wait.
+    float           TimewarpWaitErrorSeconds;
+    // DK2 latency tester results as of the frame, as the "DK2Latency" property:
+    // render, timewarp and post-present latency; zeros without results.
+    float           LatencySeconds[3];
+} ovrFrameRecord;
+
+
 
 // Rendering information for each eye, computed by either ovrHmd_ConfigureRendering().
 // or ovrHmd_GetRenderDesc() based on the specified Fov.
@@ -408,6 +483,55 @@ typedef struct ovrTexture_
 //  10. ovr_Shutdown()
 //
 
+// Scheduling policy of the sensor thread, used in ovrInitOptions.
+typedef enum
+{
+    ovrThreadSched_Normal     = 0,  // Default time-sharing scheduling.
+    ovrThreadSched_FIFO       = 1,  // Real-time, SCHED_FIFO.
+    ovrThreadSched_RoundRobin = 2   // Real-time, SCHED_RR.
+} ovrThreadSchedPolicy;
+
+// Sharing of sensor tracking between processes, used in ovrInitOptions.
+typedef enum
+{
+    ovrPoseService_None      = 0,  // The process tracks the HMD itself.
+    ovrPoseService_Publish   = 1,  // Tracks the HMD and publishes its poses to subscribers.
+    ovrPoseService_Subscribe = 2   // Reads the poses of a publishing process instead of
+                                   // opening the sensor; tracks the HMD itself if none runs.
+} ovrPoseServiceMode;
+
+// Options for ovr_InitializeWithOptions, controlling the background thread that reads
+// and processes sensor data. Zero-initialized options match ovr_Initialize.
+// Real-time scheduling and stack locking need privileges (CAP_SYS_NICE or RLIMIT_RTPRIO,
+// RLIMIT_MEMLOCK); failures are logged and initialization continues. Linux only.
+typedef struct ovrInitOptions_
+{
+    ovrThreadSchedPolicy SensorThreadPolicy;
+    // Real-time priority, 1 (lowest) to 99; ignored for ovrThreadSched_Normal.
+    int                  SensorThreadPriority;
+    // Bit i allows the thread to run on CPU i; 0 leaves affinity unchanged.
+    // Combine with an isolated core (isolcpus) to run sensor processing undisturbed.
+    uint64_t             SensorThreadCpuMask;
+    // Locks the thread's stack in memory so that it can't page fault.
+    ovrBool              SensorThreadLockStack;
+    // Lets several processes, such as a renderer and an audio engine, follow one HMD:
+    // a service process publishes, the others subscribe. Only the first HMD is shared,
+    // and all processes must use the same SDK build and run as the same user.
+    ovrPoseServiceMode   PoseService;
+    // Defers HID enumeration and profile loading from initialization to the first
+    // ovrHmd_Detect or ovrHmd_Create, so that initialization returns sooner.
+    ovrBool              DeferDetection;
+    // Runs sensor fusion on a thread of its own, so that the sensor thread only reads
+    // and queues the readings and keeps up with the HMD; the fusion thread integrates
+    // them in batches. It is scheduled like the sensor thread above, with the options
+    // below, so that it can be pinned to another CPU.
+    ovrBool              FusionThread;
+    ovrThreadSchedPolicy FusionThreadPolicy;
+    int                  FusionThreadPriority;
+    uint64_t             FusionThreadCpuMask;
+} ovrInitOptions;
+
+
 #ifdef __cplusplus 
 extern "C" {
 #endif
@@ -415,8 +539,16 @@ extern "C" {
 // Library init/shutdown, must be called around all other OVR code.
 // No other functions calls are allowed before ovr_Initialize succeeds or after ovr_Shutdown.
 OVR_EXPORT ovrBool  ovr_Initialize();
+// Same as ovr_Initialize, with options; options may be null.
+OVR_EXPORT ovrBool  ovr_InitializeWithOptions(const ovrInitOptions* options);
 OVR_EXPORT void     ovr_Shutdown();
 
+// For ovrPoseService_Subscribe: gets the timing of the frame being rendered by the
+// subscriber that renders, which is the first one to call ovrHmd_BeginFrameTiming,
+// so that processes that don't render can predict for the same display time.
+// Returns false if there is no such timing.
+OVR_EXPORT ovrBool  ovr_GetPoseServiceFrameTiming(ovrFrameTiming* timing);
+
 
 // Detects or re-detects HMDs and reports the total number detected.
 // Users can get information about each HMD by calling ovrHmd_Create with an index.
@@ -479,6 +611,20 @@ OVR_EXPORT void     ovrHmd_ResetSensor(ovrHmd hmd);
 // This may also be used for more refined timing of FrontBuffer rendering logic, etc.
 OVR_EXPORT ovrSensorState ovrHmd_GetSensorState(ovrHmd hmd, double absTime);
 
+// Batch version of ovrHmd_GetSensorState, intended for rolling-shutter style rendering that
+// needs a pose per scanline band. Predicts a pose for each of count absTimes from a single
+// sensor snapshot and writes them to predictedStatesOut, which must hold count entries.
+// Returns the full sensor state for absTimes[0]; its Predicted member equals predictedStatesOut[0].
+OVR_EXPORT ovrSensorState ovrHmd_GetSensorStateBatch(ovrHmd hmd, const double* absTimes,
+                                                     ovrPoseStatef* predictedStatesOut,
+                                                     unsigned int count);
+
+// Multi-HMD version of ovrHmd_GetSensorState, for applications driving several HMDs:
+// predicts the state of each of count hmds for the same absTime, in one call, and
+// writes them to statesOut, which must hold count entries.
+OVR_EXPORT void        ovrHmd_GetSensorStates(const ovrHmd* hmds, unsigned int count,
+                                              double absTime, ovrSensorState* statesOut);
+
 // Returns information about a sensor.
 // Only valid after StartSensor.
 OVR_EXPORT ovrBool     ovrHmd_GetSensorDesc(ovrHmd hmd, ovrSensorDesc* descOut);
@@ -512,11 +658,18 @@ OVR_EXPORT ovrSizei ovrHmd_GetFovTextureSize(ovrHmd hmd, ovrEyeType eye, ovrFovP
 //  the render thread, which is the same thread that calls ovrHmd_BeginFrame
 //  or ovrHmd_BeginFrameTiming.
 //    - ovrHmd_EndFrame
-//    - ovrHmd_BeginEyeRender
-//    - ovrHmd_EndEyeRender
 //    - ovrHmd_GetFramePointTime
 //    - ovrHmd_GetEyePose
 //    - ovrHmd_GetEyeTimewarpMatrices
+//
+//  The exception is ovrHmd_BeginEyeRender and ovrHmd_EndEyeRender: each eye may be
+//  rendered on a thread of its own, such as one with a context sharing objects
+//  with the render thread's, and both at the same time. ovrHmd_GetEyePose may
+//  then be called for an eye on the thread rendering it. The calls for one eye
+//  must come from one thread, between ovrHmd_BeginFrame and ovrHmd_EndFrame, which
+//  waits for eyes still being rendered. The eye textures are only used by
+//  ovrHmd_EndFrame, so the eye threads must make their rendering visible to the
+//  render thread first, as with glFlush and a fence it waits for.
 
 
 //-------------------------------------------------------------------------------------
@@ -557,7 +710,8 @@ OVR_EXPORT ovrFrameTiming ovrHmd_BeginFrame(ovrHmd hmd, unsigned int frameIndex)
 OVR_EXPORT void     ovrHmd_EndFrame(ovrHmd hmd);
 
 
-// Marks beginning of eye rendering. Must be called on the same thread as BeginFrame.
+// Marks beginning of eye rendering. Called on the same thread as BeginFrame, or on the
+// thread rendering the eye (see Rendering API Thread Safety).
 // This function uses ovrHmd_GetEyePose to predict sensor state that should be
 // used rendering the specified eye.
 // This combines current absolute time with prediction that is appropriate for this HMD.
@@ -575,6 +729,41 @@ OVR_EXPORT ovrPosef ovrHmd_BeginEyeRender(ovrHmd hmd, ovrEyeType eye);
 OVR_EXPORT void     ovrHmd_EndEyeRender(ovrHmd hmd, ovrEyeType eye,
                                         ovrPosef renderPose, ovrTexture* eyeTexture);
 
+// ovrHmd_EndEyeRender for ovrDistortionCap_PositionalTimeWarp: also submits the depth
+// buffer the eye was rendered with, which must have the size and viewport of
+// eyeTexture, and the projection that wrote it, as ovrMatrix4f_Projection makes,
+// with GL's default depth range. Its units must be those of the poses, meters.
+// It is sampled with the filtering it has, which must not need mipmaps or compare.
+// Without the cap, or with a null depthTexture, this is ovrHmd_EndEyeRender.
+OVR_EXPORT void     ovrHmd_EndEyeRenderDepth(ovrHmd hmd, ovrEyeType eye,
+                                             ovrPosef renderPose, ovrTexture* eyeTexture,
+                                             ovrTexture* depthTexture, const ovrMatrix4f* projection);
+
+
+// A ring of eye render targets allocated by ovrHmd_CreateSwapTextureSet.
+typedef struct ovrSwapTextureSet_
+{
+    ovrTexture* Textures;
+    int         TextureCount;
+    // Texture to render the eye into next. The application advances it after
+    // submitting Textures[CurrentIndex], so that it doesn't render into a texture
+    // that distortion may still be reading.
+    int         CurrentIndex;
+} ovrSwapTextureSet;
+
+// Allocates textureCount color textures of the given size to render eyes into.
+// The distortion renderer sets them up once, with their sampler state, and keeps
+// them for as long as the set exists, so that submitting one with
+// ovrHmd_EndEyeRender doesn't wrap and bind a new texture every frame. Their
+// RenderViewport starts as the whole texture and may be changed per frame.
+// Must be called on the render thread after ovrHmd_ConfigureRendering, with its
+// context current. Returns false if the rendering API doesn't support it.
+// The textures are released by ovrHmd_DestroySwapTextureSet, or when rendering is
+// shut down or configured for another API.
+OVR_EXPORT ovrBool  ovrHmd_CreateSwapTextureSet(ovrHmd hmd, ovrSizei size, int textureCount,
+                                                ovrSwapTextureSet** outTextureSet);
+OVR_EXPORT void     ovrHmd_DestroySwapTextureSet(ovrHmd hmd, ovrSwapTextureSet* textureSet);
+
 
 
 //-------------------------------------------------------------------------------------
@@ -635,6 +824,9 @@ typedef struct ovrDistortionMesh_
 // Users should call ovrHmd_GetRenderScaleAndOffset to get uvScale and Offset values for rendering.
 // The function shouldn't fail unless theres is a configuration or memory error, in which case
 // ovrDistortionMesh values will be set to null.
+// Recently generated meshes are cached, so asking again for one with the same FOV and
+// caps returns a copy without recomputing it. If the OVR_DISTORTION_MESH_CACHE environment
+// variable names a file, the cache is also kept there between runs.
 OVR_EXPORT ovrBool  ovrHmd_CreateDistortionMesh( ovrHmd hmd,
                                                  ovrEyeType eyeType, ovrFovPort fov,
                                                  unsigned int distortionCaps,
@@ -670,6 +862,35 @@ OVR_EXPORT void     ovrHmd_EndFrameTiming(ovrHmd hmd);
 // isn't called. Resets internal frame index to the specified number.
 OVR_EXPORT void     ovrHmd_ResetFrameTiming(ovrHmd hmd, unsigned int frameIndex);
 
+// Returns the latest absolute time, in ovr_GetTimeInSeconds, at which the app can
+// begin its next frame and still have it shown at the first vsync it can make. The
+// SDK models the vsync phase from presentation timestamps where the graphics API
+// has them (GLX_OML_sync_control with the GL renderer on Linux) and from the
+// times frames were presented otherwise, and learns how long frames take between
+// ovrHmd_BeginFrame and ovrHmd_EndFrame. Waiting for the time with ovr_WaitTillTime
+// before ovrHmd_BeginFrame shortens the time from input to scan-out. Returns the
+// current time while it doesn't know enough, without vsync, and with game-side
+// distortion rendering, where it can't tell rendering from waiting for the vsync.
+OVR_EXPORT double   ovrHmd_GetRecommendedFrameStart(ovrHmd hmd);
+
+// Copies the records of up to maxRecords of the most recent frames into records,
+// oldest first, and returns how many were copied; the SDK keeps the last 127 (31 in
+// builds with OVR_COMPACT_HMD_STATE).
+// Thread-safe, and never holds up the render thread, which may be recording a new
+// frame meanwhile: records overwritten during the copy are left out.
+OVR_EXPORT unsigned int ovrHmd_GetFrameHistory(ovrHmd hmd, ovrFrameRecord* records,
+                                               unsigned int maxRecords);
+
+// Dynamic resolution: with a minScale below 1, the SDK adjusts a scale for the eye
+// viewports from minScale to 1 at every ovrHmd_EndFrame or ovrHmd_EndFrameTiming,
+// lowering it at once when the GPU falls behind the display and raising it slowly
+// while it keeps up. The app renders each eye into its viewport scaled by
+// ovrHmd_GetRenderViewportScale within the unchanged render target, and passes that
+// viewport in its ovrTexture with SDK distortion or to ovrHmd_GetRenderScaleAndOffset
+// otherwise. A minScale of 1 or more turns it off; it is off by default.
+OVR_EXPORT void     ovrHmd_SetDynamicResolution(ovrHmd hmd, float minScale);
+OVR_EXPORT float    ovrHmd_GetRenderViewportScale(ovrHmd hmd);
+
 
 // Predicts and returns Pose that should be used rendering the specified eye.
 // Must be called between ovrHmd_BeginFrameTiming & ovrHmd_EndFrameTiming.
@@ -716,6 +937,11 @@ OVR_EXPORT ovrBool      ovrHmd_ProcessLatencyTest(ovrHmd hmd, unsigned char rgbC
 
 // Returns non-null string once with latency test result, when it is available.
 // Buffer is valid until next call.
+// Setting the "LatencyTestContinuous" float property to 1 instead measures continuously,
+// without the button, while the SDK renders distortion. Results of the latest measurements
+// are then read through ovrHmd_GetFloatArray: "LatencyTestStats" gives { count, min, mean,
+// median, 99th percentile, max, submit-to-photon mean } in milliseconds, and
+// "LatencyTestHistogram" the count in each 1 ms bucket.
 OVR_EXPORT const char*  ovrHmd_GetLatencyTestResult(ovrHmd hmd);
 
 // Returns latency for HMDs that support internal latency testing via the
@@ -759,11 +985,41 @@ OVR_EXPORT double       ovrHmd_GetMeasuredLatencyTest2(ovrHmd hmd);
 OVR_EXPORT float       ovrHmd_GetFloat(ovrHmd hmd, const char* propertyName, float defaultVal);
 
 // Modify float property; false if property doesn't exist or is readonly.
+// "DistortionMeshGridSizeLog2" sets the distortion mesh density for meshes created afterwards,
+// including by the next ovrHmd_ConfigureRendering; see ovrDistortionCap_AdaptiveMesh.
+// In builds with OVR_ENABLE_TRACE, setting "TraceWrite" writes the internal event timeline
+// to the file named by the OVR_TRACE_FILE environment variable, or ovr_trace.json.
+// "IdleReadTimeout" and "IdleMotionTimeout" lower the sensor report rate once no sensor
+// state has been read, or the headset hasn't moved, for that many seconds; the full rate
+// is back within a frame of the next read or movement. Both are 0, off, by default.
+// "PredictionModel" selects how poses are predicted past the latest reading: 0, the default,
+// shortens the prediction at low speeds; 1 extrapolates at constant velocity; 2 at constant
+// acceleration; 3 at constant acceleration from Kalman-filtered velocities, which stays stable
+// for longer predictions. "PredictionFilterTime" is the time constant, in seconds, of that
+// filter; 0.02 by default.
 OVR_EXPORT ovrBool      ovrHmd_SetFloat(ovrHmd hmd, const char* propertyName, float value);
 
 
 // Get float[] property. Returns the number of elements filled in, 0 if property doesn't exist.
 // Maximum of arraySize elements will be written.
+// Performance counters are read with their "perf.*" names, such as "perf.hid.readToDispatch",
+// as { sample count, mean, max } since the process started; times are in seconds. Latency
+// counters follow these with a histogram of 16 sample counts, in buckets whose bounds
+// double from 1/16 ms; the last also counts longer latencies. The "perf.latency.sampleTo*"
+// counters time IMU samples from the sample time, as converted to system time, to:
+// "Receive" the report being read, "Fusion" the fusion integrating it, "Publish" its
+// state being published, "PoseRead" its pose read by ovrHmd_GetEyePose, "Timewarp" its
+// pose sampled by timewarp, and "PredictedScanout" and, measured on DK2, "Scanout" the
+// scan-out of the frame. Sample times are aligned with the quickest reports received, so
+// the fixed part of the USB transfer isn't counted. "perf.hid.readToDispatch" has the
+// histogram as well.
+// "TimeSyncStats" reports how the sensor clock is synchronized: { drift, current correction
+// rate (both in seconds per second), last, mean and max jitter (in seconds), windows
+// measured, filter resets }; see SensorTimeSyncStats.
+// "MemoryFootprint" reports the bytes used by the HMD: { total, sensor fusion, of which its
+// state and pose history, sensor filters, exposure records, fusion queue and magnetometer
+// references, frame timing, render state, latency tester, pose stream, properties }. Builds
+// with OVR_COMPACT_HMD_STATE keep shorter histories, for systems with many HMDs.
 OVR_EXPORT unsigned int ovrHmd_GetFloatArray(ovrHmd hmd, const char* propertyName,
                                             float values[], unsigned int arraySize);
 
@@ -781,6 +1037,17 @@ OVR_EXPORT const char* ovrHmd_GetString(ovrHmd hmd, const char* propertyName,
 // Can be used to check existence of a property.
 OVR_EXPORT unsigned int ovrHmd_GetArraySize(ovrHmd hmd, const char* propertyName);
 
+// Returns an id for a property, valid until the HMD is destroyed, or -1 if hmd or
+// propertyName is null, or if there is no such property; profile values only exist
+// once the profile has been read, shortly after the HMD is created. Reading a property by its id skips the name lookup, and
+// profile values such as the IPD are cached until the profile changes, so
+// properties polled every frame are best read with ovrHmd_GetFloatById and
+// ovrHmd_GetFloatArrayById. These behave like ovrHmd_GetFloat and ovrHmd_GetFloatArray.
+OVR_EXPORT int          ovrHmd_GetPropertyId(ovrHmd hmd, const char* propertyName);
+OVR_EXPORT float        ovrHmd_GetFloatById(ovrHmd hmd, int propertyId, float defaultVal);
+OVR_EXPORT unsigned int ovrHmd_GetFloatArrayById(ovrHmd hmd, int propertyId,
+                                                 float values[], unsigned int arraySize);
+
 
 #ifdef __cplusplus 
 } // extern "C"
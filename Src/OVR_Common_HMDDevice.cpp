@@ -93,7 +93,7 @@ HmdTypeEnum HMDDeviceCreateDesc::GetHmdType() const
             // If available, check the sensor to determine exactly which variant this is
             if (pDevice)
             {
-                Ptr<SensorDevice> sensor = *((HMDDevice*)pDevice)->GetSensor();
+                Ptr<SensorDevice> sensor = *((HMDDevice*)pDevice.Load_Acquire())->GetSensor();
                 
                 SensorInfo sinfo;
                 if (sensor && sensor->GetDeviceInfo(&sinfo))
@@ -308,14 +308,19 @@ Profile* HMDDevice::GetProfile()
     return pCachedProfile.GetPtr();
 }
 
+void HMDDevice::ReloadProfile()
+{
+    // The profile name is kept; only its values are read again
+    pCachedProfile.Clear();
+}
+
 const char* HMDDevice::GetProfileName()
 {
     if (ProfileName.IsEmpty())
     {   // If the profile name has not been initialized then
         // retrieve the stored default user for this specific device
         ProfileManager* mgr = GetManager()->GetProfileManager();
-        const char* name = mgr->GetDefaultUser(this);
-        ProfileName = name;
+        ProfileName = mgr->GetDefaultUser(this);
     }
     
     return ProfileName.ToCStr();
@@ -36,6 +36,7 @@ limitations under the License.
 #include "Kernel/OVR_Atomic.h"
 #include "Kernel/OVR_RefCount.h"
 #include "Kernel/OVR_String.h"
+#include "Kernel/OVR_Threads.h"
 
 
 namespace OVR {
@@ -46,6 +47,7 @@ class ProfileManager; // << Should be renamed for consistency
 
 // Forward declarations
 class SensorDevice;
+class SensorReportBatch;
 class DeviceCommon;
 class DeviceManager;
 
@@ -77,7 +79,9 @@ public:
     // Determines if handler supports a specific message type. Can
     // be used to filter out entire message groups. The result
     // returned by this function shouldn't change after handler creation.
-    virtual bool SupportsMessageType(MessageType) const { return true; }    
+    // Message_BodyFrameBatch must be accepted explicitly; handlers that don't
+    // get the frames of a batch one by one instead.
+    virtual bool SupportsMessageType(MessageType type) const { return type != Message_BodyFrameBatch; }
 
 private:    
     UPInt Internal[8];
@@ -275,7 +279,10 @@ public:
     virtual DeviceEnumerator<> EnumerateDevicesEx(const DeviceEnumerationArgs& args) = 0;
 
     // Creates a new DeviceManager. Only one instance of DeviceManager should be created at a time.
-    static   DeviceManager* Create();
+    // If threadScheduling is not null it is applied to the manager's background thread,
+    // which reads the sensors; use it to give sensor processing real-time priority or
+    // a dedicated core. Failing to apply it is logged but does not fail creation.
+    static   DeviceManager* Create(const Thread::SchedulingParams* threadScheduling = 0);
 
     // Static constant for this device type, used in template cast type checks.
     enum { EnumDeviceType = Device_Manager };
@@ -432,6 +439,9 @@ public:
     virtual const char* GetProfileName() = 0;
     // Sets the profile user name, changing the data returned by GetProfileInfo.
     virtual bool        SetProfileName(const char* name) = 0;
+    // Drops the cached profile, so that the next GetProfile reads it again from
+    // the profile manager; used after Message_ProfileChanged.
+    virtual void        ReloadProfile() = 0;
 
 
     // Disconnects from real HMD device. This HMDDevice remains as 'fake' HMD.
@@ -950,6 +960,75 @@ struct GyroOffsetReport
     double      Temperature;
 };
 
+// Keep-alive reports sent by a sensor's device thread, and how long their
+// transfers held up input reports.
+struct SensorKeepAliveStats
+{
+    SensorKeepAliveStats()
+      : Count(0), Failures(0), Interval(0), LastDuration(0), MaxDuration(0), TotalDuration(0)
+    {}
+
+    UInt32      Count;
+    UInt32      Failures;
+    // Seconds from the last keep-alive to the next one.
+    double      Interval;
+    // Seconds the transfers took.
+    double      LastDuration;
+    double      MaxDuration;
+    double      TotalDuration;
+};
+
+// Synchronization of a sensor's clock with the system clock, as estimated by its
+// time filter. The filter measures the delay of samples over windows of half a
+// second; the jitter of a window is how much its samples were delayed beyond the
+// fastest one. Times are in seconds.
+struct SensorTimeSyncStats
+{
+    SensorTimeSyncStats()
+      : ClockDelta(0), DriftPerSecond(0), CorrectionPerSecond(0),
+        LastJitter(0), MeanJitter(0), MaxJitter(0), Windows(0), Resets(0)
+    {}
+
+    // System time minus device time.
+    double      ClockDelta;
+    // Drift of the device clock against the system clock, in seconds per second.
+    double      DriftPerSecond;
+    // Rate at which ClockDelta is currently corrected towards the measured delay.
+    double      CorrectionPerSecond;
+    double      LastJitter;
+    double      MeanJitter;
+    double      MaxJitter;
+    // Windows measured, and times the filter restarted after a jump of the clocks.
+    UInt32      Windows;
+    UInt32      Resets;
+};
+
+// Input report counters of a sensor. Rates are measured over the last full
+// second of reports.
+struct SensorReportStats
+{
+    SensorReportStats()
+      : Packets(0), Samples(0), LostSamples(0), PacketsPerSecond(0), SamplesPerPacket(0),
+        LastDecodeTime(0), MaxDecodeTime(0), TotalDecodeTime(0), ReportRate(0), Autotune(false)
+    {}
+
+    UInt32      Packets;
+    // IMU samples carried by the packets; with report rates below 1000Hz the
+    // sensor merges several into one packet.
+    UInt32      Samples;
+    // Samples the running count or timestamp skipped over: packets lost on the way.
+    UInt32      LostSamples;
+    double      PacketsPerSecond;
+    double      SamplesPerPacket;
+    // Seconds spent decoding and dispatching a packet.
+    double      LastDecodeTime;
+    double      MaxDecodeTime;
+    double      TotalDecodeTime;
+    // Report rate last set on the device, in Hz, and whether autotune picked it.
+    unsigned    ReportRate;
+    bool        Autotune;
+};
+
 
 
 //-------------------------------------------------------------------------------------
@@ -998,6 +1077,14 @@ public:
     // Note, this value may be different from the one provided for SetReportRate. The return
     // value will contain the actual rate.
     virtual unsigned	GetReportRate() const = 0;
+    // While enabled, the report rate starts at the maximum and is lowered whenever
+    // samples are lost, then raised again after a while without losses, but never
+    // back to a rate that lost samples. SetReportRate turns it off.
+    virtual void        SetReportRateAutotune(bool enabled) { OVR_UNUSED(enabled); }
+    // Idle mode lowers the report rate while nobody uses the sensor, to save CPU
+    // time and USB bandwidth; leaving it restores the rate or autotune from before.
+    // May be called from a message handler, on the device thread.
+    virtual void        SetIdle(bool idle) { OVR_UNUSED(idle); }
 
     // Sets maximum range settings for the sensor described by SensorRange.    
     // The function will fail if you try to pass values outside Maximum supported
@@ -1051,12 +1138,133 @@ public:
 	virtual bool		GetUUIDReport(UUIDReport*) { return false; }
 
     virtual bool		SetTemperatureReport(const TemperatureReport&) { return false; }
+    // Returns the next temperature report; the device steps through its bins and
+    // samples on each read, so the received Bin and Sample say which one it is.
+    virtual bool        GetTemperatureReport(TemperatureReport*) { return false; }
     virtual bool        GetAllTemperatureReports(Array<Array<TemperatureReport> >*) { return false; }
 
     virtual bool        GetGyroOffsetReport(GyroOffsetReport*) { return false; }
 
     virtual bool		SetLensDistortionReport(const LensDistortionReport&) { return false; }
     virtual bool		GetLensDistortionReport(LensDistortionReport*) { return false; }
+
+    // Raw sample stream. While enabled, every MessageBodyFrame the device produces is
+    // also queued in a lock-free single-producer/single-consumer buffer that one
+    // application thread drains with PopRawSample, without going through message
+    // handlers and their shared lock. Samples that arrive while the buffer is full
+    // are dropped and counted by GetRawSampleDropCount.
+    enum { RawSampleStreamCapacity = 1024 };
+
+    virtual void        EnableRawSampleStream(bool enable) { OVR_UNUSED(enable); }
+    // Copies the oldest queued sample into *frame; returns false if none is queued.
+    virtual bool        PopRawSample(MessageBodyFrame* frame) { OVR_UNUSED(frame); return false; }
+    virtual UInt32      GetRawSampleDropCount() const { return 0; }
+
+    virtual bool        GetKeepAliveStats(SensorKeepAliveStats* stats) const { OVR_UNUSED(stats); return false; }
+    virtual bool        GetReportStats(SensorReportStats* stats) const { OVR_UNUSED(stats); return false; }
+    virtual bool        GetTimeSyncStats(SensorTimeSyncStats* stats) { OVR_UNUSED(stats); return false; }
+
+    // Issues the feature report requests of the batch, in order, as a single command
+    // on the device thread, and returns without waiting for them. Returns
+    // false if the batch couldn't be submitted; it is then completed as failed.
+    virtual bool        SubmitReports(SensorReportBatch* batch);
+};
+
+
+//-------------------------------------------------------------------------------------
+// ***** SensorReportBatch
+
+// SensorReportBatch collects feature report reads and writes of a SensorDevice, so that
+// SubmitReports can issue them all in one trip to the device thread. After
+// submission the batch works as a future: IsDone, Wait and GetResult report the outcome,
+// and a CompletionHandler, if set, is called on the device thread once the
+// requests have run. Reports to write are copied into the batch; reports being read
+// into must stay valid until the batch is done.
+//
+//     Ptr<SensorReportBatch> batch = *new SensorReportBatch;
+//     batch->Get(&SensorDevice::GetTrackingReport, &tracking);
+//     batch->Get(&SensorDevice::GetDisplayReport, &display);
+//     sensor->SubmitReports(batch);
+//     ...
+//     if (batch->Wait() && batch->Succeeded())
+//
+// A batch of writes that nobody waits for is fire-and-forget.
+
+class SensorReportBatch : public RefCountBase<SensorReportBatch>
+{
+public:
+    class CompletionHandler
+    {
+    public:
+        virtual ~CompletionHandler() { }
+        // Called on the device thread after all requests have run.
+        virtual void OnReportsCompleted(SensorReportBatch* batch) = 0;
+    };
+
+    SensorReportBatch();
+    ~SensorReportBatch();
+
+    // Requests can be added until the batch is submitted.
+    template<class R>
+    void        Get(bool (SensorDevice::*get)(R*), R* report)
+    { addRequest(new GetRequest<R>(get, report)); }
+    template<class R>
+    void        Set(bool (SensorDevice::*set)(const R&), const R& report)
+    { addRequest(new SetRequest<R>(set, report)); }
+
+    // The handler must stay valid until it has been called.
+    void        SetCompletionHandler(CompletionHandler* handler) { pHandler = handler; }
+
+    UPInt       GetCount() const { return Requests.GetSize(); }
+    bool        IsDone() const   { return Status.Load_Acquire() == Status_Done; }
+    // Waits up to delay milliseconds for the batch to complete; returns true if it has.
+    bool        Wait(unsigned delay = OVR_WAIT_INFINITE);
+    // Result of request i, counted in the order they were added; false until done.
+    bool        GetResult(UPInt i) const;
+    // True once done if every request succeeded.
+    bool        Succeeded() const;
+
+    // Used by SensorDevice implementations: Begin marks the batch as submitted and
+    // fails if it already was; Execute runs the requests on the device and completes
+    // the batch, while Fail completes it without running them.
+    bool        Begin();
+    void        Execute(SensorDevice* device);
+    void        Fail();
+
+private:
+    enum { Status_New, Status_Submitted, Status_Done };
+
+    struct Request : public NewOverrideBase
+    {
+        bool Result;
+        Request() : Result(false) { }
+        virtual ~Request() { }
+        virtual bool Run(SensorDevice* device) = 0;
+    };
+    template<class R>
+    struct GetRequest : public Request
+    {
+        bool (SensorDevice::*pGet)(R*);
+        R*   pReport;
+        GetRequest(bool (SensorDevice::*get)(R*), R* report) : pGet(get), pReport(report) { }
+        virtual bool Run(SensorDevice* device) { return (device->*pGet)(pReport); }
+    };
+    template<class R>
+    struct SetRequest : public Request
+    {
+        bool (SensorDevice::*pSet)(const R&);
+        R    Report;
+        SetRequest(bool (SensorDevice::*set)(const R&), const R& report) : pSet(set), Report(report) { }
+        virtual bool Run(SensorDevice* device) { return (device->*pSet)(Report); }
+    };
+
+    void        addRequest(Request* request);
+    void        complete();
+
+    Array<Request*>     Requests;
+    CompletionHandler*  pHandler;
+    AtomicInt<int>      Status;
+    Event               DoneEvent;
 };
 
 //-------------------------------------------------------------------------------------
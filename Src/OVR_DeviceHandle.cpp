@@ -62,12 +62,7 @@ void DeviceHandle::operator = (const DeviceHandle& src)
 
 DeviceBase* DeviceHandle::GetDevice_AddRef() const
 { 
-    if (pImpl && pImpl->pDevice)
-    {
-        pImpl->pDevice->AddRef();
-        return pImpl->pDevice;
-    }
-    return NULL;
+    return pImpl ? pImpl->GetDevice_AddRef() : NULL;
 }
 
 // Returns true, if the handle contains the same device ptr
@@ -104,20 +99,22 @@ DeviceBase* DeviceHandle::CreateDevice()
     if (!pImpl)
         return 0;
     
-    DeviceBase*            device = 0;
+    // An existing device is returned without taking the lock.
+    DeviceBase* device = pImpl->GetDevice_AddRef();
+    if (device)
+        return device;
+
     Ptr<DeviceManagerImpl> manager= 0;
 
-    // Since both manager and device pointers can only be destroyed during a lock,
-    // hold it while checking for availability.
+    // Since the manager pointer can only be destroyed during a lock, hold it while
+    // checking for availability.
     // AddRef to manager so that it doesn't get released on us.
     {
         Lock::Locker deviceLockScope(pImpl->GetLock());
 
-        if (pImpl->pDevice)
-        {
-            pImpl->pDevice->AddRef();
-            return pImpl->pDevice;
-        }
+        device = pImpl->GetDevice_AddRef();
+        if (device)
+            return device;
         manager = pImpl->GetManagerImpl();
     }
 
@@ -40,9 +40,9 @@ namespace OVR {
 // ***** MessageHandler
 
 // Threading notes:
-// The OnMessage() handler and SetMessageHandler are currently synchronized
-// through a separately stored shared Lock object to avoid calling the handler 
-// from background thread while it's being removed.
+// Handlers are installed and removed under a separately stored shared Lock object,
+// which also protects the list of devices each handler is applied to. Messages are
+// delivered on each device's thread without taking it; see MessageHandlerRef.
 
 static SharedLock MessageHandlerSharedLock;
 
@@ -56,13 +56,15 @@ public:
     };
 
     MessageHandlerImpl()
-        : pLock(MessageHandlerSharedLock.GetLockAddRef()), HandlerRefsCount(0)
+        : pLock(MessageHandlerSharedLock.GetLockAddRef()), pHandlerLock(0), HandlerRefsCount(0)
     {
     }
     ~MessageHandlerImpl()
     {
         MessageHandlerSharedLock.ReleaseLock(pLock);
         pLock = 0;
+        delete pHandlerLock;
+        pHandlerLock = 0;
     }
 
     static MessageHandlerImpl* FromHandler(MessageHandler* handler)
@@ -70,9 +72,15 @@ public:
     static const MessageHandlerImpl* FromHandler(const MessageHandler* handler)
     { return (const MessageHandlerImpl*)&handler->Internal; }
 
-    // This lock is held while calling a handler and when we are applied/
-    // removed from a device.
+    // This lock is held when we are applied/removed from a device.
     Lock*               pLock;
+    // Held while calling the handler, once GetHandlerLock has been called.
+    // Lock can't be allocated on its own.
+    struct HandlerLock : public NewOverrideBase
+    {
+        Lock            TheLock;
+    };
+    HandlerLock*        pHandlerLock;
     // List of devices we are applied to.
     int                 HandlerRefsCount;
     MessageHandlerRef*  pHandlerRefs[MaxHandlerRefsCount];
@@ -80,7 +88,8 @@ public:
 
 
 MessageHandlerRef::MessageHandlerRef(DeviceBase* device)
-    : pLock(MessageHandlerSharedLock.GetLockAddRef()), pDevice(device), HandlersCount(0)
+    : pLock(MessageHandlerSharedLock.GetLockAddRef()), pDevice(device),
+      pList(0), CallDepth(0), pRetired(0)
 {
 }
 
@@ -88,9 +97,11 @@ MessageHandlerRef::~MessageHandlerRef()
 {
     {
         Lock::Locker lockScope(pLock);
-        
-        while (HandlersCount > 0)
-            removeHandler(0);
+
+        // The device is going away, so nothing can be delivering through us and
+        // the lists can be freed right away.
+        while (HasHandlers())
+            delete removeHandler_NTS(0);
     }
     MessageHandlerSharedLock.ReleaseLock(pLock);
     pLock = 0;
@@ -98,76 +109,264 @@ MessageHandlerRef::~MessageHandlerRef()
 
 void MessageHandlerRef::Call(const Message& msg)
 {
-    Lock::Locker lockScope(pLock);
+    CallDepth++;
+
+    // The handlers are those installed when the call starts, so that one removing
+    // itself doesn't shift the next out of the loop; a handler removed by an earlier
+    // one isn't called. Lists loaded here stay valid until endCall.
+    HandlerList* list  = pList.Load_Acquire();
+    int          count = list ? list->Count : 0;
+    for (int i = 0; i < count; i++)
+    {
+        if (!(list->TypeMasks[i] & GetTypeBit(msg.Type)) || !isStillInstalled(list, i))
+            continue;
+
+        Lock* handlerLock = list->pHandlerLocks[i];
+        if (handlerLock)
+        {
+            Lock::Locker lockScope(handlerLock);
+            list->pHandlers[i]->OnMessage(msg);
+        }
+        else
+        {
+            list->pHandlers[i]->OnMessage(msg);
+        }
+    }
 
-    for (int i = 0; i < HandlersCount; i++)
-        pHandlers[i]->OnMessage(msg);
+    endCall();
+}
+
+void MessageHandlerRef::CallBodyFrames(const MessageBodyFrameBatch& batch)
+{
+    CallDepth++;
+
+    // As in Call, the handlers installed when the call starts.
+    HandlerList* list  = pList.Load_Acquire();
+    int          count = list ? list->Count : 0;
+    for (int i = 0; i < count; i++)
+    {
+        if (!(list->TypeMasks[i] & (GetTypeBit(Message_BodyFrameBatch) | GetTypeBit(Message_BodyFrame))) ||
+            !isStillInstalled(list, i))
+            continue;
+
+        MessageHandler* handler     = list->pHandlers[i];
+        Lock*           handlerLock = list->pHandlerLocks[i];
+        if (handlerLock)
+            handlerLock->DoLock();
+
+        if (list->AcceptsBatches[i])
+        {
+            handler->OnMessage(batch);
+        }
+        else
+        {
+            for (unsigned j = 0; j < batch.Count; j++)
+                handler->OnMessage(batch.pFrames[j]);
+        }
+
+        if (handlerLock)
+            handlerLock->Unlock();
+    }
+
+    endCall();
+}
+
+void MessageHandlerRef::endCall()
+{
+    if (--CallDepth > 0)
+        return;
+
+    while (pRetired)
+    {
+        HandlerList* list = pRetired;
+        pRetired = list->pNextRetired;
+        delete list;
+    }
+}
+
+MessageHandlerRef::HandlerList* MessageHandlerRef::copyList_NTS() const
+{
+    HandlerList* list = new HandlerList;
+    HandlerList* old  = pList.Load_Acquire();
+    if (old)
+    {
+        *list = *old;
+    }
+    else
+    {
+        list->Count    = 0;
+        list->TypeMask = 0;
+    }
+    list->pNextRetired = 0;
+    return list;
+}
+
+// Asks handler about every type that has a bit; SupportsMessageType doesn't change.
+static UInt64 getHandlerTypeMask(const MessageHandler* handler)
+{
+    UInt64 mask = 0;
+    for (unsigned deviceClass = 0; deviceClass < 8; deviceClass++)
+        for (unsigned index = 0; index < 8; index++)
+            if (handler->SupportsMessageType(MessageType((deviceClass << 8) | index)))
+                mask |= UInt64(1) << (deviceClass * 8 + index);
+    return mask;
+}
+
+void MessageHandlerRef::releaseList(HandlerList* list)
+{
+    if (!list)
+        return;
+
+    // Messages are delivered on the device's thread.
+    DeviceCommon* devCommon = DeviceManagerImpl::GetDeviceCommon(pDevice);
+    if (pDevice->GetManager())
+    {
+        if (GetCurrentThreadId() == devCommon->GetDeviceThreadId())
+        {
+            // We may be inside a Call that still uses the list.
+            if (CallDepth > 0)
+            {
+                list->pNextRetired = pRetired;
+                pRetired = list;
+                return;
+            }
+        }
+        else
+        {
+            // Once the device thread has run this command it is done with any
+            // Call that started before the list was replaced. This fails
+            // without waiting if the thread has been told to exit.
+            Void result;
+            devCommon->GetDeviceQueue()->PushCallAndWaitResult(this, &MessageHandlerRef::waitForCalls, &result);
+        }
+    }
+    delete list;
 }
 
 void MessageHandlerRef::AddHandler(MessageHandler* handler)
 {    
     OVR_ASSERT(!handler ||
                MessageHandlerImpl::FromHandler(handler)->pLock == pLock);    
-    Lock::Locker lockScope(pLock);
-    AddHandler_NTS(handler);
+    HandlerList* old;
+    {
+        Lock::Locker lockScope(pLock);
+        old = addHandler_NTS(handler);
+    }
+    releaseList(old);
 }
 
-void MessageHandlerRef::AddHandler_NTS(MessageHandler* handler)
+MessageHandlerRef::HandlerList* MessageHandlerRef::addHandler_NTS(MessageHandler* handler)
 {
     OVR_ASSERT(handler != NULL);
 
-    OVR_ASSERT(HandlersCount < MaxHandlersCount);
-    for (int i = 0; i < HandlersCount; i++)
-        if (pHandlers[i] == handler)
+    HandlerList* old = pList.Load_Acquire();
+    int          count = old ? old->Count : 0;
+
+    OVR_ASSERT(count < MaxHandlersCount);
+    for (int i = 0; i < count; i++)
+        if (old->pHandlers[i] == handler)
             // handler already installed - do nothing
-            return;
-    pHandlers[HandlersCount] = handler;
-    HandlersCount++;
+            return 0;
 
     MessageHandlerImpl* handlerImpl = MessageHandlerImpl::FromHandler(handler);
+
+    HandlerList* list = copyList_NTS();
+    list->pHandlers[count]      = handler;
+    list->AcceptsBatches[count] = handler->SupportsMessageType(Message_BodyFrameBatch);
+    list->TypeMasks[count]      = getHandlerTypeMask(handler);
+    list->pHandlerLocks[count]  = handlerImpl->pHandlerLock ? &handlerImpl->pHandlerLock->TheLock : 0;
+    list->TypeMask             |= list->TypeMasks[count];
+    list->Count++;
+    pList.Store_Release(list);
+
     OVR_ASSERT(handlerImpl->HandlerRefsCount < MessageHandlerImpl::MaxHandlerRefsCount);
     handlerImpl->pHandlerRefs[handlerImpl->HandlerRefsCount] = this;
     handlerImpl->HandlerRefsCount++;
 
     // TBD: Call notifier on device?
+    return old;
 }
 
 bool MessageHandlerRef::RemoveHandler(MessageHandler* handler)
 {
-    Lock::Locker lockScope(pLock);
-
-    for (int i = 0; i < HandlersCount; i++)
+    HandlerList* old = 0;
+    bool         removed = false;
     {
-        if (pHandlers[i] == handler)
-            return removeHandler(i);
+        Lock::Locker lockScope(pLock);
+
+        HandlerList* list = pList.Load_Acquire();
+        for (int i = 0; list && i < list->Count; i++)
+        {
+            if (list->pHandlers[i] == handler)
+            {
+                old     = removeHandler_NTS(i);
+                removed = true;
+                break;
+            }
+        }
     }
-    return false;
+    releaseList(old);
+    return removed;
 }
 
-bool MessageHandlerRef::removeHandler(int idx)
+MessageHandlerRef::HandlerList* MessageHandlerRef::removeHandler_NTS(int idx)
 {
-    OVR_ASSERT(idx < HandlersCount);
+    HandlerList* old = pList.Load_Acquire();
+    OVR_ASSERT(old && idx < old->Count);
 
-    MessageHandlerImpl* handlerImpl = MessageHandlerImpl::FromHandler(pHandlers[idx]);
+    MessageHandlerImpl* handlerImpl = MessageHandlerImpl::FromHandler(old->pHandlers[idx]);
+    bool                linked = false;
     for (int i = 0; i < handlerImpl->HandlerRefsCount; i++)
         if (handlerImpl->pHandlerRefs[i] == this)
         {
             handlerImpl->pHandlerRefs[i] = handlerImpl->pHandlerRefs[handlerImpl->HandlerRefsCount - 1];
             handlerImpl->HandlerRefsCount--;
+            linked = true;
+            break;
+        }
 
-            pHandlers[idx] = pHandlers[HandlersCount - 1];
-            HandlersCount--;
+    // couldn't find a link in the opposite direction, assert in Debug
+    OVR_ASSERT(linked);
+    OVR_UNUSED(linked);
 
-            return true;
+    // Keep the order of the remaining handlers, so that a Call in progress on
+    // the old list doesn't skip any of them.
+    HandlerList* list = 0;
+    if (old->Count > 1)
+    {
+        list = copyList_NTS();
+        for (int j = idx; j < list->Count - 1; j++)
+        {
+            list->pHandlers[j]      = list->pHandlers[j + 1];
+            list->AcceptsBatches[j] = list->AcceptsBatches[j + 1];
+            list->TypeMasks[j]      = list->TypeMasks[j + 1];
+            list->pHandlerLocks[j]  = list->pHandlerLocks[j + 1];
         }
+        list->Count--;
 
-    // couldn't find a link in the opposite direction, assert in Debug
-    OVR_ASSERT(0);
+        list->TypeMask = 0;
+        for (int j = 0; j < list->Count; j++)
+            list->TypeMask |= list->TypeMasks[j];
+    }
+    pList.Store_Release(list);
+    return old;
+}
 
-    pHandlers[idx] = pHandlers[HandlersCount - 1];
-    HandlersCount--;
-    
-    return true;
+MessageHandlerRef::HandlerList* MessageHandlerRef::setHandlerLock_NTS(MessageHandler* handler,
+                                                                      Lock* handlerLock)
+{
+    HandlerList* old = pList.Load_Acquire();
+    for (int i = 0; old && i < old->Count; i++)
+    {
+        if (old->pHandlers[i] == handler)
+        {
+            HandlerList* list = copyList_NTS();
+            list->pHandlerLocks[i] = handlerLock;
+            pList.Store_Release(list);
+            return old;
+        }
+    }
+    return 0;
 }
 
 MessageHandler::MessageHandler()
@@ -199,19 +398,71 @@ bool MessageHandler::IsHandlerInstalled() const
 void MessageHandler::RemoveHandlerFromDevices()
 {
     MessageHandlerImpl* handlerImpl = MessageHandlerImpl::FromHandler(this);
-    Lock::Locker lockedScope(handlerImpl->pLock);
 
-    while (handlerImpl->HandlerRefsCount > 0)
+    MessageHandlerRef*              refs[MessageHandlerImpl::MaxHandlerRefsCount];
+    MessageHandlerRef::HandlerList* oldLists[MessageHandlerImpl::MaxHandlerRefsCount];
+    int                             count = 0;
     {
-        MessageHandlerRef* use = handlerImpl->pHandlerRefs[0];
-        use->RemoveHandler(this);
+        Lock::Locker lockedScope(handlerImpl->pLock);
+
+        while (handlerImpl->HandlerRefsCount > 0)
+        {
+            MessageHandlerRef*              use  = handlerImpl->pHandlerRefs[0];
+            MessageHandlerRef::HandlerList* list = use->pList.Load_Acquire();
+            int i;
+            for (i = 0; list && i < list->Count; i++)
+                if (list->pHandlers[i] == this)
+                    break;
+
+            if (!list || i == list->Count)
+            {
+                // Not in the device's list; drop the stale link.
+                OVR_ASSERT(0);
+                handlerImpl->pHandlerRefs[0] = handlerImpl->pHandlerRefs[handlerImpl->HandlerRefsCount - 1];
+                handlerImpl->HandlerRefsCount--;
+                continue;
+            }
+
+            refs[count]     = use;
+            oldLists[count] = use->removeHandler_NTS(i);
+            count++;
+        }
     }
+
+    for (int i = 0; i < count; i++)
+        refs[i]->releaseList(oldLists[i]);
 }
 
 Lock* MessageHandler::GetHandlerLock() const
 {
-    const MessageHandlerImpl* handlerImpl = MessageHandlerImpl::FromHandler(this);
-    return handlerImpl->pLock;
+    MessageHandlerImpl* handlerImpl = const_cast<MessageHandlerImpl*>(MessageHandlerImpl::FromHandler(this));
+
+    // Handlers are called without a lock until someone asks for it; from then on
+    // the devices the handler is applied to hold it around OnMessage.
+    MessageHandlerRef*              refs[MessageHandlerImpl::MaxHandlerRefsCount];
+    MessageHandlerRef::HandlerList* oldLists[MessageHandlerImpl::MaxHandlerRefsCount];
+    int                             count = 0;
+    Lock*                           handlerLock;
+    {
+        Lock::Locker lockedScope(handlerImpl->pLock);
+
+        if (handlerImpl->pHandlerLock)
+            return &handlerImpl->pHandlerLock->TheLock;
+
+        handlerImpl->pHandlerLock = new MessageHandlerImpl::HandlerLock;
+        handlerLock = &handlerImpl->pHandlerLock->TheLock;
+        for (int i = 0; i < handlerImpl->HandlerRefsCount; i++)
+        {
+            refs[count]     = handlerImpl->pHandlerRefs[i];
+            oldLists[count] = refs[count]->setHandlerLock_NTS(const_cast<MessageHandler*>(this), handlerLock);
+            count++;
+        }
+    }
+
+    // Wait for calls that don't take the lock yet.
+    for (int i = 0; i < count; i++)
+        refs[i]->releaseList(oldLists[i]);
+    return handlerLock;
 }
 
 
@@ -364,25 +615,34 @@ DeviceBase* DeviceManagerImpl::CreateDevice_MgrThread(DeviceCreateDesc* createDe
     // so 'this' must remain valid.
     OVR_ASSERT(createDesc->pLock->pManager);    
 
-    Lock::Locker devicesLock(GetLock());
-
-    // If device already exists, just AddRef to it.
-    if (createDesc->pDevice)
     {
-        createDesc->pDevice->AddRef();
-        return createDesc->pDevice;
+        Lock::Locker devicesLock(GetLock());
+
+        // If device already exists, just AddRef to it.
+        if (createDesc->pDevice)
+        {
+            createDesc->pDevice->AddRef();
+            return createDesc->pDevice;
+        }
     }
 
     if (!parent)
         parent = this;
 
+    // Devices are only created and destroyed on this thread, so nothing else can
+    // create this one meanwhile. Opening a device takes a while; the lock isn't held
+    // for it, so that handles can be enumerated and queried on other threads.
     DeviceBase* device = createDesc->NewDeviceInstance();
     
     if (device)
     {
-        if (device->getDeviceCommon()->Initialize(parent))
+        DeviceCommon* devCommon = device->getDeviceCommon();
+        devCommon->pDeviceQueue = GetThreadQueueFor(createDesc, &devCommon->DeviceThreadId);
+
+        if (devCommon->InitializeOnDeviceThread(parent))
         {
-           createDesc->pDevice = device;
+            Lock::Locker devicesLock(GetLock());
+            createDesc->pDevice = device;
         }
         else
         {
@@ -401,27 +661,33 @@ Void DeviceManagerImpl::ReleaseDevice_MgrThread(DeviceBase* device)
     // descKeepAlive will keep ManagerLock object alive as well,
     // allowing us to exit gracefully.    
     Ptr<DeviceCreateDesc>  descKeepAlive;
-    Lock::Locker           devicesLock(GetLock());
     DeviceCommon*          devCommon = device->getDeviceCommon();
 
-    while(1)
     {
-        UInt32 refCount = devCommon->RefCount;
+        Lock::Locker devicesLock(GetLock());
 
-        if (refCount > 1)
+        while(1)
         {
-            if (devCommon->RefCount.CompareAndSet_NoSync(refCount, refCount-1))
+            UInt32 refCount = devCommon->RefCount;
+
+            if (refCount > 1)
             {
-                // We decreented from initial count higher then 1;
-                // nothing else to do.
-                return 0;
-            }        
-        }
-        else if (devCommon->RefCount.CompareAndSet_NoSync(1, 0))
-        {
-            // { 1 -> 0 } decrement succeded. Destroy this device.
-            break;
+                if (devCommon->RefCount.CompareAndSet_NoSync(refCount, refCount-1))
+                {
+                    // We decreented from initial count higher then 1;
+                    // nothing else to do.
+                    return 0;
+                }        
+            }
+            else if (devCommon->RefCount.CompareAndSet_NoSync(1, 0))
+            {
+                // { 1 -> 0 } decrement succeded. Destroy this device.
+                break;
+            }
         }
+
+        descKeepAlive = devCommon->pCreateDesc;
+        descKeepAlive->ClearDevice();
     }
 
     // At this point, may be releasing the device manager itself.
@@ -429,9 +695,7 @@ Void DeviceManagerImpl::ReleaseDevice_MgrThread(DeviceBase* device)
     // in both cases. DeviceManager::Shutdown with begin shutdown process for
     // the internal manager thread, which will eventually destroy itself.
     // TBD: Clean thread shutdown.
-    descKeepAlive = devCommon->pCreateDesc;
-    descKeepAlive->pDevice = 0;
-    devCommon->Shutdown();
+    devCommon->ShutdownOnDeviceThread();
     delete device;
     return 0;
 }
@@ -644,6 +908,56 @@ void DeviceCommon::DeviceAddRef()
     RefCount++;
 }
 
+bool DeviceCommon::TryDeviceAddRef()
+{
+    while(1)
+    {
+        UInt32 refCount = RefCount;
+        if (refCount == 0)
+            return false;
+        if (RefCount.CompareAndSet_Sync(refCount, refCount+1))
+            return true;
+    }
+}
+
+ThreadCommandQueue* DeviceCommon::GetDeviceQueue() const
+{
+    if (pDeviceQueue)
+        return pDeviceQueue;
+    return pCreateDesc->GetManagerImpl()->GetThreadQueue();
+}
+
+ThreadId DeviceCommon::GetDeviceThreadId() const
+{
+    if (pDeviceQueue)
+        return DeviceThreadId;
+    return pCreateDesc->GetManagerImpl()->GetThreadId();
+}
+
+bool DeviceCommon::InitializeOnDeviceThread(DeviceBase* parent)
+{
+    // direct call if we are already on the device thread
+    if (GetCurrentThreadId() == GetDeviceThreadId())
+        return Initialize(parent);
+
+    bool result = false;
+    if (!GetDeviceQueue()->PushCallAndWaitResult(this, &DeviceCommon::Initialize, &result, parent))
+        return false;
+    return result;
+}
+
+void DeviceCommon::ShutdownOnDeviceThread()
+{
+    Void result;
+    // If the device thread has already been told to exit, nothing else runs
+    // the device any more.
+    if (GetCurrentThreadId() == GetDeviceThreadId() ||
+        !GetDeviceQueue()->PushCallAndWaitResult(this, &DeviceCommon::shutdownCommand, &result))
+    {
+        Shutdown();
+    }
+}
+
 void DeviceCommon::DeviceRelease()
 {
     while(1)
@@ -691,6 +1005,34 @@ void DeviceCreateDesc::AddRef()
     HandleCount++;
 }
 
+DeviceBase* DeviceCreateDesc::GetDevice_AddRef()
+{
+    // Announce ourselves before loading pDevice; ClearDevice does the opposite,
+    // so either it sees us and waits, or we see the cleared pointer.
+    DeviceUsers.ExchangeAdd_Sync(1);
+
+    DeviceBase* device = pDevice;
+    if (device && !DeviceManagerImpl::GetDeviceCommon(device)->TryDeviceAddRef())
+        device = 0;
+
+    DeviceUsers.ExchangeAdd_Release((UInt32)-1);
+    return device;
+}
+
+void DeviceCreateDesc::ClearDevice()
+{
+    pDevice.Exchange_Sync(0);
+
+    // Users only hold the count for a few instructions; one still holding it after
+    // a while has likely been preempted, so it is given the CPU.
+    enum { SpinsBeforeYield = 64 };
+    for (unsigned spins = 0; DeviceUsers.Load_Acquire() != 0; spins++)
+    {
+        if (spins >= SpinsBeforeYield)
+            Thread::YieldCurrentThread();
+    }
+}
+
 void DeviceCreateDesc::Release()
 {
     while(1)
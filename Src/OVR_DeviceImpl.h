@@ -51,6 +51,12 @@ enum
 
 
 // Wrapper for MessageHandler that includes synchronization logic.
+//
+// Handlers are called from the device's thread (see DeviceCommon::GetDeviceQueue)
+// without taking any lock: the installed handlers are kept in an immutable list that
+// Add/RemoveHandler replace under the shared handler lock. A replaced list is freed
+// once the device's thread has been seen outside of Call, so RemoveHandler still
+// guarantees that the handler isn't called after it returns.
 class MessageHandlerRef
 {   
     enum
@@ -61,26 +67,84 @@ public:
     MessageHandlerRef(DeviceBase* device);
     ~MessageHandlerRef();
 
-    bool            HasHandlers() const { return HandlersCount > 0; };
+    bool            HasHandlers() const
+    { HandlerList* list = pList.Load_Acquire(); return list && list->Count > 0; }
+    // True if a handler supports messages of type, so that devices can skip
+    // building the ones that would go nowhere.
+    bool            HasHandlers(MessageType type) const
+    { HandlerList* list = pList.Load_Acquire(); return list && (list->TypeMask & GetTypeBit(type)) != 0; }
+
+    // Bit of type in the masks of supported types: a group of eight bits for each
+    // device class, and a bit in it for each message of the class.
+    static UInt64   GetTypeBit(MessageType type)
+    { return UInt64(1) << ((((unsigned)type >> 5) & 0x38) | ((unsigned)type & 7)); }
     void            AddHandler(MessageHandler* handler);
     // returns false if the handler is not found
     bool            RemoveHandler(MessageHandler* handler);
-    // Not-thread-safe version
-    void            AddHandler_NTS(MessageHandler* handler);
     
+    // Must be called on the device's thread.
     void            Call(const Message& msg);
+    // Calls handlers that accept batches once; the others once per frame.
+    void            CallBodyFrames(const MessageBodyFrameBatch& batch);
 
+    // Lock serializing handler installation; it isn't held during Call.
     Lock*           GetLock() const { return pLock; }
     DeviceBase*     GetDevice() const  { return pDevice; }
 
 private:
+    friend class MessageHandler;
+
+    struct HandlerList : public NewOverrideBase
+    {
+        int             Count;
+        MessageHandler* pHandlers[MaxHandlersCount];
+        // SupportsMessageType(Message_BodyFrameBatch) of each handler.
+        bool            AcceptsBatches[MaxHandlersCount];
+        // Types supported by each handler (see GetTypeBit), and by any of them.
+        UInt64          TypeMasks[MaxHandlersCount];
+        UInt64          TypeMask;
+        // The handler's lock, if it was requested with GetHandlerLock; it is held
+        // around the handler's OnMessage.
+        Lock*           pHandlerLocks[MaxHandlersCount];
+        // Lists replaced during a Call, freed when the Call returns.
+        HandlerList*    pNextRetired;
+
+        bool            Contains(const MessageHandler* handler) const
+        {
+            for (int i = 0; i < Count; i++)
+                if (pHandlers[i] == handler)
+                    return true;
+            return false;
+        }
+    };
+
+    // True if the handler at index of list, loaded when a Call started, is still
+    // installed; handlers removed by an earlier one aren't called.
+    bool            isStillInstalled(const HandlerList* list, int index) const
+    {
+        const HandlerList* current = pList.Load_Acquire();
+        return current == list || (current && current->Contains(list->pHandlers[index]));
+    }
+
     Lock*           pLock;   // Cached global handler lock.
     DeviceBase*     pDevice;
 
-    int             HandlersCount;
-    MessageHandler* pHandlers[MaxHandlersCount];
-
-    bool            removeHandler(int idx);
+    AtomicPtr<HandlerList> pList;
+    // Nesting of Call on the device's thread, and the lists replaced meanwhile.
+    // Only used by that thread.
+    int             CallDepth;
+    HandlerList*    pRetired;
+
+    HandlerList*    copyList_NTS() const;
+    // These replace the published list and return the old one, to be passed to
+    // releaseList once the shared lock is released.
+    HandlerList*    addHandler_NTS(MessageHandler* handler);
+    HandlerList*    removeHandler_NTS(int idx);
+    HandlerList*    setHandlerLock_NTS(MessageHandler* handler, Lock* handlerLock);
+    void            releaseList(HandlerList* list);
+    void            endCall();
+
+    Void            waitForCalls() { return 0; }
 };
 
 
@@ -114,7 +178,8 @@ class DeviceCreateDesc : public ListNode<DeviceCreateDesc>, public NewOverrideBa
     void operator = (const DeviceCreateDesc&) { } // Assign not supported; suppress MSVC warning.
 public:
     DeviceCreateDesc(DeviceFactory* factory, DeviceType type)
-        : pFactory(factory), Type(type), pLock(0), HandleCount(0), pDevice(0), Enumerated(true)
+        : pFactory(factory), Type(type), pLock(0), HandleCount(0), pDevice(0), DeviceUsers(0),
+          Enumerated(true)
     {
         pNext = pPrev = 0;
     }
@@ -134,6 +199,14 @@ public:
     void AddRef();
     void Release();
 
+    // Returns the created device AddRef-ed, or null if there is none or it is being
+    // destroyed. Doesn't take the lock, so handles can be resolved from any thread
+    // while the manager thread creates or enumerates devices.
+    DeviceBase* GetDevice_AddRef();
+    // Clears pDevice, then waits for GetDevice_AddRef calls that may still be using
+    // the old device, so that it can be deleted.
+    void        ClearDevice();
+
 
     // *** Device creation/matching Interface
 
@@ -174,6 +247,9 @@ public:
 
     // Matches device by path.
     virtual bool              MatchDevice(const String& /*path*/) { return false; }
+
+    // Descriptor of the HID device this describes, or null if it isn't one.
+    virtual const HIDDeviceDesc* GetHIDDeviceDesc() const     { return NULL; }
 //protected:
     DeviceFactory* const        pFactory;
     const DeviceType            Type;
@@ -187,8 +263,11 @@ public:
     //  {1 -> 0}: May delete & remove handle if no longer available.
     //  {0 -> 1}: Device creation is only possible if manager is still alive.
     AtomicInt<UInt32>           HandleCount;
-    // If not null, points to our created device instance. Modified during lock only.
-    DeviceBase*                 pDevice;
+    // If not null, points to our created device instance. Modified during lock only;
+    // read without it through GetDevice_AddRef.
+    AtomicPtr<DeviceBase>       pDevice;
+    // GetDevice_AddRef calls in progress.
+    AtomicInt<UInt32>           DeviceUsers;
     // True if device is marked as available during enumeration.
     bool                        Enumerated;
 };
@@ -206,9 +285,14 @@ public:
     volatile bool          ConnectedFlag;
     MessageHandlerRef      HandlerRef;
 
+    // Thread the device runs on, assigned by the manager when it creates the
+    // device; see DeviceManagerImpl::GetThreadQueueFor. Null for the manager.
+    ThreadCommandQueue*    pDeviceQueue;
+    ThreadId               DeviceThreadId;
+
     DeviceCommon(DeviceCreateDesc* createDesc, DeviceBase* device, DeviceBase* parent)
         : RefCount(1), pCreateDesc(createDesc), pParent(parent),
-          ConnectedFlag(true), HandlerRef(device)
+          ConnectedFlag(true), HandlerRef(device), pDeviceQueue(0), DeviceThreadId(0)
     {
     }
 	virtual ~DeviceCommon() {}
@@ -216,11 +300,26 @@ public:
     // Device reference counting delegates to Manager thread to actually kill devices.
     void DeviceAddRef();
     void DeviceRelease();
+    // AddRefs unless the count has already dropped to 0 for destruction.
+    bool TryDeviceAddRef();
 
     Lock* GetLock() const { return pCreateDesc->GetLock(); }
 
+    // Queue used to post commands to the thread that does the device's I/O and
+    // delivers its messages; this is the device manager thread unless the manager
+    // runs devices on threads of their own.
+    ThreadCommandQueue* GetDeviceQueue() const;
+    ThreadId            GetDeviceThreadId() const;
+
     virtual bool Initialize(DeviceBase* parent) = 0;
     virtual void Shutdown() = 0;
+
+    // Initialize and Shutdown on the device thread, waiting for them to finish.
+    bool InitializeOnDeviceThread(DeviceBase* parent);
+    void ShutdownOnDeviceThread();
+
+private:
+    Void shutdownCommand() { Shutdown(); return 0; }
 };
 
 
@@ -357,6 +456,17 @@ public:
     // Returns the thread id of the DeviceManager.
     virtual ThreadId GetThreadId() const = 0;
 
+    // Returns the queue of the thread that runs the device described by desc, and
+    // its id in threadId. Called on the manager thread when the device is created,
+    // before its Initialize, which then runs on that thread too. By default all
+    // devices run on the device manager thread.
+    virtual ThreadCommandQueue* GetThreadQueueFor(const DeviceCreateDesc* desc, ThreadId* threadId)
+    {
+        OVR_UNUSED(desc);
+        *threadId = GetThreadId();
+        return GetThreadQueue();
+    }
+
     virtual DeviceEnumerator<> EnumerateDevicesEx(const DeviceEnumerationArgs& args);
 
 
@@ -369,13 +479,20 @@ public:
         factory->AddedToManager(this);        
     }
 
+    // Manager messages are delivered on the manager thread; devices running on
+    // threads of their own queue them without waiting.
     void CallOnDeviceAdded(DeviceCreateDesc* desc)
     {
-        HandlerRef.Call(MessageDeviceStatus(Message_DeviceAdded, this, DeviceHandle(desc)));
+        callOnDeviceStatus(Message_DeviceAdded, DeviceHandle(desc));
     }
     void CallOnDeviceRemoved(DeviceCreateDesc* desc)
     {
-        HandlerRef.Call(MessageDeviceStatus(Message_DeviceRemoved, this, DeviceHandle(desc)));
+        callOnDeviceStatus(Message_DeviceRemoved, DeviceHandle(desc));
+    }
+    // Called on the manager thread once the profile manager has dropped its cache.
+    void CallOnProfileChanged()
+    {
+        HandlerRef.Call(Message(Message_ProfileChanged, this));
     }
 
     // Helper to access Common data for a device.
@@ -385,6 +502,17 @@ public:
     }
 
 
+    Void callOnDeviceStatus(MessageType type, DeviceHandle handle)
+    {
+        if (GetCurrentThreadId() != GetThreadId())
+        {
+            GetThreadQueue()->PushCall(this, &DeviceManagerImpl::callOnDeviceStatus, type, handle);
+            return 0;
+        }
+        HandlerRef.Call(MessageDeviceStatus(type, this, handle));
+        return 0;
+    }
+
     // Background-thread callbacks for DeviceCreation/Release. These
     DeviceBase* CreateDevice_MgrThread(DeviceCreateDesc* createDesc, DeviceBase* parent = 0);
     Void        ReleaseDevice_MgrThread(DeviceBase* device);
@@ -55,10 +55,12 @@ enum MessageType
     // Device Manager Messages
     Message_DeviceAdded             = OVR_MESSAGETYPE(Manager, 0),  // A new device is detected by manager.
     Message_DeviceRemoved           = OVR_MESSAGETYPE(Manager, 1),  // Existing device has been plugged/unplugged.
+    Message_ProfileChanged          = OVR_MESSAGETYPE(Manager, 2),  // Profile database was changed by another process.
     // Sensor Messages
     Message_BodyFrame               = OVR_MESSAGETYPE(Sensor, 0),   // Emitted by sensor at regular intervals.
     Message_ExposureFrame	        = OVR_MESSAGETYPE(Sensor, 1),
     Message_PixelRead               = OVR_MESSAGETYPE(Sensor, 2),
+    Message_BodyFrameBatch          = OVR_MESSAGETYPE(Sensor, 3),   // All body frames of one sensor report.
 
     // Latency Tester Messages
     Message_LatencyTestSamples          = OVR_MESSAGETYPE(LatencyTester, 0),
@@ -102,7 +104,7 @@ public:
 class MessageBodyFrame : public Message
 {
 public:
-    MessageBodyFrame(DeviceBase* dev)
+    MessageBodyFrame(DeviceBase* dev = 0)
         : Message(Message_BodyFrame, dev), Temperature(0.0f), TimeDelta(0.0f)
     {
     }
@@ -127,6 +129,26 @@ public:
     double   AbsoluteTimeSeconds;
 };
 
+// The body frames decoded from one sensor report, in order, passed to handlers in
+// a single call. The frames are owned by the sender and only valid during OnMessage.
+// Batches only go to handlers whose SupportsMessageType accepts Message_BodyFrameBatch;
+// other handlers receive each frame as a separate Message_BodyFrame.
+class MessageBodyFrameBatch : public Message
+{
+public:
+    MessageBodyFrameBatch(DeviceBase* dev, const MessageBodyFrame* frames, unsigned count,
+                          double receiveTimeSeconds = 0)
+        : Message(Message_BodyFrameBatch, dev), pFrames(frames), Count(count),
+          ReceiveTimeSeconds(receiveTimeSeconds)
+    {
+    }
+
+    const MessageBodyFrame* pFrames;
+    unsigned                Count;
+    // Host time the report was read at, on the clock of AbsoluteTimeSeconds, or 0.
+    double                  ReceiveTimeSeconds;
+};
+
 // Sent when we receive a device status changes (e.g.:
 // Message_DeviceAdded, Message_DeviceRemoved).
 class MessageDeviceStatus : public Message
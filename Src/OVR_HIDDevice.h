@@ -126,8 +126,21 @@ public:
     class HIDHandler
     {
     public:
-        virtual void OnInputReport(UByte* pData, UInt32 length)
-        { OVR_UNUSED2(pData, length); }
+        // receiveTime is the earliest Timer::GetSeconds time the transport has for
+        // the report's arrival, so that handlers don't count their own scheduling
+        // delay as transport latency.
+        virtual void OnInputReport(UByte* pData, UInt32 length, double receiveTime)
+        { OVR_UNUSED3(pData, length, receiveTime); }
+
+        // Called with several reports read in one go, in the order received; report i
+        // starts at pReports + i * reportStride. Delivers them one by one by default.
+        virtual void OnInputReports(UByte* pReports, UInt32 reportStride,
+                                    const UInt32* lengths, const double* receiveTimes,
+                                    UInt32 count)
+        {
+            for (UInt32 i = 0; i < count; i++)
+                OnInputReport(pReports + i * reportStride, lengths[i], receiveTimes[i]);
+        }
 
         virtual double OnTicks(double tickSeconds)
         { OVR_UNUSED1(tickSeconds);  return 1000.0 ; }
@@ -47,6 +47,8 @@ public:
         return HIDDesc.Path.CompareNoCase(path) == 0;
     }
 
+    virtual const HIDDeviceDesc* GetHIDDeviceDesc() const { return &HIDDesc; }
+
     HIDDeviceDesc HIDDesc;
 };
 
@@ -100,11 +102,7 @@ public:
     virtual bool Initialize(DeviceBase* parent)
     {
         // Open HID device.
-        HIDDeviceDesc&		hidDesc = *getHIDDesc();
-        HIDDeviceManager*   pManager = GetHIDDeviceManager();
-
-
-        HIDDevice* device = pManager->Open(hidDesc.Path);
+        HIDDevice* device = openHIDDevice(*getHIDDesc());
         if (!device)
         {
             return false;
@@ -141,7 +139,7 @@ public:
         // Push call with wait.
         bool result = false;
 
-		ThreadCommandQueue* pQueue = this->GetManagerImpl()->GetThreadQueue();
+		ThreadCommandQueue* pQueue = this->GetDeviceQueue();
         if (!pQueue->PushCallAndWaitResult(this, &HIDDeviceImpl::setFeatureReport, &result, data, length))
             return false;
 
@@ -157,7 +155,7 @@ public:
     { 
         bool result = false;
 
-		ThreadCommandQueue* pQueue = this->GetManagerImpl()->GetThreadQueue();
+		ThreadCommandQueue* pQueue = this->GetDeviceQueue();
         if (!pQueue->PushCallAndWaitResult(this, &HIDDeviceImpl::getFeatureReport, &result, data, length))
             return false;
 
@@ -181,6 +179,13 @@ public:
 	}
 
 protected:
+    // Opens the HID device that Initialize attaches to; devices that emulate
+    // their hardware override it. Returns a new reference, or NULL.
+    virtual HIDDevice* openHIDDevice(const HIDDeviceDesc& hidDesc)
+    {
+        return GetHIDDeviceManager()->Open(hidDesc.Path);
+    }
+
     HIDDevice* GetInternalDevice() const
     {
         return InternalDevice;
@@ -58,8 +58,14 @@ limitations under the License.
 #include <ctype.h>
 #include "OVR_JSON.h"
 #include "Kernel/OVR_SysFile.h"
+#include "Kernel/OVR_MappedFile.h"
 #include "Kernel/OVR_Log.h"
 
+#if defined(OVR_CPU_SSE) && (defined(__SSE2__) || defined(OVR_CPU_X86_64) || defined(OVR_OS_WIN32))
+#define OVR_JSON_SSE2
+#include <emmintrin.h>
+#endif
+
 namespace OVR {
 
 
@@ -77,32 +83,77 @@ static char* JSON_strdup(const char* str)
 
 
 //-----------------------------------------------------------------------------
-// Render the number from the given item into a string.
-static char* PrintNumber(double d)
+// Text being printed. When there's a writer, the text is handed to it between
+// items once it passes FlushSize, so the buffer stays small.
+struct JSONPrintBuffer
 {
-	char *str;
-	//double d=item->valuedouble;
-    int valueint = (int)d;
-	if (fabs(((double)valueint)-d)<=DBL_EPSILON && d<=INT_MAX && d>=INT_MIN)
-	{
-		str=(char*)OVR_ALLOC(21);	// 2^64+1 can be represented in 21 chars.
-		if (str)
-            OVR_sprintf(str, 21, "%d", valueint);
-	}
-	else
-	{
-		str=(char*)OVR_ALLOC(64);	// This is a nice tradeoff.
-		if (str)
-		{
-			if (fabs(floor(d)-d)<=DBL_EPSILON && fabs(d)<1.0e60)
-                OVR_sprintf(str, 64, "%.0f", d);
-			else if (fabs(d)<1.0e-6 || fabs(d)>1.0e9)
-                OVR_sprintf(str, 64, "%e", d);
-			else
-                OVR_sprintf(str, 64, "%f", d);
-		}
-	}
-	return str;
+    enum { FlushSize = 16 * 1024 };
+
+    ArrayPOD<char>* pText;
+    JSONWriter*     pWriter;
+    bool            Failed;
+
+    JSONPrintBuffer(ArrayPOD<char>* text, JSONWriter* writer = 0)
+        : pText(text), pWriter(writer), Failed(false) { }
+
+    void Flush(UPInt minSize = FlushSize)
+    {
+        if (!pWriter || pText->GetSize() < minSize || pText->GetSize() == 0)
+            return;
+        if (!Failed && !pWriter->Write(&(*pText)[0], pText->GetSize()))
+            Failed = true;
+        // Keeps the capacity for the next pieces.
+        pText->ClearKeepCapacity();
+    }
+};
+
+// Writes printed text to a file.
+class JSONFileWriter : public JSONWriter
+{
+public:
+    JSONFileWriter(File* file) : pFile(file) { }
+
+    virtual bool Write(const char* text, UPInt size)
+    {
+        OVR_ASSERT(size <= (UPInt)INT_MAX);
+        return pFile->Write((const UByte*)text, (int)size) == (int)size;
+    }
+
+private:
+    File* pFile;
+};
+
+//-----------------------------------------------------------------------------
+// Appends text to a print buffer. The buffer grows geometrically, so printing
+// a large tree doesn't copy its text over and over.
+static void appendText(ArrayPOD<char>* out, const char* text, UPInt len)
+{
+    UPInt pos = out->GetSize();
+    out->Resize(pos + len);
+    memcpy(&(*out)[pos], text, len);
+}
+
+static void appendText(ArrayPOD<char>* out, const char* text)
+{
+    appendText(out, text, OVR_strlen(text));
+}
+
+static void appendTabs(ArrayPOD<char>* out, int count)
+{
+    if (count <= 0)
+        return;
+    UPInt pos = out->GetSize();
+    out->Resize(pos + count);
+    memset(&(*out)[pos], '\t', count);
+}
+
+//-----------------------------------------------------------------------------
+// Render the number from the given item into a string; it reads back exactly.
+static void appendNumber(ArrayPOD<char>* out, double d)
+{
+    char  str[OVR_DtoaBufferSize];
+    UPInt length = OVR_dtoa(d, str, sizeof(str));
+    appendText(out, str, length);
 }
 
 // Parse the input text into an un-escaped cstring, and populate item.
@@ -136,65 +187,213 @@ JSON::~JSON()
 }
 
 //-----------------------------------------------------------------------------
-// Parse the input text to generate a number, and populate the result into item
-// Returns the text position after the parsed number
-const char* JSON::parseNumber(const char *num)
+// Number and string scanning
+
+// Returns the character at p, or 0 at the end of the text.
+static inline char peekChar(const char* p, const char* end)
 {
-    const char* num_start = num;
-    double      n=0, sign=1, scale=0;
-    int         subscale     = 0,
-                signsubscale = 1;
-
-	// Could use sscanf for this?
-	if (*num=='-') 
-        sign=-1,num++;	// Has sign?
-	if (*num=='0')
-        num++;			// is zero
-	
-    if (*num>='1' && *num<='9')	
+    return (p != end) ? *p : 0;
+}
+
+static inline bool isDigit(char c)
+{
+    return c >= '0' && c <= '9';
+}
+
+// Powers of ten that doubles hold exactly.
+static const double ExactPowersOfTen[] =
+{
+    1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,  1e8,  1e9,  1e10, 1e11,
+    1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+};
+
+// Numbers are read into a decimal mantissa of up to 19 digits and an exponent.
+// When the mantissa fits a double exactly and the exponent is within the exact
+// powers of ten, one multiply or divide gives the correctly rounded result
+// (Clinger's fast path), which covers the numbers we write. Anything else is
+// converted by OVR_strtod.
+const char* JSON::ParseNumber(const char* str, const char* end, double* value)
+{
+    const char* p        = str;
+    bool        negative = false;
+    UInt64      mantissa = 0;
+    int         digits   = 0;       // significant digits in mantissa
+    int         exponent = 0;       // decimal exponent of mantissa
+    bool        dropped  = false;   // non-zero digits didn't fit in mantissa
+
+    if (peekChar(p, end) == '-')
+    {
+        negative = true;
+        p++;
+    }
+
+    if (peekChar(p, end) == '0')
+        p++;
+    else if (isDigit(peekChar(p, end)))
     {
         do
-        {   
-            n=(n*10.0)+(*num++ -'0');
+        {
+            int d = *p++ - '0';
+            if (digits < 19)
+            {
+                mantissa = mantissa * 10 + d;
+                digits++;
+            }
+            else
+            {
+                exponent++;
+                dropped |= (d != 0);
+            }
         }
-        while (*num>='0' && *num<='9');	// Number?
+        while (isDigit(peekChar(p, end)));
     }
+    else
+        return 0;
 
-	if (*num=='.' && num[1]>='0' && num[1]<='9')
+    if (peekChar(p, end) == '.' && isDigit(peekChar(p + 1, end)))
     {
-        num++;
+        p++;
         do
         {
-            n=(n*10.0)+(*num++ -'0');
-            scale--;
+            int d = *p++ - '0';
+            if (digits < 19)
+            {
+                mantissa = mantissa * 10 + d;
+                exponent--;
+                if (mantissa)
+                    digits++;   // leading zeros aren't significant
+            }
+            else
+            {
+                dropped |= (d != 0);
+            }
         }
-        while (*num>='0' && *num<='9');  // Fractional part?
+        while (isDigit(peekChar(p, end)));
     }
 
-	if (*num=='e' || *num=='E')		// Exponent?
-	{
-        num++;
-        if (*num=='+')
-            num++;
-        else if (*num=='-')
+    if (peekChar(p, end) == 'e' || peekChar(p, end) == 'E')
+    {
+        int  scale    = 0;
+        bool negScale = false;
+
+        p++;
+        if (peekChar(p, end) == '+')
+            p++;
+        else if (peekChar(p, end) == '-')
         {
-            signsubscale=-1;
-            num++;		// With sign?
+            negScale = true;
+            p++;
         }
 
-		while (*num>='0' && *num<='9')
-            subscale=(subscale*10)+(*num++ - '0');	// Number?
-	}
+        while (isDigit(peekChar(p, end)))
+        {
+            if (scale < 100000)     // far past the range of doubles
+                scale = scale * 10 + (*p - '0');
+            p++;
+        }
+        exponent += negScale ? -scale : scale;
+    }
+
+    double n;
+    if (mantissa == 0)
+    {
+        n = 0.0;
+    }
+    else if (!dropped && mantissa <= (UInt64(1) << 53) && exponent >= -22 && exponent <= 22)
+    {
+        n = (double)mantissa;
+        n = (exponent < 0) ? n / ExactPowersOfTen[-exponent] : n * ExactPowersOfTen[exponent];
+    }
+    else
+    {
+        char buffer[347 + 1];
+        UPInt length = (UPInt)(p - str);
+        if (length < sizeof(buffer))
+        {
+            memcpy(buffer, str, length);
+            buffer[length] = 0;
+            *value = OVR_strtod(buffer, 0);
+            return p;
+        }
+        // Longer than OVR_strtod handles; the digits kept are plenty for a double.
+        n = (double)mantissa * pow(10.0, exponent);
+    }
 
-    // Number = +/- number.fraction * 10^+/- exponent
-	n = sign*n*pow(10.0,(scale+subscale*signsubscale));
+    *value = negative ? -n : n;
+    return p;
+}
+
+// Null-terminated text is scanned in aligned blocks, which never reach into
+// the next page past the terminator; the block that matched is finished a
+// character at a time.
+const char* JSON::ScanString(const char* str, const char* end)
+{
+    const char* p = str;
+
+#if defined(OVR_JSON_SSE2)
+    const __m128i quote = _mm_set1_epi8('\"');
+    const __m128i slash = _mm_set1_epi8('\\');
+    if (end)
+    {
+        for (; end - p >= 16; p += 16)
+        {
+            __m128i chars = _mm_loadu_si128((const __m128i*)p);
+            if (_mm_movemask_epi8(_mm_or_si128(_mm_cmpeq_epi8(chars, quote),
+                                               _mm_cmpeq_epi8(chars, slash))))
+                break;
+        }
+    }
+    else
+    {
+        const __m128i zero  = _mm_setzero_si128();
+        const char*   block = (const char*)((UPInt)p & ~(UPInt)15);
+        // Characters before str in the first block are masked off; the shift is
+        // below 16.
+        unsigned      mask  = ~0u << (unsigned)(p - block);
+        for (;; block += 16, mask = ~0u)
+        {
+            __m128i chars = _mm_load_si128((const __m128i*)block);
+            __m128i stops = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(chars, quote),
+                                                      _mm_cmpeq_epi8(chars, slash)),
+                                         _mm_cmpeq_epi8(chars, zero));
+            if ((unsigned)_mm_movemask_epi8(stops) & mask)
+                break;
+        }
+        if (block > p)
+            p = block;
+    }
+#endif
 
-    // Assign parsed value.
+    if (end)
+    {
+        while (p < end && *p != '\"' && *p != '\\')
+            p++;
+    }
+    else
+    {
+        while (*p && *p != '\"' && *p != '\\')
+            p++;
+    }
+    return p;
+}
+
+//-----------------------------------------------------------------------------
+// Parse the input text to generate a number, and populate the result into item
+// Returns the text position after the parsed number
+const char* JSON::parseNumber(const char *num)
+{
+    double      n    = 0;
+    const char* next = ParseNumber(num, 0, &n);
+
+    // A lone sign has always been read as zero
+    if (!next)
+        next = (*num == '-') ? num + 1 : num;
+
+    // Assign parsed value. Numbers only keep dValue; printing formats it again.
 	Type   = JSON_Number;
     dValue = n;
-    Value.AssignString(num_start, num - num_start);
     
-	return num;
+	return next;
 }
 
 // Parses a hex string up to the specified number of digits.
@@ -238,29 +437,43 @@ const char* JSON::parseString(const char* str, const char** perror)
     {
         return AssignError(perror, "Syntax Error: Missing quote");
     }
-	
-	while (*ptr!='\"' && *ptr && ++len)
-    {   
-        if (*ptr++ == '\\') ptr++;	// Skip escaped quotes.
+
+    // Most strings have no escapes and are copied as they are.
+    p = ScanString(ptr, 0);
+    if (*p != '\\')
+    {
+        Value = String(ptr, p - ptr);
+        Type  = JSON_String;
+        return (*p == '\"') ? p + 1 : p;
     }
 	
-    // This is how long we need for the string, roughly.
-	out=(char*)OVR_ALLOC(len+1);
+    // Find the end, skipping escaped quotes.
+    while (*p == '\\' && p[1])
+        p = ScanString(p + 2, 0);
+	
+    // Decoded strings are never longer than their text.
+    len = (int)(p - ptr);
+	out=(char*)OVR_ALLOC_TAGGED(AllocSubsystem_JSON, len+1);
 	if (!out)
         return 0;
 	
-	ptr = str+1;
     ptr2= out;
 
 	while (*ptr!='\"' && *ptr)
 	{
 		if (*ptr!='\\')
         {
-            *ptr2++ = *ptr++;
+            // Copy up to the next escape at once.
+            p = ScanString(ptr, 0);
+            memcpy(ptr2, ptr, p - ptr);
+            ptr2 += p - ptr;
+            ptr   = p;
         }
 		else
 		{
 			ptr++;
+            if (!*ptr)
+                break;  // Text ends inside the escape.
 			switch (*ptr)
 			{
 				case 'b': *ptr2++ = '\b';	break;
@@ -339,63 +552,43 @@ const char* JSON::parseString(const char* str, const char** perror)
 
 //-----------------------------------------------------------------------------
 // Render the string provided to an escaped version that can be printed.
-char* PrintString(const char* str)
+static void appendString(ArrayPOD<char>* out, const char* str)
 {
-	const char *ptr;
-    char *ptr2,*out;
-    int len=0;
-    unsigned char token;
-	
-	if (!str)
-        return JSON_strdup("");
-	ptr=str;
-    
-    token=*ptr;
-    while (token && ++len)\
-    {
-        if (strchr("\"\\\b\f\n\r\t",token))
-            len++;
-        else if (token<32) 
-            len+=5;
-        ptr++;
-        token=*ptr;
-    }
-	
-	int buff_size = len+3;
-    out=(char*)OVR_ALLOC(buff_size);
-	if (!out)
-        return 0;
-
-	ptr2 = out;
-    ptr  = str;
-	*ptr2++ = '\"';
+	const char* ptr = str ? str : "";
 
+	out->PushBack('\"');
 	while (*ptr)
 	{
-		if ((unsigned char)*ptr>31 && *ptr!='\"' && *ptr!='\\') 
-            *ptr2++=*ptr++;
-		else
+        // Copy runs of characters that need no escaping at once
+        const char* run = ptr;
+		while ((unsigned char)*ptr>31 && *ptr!='\"' && *ptr!='\\')
+            ptr++;
+        if (ptr > run)
+            appendText(out, run, ptr - run);
+        if (!*ptr)
+            break;
+
+		out->PushBack('\\');
+		unsigned char token = *ptr++;
+		switch (token)
 		{
-			*ptr2++='\\';
-			switch (token=*ptr++)
-			{
-				case '\\':	*ptr2++='\\';	break;
-				case '\"':	*ptr2++='\"';	break;
-				case '\b':	*ptr2++='b';	break;
-				case '\f':	*ptr2++='f';	break;
-				case '\n':	*ptr2++='n';	break;
-				case '\r':	*ptr2++='r';	break;
-				case '\t':	*ptr2++='t';	break;
-				default: 
-                    OVR_sprintf(ptr2, buff_size - (ptr2-out), "u%04x",token);
-                    ptr2+=5;
-                    break;	// Escape and print.
-			}
+			case '\\':	out->PushBack('\\');	break;
+			case '\"':	out->PushBack('\"');	break;
+			case '\b':	out->PushBack('b');	break;
+			case '\f':	out->PushBack('f');	break;
+			case '\n':	out->PushBack('n');	break;
+			case '\r':	out->PushBack('r');	break;
+			case '\t':	out->PushBack('t');	break;
+			default:
+                {
+                    char hex[8];
+                    OVR_sprintf(hex, sizeof(hex), "u%04x", token);
+                    appendText(out, hex, 5);
+                }
+                break;	// Escape and print.
 		}
 	}
-	*ptr2++='\"';
-    *ptr2++=0;
-	return out;
+	out->PushBack('\"');
 }
 
 //-----------------------------------------------------------------------------
@@ -499,27 +692,63 @@ const char* JSON::parseValue(const char* buff, const char** perror)
 
 
 //-----------------------------------------------------------------------------
-// Render a value to text. 
+// Render a value to text. The returned text must be freed
 char* JSON::PrintValue(int depth, bool fmt)
 {
-	char *out=0;
+    ArrayPOD<char>  text;
+    JSONPrintBuffer buffer(&text);
+    printValue(&buffer, depth, fmt);
+
+    char* out = (char*)OVR_ALLOC(text.GetSize() + 1);
+    if (out)
+    {
+        if (text.GetSize())
+            memcpy(out, &text[0], text.GetSize());
+        out[text.GetSize()] = 0;
+    }
+    return out;
+}
+
+void JSON::printValue(JSONPrintBuffer* buffer, int depth, bool fmt)
+{
+    ArrayPOD<char>* out = buffer->pText;
 
     switch (Type)
 	{
-        case JSON_Null:	    out = JSON_strdup("null");	break;
+        case JSON_Null:	    appendText(out, "null", 4);	break;
         case JSON_Bool:
             if (dValue == 0)
-                out = JSON_strdup("false");
+                appendText(out, "false", 5);
             else
-                out = JSON_strdup("true");
+                appendText(out, "true", 4);
             break;
-        case JSON_Number:	out = PrintNumber(dValue); break;
-        case JSON_String:	out = PrintString(Value); break;
-        case JSON_Array:	out = PrintArray(depth, fmt); break;
-        case JSON_Object:	out = PrintObject(depth, fmt); break;
+        case JSON_Number:	appendNumber(out, dValue); break;
+        case JSON_String:	appendString(out, Value); break;
+        case JSON_Array:	printArray(buffer, depth, fmt); break;
+        case JSON_Object:	printObject(buffer, depth, fmt); break;
         case JSON_None: OVR_ASSERT_LOG(false, ("Bad JSON type.")); break;
 	}
-	return out;
+}
+
+void JSON::Print(ArrayPOD<char>* out, bool fmt)
+{
+    JSONPrintBuffer buffer(out);
+    printValue(&buffer, 0, fmt);
+}
+
+bool JSON::Print(JSONWriter* writer, bool fmt)
+{
+    ArrayPOD<char>  text;
+    JSONPrintBuffer buffer(&text, writer);
+    printValue(&buffer, 0, fmt);
+    buffer.Flush(0);
+    return !buffer.Failed;
+}
+
+bool JSON::Print(File* file, bool fmt)
+{
+    JSONFileWriter writer(file);
+    return Print(&writer, fmt);
 }
 
 //-----------------------------------------------------------------------------
@@ -568,87 +797,28 @@ const char* JSON::parseArray(const char* buff, const char** perror)
 }
 
 //-----------------------------------------------------------------------------
-// Render an array to text.  The returned text must be freed
-char* JSON::PrintArray(int depth, bool fmt)
+// Render an array to text.
+void JSON::printArray(JSONPrintBuffer* buffer, int depth, bool fmt)
 {
-	char **entries;
-	char * out = 0,*ptr,*ret;
-    SPInt  len = 5;
-	
-    bool fail = false;
-	
-	// How many entries in the array? 
-    int numentries = GetItemCount();
-	if (!numentries)
-	{
-		out=(char*)OVR_ALLOC(3);
-		if (out)
-            OVR_strcpy(out, 3, "[]");
-		return out;
-	}
-	// Allocate an array to hold the values for each
-	entries=(char**)OVR_ALLOC(numentries*sizeof(char*));
-	if (!entries)
-        return 0;
-	memset(entries,0,numentries*sizeof(char*));
+    ArrayPOD<char>* out = buffer->pText;
+	out->PushBack('[');
 
-	//// Retrieve all the results:
     JSON* child = Children.GetFirst();
-    for (int i=0; i<numentries; i++)
+    while (!Children.IsNull(child))
 	{
-		//JSON* child = Children[i];
-        ret=child->PrintValue(depth+1, fmt);
-		entries[i]=ret;
-		if (ret)
-            len+=OVR_strlen(ret)+2+(fmt?1:0);
-        else
-        {
-            fail = true;
-            break;
-        }
-        child = Children.GetNext(child);
-	}
-	
-	// If we didn't fail, try to malloc the output string 
-	if (!fail)
-        out=(char*)OVR_ALLOC(len);
-	// If that fails, we fail. 
-	if (!out)
-        fail = true;
+        child->printValue(buffer, depth+1, fmt);
+        buffer->Flush();
 
-	// Handle failure.
-	if (fail)
-	{
-		for (int i=0; i<numentries; i++) 
-        {
-            if (entries[i])
-                OVR_FREE(entries[i]);
-        }
-		OVR_FREE(entries);
-		return 0;
-	}
-	
-	// Compose the output array.
-	*out='[';
-	ptr=out+1;
-    *ptr=0;
-	for (int i=0; i<numentries; i++)
-	{
-		OVR_strcpy(ptr, len - (ptr-out), entries[i]);
-        ptr+=OVR_strlen(entries[i]);
-		if (i!=numentries-1)
+        child = Children.GetNext(child);
+		if (!Children.IsNull(child))
         {
-            *ptr++=',';
+            out->PushBack(',');
             if (fmt)
-                *ptr++=' ';
-            *ptr=0;
+                out->PushBack(' ');
         }
-		OVR_FREE(entries[i]);
 	}
-	OVR_FREE(entries);
-	*ptr++=']';
-    *ptr++=0;
-	return out;	
+
+	out->PushBack(']');
 }
 
 //-----------------------------------------------------------------------------
@@ -717,148 +887,55 @@ const char* JSON::parseObject(const char* buff, const char** perror)
 }
 
 //-----------------------------------------------------------------------------
-// Render an object to text.  The returned string must be freed
-char* JSON::PrintObject(int depth, bool fmt)
+// Render an object to text.
+void JSON::printObject(JSONPrintBuffer* buffer, int depth, bool fmt)
 {
-	char** entries = 0, **names = 0;
-	char*  out = 0;
-    char*  ptr, *ret, *str;
-    SPInt  len = 7, i = 0, j;
-    bool   fail = false;
-	
-    // Count the number of entries.
-    int numentries = GetItemCount();
-    
+    ArrayPOD<char>* out = buffer->pText;
+	out->PushBack('{');
+
 	// Explicitly handle empty object case
-	if (numentries == 0)
+    if (Children.IsEmpty())
 	{
-		out=(char*)OVR_ALLOC(fmt?depth+3:3);
-		if (!out)
-            return 0;
-		ptr=out;
-        *ptr++='{';
-		
         if (fmt)
         {
-            *ptr++='\n';
-            for (i=0;i<depth-1;i++)
-                *ptr++='\t';
+            out->PushBack('\n');
+            appendTabs(out, depth-1);
         }
-		*ptr++='}';
-        *ptr++=0;
-		return out;
+		out->PushBack('}');
+		return;
 	}
-	// Allocate space for the names and the objects
-	entries=(char**)OVR_ALLOC(numentries*sizeof(char*));
-	if (!entries)
-        return 0;
-	names=(char**)OVR_ALLOC(numentries*sizeof(char*));
-	
-    if (!names)
-    {
-        OVR_FREE(entries);
-        return 0;
-    }
-	memset(entries,0,sizeof(char*)*numentries);
-	memset(names,0,sizeof(char*)*numentries);
 
-	// Collect all the results into our arrays:
     depth++;
     if (fmt)
-        len+=depth;
+        out->PushBack('\n');
 
     JSON* child = Children.GetFirst();
     while (!Children.IsNull(child))
-	{
-		names[i]     = str = PrintString(child->Name);
-		entries[i++] = ret = child->PrintValue(depth, fmt);
-
-		if (str && ret)
-        {
-            len += OVR_strlen(ret)+OVR_strlen(str)+2+(fmt?2+depth:0);
-        }
-        else
-        {
-            fail = true;
-            break;
-        }
-		
-        child = Children.GetNext(child);
-	}
-	
-	// Try to allocate the output string
-	if (!fail)
-        out=(char*)OVR_ALLOC(len);
-	if (!out)
-        fail=true;
-
-	// Handle failure
-	if (fail)
-	{
-		for (i=0;i<numentries;i++)
-        {
-            if (names[i])
-                OVR_FREE(names[i]);
-            
-            if (entries[i])
-                OVR_FREE(entries[i]);}
-		
-        OVR_FREE(names);
-        OVR_FREE(entries);
-		return 0;
-	}
-	
-	// Compose the output:
-	*out = '{';
-    ptr  = out+1;
-    if (fmt)
-        *ptr++='\n';
-    *ptr = 0;
-	
-    for (i=0; i<numentries; i++)
 	{
 		if (fmt)
-        {
-            for (j=0; j<depth; j++)
-                *ptr++ = '\t';
-        }
-		OVR_strcpy(ptr, len - (ptr-out), names[i]);
-        ptr   += OVR_strlen(names[i]);
-		*ptr++ =':';
-        
+            appendTabs(out, depth);
+
+		appendString(out, child->Name);
+		out->PushBack(':');
         if (fmt)
-            *ptr++='\t';
-		
-        OVR_strcpy(ptr, len - (ptr-out), entries[i]);
-        ptr+=OVR_strlen(entries[i]);
-		
-        if (i!=numentries-1)
-            *ptr++ = ',';
-		
+            out->PushBack('\t');
+
+		child->printValue(buffer, depth, fmt);
+        buffer->Flush();
+
+        child = Children.GetNext(child);
+        if (!Children.IsNull(child))
+            out->PushBack(',');
         if (fmt)
-            *ptr++ = '\n';
-        *ptr = 0;
-		
-        OVR_FREE(names[i]);
-        OVR_FREE(entries[i]);
+            out->PushBack('\n');
 	}
-	
-	OVR_FREE(names);
-    OVR_FREE(entries);
-	
+
     if (fmt)
-    {
-        for (i=0;i<depth-1;i++)
-            *ptr++='\t';
-    }
-	*ptr++='}';
-    *ptr++=0;
-	
-    return out;	
+        appendTabs(out, depth-1);
+	out->PushBack('}');
 }
 
 
-
 // Returns the number of child items in the object
 // Counts the number of items in the object.
 unsigned JSON::GetItemCount() const
@@ -1036,6 +1113,26 @@ String JSON::GetStringByName(const char *name, const String &defValue)
 	}
 }
 
+int JSON::GetMajorVersion() const
+{
+    if (Type == JSON_Number)
+        return (int)dValue;
+    return (int)OVR_strtol(Value.ToCStr(), NULL, 10);
+}
+
+int JSON::GetMinorVersion() const
+{
+    char        number[32];
+    const char* text = Value.ToCStr();
+    if (Type == JSON_Number)
+    {
+        OVR_sprintf(number, sizeof(number), "%.6g", dValue);
+        text = number;
+    }
+    const char* dot = strchr(text, '.');
+    return dot ? (int)OVR_strtol(dot + 1, NULL, 10) : 0;
+}
+
 //-----------------------------------------------------------------------------
 // Adds an element to an array object type
 void JSON::AddArrayElement(JSON *item)
@@ -1131,55 +1228,67 @@ JSON* JSON::Copy()
 // The returned object must be Released after use.
 JSON* JSON::Load(const char* path, const char** perror)
 {
-    SysFile f;
-    if (!f.Open(path, File::Open_Read, File::Mode_Read))
+    // The mapped contents are null-terminated, so they are parsed in place.
+    MappedFile f(path);
+    if (!f.IsValid())
     {
         AssignError(perror, "Failed to open file");
         return NULL;
     }
 
-    int    len   = f.GetLength();
-    UByte* buff  = (UByte*)OVR_ALLOC(len + 1);
-    int    bytes = f.Read(buff, len);
-    f.Close();
-
-    if (bytes == 0 || bytes != len)
-    {
-        OVR_FREE(buff);
+    if (f.GetLength() == 0)
         return NULL;
-    }
 
-	// Ensure the result is null-terminated since Parse() expects null-terminated input.
-	buff[len] = '\0';
-
-    JSON* json = JSON::Parse((char*)buff, perror);
-    OVR_FREE(buff);
-    return json;
+    return JSON::Parse((const char*)f.GetData(), perror);
 }
 
 //-----------------------------------------------------------------------------
 // Serializes the JSON object and writes to the give file path
+// Save and SaveText write a new file and move it over the old one, so that the
+// file is never left half written.
+static bool MoveOverFile(const String& tempPath, const char* path, bool written)
+{
+#if defined(OVR_OS_WIN32)
+    // rename doesn't replace existing files on Windows.
+    if (written)
+        remove(path);
+#endif
+    if (!written || rename(tempPath.ToCStr(), path) != 0)
+    {
+        remove(tempPath.ToCStr());
+        return false;
+    }
+    return true;
+}
+
 bool JSON::Save(const char* path)
 {
+    // The text is streamed to the file rather than built up in memory.
+    String tempPath = String(path) + ".tmp";
+
     SysFile f;
-    if (!f.Open(path, File::Open_Write | File::Open_Create | File::Open_Truncate, File::Mode_Write))
+    if (!f.Open(tempPath, File::Open_Write | File::Open_Create | File::Open_Truncate, File::Mode_Write))
         return false;
 
-    char* text = PrintValue(0, true);
-    if (text)
-    {
-        SPInt len   = OVR_strlen(text);
-        OVR_ASSERT(len <= (SPInt)(int)len);
+    bool written = Print(&f, true);
+    written = f.Close() && written;
 
-        int   bytes = f.Write((UByte*)text, (int)len);
-        f.Close();
-        OVR_FREE(text);
-        return (bytes == len);
-    }
-    else
-    {
+    return MoveOverFile(tempPath, path, written);
+}
+
+bool JSON::SaveText(const char* path, const char* text, UPInt size)
+{
+    String tempPath = String(path) + ".tmp";
+
+    SysFile f;
+    if (!f.Open(tempPath, File::Open_Write | File::Open_Create | File::Open_Truncate, File::Mode_Write))
         return false;
-    }
+
+    OVR_ASSERT(size <= (UPInt)INT_MAX);
+    bool written = f.Write((const UByte*)text, (int)size) == (int)size;
+    f.Close();
+
+    return MoveOverFile(tempPath, path, written);
 }
 
 }
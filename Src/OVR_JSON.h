@@ -32,9 +32,13 @@ limitations under the License.
 #include "Kernel/OVR_RefCount.h"
 #include "Kernel/OVR_String.h"
 #include "Kernel/OVR_List.h"
+#include "Kernel/OVR_Array.h"
 
 namespace OVR {  
 
+class File;
+struct JSONPrintBuffer;
+
 // JSONItemType describes the type of JSON item, specifying the type of
 // data that can be obtained from it.
 enum JSONItemType
@@ -48,23 +52,44 @@ enum JSONItemType
     JSON_Object    = 6
 };
 
+//-----------------------------------------------------------------------------
+// ***** JSONWriter
+
+// Receives the text printed by JSON::Print, a piece at a time, so that a tree can
+// be written out without holding all of its text.
+class JSONWriter
+{
+public:
+    virtual ~JSONWriter() { }
+
+    // Returns false to stop printing.
+    virtual bool    Write(const char* text, UPInt size) = 0;
+};
+
+
 //-----------------------------------------------------------------------------
 // ***** JSON
 
 // JSON object represents a JSON node that can be either a root of the JSON tree
 // or a child item. Every node has a type that describes what is is.
 // New JSON trees are typically loaded JSON::Load or created with JSON::Parse.
+//
+// Reference counting is not thread-safe: a tree is only used by one thread at a
+// time, the one that loaded or built it, or the holder of the lock of the
+// ProfileManager that caches it.
 
-class JSON : public RefCountBase<JSON>, public ListNode<JSON>
+class JSON : public RefCountBaseNTS<JSON>, public ListNode<JSON>
 {
 protected:
     List<JSON>      Children;
 
 public:
+    OVR_MEMORY_REDEFINE_NEW_TAGGED(AllocSubsystem_JSON)
+
     JSONItemType    Type;       // Type of this JSON node.
     String          Name;       // Name part of the {Name, Value} pair in a parent object.
-    String          Value;
-    double          dValue;
+    String          Value;      // Text of a string; empty for numbers.
+    double          dValue;     // Value of a number, or 1 or 0 for a bool.
 
 public:
     ~JSON();
@@ -89,8 +114,25 @@ public:
     // Returns 0 and assigns perror with error message on fail.
     static JSON*    Load(const char* path, const char** perror = 0);
 
-    // Saves a JSON object to a file.
+    // Saves a JSON object to a file. The file is replaced through a temporary
+    // file, so that it's never left half written.
     bool            Save(const char* path);
+    // Writes text to a file the same way.
+    static bool     SaveText(const char* path, const char* text, UPInt size);
+
+    // Appends the formatted or compact text of this object to out.
+    void            Print(ArrayPOD<char>* out, bool fmt = true);
+    // Streams the text to a writer or file, through a buffer of FlushSize bytes.
+    // Returns false if a write failed.
+    bool            Print(JSONWriter* writer, bool fmt = true);
+    bool            Print(File* file, bool fmt = true);
+
+    // Text scanners shared with JSONReader; end is null for null-terminated text.
+    // Converts the number at str into *value, correctly rounded, and returns the
+    // position after it, or null if str doesn't start with a number.
+    static const char* ParseNumber(const char* str, const char* end, double* value);
+    // Returns the first quote or backslash at or after str, or the end of the text.
+    static const char* ScanString(const char* str, const char* end);
 
     // *** Object Member Access
 
@@ -111,6 +153,11 @@ public:
 	bool			GetBoolByName(const char *name, bool defValue = false);
 	String			GetStringByName(const char *name, const String &defValue = "");
 
+    // Major and minor numbers of a version item written as text, such as "2.1", or
+    // as a number; numbers don't keep their text, so theirs is formatted again.
+    int             GetMajorVersion() const;
+    int             GetMinorVersion() const;
+
     // Returns next item in a list of children; 0 if no more items exist.
     JSON*           GetNextItem(JSON* item)  { return Children.IsNull(item->pNext) ? 0 : item->pNext; }
     JSON*           GetPrevItem(JSON* item)  { return Children.IsNull(item->pPrev) ? 0 : item->pPrev; }
@@ -153,9 +200,11 @@ protected:
     const char*     parseObject(const char* value, const char** perror);
     const char*     parseString(const char* str, const char** perror);
 
+    // Renders this item to text. The returned text must be freed with OVR_FREE.
     char*           PrintValue(int depth, bool fmt);
-    char*           PrintObject(int depth, bool fmt);
-    char*           PrintArray(int depth, bool fmt);
+    void            printValue(JSONPrintBuffer* out, int depth, bool fmt);
+    void            printObject(JSONPrintBuffer* out, int depth, bool fmt);
+    void            printArray(JSONPrintBuffer* out, int depth, bool fmt);
 };
 
 
@@ -0,0 +1,702 @@
+/************************************************************************************
+
+Filename    :   OVR_JSONReader.cpp
+Content     :   Streaming JSON reader and arena-allocated JSON document
+Created     :   October 14, 2026
+Notes       :
+
+Copyright   :   Copyright 2014 Oculus VR, Inc. All Rights reserved.
+
+Licensed under the Oculus VR Rift SDK License Version 3.1 (the "License");
+you may not use the Oculus VR Rift SDK except in compliance with the License,
+which is provided at the time of installation or download, or which
+otherwise accompanies this software in either electronic or hard copy form.
+
+You may obtain a copy of the License at
+
+http://www.oculusvr.com/licenses/LICENSE-3.1
+
+Unless required by applicable law or agreed to in writing, the Oculus VR SDK
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+************************************************************************************/
+
+#include "OVR_JSONReader.h"
+#include <string.h>
+
+#ifdef OVR_JSON_BENCHMARK
+#include "Kernel/OVR_Log.h"
+#include "Kernel/OVR_Timer.h"
+#endif
+
+namespace OVR {
+
+
+bool JSONStringView::operator == (const char* str) const
+{
+    return strncmp(pData ? pData : "", str, Size) == 0 && str[Size] == 0;
+}
+
+
+//-----------------------------------------------------------------------------
+// ***** JSONReader
+
+// Recursive descent over [Pos, End). Errors are kept in pError, and the first
+// one is reported.
+class JSONReaderImpl
+{
+public:
+    JSONReaderImpl(const char* buff, UPInt len, JSONHandler* handler)
+        : Pos(buff), End(buff + len), pHandler(handler), pError(0)
+    { }
+
+    bool parseDocument();
+
+    const char* GetError() const { return pError; }
+
+private:
+    // Current character, or 0 past the end.
+    char    peek() const            { return (Pos < End) ? *Pos : 0; }
+    void    skip()                  { while (Pos < End && (unsigned char)*Pos <= ' ') Pos++; }
+    bool    match(const char* literal, UPInt size);
+
+    bool    fail(const char* error) { if (!pError) pError = error; return false; }
+    bool    handled(bool ok)        { return ok ? true : fail("Error: Parse stopped by handler"); }
+
+    bool    parseValue(int depth);
+    bool    parseNumber();
+    bool    parseString(JSONStringView* str);
+    bool    parseArray(int depth);
+    bool    parseObject(int depth);
+
+    void    appendUTF8(unsigned uc);
+    bool    parseHex4(unsigned* val);
+
+    const char*     Pos;
+    const char*     End;
+    JSONHandler*    pHandler;
+    const char*     pError;
+    // Decoded strings that had escape sequences.
+    ArrayPOD<char>  Scratch;
+};
+
+bool JSONReaderImpl::match(const char* literal, UPInt size)
+{
+    if ((UPInt)(End - Pos) < size || strncmp(Pos, literal, size) != 0)
+        return false;
+    Pos += size;
+    return true;
+}
+
+bool JSONReaderImpl::parseDocument()
+{
+    skip();
+    if (!parseValue(0))
+        return false;
+
+    skip();
+    if (Pos != End)
+        return fail("Syntax Error: Unexpected text after value");
+    return true;
+}
+
+bool JSONReaderImpl::parseValue(int depth)
+{
+    switch (peek())
+    {
+    case 'n':
+        if (match("null", 4))
+            return handled(pHandler->OnNull());
+        break;
+    case 'f':
+        if (match("false", 5))
+            return handled(pHandler->OnBool(false));
+        break;
+    case 't':
+        if (match("true", 4))
+            return handled(pHandler->OnBool(true));
+        break;
+    case '\"':
+        {
+            JSONStringView str;
+            return parseString(&str) && handled(pHandler->OnString(str));
+        }
+    case '[':
+        return parseArray(depth);
+    case '{':
+        return parseObject(depth);
+    default:
+        if (peek() == '-' || (peek() >= '0' && peek() <= '9'))
+            return parseNumber();
+        break;
+    }
+
+    return fail("Syntax Error: Invalid syntax");
+}
+
+// Same number syntax and conversion as JSON::parseNumber.
+bool JSONReaderImpl::parseNumber()
+{
+    const char* start = Pos;
+    double      n     = 0;
+
+    const char* next = JSON::ParseNumber(Pos, End, &n);
+    if (!next)
+        return fail("Syntax Error: Invalid number");
+
+    Pos = next;
+    return handled(pHandler->OnNumber(n, JSONStringView(start, Pos - start)));
+}
+
+bool JSONReaderImpl::parseHex4(unsigned* val)
+{
+    if (End - Pos < 4)
+        return false;
+
+    *val = 0;
+    for (int i = 0; i < 4; i++)
+    {
+        unsigned v = (unsigned char)Pos[i];
+        if (v >= '0' && v <= '9')
+            v -= '0';
+        else if (v >= 'a' && v <= 'f')
+            v = 10 + v - 'a';
+        else if (v >= 'A' && v <= 'F')
+            v = 10 + v - 'A';
+        else
+            return false;
+        *val = *val * 16 + v;
+    }
+    Pos += 4;
+    return true;
+}
+
+void JSONReaderImpl::appendUTF8(unsigned uc)
+{
+    if (uc < 0x80)
+        Scratch.PushBack((char)uc);
+    else if (uc < 0x800)
+    {
+        Scratch.PushBack((char)(0xC0 | (uc >> 6)));
+        Scratch.PushBack((char)(0x80 | (uc & 0x3F)));
+    }
+    else if (uc < 0x10000)
+    {
+        Scratch.PushBack((char)(0xE0 | (uc >> 12)));
+        Scratch.PushBack((char)(0x80 | ((uc >> 6) & 0x3F)));
+        Scratch.PushBack((char)(0x80 | (uc & 0x3F)));
+    }
+    else
+    {
+        Scratch.PushBack((char)(0xF0 | (uc >> 18)));
+        Scratch.PushBack((char)(0x80 | ((uc >> 12) & 0x3F)));
+        Scratch.PushBack((char)(0x80 | ((uc >> 6) & 0x3F)));
+        Scratch.PushBack((char)(0x80 | (uc & 0x3F)));
+    }
+}
+
+// Strings without escapes are returned in place; others are decoded into Scratch,
+// dropping invalid UTF-16 escapes as JSON::parseString does.
+bool JSONReaderImpl::parseString(JSONStringView* str)
+{
+    if (peek() != '\"')
+        return fail("Syntax Error: Missing quote");
+    Pos++;
+
+    const char* start = Pos;
+    Pos = JSON::ScanString(Pos, End);
+
+    if (peek() == '\"')
+    {
+        *str = JSONStringView(start, Pos - start);
+        Pos++;
+        return true;
+    }
+
+    Scratch.Clear();
+    if (Pos > start)
+    {
+        Scratch.Resize(Pos - start);
+        memcpy(&Scratch[0], start, Pos - start);
+    }
+
+    while (Pos < End && *Pos != '\"')
+    {
+        if (*Pos != '\\')
+        {   // Copy up to the next escape at once.
+            const char* run  = JSON::ScanString(Pos, End);
+            UPInt       size = Scratch.GetSize();
+            Scratch.Resize(size + (run - Pos));
+            memcpy(&Scratch[size], Pos, run - Pos);
+            Pos = run;
+            continue;
+        }
+
+        if (++Pos == End)
+            break;
+
+        char c = *Pos++;
+        switch (c)
+        {
+        case 'b': Scratch.PushBack('\b'); break;
+        case 'f': Scratch.PushBack('\f'); break;
+        case 'n': Scratch.PushBack('\n'); break;
+        case 'r': Scratch.PushBack('\r'); break;
+        case 't': Scratch.PushBack('\t'); break;
+
+        case 'u':
+            {
+                unsigned uc, uc2;
+                if (!parseHex4(&uc) || uc == 0 || (uc >= 0xDC00 && uc <= 0xDFFF))
+                    break;
+
+                // UTF-16 surrogate pairs.
+                if (uc >= 0xD800 && uc <= 0xDBFF)
+                {
+                    if (End - Pos < 2 || Pos[0] != '\\' || Pos[1] != 'u')
+                        break;
+                    Pos += 2;
+                    if (!parseHex4(&uc2) || uc2 < 0xDC00 || uc2 > 0xDFFF)
+                        break;
+                    uc = 0x10000 + (((uc & 0x3FF) << 10) | (uc2 & 0x3FF));
+                }
+                appendUTF8(uc);
+            }
+            break;
+
+        default:
+            Scratch.PushBack(c);
+            break;
+        }
+    }
+
+    if (peek() != '\"')
+        return fail("Syntax Error: Missing quote");
+    Pos++;
+
+    *str = JSONStringView(Scratch.GetSize() ? &Scratch[0] : "", Scratch.GetSize());
+    return true;
+}
+
+bool JSONReaderImpl::parseArray(int depth)
+{
+    if (depth >= JSONReader::MaxDepth)
+        return fail("Syntax Error: Nesting too deep");
+
+    Pos++;
+    if (!handled(pHandler->OnBeginArray()))
+        return false;
+
+    skip();
+    if (peek() == ']')
+    {
+        Pos++;
+        return handled(pHandler->OnEndArray());
+    }
+
+    while (true)
+    {
+        skip();
+        if (!parseValue(depth + 1))
+            return false;
+
+        skip();
+        if (peek() == ',')
+        {
+            Pos++;
+            continue;
+        }
+        if (peek() == ']')
+        {
+            Pos++;
+            return handled(pHandler->OnEndArray());
+        }
+        return fail("Syntax Error: Missing ending bracket");
+    }
+}
+
+bool JSONReaderImpl::parseObject(int depth)
+{
+    if (depth >= JSONReader::MaxDepth)
+        return fail("Syntax Error: Nesting too deep");
+
+    Pos++;
+    if (!handled(pHandler->OnBeginObject()))
+        return false;
+
+    skip();
+    if (peek() == '}')
+    {
+        Pos++;
+        return handled(pHandler->OnEndObject());
+    }
+
+    while (true)
+    {
+        JSONStringView name;
+
+        skip();
+        if (!parseString(&name) || !handled(pHandler->OnKey(name)))
+            return false;
+
+        skip();
+        if (peek() != ':')
+            return fail("Syntax Error: Missing colon");
+        Pos++;
+
+        skip();
+        if (!parseValue(depth + 1))
+            return false;
+
+        skip();
+        if (peek() == ',')
+        {
+            Pos++;
+            continue;
+        }
+        if (peek() == '}')
+        {
+            Pos++;
+            return handled(pHandler->OnEndObject());
+        }
+        return fail("Syntax Error: Missing closing brace");
+    }
+}
+
+
+bool JSONReader::Parse(const char* buff, UPInt len, JSONHandler* handler, const char** perror)
+{
+    if (perror)
+        *perror = 0;
+
+    JSONReaderImpl reader(buff, len, handler);
+    if (reader.parseDocument())
+        return true;
+
+    if (perror)
+        *perror = reader.GetError();
+    return false;
+}
+
+
+//-----------------------------------------------------------------------------
+// ***** JSONDocument
+
+// Builds the tree from the reader's callbacks. Items of the open containers are
+// kept in Pending after their container, and moved into the arena together once
+// the container ends.
+class JSONDocument::Builder : public JSONHandler
+{
+public:
+    Builder(JSONDocument* doc) : pDoc(doc) { }
+
+    virtual bool OnNull()
+    {
+        push(JSON_Null);
+        return true;
+    }
+    virtual bool OnBool(bool value)
+    {
+        Node* node   = push(JSON_Bool);
+        node->Value  = value ? JSONStringView("true", 4) : JSONStringView("false", 5);
+        node->dValue = value ? 1.0 : 0.0;
+        return true;
+    }
+    virtual bool OnNumber(double value, const JSONStringView& text)
+    {
+        Node* node   = push(JSON_Number);
+        node->Value  = pDoc->keepString(text);
+        node->dValue = value;
+        return true;
+    }
+    virtual bool OnString(const JSONStringView& value)
+    {
+        JSONStringView str = pDoc->keepString(value);
+        push(JSON_String)->Value = str;
+        return str.pData != 0;
+    }
+    virtual bool OnKey(const JSONStringView& name)
+    {
+        PendingName = pDoc->keepString(name);
+        return PendingName.pData != 0;
+    }
+    virtual bool OnBeginObject()
+    {
+        push(JSON_Object);
+        Starts.PushBack(Pending.GetSize());
+        return true;
+    }
+    virtual bool OnEndObject()                  { return endContainer(); }
+    virtual bool OnBeginArray()
+    {
+        push(JSON_Array);
+        Starts.PushBack(Pending.GetSize());
+        return true;
+    }
+    virtual bool OnEndArray()                   { return endContainer(); }
+
+    // Moves the finished root into the arena.
+    const Node* Finish()
+    {
+        OVR_ASSERT(Pending.GetSize() == 1 && Starts.IsEmpty());
+        Node* root = (Node*)pDoc->Arena.Alloc(sizeof(Node));
+        if (root)
+            *root = Pending[0];
+        return root;
+    }
+
+private:
+    Node* push(JSONItemType type)
+    {
+        Node node;
+        node.Type      = type;
+        node.Name      = PendingName;
+        node.dValue    = 0.0;
+        node.pItems    = 0;
+        node.ItemCount = 0;
+        PendingName    = JSONStringView();
+
+        Pending.PushBack(node);
+        return &Pending.Back();
+    }
+
+    bool endContainer()
+    {
+        UPInt start = Starts.Pop();
+        UPInt count = Pending.GetSize() - start;
+        Node* items = 0;
+        if (count)
+        {
+            items = (Node*)pDoc->Arena.Alloc(count * sizeof(Node));
+            if (!items)
+                return false;
+            memcpy(items, &Pending[start], count * sizeof(Node));
+        }
+
+        Node& container     = Pending[start - 1];
+        container.pItems    = items;
+        container.ItemCount = count;
+        Pending.Resize(start);
+        return true;
+    }
+
+    JSONDocument*   pDoc;
+    ArrayPOD<Node>  Pending;
+    // Index in Pending of the first item of each open container.
+    ArrayPOD<UPInt> Starts;
+    JSONStringView  PendingName;
+};
+
+
+JSONDocument::JSONDocument(UPInt arenaBlockSize)
+    : Arena(arenaBlockSize), pSource(0), SourceSize(0), pRoot(0)
+{
+}
+
+JSONDocument::~JSONDocument()
+{
+    Clear();
+}
+
+void JSONDocument::Clear()
+{
+    pRoot      = 0;
+    pSource    = 0;
+    SourceSize = 0;
+    Arena.ReleaseBlocks();
+    File.Close();
+}
+
+bool JSONDocument::Parse(const char* buff, UPInt len, const char** perror)
+{
+    Clear();
+    return parse(buff, len, perror);
+}
+
+bool JSONDocument::Load(const char* path, const char** perror)
+{
+    Clear();
+    if (!File.Open(path))
+    {
+        if (perror)
+            *perror = "Failed to open file";
+        return false;
+    }
+
+    if (parse((const char*)File.GetData(), (UPInt)File.GetLength(), perror))
+        return true;
+    Clear();
+    return false;
+}
+
+bool JSONDocument::parse(const char* buff, UPInt len, const char** perror)
+{
+    pSource    = buff;
+    SourceSize = len;
+
+    Builder builder(this);
+    if (JSONReader::Parse(buff, len, &builder, perror))
+        pRoot = builder.Finish();
+
+    if (!pRoot)
+    {
+        if (perror && !*perror)
+            *perror = "Error: Failed to allocate memory";
+        Arena.ReleaseBlocks();
+        return false;
+    }
+    return true;
+}
+
+JSONStringView JSONDocument::keepString(const JSONStringView& str)
+{
+    if (!str.Size)
+        return JSONStringView("", 0);
+    if (str.pData >= pSource && str.pData + str.Size <= pSource + SourceSize)
+        return str;
+
+    char* copy = (char*)Arena.Alloc(str.Size);
+    if (!copy)
+        return JSONStringView();
+    memcpy(copy, str.pData, str.Size);
+    return JSONStringView(copy, str.Size);
+}
+
+
+const JSONDocument::Node* JSONDocument::Node::GetItemByName(const char* name) const
+{
+    for (UPInt i = 0; i < ItemCount; i++)
+    {
+        if (pItems[i].Name == name)
+            return &pItems[i];
+    }
+    return 0;
+}
+
+double JSONDocument::Node::GetNumberByName(const char* name, double defValue) const
+{
+    const Node* item = GetItemByName(name);
+    return (item && item->Type == JSON_Number) ? item->dValue : defValue;
+}
+
+bool JSONDocument::Node::GetBoolByName(const char* name, bool defValue) const
+{
+    const Node* item = GetItemByName(name);
+    return (item && item->Type == JSON_Bool) ? (item->dValue != 0) : defValue;
+}
+
+String JSONDocument::Node::GetStringByName(const char* name, const String& defValue) const
+{
+    const Node* item = GetItemByName(name);
+    return (item && item->Type == JSON_String) ? item->Value.ToString() : defValue;
+}
+
+
+#ifdef OVR_JSON_BENCHMARK
+
+//-----------------------------------------------------------------------------
+// ***** JSON Parse Benchmark
+
+// Collects the text of every number in a document.
+class JSONNumberCollector : public JSONHandler
+{
+public:
+    Array<String> Numbers;
+
+    virtual bool OnNumber(double value, const JSONStringView& text)
+    {
+        OVR_UNUSED(value);
+        Numbers.PushBack(text.ToString());
+        return true;
+    }
+};
+
+void RunJSONParseBenchmark(const char* path, int iterations)
+{
+    MappedFile file;
+    if (!file.Open(path) || file.GetLength() <= 0 || iterations <= 0)
+    {
+        LogText("JSONBenchmark: can't read '%s'\n", path);
+        return;
+    }
+
+    const char* data = (const char*)file.GetData();
+    UPInt       size = (UPInt)file.GetLength();
+    double      mb   = size / (1024.0 * 1024.0);
+    // JSON::Parse needs null-terminated text.
+    String      text(data, size);
+
+    double start = Timer::GetSeconds();
+    for (int i = 0; i < iterations; i++)
+    {
+        JSON* json = JSON::Parse(text.ToCStr());
+        if (json)
+            json->Release();
+    }
+    double treeTime = (Timer::GetSeconds() - start) / iterations;
+
+    JSONDocument document;
+    start = Timer::GetSeconds();
+    for (int i = 0; i < iterations; i++)
+        document.Parse(data, size);
+    double documentTime = (Timer::GetSeconds() - start) / iterations;
+
+    JSONHandler nullHandler;
+    start = Timer::GetSeconds();
+    for (int i = 0; i < iterations; i++)
+        JSONReader::Parse(data, size, &nullHandler);
+    double readerTime = (Timer::GetSeconds() - start) / iterations;
+
+    LogText("JSONBenchmark: '%s', %u bytes, %d iterations\n", path, (unsigned)size, iterations);
+    LogText("  JSON::Parse          %10.1f us  %8.1f MB/s\n", treeTime * 1e6, mb / treeTime);
+    LogText("  JSONDocument::Parse  %10.1f us  %8.1f MB/s\n", documentTime * 1e6, mb / documentTime);
+    LogText("  JSONReader::Parse    %10.1f us  %8.1f MB/s\n", readerTime * 1e6, mb / readerTime);
+
+    // Numbers alone, through JSON::ParseNumber and through OVR_strtod.
+    JSONNumberCollector collector;
+    JSONReader::Parse(data, size, &collector);
+    UPInt count = collector.Numbers.GetSize();
+    if (count == 0)
+        return;
+
+    double sum = 0;
+    start = Timer::GetSeconds();
+    for (int i = 0; i < iterations; i++)
+    {
+        for (UPInt j = 0; j < count; j++)
+        {
+            double value = 0;
+            JSON::ParseNumber(collector.Numbers[j].ToCStr(), 0, &value);
+            sum += value;
+        }
+    }
+    double parseTime = (Timer::GetSeconds() - start) / (iterations * (double)count);
+
+    start = Timer::GetSeconds();
+    for (int i = 0; i < iterations; i++)
+    {
+        for (UPInt j = 0; j < count; j++)
+            sum += OVR_strtod(collector.Numbers[j].ToCStr(), 0);
+    }
+    double strtodTime = (Timer::GetSeconds() - start) / (iterations * (double)count);
+
+    // Both are correctly rounded, so any difference is a bug.
+    int differ = 0;
+    for (UPInt j = 0; j < count; j++)
+    {
+        double value = 0;
+        JSON::ParseNumber(collector.Numbers[j].ToCStr(), 0, &value);
+        if (value != OVR_strtod(collector.Numbers[j].ToCStr(), 0))
+            differ++;
+    }
+
+    LogText("  %u numbers: ParseNumber %.1f ns, OVR_strtod %.1f ns, %d differ (%g)\n",
+            (unsigned)count, parseTime * 1e9, strtodTime * 1e9, differ, sum);
+}
+
+#endif // OVR_JSON_BENCHMARK
+
+} // namespace OVR
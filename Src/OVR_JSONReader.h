@@ -0,0 +1,185 @@
+/************************************************************************************
+
+PublicHeader:   None
+Filename    :   OVR_JSONReader.h
+Content     :   Streaming JSON reader and arena-allocated JSON document
+Created     :   October 14, 2026
+Notes       :
+
+Copyright   :   Copyright 2014 Oculus VR, Inc. All Rights reserved.
+
+Licensed under the Oculus VR Rift SDK License Version 3.1 (the "License");
+you may not use the Oculus VR Rift SDK except in compliance with the License,
+which is provided at the time of installation or download, or which
+otherwise accompanies this software in either electronic or hard copy form.
+
+You may obtain a copy of the License at
+
+http://www.oculusvr.com/licenses/LICENSE-3.1
+
+Unless required by applicable law or agreed to in writing, the Oculus VR SDK
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+************************************************************************************/
+
+#ifndef OVR_JSONReader_h
+#define OVR_JSONReader_h
+
+#include "OVR_JSON.h"
+#include "Kernel/OVR_Allocator.h"
+#include "Kernel/OVR_Array.h"
+#include "Kernel/OVR_MappedFile.h"
+
+namespace OVR {
+
+//-----------------------------------------------------------------------------
+// ***** JSONStringView
+
+// Characters of a JSON string or number, not null-terminated.
+struct JSONStringView
+{
+    const char* pData;
+    UPInt       Size;
+
+    JSONStringView() : pData(0), Size(0) { }
+    JSONStringView(const char* data, UPInt size) : pData(data), Size(size) { }
+
+    bool        operator == (const char* str) const;
+    bool        operator != (const char* str) const { return !operator == (str); }
+
+    String      ToString() const { return String(pData, Size); }
+};
+
+
+//-----------------------------------------------------------------------------
+// ***** JSONHandler
+
+// Receives the contents of a JSON text from JSONReader::Parse, in order. Object
+// members are reported as OnKey followed by their value. Any callback can return
+// false to stop parsing, which then fails.
+//
+// The views passed in point into the parsed buffer unless the text had escape
+// sequences to decode; those are only valid until the callback returns.
+
+class JSONHandler
+{
+public:
+    virtual ~JSONHandler() { }
+
+    virtual bool    OnNull()                                            { return true; }
+    virtual bool    OnBool(bool value)                                  { OVR_UNUSED(value); return true; }
+    // text is the number as written.
+    virtual bool    OnNumber(double value, const JSONStringView& text)  { OVR_UNUSED2(value, text); return true; }
+    virtual bool    OnString(const JSONStringView& value)               { OVR_UNUSED(value); return true; }
+    virtual bool    OnKey(const JSONStringView& name)                   { OVR_UNUSED(name); return true; }
+    virtual bool    OnBeginObject()                                     { return true; }
+    virtual bool    OnEndObject()                                       { return true; }
+    virtual bool    OnBeginArray()                                      { return true; }
+    virtual bool    OnEndArray()                                        { return true; }
+};
+
+
+//-----------------------------------------------------------------------------
+// ***** JSONReader
+
+// Parses JSON text without building a tree, passing its contents to a handler.
+// The text is read in place and needs no null terminator; nothing is allocated
+// unless strings contain escape sequences.
+
+class JSONReader
+{
+public:
+    // Containers nested deeper than this fail to parse.
+    enum { MaxDepth = 256 };
+
+    // Parses len bytes of buff. Returns false and fills in *perror on a parse error,
+    // or when the handler stops the parse.
+    static bool     Parse(const char* buff, UPInt len, JSONHandler* handler,
+                          const char** perror = 0);
+};
+
+
+//-----------------------------------------------------------------------------
+// ***** JSONDocument
+
+// Read-only JSON tree for large documents, such as profile databases and
+// calibration dumps. All nodes live in an arena owned by the document, the
+// children of each array or object are stored next to each other, and strings
+// are views into the parsed buffer where they need no decoding. The whole tree
+// is freed at once when the document is cleared or destroyed.
+//
+// Text given to Parse must stay valid and unchanged while the document is used;
+// Load keeps the file mapped for as long.
+
+class JSONDocument
+{
+public:
+    struct Node
+    {
+        JSONItemType    Type;
+        // Member name in a parent object.
+        JSONStringView  Name;
+        // String value, or the text of a number.
+        JSONStringView  Value;
+        // Number value; 1 or 0 for a bool.
+        double          dValue;
+        // Items of an array or object.
+        const Node*     pItems;
+        UPInt           ItemCount;
+
+        const Node*     GetItem(UPInt i) const      { return (i < ItemCount) ? &pItems[i] : 0; }
+        const Node*     GetItemByName(const char* name) const;
+
+        double          GetNumberByName(const char* name, double defValue = 0.0) const;
+        bool            GetBoolByName(const char* name, bool defValue = false) const;
+        String          GetStringByName(const char* name, const String& defValue = "") const;
+    };
+
+    JSONDocument(UPInt arenaBlockSize = LinearAllocator::DefaultBlockSize);
+    ~JSONDocument();
+
+    // Parses len bytes of buff, replacing any earlier tree. Returns false and fills
+    // in *perror on failure.
+    bool            Parse(const char* buff, UPInt len, const char** perror = 0);
+    // Maps and parses a file.
+    bool            Load(const char* path, const char** perror = 0);
+
+    // Frees all nodes.
+    void            Clear();
+
+    // Null unless a parse succeeded.
+    const Node*     GetRoot() const             { return pRoot; }
+
+private:
+    class Builder;
+
+    bool            parse(const char* buff, UPInt len, const char** perror);
+    // Returns a view that stays valid with the document, copying the string into
+    // the arena unless it's in the parsed text.
+    JSONStringView  keepString(const JSONStringView& str);
+
+    LinearAllocator Arena;
+    MappedFile      File;
+    const char*     pSource;
+    UPInt           SourceSize;
+    const Node*     pRoot;
+};
+
+
+// Define this to compile-in the JSON parse benchmark.
+//#define OVR_JSON_BENCHMARK
+
+#ifdef OVR_JSON_BENCHMARK
+// Parses the JSON file at path, such as a Profiles.json or ProfileDB.json, with
+// JSON::Parse, JSONDocument and JSONReader, then converts its numbers alone, logging
+// the time per parse and per number. Numbers that convert differently from
+// OVR_strtod are counted.
+void RunJSONParseBenchmark(const char* path, int iterations = 100);
+#endif
+
+} // namespace OVR
+
+#endif // OVR_JSONReader_h
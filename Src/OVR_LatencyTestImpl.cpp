@@ -507,9 +507,10 @@ void LatencyTestDeviceImpl::Shutdown()
     LogText("OVR::LatencyTestDevice - Closed '%s'\n", getHIDDesc()->Path.ToCStr());
 }
 
-void LatencyTestDeviceImpl::OnInputReport(UByte* pData, UInt32 length)
+void LatencyTestDeviceImpl::OnInputReport(UByte* pData, UInt32 length, double receiveTime)
 {
-    
+    OVR_UNUSED(receiveTime);
+
     bool processed = false;
     if (!processed)
     {
@@ -555,9 +556,9 @@ void LatencyTestDeviceImpl::OnInputReport(UByte* pData, UInt32 length)
 bool LatencyTestDeviceImpl::SetConfiguration(const OVR::LatencyTestConfiguration& configuration, bool waitFlag)
 {  
     bool                result = false;
-    ThreadCommandQueue* queue = GetManagerImpl()->GetThreadQueue();
+    ThreadCommandQueue* queue = GetDeviceQueue();
 
-    if (GetManagerImpl()->GetThreadId() != OVR::GetCurrentThreadId())
+    if (GetDeviceThreadId() != OVR::GetCurrentThreadId())
     {
         if (!waitFlag)
         {
@@ -588,7 +589,7 @@ bool LatencyTestDeviceImpl::GetConfiguration(OVR::LatencyTestConfiguration* conf
 {  
     bool result = false;
 
-	ThreadCommandQueue* pQueue = this->GetManagerImpl()->GetThreadQueue();
+	ThreadCommandQueue* pQueue = this->GetDeviceQueue();
     if (!pQueue->PushCallAndWaitResult(this, &LatencyTestDeviceImpl::getConfiguration, &result, configuration))
         return false;
 
@@ -611,7 +612,7 @@ bool LatencyTestDeviceImpl::getConfiguration(OVR::LatencyTestConfiguration* conf
 bool LatencyTestDeviceImpl::SetCalibrate(const Color& calibrationColor, bool waitFlag)
 {
     bool                result = false;
-    ThreadCommandQueue* queue = GetManagerImpl()->GetThreadQueue();
+    ThreadCommandQueue* queue = GetDeviceQueue();
 
     if (!waitFlag)
     {
@@ -638,7 +639,7 @@ bool LatencyTestDeviceImpl::setCalibrate(const Color& calibrationColor)
 bool LatencyTestDeviceImpl::SetStartTest(const Color& targetColor, bool waitFlag)
 {
     bool                result = false;
-    ThreadCommandQueue* queue = GetManagerImpl()->GetThreadQueue();
+    ThreadCommandQueue* queue = GetDeviceQueue();
 
     if (!waitFlag)
     {
@@ -665,7 +666,7 @@ bool LatencyTestDeviceImpl::setStartTest(const Color& targetColor)
 bool LatencyTestDeviceImpl::SetDisplay(const OVR::LatencyTestDisplay& display, bool waitFlag)
 {
     bool                 result = false;
-    ThreadCommandQueue * queue = GetManagerImpl()->GetThreadQueue();
+    ThreadCommandQueue * queue = GetDeviceQueue();
 
     if (!waitFlag)
     {
@@ -697,10 +698,7 @@ void LatencyTestDeviceImpl::onLatencyTestSamplesMessage(LatencyTestSamplesMessag
 
     LatencyTestSamples& s = message->Samples;
 
-    // Call OnMessage() within a lock to avoid conflicts with handlers.
-    Lock::Locker scopeLock(HandlerRef.GetLock());
-  
-    if (HandlerRef.HasHandlers())
+    if (HandlerRef.HasHandlers(Message_LatencyTestSamples))
     {
         MessageLatencyTestSamples samples(this);
         for (UByte i = 0; i < s.SampleCount; i++)
@@ -719,10 +717,7 @@ void LatencyTestDeviceImpl::onLatencyTestColorDetectedMessage(LatencyTestColorDe
 
     LatencyTestColorDetected& s = message->ColorDetected;
 
-    // Call OnMessage() within a lock to avoid conflicts with handlers.
-    Lock::Locker scopeLock(HandlerRef.GetLock());
-
-    if (HandlerRef.HasHandlers())
+    if (HandlerRef.HasHandlers(Message_LatencyTestColorDetected))
     {
         MessageLatencyTestColorDetected detected(this);
         detected.Elapsed = s.Elapsed;
@@ -740,10 +735,7 @@ void LatencyTestDeviceImpl::onLatencyTestStartedMessage(LatencyTestStartedMessag
 
     LatencyTestStarted& ts = message->TestStarted;
 
-    // Call OnMessage() within a lock to avoid conflicts with handlers.
-    Lock::Locker scopeLock(HandlerRef.GetLock());
-
-    if (HandlerRef.HasHandlers())
+    if (HandlerRef.HasHandlers(Message_LatencyTestStarted))
     {
         MessageLatencyTestStarted started(this);
         started.TargetValue = Color(ts.TargetValue[0], ts.TargetValue[1], ts.TargetValue[2]);
@@ -759,10 +751,7 @@ void LatencyTestDeviceImpl::onLatencyTestButtonMessage(LatencyTestButtonMessage*
 
 //  LatencyTestButton& s = message->Button;
 
-    // Call OnMessage() within a lock to avoid conflicts with handlers.
-    Lock::Locker scopeLock(HandlerRef.GetLock());
-
-    if (HandlerRef.HasHandlers())
+    if (HandlerRef.HasHandlers(Message_LatencyTestButton))
     {
         MessageLatencyTestButton button(this);
 
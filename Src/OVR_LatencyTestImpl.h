@@ -106,7 +106,7 @@ public:
     virtual void Shutdown();
 
     // DeviceManagerThread::Notifier interface.
-    virtual void OnInputReport(UByte* pData, UInt32 length);
+    virtual void OnInputReport(UByte* pData, UInt32 length, double receiveTime);
 
     // LatencyTesterDevice interface
     virtual bool SetConfiguration(const OVR::LatencyTestConfiguration& configuration, bool waitFlag = false);
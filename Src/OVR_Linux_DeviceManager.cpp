@@ -30,11 +30,18 @@ limitations under the License.
 #include "OVR_LatencyTestImpl.h"
 #include "OVR_SensorImpl.h"
 #include "OVR_Linux_HIDDevice.h"
+#include "OVR_Linux_LibUSBHIDDevice.h"
 #include "OVR_Linux_HMDDevice.h"
+#include "OVR_Linux_ProfileWatcher.h"
 
 #include "Kernel/OVR_Timer.h"
 #include "Kernel/OVR_Std.h"
 #include "Kernel/OVR_Log.h"
+#include "Kernel/OVR_ProfilingAllocator.h"
+#include "Kernel/OVR_Trace.h"
+
+#include <math.h>
+#include <stdlib.h>
 
 namespace OVR { namespace Linux {
 
@@ -43,6 +50,8 @@ namespace OVR { namespace Linux {
 // **** Linux::DeviceManager
 
 DeviceManager::DeviceManager()
+    : Sharding(Sharding_None), HasScheduling(false), pProfileWatcher(0),
+      pHidrawManager(0)
 {
 }
 
@@ -50,12 +59,21 @@ DeviceManager::~DeviceManager()
 {    
 }
 
-bool DeviceManager::Initialize(DeviceBase*)
+bool DeviceManager::Initialize(DeviceBase* parent)
+{
+    return Initialize(parent, 0);
+}
+
+bool DeviceManager::Initialize(DeviceBase*, const Thread::SchedulingParams* threadScheduling)
 {
     if (!DeviceManagerImpl::Initialize(0))
         return false;
 
-    pThread = *new DeviceManagerThread();
+    HasScheduling = (threadScheduling != 0);
+    if (threadScheduling)
+        Scheduling = *threadScheduling;
+
+    pThread = *new DeviceManagerThread(threadScheduling);
     if (!pThread || !pThread->Start())
         return false;
 
@@ -63,8 +81,30 @@ bool DeviceManager::Initialize(DeviceBase*)
     pThread->StartupEvent.Wait();
 
     // Do this now that we know the thread's run loop.
-    HidDeviceManager = *HIDDeviceManager::CreateInternal(this);
+#ifdef OVR_USE_LIBUSB
+    // Prefer libusb transfers, falling back to hidraw if libusb can't be used.
+    const char* transport = getenv("OVR_HID_TRANSPORT");
+    if (!transport || OVR_strcmp(transport, "hidraw") != 0)
+        HidDeviceManager = *LibUSBHIDDeviceManager::CreateInternal(this);
+    if (!HidDeviceManager)
+#endif
+    {
+        HidDeviceManager = *HIDDeviceManager::CreateInternal(this);
+        pHidrawManager   = static_cast<HIDDeviceManager*>(HidDeviceManager.GetPtr());
+
+        // hidraw devices each have a descriptor of their own, so their threads
+        // can be split up; libusb devices are serviced through one context.
+        const char* threads = getenv("OVR_DEVICE_THREADS");
+        if (threads && OVR_strcmp(threads, "bus") == 0)
+            Sharding = Sharding_Bus;
+        else if (threads && OVR_strcmp(threads, "device") == 0)
+            Sharding = Sharding_Device;
+    }
          
+    // Pick up profile changes made by other processes as they happen.
+    pProfileWatcher = new ProfileWatcher(this);
+    pThread->PushCall(pProfileWatcher, &ProfileWatcher::Start);
+
     pCreateDesc->pDevice = this;
     LogText("OVR::DeviceManager - initialized.\n");
     return true;
@@ -87,6 +127,34 @@ void DeviceManager::Shutdown()
     //    after pManager is null.
     //  - Once ExitCommand executes, ThreadCommand::Run loop will exit and release the last
     //    reference to the thread object.
+    // Devices have all been released by now, so their threads are idle.
+    {
+        Lock::Locker lock(&DeviceThreadsLock);
+        for (UPInt i = 0; i < DeviceThreads.GetSize(); i++)
+        {
+            // Threads are shared by the devices with the same key.
+            bool exited = (DeviceThreads[i].pThread == pThread);
+            for (UPInt j = 0; j < i && !exited; j++)
+                exited = (DeviceThreads[j].pThread == DeviceThreads[i].pThread);
+            if (!exited)
+                DeviceThreads[i].pThread->PushExitCommand(false);
+        }
+        DeviceThreads.Clear();
+    }
+
+    if (pProfileWatcher)
+    {
+        // Its descriptor must be off the loop before the watcher goes away.
+        if (!pThread->PushCall(pProfileWatcher, &ProfileWatcher::Stop, true))
+            pProfileWatcher->Stop();
+        delete pProfileWatcher;
+        pProfileWatcher = 0;
+    }
+
+    // The hotplug thread queues calls to the manager thread.
+    if (pHidrawManager)
+        pHidrawManager->StopHotplugMonitor();
+
     pThread->PushExitCommand(false);
     pThread.Clear();
 
@@ -103,6 +171,71 @@ ThreadId DeviceManager::GetThreadId() const
     return pThread->GetThreadId();
 }
 
+ThreadCommandQueue* DeviceManager::GetThreadQueueFor(const DeviceCreateDesc* desc, ThreadId* threadId)
+{
+    const HIDDeviceDesc* hidDesc = desc->GetHIDDeviceDesc();
+    DeviceManagerThread* thread  = hidDesc ? GetDeviceThread(hidDesc->Path) : pThread.GetPtr();
+
+    *threadId = thread->GetThreadId();
+    return thread;
+}
+
+DeviceManagerThread* DeviceManager::GetDeviceThread(const String& path)
+{
+    if (Sharding == Sharding_None)
+        return pThread;
+
+    // Called on the manager thread, and on device threads while they open a device.
+    Lock::Locker lock(&DeviceThreadsLock);
+
+    for (UPInt i = 0; i < DeviceThreads.GetSize(); i++)
+    {
+        if (DeviceThreads[i].Path == path)
+            return DeviceThreads[i].pThread;
+    }
+
+    DeviceThreadEntry entry;
+    entry.Path = path;
+    entry.Key  = path;
+    if (Sharding == Sharding_Bus)
+    {
+        // Devices on a bus share its bandwidth and usually its controller.
+        HIDDeviceManager* hidManager = static_cast<HIDDeviceManager*>(HidDeviceManager.GetPtr());
+        String bus;
+        if (hidManager->GetUSBBus(path.ToCStr(), &bus))
+            entry.Key = String("bus:") + bus;
+    }
+
+    // Other devices with the same key may have a thread already.
+    for (UPInt i = 0; i < DeviceThreads.GetSize(); i++)
+    {
+        if (DeviceThreads[i].Key == entry.Key)
+        {
+            entry.pThread = DeviceThreads[i].pThread;
+            break;
+        }
+    }
+
+    if (!entry.pThread)
+    {
+        entry.pThread = *new DeviceManagerThread(HasScheduling ? &Scheduling : 0);
+        if (entry.pThread->Start())
+        {
+            entry.pThread->StartupEvent.Wait();
+            LogText("OVR::DeviceManager - started a device thread for '%s'.\n", entry.Key.ToCStr());
+        }
+        else
+        {
+            // Remembered, so that the device is always given the same thread.
+            LogError("OVR::DeviceManager - can't start a thread for '%s'.\n", entry.Key.ToCStr());
+            entry.pThread = pThread;
+        }
+    }
+
+    DeviceThreads.PushBack(entry);
+    return entry.pThread;
+}
+
 bool DeviceManager::GetDeviceInfo(DeviceInfo* info) const
 {
     if ((info->InfoClassType != Device_Manager) &&
@@ -129,54 +262,27 @@ DeviceEnumerator<> DeviceManager::EnumerateDevicesEx(const DeviceEnumerationArgs
 //-------------------------------------------------------------------------------------
 // ***** DeviceManager Thread 
 
-DeviceManagerThread::DeviceManagerThread()
-    : Thread(ThreadStackSize)
+DeviceManagerThread::DeviceManagerThread(const Thread::SchedulingParams* scheduling)
+    : Thread(ThreadStackSize), HasScheduling(scheduling != 0)
 {
-    int result = pipe(CommandFd);
-    OVR_ASSERT(!result);
-    OVR_UNUSED(result);
+    if (scheduling)
+        Scheduling = *scheduling;
 
-    AddSelectFd(NULL, CommandFd[0]);
+    OVR_ASSERT(Loop.IsValid());
 }
 
 DeviceManagerThread::~DeviceManagerThread()
 {
-    if (CommandFd[0])
-    {
-        RemoveSelectFd(NULL, CommandFd[0]);
-        close(CommandFd[0]);
-        close(CommandFd[1]);
-    }
 }
 
-bool DeviceManagerThread::AddSelectFd(Notifier* notify, int fd)
+bool DeviceManagerThread::AddSelectFd(Notifier* notify, int fd, int events)
 {
-    struct pollfd pfd;
-    pfd.fd = fd;
-    pfd.events = POLLIN|POLLHUP|POLLERR;
-    pfd.revents = 0;
-
-    FdNotifiers.PushBack(notify);
-    PollFds.PushBack(pfd);
-
-    OVR_ASSERT(FdNotifiers.GetSize() == PollFds.GetSize());
-    return true;
+    return Loop.AddFd(notify, fd, events);
 }
 
 bool DeviceManagerThread::RemoveSelectFd(Notifier* notify, int fd)
 {
-    // [0] is reserved for thread commands with notify of null, but we still
-    // can use this function to remove it.
-    for (UPInt i = 0; i < FdNotifiers.GetSize(); i++)
-    {
-        if ((FdNotifiers[i] == notify) && (PollFds[i].fd == fd))
-        {
-            FdNotifiers.RemoveAt(i);
-            PollFds.RemoveAt(i);
-            return true;
-        }
-    }
-    return false;
+    return Loop.RemoveFd(notify, fd);
 }
 
 
@@ -186,7 +292,12 @@ int DeviceManagerThread::Run()
     ThreadCommand::PopBuffer command;
 
     SetThreadName("OVR::DeviceManagerThread");
+    OVR_TRACE_THREAD_NAME("OVR::DeviceManagerThread");
+    ProfilingAllocator::SetThreadRole(ProfilingAllocator::ThreadRole_Device);
     LogText("OVR::DeviceManagerThread - running (ThreadId=%p).\n", GetThreadId());
+
+    if (HasScheduling && !SetCurrentThreadScheduling(Scheduling))
+        LogText("OVR::DeviceManagerThread - requested scheduling only partly applied.\n");
     
     // Signal to the parent thread that initialization has finished.
     StartupEvent.SetEvent();
@@ -196,94 +307,115 @@ int DeviceManagerThread::Run()
         // PopCommand will reset event on empty queue.
         if (PopCommand(&command))
         {
+            OVR_TRACE_SCOPE("DeviceManagerThread::Command");
             command.Execute();
         }
         else
         {
-            bool commands = 0;
+            bool commands = false;
             do
             {
-                int waitMs = -1;
-
-                // If devices have time-dependent logic registered, get the longest wait
-                // allowed based on current ticks.
-                if (!TicksNotifiers.IsEmpty())
-                {
-                    double   timeSeconds = Timer::GetSeconds();
-                    unsigned waitAllowed;
-
-                    for (UPInt j = 0; j < TicksNotifiers.GetSize(); j++)
-                    {
-                        waitAllowed = (unsigned)(TicksNotifiers[j]->OnTicks(timeSeconds) * Timer::MsPerSecond);
-                        if (waitAllowed < (unsigned)waitMs)
-                            waitMs = waitAllowed;
-                    }                
-                }
-
-                // wait until there is data available on one of the devices or the timeout expires
-                int n = poll(&PollFds[0], PollFds.GetSize(), waitMs);
-
-                if (n > 0)
-                {
-                    // Iterate backwards through the list so the ordering will not be
-                    // affected if the called object gets removed during the callback
-                    // Also, the HID data streams are located toward the back of the list
-                    // and servicing them first will allow a disconnect to be handled
-                    // and cleaned directly at the device first instead of the general HID monitor
-                    for (int i=PollFds.GetSize()-1; i>=0; i--)
-                    {
-                        if (PollFds[i].revents & POLLERR)
-                        {
-                            OVR_DEBUG_LOG(("poll: error on [%d]: %d", i, PollFds[i].fd));
-                        }
-                        else if (PollFds[i].revents & POLLIN)
-                        {
-                            if (FdNotifiers[i])
-                                FdNotifiers[i]->OnEvent(i, PollFds[i].fd);
-                            else if (i == 0) // command
-                            {
-                                char dummy[128];
-                                read(PollFds[i].fd, dummy, 128);
-                                commands = 1;
-                            }
-                        }
-
-                        if (PollFds[i].revents & POLLHUP)
-                            PollFds[i].events = 0;
-
-                        if (PollFds[i].revents != 0)
-                        {
-                            n--;
-                            if (n == 0)
-                                break;
-                        }
-                    }
-                }
-            } while (PollFds.GetSize() > 0 && !commands);
+                // If devices have time-dependent logic registered, call those that
+                // are due and wait no longer than the next deadline.
+                int waitMs = serviceTicksNotifiers();
+
+                // Wait until there is data available on one of the devices, the timeout
+                // expires or a command is pushed; ready devices are serviced inside.
+                commands = Loop.Wait(waitMs);
+            } while (!commands);
         }
     }
 
-    LogText("OVR::DeviceManagerThread - exiting (ThreadId=%p).\n", GetThreadId());
+    LogText("OVR::DeviceManagerThread - exiting (ThreadId=%p, at most %d commands queued).\n",
+            GetThreadId(), (int)GetHighWaterMark());
     return 0;
 }
 
 bool DeviceManagerThread::AddTicksNotifier(Notifier* notify)
 {
-     TicksNotifiers.PushBack(notify);
-     return true;
+    // Due immediately; it goes to the end of the heap and sifts up.
+    TicksEntry entry;
+    entry.Deadline  = 0.0;
+    entry.pNotifier = notify;
+    TicksHeap.PushBack(entry);
+    return setTicksDeadline(notify, 0.0);
 }
 
 bool DeviceManagerThread::RemoveTicksNotifier(Notifier* notify)
 {
-    for (UPInt i = 0; i < TicksNotifiers.GetSize(); i++)
+    // Move it to the top, then replace it with the last entry.
+    if (!setTicksDeadline(notify, -1.0))
+        return false;
+
+    TicksHeap[0] = TicksHeap.Back();
+    TicksHeap.PopBack();
+    if (!TicksHeap.IsEmpty())
+        setTicksDeadline(TicksHeap[0].pNotifier, TicksHeap[0].Deadline);
+    return true;
+}
+
+bool DeviceManagerThread::ResetTicksNotifier(Notifier* notify)
+{
+    return setTicksDeadline(notify, 0.0);
+}
+
+bool DeviceManagerThread::setTicksDeadline(Notifier* notify, double deadline)
+{
+    // There are only a few notifiers, so finding one by pointer is fine.
+    UPInt i = 0;
+    while (i < TicksHeap.GetSize() && TicksHeap[i].pNotifier != notify)
+        i++;
+    if (i == TicksHeap.GetSize())
+        return false;
+
+    TicksEntry entry = TicksHeap[i];
+    entry.Deadline   = deadline;
+
+    // Sift up, then down.
+    while (i > 0 && TicksHeap[(i - 1) / 2].Deadline > deadline)
     {
-        if (TicksNotifiers[i] == notify)
-        {
-            TicksNotifiers.RemoveAt(i);
-            return true;
-        }
+        TicksHeap[i] = TicksHeap[(i - 1) / 2];
+        i = (i - 1) / 2;
     }
-    return false;
+    for (;;)
+    {
+        UPInt child = 2 * i + 1;
+        if (child >= TicksHeap.GetSize())
+            break;
+        if (child + 1 < TicksHeap.GetSize() && TicksHeap[child + 1].Deadline < TicksHeap[child].Deadline)
+            child++;
+        if (TicksHeap[child].Deadline >= deadline)
+            break;
+        TicksHeap[i] = TicksHeap[child];
+        i = child;
+    }
+    TicksHeap[i] = entry;
+    return true;
+}
+
+int DeviceManagerThread::serviceTicksNotifiers()
+{
+    if (TicksHeap.IsEmpty())
+        return -1;
+
+    // A notifier stays in the heap while it is called, so that it may remove
+    // itself; otherwise it moves to its new deadline. Waits are at least 1 ms
+    // so that the loop always ends.
+    double timeSeconds = Timer::GetSeconds();
+    while (!TicksHeap.IsEmpty() && TicksHeap[0].Deadline <= timeSeconds)
+    {
+        Notifier* notify = TicksHeap[0].pNotifier;
+        OVR_TRACE_SCOPE("DeviceManagerThread::OnTicks");
+        double    wait   = notify->OnTicks(timeSeconds);
+        setTicksDeadline(notify, timeSeconds + Alg::Max(wait, 0.001));
+    }
+
+    if (TicksHeap.IsEmpty())
+        return -1;
+
+    // Round up, so as not to wake just before the deadline.
+    double waitMs = ceil((TicksHeap[0].Deadline - timeSeconds) * Timer::MsPerSecond);
+    return (waitMs < 0x7FFFFFFF) ? (int)waitMs : 0x7FFFFFFF;
 }
 
 } // namespace Linux
@@ -294,7 +426,7 @@ bool DeviceManagerThread::RemoveTicksNotifier(Notifier* notify)
 
 
 // Creates a new DeviceManager and initializes OVR.
-DeviceManager* DeviceManager::Create()
+DeviceManager* DeviceManager::Create(const Thread::SchedulingParams* threadScheduling)
 {
     if (!System::IsInitialized())
     {
@@ -308,7 +440,7 @@ DeviceManager* DeviceManager::Create()
 
     if (manager)
     {
-        if (manager->Initialize(0))
+        if (manager->Initialize(0, threadScheduling))
         {            
             manager->AddFactory(&LatencyTestDeviceFactory::GetInstance());
             manager->AddFactory(&SensorDeviceFactory::GetInstance());
@@ -28,14 +28,14 @@ limitations under the License.
 #define OVR_Linux_DeviceManager_h
 
 #include "OVR_DeviceImpl.h"
-
-#include <unistd.h>
-#include <sys/poll.h>
+#include "OVR_Linux_EventLoop.h"
 
 
 namespace OVR { namespace Linux {
 
 class DeviceManagerThread;
+class ProfileWatcher;
+class HIDDeviceManager;
 
 //-------------------------------------------------------------------------------------
 // ***** Linux DeviceManager
@@ -48,16 +48,55 @@ public:
 
     // Initialize/Shutdowncreate and shutdown manger thread.
     virtual bool Initialize(DeviceBase* parent);
+    bool         Initialize(DeviceBase* parent, const Thread::SchedulingParams* threadScheduling);
     virtual void Shutdown();
 
     virtual ThreadCommandQueue* GetThreadQueue();
     virtual ThreadId GetThreadId() const;
+    virtual ThreadCommandQueue* GetThreadQueueFor(const DeviceCreateDesc* desc, ThreadId* threadId);
 
     virtual DeviceEnumerator<> EnumerateDevicesEx(const DeviceEnumerationArgs& args);    
 
     virtual bool  GetDeviceInfo(DeviceInfo* info) const;
 
+    // Returns the thread that services the hidraw device at path. With several
+    // HMDs attached, a single thread can fall behind on their reports; setting the
+    // OVR_DEVICE_THREADS environment variable to "bus" gives the devices on each
+    // USB bus a thread of their own, and "device" gives one to every device.
+    // Otherwise, and for the libusb transport, all devices use pThread.
+    DeviceManagerThread* GetDeviceThread(const String& path);
+
     Ptr<DeviceManagerThread> pThread;
+
+private:
+    enum ThreadSharding
+    {
+        Sharding_None,
+        Sharding_Bus,
+        Sharding_Device
+    };
+
+    // Device threads, created as devices are first opened and kept until shutdown.
+    struct DeviceThreadEntry
+    {
+        String                   Path;
+        String                   Key;
+        Ptr<DeviceManagerThread> pThread;
+    };
+
+    ThreadSharding           Sharding;
+    // Scheduling given to Initialize, applied to the device threads too.
+    bool                     HasScheduling;
+    Thread::SchedulingParams Scheduling;
+
+    Lock                     DeviceThreadsLock;
+    Array<DeviceThreadEntry> DeviceThreads;
+
+    // Runs on pThread.
+    ProfileWatcher*          pProfileWatcher;
+    // HidDeviceManager when it is the hidraw one, whose hotplug monitor is
+    // stopped at shutdown; null with libusb.
+    HIDDeviceManager*        pHidrawManager;
 };
 
 //-------------------------------------------------------------------------------------
@@ -68,22 +107,20 @@ class DeviceManagerThread : public Thread, public ThreadCommandQueue
     friend class DeviceManager;
     enum { ThreadStackSize = 64 * 1024 };
 public:
-    DeviceManagerThread();
+    DeviceManagerThread(const Thread::SchedulingParams* scheduling = 0);
     ~DeviceManagerThread();
 
     virtual int Run();
 
     // ThreadCommandQueue notifications for CommandEvent handling.
-    virtual void OnPushNonEmpty_Locked() { write(CommandFd[1], this, 1); }
-    virtual void OnPopEmpty_Locked()     { }
+    virtual void OnPushNonEmpty() { Loop.Wake(); }
+    virtual void OnPopEmpty()     { }
 
-    class Notifier
+    // OnEvent(i, fd) is called when I/O is received.
+    class Notifier : public EventLoop::FdHandler
     {
     public:
-        // Called when I/O is received
-        virtual void OnEvent(int i, int fd) = 0;
-
-        // Called when timing ticks are updated.
+        // Called when the deadline set by the previous call expires.
         // Returns the largest number of seconds this function can
         // wait till next call.
         virtual double  OnTicks(double tickSeconds)
@@ -94,27 +131,51 @@ public:
     };
 
     // Add I/O notifier
-    bool AddSelectFd(Notifier* notify, int fd);
+    // events is a combination of EventLoop::Event_ flags.
+    bool AddSelectFd(Notifier* notify, int fd, int events = EventLoop::Event_Read);
     bool RemoveSelectFd(Notifier* notify, int fd);
 
-    // Add notifier that will be called at regular intervals.
+    // Time at which the thread last woke up, for Notifier::OnEvent.
+    double GetWakeTime() const { return Loop.GetWakeTime(); }
+
+    // Add notifier that will be called at regular intervals. It is first called
+    // on the next loop iteration, then whenever the wait it returned runs out.
     bool AddTicksNotifier(Notifier* notify);
     bool RemoveTicksNotifier(Notifier* notify);
+    // Calls notify on the next loop iteration instead of at its deadline, for
+    // notifiers whose state has changed since they returned their wait.
+    bool ResetTicksNotifier(Notifier* notify);
 
 private:
-    
-    bool threadInitialized() { return CommandFd[0] != 0; }
 
-    // pipe used to signal commands
-    int CommandFd[2];
+    // Waits on the device descriptors; woken when commands are pushed.
+    EventLoop               Loop;
 
-    Array<struct pollfd>    PollFds;
-    Array<Notifier*>        FdNotifiers;
+    // Only a handful of devices need ticks, so these stay inline and device
+    // enumeration does not hit the heap.
+    enum { InlineTicksCount = 4 };
+
+    struct TicksEntry
+    {
+        double      Deadline;
+        Notifier*   pNotifier;
+    };
+
+    // Calls the notifiers whose deadline has passed; returns the milliseconds
+    // until the next deadline, or -1 if there is none.
+    int  serviceTicksNotifiers();
+    // Moves notify to the new deadline; returns false if it isn't registered.
+    bool setTicksDeadline(Notifier* notify, double deadline);
 
     Event                   StartupEvent;
 
+    // Applied by Run before the thread starts processing commands.
+    bool                    HasScheduling;
+    SchedulingParams        Scheduling;
+
     // Ticks notifiers - used for time-dependent events such as keep-alive.
-    Array<Notifier*>        TicksNotifiers;
+    // Kept as a binary heap ordered by deadline, so only the expired ones are called.
+    ArrayInline<TicksEntry, InlineTicksCount>   TicksHeap;
 };
 
 }} // namespace Linux::OVR
@@ -0,0 +1,292 @@
+/************************************************************************************
+
+Filename    :   OVR_Linux_EventLoop.cpp
+Content     :   File descriptor event loop for the Linux device manager thread
+Created     :   October 14, 2026
+Notes       :
+
+Copyright   :   Copyright 2014 Oculus VR, Inc. All Rights reserved.
+
+Licensed under the Oculus VR Rift SDK License Version 3.1 (the "License"); 
+you may not use the Oculus VR Rift SDK except in compliance with the License, 
+which is provided at the time of installation or download, or which 
+otherwise accompanies this software in either electronic or hard copy form.
+
+You may obtain a copy of the License at
+
+http://www.oculusvr.com/licenses/LICENSE-3.1 
+
+Unless required by applicable law or agreed to in writing, the Oculus VR SDK 
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+*************************************************************************************/
+
+#include "OVR_Linux_EventLoop.h"
+#include "Kernel/OVR_Log.h"
+#include "Kernel/OVR_Timer.h"
+#include "Kernel/OVR_Trace.h"
+
+#include <unistd.h>
+#include <errno.h>
+
+#if defined(__FreeBSD__)
+#define OVR_EVENTLOOP_KQUEUE
+#include <sys/types.h>
+#include <sys/event.h>
+#include <sys/time.h>
+#else
+#define OVR_EVENTLOOP_EPOLL
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#endif
+
+namespace OVR { namespace Linux {
+
+// Ident of the EVFILT_USER event used by Wake.
+#define OVR_EVENTLOOP_WAKE_IDENT 1
+
+EventLoop::EventLoop()
+  : LoopFd(-1), WakeFd(-1), NextSequence(0), WakeTime(0), Dispatching(false)
+{
+#if defined(OVR_EVENTLOOP_EPOLL)
+    LoopFd = epoll_create1(EPOLL_CLOEXEC);
+    WakeFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+
+    // The wake descriptor is the only one registered without a Registration.
+    struct epoll_event ev;
+    ev.events   = EPOLLIN;
+    ev.data.ptr = 0;
+    if (LoopFd >= 0 && (WakeFd < 0 || epoll_ctl(LoopFd, EPOLL_CTL_ADD, WakeFd, &ev) != 0))
+    {
+        close(LoopFd);
+        LoopFd = -1;
+    }
+#else
+    LoopFd = kqueue();
+
+    struct kevent kev;
+    EV_SET(&kev, OVR_EVENTLOOP_WAKE_IDENT, EVFILT_USER, EV_ADD | EV_CLEAR, 0, 0, 0);
+    if (LoopFd >= 0 && kevent(LoopFd, &kev, 1, 0, 0, 0) != 0)
+    {
+        close(LoopFd);
+        LoopFd = -1;
+    }
+#endif
+
+    if (LoopFd < 0)
+        LogError("OVR::Linux::EventLoop - Failed to create event loop (error %d).\n", errno);
+}
+
+EventLoop::~EventLoop()
+{
+    for (Hash<int, Registration*>::Iterator it = Registrations.Begin();
+         it != Registrations.End(); ++it)
+    {
+        delete it->Second;
+    }
+    if (LoopFd >= 0)
+        close(LoopFd);
+    if (WakeFd >= 0)
+        close(WakeFd);
+}
+
+
+bool EventLoop::watch(Registration* reg, bool enable)
+{
+#if defined(OVR_EVENTLOOP_EPOLL)
+    struct epoll_event ev;
+    ev.events   = ((reg->Events & Event_Read)  ? (UInt32)EPOLLIN  : 0) |
+                  ((reg->Events & Event_Write) ? (UInt32)EPOLLOUT : 0);
+    ev.data.ptr = reg;
+    bool ok = epoll_ctl(LoopFd, enable ? EPOLL_CTL_ADD : EPOLL_CTL_DEL, reg->Fd, &ev) == 0;
+#else
+    // kqueue watches each condition with its own filter.
+    struct kevent kev[2];
+    int           count = 0;
+    if (reg->Events & Event_Read)
+        EV_SET(&kev[count++], reg->Fd, EVFILT_READ, enable ? EV_ADD : EV_DELETE, 0, 0, reg);
+    if (reg->Events & Event_Write)
+        EV_SET(&kev[count++], reg->Fd, EVFILT_WRITE, enable ? EV_ADD : EV_DELETE, 0, 0, reg);
+    bool ok = kevent(LoopFd, kev, count, 0, 0, 0) == 0;
+#endif
+    // A descriptor closed before removal is already gone from the kernel set.
+    reg->Watched = enable && ok;
+    return ok;
+}
+
+bool EventLoop::AddFd(FdHandler* handler, int fd, int events)
+{
+    if (!IsValid() || !handler || !(events & (Event_Read | Event_Write)) || Registrations.Get(fd))
+        return false;
+
+    Registration* reg = new Registration;
+    reg->pHandler = handler;
+    reg->Fd       = fd;
+    reg->Events   = events;
+    reg->Sequence = NextSequence++;
+    reg->Watched  = false;
+
+    if (!watch(reg, true))
+    {
+        LogError("OVR::Linux::EventLoop - Failed to watch fd %d (error %d).\n", fd, errno);
+        delete reg;
+        return false;
+    }
+
+    Registrations.Add(fd, reg);
+    return true;
+}
+
+bool EventLoop::RemoveFd(FdHandler* handler, int fd)
+{
+    Registration** preg = Registrations.Get(fd);
+    if (!preg || (*preg)->pHandler != handler)
+        return false;
+
+    Registration* reg = *preg;
+    Registrations.Remove(fd);
+    if (reg->Watched)
+        watch(reg, false);
+
+    // Events already fetched for it may still be waiting to be dispatched.
+    if (Dispatching)
+    {
+        reg->pHandler = 0;
+        Retired.PushBack(reg);
+    }
+    else
+    {
+        delete reg;
+    }
+    return true;
+}
+
+
+void EventLoop::Wake()
+{
+#if defined(OVR_EVENTLOOP_EPOLL)
+    UInt64 one = 1;
+    ssize_t result = write(WakeFd, &one, sizeof(one));
+    OVR_UNUSED(result);
+#else
+    struct kevent kev;
+    EV_SET(&kev, OVR_EVENTLOOP_WAKE_IDENT, EVFILT_USER, 0, NOTE_TRIGGER, 0, 0);
+    kevent(LoopFd, &kev, 1, 0, 0, 0);
+#endif
+}
+
+
+bool EventLoop::Wait(int waitMs)
+{
+    struct ReadyEvent
+    {
+        Registration*   pReg;
+        bool            Ready;
+        bool            Error;
+        bool            Closed;
+    };
+
+    ReadyEvent ready[MaxReadyEvents];
+    int        readyCount = 0;
+    bool       woken      = false;
+
+#if defined(OVR_EVENTLOOP_EPOLL)
+    struct epoll_event events[MaxReadyEvents];
+    int n = epoll_wait(LoopFd, events, MaxReadyEvents, waitMs);
+    WakeTime = Timer::GetSeconds();
+
+    for (int i = 0; i < n; i++)
+    {
+        Registration* reg = (Registration*)events[i].data.ptr;
+        if (!reg)
+        {
+            UInt64 count;
+            ssize_t result = read(WakeFd, &count, sizeof(count));
+            OVR_UNUSED(result);
+            woken = true;
+            continue;
+        }
+
+        ready[readyCount].pReg     = reg;
+        ready[readyCount].Ready = (events[i].events & (EPOLLIN | EPOLLOUT)) != 0;
+        ready[readyCount].Error    = (events[i].events & EPOLLERR) != 0;
+        ready[readyCount].Closed   = (events[i].events & (EPOLLHUP | EPOLLERR)) != 0;
+        readyCount++;
+    }
+#else
+    struct kevent   events[MaxReadyEvents];
+    struct timespec timeout;
+    timeout.tv_sec  = waitMs / 1000;
+    timeout.tv_nsec = (waitMs % 1000) * 1000000;
+    int n = kevent(LoopFd, 0, 0, events, MaxReadyEvents, (waitMs < 0) ? 0 : &timeout);
+    WakeTime = Timer::GetSeconds();
+
+    for (int i = 0; i < n; i++)
+    {
+        if (events[i].filter == EVFILT_USER)
+        {
+            woken = true;
+            continue;
+        }
+
+        bool eof = (events[i].flags & EV_EOF) != 0;
+        ready[readyCount].pReg     = (Registration*)events[i].udata;
+        ready[readyCount].Ready = !eof || events[i].data > 0;
+        ready[readyCount].Error    = (events[i].flags & EV_ERROR) != 0;
+        ready[readyCount].Closed   = eof || ready[readyCount].Error;
+        readyCount++;
+    }
+#endif
+
+    if (n < 0 && errno != EINTR)
+        OVR_DEBUG_LOG(("EventLoop: wait failed: %d", errno));
+
+    // Service the most recently added descriptors first, as the HID devices are
+    // added after the HID monitor; a disconnect is then handled at the device
+    // before the monitor reports it.
+    for (int i = 1; i < readyCount; i++)
+    {
+        ReadyEvent event = ready[i];
+        int        j     = i;
+        for (; j > 0 && ready[j - 1].pReg->Sequence < event.pReg->Sequence; j--)
+            ready[j] = ready[j - 1];
+        ready[j] = event;
+    }
+
+    Dispatching = true;
+    for (int i = 0; i < readyCount; i++)
+    {
+        Registration* reg = ready[i].pReg;
+        if (!reg->pHandler)
+            continue;
+
+        OVR_TRACE_SCOPE("EventLoop::OnEvent");
+        if (reg->Events & Event_Error)
+        {
+            // The handler deals with errors itself and removes the descriptor.
+            reg->pHandler->OnEvent(i, reg->Fd);
+            continue;
+        }
+
+        if (ready[i].Error)
+            OVR_DEBUG_LOG(("EventLoop: error on fd %d", reg->Fd));
+        else if (ready[i].Ready)
+            reg->pHandler->OnEvent(i, reg->Fd);
+
+        // Stop watching a closed descriptor, unless the handler removed it.
+        if (ready[i].Closed && reg->pHandler && reg->Watched)
+            watch(reg, false);
+    }
+    Dispatching = false;
+
+    for (UPInt i = 0; i < Retired.GetSize(); i++)
+        delete Retired[i];
+    Retired.Clear();
+
+    return woken;
+}
+
+}} // namespace OVR::Linux
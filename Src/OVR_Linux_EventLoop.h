@@ -0,0 +1,115 @@
+/************************************************************************************
+
+Filename    :   OVR_Linux_EventLoop.h
+Content     :   File descriptor event loop for the Linux device manager thread
+Created     :   October 14, 2026
+Notes       :
+
+Copyright   :   Copyright 2014 Oculus VR, Inc. All Rights reserved.
+
+Licensed under the Oculus VR Rift SDK License Version 3.1 (the "License"); 
+you may not use the Oculus VR Rift SDK except in compliance with the License, 
+which is provided at the time of installation or download, or which 
+otherwise accompanies this software in either electronic or hard copy form.
+
+You may obtain a copy of the License at
+
+http://www.oculusvr.com/licenses/LICENSE-3.1 
+
+Unless required by applicable law or agreed to in writing, the Oculus VR SDK 
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+*************************************************************************************/
+
+#ifndef OVR_Linux_EventLoop_h
+#define OVR_Linux_EventLoop_h
+
+#include "Kernel/OVR_Hash.h"
+#include "Kernel/OVR_Array.h"
+
+namespace OVR { namespace Linux {
+
+//-------------------------------------------------------------------------------------
+// ***** EventLoop
+
+// EventLoop waits for input on a set of file descriptors and calls the handler
+// registered for each one that becomes readable. It is built on epoll on Linux and
+// kqueue on FreeBSD, so registering, removing and dispatching don't depend on the
+// number of descriptors: each ready event carries its registration directly.
+//
+// Wake may be called from any thread to make Wait return early; everything else
+// must be called on the thread that calls Wait. Handlers may add and remove
+// descriptors, their own included, while they are being called.
+
+class EventLoop
+{
+public:
+    class FdHandler
+    {
+    public:
+        // Called when fd has input; i is the event's position in this dispatch.
+        virtual void OnEvent(int i, int fd) = 0;
+    };
+
+    // Conditions a descriptor can be watched for.
+    enum
+    {
+        Event_Read  = 1,
+        Event_Write = 2,
+        // Calls the handler for errors and hang-up too, and leaves the descriptor
+        // watched; the handler must remove it once it has dealt with them.
+        Event_Error = 4
+    };
+
+    EventLoop();
+    ~EventLoop();
+
+    bool IsValid() const { return LoopFd >= 0; }
+
+    // Each fd may be registered once. Unless Event_Error is given, descriptors that
+    // report hang-up or an error stop being watched but stay registered until removed.
+    bool AddFd(FdHandler* handler, int fd, int events = Event_Read);
+    bool RemoveFd(FdHandler* handler, int fd);
+
+    // Makes the current or next Wait return.
+    void Wake();
+
+    // Waits up to waitMs milliseconds (-1 for no limit) and dispatches the
+    // descriptors that are ready, most recently added first. Returns true if
+    // Wake was called.
+    bool Wait(int waitMs);
+
+    // Timer::GetSeconds time at which the last Wait stopped waiting; handlers
+    // can use it as the arrival time of the input they are called for.
+    double GetWakeTime() const { return WakeTime; }
+
+private:
+    struct Registration : public NewOverrideBase
+    {
+        FdHandler*  pHandler;
+        int         Fd;
+        int         Events;
+        UInt32      Sequence;
+        bool        Watched;
+    };
+
+    bool watch(Registration* reg, bool enable);
+
+    enum { MaxReadyEvents = 32 };
+
+    int                         LoopFd;
+    int                         WakeFd;
+    UInt32                      NextSequence;
+    double                      WakeTime;
+    Hash<int, Registration*>    Registrations;
+    // Removed during dispatch; freed once it completes.
+    bool                        Dispatching;
+    Array<Registration*>        Retired;
+};
+
+}} // namespace OVR::Linux
+
+#endif // OVR_Linux_EventLoop_h
@@ -26,10 +26,14 @@ limitations under the License.
 #include "OVR_Linux_HIDDevice.h"
 
 #include <sys/ioctl.h>
+#include <sys/stat.h>
 #include <fcntl.h>
+#include <unistd.h>
 #include <errno.h>
 #include <linux/hidraw.h>
 #include "OVR_HIDDeviceImpl.h"
+#include "Kernel/OVR_BinaryLog.h"
+#include "Kernel/OVR_Timer.h"
 
 namespace OVR { namespace Linux {
 
@@ -41,62 +45,15 @@ static const UInt32 MAX_QUEUED_INPUT_REPORTS = 5;
 HIDDeviceManager::HIDDeviceManager(DeviceManager* manager) : DevManager(manager)
 {
     UdevInstance = NULL;
-    HIDMonitor = NULL;
-    HIDMonHandle = -1;
+    CacheValid = false;
+    HotplugQueued = false;
+    HotplugRescan = false;
 }
 
 //-----------------------------------------------------------------------------
 HIDDeviceManager::~HIDDeviceManager()
 {
-}
-
-//-----------------------------------------------------------------------------
-bool HIDDeviceManager::initializeManager()
-{
-    if (HIDMonitor)
-    {
-        return true;
-    }
-
-    // Create a udev_monitor handle to watch for device changes (hot-plug detection)
-    HIDMonitor = udev_monitor_new_from_netlink(UdevInstance, "udev");
-    if (HIDMonitor == NULL)
-    {
-        return false;
-    }
-
-    udev_monitor_filter_add_match_subsystem_devtype(HIDMonitor, "hidraw", NULL);  // filter for hidraw only
-	
-    int err = udev_monitor_enable_receiving(HIDMonitor);
-    if (err)
-    {
-        udev_monitor_unref(HIDMonitor);
-        HIDMonitor = NULL;
-        return false;
-    }
-	
-    // Get the file descriptor (fd) for the monitor.  
-    HIDMonHandle = udev_monitor_get_fd(HIDMonitor);
-    if (HIDMonHandle < 0)
-    {
-        udev_monitor_unref(HIDMonitor);
-        HIDMonitor = NULL;
-        return false;
-    }
-
-    // This file handle will be polled along-side with the device hid handles for changes
-    // Add the handle to the polling list
-    if (!DevManager->pThread->AddSelectFd(this, HIDMonHandle))
-    {
-        close(HIDMonHandle);
-        HIDMonHandle = -1;
-
-        udev_monitor_unref(HIDMonitor);
-        HIDMonitor = NULL;
-        return false;
-    }
-
-    return true;
+    StopHotplugMonitor();
 }
 
 //-----------------------------------------------------------------------------
@@ -108,7 +65,16 @@ bool HIDDeviceManager::Initialize()
     if (!UdevInstance)
         return false;
 
-    return initializeManager();
+    // Hotplug events are received and described on a thread of their own, so
+    // that they don't hold up the device manager thread. Without them devices
+    // are still found, by scanning udev on each enumeration.
+    pHotplugMonitor = *new HotplugMonitor(this);
+    if (!pHotplugMonitor->StartMonitoring())
+    {
+        LogText("OVR::Linux::HIDDeviceManager - hot-plug notifications are not available.\n");
+        pHotplugMonitor.Clear();
+    }
+    return true;
 }
 
 //-----------------------------------------------------------------------------
@@ -116,15 +82,7 @@ void HIDDeviceManager::Shutdown()
 {
     OVR_ASSERT_LOG((UdevInstance), ("Should have called 'Initialize' before 'Shutdown'."));
 
-    if (HIDMonitor)
-    {
-        DevManager->pThread->RemoveSelectFd(this, HIDMonHandle);
-        close(HIDMonHandle);
-        HIDMonHandle = -1;
-
-        udev_monitor_unref(HIDMonitor);
-        HIDMonitor = NULL;
-    }
+    StopHotplugMonitor();
 
     udev_unref(UdevInstance);  // release the library
     
@@ -211,14 +169,33 @@ bool HIDDeviceManager::getStringProperty(udev_device* device,
 }
 
 //-----------------------------------------------------------------------------
-bool HIDDeviceManager::Enumerate(HIDEnumerateVisitor* enumVisitor)
+bool HIDDeviceManager::GetUSBBus(const char* dev_path, String* pBus)
 {
-    
-    if (!initializeManager())
+    struct stat st;
+    if (stat(dev_path, &st) != 0)
+    {
+        return false;
+    }
+
+    udev_device* hid = udev_device_new_from_devnum(UdevInstance, 'c', st.st_rdev);
+    if (!hid)
     {
         return false;
     }
 
+    // The USB device belongs to hid.
+    udev_device* usb = udev_device_get_parent_with_subsystem_devtype(hid, "usb", "usb_device");
+    bool success = usb && getStringProperty(usb, "busnum", pBus);
+
+    udev_device_unref(hid);
+    return success;
+}
+
+//-----------------------------------------------------------------------------
+void HIDDeviceManager::scanDevices()
+{
+    CachedDevices.Clear();
+
 	// Get a list of hid devices
     udev_enumerate* devices = udev_enumerate_new(UdevInstance);
     udev_enumerate_add_match_subsystem(devices, "hidraw");
@@ -226,59 +203,100 @@ bool HIDDeviceManager::Enumerate(HIDEnumerateVisitor* enumVisitor)
 
     udev_list_entry* entry = udev_enumerate_get_list_entry(devices);
 
-    // Search each device for the matching vid/pid
     while (entry != NULL)
     {
         // Get the device file name
         const char* sysfs_path = udev_list_entry_get_name(entry);
         udev_device* hid;  // The device's HID udev node.
         hid = udev_device_new_from_syspath(UdevInstance, sysfs_path);
-        const char* dev_path = udev_device_get_devnode(hid);
+        const char* dev_path = hid ? udev_device_get_devnode(hid) : NULL;
 
-        // Get the USB device
-        hid = udev_device_get_parent_with_subsystem_devtype(hid, "usb", "usb_device");
-        if (hid)
+        // Get the USB device; it belongs to hid.
+        udev_device* usb = hid ? udev_device_get_parent_with_subsystem_devtype(hid, "usb", "usb_device") : NULL;
+        if (usb && dev_path)
         {
             HIDDeviceDesc devDesc;
+            devDesc.Path = dev_path;
+            getFullDesc(usb, &devDesc);
+            CachedDevices.PushBack(devDesc);
+        }
 
-            // Check the VID/PID for a match
-            if (dev_path &&
-                initVendorProductVersion(hid, &devDesc) &&
-                enumVisitor->MatchVendorProduct(devDesc.VendorId, devDesc.ProductId))
-            {
-                devDesc.Path = dev_path;
-                getFullDesc(hid, &devDesc);
-
-                // Look for the device to check if it is already opened.
-                Ptr<DeviceCreateDesc> existingDevice = DevManager->FindHIDDevice(devDesc, true);
-                // if device exists and it is opened then most likely the device open()
-                // will fail; therefore, we just set Enumerated to 'true' and continue.
-                if (existingDevice && existingDevice->pDevice)
-                {
-                    existingDevice->Enumerated = true;
-                }
-                else
-                {   // open the device temporarily for startup communication
-                    int device_handle = open(dev_path, O_RDWR);
-                    if (device_handle >= 0)
-                    {
-                        // Construct minimal device that the visitor callback can get feature reports from
-                        Linux::HIDDevice device(this, device_handle);
-                        enumVisitor->Visit(device, devDesc);
-
-                        close(device_handle);  // close the file handle
-                    }
-                }
-            }
-
+        if (hid)
             udev_device_unref(hid);
-            entry = udev_list_entry_get_next(entry);
-        }
+        entry = udev_list_entry_get_next(entry);
     }
 
 	// Free the enumerator and udev objects
     udev_enumerate_unref(devices);
 
+    // Events from now on keep the list current.
+    CacheValid = pHotplugMonitor && pHotplugMonitor->IsMonitoring();
+}
+
+void HIDDeviceManager::updateCachedDevice(const HIDDeviceDesc& desc)
+{
+    for (UPInt i = 0; i < CachedDevices.GetSize(); i++)
+    {
+        if (CachedDevices[i].Path == desc.Path)
+        {
+            CachedDevices[i] = desc;
+            return;
+        }
+    }
+    CachedDevices.PushBack(desc);
+}
+
+void HIDDeviceManager::removeCachedDevice(const String& path)
+{
+    for (UPInt i = 0; i < CachedDevices.GetSize(); i++)
+    {
+        if (CachedDevices[i].Path == path)
+        {
+            CachedDevices.RemoveAt(i);
+            return;
+        }
+    }
+}
+
+//-----------------------------------------------------------------------------
+bool HIDDeviceManager::Enumerate(HIDEnumerateVisitor* enumVisitor)
+{
+    if (!CacheValid)
+    {
+        scanDevices();
+    }
+
+    // Search each device for the matching vid/pid
+    for (UPInt i = 0; i < CachedDevices.GetSize(); i++)
+    {
+        const HIDDeviceDesc& devDesc = CachedDevices[i];
+        if (!enumVisitor->MatchVendorProduct(devDesc.VendorId, devDesc.ProductId))
+        {
+            continue;
+        }
+
+        // Look for the device to check if it is already opened.
+        Ptr<DeviceCreateDesc> existingDevice = DevManager->FindHIDDevice(devDesc, true);
+        // if device exists and it is opened then most likely the device open()
+        // will fail; therefore, we just set Enumerated to 'true' and continue.
+        if (existingDevice && existingDevice->pDevice)
+        {
+            existingDevice->Enumerated = true;
+        }
+        else
+        {   // open the device temporarily for startup communication
+            int device_handle = open(devDesc.Path.ToCStr(), O_RDWR);
+            if (device_handle >= 0)
+            {
+                // Construct minimal device that the visitor callback can get feature reports from
+                Linux::HIDDevice device(this, device_handle);
+                enumVisitor->Visit(device, devDesc);
+
+                close(device_handle);  // close the file handle
+            }
+        }
+    }
+
     return true;
 }
 
@@ -319,9 +337,16 @@ bool HIDDeviceManager::getFullDesc(udev_device* device, HIDDeviceDesc* desc)
 //-----------------------------------------------------------------------------
 bool HIDDeviceManager::GetDescriptorFromPath(const char* dev_path, HIDDeviceDesc* desc)
 {
-    if (!initializeManager())
+    if (CacheValid)
     {
-        return false;
+        for (UPInt i = 0; i < CachedDevices.GetSize(); i++)
+        {
+            if (CachedDevices[i].Path == dev_path)
+            {
+                *desc = CachedDevices[i];
+                return true;
+            }
+        }
     }
 
     // Search for the udev device from the given pathname so we can
@@ -367,46 +392,91 @@ bool HIDDeviceManager::GetDescriptorFromPath(const char* dev_path, HIDDeviceDesc
 }
 
 //-----------------------------------------------------------------------------
-void HIDDeviceManager::OnEvent(int i, int fd)
+void HIDDeviceManager::StopHotplugMonitor()
 {
-    OVR_UNUSED(i);
-    OVR_UNUSED(fd);
-
-    // There is a device status change
-    udev_device* hid = udev_monitor_receive_device(HIDMonitor);
-    if (hid)
+    if (pHotplugMonitor)
     {
-        const char* dev_path = udev_device_get_devnode(hid);
-        const char* action = udev_device_get_action(hid);
+        pHotplugMonitor->StopMonitoring();
+        pHotplugMonitor.Clear();
+    }
+}
 
-        HIDDeviceDesc device_info;
-        device_info.Path = dev_path;
+//-----------------------------------------------------------------------------
+void HIDDeviceManager::QueueHotplugEvent(MessageType type, const HIDDeviceDesc& desc)
+{
+    HotplugEvent hotplugEvent;
+    hotplugEvent.Type = type;
+    hotplugEvent.Desc = desc;
 
-        MessageType notify_type;
-        if (OVR_strcmp(action, "add") == 0)
-        {
-            notify_type = Message_DeviceAdded;
+    bool queueCall;
+    {
+        Lock::Locker lock(&HotplugLock);
+        HotplugEvents.PushBack(hotplugEvent);
+        queueCall = !HotplugQueued;
+        HotplugQueued = true;
+    }
+    queueHotplugCall(queueCall);
+}
 
-            // Retrieve the device info.  This can only be done on a connected
-            // device and is invalid for a disconnected device
+//-----------------------------------------------------------------------------
+void HIDDeviceManager::QueueHotplugRescan()
+{
+    bool queueCall;
+    {
+        Lock::Locker lock(&HotplugLock);
+        HotplugRescan = true;
+        queueCall = !HotplugQueued;
+        HotplugQueued = true;
+    }
+    queueHotplugCall(queueCall);
+}
 
-            // Get the USB device
-            hid = udev_device_get_parent_with_subsystem_devtype(hid, "usb", "usb_device");
-            if (!hid)
+//-----------------------------------------------------------------------------
+void HIDDeviceManager::queueHotplugCall(bool queueCall)
+{
+    // The queued call keeps the manager alive until it has run. Pushing can
+    // block, so it is done without holding the lock.
+    if (queueCall)
+    {
+        AddRef();
+        if (!DevManager->pThread->PushCall(this, &HIDDeviceManager::processHotplugEvents))
+        {
             {
-                return;
+                Lock::Locker lock(&HotplugLock);
+                HotplugQueued = false;
             }
-
-            getFullDesc(hid, &device_info);
+            Release();
         }
-        else if (OVR_strcmp(action, "remove") == 0)
+    }
+}
+
+//-----------------------------------------------------------------------------
+Void HIDDeviceManager::processHotplugEvents()
+{
+    Array<HotplugEvent> events;
+    {
+        Lock::Locker lock(&HotplugLock);
+        events = HotplugEvents;
+        HotplugEvents.Clear();
+        HotplugQueued = false;
+        if (HotplugRescan)
         {
-            notify_type = Message_DeviceRemoved;
+            // Some events may have been lost, so the device list can no longer
+            // be trusted.
+            CacheValid    = false;
+            HotplugRescan = false;
         }
+    }
+
+    for (UPInt e = 0; e < events.GetSize(); e++)
+    {
+        MessageType    notify_type = events[e].Type;
+        HIDDeviceDesc& device_info = events[e].Desc;
+
+        if (notify_type == Message_DeviceAdded)
+            updateCachedDevice(device_info);
         else
-        {
-            return;
-        }
+            removeCachedDevice(device_info.Path);
 
         bool error = false;
         bool deviceFound = false;
@@ -425,9 +495,10 @@ void HIDDeviceManager::OnEvent(int i, int fd)
         {
             DevManager->DetectHIDDevice(device_info);
         }
-
-        udev_device_unref(hid);
     }
+
+    Release();
+    return 0;
 }
 
 //=============================================================================
@@ -460,13 +531,18 @@ HIDDevice::~HIDDevice()
 bool HIDDevice::HIDInitialize(const String& path)
 {
     const char* hid_path = path.ToCStr();
+
+    // Called on this thread, as part of the device's Initialize.
+    pThread = HIDManager->DevManager->GetDeviceThread(path);
+    OVR_ASSERT(pThread->GetThreadId() == GetCurrentThreadId());
+
     if (!openDevice(hid_path))
     {
         LogText("OVR::Linux::HIDDevice - Failed to open HIDDevice: %s", hid_path);
         return false;
     }
     
-    HIDManager->DevManager->pThread->AddTicksNotifier(this);
+    pThread->AddTicksNotifier(this);
     HIDManager->AddNotificationDevice(this);
 
     LogText("OVR::Linux::HIDDevice - Opened '%s'\n"
@@ -561,8 +637,8 @@ bool HIDDevice::openDevice(const char* device_path)
         return false;
     }
 
-    // Now open the device
-    DeviceHandle = open(device_path, O_RDWR);
+    // Now open the device; non-blocking so that OnEvent can drain its queue
+    DeviceHandle = open(device_path, O_RDWR | O_NONBLOCK);
     if (DeviceHandle < 0)
     {
         OVR_DEBUG_LOG(("Failed 'CreateHIDFile' while opening device, error = 0x%X.", errno));
@@ -581,7 +657,7 @@ bool HIDDevice::openDevice(const char* device_path)
     }
 
     // Add the device to the polling list
-    if (!HIDManager->DevManager->pThread->AddSelectFd(this, DeviceHandle))
+    if (!pThread->AddSelectFd(this, DeviceHandle))
     {
         OVR_ASSERT_LOG(false, ("Failed to initialize polling for HIDDevice."));
 
@@ -596,8 +672,25 @@ bool HIDDevice::openDevice(const char* device_path)
 //-----------------------------------------------------------------------------
 void HIDDevice::HIDShutdown()
 {
+    // Not registered anywhere if the thread was never assigned.
+    if (!pThread)
+    {
+        return;
+    }
+
+    // The last reference may be released on the manager thread. If the device
+    // thread is exiting, its event loop is no longer serviced.
+    Void result;
+    if (pThread->GetThreadId() == GetCurrentThreadId() ||
+        !pThread->PushCallAndWaitResult(this, &HIDDevice::hidShutdown, &result))
+    {
+        hidShutdown();
+    }
+}
 
-    HIDManager->DevManager->pThread->RemoveTicksNotifier(this);
+Void HIDDevice::hidShutdown()
+{
+    pThread->RemoveTicksNotifier(this);
     HIDManager->RemoveNotificationDevice(this);
     
     if (DeviceHandle >= 0) // Device may already have been closed if unplugged.
@@ -606,6 +699,7 @@ void HIDDevice::HIDShutdown()
     }
     
     LogText("OVR::Linux::HIDDevice - HIDShutdown '%s'\n", DevDesc.Path.ToCStr());
+    return 0;
 }
 
 //-----------------------------------------------------------------------------
@@ -615,7 +709,7 @@ void HIDDevice::closeDevice(bool wasUnplugged)
     OVR_ASSERT(DeviceHandle >= 0);
     
 
-    HIDManager->DevManager->pThread->RemoveSelectFd(this, DeviceHandle);
+    pThread->RemoveSelectFd(this, DeviceHandle);
 
     close(DeviceHandle);  // close the file handle
     DeviceHandle = -1;
@@ -675,19 +769,46 @@ double HIDDevice::OnTicks(double tickSeconds)
 void HIDDevice::OnEvent(int i, int fd)
 {
     OVR_UNUSED(i);
-    // We have data to read from the device
-    int bytes = read(fd, ReadBuffer, ReadBufferSize);
-    if (bytes >= 0)
-    {
+    // We have data to read from the device. hidraw returns one report per read;
+    // keep reading until it has no more, so a backed up queue costs one wakeup.
+    // hidraw doesn't timestamp reports: the first was there when the thread woke
+    // up, and any later one by the time it is read.
+    double receiveTime = pThread->GetWakeTime();
+    for (;;)
+    {
+        UInt32 count = 0;
+        int    bytes = 0;
+        while (count < ReadBatchSize)
+        {
+            ReadTimes[count] = receiveTime;
+            bytes = read(fd, ReadReports[count], ReadBufferSize);
+            receiveTime = Timer::GetSeconds();
+            if (bytes < 0)
+                break;
+            ReadLengths[count++] = (UInt32)bytes;
+            if (bytes == 0)
+                break;
+        }
+        int readErrno = (bytes < 0) ? errno : 0;
+        bool drained  = (count < ReadBatchSize);
+
 // TODO: I need to handle partial messages and package reconstruction
-        if (Handler)
+        if (count && Handler)
         {
-            Handler->OnInputReport(ReadBuffer, bytes);
+            Handler->OnInputReports(ReadReports[0], ReadBufferSize, ReadLengths, ReadTimes, count);
         }
-    }
-    else
-    {   // Close the device on read error.
-        closeDeviceOnIOError();
+
+        if (readErrno && readErrno != EAGAIN && readErrno != EWOULDBLOCK && readErrno != EINTR)
+        {   // Close the device on read error.
+            OVR_BINARY_LOG_TEXT("OVR::Linux::HIDDevice - Read error %d on '%s'\n",
+                                (readErrno, DevDesc.Path.ToCStr()));
+            closeDeviceOnIOError();
+            return;
+        }
+
+        // The handler may have closed the device.
+        if (drained || DeviceHandle != fd)
+            return;
     }
 }
 
@@ -707,33 +828,62 @@ bool HIDDevice::OnDeviceNotification(MessageType messageType,
         {
             return false;
         }
+    }
+    else if (messageType == Message_DeviceRemoved)
+    {
+        // Is this the correct device?
+        // For disconnected device, the device description will be invalid so
+        // checking the path is the only way to match them
+        if (DevDesc.Path.CompareNoCase(device_path) != 0)
+        {
+            return false;
+        }
+    }
+    else
+    {
+        OVR_ASSERT(0);
+        *error = false;
+        return true;
+    }
+
+    // The device is reopened or closed, and its handler told, on its own thread.
+    Notification notification = { messageType, device_info, error };
+    bool         result       = false;
+    if (pThread->GetThreadId() == GetCurrentThreadId() ||
+        !pThread->PushCallAndWaitResult(this, &HIDDevice::handleNotification, &result, &notification))
+    {
+        result = handleNotification(&notification);
+    }
+    return result;
+}
 
+bool HIDDevice::handleNotification(Notification* notification)
+{
+    const char* device_path = notification->pDesc->Path.ToCStr();
+
+    if (notification->Type == Message_DeviceAdded)
+    {
         // A closed device has been re-added. Try to reopen.
         if (!openDevice(device_path))
         {
             LogError("OVR::Linux::HIDDevice - Failed to reopen a device '%s' that was re-added.\n", 
                      device_path);
-            *error = true;
+            *notification->pError = true;
             return true;
         }
 
         LogText("OVR::Linux::HIDDevice - Reopened device '%s'\n", device_path);
 
+        // Let the handler send its keep-alive now rather than at its old deadline.
+        pThread->ResetTicksNotifier(this);
+
         if (Handler)
         {
             Handler->OnDeviceMessage(HIDHandler::HIDDeviceMessage_DeviceAdded);
         }
     }
-    else if (messageType == Message_DeviceRemoved)
+    else
     {
-        // Is this the correct device?
-        // For disconnected device, the device description will be invalid so
-        // checking the path is the only way to match them
-        if (DevDesc.Path.CompareNoCase(device_path) != 0)
-        {
-            return false;
-        }
-
         if (DeviceHandle >= 0)
         {
             closeDevice(true);
@@ -744,12 +894,8 @@ bool HIDDevice::OnDeviceNotification(MessageType messageType,
             Handler->OnDeviceMessage(HIDHandler::HIDDeviceMessage_DeviceRemoved);
         }
     }
-    else
-    {
-        OVR_ASSERT(0);
-    }
 
-    *error = false;
+    *notification->pError = false;
     return true;
 }
 
@@ -28,6 +28,7 @@ limitations under the License.
 
 #include "OVR_HIDDevice.h"
 #include "OVR_Linux_DeviceManager.h"
+#include "OVR_Linux_HotplugMonitor.h"
 #include <libudev.h>
 
 namespace OVR { namespace Linux {
@@ -43,6 +44,9 @@ private:
     friend class HIDDeviceManager;
 
 public:
+    // The read buffers are part of the object.
+    OVR_MEMORY_REDEFINE_NEW_TAGGED(AllocSubsystem_HID)
+
     HIDDevice(HIDDeviceManager* manager);
 
     // This is a minimal constructor used during enumeration for us to pass
@@ -66,19 +70,38 @@ public:
                               bool* error);
 
 private:
+    // A hotplug notification matched to this device, handed to its thread.
+    struct Notification
+    {
+        MessageType         Type;
+        HIDDeviceDesc*      pDesc;
+        bool*               pError;
+    };
+
     bool initInfo();
     bool openDevice(const char* dev_path);
     void closeDevice(bool wasUnplugged);
     void closeDeviceOnIOError();
     bool setupDevicePluggedInNotification();
 
+    // Bodies of HIDShutdown and OnDeviceNotification, run on pThread.
+    Void hidShutdown();
+    bool handleNotification(Notification* notification);
+
     bool                    InMinimalMode;
     HIDDeviceManager*       HIDManager;
+    // Thread whose event loop the device is registered with; the device's I/O,
+    // ticks and handler calls all happen there.
+    Ptr<DeviceManagerThread> pThread;
     int                     DeviceHandle;     // file handle to the device
     HIDDeviceDesc           DevDesc;
     
-    enum { ReadBufferSize = 96 };
-    UByte                   ReadBuffer[ReadBufferSize];
+    // Reports are read until the device has no more queued, up to ReadBatchSize
+    // at a time, and handed to the handler together.
+    enum { ReadBufferSize = 96, ReadBatchSize = 16 };
+    UByte                   ReadReports[ReadBatchSize][ReadBufferSize];
+    UInt32                  ReadLengths[ReadBatchSize];
+    double                  ReadTimes[ReadBatchSize];
 
     UInt16                  InputReportBufferLength;
     UInt16                  OutputReportBufferLength;
@@ -89,9 +112,10 @@ private:
 //-------------------------------------------------------------------------------------
 // ***** Linux HIDDeviceManager
 
-class HIDDeviceManager : public OVR::HIDDeviceManager, public DeviceManagerThread::Notifier
+class HIDDeviceManager : public OVR::HIDDeviceManager
 {
 	friend class HIDDevice;
+	friend class HotplugMonitor;
 
 public:
     HIDDeviceManager(Linux::DeviceManager* Manager);
@@ -105,29 +129,65 @@ public:
 
     static HIDDeviceManager* CreateInternal(DeviceManager* manager);
 
-    void OnEvent(int i, int fd);
+    // Called by the HotplugMonitor on its thread; the events are handled by
+    // processHotplugEvents on the device manager thread.
+    void QueueHotplugEvent(MessageType type, const HIDDeviceDesc& desc);
+    // Events may have been missed, so the device list must be scanned again.
+    void QueueHotplugRescan();
+    // Called before the device manager thread exits; no events are queued after.
+    void StopHotplugMonitor();
+
+    // Returns the number of the USB bus the hidraw device at dev_path is on.
+    bool GetUSBBus(const char* dev_path, String* pBus);
     
 private:
-    bool initializeManager();
-    bool initVendorProductVersion(udev_device* device, HIDDeviceDesc* pDevDesc);
+    struct HotplugEvent
+    {
+        MessageType     Type;
+        HIDDeviceDesc   Desc;
+    };
+
+    // The udev queries below use no state, so the HotplugMonitor calls them too.
+    static bool initVendorProductVersion(udev_device* device, HIDDeviceDesc* pDevDesc);
     bool getPath(udev_device* device, String* pPath);
-    bool getIntProperty(udev_device* device, const char* key, int32_t* pResult);
-    bool getStringProperty(udev_device* device,
-                           const char* propertyName,
-                           OVR::String* pResult);
-    bool getFullDesc(udev_device* device, HIDDeviceDesc* desc);
+    static bool getIntProperty(udev_device* device, const char* key, int32_t* pResult);
+    static bool getStringProperty(udev_device* device,
+                                  const char* propertyName,
+                                  OVR::String* pResult);
+    static bool getFullDesc(udev_device* device, HIDDeviceDesc* desc);
     bool GetDescriptorFromPath(const char* dev_path, HIDDeviceDesc* desc);
     
     bool AddNotificationDevice(HIDDevice* device);
     bool RemoveNotificationDevice(HIDDevice* device);
+
+    // Fills CachedDevices from a full udev scan.
+    void scanDevices();
+    void updateCachedDevice(const HIDDeviceDesc& desc);
+    void removeCachedDevice(const String& path);
+
+    // Queues processHotplugEvents, if queueCall.
+    void queueHotplugCall(bool queueCall);
+    Void processHotplugEvents();
     
     DeviceManager*           DevManager;
 
     udev*                    UdevInstance;     // a handle to the udev library instance
-    udev_monitor*            HIDMonitor;
-    int                      HIDMonHandle;     // the udev_monitor file handle
+    Ptr<HotplugMonitor>      pHotplugMonitor;
+
+    Lock                     HotplugLock;
+    Array<HotplugEvent>      HotplugEvents;
+    bool                     HotplugQueued;
+    bool                     HotplugRescan;
 
     Array<HIDDevice*>        NotificationDevices;
+
+    // Descriptors of the hidraw devices present, so that Enumerate doesn't query
+    // udev each time. Scanned once, then kept up to date from the monitor's add
+    // and remove events; rescanned if the monitor may have missed any. Only used
+    // on the device manager thread, like Enumerate and processHotplugEvents, or on
+    // a device thread while the manager thread waits for it to open or close a device.
+    Array<HIDDeviceDesc>     CachedDevices;
+    bool                     CacheValid;
 };
 
 }} // namespace OVR::Linux
@@ -187,28 +187,106 @@ bool HMDDeviceCreateDesc::MatchDevice(const String& path)
 //-------------------------------------------------------------------------------------
 // ***** HMDDeviceFactory
 
+HMDDeviceFactory::HMDDeviceFactory()
+    : pDisplay(0), RREventBase(-1), DisplaysKnown(false),
+      HMDFound(false), HMDDisplayIndex(0), HMDX(0), HMDY(0)
+{
+}
+
 HMDDeviceFactory &HMDDeviceFactory::GetInstance()
 {
 	static HMDDeviceFactory instance;
 	return instance;
 }
 
-void HMDDeviceFactory::EnumerateDevices(EnumerateVisitor& visitor)
+void HMDDeviceFactory::RemovedFromManager()
+{
+    if (pDisplay)
+    {
+        XCloseDisplay(pDisplay);
+        pDisplay = 0;
+    }
+    RREventBase   = -1;
+    DisplaysKnown = false;
+    HMDFound      = false;
+
+    DeviceFactory::RemovedFromManager();
+}
+
+bool HMDDeviceFactory::openDisplay()
+{
+    if (pDisplay)
+        return true;
+
+    pDisplay = XOpenDisplay(NULL);
+    if (!pDisplay)
+        return false;
+
+    int errorBase;
+    if (XRRQueryExtension(pDisplay, &RREventBase, &errorBase))
+    {
+        XRRSelectInput(pDisplay, DefaultRootWindow(pDisplay),
+                       RRScreenChangeNotifyMask | RRCrtcChangeNotifyMask | RROutputChangeNotifyMask);
+    }
+    else
+    {
+        RREventBase = -1;
+    }
+    return true;
+}
+
+bool HMDDeviceFactory::displaysChanged()
+{
+    if (!pDisplay || RREventBase < 0)
+        return true;
+
+    // Only RandR events are selected on this connection, and XPending doesn't block.
+    bool changed = false;
+    while (XPending(pDisplay))
+    {
+        XEvent event;
+        XNextEvent(pDisplay, &event);
+        XRRUpdateConfiguration(&event);
+        if (event.type == RREventBase + RRScreenChangeNotify ||
+            event.type == RREventBase + RRNotify)
+        {
+            changed = true;
+        }
+    }
+    return changed;
+}
+
+void HMDDeviceFactory::scanDisplays()
 {
     // For now we'll assume the Rift DK1 is attached in extended monitor mode. Ultimately we need to
     // use XFree86 to enumerate X11 screens in case the Rift is attached as a separate screen.
 
-    bool foundHMD = false;
-    Display* display = XOpenDisplay(NULL);
-    XRRScreenResources *screen = XRRGetScreenResources(display, DefaultRootWindow(display));
-    for (int iscres = screen->noutput - 1; iscres >= 0; --iscres) {
+    DisplaysKnown = false;
+    HMDFound      = false;
+    if (!openDisplay())
+        return;
+
+    // The current configuration is read without making the server probe the
+    // outputs again, which can take a long time; a server that hasn't probed
+    // them yet reports none.
+    Window              root   = DefaultRootWindow(pDisplay);
+    XRRScreenResources* screen = XRRGetScreenResourcesCurrent(pDisplay, root);
+    if (screen && screen->noutput == 0)
+    {
+        XRRFreeScreenResources(screen);
+        screen = XRRGetScreenResources(pDisplay, root);
+    }
+    if (!screen)
+        return;
+
+    for (int iscres = screen->noutput - 1; iscres >= 0 && !HMDFound; --iscres) {
         RROutput output = screen->outputs[iscres];
-        MonitorInfo * mi = read_edid_data(display, output);
+        MonitorInfo * mi = read_edid_data(pDisplay, output);
         if (mi == NULL) {
             continue;
         }
 
-        XRROutputInfo * info = XRRGetOutputInfo (display, screen, output);
+        XRROutputInfo * info = XRRGetOutputInfo (pDisplay, screen, output);
         if (info && (0 == memcmp(mi->manufacturer_code, "OVR", 3))) {
 
             // Generate a device ID string similar to the way Windows does it
@@ -216,67 +294,82 @@ void HMDDeviceFactory::EnumerateDevices(EnumerateVisitor& visitor)
             OVR_sprintf(device_id, 32, "%s%04d", mi->manufacturer_code, mi->product_code);
 
             // The default monitor coordinates
-            int mx      = 0;
-            int my      = 0;
-            int mwidth  = 1280;
-            int mheight = 800;
+            HMDX = 0;
+            HMDY = 0;
 
             if (info->connection == RR_Connected && info->crtc) {
-                XRRCrtcInfo * crtc_info = XRRGetCrtcInfo (display, screen, info->crtc);
+                XRRCrtcInfo * crtc_info = XRRGetCrtcInfo (pDisplay, screen, info->crtc);
                 if (crtc_info)
                 {
-                    mx = crtc_info->x;
-                    my = crtc_info->y;
-                    //mwidth = crtc_info->width;
-                    //mheight = crtc_info->height;
+                    HMDX = crtc_info->x;
+                    HMDY = crtc_info->y;
                     XRRFreeCrtcInfo(crtc_info);
                 }
             }
 
-            String deviceID = device_id;
-            HMDDeviceCreateDesc hmdCreateDesc(this, deviceID, iscres);
-
-            // Hard-coded defaults in case the device doesn't have the data itself.
-            if (strstr(device_id, "OVR0003"))
-            {   // DK2 prototypes and variants (default to HmdType_DK2)
-                hmdCreateDesc.SetScreenParameters(mx, my, 1920, 1080, 0.12576f, 0.07074f, 0.12576f*0.5f, 0.0635f );
-            }
-            else if (strstr(device_id, "OVR0002"))
-            {   // HD Prototypes (default to HmdType_DKHDProto)
-                hmdCreateDesc.SetScreenParameters(mx, my, 1920, 1080, 0.12096f, 0.06804f, 0.06804f*0.5f, 0.0635f );
-            }
-            else if (strstr(device_id, "OVR0001"))
-            {   // DK1
-                hmdCreateDesc.SetScreenParameters(mx, my, mwidth, mheight, 0.14976f, 0.0936f, 0.0936f*0.5f, 0.0635f);
-            }
-            else if (strstr(device_id, "OVR00"))
-            {   // Future Oculus HMD devices (default to DK1 dimensions)
-                hmdCreateDesc.SetScreenParameters(mx, my, mwidth, mheight, 0.14976f, 0.0936f, 0.0936f*0.5f, 0.0635f);
-            }
-            else
-            {   // Duct-tape prototype
-                hmdCreateDesc.SetScreenParameters(mx, my, mwidth, mheight, 0.12096f, 0.0756f, 0.0756f*0.5f, 0.0635f);
-            }
+            HMDDeviceId     = device_id;
+            HMDDisplayIndex = iscres;
+            HMDFound        = true;
 
             OVR_DEBUG_LOG_TEXT(("DeviceManager - HMD Found %s - %s\n", device_id, mi->dsc_product_name));
-
-            // Notify caller about detected device. This will call EnumerateAddDevice
-            // if the this is the first time device was detected.
-            visitor.Visit(hmdCreateDesc);
-            foundHMD = true;
-            break;
         } // if
 
-        XRRFreeOutputInfo(info);
+        if (info)
+            XRRFreeOutputInfo(info);
         delete mi;
     } // for
     XRRFreeScreenResources(screen);
 
+    DisplaysKnown = true;
+}
+
+void HMDDeviceFactory::EnumerateDevices(EnumerateVisitor& visitor)
+{
+    if (!DisplaysKnown || displaysChanged())
+        scanDisplays();
+
+    if (HMDFound)
+    {
+        // The default monitor size
+        int mwidth  = 1280;
+        int mheight = 800;
+        int mx      = HMDX;
+        int my      = HMDY;
+
+        const char* device_id = HMDDeviceId.ToCStr();
+        HMDDeviceCreateDesc hmdCreateDesc(this, HMDDeviceId, HMDDisplayIndex);
+
+        // Hard-coded defaults in case the device doesn't have the data itself.
+        if (strstr(device_id, "OVR0003"))
+        {   // DK2 prototypes and variants (default to HmdType_DK2)
+            hmdCreateDesc.SetScreenParameters(mx, my, 1920, 1080, 0.12576f, 0.07074f, 0.12576f*0.5f, 0.0635f );
+        }
+        else if (strstr(device_id, "OVR0002"))
+        {   // HD Prototypes (default to HmdType_DKHDProto)
+            hmdCreateDesc.SetScreenParameters(mx, my, 1920, 1080, 0.12096f, 0.06804f, 0.06804f*0.5f, 0.0635f );
+        }
+        else if (strstr(device_id, "OVR0001"))
+        {   // DK1
+            hmdCreateDesc.SetScreenParameters(mx, my, mwidth, mheight, 0.14976f, 0.0936f, 0.0936f*0.5f, 0.0635f);
+        }
+        else if (strstr(device_id, "OVR00"))
+        {   // Future Oculus HMD devices (default to DK1 dimensions)
+            hmdCreateDesc.SetScreenParameters(mx, my, mwidth, mheight, 0.14976f, 0.0936f, 0.0936f*0.5f, 0.0635f);
+        }
+        else
+        {   // Duct-tape prototype
+            hmdCreateDesc.SetScreenParameters(mx, my, mwidth, mheight, 0.12096f, 0.0756f, 0.0756f*0.5f, 0.0635f);
+        }
+
+        // Notify caller about detected device. This will call EnumerateAddDevice
+        // if the this is the first time device was detected.
+        visitor.Visit(hmdCreateDesc);
+    }
 
     // Real HMD device is not found; however, we still may have a 'fake' HMD
     // device created via SensorDeviceImpl::EnumerateHMDFromSensorDisplayInfo.
     // Need to find it and set 'Enumerated' to true to avoid Removal notification.
-    if (!foundHMD)
+    if (!HMDFound)
     {
         Ptr<DeviceCreateDesc> hmdDevDesc = getManager()->FindDevice("", Device_HMD);
         if (hmdDevDesc)
@@ -30,6 +30,9 @@ limitations under the License.
 #include "OVR_Linux_DeviceManager.h"
 #include "OVR_Profile.h"
 
+// Xlib's Display, without including Xlib here.
+struct _XDisplay;
+
 namespace OVR { namespace Linux {
 
 class HMDDevice;
@@ -39,17 +42,44 @@ class HMDDevice;
 // HMDDeviceFactory enumerates attached Oculus HMD devices.
 //
 // This is currently done by matching monitor device strings.
+//
+// The X connection is kept open between enumerations and subscribed to RandR
+// change events, so the outputs are only scanned again after the server reports
+// that the screen configuration changed.
 
 class HMDDeviceFactory : public DeviceFactory
 {
 public:
+    HMDDeviceFactory();
+
     static HMDDeviceFactory &GetInstance();
 
     // Enumerates devices, creating and destroying relevant objects in manager.
     virtual void EnumerateDevices(EnumerateVisitor& visitor);
 
+    // Closes the X connection.
+    virtual void RemovedFromManager();
+
 protected:
     DeviceManager* getManager() const { return (DeviceManager*) pManager; }
+
+    bool        openDisplay();
+    // Consumes pending RandR events; returns true if the outputs may have changed.
+    bool        displaysChanged();
+    // Looks for an Oculus display among the current outputs.
+    void        scanDisplays();
+
+    _XDisplay*  pDisplay;
+    // First RandR event type, or -1 if the server has no RandR, in which case
+    // the outputs are scanned by every enumeration.
+    int         RREventBase;
+    bool        DisplaysKnown;
+
+    // The Oculus display found by the last scan.
+    bool        HMDFound;
+    String      HMDDeviceId;
+    long        HMDDisplayIndex;
+    int         HMDX, HMDY;
 };
 
 
@@ -135,6 +165,7 @@ public:
     virtual Profile*    GetProfile();
     virtual const char* GetProfileName();
     virtual bool        SetProfileName(const char* name);
+    virtual void        ReloadProfile();
 
     // Query associated sensor.
     virtual OVR::SensorDevice* GetSensor();  
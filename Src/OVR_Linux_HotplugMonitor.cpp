@@ -0,0 +1,314 @@
+/************************************************************************************
+
+Filename    :   OVR_Linux_HotplugMonitor.cpp
+Content     :   Watches for hidraw devices being added and removed
+Created     :   October 14, 2026
+Notes       :
+
+Copyright   :   Copyright 2014 Oculus VR, Inc. All Rights reserved.
+
+Licensed under the Oculus VR Rift SDK License Version 3.1 (the "License");
+you may not use the Oculus VR Rift SDK except in compliance with the License,
+which is provided at the time of installation or download, or which
+otherwise accompanies this software in either electronic or hard copy form.
+
+You may obtain a copy of the License at
+
+http://www.oculusvr.com/licenses/LICENSE-3.1
+
+Unless required by applicable law or agreed to in writing, the Oculus VR SDK
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+*************************************************************************************/
+
+#include "OVR_Linux_HotplugMonitor.h"
+#include "OVR_Linux_HIDDevice.h"
+#include "Kernel/OVR_Log.h"
+
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <string.h>
+#include <poll.h>
+#include <sys/stat.h>
+
+#if defined(__FreeBSD__)
+#include <sys/socket.h>
+#include <sys/un.h>
+#else
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#endif
+
+namespace OVR { namespace Linux {
+
+#if defined(__FreeBSD__)
+// devd passes events to any number of readers through this socket.
+static const char* DevdSocketPath = "/var/run/devd.seqpacket.pipe";
+
+// Finds "key=value" in a devd event and copies the value; returns false if absent.
+static bool getDevdField(const char* event, const char* key, char* value, UPInt size)
+{
+    UPInt       keyLength = strlen(key);
+    const char* p         = event;
+    while ((p = strstr(p, key)) != NULL)
+    {
+        bool start = (p == event) || p[-1] == ' ' || p[-1] == '!';
+        p += keyLength;
+        if (start && *p == '=')
+        {
+            p++;
+            UPInt length = strcspn(p, " \n");
+            if (length >= size)
+                return false;
+            memcpy(value, p, length);
+            value[length] = 0;
+            return true;
+        }
+    }
+    return false;
+}
+#endif
+
+HotplugMonitor::HotplugMonitor(HIDDeviceManager* manager)
+  : Thread(64 * 1024), pManager(manager), Udev(NULL),
+#if defined(__FreeBSD__)
+    DevdFd(-1),
+#else
+    Monitor(NULL),
+#endif
+    EventFd(-1), Monitoring(false)
+{
+    WakeFds[0] = WakeFds[1] = -1;
+}
+
+HotplugMonitor::~HotplugMonitor()
+{
+    OVR_ASSERT(EventFd < 0);
+}
+
+bool HotplugMonitor::StartMonitoring()
+{
+    Udev = udev_new();
+    if (!Udev || pipe(WakeFds) != 0)
+    {
+        closeSource();
+        return false;
+    }
+
+#if defined(__FreeBSD__)
+    DevdFd = socket(PF_LOCAL, SOCK_SEQPACKET, 0);
+    sockaddr_un address;
+    memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    strncpy(address.sun_path, DevdSocketPath, sizeof(address.sun_path) - 1);
+    if (DevdFd < 0 || connect(DevdFd, (sockaddr*)&address, sizeof(address)) != 0)
+    {
+        LogText("OVR::Linux::HotplugMonitor - devd is not running; hot-plug notifications are not available.\n");
+        closeSource();
+        return false;
+    }
+    EventFd = DevdFd;
+#else
+    // Create a udev_monitor handle to watch for device changes (hot-plug detection)
+    Monitor = udev_monitor_new_from_netlink(Udev, "udev");
+    if (Monitor)
+    {
+        udev_monitor_filter_add_match_subsystem_devtype(Monitor, "hidraw", NULL);  // filter for hidraw only
+        if (udev_monitor_enable_receiving(Monitor) == 0)
+            EventFd = udev_monitor_get_fd(Monitor);
+    }
+    if (EventFd < 0)
+    {
+        closeSource();
+        return false;
+    }
+#endif
+
+    Monitoring = true;
+    if (!Start())
+    {
+        Monitoring = false;
+        closeSource();
+        return false;
+    }
+    return true;
+}
+
+void HotplugMonitor::StopMonitoring()
+{
+    if (EventFd < 0)
+        return;
+
+    Monitoring = false;
+    char wake = 0;
+    while (write(WakeFds[1], &wake, 1) < 0 && errno == EINTR)
+        ;
+    Stopped.Wait();
+    closeSource();
+}
+
+void HotplugMonitor::closeSource()
+{
+#if defined(__FreeBSD__)
+    if (DevdFd >= 0)
+        close(DevdFd);
+    DevdFd = -1;
+#else
+    // The monitor owns its descriptor.
+    if (Monitor)
+        udev_monitor_unref(Monitor);
+    Monitor = NULL;
+#endif
+    EventFd = -1;
+
+    for (int i = 0; i < 2; i++)
+    {
+        if (WakeFds[i] >= 0)
+            close(WakeFds[i]);
+        WakeFds[i] = -1;
+    }
+
+    if (Udev)
+        udev_unref(Udev);
+    Udev = NULL;
+}
+
+int HotplugMonitor::Run()
+{
+    SetThreadName("OVR::HotplugMonitor");
+#if !defined(__FreeBSD__)
+    // Niceness is per thread on Linux.
+    setpriority(PRIO_PROCESS, (id_t)syscall(SYS_gettid), 10);
+#endif
+
+    pollfd fds[2];
+    fds[0].fd     = EventFd;
+    fds[0].events = POLLIN;
+    fds[1].fd     = WakeFds[0];
+    fds[1].events = POLLIN;
+
+    while (true)
+    {
+        fds[0].revents = fds[1].revents = 0;
+        if (poll(fds, 2, -1) < 0)
+        {
+            if (errno == EINTR)
+                continue;
+            break;
+        }
+        if (fds[1].revents)
+            break;
+
+        // Otherwise the source went away, such as devd exiting.
+        if (!(fds[0].revents & POLLIN) || !readEvent())
+            break;
+    }
+
+    if (Monitoring)
+    {
+        // Unless stopped, later changes won't be seen.
+        Monitoring = false;
+        pManager->QueueHotplugRescan();
+    }
+    Stopped.SetEvent();
+    return 0;
+}
+
+#if defined(__FreeBSD__)
+
+bool HotplugMonitor::readEvent()
+{
+    // An event is one line of fields, such as
+    // "!system=DEVFS subsystem=CDEV type=CREATE cdev=hidraw0".
+    char    event[1024];
+    ssize_t length = recv(DevdFd, event, sizeof(event) - 1, 0);
+    if (length <= 0)
+    {
+        // Unless interrupted, devd has exited.
+        return length < 0 && errno == EINTR;
+    }
+    event[length] = 0;
+
+    char system[16], subsystem[16], type[16], cdev[64];
+    if (!getDevdField(event, "system", system, sizeof(system)) || strcmp(system, "DEVFS") != 0 ||
+        !getDevdField(event, "subsystem", subsystem, sizeof(subsystem)) || strcmp(subsystem, "CDEV") != 0 ||
+        !getDevdField(event, "type", type, sizeof(type)) ||
+        !getDevdField(event, "cdev", cdev, sizeof(cdev)) || strncmp(cdev, "hidraw", 6) != 0)
+    {
+        return true;
+    }
+
+    HIDDeviceDesc device_info;
+    device_info.Path = String("/dev/") + cdev;
+
+    if (strcmp(type, "CREATE") == 0)
+    {
+        struct stat st;
+        udev_device* hid = (stat(device_info.Path.ToCStr(), &st) == 0) ?
+                           udev_device_new_from_devnum(Udev, 'c', st.st_rdev) : NULL;
+        // Get the USB device; it belongs to hid.
+        udev_device* usb = hid ? udev_device_get_parent_with_subsystem_devtype(hid, "usb", "usb_device") : NULL;
+        if (usb)
+        {
+            HIDDeviceManager::getFullDesc(usb, &device_info);
+            pManager->QueueHotplugEvent(Message_DeviceAdded, device_info);
+        }
+        if (hid)
+            udev_device_unref(hid);
+    }
+    else if (strcmp(type, "DESTROY") == 0)
+    {
+        pManager->QueueHotplugEvent(Message_DeviceRemoved, device_info);
+    }
+    return true;
+}
+
+#else
+
+bool HotplugMonitor::readEvent()
+{
+    // There is a device status change
+    udev_device* hid = udev_monitor_receive_device(Monitor);
+    if (!hid)
+    {
+        // The event may have been lost (for example if the socket overflowed),
+        // so the device list can no longer be trusted.
+        pManager->QueueHotplugRescan();
+        return true;
+    }
+
+    const char* dev_path = udev_device_get_devnode(hid);
+    const char* action   = udev_device_get_action(hid);
+
+    HIDDeviceDesc device_info;
+    device_info.Path = dev_path;
+
+    if (OVR_strcmp(action, "add") == 0)
+    {
+        // Retrieve the device info.  This can only be done on a connected
+        // device and is invalid for a disconnected device
+
+        // Get the USB device; it belongs to hid.
+        udev_device* usb = udev_device_get_parent_with_subsystem_devtype(hid, "usb", "usb_device");
+        if (usb && dev_path)
+        {
+            HIDDeviceManager::getFullDesc(usb, &device_info);
+            pManager->QueueHotplugEvent(Message_DeviceAdded, device_info);
+        }
+    }
+    else if (OVR_strcmp(action, "remove") == 0)
+    {
+        pManager->QueueHotplugEvent(Message_DeviceRemoved, device_info);
+    }
+
+    udev_device_unref(hid);
+    return true;
+}
+
+#endif
+
+}} // namespace OVR::Linux
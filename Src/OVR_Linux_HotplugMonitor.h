@@ -0,0 +1,91 @@
+/************************************************************************************
+
+Filename    :   OVR_Linux_HotplugMonitor.h
+Content     :   Watches for hidraw devices being added and removed
+Created     :   October 14, 2026
+Notes       :
+
+Copyright   :   Copyright 2014 Oculus VR, Inc. All Rights reserved.
+
+Licensed under the Oculus VR Rift SDK License Version 3.1 (the "License");
+you may not use the Oculus VR Rift SDK except in compliance with the License,
+which is provided at the time of installation or download, or which
+otherwise accompanies this software in either electronic or hard copy form.
+
+You may obtain a copy of the License at
+
+http://www.oculusvr.com/licenses/LICENSE-3.1
+
+Unless required by applicable law or agreed to in writing, the Oculus VR SDK
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+*************************************************************************************/
+
+#ifndef OVR_Linux_HotplugMonitor_h
+#define OVR_Linux_HotplugMonitor_h
+
+#include "Kernel/OVR_Threads.h"
+#include <libudev.h>
+
+namespace OVR { namespace Linux {
+
+class HIDDeviceManager;
+
+//-------------------------------------------------------------------------------------
+// ***** HotplugMonitor
+
+// HotplugMonitor waits for hidraw devices to come and go on a thread of its own,
+// from a udev monitor on Linux and from devd on FreeBSD, and reads the descriptor
+// of each device added there, so that a burst of events doesn't hold up the
+// device manager thread. The finished descriptors are queued to the
+// HIDDeviceManager, which handles them on the manager thread.
+//
+// The thread runs at a lower priority than the application where the OS allows
+// it for a single thread (Linux).
+
+class HotplugMonitor : public Thread
+{
+public:
+    HotplugMonitor(HIDDeviceManager* manager);
+    ~HotplugMonitor();
+
+    // Opens the event source, so that events from now on are delivered, and
+    // starts the thread. Returns false if hotplug events can't be received.
+    bool        StartMonitoring();
+    // Stops the thread; no events are queued once it returns.
+    void        StopMonitoring();
+
+    // False once events may go missing, such as when devd exits.
+    bool        IsMonitoring() const { return Monitoring; }
+
+    virtual int Run();
+
+private:
+    // Reads one event and queues what it reports to the manager; returns false
+    // once the source is gone.
+    bool        readEvent();
+    void        closeSource();
+
+    HIDDeviceManager*   pManager;
+    // Used on the monitor thread only; udev objects can't be shared between threads.
+    udev*               Udev;
+#if defined(__FreeBSD__)
+    // The devd event socket.
+    int                 DevdFd;
+#else
+    udev_monitor*       Monitor;
+#endif
+    // The descriptor polled for events.
+    int                 EventFd;
+    // Written to by StopMonitoring to wake the thread.
+    int                 WakeFds[2];
+    volatile bool       Monitoring;
+    Event               Stopped;
+};
+
+}} // namespace OVR::Linux
+
+#endif // OVR_Linux_HotplugMonitor_h
@@ -0,0 +1,1011 @@
+/************************************************************************************
+Filename    :   OVR_Linux_LibUSBHIDDevice.cpp
+Content     :   HID device implementation on libusb interrupt transfers.
+Created     :   October 14, 2026
+
+Copyright   :   Copyright 2014 Oculus VR, Inc. All Rights reserved.
+
+Licensed under the Oculus VR Rift SDK License Version 3.1 (the "License");
+you may not use the Oculus VR Rift SDK except in compliance with the License,
+which is provided at the time of installation or download, or which
+otherwise accompanies this software in either electronic or hard copy form.
+
+You may obtain a copy of the License at
+
+http://www.oculusvr.com/licenses/LICENSE-3.1
+
+Unless required by applicable law or agreed to in writing, the Oculus VR SDK
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+*************************************************************************************/
+
+#include "OVR_Linux_LibUSBHIDDevice.h"
+
+#ifdef OVR_USE_LIBUSB
+
+#include "OVR_HIDDeviceImpl.h"
+#include "Kernel/OVR_Log.h"
+#include "Kernel/OVR_Std.h"
+#include "Kernel/OVR_Timer.h"
+#include <poll.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+namespace OVR { namespace Linux {
+
+// HID class requests and report type (HID 1.11, section 7.2).
+enum
+{
+    HID_GetReport       = 0x01,
+    HID_SetReport       = 0x09,
+    HID_ReportFeature   = 3
+};
+
+// Number of 100 ms waits closeDevice allows for cancelled transfers to complete.
+static const int CancelWaitCount = 20;
+
+//-------------------------------------------------------------------------------------
+// **** Linux::LibUSBHIDDeviceManager
+//-----------------------------------------------------------------------------
+LibUSBHIDDeviceManager::LibUSBHIDDeviceManager(DeviceManager* manager)
+  : DevManager(manager), Context(NULL), HasHotplug(false), HotplugHandle(0),
+    Delivering(false), HotplugQueued(false)
+{
+}
+
+//-----------------------------------------------------------------------------
+LibUSBHIDDeviceManager::~LibUSBHIDDeviceManager()
+{
+    // The device thread may be gone by now, so only release libusb itself.
+    if (Context)
+    {
+        if (HasHotplug)
+            libusb_hotplug_deregister_callback(Context, HotplugHandle);
+        for (UPInt i = 0; i < HotplugEvents.GetSize(); i++)
+            libusb_unref_device(HotplugEvents[i].pDevice);
+        libusb_exit(Context);
+    }
+}
+
+//-----------------------------------------------------------------------------
+bool LibUSBHIDDeviceManager::Initialize()
+{
+    int r = libusb_init(&Context);
+    if (r != LIBUSB_SUCCESS)
+    {
+        LogError("OVR::Linux::LibUSBHIDDeviceManager - Failed to initialize libusb (%s).\n",
+                 libusb_error_name(r));
+        Context = NULL;
+        return false;
+    }
+
+    // Watch the descriptors libusb has open, and those it opens from now on, on
+    // the device thread. Set the notifiers first so that none are missed.
+    libusb_set_pollfd_notifiers(Context, pollfdAdded, pollfdRemoved, this);
+    const libusb_pollfd** pollfds = libusb_get_pollfds(Context);
+    if (!pollfds)
+    {
+        LogError("OVR::Linux::LibUSBHIDDeviceManager - libusb can't be polled on this platform.\n");
+        libusb_set_pollfd_notifiers(Context, NULL, NULL, NULL);
+        libusb_exit(Context);
+        Context = NULL;
+        return false;
+    }
+    for (int i = 0; pollfds[i]; i++)
+    {
+        pollfdAdded(pollfds[i]->fd, pollfds[i]->events, this);
+    }
+    free(pollfds);
+
+    // Without a timer descriptor, libusb's timeouts are serviced from OnTicks.
+    if (!libusb_pollfds_handle_timeouts(Context))
+    {
+        DevManager->pThread->AddTicksNotifier(this);
+    }
+
+    HasHotplug = libusb_has_capability(LIBUSB_CAP_HAS_HOTPLUG) &&
+                 libusb_hotplug_register_callback(Context,
+                        LIBUSB_HOTPLUG_EVENT_DEVICE_ARRIVED | LIBUSB_HOTPLUG_EVENT_DEVICE_LEFT,
+                        LIBUSB_HOTPLUG_NO_FLAGS,
+                        LIBUSB_HOTPLUG_MATCH_ANY, LIBUSB_HOTPLUG_MATCH_ANY, LIBUSB_HOTPLUG_MATCH_ANY,
+                        hotplugCallback, this, &HotplugHandle) == LIBUSB_SUCCESS;
+    if (!HasHotplug)
+    {
+        LogText("OVR::Linux::LibUSBHIDDeviceManager - hot-plug notifications are not available.\n");
+    }
+
+    LogText("OVR::Linux::LibUSBHIDDeviceManager - initialized.\n");
+    return true;
+}
+
+//-----------------------------------------------------------------------------
+void LibUSBHIDDeviceManager::Shutdown()
+{
+    OVR_ASSERT_LOG((Context), ("Should have called 'Initialize' before 'Shutdown'."));
+
+    if (HasHotplug)
+    {
+        libusb_hotplug_deregister_callback(Context, HotplugHandle);
+        HasHotplug = false;
+    }
+
+    {
+        Lock::Locker lock(&HotplugLock);
+        for (UPInt i = 0; i < HotplugEvents.GetSize(); i++)
+            libusb_unref_device(HotplugEvents[i].pDevice);
+        HotplugEvents.Clear();
+    }
+
+    libusb_set_pollfd_notifiers(Context, NULL, NULL, NULL);
+    const libusb_pollfd** pollfds = libusb_get_pollfds(Context);
+    for (int i = 0; pollfds && pollfds[i]; i++)
+    {
+        pollfdRemoved(pollfds[i]->fd, this);
+    }
+    free(pollfds);
+    DevManager->pThread->RemoveTicksNotifier(this);
+
+    libusb_exit(Context);  // release the library
+    Context = NULL;
+
+    LogText("OVR::Linux::LibUSBHIDDeviceManager - shutting down.\n");
+}
+
+//-----------------------------------------------------------------------------
+void LibUSBHIDDeviceManager::pollfdAdded(int fd, short events, void* userData)
+{
+    LibUSBHIDDeviceManager* manager = (LibUSBHIDDeviceManager*)userData;
+
+    // libusb looks at errors itself; on Linux a device's completions and its
+    // disconnection are both signalled on its descriptor.
+    int loopEvents = EventLoop::Event_Error;
+    if (events & POLLIN)
+        loopEvents |= EventLoop::Event_Read;
+    if (events & POLLOUT)
+        loopEvents |= EventLoop::Event_Write;
+
+    if (!manager->DevManager->pThread->AddSelectFd(manager, fd, loopEvents))
+    {
+        LogError("OVR::Linux::LibUSBHIDDeviceManager - Failed to watch libusb fd %d.\n", fd);
+    }
+}
+
+void LibUSBHIDDeviceManager::pollfdRemoved(int fd, void* userData)
+{
+    LibUSBHIDDeviceManager* manager = (LibUSBHIDDeviceManager*)userData;
+    manager->DevManager->pThread->RemoveSelectFd(manager, fd);
+}
+
+//-----------------------------------------------------------------------------
+void LibUSBHIDDeviceManager::OnEvent(int i, int fd)
+{
+    OVR_UNUSED2(i, fd);
+    handleEvents();
+}
+
+//-----------------------------------------------------------------------------
+double LibUSBHIDDeviceManager::OnTicks(double tickSeconds)
+{
+    handleEvents();
+
+    timeval timeout;
+    if (libusb_get_next_timeout(Context, &timeout) == 1)
+    {
+        return timeout.tv_sec + timeout.tv_usec * 0.000001;
+    }
+    return DeviceManagerThread::Notifier::OnTicks(tickSeconds);
+}
+
+//-----------------------------------------------------------------------------
+void LibUSBHIDDeviceManager::handleEvents()
+{
+    timeval zero = { 0, 0 };
+    libusb_handle_events_timeout_completed(Context, &zero, NULL);
+    deliverReports();
+}
+
+//-----------------------------------------------------------------------------
+void LibUSBHIDDeviceManager::deliverReports()
+{
+    // A handler making a control transfer brings us back here; the outer call
+    // delivers whatever that transfer completed.
+    if (Delivering)
+    {
+        return;
+    }
+
+    Delivering = true;
+    for (UPInt i = 0; i < NotificationDevices.GetSize(); i++)
+    {
+        NotificationDevices[i]->deliverCompleted();
+    }
+    Delivering = false;
+
+    for (UPInt i = 0; i < NotificationDevices.GetSize(); i++)
+    {
+        LibUSBHIDDevice* device = NotificationDevices[i];
+        if (device->IOError && device->DeviceHandle)
+        {
+            device->closeDeviceOnIOError();
+        }
+    }
+}
+
+//-----------------------------------------------------------------------------
+int LibUSBHIDDeviceManager::controlTransfer(libusb_device_handle* handle,
+                                            UByte requestType, UByte request,
+                                            UInt16 value, UInt16 index,
+                                            UByte* data, UInt16 length)
+{
+    int r = libusb_control_transfer(handle, requestType, request, value, index,
+                                    data, length, LibUSBHIDDevice::ControlTimeoutMs);
+    // Waiting for the transfer ran libusb's event handling.
+    deliverReports();
+
+    if (r < 0)
+    {
+        OVR_DEBUG_LOG(("OVR::Linux::LibUSBHIDDeviceManager - Control transfer failed (%s).",
+                       libusb_error_name(r)));
+    }
+    return r;
+}
+
+//-------------------------------------------------------------------------------
+bool LibUSBHIDDeviceManager::AddNotificationDevice(LibUSBHIDDevice* device)
+{
+    NotificationDevices.PushBack(device);
+    return true;
+}
+
+//-------------------------------------------------------------------------------
+bool LibUSBHIDDeviceManager::RemoveNotificationDevice(LibUSBHIDDevice* device)
+{
+    for (UPInt i = 0; i < NotificationDevices.GetSize(); i++)
+    {
+        if (NotificationDevices[i] == device)
+        {
+            NotificationDevices.RemoveAt(i);
+            return true;
+        }
+    }
+    return false;
+}
+
+//-----------------------------------------------------------------------------
+void LibUSBHIDDeviceManager::getPath(libusb_device* device, String* pPath)
+{
+    // Bus and address stay readable after the device is unplugged, so removal
+    // can be matched by path as it is for hidraw.
+    char path[32];
+    OVR_sprintf(path, sizeof(path), "libusb:%03d:%03d",
+                (int)libusb_get_bus_number(device), (int)libusb_get_device_address(device));
+    *pPath = path;
+}
+
+//-----------------------------------------------------------------------------
+libusb_device* LibUSBHIDDeviceManager::findDevice(const char* dev_path)
+{
+    libusb_device** list;
+    ssize_t count = libusb_get_device_list(Context, &list);
+    if (count < 0)
+    {
+        return NULL;
+    }
+
+    libusb_device* found = NULL;
+    for (ssize_t i = 0; i < count && !found; i++)
+    {
+        String path;
+        getPath(list[i], &path);
+        if (path == dev_path)
+        {
+            found = libusb_ref_device(list[i]);
+        }
+    }
+
+    libusb_free_device_list(list, 1);
+    return found;
+}
+
+//-----------------------------------------------------------------------------
+bool LibUSBHIDDeviceManager::getHIDInterface(libusb_device* device, int* pInterface,
+                                             UByte* pEndpoint, int* pPacketSize)
+{
+    libusb_config_descriptor* config;
+    if (libusb_get_active_config_descriptor(device, &config) != LIBUSB_SUCCESS)
+    {
+        return false;
+    }
+
+    // Use the first HID interface with an interrupt IN endpoint.
+    bool found = false;
+    for (int i = 0; i < config->bNumInterfaces && !found; i++)
+    {
+        if (config->interface[i].num_altsetting < 1)
+            continue;
+
+        const libusb_interface_descriptor* intf = &config->interface[i].altsetting[0];
+        if (intf->bInterfaceClass != LIBUSB_CLASS_HID)
+            continue;
+
+        for (int e = 0; e < intf->bNumEndpoints && !found; e++)
+        {
+            const libusb_endpoint_descriptor* ep = &intf->endpoint[e];
+            if ((ep->bEndpointAddress & LIBUSB_ENDPOINT_DIR_MASK) == LIBUSB_ENDPOINT_IN &&
+                (ep->bmAttributes & LIBUSB_TRANSFER_TYPE_MASK) == LIBUSB_TRANSFER_TYPE_INTERRUPT)
+            {
+                *pInterface  = intf->bInterfaceNumber;
+                *pEndpoint   = ep->bEndpointAddress;
+                *pPacketSize = ep->wMaxPacketSize;
+                found = true;
+            }
+        }
+    }
+
+    libusb_free_config_descriptor(config);
+    return found;
+}
+
+//-----------------------------------------------------------------------------
+bool LibUSBHIDDeviceManager::getFullDesc(libusb_device* device, HIDDeviceDesc* desc)
+{
+    libusb_device_descriptor deviceDesc;
+    if (libusb_get_device_descriptor(device, &deviceDesc) != LIBUSB_SUCCESS)
+    {
+        return false;
+    }
+
+    int   interfaceNumber, packetSize;
+    UByte endpoint;
+    if (!getHIDInterface(device, &interfaceNumber, &endpoint, &packetSize))
+    {
+        return false;
+    }
+
+    desc->VendorId      = deviceDesc.idVendor;
+    desc->ProductId     = deviceDesc.idProduct;
+    desc->VersionNumber = deviceDesc.bcdDevice;
+    desc->Usage         = 0;
+    desc->UsagePage     = 0;
+    getPath(device, &desc->Path);
+
+    // The strings have to be read from the device itself.
+    libusb_device_handle* handle;
+    if (libusb_open(device, &handle) != LIBUSB_SUCCESS)
+    {
+        return false;
+    }
+
+    unsigned char str[256];
+    bool          success = false;
+    if (deviceDesc.iSerialNumber &&
+        libusb_get_string_descriptor_ascii(handle, deviceDesc.iSerialNumber, str, sizeof(str)) >= 0)
+    {
+        desc->SerialNumber = (const char*)str;
+        success = true;
+    }
+    if (deviceDesc.iManufacturer &&
+        libusb_get_string_descriptor_ascii(handle, deviceDesc.iManufacturer, str, sizeof(str)) >= 0)
+    {
+        desc->Manufacturer = (const char*)str;
+    }
+    if (deviceDesc.iProduct &&
+        libusb_get_string_descriptor_ascii(handle, deviceDesc.iProduct, str, sizeof(str)) >= 0)
+    {
+        desc->Product = (const char*)str;
+    }
+
+    libusb_close(handle);
+    return success;
+}
+
+//-----------------------------------------------------------------------------
+bool LibUSBHIDDeviceManager::openInterface(libusb_device* device, int interfaceNumber,
+                                           libusb_device_handle** pHandle, bool* pDetached)
+{
+    int r = libusb_open(device, pHandle);
+    if (r != LIBUSB_SUCCESS)
+    {
+        OVR_DEBUG_LOG(("Failed 'libusb_open' while opening device, error = %s.", libusb_error_name(r)));
+        return false;
+    }
+
+    // Take the interface over from the kernel HID driver; it is given back on close.
+    *pDetached = false;
+    if (libusb_kernel_driver_active(*pHandle, interfaceNumber) == 1)
+    {
+        *pDetached = (libusb_detach_kernel_driver(*pHandle, interfaceNumber) == LIBUSB_SUCCESS);
+    }
+
+    r = libusb_claim_interface(*pHandle, interfaceNumber);
+    if (r != LIBUSB_SUCCESS)
+    {
+        OVR_DEBUG_LOG(("Failed to claim HID interface %d, error = %s.", interfaceNumber, libusb_error_name(r)));
+        closeInterface(*pHandle, -1, false);
+        *pHandle = NULL;
+        return false;
+    }
+    return true;
+}
+
+void LibUSBHIDDeviceManager::closeInterface(libusb_device_handle* handle, int interfaceNumber, bool detached)
+{
+    if (interfaceNumber >= 0)
+    {
+        libusb_release_interface(handle, interfaceNumber);
+        if (detached)
+        {
+            libusb_attach_kernel_driver(handle, interfaceNumber);
+        }
+    }
+    libusb_close(handle);
+}
+
+//-----------------------------------------------------------------------------
+bool LibUSBHIDDeviceManager::Enumerate(HIDEnumerateVisitor* enumVisitor)
+{
+    libusb_device** list;
+    ssize_t count = libusb_get_device_list(Context, &list);
+    if (count < 0)
+    {
+        return false;
+    }
+
+    // Search each device for the matching vid/pid
+    for (ssize_t i = 0; i < count; i++)
+    {
+        libusb_device_descriptor deviceDesc;
+        if (libusb_get_device_descriptor(list[i], &deviceDesc) != LIBUSB_SUCCESS ||
+            !enumVisitor->MatchVendorProduct(deviceDesc.idVendor, deviceDesc.idProduct))
+        {
+            continue;
+        }
+
+        HIDDeviceDesc devDesc;
+        if (!getFullDesc(list[i], &devDesc))
+        {
+            continue;
+        }
+
+        // Look for the device to check if it is already opened.
+        Ptr<DeviceCreateDesc> existingDevice = DevManager->FindHIDDevice(devDesc, true);
+        // if device exists and it is opened then most likely the device open()
+        // will fail; therefore, we just set Enumerated to 'true' and continue.
+        if (existingDevice && existingDevice->pDevice)
+        {
+            existingDevice->Enumerated = true;
+            continue;
+        }
+
+        // open the device temporarily for startup communication
+        int                   interfaceNumber, packetSize;
+        UByte                 endpoint;
+        libusb_device_handle* handle;
+        bool                  detached;
+        if (getHIDInterface(list[i], &interfaceNumber, &endpoint, &packetSize) &&
+            openInterface(list[i], interfaceNumber, &handle, &detached))
+        {
+            // Construct minimal device that the visitor callback can get feature reports from
+            LibUSBHIDDevice device(this, handle, interfaceNumber);
+            enumVisitor->Visit(device, devDesc);
+
+            closeInterface(handle, interfaceNumber, detached);
+        }
+    }
+
+    libusb_free_device_list(list, 1);
+    return true;
+}
+
+//-----------------------------------------------------------------------------
+OVR::HIDDevice* LibUSBHIDDeviceManager::Open(const String& path)
+{
+    Ptr<Linux::LibUSBHIDDevice> device = *new Linux::LibUSBHIDDevice(this);
+
+    if (device->HIDInitialize(path))
+    {
+        device->AddRef();
+        return device;
+    }
+
+    return NULL;
+}
+
+//-----------------------------------------------------------------------------
+int LibUSBHIDDeviceManager::hotplugCallback(libusb_context* context, libusb_device* device,
+                                            libusb_hotplug_event event, void* userData)
+{
+    OVR_UNUSED(context);
+    LibUSBHIDDeviceManager* manager = (LibUSBHIDDeviceManager*)userData;
+
+    HotplugEvent hotplugEvent;
+    hotplugEvent.pDevice = libusb_ref_device(device);
+    hotplugEvent.Event   = event;
+
+    bool queueCall;
+    {
+        Lock::Locker lock(&manager->HotplugLock);
+        manager->HotplugEvents.PushBack(hotplugEvent);
+        queueCall = !manager->HotplugQueued;
+        manager->HotplugQueued = true;
+    }
+
+    // The queued call keeps the manager alive until it has run. Pushing can
+    // block, so it is done without holding the lock.
+    if (queueCall)
+    {
+        manager->AddRef();
+        if (!manager->DevManager->pThread->PushCall(manager, &LibUSBHIDDeviceManager::processHotplugEvents))
+        {
+            {
+                Lock::Locker lock(&manager->HotplugLock);
+                manager->HotplugQueued = false;
+            }
+            manager->Release();
+        }
+    }
+
+    // Stay registered.
+    return 0;
+}
+
+//-----------------------------------------------------------------------------
+Void LibUSBHIDDeviceManager::processHotplugEvents()
+{
+    Array<HotplugEvent> events;
+    {
+        Lock::Locker lock(&HotplugLock);
+        events = HotplugEvents;
+        HotplugEvents.Clear();
+        HotplugQueued = false;
+    }
+
+    for (UPInt e = 0; e < events.GetSize(); e++)
+    {
+        libusb_device* hid = events[e].pDevice;
+
+        HIDDeviceDesc device_info;
+        MessageType   notify_type;
+        bool          valid;
+        if (events[e].Event == LIBUSB_HOTPLUG_EVENT_DEVICE_ARRIVED)
+        {
+            notify_type = Message_DeviceAdded;
+
+            // Retrieve the device info.  This can only be done on a connected
+            // device and is invalid for a disconnected device
+            valid = getFullDesc(hid, &device_info);
+        }
+        else
+        {
+            notify_type = Message_DeviceRemoved;
+            getPath(hid, &device_info.Path);
+            valid = true;
+        }
+
+        if (valid)
+        {
+            bool error = false;
+            bool deviceFound = false;
+            for (UPInt i = 0; i < NotificationDevices.GetSize(); i++)
+            {
+                if (NotificationDevices[i] &&
+                    NotificationDevices[i]->OnDeviceNotification(notify_type, &device_info, &error))
+                {
+                    // The notification was for an existing device
+                    deviceFound = true;
+                    break;
+                }
+            }
+
+            if (notify_type == Message_DeviceAdded && !deviceFound)
+            {
+                DevManager->DetectHIDDevice(device_info);
+            }
+        }
+
+        libusb_unref_device(hid);
+    }
+
+    Release();
+    return 0;
+}
+
+//-----------------------------------------------------------------------------
+LibUSBHIDDeviceManager* LibUSBHIDDeviceManager::CreateInternal(Linux::DeviceManager* devManager)
+{
+    if (!System::IsInitialized())
+    {
+        // Use custom message, since Log is not yet installed.
+        OVR_DEBUG_STATEMENT(Log::GetDefaultLog()->
+                            LogMessage(Log_Debug, "LibUSBHIDDeviceManager::Create failed - OVR::System not initialized"); );
+        return 0;
+    }
+
+    Ptr<Linux::LibUSBHIDDeviceManager> manager = *new Linux::LibUSBHIDDeviceManager(devManager);
+
+    if (manager)
+    {
+        if (manager->Initialize())
+        {
+            manager->AddRef();
+        }
+        else
+        {
+            manager.Clear();
+        }
+    }
+
+    return manager.GetPtr();
+}
+
+
+//=============================================================================
+//                           Linux::LibUSBHIDDevice
+//=============================================================================
+LibUSBHIDDevice::LibUSBHIDDevice(LibUSBHIDDeviceManager* manager)
+ :  InMinimalMode(false), HIDManager(manager), DeviceHandle(NULL),
+    InterfaceNumber(-1), InputEndpoint(0), InputReportLength(0), KernelDriverDetached(false),
+    PendingCount(0), CompletedCount(0), Closing(false), IOError(false)
+{
+    memset(Transfers, 0, sizeof(Transfers));
+}
+
+//-----------------------------------------------------------------------------
+// This is a minimal constructor used during enumeration for us to pass
+// a HIDDevice to the visit function (so that it can query feature reports).
+LibUSBHIDDevice::LibUSBHIDDevice(LibUSBHIDDeviceManager* manager,
+                                 libusb_device_handle* handle, int interfaceNumber)
+ :  InMinimalMode(true), HIDManager(manager), DeviceHandle(handle),
+    InterfaceNumber(interfaceNumber), InputEndpoint(0), InputReportLength(0), KernelDriverDetached(false),
+    PendingCount(0), CompletedCount(0), Closing(false), IOError(false)
+{
+    memset(Transfers, 0, sizeof(Transfers));
+}
+
+//-----------------------------------------------------------------------------
+LibUSBHIDDevice::~LibUSBHIDDevice()
+{
+    if (!InMinimalMode)
+    {
+        HIDShutdown();
+    }
+}
+
+//-----------------------------------------------------------------------------
+bool LibUSBHIDDevice::HIDInitialize(const String& path)
+{
+    const char* hid_path = path.ToCStr();
+    if (!openDevice(hid_path))
+    {
+        LogText("OVR::Linux::LibUSBHIDDevice - Failed to open HIDDevice: %s", hid_path);
+        return false;
+    }
+
+    HIDManager->DevManager->pThread->AddTicksNotifier(this);
+    HIDManager->AddNotificationDevice(this);
+
+    LogText("OVR::Linux::LibUSBHIDDevice - Opened '%s'\n"
+            "                    Manufacturer:'%s'  Product:'%s'  Serial#:'%s'\n",
+            DevDesc.Path.ToCStr(),
+            DevDesc.Manufacturer.ToCStr(), DevDesc.Product.ToCStr(),
+            DevDesc.SerialNumber.ToCStr());
+
+    return true;
+}
+
+//-----------------------------------------------------------------------------
+bool LibUSBHIDDevice::openDevice(const char* device_path)
+{
+    libusb_device* device = HIDManager->findDevice(device_path);
+    if (!device)
+    {
+        return false;
+    }
+
+    // First fill out the device descriptor, then take over the HID interface.
+    int  packetSize = 0;
+    bool opened     = HIDManager->getFullDesc(device, &DevDesc) &&
+                      LibUSBHIDDeviceManager::getHIDInterface(device, &InterfaceNumber,
+                                                              &InputEndpoint, &packetSize) &&
+                      LibUSBHIDDeviceManager::openInterface(device, InterfaceNumber,
+                                                            &DeviceHandle, &KernelDriverDetached);
+    libusb_unref_device(device);
+    if (!opened)
+    {
+        DeviceHandle = NULL;
+        return false;
+    }
+
+    // A transfer only completes on a short packet or a full buffer, so read one
+    // packet per transfer: reports are never merged.
+    InputReportLength = (packetSize > 0 && packetSize < ReadBufferSize) ? packetSize : (int)ReadBufferSize;
+
+    for (int i = 0; i < TransfersInFlight; i++)
+    {
+        Transfers[i] = libusb_alloc_transfer(0);
+        if (!Transfers[i])
+        {
+            break;
+        }
+        libusb_fill_interrupt_transfer(Transfers[i], DeviceHandle, InputEndpoint,
+                                       TransferBuffers[i], InputReportLength,
+                                       transferCallback, this, 0);
+        if (!submitTransfer(Transfers[i]))
+        {
+            break;
+        }
+    }
+
+    if (PendingCount < TransfersInFlight)
+    {
+        OVR_ASSERT_LOG(false, ("Failed to submit HID input transfers."));
+        closeDevice(false);
+        return false;
+    }
+
+    return true;
+}
+
+//-----------------------------------------------------------------------------
+void LibUSBHIDDevice::HIDShutdown()
+{
+    HIDManager->DevManager->pThread->RemoveTicksNotifier(this);
+    HIDManager->RemoveNotificationDevice(this);
+
+    if (DeviceHandle) // Device may already have been closed if unplugged.
+    {
+        closeDevice(false);
+    }
+
+    LogText("OVR::Linux::LibUSBHIDDevice - HIDShutdown '%s'\n", DevDesc.Path.ToCStr());
+}
+
+//-----------------------------------------------------------------------------
+void LibUSBHIDDevice::closeDevice(bool wasUnplugged)
+{
+    OVR_ASSERT(DeviceHandle);
+
+    // Transfers can only be freed once libusb has given them back.
+    Closing = true;
+    for (int i = 0; i < TransfersInFlight; i++)
+    {
+        if (Transfers[i])
+            libusb_cancel_transfer(Transfers[i]);
+    }
+    for (int wait = 0; PendingCount > 0 && wait < CancelWaitCount; wait++)
+    {
+        timeval timeout = { 0, 100000 };
+        if (libusb_handle_events_timeout_completed(HIDManager->Context, &timeout, NULL) < 0)
+            break;
+    }
+
+    if (PendingCount == 0)
+    {
+        for (int i = 0; i < TransfersInFlight; i++)
+        {
+            if (Transfers[i])
+                libusb_free_transfer(Transfers[i]);
+            Transfers[i] = NULL;
+        }
+    }
+    else
+    {   // Leaked rather than freed while libusb may still complete them.
+        LogError("OVR::Linux::LibUSBHIDDevice - %d transfers did not complete on '%s'.\n",
+                 PendingCount, DevDesc.Path.ToCStr());
+        memset(Transfers, 0, sizeof(Transfers));
+        PendingCount = 0;
+    }
+    CompletedCount = 0;
+
+    // There is no kernel driver to hand back to an unplugged device.
+    LibUSBHIDDeviceManager::closeInterface(DeviceHandle, InterfaceNumber,
+                                           KernelDriverDetached && !wasUnplugged);
+    DeviceHandle = NULL;
+    Closing      = false;
+    IOError      = false;
+
+    LogText("OVR::Linux::LibUSBHIDDevice - HID Device Closed '%s'\n", DevDesc.Path.ToCStr());
+}
+
+//-----------------------------------------------------------------------------
+void LibUSBHIDDevice::closeDeviceOnIOError()
+{
+    LogText("OVR::Linux::LibUSBHIDDevice - Lost connection to '%s'\n", DevDesc.Path.ToCStr());
+    closeDevice(false);
+}
+
+//-----------------------------------------------------------------------------
+bool LibUSBHIDDevice::submitTransfer(libusb_transfer* transfer)
+{
+    if (libusb_submit_transfer(transfer) != LIBUSB_SUCCESS)
+    {
+        return false;
+    }
+    PendingCount++;
+    return true;
+}
+
+//-----------------------------------------------------------------------------
+void LibUSBHIDDevice::transferCallback(libusb_transfer* transfer)
+{
+    ((LibUSBHIDDevice*)transfer->user_data)->onTransferComplete(transfer);
+}
+
+void LibUSBHIDDevice::onTransferComplete(libusb_transfer* transfer)
+{
+    // Called from inside libusb's event handling, where the handler must not be
+    // called; the report is delivered once libusb returns.
+    PendingCount--;
+    if (Closing)
+    {
+        return;
+    }
+
+    if (transfer->status == LIBUSB_TRANSFER_COMPLETED)
+    {
+        // Reaped as soon as the thread woke up, so this is the completion time.
+        OVR_ASSERT(CompletedCount < TransfersInFlight);
+        CompletedTimes[CompletedCount] = Timer::GetSeconds();
+        Completed[CompletedCount++]    = transfer;
+    }
+    else if (transfer->status != LIBUSB_TRANSFER_CANCELLED)
+    {
+        // Unplugged, or the endpoint failed.
+        IOError = true;
+    }
+}
+
+//-----------------------------------------------------------------------------
+void LibUSBHIDDevice::deliverCompleted()
+{
+    // Reports completed while the handler runs are appended and delivered here too.
+    while (CompletedCount > 0 && DeviceHandle)
+    {
+        libusb_transfer* transfer    = Completed[0];
+        double           receiveTime = CompletedTimes[0];
+        CompletedCount--;
+        memmove(Completed, Completed + 1, CompletedCount * sizeof(Completed[0]));
+        memmove(CompletedTimes, CompletedTimes + 1, CompletedCount * sizeof(CompletedTimes[0]));
+
+        if (Handler)
+        {
+            // Through OnInputReports, so the handler knows when a report has been handled.
+            UInt32 length = (UInt32)transfer->actual_length;
+            Handler->OnInputReports(transfer->buffer, ReadBufferSize, &length, &receiveTime, 1);
+        }
+
+        if (!Closing && DeviceHandle && !submitTransfer(transfer))
+        {
+            IOError = true;
+        }
+    }
+}
+
+//-----------------------------------------------------------------------------
+bool LibUSBHIDDevice::SetFeatureReport(UByte* data, UInt32 length)
+{
+    if (!DeviceHandle)
+        return false;
+
+    UByte reportID = data[0];
+
+    if (reportID == 0)
+    {
+        // Not using reports so remove from data packet.
+        data++;
+        length--;
+    }
+
+    int r = HIDManager->controlTransfer(DeviceHandle,
+                LIBUSB_ENDPOINT_OUT | LIBUSB_REQUEST_TYPE_CLASS | LIBUSB_RECIPIENT_INTERFACE,
+                HID_SetReport, (UInt16)((HID_ReportFeature << 8) | reportID),
+                (UInt16)InterfaceNumber, data, (UInt16)length);
+    return (r >= 0);
+}
+
+//-----------------------------------------------------------------------------
+bool LibUSBHIDDevice::GetFeatureReport(UByte* data, UInt32 length)
+{
+    if (!DeviceHandle)
+        return false;
+
+    UByte reportID = data[0];
+
+    if (reportID == 0)
+    {
+        // Unnumbered reports don't carry the ID; leave data[0] as it was.
+        data++;
+        length--;
+    }
+
+    int r = HIDManager->controlTransfer(DeviceHandle,
+                LIBUSB_ENDPOINT_IN | LIBUSB_REQUEST_TYPE_CLASS | LIBUSB_RECIPIENT_INTERFACE,
+                HID_GetReport, (UInt16)((HID_ReportFeature << 8) | reportID),
+                (UInt16)InterfaceNumber, data, (UInt16)length);
+    return (r >= 0);
+}
+
+//-----------------------------------------------------------------------------
+double LibUSBHIDDevice::OnTicks(double tickSeconds)
+{
+    if (Handler)
+    {
+        return Handler->OnTicks(tickSeconds);
+    }
+
+    return DeviceManagerThread::Notifier::OnTicks(tickSeconds);
+}
+
+//-----------------------------------------------------------------------------
+bool LibUSBHIDDevice::OnDeviceNotification(MessageType messageType,
+                                           HIDDeviceDesc* device_info,
+                                           bool* error)
+{
+    const char* device_path = device_info->Path.ToCStr();
+
+    if (messageType == Message_DeviceAdded)
+    {
+        // Is this the correct device? Other devices arrive while we are open.
+        if (DeviceHandle ||
+            !(device_info->VendorId == DevDesc.VendorId
+            && device_info->ProductId == DevDesc.ProductId
+            && device_info->SerialNumber == DevDesc.SerialNumber))
+        {
+            return false;
+        }
+
+        // A closed device has been re-added. Try to reopen.
+        if (!openDevice(device_path))
+        {
+            LogError("OVR::Linux::LibUSBHIDDevice - Failed to reopen a device '%s' that was re-added.\n",
+                     device_path);
+            *error = true;
+            return true;
+        }
+
+        LogText("OVR::Linux::LibUSBHIDDevice - Reopened device '%s'\n", device_path);
+
+        // Let the handler send its keep-alive now rather than at its old deadline.
+        HIDManager->DevManager->pThread->ResetTicksNotifier(this);
+
+        if (Handler)
+        {
+            Handler->OnDeviceMessage(HIDHandler::HIDDeviceMessage_DeviceAdded);
+        }
+    }
+    else if (messageType == Message_DeviceRemoved)
+    {
+        // Is this the correct device?
+        // For disconnected device, the device description will be invalid so
+        // checking the path is the only way to match them
+        if (DevDesc.Path.CompareNoCase(device_path) != 0)
+        {
+            return false;
+        }
+
+        if (DeviceHandle)
+        {
+            closeDevice(true);
+        }
+
+        if (Handler)
+        {
+            Handler->OnDeviceMessage(HIDHandler::HIDDeviceMessage_DeviceRemoved);
+        }
+    }
+    else
+    {
+        OVR_ASSERT(0);
+    }
+
+    *error = false;
+    return true;
+}
+
+}} // namespace OVR::Linux
+
+#endif // OVR_USE_LIBUSB
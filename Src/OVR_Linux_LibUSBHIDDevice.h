@@ -0,0 +1,209 @@
+/************************************************************************************
+Filename    :   OVR_Linux_LibUSBHIDDevice.h
+Content     :   HID device implementation on libusb interrupt transfers.
+Created     :   October 14, 2026
+
+Copyright   :   Copyright 2014 Oculus VR, Inc. All Rights reserved.
+
+Licensed under the Oculus VR Rift SDK License Version 3.1 (the "License");
+you may not use the Oculus VR Rift SDK except in compliance with the License,
+which is provided at the time of installation or download, or which
+otherwise accompanies this software in either electronic or hard copy form.
+
+You may obtain a copy of the License at
+
+http://www.oculusvr.com/licenses/LICENSE-3.1
+
+Unless required by applicable law or agreed to in writing, the Oculus VR SDK
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+*************************************************************************************/
+
+#ifndef OVR_Linux_LibUSBHIDDevice_h
+#define OVR_Linux_LibUSBHIDDevice_h
+
+// Define OVR_USE_LIBUSB (and link with libusb-1.0) to build the libusb HID
+// transport. When built, DeviceManager uses it in preference to hidraw unless
+// the OVR_HID_TRANSPORT environment variable is set to "hidraw".
+#ifdef OVR_USE_LIBUSB
+
+#include "OVR_HIDDevice.h"
+#include "OVR_Linux_DeviceManager.h"
+#include "Kernel/OVR_Atomic.h"
+#include <libusb.h>
+
+namespace OVR { namespace Linux {
+
+class LibUSBHIDDeviceManager;
+
+//-------------------------------------------------------------------------------------
+// ***** Linux LibUSBHIDDevice
+
+// HID device driven directly through libusb: the kernel HID driver is detached,
+// the interrupt IN endpoint is kept busy with several transfers at once, and
+// feature reports go through HID class control transfers. Completed transfers are
+// queued by the libusb callback and handed to the handler as soon as libusb
+// returns, on the device manager thread, so handlers may make control transfers.
+
+class LibUSBHIDDevice : public OVR::HIDDevice, public DeviceManagerThread::Notifier
+{
+private:
+    friend class LibUSBHIDDeviceManager;
+
+public:
+    LibUSBHIDDevice(LibUSBHIDDeviceManager* manager);
+
+    // This is a minimal constructor used during enumeration for us to pass
+    // a HIDDevice to the visit function (so that it can query feature reports).
+    LibUSBHIDDevice(LibUSBHIDDeviceManager* manager, libusb_device_handle* handle, int interfaceNumber);
+
+    virtual ~LibUSBHIDDevice();
+
+    bool HIDInitialize(const String& path);
+    void HIDShutdown();
+
+    virtual bool SetFeatureReport(UByte* data, UInt32 length);
+    virtual bool GetFeatureReport(UByte* data, UInt32 length);
+
+    // DeviceManagerThread::Notifier. Input arrives through the manager's
+    // libusb descriptors, so the device only uses ticks.
+    void OnEvent(int i, int fd) { OVR_UNUSED2(i, fd); }
+    double OnTicks(double tickSeconds);
+
+    bool OnDeviceNotification(MessageType messageType,
+                              HIDDeviceDesc* device_info,
+                              bool* error);
+
+private:
+    enum
+    {
+        ReadBufferSize     = 96,
+        // Interrupt transfers kept submitted, so that the host controller always
+        // has one to fill while earlier reports are being handled.
+        TransfersInFlight  = 4,
+        ControlTimeoutMs   = 1000
+    };
+
+    bool openDevice(const char* dev_path);
+    void closeDevice(bool wasUnplugged);
+    void closeDeviceOnIOError();
+
+    bool submitTransfer(libusb_transfer* transfer);
+    void onTransferComplete(libusb_transfer* transfer);
+    // Hands the completed reports to the handler and resubmits their transfers.
+    void deliverCompleted();
+
+    static void transferCallback(libusb_transfer* transfer);
+
+    bool                    InMinimalMode;
+    LibUSBHIDDeviceManager* HIDManager;
+    libusb_device_handle*   DeviceHandle;
+    int                     InterfaceNumber;
+    UByte                   InputEndpoint;
+    int                     InputReportLength;
+    bool                    KernelDriverDetached;
+    HIDDeviceDesc           DevDesc;
+
+    libusb_transfer*        Transfers[TransfersInFlight];
+    UByte                   TransferBuffers[TransfersInFlight][ReadBufferSize];
+    // Transfers currently submitted to libusb.
+    int                     PendingCount;
+    // Completed and waiting to be delivered, in completion order.
+    libusb_transfer*        Completed[TransfersInFlight];
+    double                  CompletedTimes[TransfersInFlight];
+    int                     CompletedCount;
+    bool                    Closing;
+    // Set by a failed transfer; the device is closed once libusb returns.
+    bool                    IOError;
+};
+
+
+//-------------------------------------------------------------------------------------
+// ***** Linux LibUSBHIDDeviceManager
+
+// Enumerates USB devices with a HID interface through libusb and services libusb
+// on the device manager thread: its descriptors are watched by the thread's
+// event loop, and its timeouts through a ticks notifier when it can't use a
+// descriptor for them. Device paths have the form "libusb:<bus>:<address>".
+
+class LibUSBHIDDeviceManager : public OVR::HIDDeviceManager, public DeviceManagerThread::Notifier
+{
+    friend class LibUSBHIDDevice;
+
+public:
+    LibUSBHIDDeviceManager(Linux::DeviceManager* manager);
+    virtual ~LibUSBHIDDeviceManager();
+
+    virtual bool Initialize();
+    virtual void Shutdown();
+
+    virtual bool Enumerate(HIDEnumerateVisitor* enumVisitor);
+    virtual OVR::HIDDevice* Open(const String& path);
+
+    static LibUSBHIDDeviceManager* CreateInternal(DeviceManager* manager);
+
+    // DeviceManagerThread::Notifier
+    void   OnEvent(int i, int fd);
+    double OnTicks(double tickSeconds);
+
+private:
+    struct HotplugEvent
+    {
+        libusb_device*          pDevice;
+        libusb_hotplug_event    Event;
+    };
+
+    // Runs libusb's event handling without blocking, then deliverReports.
+    void handleEvents();
+    // Delivers the reports completed on each open device and closes the devices
+    // whose transfers failed.
+    void deliverReports();
+
+    libusb_device* findDevice(const char* dev_path);
+    bool getFullDesc(libusb_device* device, HIDDeviceDesc* desc);
+    static void getPath(libusb_device* device, String* pPath);
+    static bool getHIDInterface(libusb_device* device, int* pInterface,
+                                UByte* pEndpoint, int* pPacketSize);
+    // Opens the device and claims its HID interface, detaching the kernel driver.
+    static bool openInterface(libusb_device* device, int interfaceNumber,
+                              libusb_device_handle** pHandle, bool* pDetached);
+    static void closeInterface(libusb_device_handle* handle, int interfaceNumber, bool detached);
+
+    // Synchronous control transfer; delivers any reports completed meanwhile.
+    int  controlTransfer(libusb_device_handle* handle, UByte requestType, UByte request,
+                         UInt16 value, UInt16 index, UByte* data, UInt16 length);
+
+    bool AddNotificationDevice(LibUSBHIDDevice* device);
+    bool RemoveNotificationDevice(LibUSBHIDDevice* device);
+
+    // Hotplug callbacks may come from a libusb thread; events are queued and
+    // handled by processHotplugEvents on the device manager thread.
+    static int  hotplugCallback(libusb_context* context, libusb_device* device,
+                                libusb_hotplug_event event, void* userData);
+    Void        processHotplugEvents();
+
+    static void pollfdAdded(int fd, short events, void* userData);
+    static void pollfdRemoved(int fd, void* userData);
+
+    DeviceManager*                  DevManager;
+
+    libusb_context*                 Context;
+    bool                            HasHotplug;
+    libusb_hotplug_callback_handle  HotplugHandle;
+    bool                            Delivering;
+
+    Lock                            HotplugLock;
+    Array<HotplugEvent>             HotplugEvents;
+    bool                            HotplugQueued;
+
+    Array<LibUSBHIDDevice*>         NotificationDevices;
+};
+
+}} // namespace OVR::Linux
+
+#endif // OVR_USE_LIBUSB
+
+#endif // OVR_Linux_LibUSBHIDDevice_h
@@ -0,0 +1,199 @@
+/************************************************************************************
+
+Filename    :   OVR_Linux_ProfileWatcher.cpp
+Content     :   Watches the profile database for changes made by other processes
+Created     :   October 14, 2026
+Notes       :
+
+Copyright   :   Copyright 2014 Oculus VR, Inc. All Rights reserved.
+
+Licensed under the Oculus VR Rift SDK License Version 3.1 (the "License");
+you may not use the Oculus VR Rift SDK except in compliance with the License,
+which is provided at the time of installation or download, or which
+otherwise accompanies this software in either electronic or hard copy form.
+
+You may obtain a copy of the License at
+
+http://www.oculusvr.com/licenses/LICENSE-3.1
+
+Unless required by applicable law or agreed to in writing, the Oculus VR SDK
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+*************************************************************************************/
+
+#include "OVR_Linux_ProfileWatcher.h"
+#include "OVR_Profile.h"
+#include "Kernel/OVR_Log.h"
+
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <string.h>
+
+#if defined(__FreeBSD__)
+#include <sys/types.h>
+#include <sys/event.h>
+#include <sys/time.h>
+#else
+#include <sys/inotify.h>
+#endif
+
+namespace OVR { namespace Linux {
+
+// Name of the database in the profile directory, as written by ProfileManager.
+static const char* ProfileFileName = "ProfileDB.json";
+
+ProfileWatcher::ProfileWatcher(DeviceManager* manager)
+  : pManager(manager), NotifyFd(-1)
+#if defined(__FreeBSD__)
+  , DirFd(-1), FileFd(-1)
+#endif
+{
+}
+
+ProfileWatcher::~ProfileWatcher()
+{
+    OVR_ASSERT(NotifyFd < 0);
+}
+
+bool ProfileWatcher::Start()
+{
+    if (NotifyFd >= 0)
+        return true;
+
+    DirPath  = GetBaseOVRPath(false);
+    FilePath = DirPath + "/" + ProfileFileName;
+
+#if defined(__FreeBSD__)
+    DirFd = open(DirPath.ToCStr(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (DirFd < 0)
+        return false;
+
+    NotifyFd = kqueue();
+    struct kevent kev;
+    EV_SET(&kev, DirFd, EVFILT_VNODE, EV_ADD | EV_CLEAR, NOTE_WRITE | NOTE_DELETE | NOTE_RENAME, 0, 0);
+    if (NotifyFd < 0 || kevent(NotifyFd, &kev, 1, 0, 0, 0) != 0)
+    {
+        LogError("OVR::Linux::ProfileWatcher - can't watch '%s' (error %d).\n", DirPath.ToCStr(), errno);
+        Stop();
+        return false;
+    }
+    watchFile();
+#else
+    NotifyFd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    // Saves replace the file by renaming a new one over it.
+    if (NotifyFd < 0 ||
+        inotify_add_watch(NotifyFd, DirPath.ToCStr(),
+                          IN_CLOSE_WRITE | IN_MOVED_TO | IN_MOVED_FROM | IN_DELETE) < 0)
+    {
+        // The directory is only created when a profile is first saved.
+        if (errno != ENOENT)
+            LogError("OVR::Linux::ProfileWatcher - can't watch '%s' (error %d).\n", DirPath.ToCStr(), errno);
+        Stop();
+        return false;
+    }
+#endif
+
+    if (!pManager->pThread->AddSelectFd(this, NotifyFd))
+    {
+        Stop();
+        return false;
+    }
+    return true;
+}
+
+Void ProfileWatcher::Stop()
+{
+    if (NotifyFd >= 0)
+    {
+        pManager->pThread->RemoveSelectFd(this, NotifyFd);
+        close(NotifyFd);
+        NotifyFd = -1;
+    }
+#if defined(__FreeBSD__)
+    if (FileFd >= 0)
+    {
+        close(FileFd);
+        FileFd = -1;
+    }
+    if (DirFd >= 0)
+    {
+        close(DirFd);
+        DirFd = -1;
+    }
+#endif
+    return 0;
+}
+
+#if defined(__FreeBSD__)
+void ProfileWatcher::watchFile()
+{
+    // Closing the old descriptor removes its watch.
+    if (FileFd >= 0)
+        close(FileFd);
+
+    FileFd = open(FilePath.ToCStr(), O_RDONLY | O_CLOEXEC);
+    if (FileFd < 0)
+        return;
+
+    struct kevent kev;
+    EV_SET(&kev, FileFd, EVFILT_VNODE, EV_ADD | EV_CLEAR,
+           NOTE_WRITE | NOTE_EXTEND | NOTE_DELETE | NOTE_RENAME, 0, 0);
+    kevent(NotifyFd, &kev, 1, 0, 0, 0);
+}
+#endif
+
+bool ProfileWatcher::readEvents()
+{
+    bool changed = false;
+
+#if defined(__FreeBSD__)
+    struct kevent   events[8];
+    struct timespec timeout = { 0, 0 };
+    int             n;
+    while ((n = kevent(NotifyFd, 0, 0, events, 8, &timeout)) > 0)
+        changed = true;
+    if (changed)
+        watchFile();
+#else
+    char buff[4096] __attribute__((aligned(__alignof__(struct inotify_event))));
+    ssize_t len;
+    while ((len = read(NotifyFd, buff, sizeof(buff))) > 0)
+    {
+        for (char* p = buff; p < buff + len; )
+        {
+            const struct inotify_event* event = (const struct inotify_event*)p;
+            // Dropped events may have been for the database.
+            if ((event->mask & IN_Q_OVERFLOW) ||
+                (event->len && strcmp(event->name, ProfileFileName) == 0))
+            {
+                changed = true;
+            }
+            p += sizeof(struct inotify_event) + event->len;
+        }
+    }
+#endif
+
+    return changed;
+}
+
+void ProfileWatcher::OnEvent(int i, int fd)
+{
+    OVR_UNUSED2(i, fd);
+
+    if (!readEvents())
+        return;
+
+    // Our own saves are recognized by the manager and don't count as changes.
+    ProfileManager* profiles = pManager->GetProfileManager();
+    if (profiles && profiles->ReloadIfChanged())
+    {
+        LogText("OVR::Linux::ProfileWatcher - '%s' changed.\n", FilePath.ToCStr());
+        pManager->CallOnProfileChanged();
+    }
+}
+
+}} // namespace OVR::Linux
@@ -0,0 +1,81 @@
+/************************************************************************************
+
+Filename    :   OVR_Linux_ProfileWatcher.h
+Content     :   Watches the profile database for changes made by other processes
+Created     :   October 14, 2026
+Notes       :
+
+Copyright   :   Copyright 2014 Oculus VR, Inc. All Rights reserved.
+
+Licensed under the Oculus VR Rift SDK License Version 3.1 (the "License");
+you may not use the Oculus VR Rift SDK except in compliance with the License,
+which is provided at the time of installation or download, or which
+otherwise accompanies this software in either electronic or hard copy form.
+
+You may obtain a copy of the License at
+
+http://www.oculusvr.com/licenses/LICENSE-3.1
+
+Unless required by applicable law or agreed to in writing, the Oculus VR SDK
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+*************************************************************************************/
+
+#ifndef OVR_Linux_ProfileWatcher_h
+#define OVR_Linux_ProfileWatcher_h
+
+#include "OVR_Linux_DeviceManager.h"
+
+namespace OVR { namespace Linux {
+
+//-------------------------------------------------------------------------------------
+// ***** ProfileWatcher
+
+// ProfileWatcher is told by the kernel when the profile database is written, with
+// inotify on Linux and kqueue on FreeBSD, so that changes made by another process,
+// such as the configuration utility, are picked up without polling the file.
+// The watch is serviced by the manager thread; on a change the manager's profile
+// cache is dropped and its handlers get Message_ProfileChanged.
+//
+// Start and Stop must be called on the manager thread.
+
+class ProfileWatcher : public DeviceManagerThread::Notifier, public NewOverrideBase
+{
+public:
+    ProfileWatcher(DeviceManager* manager);
+    virtual ~ProfileWatcher();
+
+    // Returns false if the profile directory can't be watched, such as before
+    // any profile has been saved.
+    bool        Start();
+    Void        Stop();
+
+    // DeviceManagerThread::Notifier
+    virtual void OnEvent(int i, int fd);
+
+private:
+    // Consumes the pending notifications; returns true if any may be for the database.
+    bool        readEvents();
+#if defined(__FreeBSD__)
+    // The directory only reports entries being replaced, so the database file is
+    // watched too, and watched again after each change as it may be a new file.
+    void        watchFile();
+#endif
+
+    DeviceManager*  pManager;
+    String          DirPath;
+    String          FilePath;
+    // The inotify descriptor, or the kqueue holding the vnode watches.
+    int             NotifyFd;
+#if defined(__FreeBSD__)
+    int             DirFd;
+    int             FileFd;
+#endif
+};
+
+}} // namespace OVR::Linux
+
+#endif // OVR_Linux_ProfileWatcher_h
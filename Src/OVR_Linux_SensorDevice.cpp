@@ -25,7 +25,9 @@ limitations under the License.
 *************************************************************************************/
 
 #include "OVR_Linux_HMDDevice.h"
+#include "OVR_Linux_DeviceManager.h"
 #include "OVR_SensorImpl.h"
+#include "OVR_SyntheticSensor.h"
 #include "OVR_DeviceImpl.h"
 
 namespace OVR { namespace Linux {
@@ -52,6 +54,44 @@ void SensorDeviceImpl::EnumerateHMDFromSensorDisplayInfo(   const SensorDisplayI
     visitor.Visit(hmdCreateDesc);
 }
 
+//-------------------------------------------------------------------------------------
+// ***** SyntheticTrackerTicks
+
+// Calls a synthetic tracker on its device thread, which services it in place of
+// reading a hidraw descriptor.
+class SyntheticTrackerTicks : public Linux::DeviceManagerThread::Notifier, public NewOverrideBase
+{
+public:
+    SyntheticTrackerTicks(SyntheticTracker* tracker, Linux::DeviceManagerThread* thread)
+        : pTracker(tracker), pThread(thread) { }
+    virtual ~SyntheticTrackerTicks() { }
+
+    virtual double OnTicks(double tickSeconds) { return pTracker->OnTicks(tickSeconds); }
+    virtual void   OnEvent(int i, int fd)      { OVR_UNUSED2(i, fd); }
+
+    SyntheticTracker*               pTracker;
+    Ptr<Linux::DeviceManagerThread> pThread;
+};
+
+bool SyntheticTracker::startTicks(DeviceManagerImpl* manager, const String& path)
+{
+    Linux::DeviceManagerThread* thread = static_cast<Linux::DeviceManager*>(manager)->GetDeviceThread(path);
+    OVR_ASSERT(thread->GetThreadId() == GetCurrentThreadId());
+
+    pTicks = new SyntheticTrackerTicks(this, thread);
+    return thread->AddTicksNotifier(pTicks);
+}
+
+void SyntheticTracker::stopTicks()
+{
+    if (!pTicks)
+        return;
+
+    pTicks->pThread->RemoveTicksNotifier(pTicks);
+    delete pTicks;
+    pTicks = 0;
+}
+
 } // namespace OVR
 
 
@@ -0,0 +1,239 @@
+/************************************************************************************
+
+Filename    :   OVR_PoseService.cpp
+Content     :   Publishes sensor fusion state to other processes through shared memory
+Created     :   October 14, 2026
+Notes       :
+
+Copyright   :   Copyright 2014 Oculus VR, Inc. All Rights reserved.
+
+Licensed under the Oculus VR Rift SDK License Version 3.1 (the "License");
+you may not use the Oculus VR Rift SDK except in compliance with the License,
+which is provided at the time of installation or download, or which
+otherwise accompanies this software in either electronic or hard copy form.
+
+You may obtain a copy of the License at
+
+http://www.oculusvr.com/licenses/LICENSE-3.1
+
+Unless required by applicable law or agreed to in writing, the Oculus VR SDK
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+*************************************************************************************/
+
+#include "OVR_PoseService.h"
+#include "Kernel/OVR_Log.h"
+
+#if !defined(OVR_OS_WIN32)
+#include <sys/types.h>
+#include <signal.h>
+#include <unistd.h>
+#include <errno.h>
+#endif
+
+namespace OVR {
+
+static const char* PoseService_RegionName = "/ovr_pose_service";
+
+enum
+{
+    PoseService_Magic   = 0x4F565253, // 'OVRS'
+    PoseService_Version = 1,
+    // Magic, Version, Size and PublisherPid.
+    PoseService_HeaderSize = 4 * sizeof(UInt32)
+};
+
+// Layout of the shared region. Magic is stored last by the publisher, so that a
+// subscriber that sees it also sees the rest initialized. The header up to
+// PublisherPid is kept by all versions, so that a publisher can tell whether the
+// region it finds is still in use.
+struct PoseService::Region
+{
+    AtomicInt<UInt32>   Magic;
+    UInt32              Version;
+    UInt32              Size;
+    // Process ids of the publisher, 0 once it has stopped, and of the frame timing's
+    // publisher, 0 if none.
+    AtomicInt<UInt32>   PublisherPid;
+    AtomicInt<UInt32>   FrameTimingPid;
+    UByte               PadHeader[OVR_CACHE_LINE_SIZE];
+
+    SensorFusion::SharedState                   Fusion;
+    LocklessSlotUpdater<PoseServiceFrameTiming> FrameTiming;
+};
+
+
+#if !defined(OVR_OS_WIN32)
+
+static UInt32 PoseService_GetProcessId()
+{
+    return (UInt32)getpid();
+}
+
+static bool PoseService_IsProcessRunning(UInt32 pid)
+{
+    return pid && (kill((pid_t)pid, 0) == 0 || errno == EPERM);
+}
+
+#else
+
+static UInt32 PoseService_GetProcessId()
+{
+    return 0;
+}
+
+static bool PoseService_IsProcessRunning(UInt32)
+{
+    return false;
+}
+
+#endif
+
+
+PoseService::PoseService(ModeType mode)
+  : Mode(mode), pRegion(0), pFusionOwner(0), FrameTimingTried(false), FrameTimingClaimed(false)
+{
+}
+
+PoseService::~PoseService()
+{
+    if (pRegion)
+    {
+        if (Mode == Mode_Publish)
+            pRegion->PublisherPid.Store_Release(0);
+        else if (FrameTimingClaimed)
+            pRegion->FrameTimingPid.CompareAndSet_Sync(PoseService_GetProcessId(), 0);
+    }
+    // The region's members hold no resources, so it isn't destroyed; the publisher's
+    // SharedMemory removes it.
+}
+
+PoseService* PoseService::Create(ModeType mode)
+{
+    PoseService* service = new PoseService(mode);
+    if (!service)
+        return 0;
+
+    SharedMemory& memory = service->Memory;
+    if (mode == Mode_Publish)
+    {
+        // A region is only replaced once the process that published it has exited;
+        // replacing it while it runs would leave that process publishing to a
+        // region nobody can open.
+        if (memory.Open(PoseService_RegionName, PoseService_HeaderSize))
+        {
+            Region* existing = (Region*)memory.GetData();
+            UInt32  pid      = (existing->Magic.Load_Acquire() == PoseService_Magic) ?
+                               existing->PublisherPid.Load_Acquire() : 0;
+            memory.Close();
+            if (PoseService_IsProcessRunning(pid))
+            {
+                LogError("PoseService - %s is published by process %u.\n", PoseService_RegionName, pid);
+                delete service;
+                return 0;
+            }
+            SharedMemory::Remove(PoseService_RegionName);
+        }
+
+        if (memory.Create(PoseService_RegionName, sizeof(Region)))
+        {
+            Region* region  = Construct<Region>(memory.GetData());
+            region->Version = PoseService_Version;
+            region->Size    = sizeof(Region);
+            region->FrameTimingPid.Store_Relaxed(0);
+            region->PublisherPid.Store_Relaxed(PoseService_GetProcessId());
+            region->Magic.Store_Release(PoseService_Magic);
+            service->pRegion = region;
+        }
+    }
+    else if (memory.Open(PoseService_RegionName, sizeof(Region)))
+    {
+        Region* region = (Region*)memory.GetData();
+        if (region->Magic.Load_Acquire() == PoseService_Magic &&
+            region->Version == PoseService_Version && region->Size == sizeof(Region))
+        {
+            service->pRegion = region;
+        }
+        else
+        {
+            LogError("PoseService - %s is from an incompatible SDK build.\n", PoseService_RegionName);
+        }
+    }
+
+    if (!service->pRegion || (mode == Mode_Subscribe && !service->IsServiceRunning()))
+    {
+        delete service;
+        return 0;
+    }
+
+    LogText("PoseService - %s %s\n", (mode == Mode_Publish) ? "Publishing to" : "Subscribed to",
+            PoseService_RegionName);
+    return service;
+}
+
+SensorFusion::SharedState* PoseService::GetFusionState()
+{
+    return &pRegion->Fusion;
+}
+
+bool PoseService::ClaimFusionState(const void* owner)
+{
+    if (Mode != Mode_Publish || (pFusionOwner && pFusionOwner != owner))
+        return false;
+    pFusionOwner = owner;
+    return true;
+}
+
+void PoseService::ReleaseFusionState(const void* owner)
+{
+    if (pFusionOwner == owner)
+        pFusionOwner = 0;
+}
+
+bool PoseService::IsServiceRunning() const
+{
+    return PoseService_IsProcessRunning(pRegion->PublisherPid.Load_Acquire());
+}
+
+bool PoseService::claimFrameTiming()
+{
+    const UInt32 self  = PoseService_GetProcessId();
+    UInt32       owner = pRegion->FrameTimingPid.Load_Acquire();
+
+    // A renderer that exited without releasing the timing gives it up.
+    if (owner && owner != self && !PoseService_IsProcessRunning(owner))
+        pRegion->FrameTimingPid.CompareAndSet_Sync(owner, 0);
+
+    FrameTimingClaimed = pRegion->FrameTimingPid.CompareAndSet_Sync(0, self) ||
+                         pRegion->FrameTimingPid.Load_Acquire() == self;
+    return FrameTimingClaimed;
+}
+
+bool PoseService::PublishFrameTiming(const PoseServiceFrameTiming& timing)
+{
+    // The claim is only tried once, so that other renderers don't make a system
+    // call every frame.
+    if (Mode != Mode_Subscribe)
+        return false;
+    if (!FrameTimingClaimed)
+    {
+        if (FrameTimingTried)
+            return false;
+        FrameTimingTried = true;
+        if (!claimFrameTiming())
+            return false;
+    }
+    pRegion->FrameTiming.SetState(timing);
+    return true;
+}
+
+bool PoseService::GetFrameTiming(PoseServiceFrameTiming* timing) const
+{
+    *timing = pRegion->FrameTiming.GetState();
+    return timing->ThisFrameSeconds != 0;
+}
+
+} // namespace OVR
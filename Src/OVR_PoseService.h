@@ -0,0 +1,122 @@
+/************************************************************************************
+
+Filename    :   OVR_PoseService.h
+Content     :   Publishes sensor fusion state to other processes through shared memory
+Created     :   October 14, 2026
+Notes       :
+
+Copyright   :   Copyright 2014 Oculus VR, Inc. All Rights reserved.
+
+Licensed under the Oculus VR Rift SDK License Version 3.1 (the "License");
+you may not use the Oculus VR Rift SDK except in compliance with the License,
+which is provided at the time of installation or download, or which
+otherwise accompanies this software in either electronic or hard copy form.
+
+You may obtain a copy of the License at
+
+http://www.oculusvr.com/licenses/LICENSE-3.1
+
+Unless required by applicable law or agreed to in writing, the Oculus VR SDK
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+*************************************************************************************/
+
+#ifndef OVR_PoseService_h
+#define OVR_PoseService_h
+
+#include "OVR_SensorFusion.h"
+#include "Kernel/OVR_SharedMemory.h"
+
+namespace OVR {
+
+//-------------------------------------------------------------------------------------
+// ***** PoseServiceFrameTiming
+
+// Timing of the frame being rendered by the process that renders, as returned by
+// ovrHmd_BeginFrameTiming, for processes that follow the display without rendering.
+struct PoseServiceFrameTiming
+{
+    UInt32  FrameIndex;
+    float   DeltaSeconds;
+    double  ThisFrameSeconds;
+    double  TimewarpPointSeconds;
+    double  NextFrameSeconds;
+    double  ScanoutMidpointSeconds;
+    double  EyeScanoutSeconds[2];
+
+    PoseServiceFrameTiming()
+      : FrameIndex(0), DeltaSeconds(0), ThisFrameSeconds(0), TimewarpPointSeconds(0),
+        NextFrameSeconds(0), ScanoutMidpointSeconds(0)
+    {
+        EyeScanoutSeconds[0] = EyeScanoutSeconds[1] = 0;
+    }
+};
+
+
+//-------------------------------------------------------------------------------------
+// ***** PoseService
+
+// PoseService lets one process own the HMD's sensor and run its SensorFusion, while
+// other processes on the machine read the resulting poses. The publishing process
+// places the fusion's lockless state in a shared memory region, where subscribing
+// processes map it and query it with SensorFusion::SetSharedState; a query is then
+// the same seqlock copy as in the publishing process, with no system calls.
+//
+// The region also carries the frame timing of one rendering subscriber, so that
+// others, such as an audio engine, can predict for the same display time.
+//
+// Only one HMD is published. All processes must be built from the same SDK version;
+// a subscriber refuses a region of another layout. The region is created with
+// owner-only access, so all processes must run as the same user.
+
+class PoseService : public NewOverrideBase
+{
+public:
+    enum ModeType
+    {
+        Mode_Publish,
+        Mode_Subscribe
+    };
+
+    // Publish creates the region, replacing a stale one; Subscribe maps the region of a
+    // running service. Returns null on failure, such as when no service is running.
+    static PoseService* Create(ModeType mode);
+    ~PoseService();
+
+    ModeType    GetMode() const                 { return Mode; }
+
+    // The fusion state in the region. The publisher passes it to the fusion of one
+    // HMD, which claims it with ClaimFusionState; subscribers read from it.
+    SensorFusion::SharedState* GetFusionState();
+    bool        ClaimFusionState(const void* owner);
+    void        ReleaseFusionState(const void* owner);
+
+    // Subscriber: true while the publishing process is running.
+    bool        IsServiceRunning() const;
+
+    // Frame timing is published by the first subscriber that calls PublishFrameTiming,
+    // until it exits; returns false in other processes. GetFrameTiming returns false
+    // until timing has been published.
+    bool        PublishFrameTiming(const PoseServiceFrameTiming& timing);
+    bool        GetFrameTiming(PoseServiceFrameTiming* timing) const;
+
+private:
+    struct Region;
+
+    PoseService(ModeType mode);
+    bool        claimFrameTiming();
+
+    ModeType        Mode;
+    SharedMemory    Memory;
+    Region*         pRegion;
+    const void*     pFusionOwner;
+    bool            FrameTimingTried;
+    bool            FrameTimingClaimed;
+};
+
+} // namespace OVR
+
+#endif // OVR_PoseService_h
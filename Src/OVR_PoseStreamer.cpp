@@ -0,0 +1,217 @@
+/************************************************************************************
+
+Filename    :   OVR_PoseStreamer.cpp
+Content     :   Streams head poses to other hosts over UDP
+Created     :   October 14, 2026
+Notes       :
+
+Copyright   :   Copyright 2014 Oculus VR, Inc. All Rights reserved.
+
+Licensed under the Oculus VR Rift SDK License Version 3.1 (the "License");
+you may not use the Oculus VR Rift SDK except in compliance with the License,
+which is provided at the time of installation or download, or which
+otherwise accompanies this software in either electronic or hard copy form.
+
+You may obtain a copy of the License at
+
+http://www.oculusvr.com/licenses/LICENSE-3.1
+
+Unless required by applicable law or agreed to in writing, the Oculus VR SDK
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+*************************************************************************************/
+
+#include "OVR_PoseStreamer.h"
+#include "OVR_SensorFusion.h"
+#include "Kernel/OVR_Alg.h"
+#include "Kernel/OVR_Log.h"
+#include "Kernel/OVR_String.h"
+
+#if !defined(OVR_OS_WIN32)
+#define OVR_POSESTREAMER_SOCKETS
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <string.h>
+#include <stdlib.h>
+#if defined(OVR_OS_LINUX) || defined(__FreeBSD__)
+#define OVR_POSESTREAMER_SENDMMSG
+#endif
+#endif
+
+namespace OVR {
+
+static const UInt32 PoseStreamMagic   = 0x5052564F; // 'OVRP'
+static const UInt16 PoseStreamVersion = 1;
+
+static UByte* encodeVector3(UByte* p, const Vector3d& v)
+{
+    Alg::EncodeFloat(p,     (float)v.x);
+    Alg::EncodeFloat(p + 4, (float)v.y);
+    Alg::EncodeFloat(p + 8, (float)v.z);
+    return p + 12;
+}
+
+
+PoseStreamer::PoseStreamer()
+  : Socket(-1), Sequence(0), QueuedCount(0), SentCount(0), DroppedCount(0)
+{
+}
+
+PoseStreamer::~PoseStreamer()
+{
+    Close();
+}
+
+void PoseStreamer::Add(const PoseState<double>& state, unsigned statusFlags)
+{
+    if (Socket < 0)
+        return;
+    if (QueuedCount == MaxQueuedPackets)
+        Flush();
+
+    UByte* p = Packets[QueuedCount++];
+    Alg::EncodeUInt32(p,      PoseStreamMagic);
+    Alg::EncodeUInt16(p + 4,  PoseStreamVersion);
+    Alg::EncodeUInt16(p + 6,  (UInt16)statusFlags);
+    Alg::EncodeUInt32(p + 8,  Sequence++);
+    Alg::EncodeDouble(p + 12, state.TimeInSeconds);
+    p += 20;
+
+    const Quatd& q = state.Pose.Rotation;
+    Alg::EncodeFloat(p,      (float)q.x);
+    Alg::EncodeFloat(p + 4,  (float)q.y);
+    Alg::EncodeFloat(p + 8,  (float)q.z);
+    Alg::EncodeFloat(p + 12, (float)q.w);
+    p = encodeVector3(p + 16, state.Pose.Translation);
+    p = encodeVector3(p, state.AngularVelocity);
+    p = encodeVector3(p, state.LinearVelocity);
+    p = encodeVector3(p, state.AngularAcceleration);
+    p = encodeVector3(p, state.LinearAcceleration);
+    OVR_ASSERT(p == Packets[QueuedCount - 1] + PacketSize);
+}
+
+
+#if defined(OVR_POSESTREAMER_SOCKETS)
+
+bool PoseStreamer::Open(const char* address, int multicastTtl)
+{
+    Close();
+
+    // Split "a.b.c.d:port"
+    String      host(address);
+    const char* colon = strrchr(address, ':');
+    int         port  = colon ? atoi(colon + 1) : 0;
+    if (colon)
+        host = String(address, (UPInt)(colon - address));
+
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port   = htons((UInt16)port);
+    if (port <= 0 || port > 0xFFFF || inet_pton(AF_INET, host.ToCStr(), &addr.sin_addr) != 1)
+    {
+        LogError("PoseStreamer - '%s' isn't an IPv4 address:port.\n", address);
+        return false;
+    }
+
+    int s = socket(AF_INET, SOCK_DGRAM, 0);
+    if (s < 0)
+    {
+        LogError("PoseStreamer - Failed to create a socket: %s\n", strerror(errno));
+        return false;
+    }
+
+    // The socket is connected, so that packets need no address of their own, and
+    // non-blocking, so that a full send buffer never stalls the sensor thread.
+    unsigned char ttl = (unsigned char)Alg::Clamp(multicastTtl, 0, 255);
+    setsockopt(s, IPPROTO_IP, IP_MULTICAST_TTL, &ttl, sizeof(ttl));
+    fcntl(s, F_SETFL, fcntl(s, F_GETFL) | O_NONBLOCK);
+    if (connect(s, (struct sockaddr*)&addr, sizeof(addr)) != 0)
+    {
+        LogError("PoseStreamer - Failed to connect to %s: %s\n", address, strerror(errno));
+        ::close(s);
+        return false;
+    }
+
+    Socket      = s;
+    QueuedCount = 0;
+    return true;
+}
+
+void PoseStreamer::Close()
+{
+    if (Socket >= 0)
+    {
+        Flush();
+        ::close(Socket);
+    }
+    Socket      = -1;
+    QueuedCount = 0;
+}
+
+void PoseStreamer::Flush()
+{
+    if (Socket < 0 || QueuedCount == 0)
+        return;
+
+    unsigned sent = 0;
+#if defined(OVR_POSESTREAMER_SENDMMSG)
+    struct iovec   iov[MaxQueuedPackets];
+    struct mmsghdr msgs[MaxQueuedPackets];
+    memset(msgs, 0, sizeof(msgs[0]) * QueuedCount);
+    for (unsigned i = 0; i < QueuedCount; i++)
+    {
+        iov[i].iov_base            = Packets[i];
+        iov[i].iov_len             = PacketSize;
+        msgs[i].msg_hdr.msg_iov    = &iov[i];
+        msgs[i].msg_hdr.msg_iovlen = 1;
+    }
+    while (sent < QueuedCount)
+    {
+        int n = sendmmsg(Socket, msgs + sent, QueuedCount - sent, MSG_DONTWAIT);
+        if (n <= 0)
+            break;
+        sent += (unsigned)n;
+    }
+#else
+    for (; sent < QueuedCount; sent++)
+    {
+        if (send(Socket, Packets[sent], PacketSize, MSG_DONTWAIT) != PacketSize)
+            break;
+    }
+#endif
+
+    SentCount    += sent;
+    DroppedCount += QueuedCount - sent;
+    QueuedCount   = 0;
+}
+
+#else // OVR_POSESTREAMER_SOCKETS
+
+bool PoseStreamer::Open(const char*, int)
+{
+    return false;
+}
+
+void PoseStreamer::Close()
+{
+    QueuedCount = 0;
+}
+
+void PoseStreamer::Flush()
+{
+    QueuedCount = 0;
+}
+
+#endif // OVR_POSESTREAMER_SOCKETS
+
+} // namespace OVR
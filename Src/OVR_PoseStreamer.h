@@ -0,0 +1,94 @@
+/************************************************************************************
+
+Filename    :   OVR_PoseStreamer.h
+Content     :   Streams head poses to other hosts over UDP
+Created     :   October 14, 2026
+Notes       :
+
+Copyright   :   Copyright 2014 Oculus VR, Inc. All Rights reserved.
+
+Licensed under the Oculus VR Rift SDK License Version 3.1 (the "License");
+you may not use the Oculus VR Rift SDK except in compliance with the License,
+which is provided at the time of installation or download, or which
+otherwise accompanies this software in either electronic or hard copy form.
+
+You may obtain a copy of the License at
+
+http://www.oculusvr.com/licenses/LICENSE-3.1
+
+Unless required by applicable law or agreed to in writing, the Oculus VR SDK
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+*************************************************************************************/
+
+#ifndef OVR_PoseStreamer_h
+#define OVR_PoseStreamer_h
+
+#include "Kernel/OVR_Math.h"
+
+// Setting the OVR_POSE_STREAM environment variable to an IPv4 "address:port", such
+// as a multicast group, makes the C API stream the head poses there while its sensor
+// is running.
+
+namespace OVR {
+
+//-------------------------------------------------------------------------------------
+// ***** PoseStreamer
+
+// Sends a UDP packet for every sensor reading that SensorFusion integrates, 1000 per
+// second for a DK2, so that motion platforms and tracking systems on other hosts can
+// follow the head without polling. Packets are encoded in place into a fixed set of
+// buffers and handed to the socket in one sendmmsg call per sensor report, which the
+// fusion makes with Flush; sending never blocks, and packets the socket can't take
+// are dropped.
+//
+// A packet is PacketSize bytes, all little-endian:
+//   UInt32 magic 'OVRP', UInt16 version, UInt16 status flags (ovrStatusBits),
+//   UInt32 sequence number, counting every packet including dropped ones,
+//   double sample time in seconds, on the sending host's Timer clock, as corrected
+//   by SensorTimeFilter,
+//   float orientation x, y, z, w, then float x, y, z of the position, angular and
+//   linear velocity and angular and linear acceleration of the center pupil frame.
+
+class PoseStreamer : public NewOverrideBase
+{
+public:
+    enum
+    {
+        PacketSize        = 96,
+        MaxQueuedPackets  = 32
+    };
+
+    PoseStreamer();
+    ~PoseStreamer();
+
+    // Opens a socket sending to the IPv4 "address:port"; multicast packets are sent
+    // with the given time-to-live, so 1 keeps them on the local network.
+    bool        Open(const char* address, int multicastTtl = 1);
+    void        Close();
+    bool        IsOpen() const              { return Socket >= 0; }
+
+    // Queues a packet for the state of the center pupil frame, flushing first if
+    // the queue is full.
+    void        Add(const PoseState<double>& state, unsigned statusFlags);
+    // Sends the queued packets.
+    void        Flush();
+
+    UInt32      GetSentCount() const        { return SentCount; }
+    UInt32      GetDroppedCount() const     { return DroppedCount; }
+
+private:
+    int         Socket;
+    UInt32      Sequence;
+    unsigned    QueuedCount;
+    UInt32      SentCount;
+    UInt32      DroppedCount;
+    UByte       Packets[MaxQueuedPackets][PacketSize];
+};
+
+} // namespace OVR
+
+#endif // OVR_PoseStreamer_h
@@ -38,6 +38,7 @@ limitations under the License.
 #include "Kernel/OVR_SysFile.h"
 #include "Kernel/OVR_Allocator.h"
 #include "Kernel/OVR_Array.h"
+#include "Kernel/OVR_Log.h"
 
 #ifdef OVR_OS_WIN32
 #include <Shlobj.h>
@@ -137,6 +138,24 @@ String ProfileManager::GetProfilePath(bool create_dir)
     return path;
 }
 
+// Stats the profile database, leaving FileSize -1 if there is none.
+static void StatProfileFile(const String& path, FileStat* stat)
+{
+    if (!SysFile::GetFileStat(stat, path))
+    {
+        stat->ModifyTime = 0;
+        stat->AccessTime = 0;
+        stat->FileSize   = -1;
+    }
+}
+
+String ProfileManager::GetStorePath(bool create_dir)
+{
+    String path = GetBaseOVRPath(create_dir);
+    path += "/ProfileDB.bin";
+    return path;
+}
+
 bool ProfileManager::GetDeviceTags(const DeviceBase* device, String& product, String& serial)
 {
     product = "";
@@ -182,49 +201,6 @@ bool ProfileManager::GetDeviceTags(const DeviceBase* device, String& product, St
     return (!product.IsEmpty() && !serial.IsEmpty());
 }
 
-static JSON* FindTaggedData(JSON* data, const char** tag_names, const char** qtags, int num_qtags)
-{
-    if (data == NULL || !(data->Name == "TaggedData") || data->Type != JSON_Array)
-        return NULL;
-
-    JSON* tagged_item = data->GetFirstItem();
-    while (tagged_item)
-    {
-        JSON* tags = tagged_item->GetItemByName("tags");
-        if (tags->Type == JSON_Array && num_qtags == tags->GetArraySize())
-        {   // Check for a full tag match on each item
-            int num_matches = 0;
-            
-            for (int k=0; k<num_qtags; k++)
-            {
-                JSON* tag = tags->GetFirstItem();
-                while (tag)
-                {
-                    JSON* tagval = tag->GetFirstItem();
-                    if (tagval && tagval->Name == tag_names[k])
-                    {
-                        if (tagval->Value == qtags[k])
-                            num_matches++;
-                        break;
-                    }
-                    tag = tags->GetNextItem(tag);
-                }
-            }
-
-            // if all tags were matched then copy the values into this Profile
-            if (num_matches == num_qtags)
-            {
-                JSON* vals = tagged_item->GetItemByName("vals");
-                return vals;
-            }
-        }
-
-        tagged_item = data->GetNextItem(tagged_item);
-    }
-
-    return NULL;
-}
-
 static void FilterTaggedData(JSON* data, const char* tag_name, const char* qtag, Array<JSON*>& items)
 {
     if (data == NULL || !(data->Name == "TaggedData") || data->Type != JSON_Array)
@@ -262,14 +238,122 @@ static void FilterTaggedData(JSON* data, const char* tag_name, const char* qtag,
 
 ProfileManager::ProfileManager()
 {
-    Changed = false;
+    Changed      = false;
+    StoreChecked = false;
+    StoreStale   = false;
+    SourceKnown  = false;
 }
 
 ProfileManager::~ProfileManager()
 {
+    Save();
     ClearCache();
 }
 
+// The database is printed under ProfileLock and written without it, so that
+// other threads can keep using the profiles during the file write.
+bool ProfileManager::Save()
+{
+    Lock::Locker saveScope(&SaveLock);
+
+    ArrayPOD<char>  text;
+    ArrayPOD<UByte> store;
+    bool            writeText;
+    {
+        Lock::Locker lockScope(&ProfileLock);
+        if (ProfileCache == NULL || (!Changed && !StoreStale))
+            return true;
+
+        // The JSON file only needs writing if the database changed
+        writeText = Changed;
+        if (writeText)
+            ProfileCache->Print(&text, true);
+
+        Array<ProfileStore::TaggedValues> tagged;
+        for (Hash<String, JSON*, String::FastHashFunctor>::ConstIterator it = TaggedIndex.Begin();
+             it != TaggedIndex.End(); ++it)
+        {
+            ProfileStore::TaggedValues values;
+            values.Key   = it->First;
+            values.pVals = it->Second;
+            tagged.PushBack(values);
+        }
+        ProfileStore::Build(&store, UserItems, tagged);
+
+        Changed    = false;
+        StoreStale = false;
+    }
+
+    String path = GetProfilePath(true);
+    if (writeText && !JSON::SaveText(path, text.GetSize() ? &text[0] : "", text.GetSize()))
+    {
+        LogError("OVR::ProfileManager - can't write '%s'\n", path.ToCStr());
+
+        Lock::Locker lockScope(&ProfileLock);
+        Changed = true;
+        return false;
+    }
+
+    // The store is only used with the JSON file it was built from
+    FileStat source;
+    String   storePath = GetStorePath(false);
+    StatProfileFile(path, &source);
+    {   // Our own write isn't a change for ReloadIfChanged
+        Lock::Locker lockScope(&ProfileLock);
+        SourceStat  = source;
+        SourceKnown = true;
+    }
+    if (source.FileSize >= 0)
+    {
+        ProfileStore::SetSource(&store, source);
+        if (!JSON::SaveText(storePath, (const char*)&store[0], store.GetSize()))
+            LogError("OVR::ProfileManager - can't write '%s'\n", storePath.ToCStr());
+    }
+    return true;
+}
+
+bool ProfileManager::openStore()
+{
+    if (ProfileCache)
+        return false;
+
+    if (!StoreChecked)
+    {
+        StoreChecked = true;
+
+        StatProfileFile(GetProfilePath(false), &SourceStat);
+        SourceKnown = true;
+        if (SourceStat.FileSize >= 0)
+            Store.Open(GetStorePath(false), &SourceStat);
+    }
+    return Store.IsOpen();
+}
+
+bool ProfileManager::ReloadIfChanged()
+{
+    // Taken first, so that a save in progress records its write before we look
+    Lock::Locker saveScope(&SaveLock);
+    Lock::Locker lockScope(&ProfileLock);
+
+    if (!SourceKnown)
+        return false;   // nothing has been read that could be out of date
+
+    FileStat current;
+    StatProfileFile(GetProfilePath(false), &current);
+    if (current.FileSize == SourceStat.FileSize && current.ModifyTime == SourceStat.ModifyTime)
+        return false;
+
+    if (Changed)
+    {   // Unsaved changes are written over the file by the next Save
+        LogText("OVR::ProfileManager - profile database changed, keeping unsaved changes.\n");
+        SourceStat = current;
+        return false;
+    }
+
+    ClearCache();
+    return true;
+}
+
 ProfileManager* ProfileManager::Create()
 {
     return new ProfileManager();
@@ -285,9 +369,114 @@ void ProfileManager::ClearCache()
         //ProfileCache->Release();
         ProfileCache = NULL;
     }
+    Store.Close();
+    StoreChecked = false;
+    StoreStale   = false;
+    SourceKnown  = false;
+    UserIndex.Clear();
+    UserItems.Clear();
+    TaggedIndex.Clear();
     Changed = false;
 }
 
+// Indexes the "Users" items of the cache by user id
+void ProfileManager::indexUsers()
+{
+    UserIndex.Clear();
+    UserItems.Clear();
+
+    JSON* users = ProfileCache->GetItemByName("Users");
+    if (users == NULL)
+        return;
+
+    JSON* user_item = users->GetFirstItem();
+    while (user_item)
+    {
+        JSON* userid = user_item->GetItemByName(OVR_KEY_USER);
+        UserItems.PushBack(user_item);
+        if (userid && !UserIndex.Get(userid->Value))
+            UserIndex.Set(userid->Value, user_item);
+
+        user_item = users->GetNextItem(user_item);
+    }
+}
+
+// Indexes the "TaggedData" items of the cache by tag set
+void ProfileManager::indexTaggedData()
+{
+    TaggedIndex.Clear();
+
+    JSON* data = ProfileCache->GetItemByName("TaggedData");
+    if (data == NULL || data->Type != JSON_Array)
+        return;
+
+    JSON* tagged_item = data->GetFirstItem();
+    while (tagged_item)
+    {
+        indexTaggedItem(tagged_item);
+        tagged_item = data->GetNextItem(tagged_item);
+    }
+}
+
+void ProfileManager::indexTaggedItem(JSON* tagged_item)
+{
+    JSON* tags = tagged_item->GetItemByName("tags");
+    JSON* vals = tagged_item->GetItemByName("vals");
+    if (tags == NULL || tags->Type != JSON_Array || vals == NULL)
+        return;
+
+    Array<const char*> tag_names;
+    Array<const char*> tag_values;
+    JSON* tag = tags->GetFirstItem();
+    while (tag)
+    {
+        JSON* tagval = tag->GetFirstItem();
+        if (tagval)
+        {
+            tag_names.PushBack(tagval->Name.ToCStr());
+            tag_values.PushBack(tagval->Value.ToCStr());
+        }
+        tag = tags->GetNextItem(tag);
+    }
+    if (tag_names.GetSize() != (UPInt)tags->GetArraySize())
+        return;   // tags without a value never match a query
+
+    // The first item with a given tag set is the one that's used
+    ProfileStore::MakeTagKey(&KeyBuffer, tag_names.GetSize() ? &tag_names[0] : NULL,
+                             tag_names.GetSize() ? &tag_values[0] : NULL, (int)tag_names.GetSize());
+    if (!TaggedIndex.GetAlt(KeyBuffer.ToCStr()))
+        TaggedIndex.Set(String(KeyBuffer.ToCStr(), KeyBuffer.GetSize()), vals);
+}
+
+JSON* ProfileManager::findTaggedData(const char** tag_names, const char** tags, int num_tags)
+{
+    ProfileStore::MakeTagKey(&KeyBuffer, tag_names, tags, num_tags);
+    JSON** vals = TaggedIndex.GetAlt(KeyBuffer.ToCStr());
+    return vals ? *vals : NULL;
+}
+
+bool ProfileManager::loadTaggedValues(const char** tag_names, const char** tags, int num_tags,
+                                      Profile* profile)
+{
+    if (ProfileCache == NULL)
+    {
+        ProfileStore::MakeTagKey(&KeyBuffer, tag_names, tags, num_tags);
+        return Store.LoadValues(KeyBuffer.ToCStr(), profile);
+    }
+
+    JSON* vals = findTaggedData(tag_names, tags, num_tags);
+    if (vals == NULL)
+        return false;
+
+    JSON* item = vals->GetFirstItem();
+    while (item)
+    {
+        profile->SetValue(item);
+        item = vals->GetNextItem(item);
+    }
+    return true;
+}
+
 // Returns a profile with all system default values
 Profile* ProfileManager::GetDefaultProfile(const DeviceBase* device)
 {
@@ -322,9 +511,13 @@ void ProfileManager::LoadCache(bool create)
 {
     Lock::Locker lockScope(&ProfileLock);
 
+    // A store that matched the JSON file doesn't need rewriting
+    bool storeCurrent = Store.IsOpen();
     ClearCache();
 
     String path = GetProfilePath(false);
+    StatProfileFile(path, &SourceStat);
+    SourceKnown = true;
 
     Ptr<JSON> root = *JSON::Load(path);
     if (root == NULL)
@@ -332,6 +525,20 @@ void ProfileManager::LoadCache(bool create)
         path = GetBaseOVRPath(false) + "/Profiles.json";  // look for legacy profile
         root = *JSON::Load(path);
         
+        if (root == NULL && Store.Open(GetStorePath(false), NULL))
+        {   // Only the binary store is left; convert it back
+            root = *Store.CreateJSON();
+            Store.Close();
+            if (root)
+            {
+                ProfileCache = root;
+                indexUsers();
+                indexTaggedData();
+                Changed = true;
+                return;
+            }
+        }
+
         if (root == NULL)
         {
             if (create)
@@ -341,6 +548,8 @@ void ProfileManager::LoadCache(bool create)
                 root->AddItem("Users", JSON::CreateArray());
                 root->AddItem("TaggedData", JSON::CreateArray());
                 ProfileCache = root;
+                indexUsers();
+                indexTaggedData();
             }
             
             return;
@@ -350,7 +559,7 @@ void ProfileManager::LoadCache(bool create)
         JSON* version_item = root->GetFirstItem();
         if (version_item->Name == "Oculus Profile Version")
         {
-            int major = atoi(version_item->Value.ToCStr());
+            int major = version_item->GetMajorVersion();
             if (major != 1)
                 return;   // don't use the file on unsupported major version number
         }
@@ -368,7 +577,7 @@ void ProfileManager::LoadCache(bool create)
         JSON* version_item = root->GetFirstItem();
         if (version_item->Name == "Oculus Profile Version")
         {
-            int major = atoi(version_item->Value.ToCStr());
+            int major = version_item->GetMajorVersion();
             if (major != 2)
                 return;   // don't use the file on unsupported major version number
         }
@@ -378,6 +587,9 @@ void ProfileManager::LoadCache(bool create)
         }
 
         ProfileCache = root;   // store the database contents for traversal
+        indexUsers();
+        indexTaggedData();
+        StoreStale = !storeCurrent;
     }
 }
 
@@ -393,6 +605,8 @@ void ProfileManager::LoadV1Profiles(JSON* v1)
     root->AddItem("Users", JSON::CreateArray());
     root->AddItem("TaggedData", JSON::CreateArray());
     ProfileCache = root;
+    indexUsers();
+    indexTaggedData();
 
     const char* default_dk1_user = item1->Value;
     
@@ -518,17 +732,17 @@ int ProfileManager::GetUserCount()
     Lock::Locker lockScope(&ProfileLock);
 
     if (ProfileCache == NULL)
-    {   // Load the cache
+    {
+        if (openStore())
+            return (int)Store.GetUserCount();
+
+        // Load the cache
         LoadCache(false);
         if (ProfileCache == NULL)
             return 0;
     }
 
-    JSON* users = ProfileCache->GetItemByName("Users");
-    if (users == NULL)
-        return 0;
-
-    return users->GetItemCount();
+    return (int)UserItems.GetSize();
 }
 
 bool ProfileManager::CreateUser(const char* user, const char* name)
@@ -551,29 +765,28 @@ bool ProfileManager::CreateUser(const char* user, const char* name)
     }
 
     // Search for the pre-existence of this user
-    JSON* user_item = users->GetFirstItem();
-    int index = 0;
-    while (user_item)
-    {
-        JSON* userid = user_item->GetItemByName("User");
-        int compare = OVR_strcmp(user, userid->Value);
-        if (compare == 0)
-        {   // The user already exists so simply update the fields
-            JSON* name_item = user_item->GetItemByName("Name");
-            if (name_item && OVR_strcmp(name, name_item->Value) != 0)
-            {
-                name_item->Value = name;
-                Changed = true;
-            }
-            return true;
-        }
-        else if (compare < 0)
-        {   // A new user should be placed before this item
-            break;
+    JSON** existing = UserIndex.GetAlt(user);
+    if (existing)
+    {   // The user already exists so simply update the fields
+        JSON* name_item = (*existing)->GetItemByName("Name");
+        if (name_item && OVR_strcmp(name, name_item->Value) != 0)
+        {
+            name_item->Value = name;
+            Changed = true;
         }
-        
-        user_item = users->GetNextItem(user_item);
-        index++;
+        return true;
+    }
+
+    // Users are kept sorted by id; find the first one that goes after the new user
+    UPInt lower = 0, upper = UserItems.GetSize();
+    while (lower < upper)
+    {
+        UPInt  middle = (lower + upper) / 2;
+        JSON*  userid = UserItems[middle]->GetItemByName(OVR_KEY_USER);
+        if (userid && OVR_strcmp(user, userid->Value) < 0)
+            upper = middle;
+        else
+            lower = middle + 1;
     }
 
     // Create and fill the user struct
@@ -582,34 +795,41 @@ bool ProfileManager::CreateUser(const char* user, const char* name)
     new_user->AddStringItem(OVR_KEY_NAME, name);
     // user_item->AddStringItem("Password", password);
 
-    if (user_item == NULL)
+    if (lower == UserItems.GetSize())
         users->AddArrayElement(new_user);
     else
-        users->InsertArrayElement(index, new_user);
+        UserItems[lower]->InsertNodeBefore(new_user);
+
+    UserItems.InsertAt(lower, new_user);
+    UserIndex.Set(user, new_user);
 
     Changed = true;
     return true;
 }
 
-// Returns the user id of a specific user in the list.  The returned 
-// memory is locally allocated and should not be stored or deleted.  Returns NULL
-// if the index is invalid
-const char* ProfileManager::GetUser(unsigned int index)
+// Returns the user id of a specific user in the list, copied so that it outlives
+// a reload of the database. Returns an empty string if the index is invalid
+String ProfileManager::GetUser(unsigned int index)
 {
     Lock::Locker lockScope(&ProfileLock);
 
     if (ProfileCache == NULL)
-    {   // Load the cache
+    {
+        if (openStore())
+        {
+            const char* user = Store.GetUser(index);
+            return user ? String(user) : String();
+        }
+
+        // Load the cache
         LoadCache(false);
         if (ProfileCache == NULL)
-            return NULL;
+            return String();
     }
 
-    JSON* users = ProfileCache->GetItemByName("Users");
-    
-    if (users && index < users->GetItemCount())
+    if (index < UserItems.GetSize())
     {
-        JSON* user_item = users->GetItemByIndex(index);
+        JSON* user_item = UserItems[index];
         if (user_item)
         {
             JSON* user = user_item->GetFirstItem();
@@ -617,13 +837,13 @@ const char* ProfileManager::GetUser(unsigned int index)
             {
                 JSON* userid = user_item->GetItemByName(OVR_KEY_USER);
                 if (userid)
-                    return userid->Value.ToCStr();
+                    return userid->Value;
             }
         }
     }
     
 
-    return NULL;
+    return String();
 }
 
 bool ProfileManager::RemoveUser(const char* user)
@@ -642,19 +862,23 @@ bool ProfileManager::RemoveUser(const char* user)
         return true;
 
     // Remove this user from the User table
-    JSON* user_item = users->GetFirstItem();
-    while (user_item)
-    {
-        JSON* userid = user_item->GetItemByName("User");
-        if (OVR_strcmp(user, userid->Value) == 0)
-        {   // Delete the user entry
-            user_item->RemoveNode();
-            user_item->Release();
-            Changed = true;
-            break;
+    JSON** existing = UserIndex.GetAlt(user);
+    if (existing)
+    {   // Delete the user entry
+        JSON* user_item = *existing;
+        for (UPInt i=0; i<UserItems.GetSize(); i++)
+        {
+            if (UserItems[i] == user_item)
+            {
+                UserItems.RemoveAt(i);
+                break;
+            }
         }
-        
-        user_item = users->GetNextItem(user_item);
+        UserIndex.Remove(user);
+
+        user_item->RemoveNode();
+        user_item->Release();
+        Changed = true;
     }
 
     // Now remove all data entries with this user tag
@@ -667,6 +891,8 @@ bool ProfileManager::RemoveUser(const char* user)
         user_items[i]->Release();
         Changed = true;
     }
+    if (user_items.GetSize())
+        indexTaggedData();
  
     return Changed;
 }
@@ -677,8 +903,9 @@ Profile* ProfileManager::CreateProfile()
     return profile;
 }
 
-// Returns the name of the profile that is marked as the current default user.
-const char* ProfileManager::GetDefaultUser(const DeviceBase* device)
+// Returns the name of the profile that is marked as the current default user,
+// or an empty string.
+String ProfileManager::GetDefaultUser(const DeviceBase* device)
 {
     const char* tag_names[2] = {"Product", "Serial"};
     const char* tags[2];
@@ -686,7 +913,7 @@ const char* ProfileManager::GetDefaultUser(const DeviceBase* device)
     String product;
     String serial;
     if (!GetDeviceTags(device, product, serial))
-        return NULL;
+        return String();
 
     const char* product_str = product.IsEmpty() ? NULL : product.ToCStr();
     const char* serial_str = serial.IsEmpty() ? NULL : serial.ToCStr();
@@ -706,14 +933,11 @@ const char* ProfileManager::GetDefaultUser(const DeviceBase* device)
         {   
             const char* user = p->GetValue("DefaultUser");
             if (user != NULL && user[0] != 0)
-            {
-                TempBuff = user;
-                return TempBuff.ToCStr();
-            }
+                return String(user);
         }
     }
 
-    return NULL;
+    return String();
 }
 
 //-----------------------------------------------------------------------------
@@ -748,32 +972,25 @@ Profile* ProfileManager::GetTaggedProfile(const char** tag_names, const char** t
 {
     Lock::Locker lockScope(&ProfileLock);
 
-    if (ProfileCache == NULL)
+    if (ProfileCache == NULL && !openStore())
     {   // Load the cache
         LoadCache(false);
         if (ProfileCache == NULL)
             return NULL;
     }
 
-    JSON* tagged_data = ProfileCache->GetItemByName("TaggedData");
-    OVR_ASSERT(tagged_data);
-    if (tagged_data == NULL)
-        return NULL;
+    if (ProfileCache)
+    {
+        JSON* tagged_data = ProfileCache->GetItemByName("TaggedData");
+        OVR_ASSERT(tagged_data);
+        if (tagged_data == NULL)
+            return NULL;
+    }
     
     Profile* profile = new Profile();
     
-    JSON* vals = FindTaggedData(tagged_data, tag_names, tags, num_tags);
-    if (vals)
+    if (loadTaggedValues(tag_names, tags, num_tags, profile))
     {   
-        JSON* item = vals->GetFirstItem();
-        while (item)
-        {
-            //printf("Add %s, %s\n", item->Name.ToCStr(), item->Value.ToCStr());
-            //profile->Settings.Set(item->Name, item->Value);
-            profile->SetValue(item);
-            item = vals->GetNextItem(item);
-        }
-
         return profile;
     }
     else
@@ -801,7 +1018,7 @@ bool ProfileManager::SetTaggedProfile(const char** tag_names, const char** tags,
         return false;
 
     // Get the cached tagged data section
-    JSON* vals = FindTaggedData(tagged_data, tag_names, tags, num_tags);
+    JSON* vals = findTaggedData(tag_names, tags, num_tags);
     if (vals == NULL)
     {  
         JSON* tagged_item = JSON::CreateObject();
@@ -818,12 +1035,13 @@ bool ProfileManager::SetTaggedProfile(const char** tag_names, const char** tags,
         tagged_item->AddItem("tags", taglist);
         tagged_item->AddItem("vals", vals);
         tagged_data->AddArrayElement(tagged_item);
+        indexTaggedItem(tagged_item);
     }
 
     // Now add or update each profile setting in cache
     for (unsigned int i=0; i<profile->Values.GetSize(); i++)
     {
-        JSON* value = profile->Values[i];
+        Ptr<JSON> value = *Profile::createJSON(profile->Values[i]);
         
         bool found = false;
         JSON* item = vals->GetFirstItem();
@@ -920,7 +1138,7 @@ Profile* ProfileManager::GetProfile(const DeviceBase* device, const char* user)
 {
     Lock::Locker lockScope(&ProfileLock);
 
-    if (ProfileCache == NULL)
+    if (ProfileCache == NULL && !openStore())
     {   // Load the cache
         LoadCache(false);
         if (ProfileCache == NULL)
@@ -947,7 +1165,7 @@ Profile* ProfileManager::GetProfile(const DeviceBase* device, const char* user)
         const char* product_str = product.IsEmpty() ? NULL : product.ToCStr();
         const char* serial_str = serial.IsEmpty() ? NULL : serial.ToCStr();
 
-        if (!profile->LoadProfile(ProfileCache.GetPtr(), user, product_str, serial_str))
+        if (!profile->LoadProfile(this, user, product_str, serial_str))
         {
             profile->Release();
             return NULL;
@@ -964,7 +1182,7 @@ Profile::~Profile()
 {
     ValMap.Clear();
     for (unsigned int i=0; i<Values.GetSize(); i++)
-        Values[i]->Release();
+        delete Values[i];
 
     Values.Clear();
 }
@@ -976,21 +1194,16 @@ bool Profile::Close()
 }
 
 //-----------------------------------------------------------------------------
-void Profile::CopyItems(JSON* root, String prefix)
+void Profile::CopyItems(JSON* root)
 {
+    // Settings are keyed by their own name, however deeply they're nested
     JSON* item = root->GetFirstItem();
     while (item)
     {
-        String item_name;
-        if (prefix.IsEmpty())
-            item_name = item->Name;
-        else
-            item_name = prefix + "." + item->Name;
-
         if (item->Type == JSON_Object)
         {   // recursively copy the children
             
-            CopyItems(item, item_name);
+            CopyItems(item);
         }
         else
         {
@@ -1020,7 +1233,7 @@ bool Profile::LoadDeviceFile(unsigned int device_id, const char* serial)
     JSON* version = root->GetFirstItem();
     if (version && version->Name == "Oculus Device Profile Version")
     {   
-        int major = atoi(version->Value.ToCStr());
+        int major = version->GetMajorVersion();
         if (major > MAX_DEVICE_PROFILE_MAJOR_VERSION)
             return false;   // don't parse the file on unsupported major version number
     }
@@ -1041,7 +1254,7 @@ bool Profile::LoadDeviceFile(unsigned int device_id, const char* serial)
                 && (product_item->dValue == device_id) && (serial_item->Value == serial))
             {   
                 // found the entry for this device so recursively copy all the settings to the profile
-                CopyItems(device, "");
+                CopyItems(device);
                 return true;   
             }
         }
@@ -1110,7 +1323,7 @@ bool Profile::LoadDeviceProfile(const DeviceBase* device)
 }
 
 //-----------------------------------------------------------------------------
-bool Profile::LoadUser(JSON* root, 
+bool Profile::LoadUser(ProfileManager* manager,
                          const char* user,
                           const char* model_name,
                           const char* device_serial)
@@ -1123,52 +1336,38 @@ bool Profile::LoadUser(JSON* root,
     //    model_name = "RiftDK1";
     
     bool user_found = false;
-    JSON* data = root->GetItemByName("TaggedData");
-    if (data)
-    {   
-        const char* tag_names[3];
-        const char* tags[3];
-        tag_names[0] = "User";
-        tags[0] = user;
-        int num_tags = 1;
+    const char* tag_names[3];
+    const char* tags[3];
+    tag_names[0] = "User";
+    tags[0] = user;
+    int num_tags = 1;
 
-        if (model_name)
-        {
-            tag_names[num_tags] = "Product";
-            tags[num_tags] = model_name;
-            num_tags++;
-        }
+    if (model_name)
+    {
+        tag_names[num_tags] = "Product";
+        tags[num_tags] = model_name;
+        num_tags++;
+    }
 
-        if (device_serial)
-        {
-            tag_names[num_tags] = "Serial";
-            tags[num_tags] = device_serial;
-            num_tags++;
-        }
+    if (device_serial)
+    {
+        tag_names[num_tags] = "Serial";
+        tags[num_tags] = device_serial;
+        num_tags++;
+    }
 
-        // Retrieve all tag permutations
-        for (int combos=1; combos<=num_tags; combos++)
+    // Retrieve all tag permutations
+    for (int combos=1; combos<=num_tags; combos++)
+    {
+        for (int i=0; i<(num_tags - combos + 1); i++)
         {
-            for (int i=0; i<(num_tags - combos + 1); i++)
-            {
-                JSON* vals = FindTaggedData(data, tag_names+i, tags+i, combos);
-                if (vals)
-                {   
-                    if (i==0)   // This tag-combination contains a user match
-                        user_found = true;
-
-                    // Add the values to the Profile.  More specialized multi-tag values
-                    // will take precedence over and overwrite generalized ones 
-                    // For example: ("Me","RiftDK1").IPD would overwrite ("Me").IPD
-                    JSON* item = vals->GetFirstItem();
-                    while (item)
-                    {
-                        //printf("Add %s, %s\n", item->Name.ToCStr(), item->Value.ToCStr());
-                        //Settings.Set(item->Name, item->Value);
-                        SetValue(item);
-                        item = vals->GetNextItem(item);
-                    }
-                }
+            // Add the values to the Profile.  More specialized multi-tag values
+            // will take precedence over and overwrite generalized ones 
+            // For example: ("Me","RiftDK1").IPD would overwrite ("Me").IPD
+            if (manager->loadTaggedValues(tag_names+i, tags+i, combos, this))
+            {   
+                if (i==0)   // This tag-combination contains a user match
+                    user_found = true;
             }
         }
     }
@@ -1181,25 +1380,95 @@ bool Profile::LoadUser(JSON* root,
 
 
 //-----------------------------------------------------------------------------
-bool Profile::LoadProfile(JSON* root,
+bool Profile::LoadProfile(ProfileManager* manager,
                           const char* user,
                           const char* device_model,
                           const char* device_serial)
 {
-    if (!LoadUser(root, user, device_model, device_serial))
+    if (!LoadUser(manager, user, device_model, device_serial))
         return false;
 
     return true;
 }
 
 
+//-----------------------------------------------------------------------------
+// Fills numbers with the leading numbers of a JSON array. Returns true if the
+// array holds nothing else.
+static bool CollectArrayNumbers(ArrayPOD<double>* numbers, JSON* array)
+{
+    numbers->Clear();
+
+    JSON* item = array->GetFirstItem();
+    while (item && item->Type == JSON_Number)
+    {
+        numbers->PushBack(item->dValue);
+        item = array->GetNextItem(item);
+    }
+    return item == NULL;
+}
+
+//-----------------------------------------------------------------------------
+Profile::ProfileValue::~ProfileValue()
+{
+    if (pArray)
+        pArray->Release();
+}
+
+//-----------------------------------------------------------------------------
+Profile::ProfileValue* Profile::findOrAdd(const char* key, ProfileValue::ValueType type)
+{
+    ProfileValue* value = NULL;
+    if (!ValMap.GetAlt(key, &value))
+    {
+        value = new ProfileValue(key, type);
+        Values.PushBack(value);
+        // The map's key shares the name's buffer
+        ValMap.Set(value->Name, value);
+    }
+    return value;
+}
+
+//-----------------------------------------------------------------------------
+JSON* Profile::createJSON(const ProfileValue* value)
+{
+    JSON* item = NULL;
+    switch (value->Type)
+    {
+    case ProfileValue::Value_String:
+        item = JSON::CreateString(value->Str);
+        break;
+    case ProfileValue::Value_Bool:
+        item = JSON::CreateBool(value->Numbers[0] != 0);
+        break;
+    case ProfileValue::Value_Number:
+        item = JSON::CreateNumber(value->Numbers[0]);
+        break;
+    case ProfileValue::Value_Array:
+        if (value->pArray)
+        {
+            item = value->pArray->Copy();
+        }
+        else
+        {
+            item = JSON::CreateArray();
+            for (UPInt i=0; i<value->Numbers.GetSize(); i++)
+                item->AddArrayNumber(value->Numbers[i]);
+        }
+        break;
+    }
+
+    item->Name = value->Name;
+    return item;
+}
+
 //-----------------------------------------------------------------------------
 char* Profile::GetValue(const char* key, char* val, int val_length) const
 {
-    JSON* value = NULL;
-    if (ValMap.Get(key, &value))
+    ProfileValue* value = NULL;
+    if (ValMap.GetAlt(key, &value))
     {
-        OVR_strcpy(val, val_length, value->Value.ToCStr());
+        OVR_strcpy(val, val_length, value->Str.ToCStr());
         return val;
     }
     else
@@ -1214,10 +1483,10 @@ const char* Profile::GetValue(const char* key)
 {
     // Non-reentrant query.  The returned buffer can only be used until the next call
     // to GetValue()
-    JSON* value = NULL;
-    if (ValMap.Get(key, &value))
+    ProfileValue* value = NULL;
+    if (ValMap.GetAlt(key, &value))
     {
-        TempVal = value->Value;
+        TempVal = value->Str;
         return TempVal.ToCStr();
     }
     else
@@ -1229,11 +1498,11 @@ const char* Profile::GetValue(const char* key)
 //-----------------------------------------------------------------------------
 int Profile::GetNumValues(const char* key) const
 {
-    JSON* value = NULL;
-    if (ValMap.Get(key, &value))
+    ProfileValue* value = NULL;
+    if (ValMap.GetAlt(key, &value))
     {  
-        if (value->Type == JSON_Array)
-            return value->GetArraySize();
+        if (value->Type == ProfileValue::Value_Array)
+            return value->pArray ? value->pArray->GetArraySize() : (int)value->Numbers.GetSize();
         else
             return 1;
     }
@@ -1244,9 +1513,9 @@ int Profile::GetNumValues(const char* key) const
 //-----------------------------------------------------------------------------
 bool Profile::GetBoolValue(const char* key, bool default_val) const
 {
-    JSON* value = NULL;
-    if (ValMap.Get(key, &value) && value->Type == JSON_Bool)
-        return (value->dValue != 0);
+    ProfileValue* value = NULL;
+    if (ValMap.GetAlt(key, &value) && value->Type == ProfileValue::Value_Bool)
+        return (value->Numbers[0] != 0);
     else
         return default_val;
 }
@@ -1254,9 +1523,9 @@ bool Profile::GetBoolValue(const char* key, bool default_val) const
 //-----------------------------------------------------------------------------
 int Profile::GetIntValue(const char* key, int default_val) const
 {
-    JSON* value = NULL;
-    if (ValMap.Get(key, &value) && value->Type == JSON_Number)
-        return (int)(value->dValue);
+    ProfileValue* value = NULL;
+    if (ValMap.GetAlt(key, &value) && value->Type == ProfileValue::Value_Number)
+        return (int)(value->Numbers[0]);
     else
         return default_val;
 }
@@ -1264,9 +1533,9 @@ int Profile::GetIntValue(const char* key, int default_val) const
 //-----------------------------------------------------------------------------
 float Profile::GetFloatValue(const char* key, float default_val) const
 {
-    JSON* value = NULL;
-    if (ValMap.Get(key, &value) && value->Type == JSON_Number)
-        return (float)(value->dValue);
+    ProfileValue* value = NULL;
+    if (ValMap.GetAlt(key, &value) && value->Type == ProfileValue::Value_Number)
+        return (float)(value->Numbers[0]);
     else
         return default_val;
 }
@@ -1274,23 +1543,12 @@ float Profile::GetFloatValue(const char* key, float default_val) const
 //-----------------------------------------------------------------------------
 int Profile::GetFloatValues(const char* key, float* values, int num_vals) const
 {
-    JSON* value = NULL;
-    if (ValMap.Get(key, &value) && value->Type == JSON_Array)
+    ProfileValue* value = NULL;
+    if (ValMap.GetAlt(key, &value) && value->Type == ProfileValue::Value_Array)
     {
-        int val_count = Alg::Min(value->GetArraySize(), num_vals);
-        JSON* item = value->GetFirstItem();
-        int count=0;
-        while (item && count < val_count)
-        {
-            if (item->Type == JSON_Number)
-                values[count] = (float)item->dValue;
-            else
-                break;
-
-            count++;
-            item = value->GetNextItem(item);
-        }
-
+        int count = Alg::Min((int)value->Numbers.GetSize(), num_vals);
+        for (int i=0; i<count; i++)
+            values[i] = (float)value->Numbers[i];
         return count;
     }
     else
@@ -1302,9 +1560,9 @@ int Profile::GetFloatValues(const char* key, float* values, int num_vals) const
 //-----------------------------------------------------------------------------
 double Profile::GetDoubleValue(const char* key, double default_val) const
 {
-    JSON* value = NULL;
-    if (ValMap.Get(key, &value) && value->Type == JSON_Number)
-        return value->dValue;
+    ProfileValue* value = NULL;
+    if (ValMap.GetAlt(key, &value) && value->Type == ProfileValue::Value_Number)
+        return value->Numbers[0];
     else
         return default_val;
 }
@@ -1312,23 +1570,12 @@ double Profile::GetDoubleValue(const char* key, double default_val) const
 //-----------------------------------------------------------------------------
 int Profile::GetDoubleValues(const char* key, double* values, int num_vals) const
 {
-    JSON* value = NULL;
-    if (ValMap.Get(key, &value) && value->Type == JSON_Array)
+    ProfileValue* value = NULL;
+    if (ValMap.GetAlt(key, &value) && value->Type == ProfileValue::Value_Array)
     {
-        int val_count = Alg::Min(value->GetArraySize(), num_vals);
-        JSON* item = value->GetFirstItem();
-        int count=0;
-        while (item && count < val_count)
-        {
-            if (item->Type == JSON_Number)
-                values[count] = item->dValue;
-            else
-                break;
-
-            count++;
-            item = value->GetNextItem(item);
-        }
-
+        int count = Alg::Min((int)value->Numbers.GetSize(), num_vals);
+        if (count > 0)
+            memcpy(values, &value->Numbers[0], count * sizeof(double));
         return count;
     }
     else
@@ -1340,6 +1587,7 @@ int Profile::GetDoubleValues(const char* key, double* values, int num_vals) cons
 //-----------------------------------------------------------------------------
 void Profile::SetValue(JSON* val)
 {
+    ChangeCount++;
     if (val->Type == JSON_Number)
         SetDoubleValue(val->Name, val->dValue);
     else if (val->Type == JSON_Bool)
@@ -1348,55 +1596,63 @@ void Profile::SetValue(JSON* val)
         SetValue(val->Name, val->Value);
     else if (val->Type == JSON_Array)
     {
-        if (val == NULL)
+        ProfileValue* value = findOrAdd(val->Name, ProfileValue::Value_Array);
+        if (value->Type != ProfileValue::Value_Array)
             return;
 
-        // Create a copy of the array
-        JSON* value = val->Copy();
-        Values.PushBack(value);
-        ValMap.Set(value->Name, value);
+        if (value->pArray)
+        {
+            value->pArray->Release();
+            value->pArray = NULL;
+        }
+
+        // Keep a copy of arrays that hold more than numbers
+        if (!CollectArrayNumbers(&value->Numbers, val))
+            value->pArray = val->Copy();
     }
 }
 
 //-----------------------------------------------------------------------------
-void Profile::SetValue(const char* key, const char* val)
+void Profile::setArrayValue(const char* key, const double* vals, int num_vals)
 {
-    if (key == NULL || val == NULL)
+    ChangeCount++;
+    ProfileValue* value = findOrAdd(key, ProfileValue::Value_Array);
+    if (value->Type != ProfileValue::Value_Array)
         return;
 
-    JSON* value = NULL;
-    if (ValMap.Get(key, &value))
+    if (value->pArray)
     {
-        value->Value = val;
+        value->pArray->Release();
+        value->pArray = NULL;
     }
-    else
-    {
-        value = JSON::CreateString(val);
-        value->Name = key;
 
-        Values.PushBack(value);
-        ValMap.Set(key, value);
-    }
+    value->Numbers.Resize(num_vals);
+    if (num_vals > 0)
+        memcpy(&value->Numbers[0], vals, num_vals * sizeof(double));
+}
+
+//-----------------------------------------------------------------------------
+void Profile::SetValue(const char* key, const char* val)
+{
+    ChangeCount++;
+    if (key == NULL || val == NULL)
+        return;
+
+    findOrAdd(key, ProfileValue::Value_String)->Str = val;
 }
 
 //-----------------------------------------------------------------------------
 void Profile::SetBoolValue(const char* key, bool val)
 {
+    ChangeCount++;
     if (key == NULL)
         return;
 
-    JSON* value = NULL;
-    if (ValMap.Get(key, &value))
+    ProfileValue* value = findOrAdd(key, ProfileValue::Value_Bool);
+    if (value->Type == ProfileValue::Value_Bool || value->Type == ProfileValue::Value_Number)
     {
-        value->dValue = val;
-    }
-    else
-    {
-        value = JSON::CreateBool(val);
-        value->Name = key;
-
-        Values.PushBack(value);
-        ValMap.Set(key, value);
+        value->Numbers.Resize(1);
+        value->Numbers[0] = val;
     }
 }
 
@@ -1415,103 +1671,60 @@ void Profile::SetFloatValue(const char* key, float val)
 //-----------------------------------------------------------------------------
 void Profile::SetFloatValues(const char* key, const float* vals, int num_vals)
 {
-    JSON* value = NULL;
-    int val_count = 0;
-    if (ValMap.Get(key, &value))
-    {
-        if (value->Type == JSON_Array)
-        {
-            // truncate the existing array if fewer entries provided
-            int num_existing_vals = value->GetArraySize();
-            for (int i=num_vals; i<num_existing_vals; i++)
-                value->RemoveLast();
-            
-            JSON* item = value->GetFirstItem();
-            while (item && val_count < num_vals)
-            {
-                if (item->Type == JSON_Number)
-                    item->dValue = vals[val_count];
-
-                item = value->GetNextItem(item);
-                val_count++;
-            }
-        }
-        else
-        {
-            return;  // Maybe we should change the data type?
-        }
-    }
-    else
-    {
-        value = JSON::CreateArray();
-        value->Name = key;
-
-        Values.PushBack(value);
-        ValMap.Set(key, value);
-    }
+    ArrayPOD<double> dvals;
+    dvals.Resize(num_vals);
+    for (int i=0; i<num_vals; i++)
+        dvals[i] = vals[i];
 
-    for (; val_count < num_vals; val_count++)
-        value->AddArrayNumber(vals[val_count]);
+    SetDoubleValues(key, num_vals ? &dvals[0] : NULL, num_vals);
 }
 
 //-----------------------------------------------------------------------------
 void Profile::SetDoubleValue(const char* key, double val)
 {
-    JSON* value = NULL;
-    if (ValMap.Get(key, &value))
-    {
-        value->dValue = val;
-    }
-    else
+    ChangeCount++;
+    ProfileValue* value = findOrAdd(key, ProfileValue::Value_Number);
+    if (value->Type == ProfileValue::Value_Bool || value->Type == ProfileValue::Value_Number)
     {
-        value = JSON::CreateNumber(val);
-        value->Name = key;
-
-        Values.PushBack(value);
-        ValMap.Set(key, value);
+        value->Numbers.Resize(1);
+        value->Numbers[0] = val;
     }
 }
 
 //-----------------------------------------------------------------------------
 void Profile::SetDoubleValues(const char* key, const double* vals, int num_vals)
 {
-    JSON* value = NULL;
-    int val_count = 0;
-    if (ValMap.Get(key, &value))
-    {
-        if (value->Type == JSON_Array)
+    ChangeCount++;
+    ProfileValue* value = findOrAdd(key, ProfileValue::Value_Array);
+    if (value->Type != ProfileValue::Value_Array)
+        return;  // Maybe we should change the data type?
+
+    if (value->pArray)
+    {   // Overwrite the numbers in the copy and truncate it, as for numeric arrays
+        int num_existing_vals = value->pArray->GetArraySize();
+        for (int i=num_vals; i<num_existing_vals; i++)
+            value->pArray->RemoveLast();
+
+        int val_count = 0;
+        JSON* item = value->pArray->GetFirstItem();
+        while (item && val_count < num_vals)
         {
-            // truncate the existing array if fewer entries provided
-            int num_existing_vals = value->GetArraySize();
-            for (int i=num_vals; i<num_existing_vals; i++)
-                value->RemoveLast();
-            
-            JSON* item = value->GetFirstItem();
-            while (item && val_count < num_vals)
-            {
-                if (item->Type == JSON_Number)
-                    item->dValue = vals[val_count];
+            if (item->Type == JSON_Number)
+                item->dValue = vals[val_count];
 
-                item = value->GetNextItem(item);
-                val_count++;
-            }
-        }
-        else
-        {
-            return;  // Maybe we should change the data type?
+            item = value->pArray->GetNextItem(item);
+            val_count++;
         }
-    }
-    else
-    {
-        value = JSON::CreateArray();
-        value->Name = key;
+        for (; val_count < num_vals; val_count++)
+            value->pArray->AddArrayNumber(vals[val_count]);
 
-        Values.PushBack(value);
-        ValMap.Set(key, value);
+        CollectArrayNumbers(&value->Numbers, value->pArray);
+        return;
     }
 
-    for (; val_count < num_vals; val_count++)
-        value->AddArrayNumber(vals[val_count]);
+    value->Numbers.Resize(num_vals);
+    if (num_vals > 0)
+        memcpy(&value->Numbers[0], vals, num_vals * sizeof(double));
 }
 
 }  // OVR
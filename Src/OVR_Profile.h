@@ -38,6 +38,7 @@ limitations under the License.
 #include "Kernel/OVR_RefCount.h"
 #include "Kernel/OVR_Array.h"
 #include "Kernel/OVR_StringHash.h"
+#include "OVR_ProfileStore.h"
 
 namespace OVR {
 
@@ -66,22 +67,46 @@ class JSON;
 // }   // Profile will be destroyed and any disk I/O completed when going out of scope
 class ProfileManager : public RefCountBase<ProfileManager>
 {
+public:
+    OVR_MEMORY_REDEFINE_NEW_TAGGED(AllocSubsystem_Profile)
+
 protected:
     // Synchronize ProfileManager access since it may be accessed from multiple threads,
     // as it's shared through DeviceManager.
     Lock                ProfileLock;
+    // Held across a whole Save, so that saves are written in order.
+    Lock                SaveLock;
     Ptr<JSON>           ProfileCache;
     bool                Changed;
-    String              TempBuff;
+
+    // Indexes over ProfileCache, updated along with it.
+    // User id to its "Users" item, and the "Users" items in order.
+    Hash<String, JSON*, String::FastHashFunctor>   UserIndex;
+    ArrayPOD<JSON*>                                UserItems;
+    // Tag set key, from ProfileStore::MakeTagKey, to the "vals" of its
+    // "TaggedData" item.
+    Hash<String, JSON*, String::FastHashFunctor>   TaggedIndex;
+    // Tag set keys are built here for lookups, so that they don't allocate.
+    StringBuffer        KeyBuffer;
+
+    // Binary copy of the database, read until the database has to be parsed.
+    ProfileStore        Store;
+    bool                StoreChecked;
+    // The store doesn't match the database, and is written by the next Save.
+    bool                StoreStale;
+    // The JSON file as last read or written, with FileSize -1 if there was none.
+    FileStat            SourceStat;
+    bool                SourceKnown;
     
 public:
     static ProfileManager* Create();
 
     int                 GetUserCount();
-    const char*         GetUser(unsigned int index);
+    // User ids are returned by value, since reloading the database frees its strings.
+    String              GetUser(unsigned int index);
     bool                CreateUser(const char* user, const char* name);
     bool                RemoveUser(const char* user);
-    const char*         GetDefaultUser(const DeviceBase* device);
+    String              GetDefaultUser(const DeviceBase* device);
     bool                SetDefaultUser(const DeviceBase* device, const char* user);
 
     virtual Profile*    CreateProfile();
@@ -91,16 +116,38 @@ public:
     bool                SetTaggedProfile(const char** key_names, const char** keys, int num_keys, Profile* profile);
     
     bool                GetDeviceTags(const DeviceBase* device, String& product, String& serial);
+
+    // Writes the profile database if it changed since it was loaded or last
+    // saved. Changes are otherwise saved once, when the manager is released.
+    bool                Save();
+    // Drops the cached database if its file was changed by another process, such
+    // as the configuration utility, since it was read or saved, so that the next
+    // access reads it again. Unsaved changes are kept instead. Returns true if
+    // the cache was dropped; profiles created before then keep the old values.
+    bool                ReloadIfChanged();
     
 protected:
     ProfileManager();
     ~ProfileManager();
     String              GetProfilePath(bool create_dir);
+    String              GetStorePath(bool create_dir);
     void                LoadCache(bool create);
     void                ClearCache();
     void                LoadV1Profiles(JSON* v1);
-    
 
+    void                indexUsers();
+    void                indexTaggedData();
+    void                indexTaggedItem(JSON* tagged_item);
+    // Returns the tagged values for exactly these tags, or NULL.
+    JSON*               findTaggedData(const char** tag_names, const char** tags, int num_tags);
+    // Adds the tagged values for exactly these tags to profile, from the store
+    // if the database isn't loaded. Returns false if there are none.
+    bool                loadTaggedValues(const char** tag_names, const char** tags, int num_tags,
+                                         Profile* profile);
+    // Maps the store unless the database is loaded; returns true if it's usable.
+    bool                openStore();
+
+    friend class Profile;
 };
 
 
@@ -112,9 +159,31 @@ protected:
 // the base profile
 class Profile : public RefCountBase<Profile>
 {
+public:
+    OVR_MEMORY_REDEFINE_NEW_TAGGED(AllocSubsystem_Profile)
+
 protected:
-    OVR::Hash<String, JSON*, String::HashFunctor>   ValMap;
-    OVR::Array<JSON*>   Values;  
+    // A setting. Numbers, bools and numeric arrays are kept as doubles, so that
+    // reading them is a copy rather than a walk over JSON items.
+    struct ProfileValue
+    {
+        enum ValueType { Value_String, Value_Number, Value_Bool, Value_Array };
+
+        String              Name;
+        ValueType           Type;
+        String              Str;
+        // One entry for a number or bool; for an array, its leading numbers.
+        ArrayPOD<double>    Numbers;
+        // Copy of an array that holds more than numbers.
+        JSON*               pArray;
+
+        ProfileValue(const char* name, ValueType type)
+            : Name(name), Type(type), pArray(0) { }
+        ~ProfileValue();
+    };
+
+    OVR::Hash<String, ProfileValue*, String::FastHashFunctor>   ValMap;
+    OVR::Array<ProfileValue*>   Values;
     OVR::String         TempVal;
 
 public:
@@ -137,36 +206,49 @@ public:
     void                SetFloatValues(const char* key, const float* vals, int num_vals);
     void                SetDoubleValue(const char* key, double val);
     void                SetDoubleValues(const char* key, const double* vals, int num_vals);
+
+    // Incremented by every Set call, so that values cached outside the profile
+    // can be read again when it changes.
+    UInt32              GetChangeCount() const { return ChangeCount; }
     
     bool Close();
 
 protected:
-    Profile() {};
+    Profile() : ChangeCount(0) {};
+
+    UInt32              ChangeCount;
 
     
     void                SetValue(JSON* val);
+    // Replaces an array setting with numbers, as SetValue does for a JSON array.
+    void                setArrayValue(const char* key, const double* vals, int num_vals);
+    // Returns the setting named key, adding it with the given type if missing.
+    ProfileValue*       findOrAdd(const char* key, ProfileValue::ValueType type);
+    // Creates the JSON item the setting is saved as.
+    static JSON*        createJSON(const ProfileValue* value);
 
    
     static bool         LoadProfile(const DeviceBase* device,
                                     const char* user,
                                     Profile** profile);
-    void                CopyItems(JSON* root, String prefix);
+    void                CopyItems(JSON* root);
     
     bool                LoadDeviceFile(unsigned int device_id, const char* serial);
     bool                LoadDeviceProfile(const DeviceBase* device);
 
-    bool                LoadProfile(JSON* root,
+    bool                LoadProfile(ProfileManager* manager,
                                     const char* user,
                                     const char* device_model,
                                     const char* device_serial);
 
-    bool                LoadUser(JSON* root,
+    bool                LoadUser(ProfileManager* manager,
                                  const char* user,
                                  const char* device_name,
                                  const char* device_serial);
 
     
     friend class ProfileManager;
+    friend class ProfileStore;
 };
 
 // # defined() check for CAPI compatibility near term that re-defines these
@@ -0,0 +1,534 @@
+/************************************************************************************
+
+Filename    :   OVR_ProfileStore.cpp
+Content     :   Memory-mapped binary form of the profile database
+Created     :   October 14, 2026
+
+Copyright   :   Copyright 2014 Oculus VR, Inc. All Rights reserved.
+
+Licensed under the Oculus VR Rift SDK License Version 3.1 (the "License");
+you may not use the Oculus VR Rift SDK except in compliance with the License,
+which is provided at the time of installation or download, or which
+otherwise accompanies this software in either electronic or hard copy form.
+
+You may obtain a copy of the License at
+
+http://www.oculusvr.com/licenses/LICENSE-3.1
+
+Unless required by applicable law or agreed to in writing, the Oculus VR SDK
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+*************************************************************************************/
+
+#include "OVR_ProfileStore.h"
+#include "OVR_Profile.h"
+#include "OVR_JSON.h"
+#include "Kernel/OVR_Alg.h"
+#include <string.h>
+
+namespace OVR {
+
+// File layout, little-endian UInt32 fields. The header is followed by the user,
+// tagged and value tables, the numbers as doubles, and the strings, which are
+// null-terminated; the file ends with a zero byte.
+//
+//   Header:  magic, file version, file size, source size (low, high), source
+//            modification time (low, high), then the count and offset of the
+//            user, tagged and value tables.
+//   User:    id string, name string.
+//   Tagged:  key string, index of its first value, value count.
+//   Value:   name string, type, count, data offset.
+
+// "OVRP", little-endian.
+static const UInt32 ProfileStoreMagic = 0x5052564F;
+
+enum
+{
+    Header_Size         = 52,
+    User_Size           = 8,
+    Tagged_Size         = 12,
+    Value_Size          = 16
+};
+
+enum StoredType
+{
+    Stored_String       = 0,    // data is a string
+    Stored_Number       = 1,    // data is a double
+    Stored_Bool         = 2,    // data is a double, 1 or 0
+    Stored_Numbers      = 3,    // data is count doubles
+    Stored_JSON         = 4     // data is the JSON text of anything else
+};
+
+static const char TagSeparator  = '\x1f';
+static const char PairSeparator = '\x1e';
+
+
+//-------------------------------------------------------------------------------------
+void ProfileStore::MakeTagKey(StringBuffer* key, const char** tag_names, const char** tags, int num_tags)
+{
+    int order[16];
+    if (num_tags > 16)
+        num_tags = 16;
+
+    for (int i = 0; i < num_tags; i++)
+    {
+        int j = i;
+        for (; j > 0 && OVR_strcmp(tag_names[order[j-1]], tag_names[i]) > 0; j--)
+            order[j] = order[j-1];
+        order[j] = i;
+    }
+
+    key->Clear();
+    for (int i = 0; i < num_tags; i++)
+    {
+        key->AppendString(tag_names[order[i]]);
+        key->AppendChar(TagSeparator);
+        key->AppendString(tags[order[i]]);
+        key->AppendChar(PairSeparator);
+    }
+}
+
+
+//-------------------------------------------------------------------------------------
+// ***** Building
+
+struct ProfileStoreValue
+{
+    UInt32 Name, Type, Count, Data;
+};
+
+// Tables with offsets relative to the numbers and strings, fixed up when the
+// file is laid out.
+struct ProfileStoreBuilder
+{
+    ArrayPOD<UInt32>            Users;
+    ArrayPOD<UInt32>            Tagged;
+    ArrayPOD<ProfileStoreValue> Values;
+    ArrayPOD<double>            Numbers;
+    ArrayPOD<char>              Strings;
+
+    ProfileStoreBuilder()       { Strings.PushBack(0); }
+
+    UInt32 addString(const char* str)
+    {
+        if (!str || !str[0])
+            return 0;
+
+        UPInt pos = Strings.GetSize();
+        UPInt len = OVR_strlen(str) + 1;
+        Strings.Resize(pos + len);
+        memcpy(&Strings[pos], str, len);
+        return (UInt32)pos;
+    }
+
+    void addValue(JSON* item)
+    {
+        ProfileStoreValue value;
+        value.Name  = addString(item->Name);
+        value.Count = 1;
+
+        if (item->Type == JSON_String)
+        {
+            value.Type = Stored_String;
+            value.Data = addString(item->Value);
+        }
+        else if (item->Type == JSON_Number || item->Type == JSON_Bool)
+        {
+            value.Type = (item->Type == JSON_Number) ? Stored_Number : Stored_Bool;
+            value.Data = (UInt32)Numbers.GetSize();
+            Numbers.PushBack(item->dValue);
+        }
+        else
+        {
+            bool numeric = (item->Type == JSON_Array);
+            for (JSON* element = item->GetFirstItem(); numeric && element; element = item->GetNextItem(element))
+                numeric = (element->Type == JSON_Number);
+
+            if (numeric)
+            {
+                value.Type  = Stored_Numbers;
+                value.Count = (UInt32)item->GetArraySize();
+                value.Data  = (UInt32)Numbers.GetSize();
+                for (JSON* element = item->GetFirstItem(); element; element = item->GetNextItem(element))
+                    Numbers.PushBack(element->dValue);
+            }
+            else
+            {
+                ArrayPOD<char> text;
+                item->Print(&text, false);
+                text.PushBack(0);
+
+                value.Type = Stored_JSON;
+                value.Data = addString(&text[0]);
+            }
+        }
+
+        Values.PushBack(value);
+    }
+};
+
+static void appendUInt32(ArrayPOD<UByte>* out, UInt32 value)
+{
+    UPInt pos = out->GetSize();
+    out->Resize(pos + 4);
+    Alg::EncodeUInt32(&(*out)[pos], value);
+}
+
+static bool TaggedKeyLess(const ProfileStore::TaggedValues& a, const ProfileStore::TaggedValues& b)
+{
+    return strcmp(a.Key, b.Key) < 0;
+}
+
+void ProfileStore::Build(ArrayPOD<UByte>* out, const ArrayPOD<JSON*>& users,
+                         const Array<TaggedValues>& tagged)
+{
+    ProfileStoreBuilder builder;
+
+    for (UPInt i = 0; i < users.GetSize(); i++)
+    {
+        JSON* id   = users[i]->GetItemByName("User");
+        JSON* name = users[i]->GetItemByName("Name");
+        builder.Users.PushBack(builder.addString(id ? id->Value.ToCStr() : ""));
+        builder.Users.PushBack(builder.addString(name ? name->Value.ToCStr() : ""));
+    }
+
+    // Sorted, so that lookups can search the table
+    Array<TaggedValues> sorted = tagged;
+    Alg::IntroSort(sorted, TaggedKeyLess);
+
+    for (UPInt i = 0; i < sorted.GetSize(); i++)
+    {
+        builder.Tagged.PushBack(builder.addString(sorted[i].Key));
+        builder.Tagged.PushBack((UInt32)builder.Values.GetSize());
+
+        UInt32 count = 0;
+        for (JSON* item = sorted[i].pVals->GetFirstItem(); item; item = sorted[i].pVals->GetNextItem(item))
+        {
+            builder.addValue(item);
+            count++;
+        }
+        builder.Tagged.PushBack(count);
+    }
+
+    // Lay out the file
+    UInt32 userTable    = Header_Size;
+    UInt32 taggedTable  = userTable + (UInt32)(builder.Users.GetSize() / 2) * User_Size;
+    UInt32 valueTable   = taggedTable + (UInt32)(builder.Tagged.GetSize() / 3) * Tagged_Size;
+    UInt32 numbers      = (valueTable + (UInt32)builder.Values.GetSize() * Value_Size + 7) & ~7u;
+    UInt32 strings      = numbers + (UInt32)builder.Numbers.GetSize() * 8;
+    UInt32 size         = strings + (UInt32)builder.Strings.GetSize() + 1;
+
+    out->Clear();
+    appendUInt32(out, ProfileStoreMagic);
+    appendUInt32(out, FileVersion);
+    appendUInt32(out, size);
+    appendUInt32(out, 0);   // source, from SetSource
+    appendUInt32(out, 0);
+    appendUInt32(out, 0);
+    appendUInt32(out, 0);
+    appendUInt32(out, (UInt32)(builder.Users.GetSize() / 2));
+    appendUInt32(out, userTable);
+    appendUInt32(out, (UInt32)(builder.Tagged.GetSize() / 3));
+    appendUInt32(out, taggedTable);
+    appendUInt32(out, (UInt32)builder.Values.GetSize());
+    appendUInt32(out, valueTable);
+    OVR_ASSERT(out->GetSize() == Header_Size);
+
+    for (UPInt i = 0; i < builder.Users.GetSize(); i++)
+        appendUInt32(out, strings + builder.Users[i]);
+
+    for (UPInt i = 0; i < builder.Tagged.GetSize(); i += 3)
+    {
+        appendUInt32(out, strings + builder.Tagged[i]);
+        appendUInt32(out, builder.Tagged[i + 1]);
+        appendUInt32(out, builder.Tagged[i + 2]);
+    }
+
+    for (UPInt i = 0; i < builder.Values.GetSize(); i++)
+    {
+        const ProfileStoreValue& value = builder.Values[i];
+        bool isString = (value.Type == Stored_String || value.Type == Stored_JSON);
+
+        appendUInt32(out, strings + value.Name);
+        appendUInt32(out, value.Type);
+        appendUInt32(out, value.Count);
+        appendUInt32(out, isString ? strings + value.Data : numbers + value.Data * 8);
+    }
+
+    out->Resize(numbers);
+    for (UPInt i = 0; i < builder.Numbers.GetSize(); i++)
+    {
+        UPInt pos = out->GetSize();
+        out->Resize(pos + 8);
+        Alg::EncodeDouble(&(*out)[pos], builder.Numbers[i]);
+    }
+
+    UPInt pos = out->GetSize();
+    out->Resize(size);
+    memcpy(&(*out)[pos], &builder.Strings[0], builder.Strings.GetSize());
+    (*out)[size - 1] = 0;
+}
+
+void ProfileStore::SetSource(ArrayPOD<UByte>* store, const FileStat& source)
+{
+    OVR_ASSERT(store->GetSize() >= Header_Size);
+    UByte* header = &(*store)[0];
+    Alg::EncodeUInt32(header + 12, (UInt32)source.FileSize);
+    Alg::EncodeUInt32(header + 16, (UInt32)((UInt64)source.FileSize >> 32));
+    Alg::EncodeUInt32(header + 20, (UInt32)source.ModifyTime);
+    Alg::EncodeUInt32(header + 24, (UInt32)((UInt64)source.ModifyTime >> 32));
+}
+
+
+//-------------------------------------------------------------------------------------
+// ***** Reading
+
+ProfileStore::ProfileStore()
+    : pData(0), Size(0)
+{
+}
+
+ProfileStore::~ProfileStore()
+{
+    Close();
+}
+
+bool ProfileStore::Open(const char* path, const FileStat* source)
+{
+    Close();
+    if (!File.Open(path))
+        return false;
+
+    const UByte* data = File.GetData();
+    UPInt        size = (UPInt)File.GetLength();
+
+    bool valid = size >= Header_Size &&
+                 Alg::DecodeUInt32(data) == ProfileStoreMagic &&
+                 Alg::DecodeUInt32(data + 4) == FileVersion &&
+                 Alg::DecodeUInt32(data + 8) == size &&
+                 data[size - 1] == 0;
+
+    if (valid && source)
+    {
+        UInt64 sourceSize = Alg::DecodeUInt32(data + 12) | ((UInt64)Alg::DecodeUInt32(data + 16) << 32);
+        UInt64 sourceTime = Alg::DecodeUInt32(data + 20) | ((UInt64)Alg::DecodeUInt32(data + 24) << 32);
+        valid = sourceSize == (UInt64)source->FileSize && sourceTime == (UInt64)source->ModifyTime;
+    }
+
+    static const UInt32 recordSizes[3] = { User_Size, Tagged_Size, Value_Size };
+    for (int i = 0; valid && i < 3; i++)
+    {
+        UInt64 count  = Alg::DecodeUInt32(data + 28 + i * 8);
+        UInt64 offset = Alg::DecodeUInt32(data + 32 + i * 8);
+        valid = offset + count * recordSizes[i] <= size;
+    }
+
+    if (!valid)
+    {
+        File.Close();
+        return false;
+    }
+
+    pData = data;
+    Size  = size;
+    return true;
+}
+
+void ProfileStore::Close()
+{
+    if (pData)
+        File.Close();
+    pData = 0;
+    Size  = 0;
+}
+
+const char* ProfileStore::getString(UInt32 offset) const
+{
+    // The file ends with a zero, so any offset inside it is a terminated string
+    return (offset < Size) ? (const char*)pData + offset : "";
+}
+
+const UByte* ProfileStore::getRecord(UInt32 table, UInt32 index, UInt32 size) const
+{
+    UInt32 count = Alg::DecodeUInt32(pData + 28 + table * 8);
+    if (index >= count)
+        return 0;
+    return pData + Alg::DecodeUInt32(pData + 32 + table * 8) + index * size;
+}
+
+unsigned ProfileStore::GetUserCount() const
+{
+    return pData ? Alg::DecodeUInt32(pData + 28) : 0;
+}
+
+const char* ProfileStore::GetUser(unsigned index) const
+{
+    const UByte* user = pData ? getRecord(0, index, User_Size) : 0;
+    return user ? getString(Alg::DecodeUInt32(user)) : NULL;
+}
+
+bool ProfileStore::LoadValues(const char* key, Profile* profile) const
+{
+    if (!pData)
+        return false;
+
+    // Binary search of the tagged table
+    UInt32       lower = 0, upper = Alg::DecodeUInt32(pData + 36);
+    const UByte* tagged = 0;
+    while (lower < upper)
+    {
+        UInt32       middle = (lower + upper) / 2;
+        const UByte* record = getRecord(1, middle, Tagged_Size);
+        int          compare = strcmp(key, getString(Alg::DecodeUInt32(record)));
+        if (compare == 0)
+        {
+            tagged = record;
+            break;
+        }
+        if (compare < 0)
+            upper = middle;
+        else
+            lower = middle + 1;
+    }
+    if (!tagged)
+        return false;
+
+    UInt32           first = Alg::DecodeUInt32(tagged + 4);
+    UInt32           count = Alg::DecodeUInt32(tagged + 8);
+    ArrayPOD<double> numbers;
+    for (UInt32 i = 0; i < count; i++)
+    {
+        const UByte* value = getRecord(2, first + i, Value_Size);
+        if (!value)
+            break;
+
+        const char* name       = getString(Alg::DecodeUInt32(value));
+        UInt32      type       = Alg::DecodeUInt32(value + 4);
+        UInt32      valueCount = Alg::DecodeUInt32(value + 8);
+        UInt32      data       = Alg::DecodeUInt32(value + 12);
+
+        if (type == Stored_String)
+        {
+            profile->SetValue(name, getString(data));
+        }
+        else if (type == Stored_JSON)
+        {
+            Ptr<JSON> item = *JSON::Parse(getString(data));
+            if (item)
+            {
+                item->Name = name;
+                profile->SetValue(item);
+            }
+        }
+        else if ((UInt64)data + (UInt64)valueCount * 8 <= Size)
+        {
+            if (type == Stored_Number)
+                profile->SetDoubleValue(name, Alg::DecodeDouble(pData + data));
+            else if (type == Stored_Bool)
+                profile->SetBoolValue(name, Alg::DecodeDouble(pData + data) != 0);
+            else if (type == Stored_Numbers)
+            {
+                numbers.Resize(valueCount);
+                for (UInt32 j = 0; j < valueCount; j++)
+                    numbers[j] = Alg::DecodeDouble(pData + data + j * 8);
+                profile->setArrayValue(name, valueCount ? &numbers[0] : NULL, (int)valueCount);
+            }
+        }
+    }
+    return true;
+}
+
+JSON* ProfileStore::CreateJSON() const
+{
+    if (!pData)
+        return NULL;
+
+    JSON* root = JSON::CreateObject();
+    root->AddNumberItem("Oculus Profile Version", 2.0);
+
+    JSON* users = JSON::CreateArray();
+    for (unsigned i = 0; i < GetUserCount(); i++)
+    {
+        const UByte* user = getRecord(0, i, User_Size);
+        JSON*        item = JSON::CreateObject();
+        item->AddStringItem("User", getString(Alg::DecodeUInt32(user)));
+        item->AddStringItem("Name", getString(Alg::DecodeUInt32(user + 4)));
+        users->AddArrayElement(item);
+    }
+    root->AddItem("Users", users);
+
+    JSON*  taggedData  = JSON::CreateArray();
+    UInt32 taggedCount = Alg::DecodeUInt32(pData + 36);
+    for (UInt32 i = 0; i < taggedCount; i++)
+    {
+        const UByte* tagged = getRecord(1, i, Tagged_Size);
+
+        // Split the key back into its tags
+        JSON*       tags = JSON::CreateArray();
+        const char* pair = getString(Alg::DecodeUInt32(tagged));
+        while (*pair)
+        {
+            const char* separator = strchr(pair, TagSeparator);
+            const char* end       = strchr(pair, PairSeparator);
+            if (!separator || !end || separator > end)
+                break;
+
+            JSON* tag = JSON::CreateObject();
+            tag->AddStringItem(String(pair, separator - pair).ToCStr(),
+                               String(separator + 1, end - separator - 1).ToCStr());
+            tags->AddArrayElement(tag);
+            pair = end + 1;
+        }
+
+        JSON*  vals  = JSON::CreateObject();
+        UInt32 first = Alg::DecodeUInt32(tagged + 4);
+        UInt32 count = Alg::DecodeUInt32(tagged + 8);
+        for (UInt32 j = 0; j < count; j++)
+        {
+            const UByte* value = getRecord(2, first + j, Value_Size);
+            if (!value)
+                break;
+
+            const char* name       = getString(Alg::DecodeUInt32(value));
+            UInt32      type       = Alg::DecodeUInt32(value + 4);
+            UInt32      valueCount = Alg::DecodeUInt32(value + 8);
+            UInt32      data       = Alg::DecodeUInt32(value + 12);
+
+            if (type == Stored_String)
+                vals->AddStringItem(name, getString(data));
+            else if (type == Stored_JSON)
+            {
+                JSON* item = JSON::Parse(getString(data));
+                if (item)
+                    vals->AddItem(name, item);
+            }
+            else if ((UInt64)data + (UInt64)valueCount * 8 <= Size)
+            {
+                if (type == Stored_Number)
+                    vals->AddNumberItem(name, Alg::DecodeDouble(pData + data));
+                else if (type == Stored_Bool)
+                    vals->AddBoolItem(name, Alg::DecodeDouble(pData + data) != 0);
+                else if (type == Stored_Numbers)
+                {
+                    JSON* array = JSON::CreateArray();
+                    for (UInt32 k = 0; k < valueCount; k++)
+                        array->AddArrayNumber(Alg::DecodeDouble(pData + data + k * 8));
+                    vals->AddItem(name, array);
+                }
+            }
+        }
+
+        JSON* item = JSON::CreateObject();
+        item->AddItem("tags", tags);
+        item->AddItem("vals", vals);
+        taggedData->AddArrayElement(item);
+    }
+    root->AddItem("TaggedData", taggedData);
+
+    return root;
+}
+
+} // namespace OVR
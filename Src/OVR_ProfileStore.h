@@ -0,0 +1,105 @@
+/************************************************************************************
+
+Filename    :   OVR_ProfileStore.h
+Content     :   Memory-mapped binary form of the profile database
+Created     :   October 14, 2026
+
+Copyright   :   Copyright 2014 Oculus VR, Inc. All Rights reserved.
+
+Licensed under the Oculus VR Rift SDK License Version 3.1 (the "License");
+you may not use the Oculus VR Rift SDK except in compliance with the License,
+which is provided at the time of installation or download, or which
+otherwise accompanies this software in either electronic or hard copy form.
+
+You may obtain a copy of the License at
+
+http://www.oculusvr.com/licenses/LICENSE-3.1
+
+Unless required by applicable law or agreed to in writing, the Oculus VR SDK
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+*************************************************************************************/
+
+#ifndef OVR_ProfileStore_h
+#define OVR_ProfileStore_h
+
+#include "Kernel/OVR_String.h"
+#include "Kernel/OVR_Array.h"
+#include "Kernel/OVR_MappedFile.h"
+#include "Kernel/OVR_SysFile.h"
+
+namespace OVR {
+
+class JSON;
+class Profile;
+
+//-------------------------------------------------------------------------------------
+// ***** ProfileStore
+
+// Binary copy of the JSON profile database, written next to it by ProfileManager,
+// so that reading one user's settings doesn't parse the whole database. The file
+// is mapped, and holds a table of users and a table of tag sets sorted by key,
+// each tag set pointing at its values; a lookup is a binary search, and only the
+// values asked for are decoded.
+//
+// The header records the size and modification time of the JSON file the store
+// was built from, and Open rejects a store whose JSON file has changed since.
+// JSON remains the interchange format; CreateJSON converts the store back.
+
+class ProfileStore : public NewOverrideBase
+{
+public:
+    enum { FileVersion = 1 };
+
+    // Values of one tagged item of the database.
+    struct TaggedValues
+    {
+        String          Key;    // From MakeTagKey.
+        JSON*           pVals;
+    };
+
+    ProfileStore();
+    ~ProfileStore();
+
+    // Maps the store at path. Fails unless it was built from a JSON file with the
+    // given stats; pass NULL to accept the store whatever its source.
+    bool                Open(const char* path, const FileStat* source);
+    void                Close();
+    bool                IsOpen() const      { return pData != 0; }
+
+    unsigned            GetUserCount() const;
+    // User id at index, in database order, or NULL.
+    const char*         GetUser(unsigned index) const;
+
+    // Adds the values of the tag set with this key to profile, in stored order.
+    // Returns false if the store has no such tag set.
+    bool                LoadValues(const char* key, Profile* profile) const;
+
+    // Rebuilds the JSON database. The returned object must be Released.
+    JSON*               CreateJSON() const;
+
+    // Lays out a store for the "Users" items and tagged values of a database.
+    static void         Build(ArrayPOD<UByte>* out, const ArrayPOD<JSON*>& users,
+                              const Array<TaggedValues>& tagged);
+    // Records the stats of the JSON file a built store is for.
+    static void         SetSource(ArrayPOD<UByte>* store, const FileStat& source);
+
+    // Builds the key of a tag set into a buffer, reusing its memory: the name and
+    // value pairs sorted by name, so that keys don't depend on the order of the tags.
+    static void         MakeTagKey(StringBuffer* key, const char** tag_names, const char** tags, int num_tags);
+
+private:
+    const char*         getString(UInt32 offset) const;
+    const UByte*        getRecord(UInt32 table, UInt32 index, UInt32 size) const;
+
+    MappedFile          File;
+    const UByte*        pData;
+    UPInt               Size;
+};
+
+} // namespace OVR
+
+#endif // OVR_ProfileStore_h
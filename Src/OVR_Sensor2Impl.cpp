@@ -28,6 +28,7 @@ limitations under the License.
 #include "OVR_SensorImpl_Common.h"
 #include "OVR_Sensor2ImplUtil.h"
 #include "Kernel/OVR_Alg.h"
+#include "Kernel/OVR_BinaryLog.h"
 
 //extern FILE *SF_LOG_fp;
 
@@ -43,8 +44,108 @@ enum {
     Sensor2_BootLoader          = 0x1001,
 
     Sensor2_DefaultReportRate   = 1000, // Hz
+
+    // Temperature reports read per tick while loading the calibration tables.
+    TemperatureReportsPerTick   = 4,
 };
 
+// Ticks interval while the temperature tables are being loaded, in seconds.
+static const double TemperatureReportsTickDelay = 0.002;
+
+// Calibration cache blobs hold the packed reports of one table back to back,
+// keyed by the report id.
+template<class Impl>
+static UByte getReportId()
+{
+    Impl impl;
+    return impl.Buffer[0];
+}
+
+template<class Impl>
+static void appendPacket(Array<UByte>* packets, const Impl& impl)
+{
+    UPInt size = packets->GetSize();
+    packets->Resize(size + Impl::PacketSize);
+    memcpy(&(*packets)[size], impl.Buffer, Impl::PacketSize);
+}
+
+template<class Impl>
+static bool unpackPacket(const Array<UByte>& packets, UPInt index, Impl* impl)
+{
+    if (packets.GetSize() < (index + 1) * Impl::PacketSize)
+        return false;
+    memcpy(impl->Buffer, &packets[index * Impl::PacketSize], Impl::PacketSize);
+    impl->Unpack();
+    return true;
+}
+
+static UPInt getPacketCount(const Array<UByte>& packets, UPInt packetSize)
+{
+    return (packets.GetSize() % packetSize) ? 0 : packets.GetSize() / packetSize;
+}
+
+// Unpacks a cached temperature table; the blob holds every bin and sample once.
+static bool unpackTemperatureReports(const Array<UByte>& packets, Array<Array<TemperatureReport> >* data)
+{
+    UPInt count = getPacketCount(packets, TemperatureImpl::PacketSize);
+    TemperatureImpl ti;
+    if (!count || !unpackPacket(packets, 0, &ti))
+        return false;
+
+    int bins = ti.Settings.NumBins, samples = ti.Settings.NumSamples;
+    if ((UPInt)(bins * samples) != count)
+        return false;
+
+    data->Clear();
+    data->Resize(bins);
+    for (int i = 0; i < bins; i++)
+        (*data)[i].Resize(samples);
+
+    for (UPInt i = 0; i < count; i++)
+    {
+        unpackPacket(packets, i, &ti);
+        if (ti.Settings.NumBins != bins || ti.Settings.NumSamples != samples ||
+            ti.Settings.Bin >= bins || ti.Settings.Sample >= samples)
+            return false;
+        (*data)[ti.Settings.Bin][ti.Settings.Sample] = ti.Settings;
+    }
+    return true;
+}
+
+// Orders received temperature packets by bin and sample for the cache; the last
+// packet of each wins. Returns false unless every entry was received.
+static bool orderTemperaturePackets(const Array<UByte>& received, Array<UByte>* packets)
+{
+    UPInt count = getPacketCount(received, TemperatureImpl::PacketSize);
+    TemperatureImpl ti;
+    if (!count || !unpackPacket(received, count - 1, &ti))
+        return false;
+
+    int bins = ti.Settings.NumBins, samples = ti.Settings.NumSamples;
+    Array<bool> filled;
+    filled.Resize(bins * samples);
+    for (UPInt i = 0; i < filled.GetSize(); i++)
+        filled[i] = false;
+    packets->Resize(bins * samples * TemperatureImpl::PacketSize);
+
+    for (UPInt i = 0; i < count; i++)
+    {
+        unpackPacket(received, i, &ti);
+        if (ti.Settings.NumBins != bins || ti.Settings.NumSamples != samples ||
+            ti.Settings.Bin >= bins || ti.Settings.Sample >= samples)
+            continue;
+        int index = ti.Settings.Bin * samples + ti.Settings.Sample;
+        memcpy(&(*packets)[index * TemperatureImpl::PacketSize], &received[i * TemperatureImpl::PacketSize],
+               TemperatureImpl::PacketSize);
+        filled[index] = true;
+    }
+
+    for (UPInt i = 0; i < filled.GetSize(); i++)
+        if (!filled[i])
+            return false;
+    return filled.GetSize() > 0;
+}
+
 
 // Messages we care for
 enum Tracker2MessageType
@@ -86,11 +187,7 @@ struct Tracker2Sensors
 		// Only unpack as many samples as there actually are.
         UByte iterationCount = (NumSamples > 1) ? 2 : NumSamples;
 
-        for (UByte i = 0; i < iterationCount; i++)
-        {
-			UnpackSensor(buffer + 12 + 16 * i, &Samples[i].AccelX, &Samples[i].AccelY, &Samples[i].AccelZ);
-            UnpackSensor(buffer + 20 + 16 * i, &Samples[i].GyroX,  &Samples[i].GyroY,  &Samples[i].GyroZ);
-		}
+        UnpackSensorSamples(buffer + 12, iterationCount, 0.0001f, Samples);
 
         MagX = DecodeSInt16(buffer + 44);
         MagY = DecodeSInt16(buffer + 46);
@@ -124,12 +221,8 @@ struct Tracker2Message
 //
 Vector3f AccelFromBodyFrameUpdate(const Tracker2Sensors& update, UByte sampleNumber)
 {
-    const TrackerSample& sample = update.Samples[sampleNumber];
-    float                ax = (float)sample.AccelX;
-    float                ay = (float)sample.AccelY;
-    float                az = (float)sample.AccelZ;
-
-    return Vector3f(ax, ay, az) * 0.0001f;
+    // Samples are already scaled by 0.0001.
+    return update.Samples[sampleNumber].Accel;
 }
 
 
@@ -140,17 +233,12 @@ Vector3f MagFromBodyFrameUpdate(const Tracker2Sensors& update)
 
 Vector3f EulerFromBodyFrameUpdate(const Tracker2Sensors& update, UByte sampleNumber)
 {
-    const TrackerSample& sample = update.Samples[sampleNumber];
-    float                gx = (float)sample.GyroX;
-    float                gy = (float)sample.GyroY;
-    float                gz = (float)sample.GyroZ;
-
-    return Vector3f(gx, gy, gz) * 0.0001f;
+    return update.Samples[sampleNumber].Gyro;
 }
 
 bool  Sensor2DeviceImpl::decodeTracker2Message(Tracker2Message* message, UByte* buffer, int size)
 {
-    memset(message, 0, sizeof(Tracker2Message));
+    *message = Tracker2Message();
 
     if (size < 4)
     {
@@ -183,7 +271,8 @@ Sensor2DeviceImpl::Sensor2DeviceImpl(SensorDeviceCreateDesc* createDesc)
         LastCameraTime("C"),
         LastFrameTime("F"),
         LastSensorTime("S"),
-        LastFrameTimestamp(0)
+        LastFrameTimestamp(0),
+        CollectTemperaturePackets(false)
 {
     // 15 samples ok in min-window for DK2 since it uses microsecond clock.
     TimeFilter = SensorTimeFilter(SensorTimeFilter::Settings(15));
@@ -198,6 +287,9 @@ Sensor2DeviceImpl::~Sensor2DeviceImpl()
 
 void Sensor2DeviceImpl::openDevice()
 {
+    // Nothing is known of the reports of a newly opened device.
+    TrackingCache.LastValid = false;
+    DisplayCache.LastValid  = false;
 
     // Read the currently configured range from sensor.
     SensorRangeImpl sr(SensorRange(), 0);
@@ -220,14 +312,11 @@ void Sensor2DeviceImpl::openDevice()
         CalibrationTemperature = sc.Temperature;
     }
 
-    // If the sensor has "DisplayInfo" data, use HMD coordinate frame by default.
-    SensorDisplayInfoImpl displayInfo;
-    if (GetInternalDevice()->GetFeatureReport(displayInfo.Buffer, SensorDisplayInfoImpl::PacketSize))
-    {
-        displayInfo.Unpack();
-        Coordinates = (displayInfo.DistortionType & SensorDisplayInfoImpl::Mask_BaseFmt) ?
-                      Coord_HMD : Coord_Sensor;
-    }
+    // The tables that take many feature reports to read are cached on disk.
+    loadCalibrationCache();
+
+    // DK2 always uses the HMD coordinate frame, so its "DisplayInfo" report
+    // isn't read to choose one.
 	Coordinates = Coord_HMD; // TODO temporary to force it behave
 
     // Read/Apply sensor config.
@@ -236,24 +325,95 @@ void Sensor2DeviceImpl::openDevice()
     setOnboardCalibrationEnabled(false);
 
     // Must send DK2 keep-alive. Set Keep-alive at 10 seconds.
-    KeepAliveMuxReport keepAlive;
-    keepAlive.CommandId = 0;
-    keepAlive.INReport = 11;
-    keepAlive.Interval = 10 * 1000;
-
     // Device creation is done from background thread so we don't need to add this to the command queue.
-    KeepAliveMuxImpl keepAliveImpl(keepAlive);
-    GetInternalDevice()->SetFeatureReport(keepAliveImpl.Buffer, KeepAliveMuxImpl::PacketSize);
+    sendKeepAlive();
 
-    // Read the temperature  data from the device
+    // Read the calibration needed for tracking; the temperature tables come from
+    // the cache or follow from OnTicks, a few reports at a time.
     pCalibration->Initialize();
+
+    Array<Array<TemperatureReport> > temperatureReports;
+    const Array<UByte>* cachedTemperatures = CalibrationCache.GetBlob(getReportId<TemperatureImpl>());
+    if (cachedTemperatures && unpackTemperatureReports(*cachedTemperatures, &temperatureReports))
+    {
+        pCalibration->SetTemperatureReports(temperatureReports);
+    }
+    else
+    {
+        TemperaturePackets.Clear();
+        CollectTemperaturePackets = true;
+    }
+}
+
+void Sensor2DeviceImpl::loadCalibrationCache()
+{
+    // The UUID report is read every time; it is what tells a cache written for
+    // this device from one written before it was reprogrammed.
+    SensorInfo sinfo;
+    UUIDReport uuid;
+    if (!GetDeviceInfo(&sinfo) || !getUUIDReport(&uuid))
+        return;
+
+    CalibrationCache.Load(sinfo.SerialNumber, sinfo.Version, GetDeviceInterfaceVersion(), uuid);
+}
+
+void Sensor2DeviceImpl::cacheTemperatureReports()
+{
+    Array<UByte> packets;
+    if (orderTemperaturePackets(TemperaturePackets, &packets))
+    {
+        CalibrationCache.SetBlob(getReportId<TemperatureImpl>(), packets);
+        CalibrationCache.Save();
+    }
+
+    TemperaturePackets.Clear();
+    CollectTemperaturePackets = false;
+}
+
+// Writes the pending report of cache, unless it packs to the report the device
+// already has.
+template<class Impl, class Report>
+static bool writeFeatureReport(HIDDevice* device, FeatureReportCache<Report>* cache)
+{
+    Impl pending;
+    {
+        Lock::Locker lock(&cache->PendingLock);
+        pending.Settings = cache->Pending;
+    }
+    pending.Pack();
+
+    if (cache->LastValid)
+    {
+        Impl last;
+        last.Settings = cache->Last;
+        last.Pack();
+        if (memcmp(pending.Buffer, last.Buffer, Impl::PacketSize) == 0)
+            return true;
+    }
+
+    // After a failed write the report of the device is not known.
+    cache->LastValid = device->SetFeatureReport(pending.Buffer, Impl::PacketSize);
+    if (cache->LastValid)
+        cache->Last = pending.Settings;
+    return cache->LastValid;
 }
 
 bool Sensor2DeviceImpl::SetTrackingReport(const TrackingReport& data)
 { 
+    {
+        Lock::Locker lock(&TrackingCache.PendingLock);
+        TrackingCache.Pending = data;
+    }
+
+    // direct call if we are already on the device thread
+    if (GetCurrentThreadId() == GetDeviceThreadId())
+    {
+        return setTrackingReport();
+    }
+
 	bool result;
-	if (!GetManagerImpl()->GetThreadQueue()->
-            PushCallAndWaitResult(this, &Sensor2DeviceImpl::setTrackingReport, &result, data))
+	if (!GetDeviceQueue()->
+            PushCallAndWaitResult(this, &Sensor2DeviceImpl::setTrackingReport, &result))
 	{
 		return false;
 	}
@@ -261,16 +421,21 @@ bool Sensor2DeviceImpl::SetTrackingReport(const TrackingReport& data)
 	return result;
 }
 
-bool Sensor2DeviceImpl::setTrackingReport(const TrackingReport& data)
+bool Sensor2DeviceImpl::setTrackingReport()
 {
-    TrackingImpl ci(data);
-    return GetInternalDevice()->SetFeatureReport(ci.Buffer, TrackingImpl::PacketSize);
+    return writeFeatureReport<TrackingImpl>(GetInternalDevice(), &TrackingCache);
 }
 
 bool Sensor2DeviceImpl::GetTrackingReport(TrackingReport* data)
 {
+    // direct call if we are already on the device thread
+    if (GetCurrentThreadId() == GetDeviceThreadId())
+    {
+        return getTrackingReport(data);
+    }
+
 	bool result;
-	if (!GetManagerImpl()->GetThreadQueue()->
+	if (!GetDeviceQueue()->
             PushCallAndWaitResult(this, &Sensor2DeviceImpl::getTrackingReport, &result, data))
 	{
 		return false;
@@ -286,6 +451,8 @@ bool Sensor2DeviceImpl::getTrackingReport(TrackingReport* data)
     {
         ci.Unpack();
         *data = ci.Settings;
+        TrackingCache.Last      = ci.Settings;
+        TrackingCache.LastValid = true;
         return true;
     }
 
@@ -294,9 +461,20 @@ bool Sensor2DeviceImpl::getTrackingReport(TrackingReport* data)
 
 bool Sensor2DeviceImpl::SetDisplayReport(const DisplayReport& data)
 { 
+    {
+        Lock::Locker lock(&DisplayCache.PendingLock);
+        DisplayCache.Pending = data;
+    }
+
+    // direct call if we are already on the device thread
+    if (GetCurrentThreadId() == GetDeviceThreadId())
+    {
+        return setDisplayReport();
+    }
+
 	bool result;
-	if (!GetManagerImpl()->GetThreadQueue()->
-            PushCallAndWaitResult(this, &Sensor2DeviceImpl::setDisplayReport, &result, data))
+	if (!GetDeviceQueue()->
+            PushCallAndWaitResult(this, &Sensor2DeviceImpl::setDisplayReport, &result))
 	{
 		return false;
 	}
@@ -304,16 +482,21 @@ bool Sensor2DeviceImpl::SetDisplayReport(const DisplayReport& data)
 	return result;
 }
 
-bool Sensor2DeviceImpl::setDisplayReport(const DisplayReport& data)
+bool Sensor2DeviceImpl::setDisplayReport()
 {
-    DisplayImpl di(data);
-    return GetInternalDevice()->SetFeatureReport(di.Buffer, DisplayImpl::PacketSize);
+    return writeFeatureReport<DisplayImpl>(GetInternalDevice(), &DisplayCache);
 }
 
 bool Sensor2DeviceImpl::GetDisplayReport(DisplayReport* data)
 {
+    // direct call if we are already on the device thread
+    if (GetCurrentThreadId() == GetDeviceThreadId())
+    {
+        return getDisplayReport(data);
+    }
+
 	bool result;
-	if (!GetManagerImpl()->GetThreadQueue()->
+	if (!GetDeviceQueue()->
             PushCallAndWaitResult(this, &Sensor2DeviceImpl::getDisplayReport, &result, data))
 	{
 		return false;
@@ -329,6 +512,8 @@ bool Sensor2DeviceImpl::getDisplayReport(DisplayReport* data)
     {
         di.Unpack();
         *data = di.Settings;
+        DisplayCache.Last      = di.Settings;
+        DisplayCache.LastValid = true;
         return true;
     }
 
@@ -337,8 +522,14 @@ bool Sensor2DeviceImpl::getDisplayReport(DisplayReport* data)
 
 bool Sensor2DeviceImpl::SetMagCalibrationReport(const MagCalibrationReport& data)
 { 
+    // direct call if we are already on the device thread
+    if (GetCurrentThreadId() == GetDeviceThreadId())
+    {
+        return setMagCalibrationReport(data);
+    }
+
 	bool result;
-	if (!GetManagerImpl()->GetThreadQueue()->
+	if (!GetDeviceQueue()->
             PushCallAndWaitResult(this, &Sensor2DeviceImpl::setMagCalibrationReport, &result, data))
 	{
 		return false;
@@ -355,14 +546,14 @@ bool Sensor2DeviceImpl::setMagCalibrationReport(const MagCalibrationReport& data
 
 bool Sensor2DeviceImpl::GetMagCalibrationReport(MagCalibrationReport* data)
 {
-    // direct call if we are already on the device manager thread
-    if (GetCurrentThreadId() == GetManagerImpl()->GetThreadId())
+    // direct call if we are already on the device thread
+    if (GetCurrentThreadId() == GetDeviceThreadId())
     {
         return getMagCalibrationReport(data);
     }
 
 	bool result;
-	if (!GetManagerImpl()->GetThreadQueue()->
+	if (!GetDeviceQueue()->
             PushCallAndWaitResult(this, &Sensor2DeviceImpl::getMagCalibrationReport, &result, data))
 	{
 		return false;
@@ -386,8 +577,14 @@ bool Sensor2DeviceImpl::getMagCalibrationReport(MagCalibrationReport* data)
 
 bool Sensor2DeviceImpl::SetPositionCalibrationReport(const PositionCalibrationReport& data)
 { 
+    // direct call if we are already on the device thread
+    if (GetCurrentThreadId() == GetDeviceThreadId())
+    {
+        return setPositionCalibrationReport(data);
+    }
+
     bool result;
-	if (!GetManagerImpl()->GetThreadQueue()->
+	if (!GetDeviceQueue()->
             PushCallAndWaitResult(this, &Sensor2DeviceImpl::setPositionCalibrationReport, &result, data))
 	{
 		return false;
@@ -402,14 +599,25 @@ bool Sensor2DeviceImpl::setPositionCalibrationReport(const PositionCalibrationRe
 	if (version < 5)
 	{
 		PositionCalibrationImpl_Pre5 pci(data);
-		return GetInternalDevice()->SetFeatureReport(pci.Buffer, PositionCalibrationImpl_Pre5::PacketSize);
+		if (!GetInternalDevice()->SetFeatureReport(pci.Buffer, PositionCalibrationImpl_Pre5::PacketSize))
+			return false;
+
+		if (CalibrationCache.RemoveBlob(getReportId<PositionCalibrationImpl_Pre5>()))
+			CalibrationCache.Save();
+		return true;
 	}
 	
 	PositionCalibrationImpl pci(data);
-    return GetInternalDevice()->SetFeatureReport(pci.Buffer, PositionCalibrationImpl::PacketSize);
+    if (!GetInternalDevice()->SetFeatureReport(pci.Buffer, PositionCalibrationImpl::PacketSize))
+        return false;
+
+    if (CalibrationCache.RemoveBlob(getReportId<PositionCalibrationImpl>()))
+        CalibrationCache.Save();
+    return true;
 }
 
-bool Sensor2DeviceImpl::getPositionCalibrationReport(PositionCalibrationReport* data)
+bool Sensor2DeviceImpl::getPositionCalibrationReport(PositionCalibrationReport* data,
+                                                     Array<UByte>* packets)
 {
 	UByte version = GetDeviceInterfaceVersion();
 	if (version < 5)
@@ -417,6 +625,8 @@ bool Sensor2DeviceImpl::getPositionCalibrationReport(PositionCalibrationReport*
 		PositionCalibrationImpl_Pre5 pci;
 		if (GetInternalDevice()->GetFeatureReport(pci.Buffer, PositionCalibrationImpl_Pre5::PacketSize))
 		{
+			if (packets)
+				appendPacket(packets, pci);
 			pci.Unpack();
 			*data = pci.Settings;
 			return true;
@@ -428,6 +638,8 @@ bool Sensor2DeviceImpl::getPositionCalibrationReport(PositionCalibrationReport*
     PositionCalibrationImpl pci;
     if (GetInternalDevice()->GetFeatureReport(pci.Buffer, PositionCalibrationImpl::PacketSize))
     {
+        if (packets)
+            appendPacket(packets, pci);
         pci.Unpack();
         *data = pci.Settings;
         return true;
@@ -438,8 +650,14 @@ bool Sensor2DeviceImpl::getPositionCalibrationReport(PositionCalibrationReport*
 
 bool Sensor2DeviceImpl::GetAllPositionCalibrationReports(Array<PositionCalibrationReport>* data)
 {
+    // direct call if we are already on the device thread
+    if (GetCurrentThreadId() == GetDeviceThreadId())
+    {
+        return getAllPositionCalibrationReports(data);
+    }
+
     bool result;
-    if (!GetManagerImpl()->GetThreadQueue()->
+    if (!GetDeviceQueue()->
         PushCallAndWaitResult(this, &Sensor2DeviceImpl::getAllPositionCalibrationReports, &result, data))
     {
         return false;
@@ -448,8 +666,45 @@ bool Sensor2DeviceImpl::GetAllPositionCalibrationReports(Array<PositionCalibrati
     return result;
 }
 
+// Unpacks cached position calibration reports, stored in position order.
+template<class Impl>
+static bool unpackPositionCalibrationReports(const Array<UByte>& packets, Array<PositionCalibrationReport>* data)
+{
+    UPInt count = getPacketCount(packets, Impl::PacketSize);
+    if (!count)
+        return false;
+
+    data->Clear();
+    data->Resize(count);
+    for (UPInt i = 0; i < count; i++)
+    {
+        Impl pci;
+        unpackPacket(packets, i, &pci);
+        if (pci.Settings.NumPositions != count || pci.Settings.PositionIndex != i)
+            return false;
+        (*data)[i] = pci.Settings;
+    }
+    return true;
+}
+
 bool Sensor2DeviceImpl::getAllPositionCalibrationReports(Array<PositionCalibrationReport>* data)
 {
+    UByte version  = GetDeviceInterfaceVersion();
+    UByte reportId = (version < 5) ? getReportId<PositionCalibrationImpl_Pre5>() :
+                                     getReportId<PositionCalibrationImpl>();
+    UPInt packetSize = (version < 5) ? (UPInt)PositionCalibrationImpl_Pre5::PacketSize :
+                                       (UPInt)PositionCalibrationImpl::PacketSize;
+
+    const Array<UByte>* cached = CalibrationCache.GetBlob(reportId);
+    if (cached)
+    {
+        bool unpacked = (version < 5) ?
+            unpackPositionCalibrationReports<PositionCalibrationImpl_Pre5>(*cached, data) :
+            unpackPositionCalibrationReports<PositionCalibrationImpl>(*cached, data);
+        if (unpacked)
+            return true;
+    }
+
     PositionCalibrationReport pc;
     bool result = getPositionCalibrationReport(&pc);
     if (!result)
@@ -459,11 +714,19 @@ bool Sensor2DeviceImpl::getAllPositionCalibrationReports(Array<PositionCalibrati
     data->Clear();
     data->Resize(positions);
 
+    // Received packets, in position order for the cache.
+    Array<UByte> received;
+    Array<UByte> packets;
+    packets.Resize(positions * packetSize);
+
     for (int i = 0; i < positions; i++)
     {
-        result = getPositionCalibrationReport(&pc);
+        received.Clear();
+        result = getPositionCalibrationReport(&pc, &received);
         if (!result)
             return false;
+        if (pc.PositionIndex < positions)
+            memcpy(&packets[pc.PositionIndex * packetSize], &received[0], packetSize);
         OVR_ASSERT(pc.NumPositions == positions);
 
         (*data)[pc.PositionIndex] = pc;
@@ -471,13 +734,22 @@ bool Sensor2DeviceImpl::getAllPositionCalibrationReports(Array<PositionCalibrati
         OVR_ASSERT(pc.PositionType == (pc.PositionIndex == positions - 1) ? 
             PositionCalibrationReport::PositionType_IMU : PositionCalibrationReport::PositionType_LED);
     }
+
+    CalibrationCache.SetBlob(reportId, packets);
+    CalibrationCache.Save();
     return true;
 }
 
 bool Sensor2DeviceImpl::SetCustomPatternReport(const CustomPatternReport& data)
 { 
+    // direct call if we are already on the device thread
+    if (GetCurrentThreadId() == GetDeviceThreadId())
+    {
+        return setCustomPatternReport(data);
+    }
+
 	bool result;
-	if (!GetManagerImpl()->GetThreadQueue()->
+	if (!GetDeviceQueue()->
             PushCallAndWaitResult(this, &Sensor2DeviceImpl::setCustomPatternReport, &result, data))
 	{
 		return false;
@@ -494,8 +766,14 @@ bool Sensor2DeviceImpl::setCustomPatternReport(const CustomPatternReport& data)
 
 bool Sensor2DeviceImpl::GetCustomPatternReport(CustomPatternReport* data)
 {
+    // direct call if we are already on the device thread
+    if (GetCurrentThreadId() == GetDeviceThreadId())
+    {
+        return getCustomPatternReport(data);
+    }
+
 	bool result;
-	if (!GetManagerImpl()->GetThreadQueue()->
+	if (!GetDeviceQueue()->
             PushCallAndWaitResult(this, &Sensor2DeviceImpl::getCustomPatternReport, &result, data))
 	{
 		return false;
@@ -519,8 +797,14 @@ bool Sensor2DeviceImpl::getCustomPatternReport(CustomPatternReport* data)
 
 bool Sensor2DeviceImpl::SetManufacturingReport(const ManufacturingReport& data)
 { 
+    // direct call if we are already on the device thread
+    if (GetCurrentThreadId() == GetDeviceThreadId())
+    {
+        return setManufacturingReport(data);
+    }
+
 	bool result;
-	if (!GetManagerImpl()->GetThreadQueue()->
+	if (!GetDeviceQueue()->
             PushCallAndWaitResult(this, &Sensor2DeviceImpl::setManufacturingReport, &result, data))
 	{
 		return false;
@@ -537,8 +821,14 @@ bool Sensor2DeviceImpl::setManufacturingReport(const ManufacturingReport& data)
 
 bool Sensor2DeviceImpl::GetManufacturingReport(ManufacturingReport* data)
 {
+    // direct call if we are already on the device thread
+    if (GetCurrentThreadId() == GetDeviceThreadId())
+    {
+        return getManufacturingReport(data);
+    }
+
 	bool result;
-	if (!GetManagerImpl()->GetThreadQueue()->
+	if (!GetDeviceQueue()->
             PushCallAndWaitResult(this, &Sensor2DeviceImpl::getManufacturingReport, &result, data))
 	{
 		return false;
@@ -562,8 +852,14 @@ bool Sensor2DeviceImpl::getManufacturingReport(ManufacturingReport* data)
 
 bool Sensor2DeviceImpl::SetLensDistortionReport(const LensDistortionReport& data)
 { 
+    // direct call if we are already on the device thread
+    if (GetCurrentThreadId() == GetDeviceThreadId())
+    {
+        return setLensDistortionReport(data);
+    }
+
 	bool result;
-	if (!GetManagerImpl()->GetThreadQueue()->
+	if (!GetDeviceQueue()->
             PushCallAndWaitResult(this, &Sensor2DeviceImpl::setLensDistortionReport, &result, data))
 	{
 		return false;
@@ -575,13 +871,24 @@ bool Sensor2DeviceImpl::SetLensDistortionReport(const LensDistortionReport& data
 bool Sensor2DeviceImpl::setLensDistortionReport(const LensDistortionReport& data)
 {
     LensDistortionImpl ui(data);
-    return GetInternalDevice()->SetFeatureReport(ui.Buffer, LensDistortionImpl::PacketSize);
+    if (!GetInternalDevice()->SetFeatureReport(ui.Buffer, LensDistortionImpl::PacketSize))
+        return false;
+
+    if (CalibrationCache.RemoveBlob(getReportId<LensDistortionImpl>()))
+        CalibrationCache.Save();
+    return true;
 }
 
 bool Sensor2DeviceImpl::GetLensDistortionReport(LensDistortionReport* data)
 {
+    // direct call if we are already on the device thread
+    if (GetCurrentThreadId() == GetDeviceThreadId())
+    {
+        return getLensDistortionReport(data);
+    }
+
 	bool result;
-	if (!GetManagerImpl()->GetThreadQueue()->
+	if (!GetDeviceQueue()->
             PushCallAndWaitResult(this, &Sensor2DeviceImpl::getLensDistortionReport, &result, data))
 	{
 		return false;
@@ -593,8 +900,20 @@ bool Sensor2DeviceImpl::GetLensDistortionReport(LensDistortionReport* data)
 bool Sensor2DeviceImpl::getLensDistortionReport(LensDistortionReport* data)
 {
     LensDistortionImpl ui;
+    const Array<UByte>* cached = CalibrationCache.GetBlob(getReportId<LensDistortionImpl>());
+    if (cached && getPacketCount(*cached, LensDistortionImpl::PacketSize) == 1 && unpackPacket(*cached, 0, &ui))
+    {
+        *data = ui.Settings;
+        return true;
+    }
+
     if (GetInternalDevice()->GetFeatureReport(ui.Buffer, LensDistortionImpl::PacketSize))
     {
+        Array<UByte> packets;
+        appendPacket(&packets, ui);
+        CalibrationCache.SetBlob(getReportId<LensDistortionImpl>(), packets);
+        CalibrationCache.Save();
+
         ui.Unpack();
         *data = ui.Settings;
         return true;
@@ -605,8 +924,14 @@ bool Sensor2DeviceImpl::getLensDistortionReport(LensDistortionReport* data)
 
 bool Sensor2DeviceImpl::SetUUIDReport(const UUIDReport& data)
 { 
+    // direct call if we are already on the device thread
+    if (GetCurrentThreadId() == GetDeviceThreadId())
+    {
+        return setUUIDReport(data);
+    }
+
 	bool result;
-	if (!GetManagerImpl()->GetThreadQueue()->
+	if (!GetDeviceQueue()->
             PushCallAndWaitResult(this, &Sensor2DeviceImpl::setUUIDReport, &result, data))
 	{
 		return false;
@@ -623,8 +948,14 @@ bool Sensor2DeviceImpl::setUUIDReport(const UUIDReport& data)
 
 bool Sensor2DeviceImpl::GetUUIDReport(UUIDReport* data)
 {
+    // direct call if we are already on the device thread
+    if (GetCurrentThreadId() == GetDeviceThreadId())
+    {
+        return getUUIDReport(data);
+    }
+
 	bool result;
-	if (!GetManagerImpl()->GetThreadQueue()->
+	if (!GetDeviceQueue()->
             PushCallAndWaitResult(this, &Sensor2DeviceImpl::getUUIDReport, &result, data))
 	{
 		return false;
@@ -648,8 +979,14 @@ bool Sensor2DeviceImpl::getUUIDReport(UUIDReport* data)
 
 bool Sensor2DeviceImpl::SetKeepAliveMuxReport(const KeepAliveMuxReport& data)
 { 
+    // direct call if we are already on the device thread
+    if (GetCurrentThreadId() == GetDeviceThreadId())
+    {
+        return setKeepAliveMuxReport(data);
+    }
+
 	bool result;
-	if (!GetManagerImpl()->GetThreadQueue()->
+	if (!GetDeviceQueue()->
             PushCallAndWaitResult(this, &Sensor2DeviceImpl::setKeepAliveMuxReport, &result, data))
 	{
 		return false;
@@ -666,8 +1003,14 @@ bool Sensor2DeviceImpl::setKeepAliveMuxReport(const KeepAliveMuxReport& data)
 
 bool Sensor2DeviceImpl::GetKeepAliveMuxReport(KeepAliveMuxReport* data)
 {
+    // direct call if we are already on the device thread
+    if (GetCurrentThreadId() == GetDeviceThreadId())
+    {
+        return getKeepAliveMuxReport(data);
+    }
+
 	bool result;
-	if (!GetManagerImpl()->GetThreadQueue()->
+	if (!GetDeviceQueue()->
             PushCallAndWaitResult(this, &Sensor2DeviceImpl::getKeepAliveMuxReport, &result, data))
 	{
 		return false;
@@ -691,14 +1034,14 @@ bool Sensor2DeviceImpl::getKeepAliveMuxReport(KeepAliveMuxReport* data)
 
 bool Sensor2DeviceImpl::SetTemperatureReport(const TemperatureReport& data)
 {
-    // direct call if we are already on the device manager thread
-    if (GetCurrentThreadId() == GetManagerImpl()->GetThreadId())
+    // direct call if we are already on the device thread
+    if (GetCurrentThreadId() == GetDeviceThreadId())
     {
         return setTemperatureReport(data);
     }
 
     bool result;
-	if (!GetManagerImpl()->GetThreadQueue()->
+	if (!GetDeviceQueue()->
             PushCallAndWaitResult(this, &Sensor2DeviceImpl::setTemperatureReport, &result, data))
 	{
 		return false;
@@ -710,7 +1053,45 @@ bool Sensor2DeviceImpl::SetTemperatureReport(const TemperatureReport& data)
 bool Sensor2DeviceImpl::setTemperatureReport(const TemperatureReport& data)
 {
     TemperatureImpl ti(data);
-    return GetInternalDevice()->SetFeatureReport(ti.Buffer, TemperatureImpl::PacketSize);
+    if (!GetInternalDevice()->SetFeatureReport(ti.Buffer, TemperatureImpl::PacketSize))
+        return false;
+
+    // Keep the cached table in step with the device.
+    if (CollectTemperaturePackets)
+        appendPacket(&TemperaturePackets, ti);
+
+    const Array<UByte>* cached = CalibrationCache.GetBlob(getReportId<TemperatureImpl>());
+    if (cached)
+    {
+        Array<UByte> received(*cached);
+        appendPacket(&received, ti);
+
+        Array<UByte> packets;
+        if (orderTemperaturePackets(received, &packets))
+            CalibrationCache.SetBlob(getReportId<TemperatureImpl>(), packets);
+        else
+            CalibrationCache.RemoveBlob(getReportId<TemperatureImpl>());
+        CalibrationCache.Save();
+    }
+    return true;
+}
+
+bool Sensor2DeviceImpl::GetTemperatureReport(TemperatureReport* data)
+{
+    // direct call if we are already on the device thread
+    if (GetCurrentThreadId() == GetDeviceThreadId())
+    {
+        return getTemperatureReport(data);
+    }
+
+    bool result;
+    if (!GetDeviceQueue()->
+        PushCallAndWaitResult(this, &Sensor2DeviceImpl::getTemperatureReport, &result, data))
+    {
+        return false;
+    }
+
+    return result;
 }
 
 bool Sensor2DeviceImpl::getTemperatureReport(TemperatureReport* data)
@@ -719,6 +1100,13 @@ bool Sensor2DeviceImpl::getTemperatureReport(TemperatureReport* data)
     if (GetInternalDevice()->GetFeatureReport(ti.Buffer, TemperatureImpl::PacketSize))
     {
         ti.Unpack();
+        if (CollectTemperaturePackets)
+        {
+            // The first report gives the size of the whole table.
+            if (TemperaturePackets.IsEmpty())
+                TemperaturePackets.Reserve(ti.Settings.NumBins * ti.Settings.NumSamples * TemperatureImpl::PacketSize);
+            appendPacket(&TemperaturePackets, ti);
+        }
         *data = ti.Settings;
         return true;
     }
@@ -728,14 +1116,14 @@ bool Sensor2DeviceImpl::getTemperatureReport(TemperatureReport* data)
 
 bool Sensor2DeviceImpl::GetAllTemperatureReports(Array<Array<TemperatureReport> >* data)
 {
-    // direct call if we are already on the device manager thread
-    if (GetCurrentThreadId() == GetManagerImpl()->GetThreadId())
+    // direct call if we are already on the device thread
+    if (GetCurrentThreadId() == GetDeviceThreadId())
     {
         return getAllTemperatureReports(data);
     }
 
     bool result;
-    if (!GetManagerImpl()->GetThreadQueue()->
+    if (!GetDeviceQueue()->
         PushCallAndWaitResult(this, &Sensor2DeviceImpl::getAllTemperatureReports, &result, data))
     {
         return false;
@@ -746,6 +1134,10 @@ bool Sensor2DeviceImpl::GetAllTemperatureReports(Array<Array<TemperatureReport>
 
 bool Sensor2DeviceImpl::getAllTemperatureReports(Array<Array<TemperatureReport> >* data)
 {
+    const Array<UByte>* cached = CalibrationCache.GetBlob(getReportId<TemperatureImpl>());
+    if (cached && unpackTemperatureReports(*cached, data))
+        return true;
+
     TemperatureReport t;
     bool result = getTemperatureReport(&t);
     if (!result)
@@ -772,14 +1164,14 @@ bool Sensor2DeviceImpl::getAllTemperatureReports(Array<Array<TemperatureReport>
 
 bool Sensor2DeviceImpl::GetGyroOffsetReport(GyroOffsetReport* data)
 {
-    // direct call if we are already on the device manager thread
-    if (GetCurrentThreadId() == GetManagerImpl()->GetThreadId())
+    // direct call if we are already on the device thread
+    if (GetCurrentThreadId() == GetDeviceThreadId())
     {
         return getGyroOffsetReport(data);
     }
 
     bool result;
-	if (!GetManagerImpl()->GetThreadQueue()->
+	if (!GetDeviceQueue()->
             PushCallAndWaitResult(this, &Sensor2DeviceImpl::getGyroOffsetReport, &result, data))
 	{
 		return false;
@@ -801,7 +1193,7 @@ bool Sensor2DeviceImpl::getGyroOffsetReport(GyroOffsetReport* data)
     return false;
 }
 
-void Sensor2DeviceImpl::onTrackerMessage(Tracker2Message* message)
+void Sensor2DeviceImpl::onTrackerMessage(Tracker2Message* message, double receiveTime)
 {
     if (message->Type != Tracker2Message_Sensors)
         return;
@@ -812,6 +1204,11 @@ void Sensor2DeviceImpl::onTrackerMessage(Tracker2Message* message)
     
     double       absoluteTimeSeconds = 0.0;
 
+    // Body frames of this report, handed to handlers together.
+    MessageBodyFrame frames[MaxBodyFramesPerReport];
+    unsigned         frameCount = 0;
+    unsigned         lostSamples = 0;
+
     if (SequenceValid)
     {
         UInt32 runningSampleCountDelta;
@@ -831,10 +1228,13 @@ void Sensor2DeviceImpl::onTrackerMessage(Tracker2Message* message)
         absoluteTimeSeconds = LastSensorTime.TimeSeconds;
         scaledSampleIntervalTimeUnit = TimeFilter.ScaleTimeUnit(sampleIntervalTimeUnit);
  
+        if (runningSampleCountDelta > LastNumSamples)
+            lostSamples = runningSampleCountDelta - LastNumSamples;
+
         // If we missed a small number of samples, replicate the last sample.
         if ((runningSampleCountDelta > LastNumSamples) && (runningSampleCountDelta <= 254))
         {
-            if (HandlerRef.HasHandlers())
+            if (hasBodyFrameConsumers())
             {
                 MessageBodyFrame sensors(this);
 
@@ -846,7 +1246,7 @@ void Sensor2DeviceImpl::onTrackerMessage(Tracker2Message* message)
                 sensors.Temperature   = LastTemperature;
 
                 pCalibration->Apply(sensors);
-                HandlerRef.Call(sensors);
+                frames[frameCount++] = sensors;
             }
         }
     }
@@ -861,8 +1261,9 @@ void Sensor2DeviceImpl::onTrackerMessage(Tracker2Message* message)
 
     LastNumSamples = s.NumSamples;
     LastRunningSampleCount = s.RunningSampleCount;
+    countReportSamples(s.NumSamples, lostSamples);
 
-    if (HandlerRef.HasHandlers())
+    if (hasBodyFrameConsumers())
     {
         MessageBodyFrame sensors(this);        
         UByte            iterations = s.NumSamples;
@@ -886,24 +1287,29 @@ void Sensor2DeviceImpl::onTrackerMessage(Tracker2Message* message)
             sensors.Temperature  = s.Temperature * 0.01f;
 
             pCalibration->Apply(sensors);
-            HandlerRef.Call(sensors);
+            frames[frameCount++] = sensors;
 
             // TimeDelta for the last two sample is always fixed.
             sensors.TimeDelta = (float) scaledSampleIntervalTimeUnit;
         }
 
+        deliverBodyFrames(frames, frameCount, receiveTime);
+
         // Send pixel read only when frame timestamp changes.
         if (LastFrameTimestamp != s.FrameTimestamp)
         {
-            MessagePixelRead pixelRead(this);
-            // Prepare message for pixel read
-            pixelRead.PixelReadValue    = s.FrameID;
-            pixelRead.RawFrameTime      = s.FrameTimestamp;
-            pixelRead.RawSensorTime     = s.SampleTimestamp;
-            pixelRead.SensorTimeSeconds = LastSensorTime.TimeSeconds;
-            pixelRead.FrameTimeSeconds  = LastFrameTime.TimeSeconds;
-
-            HandlerRef.Call(pixelRead);
+            if (HandlerRef.HasHandlers(Message_PixelRead))
+            {
+                MessagePixelRead pixelRead(this);
+                // Prepare message for pixel read
+                pixelRead.PixelReadValue    = s.FrameID;
+                pixelRead.RawFrameTime      = s.FrameTimestamp;
+                pixelRead.RawSensorTime     = s.SampleTimestamp;
+                pixelRead.SensorTimeSeconds = LastSensorTime.TimeSeconds;
+                pixelRead.FrameTimeSeconds  = LastFrameTime.TimeSeconds;
+
+                HandlerRef.Call(pixelRead);
+            }
             LastFrameTimestamp = s.FrameTimestamp;
         }
 
@@ -917,12 +1323,15 @@ void Sensor2DeviceImpl::onTrackerMessage(Tracker2Message* message)
             // update the low bits
             FullCameraFrameCount = (FullCameraFrameCount & ~0xFFFF) | s.CameraFrameCount;
 
-            MessageExposureFrame vision(this);
-            vision.CameraPattern = s.CameraPattern;
-            vision.CameraFrameCount = FullCameraFrameCount;
-            vision.CameraTimeSeconds = LastCameraTime.TimeSeconds;
+            if (HandlerRef.HasHandlers(Message_ExposureFrame))
+            {
+                MessageExposureFrame vision(this);
+                vision.CameraPattern = s.CameraPattern;
+                vision.CameraFrameCount = FullCameraFrameCount;
+                vision.CameraTimeSeconds = LastCameraTime.TimeSeconds;
 
-            HandlerRef.Call(vision);
+                HandlerRef.Call(vision);
+            }
         }
 
         LastAcceleration = sensors.Acceleration;
@@ -951,14 +1360,15 @@ void Sensor2DeviceImpl::onTrackerMessage(Tracker2Message* message)
 //   - Any timestamps that didn't increment keep their old system time.
 //   - This is a bit tricky since we don't know which one of timestamps has most recent time.
 //   - The first timestamp must be the IMU one; we assume that others can't be too much ahead of it
+//   - now is the time the report was received, as given to OnInputReport
 
 void UpdateDK2Timestamps(SensorTimeFilter& tf,
-                         SensorTimestampMapping** timestamps, UInt32 *rawValues, int count)
+                         SensorTimestampMapping** timestamps, UInt32 *rawValues, int count,
+                         double now)
 {
     int     updateIndices[4];
     int     updateCount = 0;
     int     i;
-    double  now = Timer::GetSeconds();
 
     OVR_ASSERT(count <= sizeof(updateIndices)/sizeof(int));
 
@@ -974,7 +1384,7 @@ void UpdateDK2Timestamps(SensorTimeFilter& tf,
                 // Only check for rollover in the IMU timestamp
                 if (rawValues[i] < lowMks)
                 {
-                    LogText("Timestamp %d rollover, was: %u, now: %u\n", i, lowMks, rawValues[i]);
+                    OVR_BINARY_LOG_TEXT("Timestamp %d rollover, was: %u, now: %u\n", (i, lowMks, rawValues[i]));
                     timestamps[i]->TimestampMks += 0x100000000;
                 }
                 // Update the low bits
@@ -1014,7 +1424,7 @@ void UpdateDK2Timestamps(SensorTimeFilter& tf,
 }
 
 
-void Sensor2DeviceImpl::OnInputReport(UByte* pData, UInt32 length)
+void Sensor2DeviceImpl::OnInputReport(UByte* pData, UInt32 length, double receiveTime)
 {
 	bool processed = false;
     if (!processed)
@@ -1040,9 +1450,10 @@ void Sensor2DeviceImpl::OnInputReport(UByte* pData, UInt32 length)
                 message.Sensors.FrameTimestamp
             };
             // Handle wrap-around and convert samples to system time for any samples that changed.
-            UpdateDK2Timestamps(TimeFilter, tsMaps, tsRawMks, sizeof(tsRawMks)/sizeof(tsRawMks[0]));            
+            UpdateDK2Timestamps(TimeFilter, tsMaps, tsRawMks, sizeof(tsRawMks)/sizeof(tsRawMks[0]),
+                                receiveTime);            
 
-            onTrackerMessage(&message);
+            onTrackerMessage(&message, receiveTime);
 
             /*
             if (SF_LOG_fp)
@@ -1091,26 +1502,30 @@ void Sensor2DeviceImpl::OnInputReport(UByte* pData, UInt32 length)
     }
 }
 
+bool Sensor2DeviceImpl::writeKeepAlive()
+{
+    // Must send DK2 keep-alive.
+    KeepAliveMuxReport keepAlive;
+    keepAlive.CommandId = 0;
+    keepAlive.INReport = 11;
+    keepAlive.Interval = KeepAliveTimeoutMs;
+
+    KeepAliveMuxImpl keepAliveImpl(keepAlive);
+    return GetInternalDevice()->SetFeatureReport(keepAliveImpl.Buffer, KeepAliveMuxImpl::PacketSize);
+}
+
 double Sensor2DeviceImpl::OnTicks(double tickSeconds)
 {
+    double nextTickDelta = serviceKeepAlive(tickSeconds);
 
-    if (tickSeconds >= NextKeepAliveTickSeconds)
-    {
-        // Must send DK2 keep-alive. Set Keep-alive at 10 seconds.
-        KeepAliveMuxReport keepAlive;
-        keepAlive.CommandId = 0;
-        keepAlive.INReport = 11;
-        keepAlive.Interval = 10 * 1000;
-
-        // Device creation is done from background thread so we don't need to add this to the command queue.
-        KeepAliveMuxImpl keepAliveImpl(keepAlive);
-        GetInternalDevice()->SetFeatureReport(keepAliveImpl.Buffer, KeepAliveMuxImpl::PacketSize);
-
-		// Emit keep-alive every few seconds.
-        double keepAliveDelta = 3.0;        // Use 3-second interval.
-        NextKeepAliveTickSeconds = tickSeconds + keepAliveDelta;
-    }
-    return NextKeepAliveTickSeconds - tickSeconds;
+    // Load the temperature tables in small batches, so that the reports that
+    // arrive meanwhile are not held up behind the whole table.
+    if (!pCalibration->LoadTemperatureReports(TemperatureReportsPerTick))
+        nextTickDelta = Alg::Min(nextTickDelta, TemperatureReportsTickDelay);
+    else if (CollectTemperaturePackets)
+        cacheTemperatureReports();
+
+    return nextTickDelta;
 }
 
 /*
@@ -29,6 +29,7 @@ limitations under the License.
 
 #include "OVR_SensorImpl.h"
 #include "OVR_SensorCalibration.h"
+#include "OVR_SensorCalibrationCache.h"
 
 namespace OVR {
     
@@ -46,6 +47,24 @@ struct SensorTimestampMapping
         : TimestampMks(0), TimeSeconds(0.0), DebugTag(debugTag) { }
 };
 
+//-------------------------------------------------------------------------------------
+// A feature report that applications set often, such as the display report.
+// Set stores its report as Pending and queues the write; the device thread sends
+// whatever is pending by then, so writes queued behind one another send only the
+// latest report. Last is what the device thread last wrote or read, and a pending
+// report that packs to the same bytes is not written again.
+template<class Report>
+struct FeatureReportCache
+{
+    Lock        PendingLock;
+    Report      Pending;
+    // Used on the device thread only.
+    Report      Last;
+    bool        LastValid;
+
+    FeatureReportCache() : LastValid(false) { }
+};
+
 //-------------------------------------------------------------------------------------
 // ***** OVR::Sensor2DeviceImpl
 
@@ -57,7 +76,7 @@ public:
     ~Sensor2DeviceImpl();
 
     // HIDDevice::Notifier interface.
-    virtual void        OnInputReport(UByte* pData, UInt32 length);
+    virtual void        OnInputReport(UByte* pData, UInt32 length, double receiveTime);
     virtual double      OnTicks(double tickSeconds);        
 
     // Get/set feature reports added for DK2. See 'DK2 Firmware Specification' document details.
@@ -86,6 +105,7 @@ public:
     virtual bool		GetUUIDReport(UUIDReport* data);
 
     virtual bool		SetTemperatureReport(const TemperatureReport& data);
+    virtual bool        GetTemperatureReport(TemperatureReport* data);
     virtual bool        GetAllTemperatureReports(Array<Array<TemperatureReport> >*);
 
     virtual bool        GetGyroOffsetReport(GyroOffsetReport* data);
@@ -96,19 +116,24 @@ public:
 protected:
     virtual void        openDevice();
 
+    virtual bool        writeKeepAlive();
+
     bool                decodeTracker2Message(Tracker2Message* message, UByte* buffer, int size);
 
-    bool	            setTrackingReport(const TrackingReport& data);
+    // Write the pending report of TrackingCache and DisplayCache.
+    bool	            setTrackingReport();
     bool                getTrackingReport(TrackingReport* data);
 
-    bool	            setDisplayReport(const DisplayReport& data);
+    bool	            setDisplayReport();
     bool                getDisplayReport(DisplayReport* data);
 
     bool	            setMagCalibrationReport(const MagCalibrationReport& data);
     bool                getMagCalibrationReport(MagCalibrationReport* data);
 
     bool	            setPositionCalibrationReport(const PositionCalibrationReport& data);
-    bool                getPositionCalibrationReport(PositionCalibrationReport* data);
+    // Appends the raw report to packets, if given, for the calibration cache.
+    bool                getPositionCalibrationReport(PositionCalibrationReport* data,
+                                                     Array<UByte>* packets = NULL);
     bool                getAllPositionCalibrationReports(Array<PositionCalibrationReport>* data);
 
     bool	            setCustomPatternReport(const CustomPatternReport& data);
@@ -132,8 +157,14 @@ protected:
     bool	            setLensDistortionReport(const LensDistortionReport& data);
     bool                getLensDistortionReport(LensDistortionReport* data);
 
+    // Loads the calibration cache for this device, keyed by its UUID report.
+    void                loadCalibrationCache();
+    // Caches the temperature tables once they are read, from the packets
+    // collected by getTemperatureReport.
+    void                cacheTemperatureReports();
+
     // Called for decoded messages
-    void                onTrackerMessage(Tracker2Message* message);
+    void                onTrackerMessage(Tracker2Message* message, double receiveTime);
 
     UByte                   LastNumSamples;
     UInt16		            LastRunningSampleCount;
@@ -146,6 +177,15 @@ protected:
     UInt32                  LastFrameTimestamp;
 
     SensorCalibration       *pCalibration;
+
+    SensorCalibrationCache  CalibrationCache;
+    // Temperature reports read while the tables are loaded and not cached yet,
+    // packed as received.
+    bool                    CollectTemperaturePackets;
+    Array<UByte>            TemperaturePackets;
+
+    FeatureReportCache<TrackingReport> TrackingCache;
+    FeatureReportCache<DisplayReport>  DisplayCache;
 };
 
 } // namespace OVR
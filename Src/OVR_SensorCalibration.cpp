@@ -25,6 +25,7 @@ limitations under the License.
 *************************************************************************************/
 
 #include "OVR_SensorCalibration.h"
+#include "Kernel/OVR_PerfCounters.h"
 #include "Kernel/OVR_Log.h"
 #include "Kernel/OVR_Threads.h"
 #include <time.h>
@@ -37,7 +38,8 @@ const UByte VERSION = 2;
 const UByte MAX_COMPAT_VERSION = 15;
 
 SensorCalibration::SensorCalibration(SensorDevice* pSensor)
-    : MagCalibrated(false), GyroFilter(6000), GyroAutoTemperature(0)
+    : MagCalibrated(false), TemperatureReportsLeft(-1), TemperatureReportsLoaded(false),
+      GyroFilter(6000), GyroAutoTemperature(0)
 {
     this->pSensor = pSensor;
 };
@@ -56,11 +58,12 @@ void SensorCalibration::Initialize()
         GyroAutoTemperature = (float) gyroReport.Temperature;
     }
     
-    // read the temperature tables and prepare the interpolation structures
-    result = pSensor->GetAllTemperatureReports(&TemperatureReports);
-    OVR_ASSERT(result);
+    // the temperature tables are read later by LoadTemperatureReports
+    TemperatureReports.Clear();
     for (int i = 0; i < 3; i++)
         Interpolators[i].Initialize(TemperatureReports, i);
+    TemperatureReportsLeft = -1;
+    TemperatureReportsLoaded = false;
 
     // read the mag calibration
     MagCalibrationReport report;
@@ -74,6 +77,60 @@ void SensorCalibration::Initialize()
     }
 }
 
+bool SensorCalibration::LoadTemperatureReports(int maxReports)
+{
+    if (TemperatureReportsLoaded)
+        return true;
+
+    for (int read = 0; read < maxReports; read++)
+    {
+        TemperatureReport t;
+        if (!pSensor->GetTemperatureReport(&t))
+        {
+            LogError("Temperature calibration could not be read!\n");
+            TemperatureReports.Clear();
+            TemperatureReportsLoaded = true;
+            return true;
+        }
+
+        // the first report only gives the size of the table
+        if (TemperatureReportsLeft < 0)
+        {
+            TemperatureReports.Clear();
+            TemperatureReports.Resize(t.NumBins);
+            for (int i = 0; i < (int)t.NumBins; i++)
+                TemperatureReports[i].Resize(t.NumSamples);
+            TemperatureReportsLeft = t.NumBins * t.NumSamples;
+        }
+        else
+        {
+            OVR_ASSERT(t.NumBins == TemperatureReports.GetSize() && t.NumSamples == TemperatureReports[0].GetSize());
+            if (t.Bin < TemperatureReports.GetSize() && t.Sample < TemperatureReports[t.Bin].GetSize())
+                TemperatureReports[t.Bin][t.Sample] = t;
+            TemperatureReportsLeft--;
+        }
+
+        if (TemperatureReportsLeft == 0)
+        {
+            // prepare the interpolation structures
+            for (int i = 0; i < 3; i++)
+                Interpolators[i].Initialize(TemperatureReports, i);
+            TemperatureReportsLoaded = true;
+            return true;
+        }
+    }
+    return false;
+}
+
+void SensorCalibration::SetTemperatureReports(const Array<Array<TemperatureReport> >& temperatureReports)
+{
+    TemperatureReports = temperatureReports;
+    for (int i = 0; i < 3; i++)
+        Interpolators[i].Initialize(TemperatureReports, i);
+    TemperatureReportsLeft = 0;
+    TemperatureReportsLoaded = true;
+}
+
 void SensorCalibration::DebugPrintLocalTemperatureTable()
 {
 	LogText("TemperatureReports:\n");
@@ -134,8 +191,12 @@ void SensorCalibration::DebugClearHeadsetTemperatureReports()
 	}
 }
 
+static PerfCounter ApplyCounter("perf.calibration.apply");
+
 void SensorCalibration::Apply(MessageBodyFrame& msg)
 {
+    PerfCounterScope perfScope(ApplyCounter);
+
     AutocalibrateGyro(msg);
 
     // compute the interpolated offset
@@ -184,6 +245,10 @@ void SensorCalibration::StoreAutoOffset()
     const double minExtraDeltaT = 0.5;
     const UInt32 minDelay = 24 * 3600; // 1 day in seconds
 
+    // the samples can only be rotated once the whole table has been read
+    if (!TemperatureReportsLoaded || TemperatureReports.GetSize() == 0)
+        return;
+
     // find the best bin
     UPInt binIdx = 0;
     for (UPInt i = 1; i < TemperatureReports.GetSize(); i++) 
@@ -285,12 +350,102 @@ void OffsetInterpolator::Initialize(Array<Array<TemperatureReport> > const& temp
             Values.PushBack(report.Offset[coord]);
         }
     }
+
+    buildIntervals();
+}
+
+// Interval search done by GetOffset before the table existed, and still used
+// outside of it: the interval that contains targetTemperature or, if all points
+// are on the same side of targetTemperature, the adjacent interval.
+int OffsetInterpolator::findInterval(double targetTemperature) const
+{
+    int count = (int) Temperatures.GetSize();
+    int l;
+    if (targetTemperature < Temperatures[1])
+        l = 0;
+    else if (targetTemperature >= Temperatures[count - 2])
+        l = count - 2;
+    else
+        for (l = 1; l < count - 2; l++)
+            if (Temperatures[l] <= targetTemperature && targetTemperature < Temperatures[l+1])
+                break;
+    // two bins out of order leave the search past the only interval
+    return Min(l, count - 2);
+}
+
+void OffsetInterpolator::buildIntervals()
+{
+    const double minInterpolationDist = 0.5;
+
+    IntervalUpper.Clear();
+    IntervalSlope.Clear();
+    IntervalTable.Clear();
+
+    int count = (int) Temperatures.GetSize();
+    if (count < 2)
+        return;
+
+    // The upper point and slope used for each interval only depend on the points,
+    // so they are worked out once here instead of for every sample.
+    IntervalUpper.Resize(count - 1);
+    IntervalSlope.Resize(count - 1);
+    for (int l = 0; l < count - 1; l++)
+    {
+        int u = l + 1;
+        int lower = l;
+
+        // extend the interval if it's too small and the interpolation is unreliable
+        if (Temperatures[u] - Temperatures[lower] < minInterpolationDist)
+        {
+            if (lower > 0 
+                && (u == count - 1 || Temperatures[u] - Temperatures[lower - 1] < Temperatures[u + 1] - Temperatures[lower]))
+                lower--;
+            else if (u < count - 1)
+                u++;
+        }
+
+        // verify correctness
+        OVR_ASSERT(lower >= 0 && u < count);
+        OVR_ASSERT((lower == 0 && u == count - 1) || Temperatures[u] - Temperatures[lower] > minInterpolationDist);
+        OVR_ASSERT(Temperatures[lower] <= Temperatures[u]);
+
+        IntervalUpper[l] = u;
+        if (Temperatures[u] - Temperatures[lower] >= minInterpolationDist)
+            IntervalSlope[l] = (Values[u] - Values[lower]) / (Temperatures[u] - Temperatures[lower]);
+        else
+            // avoid a badly conditioned problem
+            IntervalSlope[l] = 0;
+    }
+
+    // Uniform table over the inner points, from which the interval is found without
+    // a search. It needs the points in order; cells that contain a point are marked
+    // with -1 and left to findInterval.
+    TableStart = Temperatures[1];
+    double range = Temperatures[count - 2] - TableStart;
+    if (count < 4 || count > 127 || !(range > 0))
+        return;
+    for (int i = 1; i < count - 2; i++)
+        if (!(Temperatures[i] < Temperatures[i + 1]))
+            return;
+
+    TableScale = TableSize / range;
+    IntervalTable.Resize(TableSize);
+    for (int cell = 0; cell < TableSize; cell++)
+    {
+        // Widened a little, so that rounding of the cell index can't cross a point.
+        double cellStart = TableStart + cell / TableScale;
+        double margin    = 1e-6 / TableScale;
+        bool   split     = false;
+        for (int i = 1; i <= count - 2; i++)
+            if (Temperatures[i] > cellStart - margin && Temperatures[i] < cellStart + 1 / TableScale + margin)
+                split = true;
+        IntervalTable[cell] = split ? (SByte)-1 : (SByte)findInterval(cellStart);
+    }
 }
 
 double OffsetInterpolator::GetOffset(double targetTemperature, double autoTemperature, double autoValue)
 {
     const double autoRangeExtra = 1.0;
-    const double minInterpolationDist = 0.5;
 
     // difference between current and autocalibrated temperature adjusted for preference over historical data
     const double adjustedDeltaT = Abs(autoTemperature - targetTemperature) - autoRangeExtra;
@@ -307,43 +462,17 @@ double OffsetInterpolator::GetOffset(double targetTemperature, double autoTemper
             return Values[0];
     }
 
-    // first, find the interval that contains targetTemperature
-    // if all points are on the same side of targetTemperature, find the adjacent interval
-    int l;
-    if (targetTemperature < Temperatures[1])
-        l = 0;
-    else if (targetTemperature >= Temperatures[count - 2])
-        l = count - 2;
-    else
-        for (l = 1; l < count - 2; l++)
-            if (Temperatures[l] <= targetTemperature && targetTemperature < Temperatures[l+1])
-                break;
-    int u = l + 1;
-
-    // extend the interval if it's too small and the interpolation is unreliable
-    if (Temperatures[u] - Temperatures[l] < minInterpolationDist)
-    {
-        if (l > 0 
-            && (u == count - 1 || Temperatures[u] - Temperatures[l - 1] < Temperatures[u + 1] - Temperatures[l]))
-            l--;
-        else if (u < count - 1)
-            u++;
-    }
-
-    // verify correctness
-    OVR_ASSERT(l >= 0 && u < count);
-    OVR_ASSERT(l == 0 || Temperatures[l] <= targetTemperature);
-    OVR_ASSERT(u == count - 1 || targetTemperature < Temperatures[u]);
-    OVR_ASSERT((l == 0 && u == count - 1) || Temperatures[u] - Temperatures[l] > minInterpolationDist);
-    OVR_ASSERT(Temperatures[l] <= Temperatures[u]);
+    // first, find the interval for targetTemperature, from the table when it's in range
+    int l = -1;
+    double cell = (targetTemperature - TableStart) * TableScale;
+    if (IntervalTable.GetSize() && cell >= 0 && cell < TableSize)
+        l = IntervalTable[(int)cell];
+    if (l < 0)
+        l = findInterval(targetTemperature);
+    int    u     = IntervalUpper[l];
+    double slope = IntervalSlope[l];
 
     // perform the interpolation
-    double slope;
-    if (Temperatures[u] - Temperatures[l] >= minInterpolationDist)
-        slope = (Values[u] - Values[l]) / (Temperatures[u] - Temperatures[l]);
-    else
-        // avoid a badly conditioned problem
-        slope = 0;
     if (adjustedDeltaT < Abs(Temperatures[u] - targetTemperature))
         // use the autocalibrated value, if it's close
         return autoValue + slope * (targetTemperature - autoTemperature);
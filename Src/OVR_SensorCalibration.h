@@ -32,14 +32,34 @@ limitations under the License.
 
 namespace OVR {
 
+// Interpolates the gyro offset of one axis between the temperature table bins.
+// Initialize works out the interpolation interval of each pair of bins and a
+// uniform table mapping temperatures to them, so GetOffset doesn't search the bins.
 class OffsetInterpolator
 {
 public:
+    enum { TableSize = 64 };
+
+    OffsetInterpolator() : TableStart(0), TableScale(0) { }
+
     void Initialize(Array<Array<TemperatureReport> > const& temperatureReports, int coord);
     double GetOffset(double targetTemperature, double autoTemperature, double autoValue);
 
     Array<double> Temperatures;
     Array<double> Values;
+
+private:
+    int  findInterval(double targetTemperature) const;
+    void buildIntervals();
+
+    // Upper point and slope of each interval, by its lower bin.
+    Array<int>    IntervalUpper;
+    Array<double> IntervalSlope;
+    // Interval for each cell of the table, or -1 if a bin falls inside the cell.
+    // Empty if the bins aren't in order.
+    Array<SByte>  IntervalTable;
+    double        TableStart;
+    double        TableScale;
 };
 
 class SensorCalibration : public NewOverrideBase
@@ -47,8 +67,15 @@ class SensorCalibration : public NewOverrideBase
 public:
     SensorCalibration(SensorDevice* pSensor);
 
-    // Load data from the HW and perform the necessary preprocessing
+    // Load the data needed for tracking from the HW and perform the necessary
+    // preprocessing. The temperature tables are left to LoadTemperatureReports.
     void Initialize();
+    // Reads up to maxReports more of the temperature tables; returns true once
+    // they are complete, or could not be read. Until then the gyro offset comes
+    // from the factory and autocalibrated values alone.
+    bool LoadTemperatureReports(int maxReports);
+    // Uses temperature tables that were read earlier, instead of loading them.
+    void SetTemperatureReports(const Array<Array<TemperatureReport> >& temperatureReports);
     // Apply the calibration
     void Apply(MessageBodyFrame& msg);
     // Is mag calibration available?
@@ -71,9 +98,12 @@ protected:
     // Temperature based data
     Array<Array<TemperatureReport> > TemperatureReports;
     OffsetInterpolator Interpolators[3];
+    // Reports still to be read, or -1 before the table size is known.
+    int TemperatureReportsLeft;
+    bool TemperatureReportsLoaded;
 
     // Autocalibration data
-    SensorFilterf GyroFilter;
+    SensorFilter<float, CircularBufferFixed<Vector3f, 8192> > GyroFilter;
     Vector3f GyroAutoOffset;
     float GyroAutoTemperature;
 };
@@ -0,0 +1,254 @@
+/************************************************************************************
+
+Filename    :   OVR_SensorCalibrationCache.cpp
+Content     :   On-disk cache of calibration feature reports, per device
+Created     :   October 14, 2026
+
+Copyright   :   Copyright 2014 Oculus VR, Inc. All Rights reserved.
+
+Licensed under the Oculus VR Rift SDK License Version 3.1 (the "License");
+you may not use the Oculus VR Rift SDK except in compliance with the License,
+which is provided at the time of installation or download, or which
+otherwise accompanies this software in either electronic or hard copy form.
+
+You may obtain a copy of the License at
+
+http://www.oculusvr.com/licenses/LICENSE-3.1
+
+Unless required by applicable law or agreed to in writing, the Oculus VR SDK
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+*************************************************************************************/
+
+#include "OVR_SensorCalibrationCache.h"
+#include "OVR_Profile.h"
+#include "Kernel/OVR_MappedFile.h"
+#include "Kernel/OVR_SysFile.h"
+#include "Kernel/OVR_Alg.h"
+#include "Kernel/OVR_Log.h"
+#include <stdio.h>
+#include <string.h>
+
+namespace OVR {
+
+// "OVRC", little-endian.
+static const UInt32 CalibrationCacheMagic = 0x4352564F;
+
+static void appendBytes(Array<UByte>* data, const UByte* bytes, UPInt size)
+{
+    UPInt pos = data->GetSize();
+    data->Resize(pos + size);
+    memcpy(&(*data)[pos], bytes, size);
+}
+
+static void appendUInt16(Array<UByte>* data, UInt16 value)
+{
+    UByte bytes[2];
+    Alg::EncodeUInt16(bytes, value);
+    appendBytes(data, bytes, 2);
+}
+
+static void appendUInt32(Array<UByte>* data, UInt32 value)
+{
+    UByte bytes[4];
+    Alg::EncodeUInt32(bytes, value);
+    appendBytes(data, bytes, 4);
+}
+
+SensorCalibrationCache::SensorCalibrationCache()
+    : HasDevice(false), FirmwareVersion(0), InterfaceVersion(0)
+{
+    memset(UUID, 0, sizeof(UUID));
+}
+
+bool SensorCalibrationCache::Load(const String& serialNumber, UInt32 firmwareVersion,
+                                  UByte interfaceVersion, const UUIDReport& uuid)
+{
+    HasDevice        = true;
+    SerialNumber     = serialNumber;
+    FirmwareVersion  = firmwareVersion;
+    InterfaceVersion = interfaceVersion;
+    memcpy(UUID, uuid.UUIDValue, sizeof(UUID));
+    Blobs.Clear();
+
+    if (SerialNumber.IsEmpty())
+        return false;
+
+    MappedFile file;
+    if (!file.Open(getPath()))
+        return false;
+
+    if (!parse(file.GetData(), (UPInt)file.GetLength()))
+    {
+        Blobs.Clear();
+        return false;
+    }
+    return Blobs.GetSize() > 0;
+}
+
+// File layout, little-endian: magic, file version, serial number (length and
+// bytes), firmware version, interface version, UUID, blob count, then each blob's
+// report id, size and data.
+bool SensorCalibrationCache::parse(const UByte* data, UPInt size)
+{
+    UPInt pos = 0;
+
+    if (size < 10 ||
+        Alg::DecodeUInt32(data) != CalibrationCacheMagic ||
+        Alg::DecodeUInt32(data + 4) != FileVersion)
+        return false;
+    pos = 8;
+
+    UPInt serialLength = Alg::DecodeUInt16(data + pos);
+    pos += 2;
+    if (size - pos < serialLength + 4 + 1 + UUIDReport::UUID_SIZE + 2)
+        return false;
+    if (String((const char*)data + pos, serialLength) != SerialNumber)
+        return false;
+    pos += serialLength;
+
+    if (Alg::DecodeUInt32(data + pos) != FirmwareVersion ||
+        data[pos + 4] != InterfaceVersion ||
+        memcmp(data + pos + 5, UUID, UUIDReport::UUID_SIZE) != 0)
+        return false;
+    pos += 5 + UUIDReport::UUID_SIZE;
+
+    int count = Alg::DecodeUInt16(data + pos);
+    pos += 2;
+    for (int i = 0; i < count; i++)
+    {
+        if (size - pos < 5)
+            return false;
+        UByte reportId  = data[pos];
+        UPInt blobSize  = Alg::DecodeUInt32(data + pos + 1);
+        pos += 5;
+        if (size - pos < blobSize)
+            return false;
+
+        Blob blob;
+        blob.ReportId = reportId;
+        blob.Data.Resize(blobSize);
+        if (blobSize)
+            memcpy(&blob.Data[0], data + pos, blobSize);
+        Blobs.PushBack(blob);
+        pos += blobSize;
+    }
+    return true;
+}
+
+bool SensorCalibrationCache::Save()
+{
+    if (!HasDevice || SerialNumber.IsEmpty())
+        return false;
+
+    // Write a new file and move it over the old one, so that a process reading
+    // the cache meanwhile never sees it half written.
+    String path     = getPath();
+    String tempPath = path + ".tmp";
+
+    // The file is small; put it together in memory and write it at once.
+    Array<UByte> data;
+    appendUInt32(&data, CalibrationCacheMagic);
+    appendUInt32(&data, FileVersion);
+    appendUInt16(&data, (UInt16)SerialNumber.GetSize());
+    appendBytes(&data, (const UByte*)SerialNumber.ToCStr(), SerialNumber.GetSize());
+    appendUInt32(&data, FirmwareVersion);
+    appendBytes(&data, &InterfaceVersion, 1);
+    appendBytes(&data, UUID, UUIDReport::UUID_SIZE);
+
+    appendUInt16(&data, (UInt16)Blobs.GetSize());
+    for (UPInt i = 0; i < Blobs.GetSize(); i++)
+    {
+        const Blob& blob = Blobs[i];
+        appendBytes(&data, &blob.ReportId, 1);
+        appendUInt32(&data, (UInt32)blob.Data.GetSize());
+        if (blob.Data.GetSize())
+            appendBytes(&data, &blob.Data[0], blob.Data.GetSize());
+    }
+
+    SysFile file;
+    if (!file.Open(tempPath, File::Open_Write | File::Open_Create | File::Open_Truncate))
+    {
+        LogError("OVR::SensorCalibrationCache - can't write '%s'\n", tempPath.ToCStr());
+        return false;
+    }
+    bool written = file.Write(&data[0], (int)data.GetSize()) == (int)data.GetSize();
+    file.Close();
+
+#if defined(OVR_OS_WIN32)
+    // rename doesn't replace existing files on Windows.
+    if (written)
+        remove(path.ToCStr());
+#endif
+    if (!written || rename(tempPath.ToCStr(), path.ToCStr()) != 0)
+    {
+        remove(tempPath.ToCStr());
+        return false;
+    }
+    return true;
+}
+
+const Array<UByte>* SensorCalibrationCache::GetBlob(UByte reportId) const
+{
+    for (UPInt i = 0; i < Blobs.GetSize(); i++)
+    {
+        if (Blobs[i].ReportId == reportId)
+            return &Blobs[i].Data;
+    }
+    return NULL;
+}
+
+void SensorCalibrationCache::SetBlob(UByte reportId, const Array<UByte>& data)
+{
+    for (UPInt i = 0; i < Blobs.GetSize(); i++)
+    {
+        if (Blobs[i].ReportId == reportId)
+        {
+            Blobs[i].Data = data;
+            return;
+        }
+    }
+
+    Blob blob;
+    blob.ReportId = reportId;
+    blob.Data     = data;
+    Blobs.PushBack(blob);
+}
+
+bool SensorCalibrationCache::RemoveBlob(UByte reportId)
+{
+    for (UPInt i = 0; i < Blobs.GetSize(); i++)
+    {
+        if (Blobs[i].ReportId == reportId)
+        {
+            Blobs.RemoveAt(i);
+            return true;
+        }
+    }
+    return false;
+}
+
+String SensorCalibrationCache::getPath() const
+{
+    // Keep only the characters that are safe in a file name.
+    String name;
+    for (UPInt i = 0; i < SerialNumber.GetSize(); i++)
+    {
+        char c = SerialNumber.ToCStr()[i];
+        if ((c >= '0' && c <= '9') || (c >= 'A' && c <= 'Z') || (c >= 'a' && c <= 'z'))
+            name.AppendChar(c);
+        else
+            name.AppendChar('_');
+    }
+
+    String path = GetBaseOVRPath(true);
+    path += "/Calibration_";
+    path += name;
+    path += ".bin";
+    return path;
+}
+
+} // namespace OVR
@@ -0,0 +1,86 @@
+/************************************************************************************
+
+Filename    :   OVR_SensorCalibrationCache.h
+Content     :   On-disk cache of calibration feature reports, per device
+Created     :   October 14, 2026
+
+Copyright   :   Copyright 2014 Oculus VR, Inc. All Rights reserved.
+
+Licensed under the Oculus VR Rift SDK License Version 3.1 (the "License");
+you may not use the Oculus VR Rift SDK except in compliance with the License,
+which is provided at the time of installation or download, or which
+otherwise accompanies this software in either electronic or hard copy form.
+
+You may obtain a copy of the License at
+
+http://www.oculusvr.com/licenses/LICENSE-3.1
+
+Unless required by applicable law or agreed to in writing, the Oculus VR SDK
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+*************************************************************************************/
+
+#ifndef OVR_SensorCalibrationCache_h
+#define OVR_SensorCalibrationCache_h
+
+#include "OVR_Device.h"
+
+namespace OVR {
+
+//-------------------------------------------------------------------------------------
+// ***** SensorCalibrationCache
+
+// Keeps the calibration tables a sensor returns through many feature reports, such
+// as its temperature and position calibration, in a small binary file per device
+// next to the profiles, so that later processes don't have to read them again.
+//
+// Each blob holds the packed feature reports of one table, keyed by their report
+// id. The file records the serial number, firmware and interface versions and the
+// UUID report of the device it was written for, and is ignored unless all of them
+// match the connected device. Writes to a cached table must discard its blob.
+
+class SensorCalibrationCache : public NewOverrideBase
+{
+public:
+    enum { FileVersion = 1 };
+
+    SensorCalibrationCache();
+
+    // Sets the device the cache is for and loads its file, if there's one that
+    // matches the device. Returns true if cached data was loaded.
+    bool                Load(const String& serialNumber, UInt32 firmwareVersion,
+                             UByte interfaceVersion, const UUIDReport& uuid);
+    // Writes the cache for the device given to Load.
+    bool                Save();
+
+    // Cached packets of a report, or null if it isn't cached.
+    const Array<UByte>* GetBlob(UByte reportId) const;
+    void                SetBlob(UByte reportId, const Array<UByte>& data);
+    // Discards the cached packets of a report; returns true if there were any.
+    bool                RemoveBlob(UByte reportId);
+
+private:
+    struct Blob
+    {
+        UByte           ReportId;
+        Array<UByte>    Data;
+    };
+
+    String              getPath() const;
+    bool                parse(const UByte* data, UPInt size);
+
+    bool                HasDevice;
+    String              SerialNumber;
+    UInt32              FirmwareVersion;
+    UByte               InterfaceVersion;
+    UByte               UUID[UUIDReport::UUID_SIZE];
+
+    Array<Blob>         Blobs;
+};
+
+} // namespace OVR
+
+#endif // OVR_SensorCalibrationCache_h
@@ -34,66 +34,99 @@ limitations under the License.
 
 namespace OVR {
 
+// Sums runs of filter elements that are contiguous in memory, walking back from the
+// newest one; weights, if given, apply newest first. Vector3 elements go through the
+// MathSIMD kernels, other types through a plain loop.
+template <typename T>
+struct SensorFilterSum
+{
+    static void SumBack(T* result, const T* newest, const float* weights, int n)
+    {
+        for (int i = 0; i < n; i++)
+            *result += weights ? newest[-i] * weights[i] : newest[-i];
+    }
+};
+
+template <typename T>
+struct SensorFilterSum<Vector3<T> >
+{
+    static void SumBack(Vector3<T>* result, const Vector3<T>* newest, const float* weights, int n)
+    {
+        OVR_COMPILER_ASSERT(sizeof(Vector3<T>) == 3 * sizeof(T));
+        MathSIMD<T>::Vector3SumBack(&result->x, &newest->x, weights, n);
+    }
+};
+
 // A base class for filters that maintains a buffer of sensor data taken over time and implements
 // various simple filters, most of which are linear functions of the data history.
-// Maintains the running sum of its elements for better performance on large capacity values
-template <typename T>
-class SensorFilterBase : public CircularBuffer<T>
+// Maintains the running sum of its elements for better performance on large capacity values.
+// Buffer is CircularBuffer<T>, or CircularBufferFixed<T, N> to keep the elements inside
+// the filter without virtual calls.
+template <typename T, class Buffer = CircularBuffer<T> >
+class SensorFilterBase : public Buffer
 {
 protected:
     T RunningTotal;               // Cached sum of the elements
 
 public:
-    SensorFilterBase(int capacity = CircularBuffer<T>::DefaultCapacity)
-        : CircularBuffer<T>(capacity), RunningTotal() 
+    SensorFilterBase(int capacity = Buffer::DefaultCapacity)
+        : Buffer(capacity), RunningTotal() 
+    {
+        this->Clear();
+    };
+    // Uses the caller's storage for the elements; see DequeInline.
+    SensorFilterBase(T* storage, int capacity)
+        : Buffer(storage, capacity), RunningTotal() 
     {
         this->Clear();
     };
 
-    // The following methods are augmented to update the cached running sum value
+    // The following methods are augmented to update the cached running sum value.
+    // The oldest element is popped here when full, rather than by Buffer, whose
+    // PopFront needn't be virtual.
     void PushBack(const T &e)
     {
-        CircularBuffer<T>::PushBack(e);
+        if (this->IsFull())
+            PopFront();
+        Buffer::PushBack(e);
         RunningTotal += e;
         if (this->End == 0)
         {
             // update the cached total to avoid error accumulation
-            RunningTotal = T();
-            for (int i = 0; i < this->ElemCount; i++)
-                RunningTotal += this->Data[i];
+            RunningTotal = SumBack(this->ElemCount);
         } 
     }
 
     void PushFront(const T &e)
     {
-        CircularBuffer<T>::PushFront(e);
+        if (this->IsFull())
+            PopBack();
+        Buffer::PushFront(e);
         RunningTotal += e;
         if (this->Beginning == 0)
         {
             // update the cached total to avoid error accumulation
-            RunningTotal = T();
-            for (int i = 0; i < this->ElemCount; i++)
-                RunningTotal += this->Data[i];
+            RunningTotal = SumBack(this->ElemCount);
         }
     }
 
     T PopBack() 
     { 
-        T e = CircularBuffer<T>::PopBack();
+        T e = Buffer::PopBack();
         RunningTotal -= e;
         return e;
     }
 
     T PopFront() 
     { 
-        T e = CircularBuffer<T>::PopFront();
+        T e = Buffer::PopFront();
         RunningTotal -= e;
         return e;
     }
 
     void Clear()
     {
-        CircularBuffer<T>::Clear();
+        Buffer::Clear();
         RunningTotal = T();
     }
 
@@ -112,70 +145,63 @@ public:
 	{
         OVR_ASSERT(n > 0);
         OVR_ASSERT(this->Capacity >= n);
-		T total = T();
-        for (int i = 0; i < n; i++) 
-        {
-			total += this->PeekBack(i);
-		}
-		return total / n;
+		return SumBack(n) / n;
 	}
 
+    // Sum of the newest n elements, each times weights[i] (newest first) if given.
+    T SumBack(int n, const float* weights = NULL) const
+    {
+        OVR_ASSERT(n <= this->ElemCount);
+        T   total  = T();
+        int newest = this->wrapIndex(this->End - 1);
+        for (int i = 0; i < n; )
+        {
+            int run = Alg::Min(n - i, newest + 1);
+            SensorFilterSum<T>::SumBack(&total, &this->Data[newest], weights ? weights + i : NULL, run);
+            i      += run;
+            newest  = this->wrapIndex(newest - run);
+        }
+        return total;
+    }
+
     // A popular family of smoothing filters and smoothed derivatives
 
     T SavitzkyGolaySmooth4() 
     {
         OVR_ASSERT(this->Capacity >= 4);
-        return this->PeekBack(0)*0.7f +
-               this->PeekBack(1)*0.4f +
-               this->PeekBack(2)*0.1f -
-               this->PeekBack(3)*0.2f;
+        static const float weights[4] = { 0.7f, 0.4f, 0.1f, -0.2f };
+        return SumBack(4, weights);
     }
 
     T SavitzkyGolaySmooth8() const
     {
         OVR_ASSERT(this->Capacity >= 8);
-        return this->PeekBack(0)*0.41667f +
-               this->PeekBack(1)*0.33333f +
-               this->PeekBack(2)*0.25f +
-               this->PeekBack(3)*0.16667f +
-               this->PeekBack(4)*0.08333f -
-               this->PeekBack(6)*0.08333f -
-               this->PeekBack(7)*0.16667f;
+        static const float weights[8] = { 0.41667f, 0.33333f, 0.25f, 0.16667f,
+                                          0.08333f, 0.0f, -0.08333f, -0.16667f };
+        return SumBack(8, weights);
     }
 
     T SavitzkyGolayDerivative4() const
     {
         OVR_ASSERT(this->Capacity >= 4);
-        return this->PeekBack(0)*0.3f +
-               this->PeekBack(1)*0.1f -
-               this->PeekBack(2)*0.1f -
-               this->PeekBack(3)*0.3f;
+        static const float weights[4] = { 0.3f, 0.1f, -0.1f, -0.3f };
+        return SumBack(4, weights);
     }
 
     T SavitzkyGolayDerivative5() const
     {
-            OVR_ASSERT(this->Capacity >= 5);
-            return this->PeekBack(0)*0.2f +
-                   this->PeekBack(1)*0.1f -
-                   this->PeekBack(3)*0.1f -
-                   this->PeekBack(4)*0.2f;
-   }
+        OVR_ASSERT(this->Capacity >= 5);
+        static const float weights[5] = { 0.2f, 0.1f, 0.0f, -0.1f, -0.2f };
+        return SumBack(5, weights);
+    }
 
     T SavitzkyGolayDerivative12() const
     {
         OVR_ASSERT(this->Capacity >= 12);
-        return this->PeekBack(0)*0.03846f +
-               this->PeekBack(1)*0.03147f +
-               this->PeekBack(2)*0.02448f +
-               this->PeekBack(3)*0.01748f +
-               this->PeekBack(4)*0.01049f +
-               this->PeekBack(5)*0.0035f -
-               this->PeekBack(6)*0.0035f -
-               this->PeekBack(7)*0.01049f -
-               this->PeekBack(8)*0.01748f -
-               this->PeekBack(9)*0.02448f -
-               this->PeekBack(10)*0.03147f -
-               this->PeekBack(11)*0.03846f;
+        static const float weights[12] = {  0.03846f,  0.03147f,  0.02448f,  0.01748f,
+                                            0.01049f,  0.0035f,  -0.0035f,  -0.01049f,
+                                           -0.01748f, -0.02448f, -0.03147f, -0.03846f };
+        return SumBack(12, weights);
     } 
 
     T SavitzkyGolayDerivativeN(int n) const
@@ -196,8 +222,11 @@ public:
 
     T Median() const
     {
-        T* copy = (T*) OVR_ALLOC(this->ElemCount * sizeof(T));
-        T result = Alg::Median(ArrayAdaptor(copy));
+        T* copy = (T*) OVR_ALLOC_TAGGED(AllocSubsystem_Fusion, this->ElemCount * sizeof(T));
+        for (int i = 0; i < this->ElemCount; i++)
+            copy[i] = this->PeekFront(i);
+        Alg::ArrayAdaptor<T> adaptor(copy, this->ElemCount);
+        T result = Alg::Median(adaptor);
         OVR_FREE(copy);
         return result;
     }
@@ -205,25 +234,175 @@ public:
 
 // This class maintains a buffer of sensor data taken over time and implements
 // various simple filters, most of which are linear functions of the data history.
-template <typename T>
-class SensorFilter : public SensorFilterBase<Vector3<T> >
+// Keeps a running mean and sum of squared deviations (Welford's method) as elements
+// come and go, so that Variance costs the same for any capacity.
+template <typename T, class Buffer = CircularBuffer<Vector3<T> > >
+class SensorFilter : public SensorFilterBase<Vector3<T>, Buffer>
 {
+    typedef SensorFilterBase<Vector3<T>, Buffer> Base;
+
+    Vector3<T> RunningMean;
+    Vector3<T> RunningM2;       // Sum of squared deviations from RunningMean
+
 public:
-	SensorFilter(int capacity = SensorFilterBase<Vector3<T> >::DefaultCapacity) : SensorFilterBase<Vector3<T> >(capacity) { };
+	SensorFilter(int capacity = Base::DefaultCapacity) : Base(capacity) { };
+    SensorFilter(Vector3<T>* storage, int capacity) : Base(storage, capacity) { };
+
+    // The following methods are augmented to update the running variance
+    void PushBack(const Vector3<T> &e)
+    {
+        if (this->IsFull())
+            PopFront();
+        Base::PushBack(e);
+        addSample(e);
+        if (this->End == 0)
+            recomputeVariance();
+    }
+
+    void PushFront(const Vector3<T> &e)
+    {
+        if (this->IsFull())
+            PopBack();
+        Base::PushFront(e);
+        addSample(e);
+        if (this->Beginning == 0)
+            recomputeVariance();
+    }
+
+    Vector3<T> PopBack()
+    {
+        Vector3<T> e = Base::PopBack();
+        removeSample(e);
+        return e;
+    }
+
+    Vector3<T> PopFront()
+    {
+        Vector3<T> e = Base::PopFront();
+        removeSample(e);
+        return e;
+    }
+
+    void Clear()
+    {
+        Base::Clear();
+        RunningMean = Vector3<T>();
+        RunningM2   = Vector3<T>();
+    }
 
     // Simple statistics
     Vector3<T> Median() const;
-    Vector3<T> Variance() const; // The diagonal of covariance matrix
+    // The diagonal of covariance matrix
+    Vector3<T> Variance() const
+    {
+        return this->IsEmpty() ? Vector3<T>() : RunningM2 / (T) this->ElemCount;
+    }
     Matrix3<T> Covariance() const;
     Vector3<T> PearsonCoefficient() const;
+
+private:
+    // ElemCount already includes the added element.
+    void addSample(const Vector3<T> &e)
+    {
+        Vector3<T> delta = e - RunningMean;
+        RunningMean += delta / (T) this->ElemCount;
+        RunningM2   += delta.EntrywiseMultiply(e - RunningMean);
+    }
+
+    // ElemCount already excludes the removed element.
+    void removeSample(const Vector3<T> &e)
+    {
+        if (this->ElemCount == 0)
+        {
+            RunningMean = Vector3<T>();
+            RunningM2   = Vector3<T>();
+            return;
+        }
+        Vector3<T> delta = e - RunningMean;
+        RunningMean -= delta / (T) this->ElemCount;
+        RunningM2   -= delta.EntrywiseMultiply(e - RunningMean);
+        // Rounding can take it slightly negative.
+        RunningM2.x = Alg::Max(RunningM2.x, (T) 0);
+        RunningM2.y = Alg::Max(RunningM2.y, (T) 0);
+        RunningM2.z = Alg::Max(RunningM2.z, (T) 0);
+    }
+
+    // Recompute exactly once per wrap of the buffer to avoid error accumulation.
+    void recomputeVariance()
+    {
+        RunningMean = this->Mean();
+        RunningM2   = Vector3<T>();
+        for (int i = 0; i < this->ElemCount; i++)
+        {
+            Vector3<T> delta = this->PeekFront(i) - RunningMean;
+            RunningM2 += delta.EntrywiseMultiply(delta);
+        }
+    }
 };
 
+template <typename T, class Buffer>
+inline Vector3<T> SensorFilter<T, Buffer>::Median() const
+{
+    Vector3<T> result;
+    T* slice = (T*) OVR_ALLOC_TAGGED(AllocSubsystem_Fusion, this->ElemCount * sizeof(T));
+
+    for (int coord = 0; coord < 3; coord++)
+    {
+        for (int i = 0; i < this->ElemCount; i++)
+            slice[i] = this->PeekFront(i)[coord];
+        Alg::ArrayAdaptor<T> adaptor(slice, this->ElemCount);
+        result[coord] = Alg::Median(adaptor);
+    }
+
+    OVR_FREE(slice);
+    return result;
+}
+
+template <typename T, class Buffer>
+inline Matrix3<T> SensorFilter<T, Buffer>::Covariance() const
+{
+    Vector3<T> mean = this->Mean();
+    Matrix3<T> total(0, 0, 0, 0, 0, 0, 0, 0, 0);
+    for (int i = 0; i < this->ElemCount; i++) 
+    {
+        const Vector3<T>& e = this->PeekFront(i);
+        total.M[0][0] += (e.x - mean.x) * (e.x - mean.x);
+        total.M[1][0] += (e.y - mean.y) * (e.x - mean.x);
+        total.M[2][0] += (e.z - mean.z) * (e.x - mean.x);
+        total.M[1][1] += (e.y - mean.y) * (e.y - mean.y);
+        total.M[2][1] += (e.z - mean.z) * (e.y - mean.y);
+        total.M[2][2] += (e.z - mean.z) * (e.z - mean.z);
+    }
+    total.M[0][1] = total.M[1][0];
+    total.M[0][2] = total.M[2][0];
+    total.M[1][2] = total.M[2][1];
+    for (int i = 0; i < 3; i++)
+        for (int j = 0; j < 3; j++)
+            total.M[i][j] /= (float) this->ElemCount;
+    return total;
+}
+
+template <typename T, class Buffer>
+inline Vector3<T> SensorFilter<T, Buffer>::PearsonCoefficient() const
+{
+    Matrix3<T> cov = this->Covariance();
+    Vector3<T> pearson;
+    pearson.x = cov.M[0][1]/(sqrt(cov.M[0][0])*sqrt(cov.M[1][1]));
+    pearson.y = cov.M[1][2]/(sqrt(cov.M[1][1])*sqrt(cov.M[2][2]));
+    pearson.z = cov.M[2][0]/(sqrt(cov.M[2][2])*sqrt(cov.M[0][0]));
+
+    return pearson;
+}
+
 typedef SensorFilter<float> SensorFilterf;
 typedef SensorFilter<double> SensorFilterd;
 
 // This filter operates on the values that are measured in the body frame and rotate with the device
-class SensorFilterBodyFrame : public SensorFilterBase<Vector3d>
+template <class Buffer>
+class SensorFilterBodyFrameBase : public SensorFilterBase<Vector3d, Buffer>
 {
+    typedef SensorFilterBase<Vector3d, Buffer> Base;
+
 private:
     // low pass filter gain
     double gain;
@@ -240,19 +419,22 @@ private:
     void PushBack(const Vector3d &e)
     {
         runningTotalLengthSq += this->IsFull() ? (e.LengthSq() - this->PeekFront().LengthSq()) : e.LengthSq();
-        SensorFilterBase<Vector3d>::PushBack(e);
+        Base::PushBack(e);
         if (this->End == 0)
         {
             // update the cached total to avoid error accumulation
             runningTotalLengthSq = 0;
             for (int i = 0; i < this->ElemCount; i++)
-                runningTotalLengthSq += this->Data[i].LengthSq();
+                runningTotalLengthSq += this->PeekFront(i).LengthSq();
         } 
     }
 
 public:
-	SensorFilterBodyFrame(int capacity = SensorFilterBase<Vector3d>::DefaultCapacity) 
-        : SensorFilterBase<Vector3d>(capacity), gain(2.5), 
+	SensorFilterBodyFrameBase(int capacity = Base::DefaultCapacity) 
+        : Base(capacity), gain(2.5), 
+        runningTotalLengthSq(0), Q(), output()  { };
+    SensorFilterBodyFrameBase(Vector3d* storage, int capacity) 
+        : Base(storage, capacity), gain(2.5), 
         runningTotalLengthSq(0), Q(), output()  { };
 
     // return the scalar variance of the filter values (rotated to be in the same frame)
@@ -302,6 +484,8 @@ public:
     }
 };
 
+typedef SensorFilterBodyFrameBase<CircularBuffer<Vector3d> > SensorFilterBodyFrame;
+
 } //namespace OVR
 
 #endif // OVR_SensorFilter_h
@@ -26,11 +26,17 @@ limitations under the License.
 
 #include "OVR_SensorFusion.h"
 #include "Kernel/OVR_Log.h"
+#include "Kernel/OVR_PerfCounters.h"
+#include "Kernel/OVR_ProfilingAllocator.h"
 #include "Kernel/OVR_System.h"
 #include "OVR_JSON.h"
 #include "OVR_Profile.h"
 #include "OVR_Stereo.h"
 #include "OVR_Recording.h"
+#include "OVR_PoseStreamer.h"
+#ifdef OVR_SENSOR_FUSION_PRECISION_CHECK
+#include "OVR_SensorTrace.h"
+#endif
 
 // Temporary for debugging
 bool Global_Flag_1 = true;
@@ -46,19 +52,110 @@ namespace OVR {
 
 const Transformd DefaultWorldFromCamera(Quatd(), Vector3d(0, 0, -1));
 
+// Angular speed, in rad/s, above sensor noise and below the slowest head motion; the
+// idle policy counts faster readings as the headset being moved.
+static const double IdleMotionThreshold = 0.05;
+
+// Reports read this long after their last sample are a backlog, such as the one
+// after a stalled USB transfer; the sensors report every millisecond, and are read
+// within a few. Their orientation corrections are deferred, for at most
+// DeferCorrectionMaxSeconds of frames at a time.
+static const double DeferCorrectionLagSeconds = 0.01;
+static const double DeferCorrectionMaxSeconds = 0.05;
+
+
+//-------------------------------------------------------------------------------------
+// ***** SensorFusion::FusionThread
+
+// Integrates the frames that the sensor thread queues, with the scheduling it was
+// started with.
+class SensorFusion::FusionThread : public Thread
+{
+public:
+    FusionThread(SensorFusion* fusion, const Thread::SchedulingParams* scheduling)
+      : pFusion(fusion), HasScheduling(scheduling != 0), Stopping(false)
+    {
+        if (scheduling)
+            Scheduling = *scheduling;
+    }
+
+    // Wakes the thread for the frames queued since it last ran.
+    void        Notify()    { Wake.SetEvent(); }
+    // Handles the frames still queued and stops the thread.
+    void        Stop();
+
+    virtual int Run();
+
+private:
+    SensorFusion*               pFusion;
+    bool                        HasScheduling;
+    Thread::SchedulingParams    Scheduling;
+    volatile bool               Stopping;
+    Event                       Wake;
+    Event                       Stopped;
+};
+
+void SensorFusion::FusionThread::Stop()
+{
+    Stopping = true;
+    Wake.SetEvent();
+    Stopped.Wait();
+}
+
+int SensorFusion::FusionThread::Run()
+{
+    SetThreadName("OVR::SensorFusion");
+    ProfilingAllocator::SetThreadRole(ProfilingAllocator::ThreadRole_Device);
+    if (HasScheduling && !SetCurrentThreadScheduling(Scheduling))
+        LogText("OVR::SensorFusion - requested fusion thread scheduling only partly applied.\n");
+
+    while (true)
+    {
+        // Frames queued from here on set the event again, so none is left waiting.
+        Wake.ResetEvent();
+        {
+            Lock::Locker lockScope(&pFusion->FusionLock);
+            pFusion->processFusionQueue();
+        }
+        if (Stopping)
+            break;
+        Wake.Wait();
+    }
+
+    Stopped.SetEvent();
+    return 0;
+}
+
+
 //-------------------------------------------------------------------------------------
 // ***** Sensor Fusion
 
 SensorFusion::SensorFusion(SensorDevice* sensor)
-  : ExposureRecordHistory(100), LastMessageExposureFrame(NULL),
+  : ExposureRecordHistory(ExposureHistorySize), LastMessageExposureFrame(NULL),
     FocusDirection(Vector3d(0, 0, 0)), FocusFOV(0.0),
-    FAccelInImuFrame(1000), FAccelInCameraFrame(1000), FAngV(20),
+    FAccelInImuFrame(AccelFilterSize), FAccelInCameraFrame(AccelFilterSize), FAngV(20),
     EnableGravity(true), EnableYawCorrection(true), MagCalibrated(false),
     EnableCameraTiltCorrection(true),
     MotionTrackingEnabled(true), VisionPositionEnabled(true),
+    IdleReadTimeout(0), IdleMotionTimeout(0), LastPoseReadTime(0), LastMotionTime(0),
+    SensorIdle(false),
+    Prediction(Prediction_Adaptive), PredictionFilterSeconds(0.02), PredictionFilterPrimed(false),
     CenterPupilDepth(0.0)
 {
+   pFusionThread  = 0;
+   pMagRefBuckets = 0;
+   pState         = &LocalState;
+   SharedReadOnly = false;
+   pStreamer      = 0;
    pHandler = new BodyFrameHandler(this);
+   VisionIngestHead.Store_Release(0);
+   VisionIngestTail.Store_Release(0);
+   FusionQueueHead.Store_Release(0);
+   FusionQueueTail.Store_Release(0);
+#ifdef OVR_SENSOR_FUSION_PRECISION_CHECK
+   FloatCorrections        = false;
+   MaxCorrectionDivergence = 0;
+#endif
 
    // And the clock is running...
    LogText("*** SensorFusion Startup: TimeSeconds = %f\n", Timer::GetSeconds());
@@ -71,7 +168,38 @@ SensorFusion::SensorFusion(SensorDevice* sensor)
 
 SensorFusion::~SensorFusion()
 {   
+    // No frames are queued once the handler is removed.
+    pHandler->RemoveHandlerFromDevices();
+    StopFusionThread();
     delete(pHandler);
+    OVR_FREE(pMagRefBuckets);
+}
+
+bool SensorFusion::StartFusionThread(const Thread::SchedulingParams* scheduling)
+{
+    OVR_ASSERT(!IsAttachedToSensor());
+    if (pFusionThread)
+        return true;
+
+    FusionThread* thread = new FusionThread(this, scheduling);
+    if (!thread->Start())
+    {
+        thread->Release();
+        return false;
+    }
+    pFusionThread = thread;
+    return true;
+}
+
+void SensorFusion::StopFusionThread()
+{
+    OVR_ASSERT(!IsAttachedToSensor());
+    if (!pFusionThread)
+        return;
+
+    pFusionThread->Stop();
+    pFusionThread->Release();
+    pFusionThread = 0;
 }
 
 bool SensorFusion::AttachToSensor(SensorDevice* sensor)
@@ -79,31 +207,26 @@ bool SensorFusion::AttachToSensor(SensorDevice* sensor)
     pHandler->RemoveHandlerFromDevices();
     Reset();
 
+    // A newly attached sensor is in use.
+    SensorIdle       = false;
+    LastPoseReadTime = LastMotionTime = Timer::GetSeconds();
+
     if (sensor != NULL)
     {
-        // cache mag calibration state
-        MagCalibrated = sensor->IsMagCalibrated();
-        
         // Load IMU position
         Array<PositionCalibrationReport> reports;
         bool result = sensor->GetAllPositionCalibrationReports(&reports);
         if (result)
         {
-            PositionCalibrationReport imu = reports[reports.GetSize() - 1];
-            OVR_ASSERT(imu.PositionType == PositionCalibrationReport::PositionType_IMU);
-            // convert from vision to the world frame
-            // TBD convert rotation as necessary?
-            imu.Position.x *= -1.0;
-            imu.Position.z *= -1.0;
-
-            ImuFromScreen = Transformd(Quatd(imu.Normal, imu.Angle), imu.Position).Inverted();
-
             Recording::GetRecorder().RecordLedPositions(reports);
             Recording::GetRecorder().RecordDeviceIfcVersion(sensor->GetDeviceInterfaceVersion());
 		}
-        
-        // Repopulate CPFOrigin
-        SetCenterPupilDepth(CenterPupilDepth);
+        else
+        {
+            reports.Clear();
+        }
+
+        SetSensorCalibration(reports, sensor->IsMagCalibrated());
 
         // Subscribe to sensor updates
         sensor->AddMessageHandler(pHandler);
@@ -113,20 +236,50 @@ bool SensorFusion::AttachToSensor(SensorDevice* sensor)
         // after sensor creation but before any data has flowed through.  We should probably
         // not depend strictly on data flow to determine capabilities like orientation and position
         // tracking, or else use some sort of synchronous method to wait for data
+        OVR_ASSERT(!SharedReadOnly);
         LocklessState init;
         init.StatusFlags = Status_OrientationTracked;   
-        UpdatedState.SetState(init);
+        init.ImuFromCpf  = ImuFromCpf;
+        pState->UpdatedState.SetState(init);
     }
 
     return true;
 }
 
+void SensorFusion::SetSensorCalibration(const Array<PositionCalibrationReport>& reports,
+                                        bool magCalibrated)
+{
+    // cache mag calibration state
+    MagCalibrated = magCalibrated;
+
+    if (reports.GetSize() > 0)
+    {
+        PositionCalibrationReport imu = reports[reports.GetSize() - 1];
+        OVR_ASSERT(imu.PositionType == PositionCalibrationReport::PositionType_IMU);
+        // convert from vision to the world frame
+        // TBD convert rotation as necessary?
+        imu.Position.x *= -1.0;
+        imu.Position.z *= -1.0;
+
+        ImuFromScreen = Transformd(Quatd(imu.Normal, imu.Angle), imu.Position).Inverted();
+    }
+
+    // Repopulate CPFOrigin
+    SetCenterPupilDepth(CenterPupilDepth);
+}
+
 // Resets the current orientation
 void SensorFusion::Reset()
 {
-    Lock::Locker lockScope(pHandler->GetHandlerLock());
+    Lock::Locker lockScope(&FusionLock);
 
-    UpdatedState.SetState(LocklessState());
+    if (!SharedReadOnly)
+    {
+        LocklessState lstate;
+        lstate.ImuFromCpf = ImuFromCpf;
+        pState->UpdatedState.SetState(lstate);
+        pState->PoseHistory.Clear();
+    }
     WorldFromImu                        = PoseState<double>();
     WorldFromImu.Pose                   = ImuFromCpf.Inverted(); // place CPF at the origin, not the IMU
     CameraFromImu                       = PoseState<double>();
@@ -135,19 +288,24 @@ void SensorFusion::Reset()
     WorldFromCameraConfidence           = -1;
 
     ExposureRecordHistory.Clear();
+    // Poses for exposures before the reset are dropped.
+    VisionIngestTail.Store_Release(VisionIngestHead.Load_Acquire());
+    // So are the frames queued for the fusion thread.
+    FusionQueueTail.Store_Release(FusionQueueHead.Load_Acquire());
     NextExposureRecord                  = ExposureRecord();
     LastMessageExposureFrame            = MessageExposureFrame(NULL);
     LastVisionAbsoluteTime              = 0;
     Stage                               = 0;
+    DeferredCorrectionSeconds           = 0;
     
-    MagRefs.Clear();
-    MagRefIdx                           = -1;
+    clearMagReferences();
     MagCorrectionIntegralTerm           = Quatd();
     AccelOffset                         = Vector3d();
 
     FAccelInCameraFrame.Clear();
     FAccelInImuFrame.Clear();
     FAngV.Clear();
+    PredictionFilterPrimed              = false;
 
     setNeckPivotFromPose ( WorldFromImu.Pose );
 }
@@ -171,19 +329,78 @@ void SensorFusion::OnVisionPreviousFrame(const Transform<double>& cameraFromImu)
 
 void SensorFusion::OnVisionSuccess(const Transform<double>& cameraFromImu, UInt32 exposureCounter)
 {
-    Lock::Locker lockScope(pHandler->GetHandlerLock());
+    Lock::Locker lockScope(&FusionLock);
+    applyVisionSuccess(cameraFromImu, exposureCounter);
+}
+
+bool SensorFusion::SubmitVisionPose(const Transform<double>& cameraFromImu, UInt32 exposureCounter)
+{
+    UInt32 head = VisionIngestHead.Load_Acquire();
+    if (head - VisionIngestTail.Load_Acquire() >= (UInt32)VisionIngestQueueSize)
+        return false;
+
+    VisionIngestPose& pose = VisionIngestQueue[head % VisionIngestQueueSize];
+    pose.CameraFromImu   = cameraFromImu;
+    pose.ExposureCounter = exposureCounter;
+    VisionIngestHead.Store_Release(head + 1);
+    return true;
+}
+
+void SensorFusion::applyVisionIngest()
+{
+    UInt32 tail = VisionIngestTail.Load_Acquire();
+    UInt32 head = VisionIngestHead.Load_Acquire();
+    for (; tail != head; tail++)
+    {
+        const VisionIngestPose& pose = VisionIngestQueue[tail % VisionIngestQueueSize];
+        applyVisionSuccess(pose.CameraFromImu, pose.ExposureCounter);
+    }
+    VisionIngestTail.Store_Release(tail);
+}
 
+void SensorFusion::applyVisionSuccess(const Transform<double>& cameraFromImu, UInt32 exposureCounter)
+{
     Recording::GetRecorder().RecordVisionSuccess(true);
 
     LastVisionAbsoluteTime = GetTime();
 
     // ********* LastVisionExposureRecord *********
 
-    // Skip old data and use the record that matches the exposure counter
-    while (!ExposureRecordHistory.IsEmpty() &&
-           (ExposureRecordHistory.PeekFront().ExposureCounter <= exposureCounter))
+    // Exposure counters are consecutive, so the record for exposureCounter is at its
+    // distance from the oldest one; after skipped exposures it's searched for. Older
+    // records are dropped, and their IMU deltas are combined with its, so that the
+    // delta spans the time since the previous vision pose (GetVisionPrediction, when
+    // used, has already combined them).
+    UPInt  recordCount = ExposureRecordHistory.GetSize();
+    SPInt  matched     = -1;
+    if (recordCount)
+    {
+        UInt32 offset = exposureCounter - ExposureRecordHistory.PeekFront().ExposureCounter;
+        if (offset < recordCount && ExposureRecordHistory.PeekFront(offset).ExposureCounter == exposureCounter)
+        {
+            matched = (SPInt)offset;
+        }
+        else
+        {
+            for (UPInt i = 0; i < recordCount; i++)
+            {
+                if ((SInt32)(ExposureRecordHistory.PeekFront(i).ExposureCounter - exposureCounter) > 0)
+                    break;
+                matched = (SPInt)i;
+            }
+        }
+    }
+
+    if (matched >= 0)
     {
         LastVisionExposureRecord = ExposureRecordHistory.PopFront();
+        PoseState<double> delta  = LastVisionExposureRecord.ImuOnlyDelta;
+        for (SPInt i = 1; i <= matched; i++)
+        {
+            LastVisionExposureRecord = ExposureRecordHistory.PopFront();
+            delta.AdvanceByDelta(LastVisionExposureRecord.ImuOnlyDelta);
+        }
+        LastVisionExposureRecord.ImuOnlyDelta = delta;
     }
 
     // Use current values if we don't have historical data
@@ -239,7 +456,7 @@ PoseStated SensorFusion::computeVisionError()
 
 Transform<double> SensorFusion::GetVisionPrediction(UInt32 exposureCounter)
 {
-    Lock::Locker lockScope(pHandler->GetHandlerLock());
+    Lock::Locker lockScope(&FusionLock);
 
     // Combine the small deltas together
     // Should only be one iteration, unless we are skipping camera frames
@@ -282,11 +499,25 @@ Transform<double> SensorFusion::GetVisionPrediction(UInt32 exposureCounter)
     return result;
 }
 
-void SensorFusion::handleMessage(const MessageBodyFrame& msg)
+// Seconds spent integrating each body frame.
+static PerfCounter HandleMessageCounter("perf.fusion.handleMessage");
+// Seconds from a sample to the fusion starting to integrate it, which includes the
+// wait in the fusion queue, and to its state being published to readers.
+static PerfCounter SampleToFusionCounter("perf.latency.sampleToFusion", PerfCounter::Option_Histogram);
+static PerfCounter SampleToPublishCounter("perf.latency.sampleToPublish", PerfCounter::Option_Histogram);
+
+void SensorFusion::handleMessage(const MessageBodyFrame& msg, bool storeState, bool correct)
 {
     if (msg.Type != Message_BodyFrame || !IsMotionTrackingEnabled())
         return;
 
+    PerfCounterScope perfScope(HandleMessageCounter);
+
+    // Only frames from a device are timed; played back ones carry the times of
+    // their recording.
+    if (msg.pDevice)
+        SampleToFusionCounter.Record(Timer::GetSeconds() - msg.AbsoluteTimeSeconds);
+
     // Put the sensor readings into convenient local variables
     Vector3d gyro(msg.RotationRate); 
     Vector3d accel(msg.Acceleration); 
@@ -295,10 +526,18 @@ void SensorFusion::handleMessage(const MessageBodyFrame& msg)
 
     // Keep track of time
     WorldFromImu.TimeInSeconds = msg.AbsoluteTimeSeconds;
+    if (VisionIngestTail.Load_Acquire() != VisionIngestHead.Load_Acquire())
+        applyVisionIngest();
+
     // We got an update in the last 60ms and the data is not very old
     bool visionIsRecent = (GetTime() - LastVisionAbsoluteTime < 0.07) && (GetVisionLatency() < 0.25);
     Stage++;
 
+    // With a fusion thread, the sensor thread applies the idle policy as it queues
+    // the frame.
+    if (!pFusionThread && (IdleReadTimeout > 0 || IdleMotionTimeout > 0 || SensorIdle))
+        updateIdle(msg, gyro);
+
     // Insert current sensor data into filter history
     FAngV.PushBack(gyro);
     FAccelInImuFrame.Update(accel, DeltaT, Quatd(gyro, gyro.Length() * DeltaT));
@@ -312,18 +551,31 @@ void SensorFusion::handleMessage(const MessageBodyFrame& msg)
 
     // Update headset orientation   
     WorldFromImu.StoreAndIntegrateGyro(gyro, DeltaT);
-    // Tilt correction based on accelerometer
-    if (EnableGravity)
-        applyTiltCorrection(DeltaT);
-    // Yaw correction based on camera
-    if (EnableYawCorrection && visionIsRecent)
-        applyVisionYawCorrection(DeltaT);
-    // Yaw correction based on magnetometer
-	if (EnableYawCorrection && MagCalibrated) // MagCalibrated is always false for DK2 for now
-		applyMagYawCorrection(mag, DeltaT);
-	// Focus Correction
-	if ((FocusDirection.x != 0.0f || FocusDirection.z != 0.0f) && FocusFOV < Mathf::Pi)
-		applyFocusCorrection(DeltaT);
+
+    // The corrections are proportional to time, so deferred ones are made up
+    // for by correcting over the time of all the frames since the last.
+    double correctionDeltaT = DeltaT + DeferredCorrectionSeconds;
+    if (correct)
+    {
+        DeferredCorrectionSeconds = 0;
+
+        // Tilt correction based on accelerometer
+        if (EnableGravity)
+            applyTiltCorrection(correctionDeltaT);
+        // Yaw correction based on camera
+        if (EnableYawCorrection && visionIsRecent)
+            applyVisionYawCorrection(correctionDeltaT);
+        // Yaw correction based on magnetometer
+        if (EnableYawCorrection && MagCalibrated) // MagCalibrated is always false for DK2 for now
+            applyMagYawCorrection(mag, correctionDeltaT);
+        // Focus Correction
+        if ((FocusDirection.x != 0.0f || FocusDirection.z != 0.0f) && FocusFOV < Mathf::Pi)
+            applyFocusCorrection(correctionDeltaT);
+    }
+    else
+    {
+        DeferredCorrectionSeconds = correctionDeltaT;
+    }
 
     // Update camera orientation
     if (EnableCameraTiltCorrection && visionIsRecent)
@@ -363,6 +615,8 @@ void SensorFusion::handleMessage(const MessageBodyFrame& msg)
     // Compute the angular acceleration
     WorldFromImu.AngularAcceleration = (FAngV.GetSize() >= 12 && DeltaT > 0) ? 
         (FAngV.SavitzkyGolayDerivative12() / DeltaT) : Vector3d();
+    if (Prediction == Prediction_Kalman)
+        updatePredictionFilter(DeltaT);
 
     // Update the dead reckoning state used for incremental vision tracking
     NextExposureRecord.ImuOnlyDelta.StoreAndIntegrateGyro(gyro, DeltaT);
@@ -378,13 +632,30 @@ void SensorFusion::handleMessage(const MessageBodyFrame& msg)
 	//Recorder::LogData("sfLinAcc", State.LinearAcceleration);
 	//Recorder::LogData("sfLinVel", State.LinearVelocity);
 
-    // Store the lockless state.    
-    LocklessState lstate;
-    lstate.StatusFlags       = Status_OrientationTracked;
+    unsigned statusFlags = Status_OrientationTracked;
     if (VisionPositionEnabled)
-        lstate.StatusFlags  |= Status_PositionConnected;
+        statusFlags |= Status_PositionConnected;
     if (VisionPositionEnabled && visionIsRecent)
-        lstate.StatusFlags  |= Status_PositionTracked;
+        statusFlags |= Status_PositionTracked;
+
+    // Every reading goes to the history and the stream, even those of a batch;
+    // the stream is sent once per batch.
+    pState->PoseHistory.Push(PoseStatef(WorldFromImu));
+    if (pStreamer)
+    {
+        PoseState<double> cpfState = WorldFromImu;
+        cpfState.Pose = WorldFromImu.Pose * ImuFromCpf;
+        pStreamer->Add(cpfState, statusFlags);
+        if (storeState)
+            pStreamer->Flush();
+    }
+
+    if (!storeState)
+        return;
+
+    // Store the lockless state.    
+    LocklessState lstate;
+    lstate.StatusFlags       = statusFlags;
 
 	//A convenient means to temporarily extract this flag
 	TPH_IsPositionTracked = visionIsRecent;
@@ -392,7 +663,210 @@ void SensorFusion::handleMessage(const MessageBodyFrame& msg)
     lstate.State        = WorldFromImu;
     lstate.Temperature  = msg.Temperature;
     lstate.Magnetometer = mag;    
-    UpdatedState.SetState(lstate);
+    lstate.ImuFromCpf   = ImuFromCpf;
+    storePrediction(&lstate, (statusFlags & Status_PositionTracked) != 0);
+    pState->UpdatedState.SetState(lstate);
+
+    if (msg.pDevice)
+        SampleToPublishCounter.Record(Timer::GetSeconds() - msg.AbsoluteTimeSeconds);
+}
+
+void SensorFusion::SetPredictionModel(PredictionModel model, double filterSeconds)
+{
+    Lock::Locker lockScope(&FusionLock);
+    OVR_ASSERT(model >= Prediction_Adaptive && model < Prediction_Count);
+    Prediction              = model;
+    PredictionFilterSeconds = Alg::Max(filterSeconds, 0.001);
+    PredictionFilterPrimed  = false;
+}
+
+// One step of an alpha-beta filter of value, whose rate of change is rate.
+static void alphaBetaUpdate(Vector3d* value, Vector3d* rate, const Vector3d& measured,
+                            double deltaT, double alpha, double beta)
+{
+    Vector3d residual = measured - (*value + *rate * deltaT);
+    *value += *rate * deltaT + residual * alpha;
+    *rate  += residual * beta;
+}
+
+void SensorFusion::updatePredictionFilter(double deltaT)
+{
+    if (deltaT <= 0)
+        return;
+
+    if (!PredictionFilterPrimed)
+    {
+        PredictionAngularVelocity     = WorldFromImu.AngularVelocity;
+        PredictionLinearVelocity      = WorldFromImu.LinearVelocity;
+        PredictionAngularAcceleration = Vector3d();
+        PredictionLinearAcceleration  = Vector3d();
+        PredictionFilterPrimed        = true;
+        return;
+    }
+
+    // Fading-memory gains: each reading weighs theta times as much as the next, so
+    // that the filter, critically damped, forgets the past over PredictionFilterSeconds.
+    double theta = exp(-deltaT / PredictionFilterSeconds);
+    double alpha = 1.0 - theta * theta;
+    double beta  = (1.0 - theta) * (1.0 - theta) / deltaT;
+    alphaBetaUpdate(&PredictionAngularVelocity, &PredictionAngularAcceleration,
+                    WorldFromImu.AngularVelocity, deltaT, alpha, beta);
+    alphaBetaUpdate(&PredictionLinearVelocity, &PredictionLinearAcceleration,
+                    WorldFromImu.LinearVelocity, deltaT, alpha, beta);
+}
+
+void SensorFusion::storePrediction(LocklessState* lstate, bool positionTracked) const
+{
+    lstate->Prediction = Prediction;
+    if (Prediction == Prediction_Kalman && PredictionFilterPrimed)
+    {
+        lstate->PredictionAngularVelocity     = PredictionAngularVelocity;
+        lstate->PredictionAngularAcceleration = PredictionAngularAcceleration;
+        lstate->PredictionLinearVelocity      = PredictionLinearVelocity;
+        lstate->PredictionLinearAcceleration  = PredictionLinearAcceleration;
+    }
+    else
+    {
+        lstate->PredictionAngularVelocity     = WorldFromImu.AngularVelocity;
+        lstate->PredictionAngularAcceleration = WorldFromImu.AngularAcceleration;
+        lstate->PredictionLinearVelocity      = WorldFromImu.LinearVelocity;
+        lstate->PredictionLinearAcceleration  = WorldFromImu.LinearAcceleration;
+    }
+
+    // The head model moves the headset with its rotation; the accelerometer alone
+    // would only add its noise and bias to the position.
+    if (!positionTracked)
+        lstate->PredictionLinearAcceleration = Vector3d();
+}
+
+void SensorFusion::handleBodyFrames(const MessageBodyFrame* frames, unsigned count,
+                                    double receiveTime, bool record)
+{
+    // A backlog comes in as many short reports, one after the other; correcting the
+    // orientation once for several of them keeps it cheap to absorb. The frames
+    // after it, or after DeferCorrectionMaxSeconds of it, apply the corrections left.
+    // Frames whose report time isn't known, such as played back ones, aren't deferred.
+    bool backlog = (receiveTime > 0) && (count > 0) &&
+                   (receiveTime - frames[count - 1].AbsoluteTimeSeconds > DeferCorrectionLagSeconds);
+
+    for (unsigned i = 0; i < count; i++)
+    {
+        bool last = (i == count - 1);
+        if (record)
+            Recording::GetRecorder().RecordMessage(frames[i]);
+        handleMessage(frames[i], last, !backlog || (DeferredCorrectionSeconds >= DeferCorrectionMaxSeconds));
+    }
+}
+
+void SensorFusion::receiveBodyFrames(const MessageBodyFrame* frames, unsigned count,
+                                     double receiveTime, bool record)
+{
+    if (!pFusionThread)
+    {
+        Lock::Locker lockScope(&FusionLock);
+        handleBodyFrames(frames, count, receiveTime, record);
+        return;
+    }
+
+    // The idle policy calls the sensor, which waits for the sensor thread, so it
+    // can't be left to the fusion thread.
+    bool        idlePolicy = IsMotionTrackingEnabled() &&
+                             (IdleReadTimeout > 0 || IdleMotionTimeout > 0 || SensorIdle);
+    QueuedFrame queued;
+    queued.Type = Message_BodyFrame;
+    for (unsigned i = 0; i < count; i++)
+    {
+        if (record)
+            Recording::GetRecorder().RecordMessage(frames[i]);
+        if (idlePolicy && frames[i].Type == Message_BodyFrame)
+            updateIdle(frames[i], Vector3d(frames[i].RotationRate));
+        queued.BodyFrame = frames[i];
+        queueFrame(queued);
+    }
+    pFusionThread->Notify();
+}
+
+void SensorFusion::receiveExposure(const MessageExposureFrame& msg, bool record)
+{
+    if (record)
+        Recording::GetRecorder().RecordMessage(msg);
+
+    if (!pFusionThread)
+    {
+        Lock::Locker lockScope(&FusionLock);
+        handleExposure(msg);
+        return;
+    }
+
+    QueuedFrame queued;
+    queued.Type     = Message_ExposureFrame;
+    queued.Exposure = msg;
+    queueFrame(queued);
+    pFusionThread->Notify();
+}
+
+void SensorFusion::queueFrame(const QueuedFrame& frame)
+{
+    UInt32 head = FusionQueueHead.Load_Acquire();
+    if (head - FusionQueueTail.Load_Acquire() >= (UInt32)FusionQueueSize)
+    {
+        // The fusion thread is a whole queue behind; catching up here keeps the
+        // readings, at the cost of the sensor thread's time.
+        Lock::Locker lockScope(&FusionLock);
+        processFusionQueue();
+    }
+
+    FusionQueue[head % FusionQueueSize] = frame;
+    FusionQueueHead.Store_Release(head + 1);
+}
+
+void SensorFusion::processFusionQueue()
+{
+    UInt32 tail = FusionQueueTail.Load_Acquire();
+    UInt32 head = FusionQueueHead.Load_Acquire();
+    // A backlog is absorbed like a long batch from the sensor.
+    bool   deferCorrections = (head - tail >= (UInt32)DeferCorrectionBatchSize);
+
+    for (; tail != head; tail++)
+    {
+        const QueuedFrame& frame = FusionQueue[tail % FusionQueueSize];
+        if (frame.Type == Message_ExposureFrame)
+        {
+            handleExposure(frame.Exposure);
+            continue;
+        }
+
+        // The state is published once per batch, and corrected before exposures,
+        // which record it.
+        bool last = (tail + 1 == head) ||
+                    FusionQueue[(tail + 1) % FusionQueueSize].Type != Message_BodyFrame;
+        handleMessage(frame.BodyFrame, last, last || !deferCorrections);
+    }
+    FusionQueueTail.Store_Release(tail);
+}
+
+void SensorFusion::SetIdlePolicy(double readTimeoutSeconds, double motionTimeoutSeconds)
+{
+    // Timeouts count from now; the next reading takes the sensor out of idle mode
+    // if the new policy doesn't keep it there.
+    LastPoseReadTime  = LastMotionTime = Timer::GetSeconds();
+    IdleReadTimeout   = Alg::Max(readTimeoutSeconds, 0.0);
+    IdleMotionTimeout = Alg::Max(motionTimeoutSeconds, 0.0);
+}
+
+void SensorFusion::updateIdle(const MessageBodyFrame& msg, const Vector3d& gyro)
+{
+    double now = Timer::GetSeconds();
+    if (gyro.LengthSq() > IdleMotionThreshold * IdleMotionThreshold)
+        LastMotionTime = now;
+
+    bool idle = (IdleReadTimeout > 0   && now - LastPoseReadTime > IdleReadTimeout) ||
+                (IdleMotionTimeout > 0 && now - LastMotionTime   > IdleMotionTimeout);
+    if (idle == SensorIdle || !msg.pDevice)
+        return;
+
+    SensorIdle = idle;
+    static_cast<SensorDevice*>(msg.pDevice)->SetIdle(idle);
 }
 
 void SensorFusion::handleExposure(const MessageExposureFrame& msg)
@@ -416,25 +890,37 @@ void SensorFusion::setNeckPivotFromPose(Transformd const &worldFromImu)
 
 // These two functions need to be moved into Quat class
 // Compute a rotation required to transform "from" into "to". 
-Quatd vectorAlignmentRotation(const Vector3d &from, const Vector3d &to)
+template<class T>
+static Quat<T> vectorAlignmentRotation(const Vector3<T> &from, const Vector3<T> &to)
 {
-    Vector3d axis = from.Cross(to);
+    Vector3<T> axis = from.Cross(to);
     if (axis.LengthSq() == 0)
         // this handles both collinear and zero-length input cases
-        return Quatd();
-    double angle = from.Angle(to);
-    return Quatd(axis, angle);
+        return Quat<T>();
+    T angle = from.Angle(to);
+    return Quat<T>(axis, angle);
 }
 
 // Compute the part of the quaternion that rotates around Y axis
-Quatd extractYawRotation(const Quatd &error)
+template<class T>
+static Quat<T> extractYawRotation(const Quat<T> &error)
 {
     if (error.y == 0)
-        return Quatd();
-    double phi = atan2(error.w, error.y);
-    double alpha = Mathd::Pi - 2 * phi;
-    return Quatd(Axis_Y, alpha);
+        return Quat<T>();
+    T phi = atan2(error.w, error.y);
+    T alpha = Math<T>::Pi - 2 * phi;
+    return Quat<T>(Axis_Y, alpha);
+}
+
+#ifdef OVR_SENSOR_FUSION_PRECISION_CHECK
+// Angle of the rotation taking a to b; from the vector part, which keeps angles
+// too small to change w.
+static double rotationAngleBetween(const Quatd& a, const Quatd& b)
+{
+    Quatd delta = a.Inverted() * b;
+    return 2 * asin(Alg::Min(sqrt(delta.x * delta.x + delta.y * delta.y + delta.z * delta.z), 1.0));
 }
+#endif
 
 void SensorFusion::applyPositionCorrection(double deltaT)
 {
@@ -446,7 +932,7 @@ void SensorFusion::applyPositionCorrection(double deltaT)
 
     Vector3d correctionPos, correctionVel;
     if (VisionError.Pose.Translation.LengthSq() > (snapThreshold * snapThreshold) ||
-        !(UpdatedState.GetState().StatusFlags & Status_PositionTracked))
+        !(pState->UpdatedState.GetState().StatusFlags & Status_PositionTracked))
     {
         // high error or just reacquired position from vision - apply full correction
 
@@ -482,20 +968,35 @@ void SensorFusion::applyPositionCorrection(double deltaT)
     }
 }
 
-void SensorFusion::applyVisionYawCorrection(double deltaT)
+template<class T>
+Quatd SensorFusion::computeVisionYawCorrection(double deltaT) const
 {
-    const double gain = 0.25;
-    const double snapThreshold = 0.1;
+    const T gain = T(0.25);
+    const T snapThreshold = T(0.1);
 
-    Quatd yawError = extractYawRotation(VisionError.Pose.Rotation);
+    // The correction is computed in T and applied in double.
+    Quat<T> yawError = extractYawRotation(Quat<T>(VisionError.Pose.Rotation));
 
-    Quatd correction;
+    Quat<T> correction;
     if (Alg::Abs(yawError.w) < cos(snapThreshold / 2)) // angle(yawError) > snapThreshold
         // high error, jump to the vision position
         correction = yawError;
     else
-        correction = yawError.Nlerp(Quatd(), gain * deltaT);
+        correction = yawError.Nlerp(Quat<T>(), gain * T(deltaT));
+    return Quatd(correction);
+}
 
+void SensorFusion::applyVisionYawCorrection(double deltaT)
+{
+#ifdef OVR_SENSOR_FUSION_PRECISION_CHECK
+    Quatd correction = computeVisionYawCorrection<float>(deltaT);
+    Quatd other      = computeVisionYawCorrection<double>(deltaT);
+    if (!FloatCorrections)
+        Alg::Swap(correction, other);
+    MaxCorrectionDivergence = Alg::Max(MaxCorrectionDivergence, rotationAngleBetween(correction, other));
+#else
+    Quatd correction = computeVisionYawCorrection<SensorFusionScalar>(deltaT);
+#endif
     WorldFromImu.Pose.Rotation = correction * WorldFromImu.Pose.Rotation;
 
     // Update the exposure records so that we don't apply the same correction twice
@@ -507,10 +1008,103 @@ void SensorFusion::applyVisionYawCorrection(double deltaT)
     }
 }
 
+// The reference points are hashed into pMagRefBuckets by a uniform grid over the
+// IMU-frame field, so a lookup only visits the 27 cells around the reading rather
+// than every point. The cells are as wide as the match distance, so those cells
+// hold every point that can match.
+static const double MagRefCellSize = 0.1;
+
+static int magRefCell(double v)
+{
+    return (int)floor(v / MagRefCellSize);
+}
+
+static int magRefBucket(int x, int y, int z, int bucketCount)
+{
+    UInt32 h = (UInt32)x * 73856093u ^ (UInt32)y * 19349663u ^ (UInt32)z * 83492791u;
+    return (int)(h & (UInt32)(bucketCount - 1));
+}
+
+int SensorFusion::findMagReference(const Vector3d& mag, double maxDist) const
+{
+    OVR_ASSERT(maxDist <= MagRefCellSize);
+    if (!pMagRefBuckets)
+        return -1;
+
+    int x = magRefCell(mag.x), y = magRefCell(mag.y), z = magRefCell(mag.z);
+    int    best     = -1;
+    double bestDist = maxDist;
+
+    for (int dx = -1; dx <= 1; dx++)
+        for (int dy = -1; dy <= 1; dy++)
+            for (int dz = -1; dz <= 1; dz++)
+            {
+                // Cells sharing a bucket are searched twice, which is harmless
+                int bucket = magRefBucket(x + dx, y + dy, z + dz, MagRefBucketCount);
+                for (int i = pMagRefBuckets[bucket]; i >= 0; i = MagRefs[i].NextInBucket)
+                {
+                    double dist = mag.Distance(MagRefs[i].InImuFrame);
+                    if (bestDist > dist)
+                    {
+                        bestDist = dist;
+                        best     = i;
+                    }
+                }
+            }
+    return best;
+}
+
+void SensorFusion::addMagReference(const MagReferencePoint& ref)
+{
+    if (!pMagRefBuckets)
+    {
+        pMagRefBuckets = (int*)OVR_ALLOC_TAGGED(AllocSubsystem_Fusion, sizeof(int) * MagRefBucketCount);
+        for (int i = 0; i < MagRefBucketCount; i++)
+            pMagRefBuckets[i] = -1;
+    }
+
+    int idx = (int)MagRefs.GetSize();
+    MagRefs.PushBack(ref);
+
+    MagReferencePoint& point = MagRefs[idx];
+    point.Bucket       = magRefBucket(magRefCell(ref.InImuFrame.x), magRefCell(ref.InImuFrame.y),
+                                      magRefCell(ref.InImuFrame.z), MagRefBucketCount);
+    point.NextInBucket = pMagRefBuckets[point.Bucket];
+    pMagRefBuckets[point.Bucket] = idx;
+}
+
+void SensorFusion::removeMagReference(int idx)
+{
+    // Unlinks the point at idx, then moves the last point into its slot
+    int* link = &pMagRefBuckets[MagRefs[idx].Bucket];
+    while (*link != idx)
+        link = &MagRefs[*link].NextInBucket;
+    *link = MagRefs[idx].NextInBucket;
+
+    int last = (int)MagRefs.GetSize() - 1;
+    if (idx != last)
+    {
+        link = &pMagRefBuckets[MagRefs[last].Bucket];
+        while (*link != last)
+            link = &MagRefs[*link].NextInBucket;
+        *link = idx;
+    }
+    MagRefs.RemoveAtUnordered(idx);
+}
+
+void SensorFusion::clearMagReferences()
+{
+    MagRefs.Clear();
+    MagRefIdx = -1;
+    if (pMagRefBuckets)
+        for (int i = 0; i < MagRefBucketCount; i++)
+            pMagRefBuckets[i] = -1;
+}
+
 void SensorFusion::applyMagYawCorrection(Vector3d mag, double deltaT)
 {
     const double minMagLengthSq   = Mathd::Tolerance; // need to use a real value to discard very weak fields
-    const double maxMagRefDist    = 0.1;
+    const double maxMagRefDist    = MagRefCellSize;
     const double maxTiltError     = 0.05;
     const double proportionalGain = 0.01;
     const double integralGain     = 0.0005;
@@ -524,7 +1118,7 @@ void SensorFusion::applyMagYawCorrection(Vector3d mag, double deltaT)
     // Delete a bad point
     if (MagRefIdx >= 0 && MagRefs[MagRefIdx].Score < 0)
     {
-        MagRefs.RemoveAtUnordered(MagRefIdx);
+        removeMagReference(MagRefIdx);
         MagRefIdx = -1;
     }
 
@@ -532,22 +1126,12 @@ void SensorFusion::applyMagYawCorrection(Vector3d mag, double deltaT)
     if (MagRefIdx < 0 || mag.Distance(MagRefs[MagRefIdx].InImuFrame) > maxMagRefDist)
     {
         // Find a new one
-        MagRefIdx = -1;
-        double bestDist = maxMagRefDist;
-        for (unsigned int i = 0; i < MagRefs.GetSize(); i++)
-        {
-            double dist = mag.Distance(MagRefs[i].InImuFrame);
-            if (bestDist > dist)
-            {
-                bestDist = dist;
-                MagRefIdx = i;
-            }
-        }
+        MagRefIdx = findMagReference(mag, maxMagRefDist);
 
         // Create one if needed
         if (MagRefIdx < 0 && MagRefs.GetSize() < MagMaxReferences)
 		{
-            MagRefs.PushBack(MagReferencePoint(mag, WorldFromImu.Pose, 1000));
+            addMagReference(MagReferencePoint(mag, WorldFromImu.Pose, 1000));
 		}
     }
 
@@ -581,27 +1165,56 @@ void SensorFusion::applyMagYawCorrection(Vector3d mag, double deltaT)
     }
 }
 
-void SensorFusion::applyTiltCorrection(double deltaT)
+template<class T>
+bool SensorFusion::computeTiltCorrection(double deltaT, Quatd* correctionOut) const
 {
-    const double gain = 0.25;
-    const double snapThreshold = 0.1;
-    const Vector3d up(0, 1, 0);
+    const T gain = T(0.25);
+    const T snapThreshold = T(0.1);
+    const Vector3<T> up(0, 1, 0);
 
-    Vector3d accelInWorldFrame = WorldFromImu.Pose.Rotate(FAccelInImuFrame.GetFilteredValue());
-    Quatd error = vectorAlignmentRotation(accelInWorldFrame, up);
+    Vector3<T> accelInWorldFrame = Quat<T>(WorldFromImu.Pose.Rotation).Rotate(
+                                       Vector3<T>(FAccelInImuFrame.GetFilteredValue()));
+    Quat<T> error = vectorAlignmentRotation(accelInWorldFrame, up);
 
-    Quatd correction;
+    Quat<T> correction;
     if (FAccelInImuFrame.GetSize() == 1 || 
         ((Alg::Abs(error.w) < cos(snapThreshold / 2) && FAccelInImuFrame.Confidence() > 0.75)))
         // full correction for start-up
         // or large error with high confidence
         correction = error;
     else if (FAccelInImuFrame.Confidence() > 0.5)
-        correction = error.Nlerp(Quatd(), gain * deltaT);
+        correction = error.Nlerp(Quat<T>(), gain * T(deltaT));
     else
         // accelerometer is unreliable due to movement
-        return;
+        return false;
 
+    *correctionOut = Quatd(correction);
+    return true;
+}
+
+void SensorFusion::applyTiltCorrection(double deltaT)
+{
+    Quatd correction;
+#ifdef OVR_SENSOR_FUSION_PRECISION_CHECK
+    Quatd other;
+    bool  corrected      = computeTiltCorrection<float>(deltaT, &correction);
+    bool  otherCorrected = computeTiltCorrection<double>(deltaT, &other);
+    if (!FloatCorrections)
+    {
+        Alg::Swap(correction, other);
+        Alg::Swap(corrected, otherCorrected);
+    }
+    // Precisions choosing differently whether to correct count as the whole correction.
+    if (corrected || otherCorrected)
+        MaxCorrectionDivergence = Alg::Max(MaxCorrectionDivergence,
+                                           rotationAngleBetween(corrected ? correction : Quatd(),
+                                                                otherCorrected ? other : Quatd()));
+    if (!corrected)
+        return;
+#else
+    if (!computeTiltCorrection<SensorFusionScalar>(deltaT, &correction))
+        return;
+#endif
     WorldFromImu.Pose.Rotation = correction * WorldFromImu.Pose.Rotation;
 }
 
@@ -785,7 +1398,7 @@ Vector3f SensorFusion::GetHeadModel() const
 
 void SensorFusion::SetHeadModel(const Vector3f &headModel, bool resetNeckPivot /*= true*/ )
 {
-    Lock::Locker lockScope(pHandler->GetHandlerLock());
+    Lock::Locker lockScope(&FusionLock);
     // The head model should look something like (0, 0.12, -0.12), so
     // these asserts are to try to prevent sign problems, as
     // they can be subtle but nauseating!
@@ -849,6 +1462,83 @@ static Transform<double> calcPredictedPose(const PoseState<double>& poseState, d
 }
 
 
+Transformd SensorFusion::predictPose(const LocklessState& lstate, double deltaT, PoseStatef* predicted)
+{
+    if (lstate.Prediction == Prediction_Adaptive)
+        return calcPredictedPose(lstate.State, deltaT);
+
+    bool     accelerate          = (lstate.Prediction != Prediction_ConstantVelocity);
+    Vector3d angularAcceleration = accelerate ? lstate.PredictionAngularAcceleration : Vector3d();
+    Vector3d linearAcceleration  = accelerate ? lstate.PredictionLinearAcceleration  : Vector3d();
+    double   halfDeltaTSq        = 0.5 * deltaT * deltaT;
+
+    // The axis barely turns over a prediction interval, so the rotation is taken
+    // about the mean angular velocity.
+    Transformd pose     = lstate.State.Pose;
+    Vector3d   rotation = lstate.PredictionAngularVelocity * deltaT + angularAcceleration * halfDeltaTSq;
+    double     angle    = rotation.Length();
+    if (angle > 0)
+        pose.Rotation = pose.Rotation * Quatd(rotation, angle);
+    pose.Translation += lstate.PredictionLinearVelocity * deltaT + linearAcceleration * halfDeltaTSq;
+
+    if (predicted)
+    {
+        predicted->AngularVelocity     = Vector3f(lstate.PredictionAngularVelocity + angularAcceleration * deltaT);
+        predicted->LinearVelocity      = Vector3f(lstate.PredictionLinearVelocity + linearAcceleration * deltaT);
+        predicted->AngularAcceleration = Vector3f(angularAcceleration);
+        predicted->LinearAcceleration  = Vector3f(linearAcceleration);
+    }
+    return pose;
+}
+
+bool SensorFusion::getPastState(double absoluteTime, PoseState<float>* state) const
+{
+    UInt32 count;
+    const LocklessHistory<PoseState<float>, PoseHistorySize>& history = pState->PoseHistory;
+    UInt32 newest = history.GetNewest(&count);
+    if (count < 2)
+        return false;
+
+    // Binary search for the readings on either side of absoluteTime. Readings
+    // overwritten meanwhile fail to copy, and then the time is predicted as before.
+    UInt32 lowIndex  = newest - (count - 1);
+    UInt32 highIndex = newest;
+    PoseState<float> low, high;
+    if (!history.TryGet(lowIndex, &low) || !history.TryGet(highIndex, &high) ||
+        absoluteTime < low.TimeInSeconds || absoluteTime > high.TimeInSeconds)
+        return false;
+
+    while (highIndex - lowIndex > 1)
+    {
+        UInt32            middleIndex = lowIndex + (highIndex - lowIndex) / 2;
+        PoseState<float> middle;
+        if (!history.TryGet(middleIndex, &middle))
+            return false;
+        if (middle.TimeInSeconds <= absoluteTime)
+        {
+            low      = middle;
+            lowIndex = middleIndex;
+        }
+        else
+        {
+            high      = middle;
+            highIndex = middleIndex;
+        }
+    }
+
+    double interval = high.TimeInSeconds - low.TimeInSeconds;
+    float  f        = (interval > 0) ? (float)((absoluteTime - low.TimeInSeconds) / interval) : 1.0f;
+
+    state->Pose.Rotation        = low.Pose.Rotation.Nlerp(high.Pose.Rotation, 1.0f - f);
+    state->Pose.Translation     = low.Pose.Translation.Lerp(high.Pose.Translation, f);
+    state->AngularVelocity      = low.AngularVelocity.Lerp(high.AngularVelocity, f);
+    state->LinearVelocity       = low.LinearVelocity.Lerp(high.LinearVelocity, f);
+    state->AngularAcceleration  = low.AngularAcceleration.Lerp(high.AngularAcceleration, f);
+    state->LinearAcceleration   = low.LinearAcceleration.Lerp(high.LinearAcceleration, f);
+    state->TimeInSeconds        = absoluteTime;
+    return true;
+}
+
 Transformf SensorFusion::GetPoseAtTime(double absoluteTime) const
 {
     SensorState ss = GetSensorStateAtTime ( absoluteTime );
@@ -858,9 +1548,14 @@ Transformf SensorFusion::GetPoseAtTime(double absoluteTime) const
 
 SensorState SensorFusion::GetSensorStateAtTime(double absoluteTime) const
 {          
-     const LocklessState lstate = UpdatedState.GetState();
-     // Delta time from the last available data
-     const double pdt = absoluteTime - lstate.State.TimeInSeconds;
+    return GetSensorStateBatch(&absoluteTime, 0, 1);
+}
+
+SensorState SensorFusion::GetSensorStateBatch(const double* absoluteTimes,
+                                              PoseStatef* predictedStates, unsigned count) const
+{
+     const LocklessState lstate     = pState->UpdatedState.GetState();
+     const Transformd&   imuFromCpf = lstate.ImuFromCpf;
      
      SensorState ss;
      ss.Recorded     = PoseStatef(lstate.State);
@@ -869,17 +1564,85 @@ SensorState SensorFusion::GetSensorStateAtTime(double absoluteTime) const
      ss.StatusFlags  = lstate.StatusFlags;
 
      ss.Predicted               = ss.Recorded;
-     ss.Predicted.TimeInSeconds = absoluteTime;
-    
-     // Do prediction logic and ImuFromCpf transformation
-     ss.Recorded.Pose  = Transformf(lstate.State.Pose * ImuFromCpf);
-     ss.Predicted.Pose = Transformf(calcPredictedPose(lstate.State, pdt) * ImuFromCpf);
+     ss.Predicted.TimeInSeconds = count ? absoluteTimes[0] : lstate.State.TimeInSeconds;
+
+     // Do prediction logic and ImuFromCpf transformation; velocities and accelerations
+     // are shared by all predicted states, only pose and time differ. Times in the
+     // past are interpolated from the history when it covers them.
+     PoseState<float>  pastState;
+     ss.Recorded.Pose  = Transformf(lstate.State.Pose * imuFromCpf);
+     if (ss.Predicted.TimeInSeconds < lstate.State.TimeInSeconds &&
+         getPastState(ss.Predicted.TimeInSeconds, &pastState))
+     {
+         ss.Predicted      = pastState;
+         ss.Predicted.Pose = Transformf(Transformd(pastState.Pose) * imuFromCpf);
+     }
+     else
+     {
+         ss.Predicted.Pose = Transformf(predictPose(lstate, ss.Predicted.TimeInSeconds - lstate.State.TimeInSeconds,
+                                                    &ss.Predicted) * imuFromCpf);
+     }
+
+     if (predictedStates && count)
+     {
+         predictedStates[0] = ss.Predicted;
+         for (unsigned i = 1; i < count; i++)
+         {
+             // Delta time from the last available data
+             const double pdt = absoluteTimes[i] - lstate.State.TimeInSeconds;
+
+             if (pdt < 0 && getPastState(absoluteTimes[i], &pastState))
+             {
+                 predictedStates[i]      = pastState;
+                 predictedStates[i].Pose = Transformf(Transformd(pastState.Pose) * imuFromCpf);
+                 continue;
+             }
+
+             predictedStates[i]               = ss.Recorded;
+             predictedStates[i].TimeInSeconds = absoluteTimes[i];
+             predictedStates[i].Pose          = Transformf(predictPose(lstate, pdt, &predictedStates[i]) * imuFromCpf);
+         }
+     }
      return ss;
 }
 
+void SensorFusion::GetMemoryFootprint(MemoryFootprint* footprint) const
+{
+    footprint->MagReferences   = MagRefs.GetCapacity() * sizeof(MagReferencePoint) +
+                                 (pMagRefBuckets ? sizeof(int) * MagRefBucketCount : 0);
+    footprint->SharedState     = sizeof(LocalState);
+    footprint->Filters         = sizeof(FAccelInImuFrame) + sizeof(FAccelInCameraFrame) + sizeof(FAngV);
+    footprint->ExposureHistory = sizeof(ExposureRecordHistory);
+    footprint->FusionQueue     = sizeof(FusionQueue);
+    footprint->Total           = sizeof(SensorFusion) + sizeof(BodyFrameHandler) +
+                                 (pFusionThread ? sizeof(FusionThread) : 0) + footprint->MagReferences;
+}
+
 unsigned SensorFusion::GetStatus() const
 {
-    return UpdatedState.GetState().StatusFlags;
+    return pState->UpdatedState.GetState().StatusFlags;
+}
+
+void SensorFusion::SetPoseStreamer(PoseStreamer* streamer)
+{
+    Lock::Locker lockScope(&FusionLock);
+    pStreamer = streamer;
+}
+
+void SensorFusion::SetSharedState(SharedState* state, bool publish)
+{
+    Lock::Locker lockScope(&FusionLock);
+    OVR_ASSERT(publish || !state || !IsAttachedToSensor());
+
+    // A fusion that keeps publishing carries its latest state over, so readers of
+    // the new state don't see it reset until the next reading.
+    LocklessState current   = pState->UpdatedState.GetState();
+    bool          wasReader = SharedReadOnly;
+
+    pState         = state ? state : &LocalState;
+    SharedReadOnly = state && !publish;
+    if (!SharedReadOnly && !wasReader)
+        pState->UpdatedState.SetState(current);
 }
 
 //-------------------------------------------------------------------------------------
@@ -887,18 +1650,75 @@ unsigned SensorFusion::GetStatus() const
 void SensorFusion::OnMessage(const MessageBodyFrame& msg)
 {
     OVR_ASSERT(!IsAttachedToSensor());
-    handleMessage(msg);
+    receiveBodyFrames(&msg, 1, 0, false);
+}
+
+void SensorFusion::OnMessage(const MessageExposureFrame& msg)
+{
+    OVR_ASSERT(!IsAttachedToSensor());
+    receiveExposure(msg, false);
 }
 
 //-------------------------------------------------------------------------------------
 
 void SensorFusion::BodyFrameHandler::OnMessage(const Message& msg)
 {
-	Recording::GetRecorder().RecordMessage(msg);
-    if (msg.Type == Message_BodyFrame)
-        pFusion->handleMessage(static_cast<const MessageBodyFrame&>(msg));
-    if (msg.Type == Message_ExposureFrame)
-        pFusion->handleExposure(static_cast<const MessageExposureFrame&>(msg));
+    // Batched frames are recorded one by one, like unbatched ones.
+    if (msg.Type == Message_BodyFrameBatch)
+    {
+        const MessageBodyFrameBatch& batch = static_cast<const MessageBodyFrameBatch&>(msg);
+        pFusion->receiveBodyFrames(batch.pFrames, batch.Count, batch.ReceiveTimeSeconds, true);
+    }
+    else if (msg.Type == Message_BodyFrame)
+        pFusion->receiveBodyFrames(&static_cast<const MessageBodyFrame&>(msg), 1, 0, true);
+    else if (msg.Type == Message_ExposureFrame)
+        pFusion->receiveExposure(static_cast<const MessageExposureFrame&>(msg), true);
 }
 
+//-------------------------------------------------------------------------------------
+
+#ifdef OVR_SENSOR_FUSION_PRECISION_CHECK
+
+// The fusions are too large for the stack of every thread.
+struct PrecisionCheckFusions : public NewOverrideBase
+{
+    SensorFusion Float, Double;
+};
+
+void SensorFusion::RunPrecisionCheck(const char* tracePath)
+{
+    SensorTracePlayer floatPlayer, doublePlayer;
+    if (!floatPlayer.Open(tracePath) || !doublePlayer.Open(tracePath))
+        return;
+
+    PrecisionCheckFusions* fusions      = new PrecisionCheckFusions;
+    SensorFusion*          floatFusion  = &fusions->Float;
+    SensorFusion*          doubleFusion = &fusions->Double;
+    floatFusion->SetFloatCorrections(true);
+
+    // Both play the same records, so the fusions stay in step.
+    double maxAngle = 0, maxAngleTime = 0;
+    while (floatPlayer.PlayNext(floatFusion) && doublePlayer.PlayNext(doubleFusion))
+    {
+        double angle = rotationAngleBetween(floatFusion->WorldFromImu.Pose.Rotation,
+                                            doubleFusion->WorldFromImu.Pose.Rotation);
+        if (angle > maxAngle)
+        {
+            maxAngle     = angle;
+            maxAngleTime = doubleFusion->WorldFromImu.TimeInSeconds;
+        }
+    }
+
+    double maxCorrection = Alg::Max(floatFusion->MaxCorrectionDivergence,
+                                    doubleFusion->MaxCorrectionDivergence);
+    LogText("SensorFusion: %u body frames of '%s'. Float corrections turned the orientation "
+            "at most %g rad from double ones, at %.3f s; a correction differed from the "
+            "same one in the other precision by at most %g rad.\n",
+            doublePlayer.GetBodyFrameCount(), tracePath, maxAngle, maxAngleTime, maxCorrection);
+
+    delete fusions;
+}
+
+#endif // OVR_SENSOR_FUSION_PRECISION_CHECK
+
 } // namespace OVR
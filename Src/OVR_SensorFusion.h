@@ -40,6 +40,25 @@ typedef struct ovrSensorState_ ovrSensorState;
 
 namespace OVR {
 
+class PoseStreamer;
+
+// Precision of the per-sample tilt and vision yaw corrections. Defining
+// OVR_SENSOR_FUSION_FLOAT computes them in single precision, which is cheaper on
+// boards without fast double math. Each correction is a small rotation computed from
+// the current pose and applied to it in double, so float rounding only perturbs one
+// step relative to its own size, and doesn't accumulate in the pose. The magnetometer
+// yaw correction stays in double, since its integral term accumulates tiny steps.
+#ifdef OVR_SENSOR_FUSION_FLOAT
+typedef float  SensorFusionScalar;
+#else
+typedef double SensorFusionScalar;
+#endif
+
+// Define to build SensorFusion::RunPrecisionCheck, which measures how far float
+// corrections take the fusion from double ones on a recorded trace. With it, the
+// precision of the corrections is chosen at run time.
+//#define OVR_SENSOR_FUSION_PRECISION_CHECK
+
 struct HmdRenderInfo;
 
 //-------------------------------------------------------------------------------------
@@ -184,18 +203,49 @@ public:
 //  - By user manually passing MessageBodyFrame messages to the OnMessage() function. 
 //  - By attaching SensorFusion to a SensorDevice, in which case it will
 //    automatically handle notifications from that device.
+//
+// Its buffers are sized at compile time. Builds for systems driving many HMDs with
+// little memory can define OVR_COMPACT_HMD_STATE for smaller ones: a shorter pose
+// history and fusion queue, fewer exposure records, and a quarter second of the
+// accelerometer instead of a second, so that tilt correction trusts it sooner.
 
 
 class SensorFusion : public NewOverrideBase, public VisionHandler
 {
 	friend class SensorFusionDebug;
+    class FusionThread;
+    friend class FusionThread;
 
     enum
     {
-        MagMaxReferences = 1000
+        MagMaxReferences = 1000,
+        // Buckets of the reference point grid; a power of two, at least MagMaxReferences.
+        MagRefBucketCount = 1024,
+        // Fusion queue backlogs at least this long get their orientation
+        // corrections once, on the last frame.
+        DeferCorrectionBatchSize = 4,
+#if defined(OVR_COMPACT_HMD_STATE)
+        PoseHistorySize     = 64,
+        FusionQueueSize     = 32,
+        ExposureHistorySize = 16,
+        AccelFilterSize     = 250,
+#else
+        // Recent states kept for queries in the past: a quarter second at 1000Hz.
+        PoseHistorySize     = 256,
+        // Frames queued for the fusion thread; a quarter second at 1000Hz.
+        FusionQueueSize     = 256,
+        // Exposure records kept for vision: over a second and a half at 60Hz.
+        ExposureHistorySize = 100,
+        // Accelerometer readings the tilt correction filters: a second at 1000Hz.
+        AccelFilterSize     = 1000,
+#endif
+        // Buffer storage, powers of two past the sizes above.
+        ExposureHistoryStorage = (ExposureHistorySize > 16) ? 128 : 16,
+        AccelFilterStorage     = (AccelFilterSize > 256) ? 1024 : 256
     };        
 
 public:
+    OVR_MEMORY_REDEFINE_NEW_TAGGED(AllocSubsystem_Fusion)
 
 	// -------------------------------------------------------------------------------
 	// Critical components for tiny API
@@ -211,6 +261,17 @@ public:
     // Returns true if this Sensor fusion object is attached to the IMU.
     bool                        IsAttachedToSensor() const;
 
+    // Moves the fusion off the thread that delivers sensor messages: that thread
+    // then only queues the frames, which a fusion thread of this object integrates
+    // in batches before publishing the state. scheduling, if given, is applied to
+    // the fusion thread, so that it can be pinned to a processor of its own.
+    // Called with no sensor attached; returns false if the thread can't be started,
+    // in which case messages keep being handled as they come in.
+    bool                        StartFusionThread(const Thread::SchedulingParams* scheduling = 0);
+    // Stops the fusion thread; called with no sensor attached, and by the destructor.
+    void                        StopFusionThread();
+    bool                        IsFusionThreadRunning() const { return pFusionThread != 0; }
+
     // Sets up head-and-neck model and device-to-pupil dimensions from the user's profile and the HMD stats.
     // This copes elegantly if profile is NULL.
     void SetUserHeadDimensions(Profile const &profile, HmdRenderInfo const &hmdRenderInfo);
@@ -219,9 +280,18 @@ public:
 	Transformf                  GetPoseAtTime(double absoluteTime) const;
 
     // Get the full dynamical system state of the CPF, which includes velocities and accelerations,
-    // predicted at a specified absolute point in time.
+    // predicted at a specified absolute point in time. Times before the latest reading, within the
+    // last PoseHistorySize readings, are interpolated between the readings around them instead.
     SensorState                 GetSensorStateAtTime(double absoluteTime) const;
 
+    // Batch version of GetSensorStateAtTime: predicts the CPF state at each of count
+    // absoluteTimes from a single snapshot of the fusion state, so all results are mutually
+    // consistent and the lockless state is read only once. predictedStates receives count
+    // entries and may be null. Returns the full state for absoluteTimes[0], or the most
+    // recent reading if count is 0.
+    SensorState                 GetSensorStateBatch(const double* absoluteTimes,
+                                                    PoseStatef* predictedStates, unsigned count) const;
+
     // Get the sensor status (same as GetSensorStateAtTime(...).Status)
     unsigned int                GetStatus() const;
 
@@ -231,6 +301,19 @@ public:
     // Resets the current orientation.
     void        Reset                        ();
 
+    struct SharedState;
+    // Publishes the lockless state to state instead of the object's own, or with
+    // publish false, reads it from there, so that a fusion running in another process
+    // can be followed. A reading fusion must not be attached to a sensor; only its
+    // Get queries are meaningful, and Reset leaves the shared state alone. Null goes
+    // back to the object's own state.
+    void        SetSharedState               (SharedState* state, bool publish);
+    bool        ReadsSharedState             () const   { return SharedReadOnly; }
+
+    // Streams the pose of every reading through streamer, which must stay open
+    // until it's replaced, and is used on the sensor thread; null stops streaming.
+    void        SetPoseStreamer              (PoseStreamer* streamer);
+
     // Configuration
     void        EnableMotionTracking(bool enable = true)    { MotionTrackingEnabled = enable; }
     bool        IsMotionTrackingEnabled() const             { return MotionTrackingEnabled;   }
@@ -240,6 +323,61 @@ public:
     void        SetGravityEnabled   (bool enableGravity);
     bool        IsGravityEnabled    () const;
 
+    // Idle Policy
+    // -----------------------------------------------
+    // Puts the attached sensor in idle mode (see SensorDevice::SetIdle) once poses
+    // haven't been read for readTimeoutSeconds, or once the headset hasn't turned
+    // faster than a slow head motion for motionTimeoutSeconds; 0 turns either
+    // condition off, and both are off by default. The first reading after a pose
+    // read or a movement takes the sensor out of idle mode.
+    void        SetIdlePolicy(double readTimeoutSeconds, double motionTimeoutSeconds);
+    double      GetIdleReadTimeout  () const    { return IdleReadTimeout;   }
+    double      GetIdleMotionTimeout() const    { return IdleMotionTimeout; }
+    bool        IsSensorIdle        () const    { return SensorIdle;        }
+    // Counts as a read for the idle policy; cheap enough to call for every query.
+    void        NotifyPoseRead() { if (IdleReadTimeout > 0) LastPoseReadTime = Timer::GetSeconds(); }
+
+    // Pose Prediction
+    // -----------------------------------------------
+    // How poses past the latest reading are extrapolated by GetSensorStateAtTime and
+    // the other queries. What a model needs is updated as readings come in and
+    // published with the state, so queries cost the same with any of them; readers
+    // of a shared state predict with the model of the fusion publishing it.
+    enum PredictionModel
+    {
+        // Constant velocity, over an interval shortened at low speeds so that the
+        // noise of a still headset isn't amplified; the default.
+        Prediction_Adaptive,
+        // Constant velocity over the whole interval.
+        Prediction_ConstantVelocity,
+        // Constant acceleration, from the smoothed derivative of the readings.
+        Prediction_ConstantAcceleration,
+        // Constant acceleration, with the velocity and acceleration from an alpha-beta
+        // filter of the readings (a Kalman filter with fading-memory gains), stable
+        // enough for longer intervals without filtering the poses again.
+        Prediction_Kalman,
+        Prediction_Count
+    };
+    // filterSeconds is the time constant of the Prediction_Kalman filter: longer
+    // means smoother, shorter follows changes of motion sooner.
+    void            SetPredictionModel(PredictionModel model, double filterSeconds = 0.02);
+    PredictionModel GetPredictionModel        () const  { return Prediction; }
+    double          GetPredictionFilterSeconds() const  { return PredictionFilterSeconds; }
+
+    // Memory Footprint
+    // -----------------------------------------------
+    // The bytes this object uses, with what it allocates, and the largest parts of them.
+    struct MemoryFootprint
+    {
+        UPInt       Total;
+        UPInt       SharedState;        // Lockless state and pose history, unless shared.
+        UPInt       Filters;            // Sensor filter buffers.
+        UPInt       ExposureHistory;
+        UPInt       FusionQueue;
+        UPInt       MagReferences;      // Allocated once the magnetometer corrects yaw.
+    };
+    void            GetMemoryFootprint(MemoryFootprint* footprint) const;
+
 	// Vision Position and Orientation Configuration
     // -----------------------------------------------
 	bool        IsVisionPositionEnabled       () const;
@@ -255,6 +393,14 @@ public:
     // message from a sensor.
     // Should be called by user if not attached to sensor.
     void        OnMessage                (const MessageBodyFrame& msg);
+    // Notifies SensorFusion object about a camera exposure, likewise.
+    void        OnMessage                (const MessageExposureFrame& msg);
+
+    // Sets the IMU position and magnetometer calibration state that AttachToSensor
+    // reads from the sensor; call it instead when passing messages manually, such
+    // as when playing back a recorded trace. The last report must be the IMU's.
+    void        SetSensorCalibration     (const Array<PositionCalibrationReport>& reports,
+                                          bool magCalibrated);
    
 
 	// Interaction with vision
@@ -267,9 +413,28 @@ public:
     // Get a configuration that represents the change over a short time interval
     virtual Transform<double> GetVisionPrediction(UInt32 exposureCounter);
 
+    // Vision ingest for trackers outside the SDK: submits the camera pose computed
+    // for the exposure counted exposureCounter (MessageExposureFrame::CameraFrameCount).
+    // It is queued without locking and applied as OnVisionSuccess by the next body
+    // frame, against the state recorded at that exposure, so the tracker never waits
+    // for the sensor thread. Call it from one thread at a time. Returns false if
+    // VisionIngestQueueSize poses are waiting, in which case the pose is dropped.
+    bool                SubmitVisionPose(const Transform<double>& cameraFromImu, UInt32 exposureCounter);
+
     double              GetTime                ()     const;
     double              GetVisionLatency       ()     const;
 
+#ifdef OVR_SENSOR_FUSION_PRECISION_CHECK
+    // Plays the trace at tracePath into two fusions, one computing the tilt and vision
+    // yaw corrections in float and one in double. Logs the largest angle between their
+    // orientations, and between a correction and the same one computed in the other
+    // precision from the same state. Call after System::Init.
+    static void         RunPrecisionCheck(const char* tracePath);
+
+    // Computes the corrections in float rather than double.
+    void                SetFloatCorrections(bool useFloat)  { FloatCorrections = useFloat; }
+#endif
+
 
 	// Detailed head dimension control
     // -----------------------------------------------
@@ -321,6 +486,16 @@ private:
         virtual bool SupportsMessageType(MessageType type) const;
     };   
 
+    // A frame waiting for the fusion thread.
+    struct QueuedFrame
+    {
+        MessageType             Type;
+        MessageBodyFrame        BodyFrame;
+        MessageExposureFrame    Exposure;
+
+        QueuedFrame() : Type(Message_None), Exposure(0) { }
+    };
+
 
     // -----------------------------------------------
 
@@ -333,8 +508,32 @@ private:
         Vector3d           Magnetometer;
         unsigned int       StatusFlags;
 
-        LocklessState() : Temperature(0.0), StatusFlags(0) { };
+        // ImuFromCpf of the fusion that made the state, so that readers transform
+        // it the same way, even in another process.
+        Transformd         ImuFromCpf;
+
+        // The PredictionModel, and the velocities and accelerations it extrapolates
+        // with: angular ones in the IMU frame, linear ones in the world frame, as in
+        // State.
+        int                Prediction;
+        Vector3d           PredictionAngularVelocity, PredictionAngularAcceleration;
+        Vector3d           PredictionLinearVelocity,  PredictionLinearAcceleration;
+
+        LocklessState() : Temperature(0.0), StatusFlags(0), Prediction(Prediction_Adaptive) { };
+    };
+
+public:
+    // The state that lockless readers query: the latest state and the recent pose
+    // history. It holds no pointers, so it can be placed in memory shared with other
+    // processes (see PoseService).
+    struct SharedState
+    {
+        LocklessSlotUpdater<LocklessState>                  UpdatedState;
+        // WorldFromImu after each reading, for GetSensorStateAtTime in the recent past;
+        // in float, the precision of the states returned.
+        LocklessHistory<PoseState<float>, PoseHistorySize> PoseHistory;
     };
+private:
 
 
     // -----------------------------------------------
@@ -369,10 +568,15 @@ private:
         Vector3d          InImuFrame;
         Transformd        WorldFromImu;
 		int				  Score;
+        // MagRefBuckets entry of the point's grid cell, and the next point in
+        // that bucket or -1.
+        int               Bucket;
+        int               NextInBucket;
 
         MagReferencePoint() { }
         MagReferencePoint(const Vector3d& inImuFrame, const Transformd& worldFromImu, int score)
-            : InImuFrame(inImuFrame), WorldFromImu(worldFromImu), Score(score) { }
+            : InImuFrame(inImuFrame), WorldFromImu(worldFromImu), Score(score),
+              Bucket(0), NextInBucket(-1) { }
     };
 
     // -----------------------------------------------
@@ -382,7 +586,11 @@ private:
 
     // State that can be read without any locks, so that high priority rendering thread
     // doesn't have to worry about being blocked by a sensor/vision threads that got preempted.
-    LocklessUpdater<LocklessState>	UpdatedState;
+    SharedState             LocalState;
+    // LocalState, or the state given to SetSharedState.
+    SharedState*            pState;
+    bool                    SharedReadOnly;
+    PoseStreamer*           pStreamer;
 
     // The pose we got from Vision, augmented with velocity information from numerical derivatives
     PoseState<double>       CameraFromImu;    
@@ -396,7 +604,7 @@ private:
     PoseState<double>       VisionError;
     // Past exposure records between the last update from vision and now
     // (should only be one record unless vision latency is high)
-    CircularBuffer<ExposureRecord> ExposureRecordHistory;
+    CircularBufferFixed<ExposureRecord, ExposureHistoryStorage> ExposureRecordHistory;
     // ExposureRecord that corresponds to the last pose we got from vision
     ExposureRecord          LastVisionExposureRecord;
     // Incomplete ExposureRecord that will go into the history buffer when 
@@ -407,14 +615,41 @@ private:
     // Time of the last vision update
     double                  LastVisionAbsoluteTime;
 
+    // Poses from SubmitVisionPose, a ring written by the tracker at VisionIngestHead
+    // and read by the sensor thread at VisionIngestTail.
+    enum { VisionIngestQueueSize = 8 };
+    struct VisionIngestPose
+    {
+        Transformd        CameraFromImu;
+        UInt32            ExposureCounter;
+    };
+    VisionIngestPose        VisionIngestQueue[VisionIngestQueueSize];
+    AtomicInt<UInt32>       VisionIngestHead;
+    AtomicInt<UInt32>       VisionIngestTail;
+
     unsigned int            Stage;
+    // Time of the frames whose orientation corrections were deferred to a later one.
+    double                  DeferredCorrectionSeconds;
     BodyFrameHandler       *pHandler;
 
+    // Held while the fusion state changes: by the thread that integrates the frames,
+    // and by Reset and the other calls that change the state from outside.
+    Lock                    FusionLock;
+    // Frames from the sensor, a ring written by the sensor thread at FusionQueueHead
+    // and read by pFusionThread, if running, at FusionQueueTail.
+    FusionThread           *pFusionThread;
+    QueuedFrame             FusionQueue[FusionQueueSize];
+    AtomicInt<UInt32>       FusionQueueHead;
+    AtomicInt<UInt32>       FusionQueueTail;
+
 	Vector3d				FocusDirection;
 	double					FocusFOV;
 
-    SensorFilterBodyFrame   FAccelInImuFrame, FAccelInCameraFrame;
-    SensorFilterd           FAngV;
+    // Filter storage is inside the object, so that Reset and AttachToSensor never
+    // allocate; it is rounded up to a power of two, past the capacities the
+    // constructor gives.
+    SensorFilterBodyFrameBase<CircularBufferFixed<Vector3d, AccelFilterStorage> > FAccelInImuFrame, FAccelInCameraFrame;
+    SensorFilter<double, CircularBufferFixed<Vector3d, 32> >       FAngV;
 
     Vector3d                AccelOffset;
 
@@ -422,10 +657,21 @@ private:
 
     bool                    EnableYawCorrection;
     bool                    MagCalibrated;
-    Array<MagReferencePoint> MagRefs;
+    // Keeps its capacity when Reset clears it.
+    Array<MagReferencePoint, ArrayConstPolicy<0, 4, true> > MagRefs;
     int                     MagRefIdx;
+    // MagRefs hashed by their grid cell (see findMagReference): the first point
+    // of each bucket, or -1. Allocated with the first reference, since only
+    // sensors with a calibrated magnetometer use them.
+    int*                    pMagRefBuckets;
     Quatd                   MagCorrectionIntegralTerm;
 
+#ifdef OVR_SENSOR_FUSION_PRECISION_CHECK
+    bool                    FloatCorrections;
+    // Largest angle between a correction and the same one in the other precision.
+    double                  MaxCorrectionDivergence;
+#endif
+
     bool                    EnableCameraTiltCorrection;
     // Describes the pose of the camera in the world coordinate system
     Transformd              WorldFromCamera;
@@ -434,6 +680,20 @@ private:
     bool                    MotionTrackingEnabled;
     bool                    VisionPositionEnabled;
 
+    // Idle policy; LastPoseReadTime is written by the threads that read poses.
+    double                  IdleReadTimeout;
+    double                  IdleMotionTimeout;
+    volatile double         LastPoseReadTime;
+    double                  LastMotionTime;
+    volatile bool           SensorIdle;
+
+    // Prediction model, and the state of its filter, updated with every reading.
+    PredictionModel         Prediction;
+    double                  PredictionFilterSeconds;
+    bool                    PredictionFilterPrimed;
+    Vector3d                PredictionAngularVelocity, PredictionAngularAcceleration;
+    Vector3d                PredictionLinearVelocity,  PredictionLinearAcceleration;
+
     // This is a signed distance, but positive because Z increases looking inward.
     // This is expressed relative to the IMU in the HMD and corresponds to the location
     // of the cyclopean virtual camera focal point if both the physical and virtual 
@@ -452,18 +712,61 @@ private:
 
     // Internal handler for messages
     // bypasses error checking.
-    void        handleMessage(const MessageBodyFrame& msg);
+    // storeState can be false for all but the last frame of a batch, so that the
+    // lockless state is only published once per sensor report. Without correct, the
+    // tilt and yaw corrections are left to the next frame that applies them, which
+    // then corrects for the time of both.
+    void        handleMessage(const MessageBodyFrame& msg, bool storeState = true, bool correct = true);
+    // receiveTime is when the frames' report was read, or 0 if it isn't known.
+    void        handleBodyFrames(const MessageBodyFrame* frames, unsigned count, double receiveTime, bool record);
     void        handleExposure(const MessageExposureFrame& msg);
+    // Handles the frames of one sensor report, or queues them if the fusion thread runs.
+    void        receiveBodyFrames(const MessageBodyFrame* frames, unsigned count, double receiveTime, bool record);
+    void        receiveExposure(const MessageExposureFrame& msg, bool record);
+    // Used by the sensor thread; handles the queue itself once it is full.
+    void        queueFrame(const QueuedFrame& frame);
+    // Handles the queued frames, with FusionLock held.
+    void        processFusionQueue();
+    // OnVisionSuccess, with FusionLock held.
+    void        applyVisionSuccess(const Transform<double>& cameraFromImu, UInt32 exposureCounter);
+    // Applies the poses waiting from SubmitVisionPose.
+    void        applyVisionIngest();
+    // Applies the idle policy to the sensor that sent msg.
+    void        updateIdle(const MessageBodyFrame& msg, const Vector3d& gyro);
+    // Filters the velocities of WorldFromImu for Prediction_Kalman.
+    void        updatePredictionFilter(double deltaT);
+    // Fills in the prediction of lstate; positionTracked is false when the linear
+    // velocity and acceleration come from the head model.
+    void        storePrediction(LocklessState* lstate, bool positionTracked) const;
+    // Extrapolates the IMU pose of lstate by deltaT with its prediction model; if
+    // predicted isn't null, its velocities and accelerations are set to those of the
+    // model, unless that is Prediction_Adaptive.
+    static Transformd predictPose(const LocklessState& lstate, double deltaT, PoseStatef* predicted);
+
+    // Interpolates WorldFromImu at a time covered by PoseHistory; returns false
+    // if the time isn't between two readings in it.
+    bool        getPastState(double absoluteTime, PoseState<float>* state) const;
 
     // Compute the difference between vision and sensor fusion data
     PoseStated  computeVisionError();
     // Apply headset yaw correction from magnetometer
 	// for models without camera or when camera isn't available
 	void        applyMagYawCorrection(Vector3d mag, double deltaT);
+    // Magnetometer reference point grid: returns the index of the closest point
+    // within maxDist of mag, or -1.
+    int         findMagReference(const Vector3d& mag, double maxDist) const;
+    void        addMagReference(const MagReferencePoint& ref);
+    void        removeMagReference(int idx);
+    void        clearMagReferences();
     // Apply headset tilt correction from the accelerometer
     void        applyTiltCorrection(double deltaT);
     // Apply headset yaw correction from the camera
     void        applyVisionYawCorrection(double deltaT);
+    // The two corrections, computed in T; false if there is no tilt correction.
+    template<class T>
+    bool        computeTiltCorrection(double deltaT, Quatd* correction) const;
+    template<class T>
+    Quatd       computeVisionYawCorrection(double deltaT) const;
     // Apply headset position correction from the camera
     void        applyPositionCorrection(double deltaT);
     // Apply camera tilt correction from the accelerometer
@@ -542,7 +845,7 @@ inline SensorFusion::BodyFrameHandler::~BodyFrameHandler()
 
 inline bool SensorFusion::BodyFrameHandler::SupportsMessageType(MessageType type) const
 {
-    return (type == Message_BodyFrame || type == Message_ExposureFrame);
+    return (type == Message_BodyFrame || type == Message_BodyFrameBatch || type == Message_ExposureFrame);
 }
 
 
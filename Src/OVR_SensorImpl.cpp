@@ -27,9 +27,12 @@ limitations under the License.
 #include "OVR_SensorImpl.h"
 #include "OVR_Sensor2Impl.h"
 #include "OVR_SensorImpl_Common.h"
+#include "OVR_SyntheticSensor.h"
 #include "OVR_JSON.h"
 #include "OVR_Profile.h"
 #include "Kernel/OVR_Alg.h"
+#include "Kernel/OVR_PerfCounters.h"
+#include <stdlib.h>
 #include <time.h>
 
 // HMDDeviceDesc can be created/updated through Sensor carrying DisplayInfo.
@@ -53,10 +56,38 @@ enum {
 
     Sensor_BootLoader   = 0x1001,
 
-    Sensor_DefaultReportRate = 500, // Hz
-    Sensor_MaxReportRate     = 1000 // Hz
+    Sensor_DefaultReportRate = 500,  // Hz
+    Sensor_MaxReportRate     = 1000, // Hz
+    // High enough that a sample arrives within a frame of activity resuming.
+    Sensor_IdleReportRate    = 100   // Hz
 };
 
+// Keep-alive intervals, in seconds. While the sensor streams, each keep-alive
+// moves the next one KeepAliveDeltaStep further out, up to KeepAliveMaxDelta,
+// which leaves a few seconds of margin on the device's timeout; otherwise it
+// goes back to KeepAliveMinDelta.
+static const double KeepAliveMinDelta      = 3.0;
+static const double KeepAliveMaxDelta      = 6.0;
+static const double KeepAliveDeltaStep     = 1.0;
+// A keep-alive that is due while reports stream waits up to this long for the
+// next report, and is sent right after it, in the gap before the one after.
+static const double KeepAliveReportWait    = 0.05;
+// Reports are considered streaming if the last one is no older than this.
+static const double KeepAliveStreamTimeout = 0.1;
+
+// Report statistics are gathered over windows of this many seconds; autotune
+// lowers the rate after a window that lost samples, and tries a higher one after
+// ReportAutotuneQuietWindows windows that didn't.
+static const double   ReportStatsWindow          = 1.0;
+static const unsigned ReportAutotuneQuietWindows = 10;
+
+// Seconds from a report being read from the device to its handler being called.
+static PerfCounter ReadToDispatchCounter("perf.hid.readToDispatch", PerfCounter::Option_Histogram);
+// Seconds from the newest sample of a report, in system time, to the report being
+// read. This is the first of the "perf.latency.sampleTo*" stages that follow a
+// sample to the display; see OVR_CAPI.h.
+static PerfCounter SampleToReceiveCounter("perf.latency.sampleToReceive", PerfCounter::Option_Histogram);
+
 
 // Messages we care for
 enum TrackerMessageType
@@ -95,11 +126,7 @@ struct TrackerSensors
         // Only unpack as many samples as there actually are
         int iterationCount = (SampleCount > 2) ? 3 : SampleCount;
 
-        for (int i = 0; i < iterationCount; i++)
-        {
-            UnpackSensor(buffer + 8 + 16 * i,  &Samples[i].AccelX, &Samples[i].AccelY, &Samples[i].AccelZ);
-            UnpackSensor(buffer + 16 + 16 * i, &Samples[i].GyroX,  &Samples[i].GyroY,  &Samples[i].GyroZ);
-        }
+        UnpackSensorSamples(buffer + 8, iterationCount, 0.0001f, Samples);
 
         MagX = DecodeSInt16(buffer + 56);
         MagY = DecodeSInt16(buffer + 58);
@@ -231,6 +258,18 @@ void SensorDeviceFactory::EnumerateDevices(EnumerateVisitor& visitor)
     SensorEnumerator sensorEnumerator(this, visitor);
     GetManagerImpl()->GetHIDDeviceManager()->Enumerate(&sensorEnumerator);
 
+    // A synthetic sensor comes with the headset that real ones report.
+    const char* synthetic = getenv("OVR_SYNTHETIC_SENSOR");
+    if (synthetic && *synthetic)
+    {
+        SyntheticSensorCreateDesc createDesc(this, synthetic);
+        visitor.Visit(createDesc);
+
+        SensorDisplayInfoImpl displayInfo;
+        SyntheticTracker::GetDisplayInfo(&displayInfo);
+        SensorDeviceImpl::EnumerateHMDFromSensorDisplayInfo(displayInfo, visitor);
+    }
+
     //double totalSeconds = Timer::GetProfileSeconds() - start; 
 }
 
@@ -305,8 +344,23 @@ SensorDeviceImpl::SensorDeviceImpl(SensorDeviceCreateDesc* createDesc)
       Coordinates(SensorDevice::Coord_Sensor),
       HWCoordinates(SensorDevice::Coord_HMD), // HW reports HMD coordinates by default.
       NextKeepAliveTickSeconds(0),
+      KeepAliveDelta(KeepAliveMinDelta),
+      KeepAliveDue(false),
+      LastReportTime(0),
+      ReportWindowStart(0),
+      ReportWindowPackets(0),
+      ReportWindowSamples(0),
+      ReportWindowLost(0),
+      ReportRateChanged(true),
+      AutotuneEnabled(false),
+      AutotuneQuietWindows(0),
+      AutotuneFailedRate(0),
+      Idle(false),
+      ActiveReportRate(Sensor_DefaultReportRate),
+      ActiveAutotune(false),
       FullTimestamp(0),      
       MaxValidRange(SensorRangeImpl::GetMaxSensorRange()),
+      RawSamplesEnabled(false),
       magCalibrated(false)
 {
     SequenceValid   = false;
@@ -317,6 +371,9 @@ SensorDeviceImpl::SensorDeviceImpl(SensorDeviceCreateDesc* createDesc)
 
     PrevAbsoluteTime = 0.0;
 
+    RawSampleDropCount = 0;
+    PendingReportRate  = Sensor_DefaultReportRate;
+
 #ifdef OVR_OS_ANDROID
     pPhoneSensors = PhoneSensors::Create();
 #endif
@@ -326,6 +383,8 @@ SensorDeviceImpl::~SensorDeviceImpl()
 {
     // Check that Shutdown() was called.
     OVR_ASSERT(!pCreateDesc->pDevice);    
+
+    delete pRawSamples.Exchange_NoSync(0);
 }
 
 
@@ -382,8 +441,7 @@ void SensorDeviceImpl::openDevice()
     setReportRate(Sensor_DefaultReportRate);
 
     // Set Keep-alive at 10 seconds.
-    SensorKeepAliveImpl skeepAlive(10 * 1000);
-    GetInternalDevice()->SetFeatureReport(skeepAlive.Buffer, SensorKeepAliveImpl::PacketSize);
+    sendKeepAlive();
 
     // Load mag calibration
     MagCalibrationReport report;
@@ -399,6 +457,8 @@ void SensorDeviceImpl::closeDeviceOnError()
 {
     LogText("OVR::SensorDevice - Lost connection to '%s'\n", getHIDDesc()->Path.ToCStr());
     NextKeepAliveTickSeconds = 0;
+    KeepAliveDelta           = KeepAliveMinDelta;
+    KeepAliveDue             = false;
 }
 
 void SensorDeviceImpl::Shutdown()
@@ -408,7 +468,7 @@ void SensorDeviceImpl::Shutdown()
     LogText("OVR::SensorDevice - Closed '%s'\n", getHIDDesc()->Path.ToCStr());
 }
 
-void SensorDeviceImpl::OnInputReport(UByte* pData, UInt32 length)
+void SensorDeviceImpl::OnInputReport(UByte* pData, UInt32 length, double receiveTime)
 {
 
 	bool processed = false;
@@ -418,33 +478,235 @@ void SensorDeviceImpl::OnInputReport(UByte* pData, UInt32 length)
         if (decodeTrackerMessage(&message, pData, length))
         {
             processed = true;
-            onTrackerMessage(&message);
+            onTrackerMessage(&message, receiveTime);
         }
     }
 }
 
-double SensorDeviceImpl::OnTicks(double tickSeconds)
+void SensorDeviceImpl::OnInputReports(UByte* pReports, UInt32 reportStride,
+                                      const UInt32* lengths, const double* receiveTimes,
+                                      UInt32 count)
 {
-    if (tickSeconds >= NextKeepAliveTickSeconds)
+    double start = Timer::GetSeconds();
+    if (count)
+        ReadToDispatchCounter.Record(start - receiveTimes[0]);
+    HIDDevice::HIDHandler::OnInputReports(pReports, reportStride, lengths, receiveTimes, count);
+    double decodeTime = Timer::GetSeconds() - start;
+
+    if (count)
     {
-        // Use 3-seconds keep alive by default.
-        double keepAliveDelta = 3.0;
+        LastReportTime = receiveTimes[count - 1];
 
-        // Set Keep-alive at 10 seconds.
-        SensorKeepAliveImpl skeepAlive(10 * 1000);
-        // OnTicks is called from background thread so we don't need to add this to the command queue.
-        GetInternalDevice()->SetFeatureReport(skeepAlive.Buffer, SensorKeepAliveImpl::PacketSize);
+        {
+            Lock::Locker lock(&StatsLock);
+            ReportStats.LastDecodeTime   = decodeTime / count;
+            ReportStats.MaxDecodeTime    = Alg::Max(ReportStats.MaxDecodeTime, ReportStats.LastDecodeTime);
+            ReportStats.TotalDecodeTime += decodeTime;
+        }
+        updateReportStats(LastReportTime);
+    }
 
-		// Emit keep-alive every few seconds.
-        NextKeepAliveTickSeconds = tickSeconds + keepAliveDelta;
+    // The reports that were queued have been read, so the next one is a report
+    // period away.
+    if (KeepAliveDue)
+        sendKeepAlive();
+}
+
+double SensorDeviceImpl::OnTicks(double tickSeconds)
+{
+    return serviceKeepAlive(tickSeconds);
+}
+
+double SensorDeviceImpl::serviceKeepAlive(double tickSeconds)
+{
+    if (tickSeconds < NextKeepAliveTickSeconds)
+        return NextKeepAliveTickSeconds - tickSeconds;
+
+    // While reports stream, leave the keep-alive to the next OnInputReports,
+    // unless the report doesn't come in time.
+    bool streaming = (tickSeconds - LastReportTime) < KeepAliveStreamTimeout;
+    if (streaming && !KeepAliveDue)
+    {
+        KeepAliveDue             = true;
+        NextKeepAliveTickSeconds = tickSeconds + KeepAliveReportWait;
+        return KeepAliveReportWait;
     }
+
+    // OnTicks is called from background thread so we don't need to add this to the command queue.
+    sendKeepAlive();
     return NextKeepAliveTickSeconds - tickSeconds;
 }
 
+bool SensorDeviceImpl::writeKeepAlive()
+{
+    SensorKeepAliveImpl skeepAlive(KeepAliveTimeoutMs);
+    return GetInternalDevice()->SetFeatureReport(skeepAlive.Buffer, SensorKeepAliveImpl::PacketSize);
+}
+
+void SensorDeviceImpl::sendKeepAlive()
+{
+    double start    = Timer::GetSeconds();
+    bool   written  = writeKeepAlive();
+    double end      = Timer::GetSeconds();
+    double duration = end - start;
+
+    // Stretch the interval only while the device is evidently alive.
+    bool streaming = (start - LastReportTime) < KeepAliveStreamTimeout;
+    if (written && streaming)
+        KeepAliveDelta = Alg::Min(KeepAliveDelta + KeepAliveDeltaStep, KeepAliveMaxDelta);
+    else
+        KeepAliveDelta = KeepAliveMinDelta;
+
+    KeepAliveDue             = false;
+    NextKeepAliveTickSeconds = end + KeepAliveDelta;
+
+    Lock::Locker lock(&StatsLock);
+    KeepAliveStats.Count++;
+    if (!written)
+        KeepAliveStats.Failures++;
+    KeepAliveStats.Interval       = KeepAliveDelta;
+    KeepAliveStats.LastDuration   = duration;
+    KeepAliveStats.MaxDuration    = Alg::Max(KeepAliveStats.MaxDuration, duration);
+    KeepAliveStats.TotalDuration += duration;
+}
+
+bool SensorDeviceImpl::GetKeepAliveStats(SensorKeepAliveStats* stats) const
+{
+    Lock::Locker lock(&StatsLock);
+    *stats = KeepAliveStats;
+    return true;
+}
+
+void SensorDeviceImpl::countReportSamples(unsigned samples, unsigned lostSamples)
+{
+    // Samples skipped over by a rate change aren't lost.
+    if (ReportRateChanged)
+    {
+        ReportRateChanged = false;
+        lostSamples       = 0;
+    }
+
+    ReportWindowPackets++;
+    ReportWindowSamples += samples;
+    ReportWindowLost    += lostSamples;
+
+    Lock::Locker lock(&StatsLock);
+    ReportStats.Packets++;
+    ReportStats.Samples     += samples;
+    ReportStats.LostSamples += lostSamples;
+}
+
+void SensorDeviceImpl::updateReportStats(double now)
+{
+    double elapsed = now - ReportWindowStart;
+    if (elapsed < ReportStatsWindow)
+        return;
+
+    // The first window starts with the first report, or the first after a rate change.
+    bool firstWindow = (ReportWindowStart == 0);
+    if (!firstWindow)
+    {
+        Lock::Locker lock(&StatsLock);
+        ReportStats.PacketsPerSecond = ReportWindowPackets / elapsed;
+        ReportStats.SamplesPerPacket = ReportWindowPackets ?
+                                       (double)ReportWindowSamples / ReportWindowPackets : 0;
+    }
+
+    bool     lost = (ReportWindowLost > 0);
+    unsigned rate = ReportStats.ReportRate;
+
+    ReportWindowStart   = now;
+    ReportWindowPackets = 0;
+    ReportWindowSamples = 0;
+    ReportWindowLost    = 0;
+
+    if (firstWindow || !AutotuneEnabled || rate == 0)
+        return;
+
+    // Rates are Sensor_MaxReportRate divided by a packet interval of one or more
+    // milliseconds; step the interval.
+    unsigned interval = Sensor_MaxReportRate / rate;
+    if (lost)
+    {
+        AutotuneFailedRate   = AutotuneFailedRate ? Alg::Min(AutotuneFailedRate, rate) : rate;
+        AutotuneQuietWindows = 0;
+        if (interval < 256)
+            writeReportRate(Sensor_MaxReportRate / (interval + 1));
+    }
+    else if (++AutotuneQuietWindows >= ReportAutotuneQuietWindows && interval > 1)
+    {
+        AutotuneQuietWindows = 0;
+        unsigned higherRate  = Sensor_MaxReportRate / (interval - 1);
+        if (!AutotuneFailedRate || higherRate < AutotuneFailedRate)
+            writeReportRate(higherRate);
+    }
+}
+
+bool SensorDeviceImpl::GetReportStats(SensorReportStats* stats) const
+{
+    Lock::Locker lock(&StatsLock);
+    *stats = ReportStats;
+    return true;
+}
+
+bool SensorDeviceImpl::GetTimeSyncStats(SensorTimeSyncStats* stats)
+{
+    // The time filter is only used on the device thread.
+    if (GetCurrentThreadId() == GetDeviceThreadId())
+    {
+        return getTimeSyncStats(stats);
+    }
+
+    bool result;
+    if (!GetDeviceQueue()->
+            PushCallAndWaitResult(this, &SensorDeviceImpl::getTimeSyncStats, &result, stats))
+    {
+        return false;
+    }
+
+    return result;
+}
+
+bool SensorDeviceImpl::getTimeSyncStats(SensorTimeSyncStats* stats)
+{
+    TimeFilter.GetStats(stats);
+    return true;
+}
+
+bool SensorDeviceImpl::SubmitReports(SensorReportBatch* batch)
+{
+    if (!batch->Begin())
+        return false;
+
+    // direct call if we are already on the device thread
+    if (GetCurrentThreadId() == GetDeviceThreadId())
+    {
+        batch->Execute(this);
+        return true;
+    }
+
+    // The command keeps the batch alive until it has run.
+    batch->AddRef();
+    if (!GetDeviceQueue()->PushCall(this, &SensorDeviceImpl::executeReports, batch))
+    {
+        batch->Fail();
+        batch->Release();
+        return false;
+    }
+    return true;
+}
+
+Void SensorDeviceImpl::executeReports(SensorReportBatch* batch)
+{
+    batch->Execute(this);
+    batch->Release();
+    return 0;
+}
+
 bool SensorDeviceImpl::SetRange(const SensorRange& range, bool waitFlag)
 {
     bool                 result = 0;
-    ThreadCommandQueue * threadQueue = GetManagerImpl()->GetThreadQueue();
+    ThreadCommandQueue * threadQueue = GetDeviceQueue();
 
     if (!waitFlag)
     {
@@ -485,7 +747,7 @@ bool SensorDeviceImpl::setRange(const SensorRange& range)
 void SensorDeviceImpl::SetCoordinateFrame(CoordinateFrame coordframe)
 { 
     // Push call with wait.
-    GetManagerImpl()->GetThreadQueue()->
+    GetDeviceQueue()->
         PushCall(this, &SensorDeviceImpl::setCoordinateFrame, coordframe, true);
 }
 
@@ -526,9 +788,31 @@ Void SensorDeviceImpl::setCoordinateFrame(CoordinateFrame coordframe)
 
 void SensorDeviceImpl::SetReportRate(unsigned rateHz)
 { 
+    // Calls queued behind one another all apply the latest rate.
+    PendingReportRate.Store_Release(rateHz);
+    // Push call with wait.
+    GetDeviceQueue()->
+        PushCall(this, &SensorDeviceImpl::setPendingReportRate, true);
+}
+
+void SensorDeviceImpl::SetReportRateAutotune(bool enabled)
+{
+    // Push call with wait.
+    GetDeviceQueue()->
+        PushCall(this, &SensorDeviceImpl::setReportRateAutotune, enabled, true);
+}
+
+void SensorDeviceImpl::SetIdle(bool idle)
+{
+    // direct call if we are already on the device thread
+    if (GetCurrentThreadId() == GetDeviceThreadId())
+    {
+        setIdle(idle);
+        return;
+    }
     // Push call with wait.
-    GetManagerImpl()->GetThreadQueue()->
-        PushCall(this, &SensorDeviceImpl::setReportRate, rateHz, true);
+    GetDeviceQueue()->
+        PushCall(this, &SensorDeviceImpl::setIdle, idle, true);
 }
 
 unsigned SensorDeviceImpl::GetReportRate() const
@@ -545,24 +829,111 @@ unsigned SensorDeviceImpl::GetReportRate() const
 
 Void SensorDeviceImpl::setReportRate(unsigned rateHz)
 {
-    // Read the original configuration
-    SensorConfigImpl scfg;
-    if (GetInternalDevice()->GetFeatureReport(scfg.Buffer, SensorConfigImpl::PacketSize))
+    if (Idle)
+    {   // Takes effect once the sensor is in use again.
+        ActiveReportRate = rateHz;
+        ActiveAutotune   = false;
+        return 0;
+    }
+    AutotuneEnabled = false;
+    writeReportRate(rateHz);
+    return 0;
+}
+
+Void SensorDeviceImpl::setPendingReportRate()
+{
+    return setReportRate(PendingReportRate.Load_Acquire());
+}
+
+Void SensorDeviceImpl::setReportRateAutotune(bool enabled)
+{
+    if (Idle)
     {
-        scfg.Unpack();
+        ActiveAutotune = enabled;
+        return 0;
     }
+    AutotuneEnabled = enabled;
+    if (enabled)
+    {
+        // Start over from the top; conditions on the host may have changed.
+        AutotuneFailedRate   = 0;
+        AutotuneQuietWindows = 0;
+        writeReportRate(Sensor_MaxReportRate);
+    }
+    return 0;
+}
+
+Void SensorDeviceImpl::setIdle(bool idle)
+{
+    if (idle == Idle)
+        return 0;
+    Idle = idle;
 
+    if (idle)
+    {
+        // Autotune is held off, so that it doesn't step the idle rate.
+        ActiveReportRate = ReportStats.ReportRate;
+        ActiveAutotune   = AutotuneEnabled;
+        AutotuneEnabled  = false;
+        writeReportRate(Sensor_IdleReportRate);
+    }
+    else
+    {
+        AutotuneEnabled  = ActiveAutotune;
+        if (AutotuneEnabled)
+        {
+            AutotuneFailedRate   = 0;
+            AutotuneQuietWindows = 0;
+        }
+        writeReportRate(AutotuneEnabled ? (unsigned)Sensor_MaxReportRate : ActiveReportRate);
+    }
+
+    LogText("OVR::SensorDevice - %s, reporting at %u Hz.\n",
+            idle ? "idle" : "in use", ReportStats.ReportRate);
+    return 0;
+}
+
+unsigned SensorDeviceImpl::writeReportRate(unsigned rateHz)
+{
     if (rateHz > Sensor_MaxReportRate)
         rateHz = Sensor_MaxReportRate;
     else if (rateHz == 0)
         rateHz = Sensor_DefaultReportRate;
 
-    scfg.PacketInterval = UInt16((Sensor_MaxReportRate / rateHz) - 1);
+    UInt16 packetInterval = UInt16((Sensor_MaxReportRate / rateHz) - 1);
+
+    // ReportStats.ReportRate is that of the last successful write, or 0; if the
+    // device already has this rate, neither write it nor restart the statistics.
+    if (ReportStats.ReportRate == Sensor_MaxReportRate / (packetInterval + 1u))
+    {
+        Lock::Locker lock(&StatsLock);
+        ReportStats.Autotune = AutotuneEnabled;
+        return ReportStats.ReportRate;
+    }
+
+    // Read the original configuration
+    SensorConfigImpl scfg;
+    if (GetInternalDevice()->GetFeatureReport(scfg.Buffer, SensorConfigImpl::PacketSize))
+    {
+        scfg.Unpack();
+    }
+
+    scfg.PacketInterval = packetInterval;
 
     scfg.Pack();
 
-    GetInternalDevice()->SetFeatureReport(scfg.Buffer, SensorConfigImpl::PacketSize);
-    return 0;
+    unsigned actualRate = 0;
+    if (GetInternalDevice()->SetFeatureReport(scfg.Buffer, SensorConfigImpl::PacketSize))
+        actualRate = Sensor_MaxReportRate / (scfg.PacketInterval + 1);
+
+    // Start the statistics window over at the new rate.
+    ReportRateChanged   = true;
+    ReportWindowStart   = 0;
+
+    Lock::Locker lock(&StatsLock);
+    ReportStats.ReportRate = actualRate;
+    ReportStats.Autotune   = AutotuneEnabled;
+    return actualRate;
 }
 
 void SensorDeviceImpl::GetFactoryCalibration(Vector3f* AccelOffset, Vector3f* GyroOffset,
@@ -584,7 +955,7 @@ bool SensorDeviceImpl::IsMagCalibrated()
 void SensorDeviceImpl::SetOnboardCalibrationEnabled(bool enabled)
 {
     // Push call with wait.
-    GetManagerImpl()->GetThreadQueue()->
+    GetDeviceQueue()->
         PushCall(this, &SensorDeviceImpl::setOnboardCalibrationEnabled, enabled, true);
 }
 
@@ -626,13 +997,9 @@ void SensorDeviceImpl::AddMessageHandler(MessageHandler* handler)
 Vector3f AccelFromBodyFrameUpdate(const TrackerSensors& update, UByte sampleNumber,
                                   bool convertHMDToSensor = false)
 {
-    const TrackerSample& sample = update.Samples[sampleNumber];
-    float                ax = (float)sample.AccelX;
-    float                ay = (float)sample.AccelY;
-    float                az = (float)sample.AccelZ;
-
-    Vector3f val = convertHMDToSensor ? Vector3f(ax, az, -ay) :  Vector3f(ax, ay, az);
-    return val * 0.0001f;
+    // Samples are already scaled by 0.0001.
+    const Vector3f& a = update.Samples[sampleNumber].Accel;
+    return convertHMDToSensor ? Vector3f(a.x, a.z, -a.y) : a;
 }
 
 
@@ -654,18 +1021,13 @@ Vector3f MagFromBodyFrameUpdate(const TrackerSensors& update,
 Vector3f EulerFromBodyFrameUpdate(const TrackerSensors& update, UByte sampleNumber,
                                   bool convertHMDToSensor = false)
 {
-    const TrackerSample& sample = update.Samples[sampleNumber];
-    float                gx = (float)sample.GyroX;
-    float                gy = (float)sample.GyroY;
-    float                gz = (float)sample.GyroZ;
-
-    Vector3f val = convertHMDToSensor ? Vector3f(gx, gz, -gy) :  Vector3f(gx, gy, gz);
-    return val * 0.0001f;
+    const Vector3f& g = update.Samples[sampleNumber].Gyro;
+    return convertHMDToSensor ? Vector3f(g.x, g.z, -g.y) : g;
 }
 
 bool  SensorDeviceImpl::decodeTrackerMessage(TrackerMessage* message, UByte* buffer, int size)
 {
-    memset(message, 0, sizeof(TrackerMessage));
+    *message = TrackerMessage();
 
     if (size < 4)
     {
@@ -687,7 +1049,7 @@ bool  SensorDeviceImpl::decodeTrackerMessage(TrackerMessage* message, UByte* buf
     return (message->Type < TrackerMessage_Unknown) && (message->Type != TrackerMessage_None);
 }
 
-void SensorDeviceImpl::onTrackerMessage(TrackerMessage* message)
+void SensorDeviceImpl::onTrackerMessage(TrackerMessage* message, double receiveTime)
 {
     if (message->Type != TrackerMessage_Sensors)
         return;
@@ -699,8 +1061,13 @@ void SensorDeviceImpl::onTrackerMessage(TrackerMessage* message)
     // by the time we get the message if there are multiple samples.
     int             timestampAdjust = (s.SampleCount > 0) ? s.SampleCount-1 : 0;
 
-    const double now                 = Timer::GetSeconds();
+    const double now                 = receiveTime;
     double       absoluteTimeSeconds = 0.0;
+
+    // Body frames of this report, handed to handlers together at the end.
+    MessageBodyFrame frames[MaxBodyFramesPerReport];
+    unsigned         frameCount = 0;
+    unsigned         lostSamples = 0;
     
 
     if (SequenceValid)
@@ -726,11 +1093,14 @@ void SensorDeviceImpl::onTrackerMessage(TrackerMessage* message)
         scaledTimeUnit      = TimeFilter.ScaleTimeUnit(timeUnit);
         PrevAbsoluteTime    = absoluteTimeSeconds;
         
+        if (timestampDelta > LastSampleCount)
+            lostSamples = timestampDelta - LastSampleCount;
+
         // If we missed a small number of samples, generate the sample that would have immediately
         // proceeded the current one. Re-use the IMU values from the last processed sample.
         if ((timestampDelta > LastSampleCount) && (timestampDelta <= 254))
         {
-            if (HandlerRef.HasHandlers())
+            if (hasBodyFrameConsumers())
             {
                 MessageBodyFrame sensors(this);
 
@@ -741,7 +1111,7 @@ void SensorDeviceImpl::onTrackerMessage(TrackerMessage* message)
                 sensors.MagneticField       = LastMagneticField;
                 sensors.Temperature         = LastTemperature;
 
-                HandlerRef.Call(sensors);
+                frames[frameCount++] = sensors;
             }
         }
     }
@@ -765,6 +1135,7 @@ void SensorDeviceImpl::onTrackerMessage(TrackerMessage* message)
 
     LastSampleCount = s.SampleCount;
     LastTimestamp   = s.Timestamp;
+    countReportSamples(s.SampleCount, lostSamples);
 
     bool convertHMDToSensor = (Coordinates == Coord_Sensor) && (HWCoordinates == Coord_HMD);
 	
@@ -774,7 +1145,7 @@ void SensorDeviceImpl::onTrackerMessage(TrackerMessage* message)
     convertHMDToSensor = false;
 #endif
 
-    if (HandlerRef.HasHandlers())
+    if (hasBodyFrameConsumers())
     {
         MessageBodyFrame sensors(this);
         UByte            iterations = s.SampleCount;
@@ -800,11 +1171,13 @@ void SensorDeviceImpl::onTrackerMessage(TrackerMessage* message)
             replaceWithPhoneMag(&(sensors.MagneticField));
 #endif
             sensors.Temperature   = s.Temperature * 0.01f;
-            HandlerRef.Call(sensors);
+            frames[frameCount++] = sensors;
             // TimeDelta for the last two sample is always fixed.
             sensors.TimeDelta = (float)scaledTimeUnit;
         }
 
+        deliverBodyFrames(frames, frameCount, receiveTime);
+
         LastAcceleration = sensors.Acceleration;
         LastRotationRate = sensors.RotationRate;
         LastMagneticField= sensors.MagneticField;
@@ -907,7 +1280,7 @@ bool SensorDeviceImpl::SetMagCalibrationReport(const MagCalibrationReport &data)
         JSON* version = root->GetFirstItem();
         if (version && version->Name == "Oculus Device Profile Version")
         {   
-            int major = atoi(version->Value.ToCStr());
+            int major = version->GetMajorVersion();
             if (major > MAX_DEVICE_PROFILE_MAJOR_VERSION)
             {
                 // don't use the file on unsupported major version number
@@ -1018,7 +1391,7 @@ bool SensorDeviceImpl::GetMagCalibrationReport(MagCalibrationReport* data)
     JSON* version = root->GetFirstItem();
     if (version && version->Name == "Oculus Device Profile Version")
     {   
-        int major = atoi(version->Value.ToCStr());
+        int major = version->GetMajorVersion();
         if (major > MAX_DEVICE_PROFILE_MAJOR_VERSION)
             return false;   // don't parse the file on unsupported major version number
     }
@@ -1054,12 +1427,18 @@ bool SensorDeviceImpl::GetMagCalibrationReport(MagCalibrationReport* data)
                         if (name && name->Value == calibrationName)
                         {   // found a calibration with this name
                             
-                            int major = 0;
+                            int major = 0, minor = 0;
                             JSON* version = calibration->GetItemByName("Version");
                             if (version)
-                                major = atoi(version->Value.ToCStr());
+                            {
+                                major = version->GetMajorVersion();
+                                minor = version->GetMinorVersion();
+                            }
 
-                            if (major > data->Version && major <= 2)
+                            // Newer than data's version, and at most 2.0, the
+                            // version SetMagCalibrationReport writes.
+                            if ((major > data->Version || (major == data->Version && minor > 0)) &&
+                                (major < 2 || (major == 2 && minor == 0)))
                             {
                                 time_t now;
                                 time(&now);
@@ -1118,11 +1497,61 @@ bool SensorDeviceImpl::GetMagCalibrationReport(MagCalibrationReport* data)
     return true;
 }
 
+void SensorDeviceImpl::EnableRawSampleStream(bool enable)
+{
+    if (enable && !pRawSamples)
+    {
+        // Another thread may race us to create the buffer; keep whichever wins.
+        RawSampleBuffer* buffer = new RawSampleBuffer;
+        if (!pRawSamples.CompareAndSet_Sync(0, buffer))
+            delete buffer;
+    }
+    RawSamplesEnabled = enable;
+}
+
+bool SensorDeviceImpl::PopRawSample(MessageBodyFrame* frame)
+{
+    RawSampleBuffer* buffer = pRawSamples;
+    return buffer && buffer->Pop(frame);
+}
+
+UInt32 SensorDeviceImpl::GetRawSampleDropCount() const
+{
+    return RawSampleDropCount.Load_Acquire();
+}
+
+void SensorDeviceImpl::deliverBodyFrames(const MessageBodyFrame* frames, unsigned count,
+                                         double receiveTime)
+{
+    if (count == 0)
+        return;
+
+    SampleToReceiveCounter.Record(receiveTime - frames[count - 1].AbsoluteTimeSeconds);
+
+    if (RawSamplesEnabled)
+    {
+        RawSampleBuffer* buffer = pRawSamples;
+        for (unsigned i = 0; i < count; i++)
+        {
+            if (!buffer || !buffer->Push(frames[i]))
+                RawSampleDropCount.Increment_NoSync();
+        }
+    }
+    if (HandlerRef.HasHandlers(Message_BodyFrame) || HandlerRef.HasHandlers(Message_BodyFrameBatch))
+        HandlerRef.CallBodyFrames(MessageBodyFrameBatch(this, frames, count, receiveTime));
+}
+
 
 bool SensorDeviceImpl::SetSerialReport(const SerialReport& data)
 { 
+    // direct call if we are already on the device thread
+    if (GetCurrentThreadId() == GetDeviceThreadId())
+    {
+        return setSerialReport(data);
+    }
+
 	bool result;
-	if (!GetManagerImpl()->GetThreadQueue()->
+	if (!GetDeviceQueue()->
             PushCallAndWaitResult(this, &Sensor2DeviceImpl::setSerialReport, &result, data))
 	{
 		return false;
@@ -1139,8 +1568,14 @@ bool SensorDeviceImpl::setSerialReport(const SerialReport& data)
 
 bool SensorDeviceImpl::GetSerialReport(SerialReport* data)
 {
+    // direct call if we are already on the device thread
+    if (GetCurrentThreadId() == GetDeviceThreadId())
+    {
+        return getSerialReport(data);
+    }
+
 	bool result;
-	if (!GetManagerImpl()->GetThreadQueue()->
+	if (!GetDeviceQueue()->
             PushCallAndWaitResult(this, &Sensor2DeviceImpl::getSerialReport, &result, data))
 	{
 		return false;
@@ -1162,4 +1597,82 @@ bool SensorDeviceImpl::getSerialReport(SerialReport* data)
     return false;
 }
 
+//-------------------------------------------------------------------------------------
+// ***** SensorReportBatch
+
+SensorReportBatch::SensorReportBatch()
+    : pHandler(0), Status(Status_New)
+{
+}
+
+SensorReportBatch::~SensorReportBatch()
+{
+    for (UPInt i = 0; i < Requests.GetSize(); i++)
+        delete Requests[i];
+}
+
+void SensorReportBatch::addRequest(Request* request)
+{
+    OVR_ASSERT(Status.Load_Acquire() == Status_New);
+    Requests.PushBack(request);
+}
+
+bool SensorReportBatch::Wait(unsigned delay)
+{
+    if (IsDone())
+        return true;
+    return DoneEvent.Wait(delay);
+}
+
+bool SensorReportBatch::GetResult(UPInt i) const
+{
+    return IsDone() && i < Requests.GetSize() && Requests[i]->Result;
+}
+
+bool SensorReportBatch::Succeeded() const
+{
+    if (!IsDone())
+        return false;
+    for (UPInt i = 0; i < Requests.GetSize(); i++)
+    {
+        if (!Requests[i]->Result)
+            return false;
+    }
+    return true;
+}
+
+bool SensorReportBatch::Begin()
+{
+    return Status.CompareAndSet_Sync(Status_New, Status_Submitted);
+}
+
+void SensorReportBatch::Execute(SensorDevice* device)
+{
+    for (UPInt i = 0; i < Requests.GetSize(); i++)
+        Requests[i]->Result = Requests[i]->Run(device);
+    complete();
+}
+
+void SensorReportBatch::Fail()
+{
+    complete();
+}
+
+void SensorReportBatch::complete()
+{
+    // The submitter keeps a reference until this returns, so waiters may drop
+    // theirs as soon as the batch is marked done.
+    Status.Store_Release(Status_Done);
+    DoneEvent.SetEvent();
+    if (pHandler)
+        pHandler->OnReportsCompleted(this);
+}
+
+bool SensorDevice::SubmitReports(SensorReportBatch* batch)
+{
+    if (batch->Begin())
+        batch->Fail();
+    return false;
+}
+
 } // namespace OVR
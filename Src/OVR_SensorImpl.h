@@ -30,6 +30,7 @@ limitations under the License.
 #include "OVR_HIDDeviceImpl.h"
 #include "OVR_SensorTimeFilter.h"
 #include "OVR_Device.h"
+#include "Kernel/OVR_Lockless.h"
 
 #ifdef OVR_OS_ANDROID
 #include "OVR_PhoneSensors.h"
@@ -199,7 +200,10 @@ public:
     virtual void AddMessageHandler(MessageHandler* handler);
 
     // HIDDevice::Notifier interface.
-    virtual void OnInputReport(UByte* pData, UInt32 length);
+    virtual void OnInputReport(UByte* pData, UInt32 length, double receiveTime);
+    virtual void OnInputReports(UByte* pReports, UInt32 reportStride,
+                                const UInt32* lengths, const double* receiveTimes,
+                                UInt32 count);
     virtual double OnTicks(double tickSeconds);
 
     // HMD-Mounted sensor has a different coordinate frame.
@@ -227,6 +231,8 @@ public:
     // Note, this value may be different from the one provided for SetReportRate. The return
     // value will contain the actual rate.
     virtual unsigned    GetReportRate() const;
+    virtual void        SetReportRateAutotune(bool enabled);
+    virtual void        SetIdle(bool idle);
 
 	bool				SetSerialReport(const SerialReport& data);
     bool				GetSerialReport(SerialReport* data);
@@ -239,7 +245,26 @@ public:
     virtual bool		SetMagCalibrationReport(const MagCalibrationReport& data);
 	virtual bool		GetMagCalibrationReport(MagCalibrationReport* data);
 
+    virtual void        EnableRawSampleStream(bool enable);
+    virtual bool        PopRawSample(MessageBodyFrame* frame);
+    virtual UInt32      GetRawSampleDropCount() const;
+
+    virtual bool        SubmitReports(SensorReportBatch* batch);
+
+    virtual bool        GetKeepAliveStats(SensorKeepAliveStats* stats) const;
+    virtual bool        GetReportStats(SensorReportStats* stats) const;
+    virtual bool        GetTimeSyncStats(SensorTimeSyncStats* stats);
+
 protected:
+    // The device stops streaming this long after the last keep-alive.
+    enum { KeepAliveTimeoutMs = 10 * 1000 };
+
+    // Writes the keep-alive report; returns false if the transfer failed.
+    virtual bool    writeKeepAlive();
+    // Sends the keep-alive, updates its statistics and sets the next deadline.
+    void            sendKeepAlive();
+    // Keep-alive part of OnTicks; returns the seconds until it is due again.
+    double          serviceKeepAlive(double tickSeconds);
 
     virtual void    openDevice();
     void            closeDeviceOnError();
@@ -247,17 +272,42 @@ protected:
     Void            setCoordinateFrame(CoordinateFrame coordframe);
     bool            setRange(const SensorRange& range);
 
+    // Sets a fixed report rate, turning autotune off.
     Void            setReportRate(unsigned rateHz);
+    // Applies PendingReportRate, the rate of the latest SetReportRate.
+    Void            setPendingReportRate();
+    Void            setReportRateAutotune(bool enabled);
+    Void            setIdle(bool idle);
+    // Writes the rate to the device and returns the one it ends up with.
+    unsigned        writeReportRate(unsigned rateHz);
+    // Counts the samples of a decoded report; lostSamples were skipped before it.
+    void            countReportSamples(unsigned samples, unsigned lostSamples);
+    // Ends the statistics window if it is over, and steps the autotuned rate.
+    void            updateReportStats(double now);
 
     Void            setOnboardCalibrationEnabled(bool enabled);
+    Void            executeReports(SensorReportBatch* batch);
 
 	bool	        setSerialReport(const SerialReport& data);
     bool            getSerialReport(SerialReport* data);
+    bool            getTimeSyncStats(SensorTimeSyncStats* stats);
 
-    // Called for decoded messages
-    void			onTrackerMessage(TrackerMessage* message);
+    // Called for decoded messages; receiveTime is the report's arrival time.
+    void			onTrackerMessage(TrackerMessage* message, double receiveTime);
 	bool			decodeTrackerMessage(TrackerMessage* message, UByte* buffer, int size);
 
+    // True if a body frame built on the device thread has anyone to go to.
+    bool            hasBodyFrameConsumers() const
+    { return RawSamplesEnabled || HandlerRef.HasHandlers(Message_BodyFrame) ||
+             HandlerRef.HasHandlers(Message_BodyFrameBatch); }
+    // Most body frames one report can produce: its samples, plus one standing in
+    // for samples that were missed.
+    enum { MaxBodyFramesPerReport = 4 };
+    // Queues the frames on the raw sample stream, then passes them to message
+    // handlers as one batch; receiveTime is when the report carrying them was read.
+    void            deliverBodyFrames(const MessageBodyFrame* frames, unsigned count,
+                                      double receiveTime);
+
     // Helpers to reduce casting.
 /*
     SensorDeviceCreateDesc* getCreateDesc() const
@@ -273,6 +323,31 @@ protected:
     CoordinateFrame Coordinates;
     CoordinateFrame HWCoordinates;
     double      NextKeepAliveTickSeconds;
+    double      KeepAliveDelta;
+    // Set once the deadline has passed while a report is awaited.
+    bool        KeepAliveDue;
+    double      LastReportTime;
+    // Guards KeepAliveStats and ReportStats, which are read on other threads.
+    mutable Lock            StatsLock;
+    SensorKeepAliveStats    KeepAliveStats;
+    SensorReportStats       ReportStats;
+    AtomicInt<unsigned>     PendingReportRate;
+
+    // Current window of report statistics, and the autotune state.
+    double      ReportWindowStart;
+    UInt32      ReportWindowPackets;
+    UInt32      ReportWindowSamples;
+    UInt32      ReportWindowLost;
+    // The first report after a rate change is not counted as lost samples.
+    bool        ReportRateChanged;
+    bool        AutotuneEnabled;
+    unsigned    AutotuneQuietWindows;
+    // Lowest report rate that lost samples while autotuning, or 0.
+    unsigned    AutotuneFailedRate;
+    // While Idle, the rate and autotune setting to go back to.
+    bool        Idle;
+    unsigned    ActiveReportRate;
+    bool        ActiveAutotune;
 
     bool        SequenceValid;
     UInt16      LastTimestamp;
@@ -301,6 +376,15 @@ protected:
     SensorTimeFilter TimeFilter;
     double           PrevAbsoluteTime;
 
+    // Raw sample stream; the buffer is allocated on first enable and kept until the
+    // device is destroyed, so the device thread never sees it freed.
+    struct RawSampleBuffer : public LocklessRingBuffer<MessageBodyFrame, RawSampleStreamCapacity>,
+                             public NewOverrideBase
+    { };
+    AtomicPtr<RawSampleBuffer> pRawSamples;
+    volatile bool              RawSamplesEnabled;
+    AtomicInt<UInt32>          RawSampleDropCount;
+
 #ifdef OVR_OS_ANDROID
     void 	        replaceWithPhoneMag(Vector3f* val);
     PhoneSensors* 	pPhoneSensors;
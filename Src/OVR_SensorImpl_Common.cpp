@@ -27,6 +27,19 @@ limitations under the License.
 #include "OVR_SensorImpl_Common.h"
 #include "Kernel/OVR_Alg.h"
 
+#ifdef OVR_KERNEL_BENCHMARK
+#include "Kernel/OVR_Log.h"
+#include "OVR_SensorTrace.h"
+#endif
+
+#if defined(OVR_CPU_SSE) && (defined(__SSE2__) || defined(OVR_CPU_X86_64) || defined(OVR_OS_WIN32))
+#define OVR_SENSOR_UNPACK_SSE2
+#include <emmintrin.h>
+#elif defined(OVR_CPU_ARM_NEON)
+#define OVR_SENSOR_UNPACK_NEON
+#include <arm_neon.h>
+#endif
+
 namespace OVR 
 {
 
@@ -42,6 +55,72 @@ void UnpackSensor(const UByte* buffer, SInt32* x, SInt32* y, SInt32* z)
     *z = s.x = ((buffer[5] & 0x3F) << 15) | (buffer[6] << 7) | (buffer[7] >> 1);
 }
 
+// Each 8 bytes of a sample are a big-endian 64-bit word holding three 21-bit
+// signed fields in bits 63-43, 42-22 and 21-1. Shifting a field to the top and
+// then arithmetically back down by 43 sign extends it.
+void UnpackSensorSamples(const UByte* buffer, unsigned count, float scale, TrackerSample* samples)
+{
+#if defined(OVR_SENSOR_UNPACK_SSE2)
+
+    const __m128 s = _mm_set1_ps(scale);
+
+    for (unsigned i = 0; i < count; i++, buffer += 16)
+    {
+        // Accelerometer word in the low half, gyro word in the high half; byte
+        // swap each by swapping the bytes of every 16-bit word, then the words.
+        __m128i w = _mm_loadu_si128((const __m128i*)buffer);
+        w = _mm_or_si128(_mm_slli_epi16(w, 8), _mm_srli_epi16(w, 8));
+        w = _mm_shufflelo_epi16(w, _MM_SHUFFLE(0, 1, 2, 3));
+        w = _mm_shufflehi_epi16(w, _MM_SHUFFLE(0, 1, 2, 3));
+
+        // With a field in the top bits of a 64-bit lane, an arithmetic shift of the
+        // lane's high dword by 11 yields it; there is no 64-bit one in SSE2.
+        __m128i x = _mm_srai_epi32(w, 11);
+        __m128i y = _mm_srai_epi32(_mm_slli_epi64(w, 21), 11);
+        __m128i z = _mm_srai_epi32(_mm_slli_epi64(w, 42), 11);
+
+        // Gather the high dwords: {accel, gyro, accel, gyro} per axis.
+        x = _mm_shuffle_epi32(x, _MM_SHUFFLE(3, 1, 3, 1));
+        y = _mm_shuffle_epi32(y, _MM_SHUFFLE(3, 1, 3, 1));
+        z = _mm_shuffle_epi32(z, _MM_SHUFFLE(3, 1, 3, 1));
+
+        float xy[4], zz[4];
+        _mm_storeu_ps(xy, _mm_mul_ps(_mm_cvtepi32_ps(_mm_unpacklo_epi32(x, y)), s));
+        _mm_storeu_ps(zz, _mm_mul_ps(_mm_cvtepi32_ps(z), s));
+
+        samples[i].Accel = Vector3f(xy[0], xy[1], zz[0]);
+        samples[i].Gyro  = Vector3f(xy[2], xy[3], zz[1]);
+    }
+
+#elif defined(OVR_SENSOR_UNPACK_NEON)
+
+    for (unsigned i = 0; i < count; i++, buffer += 16)
+    {
+        // Accelerometer word in lane 0, gyro word in lane 1.
+        int64x2_t w = vreinterpretq_s64_u8(vrev64q_u8(vld1q_u8(buffer)));
+
+        float32x2_t x = vmul_n_f32(vcvt_f32_s32(vmovn_s64(vshrq_n_s64(w, 43))), scale);
+        float32x2_t y = vmul_n_f32(vcvt_f32_s32(vmovn_s64(vshrq_n_s64(vshlq_n_s64(w, 21), 43))), scale);
+        float32x2_t z = vmul_n_f32(vcvt_f32_s32(vmovn_s64(vshrq_n_s64(vshlq_n_s64(w, 42), 43))), scale);
+
+        samples[i].Accel = Vector3f(vget_lane_f32(x, 0), vget_lane_f32(y, 0), vget_lane_f32(z, 0));
+        samples[i].Gyro  = Vector3f(vget_lane_f32(x, 1), vget_lane_f32(y, 1), vget_lane_f32(z, 1));
+    }
+
+#else
+
+    for (unsigned i = 0; i < count; i++, buffer += 16)
+    {
+        SInt32 x, y, z;
+        UnpackSensor(buffer, &x, &y, &z);
+        samples[i].Accel = Vector3f((float)x, (float)y, (float)z) * scale;
+        UnpackSensor(buffer + 8, &x, &y, &z);
+        samples[i].Gyro  = Vector3f((float)x, (float)y, (float)z) * scale;
+    }
+
+#endif
+}
+
 void PackSensor(UByte* buffer, SInt32 x, SInt32 y, SInt32 z)
 {
     // Pack 3 32 bit integers into 8 bytes
@@ -242,4 +321,114 @@ void SensorKeepAliveImpl::Unpack()
     KeepAliveIntervalMs= Buffer[3] | (UInt16(Buffer[4]) << 8);
 }
 
+
+#ifdef OVR_KERNEL_BENCHMARK
+
+namespace SensorDecodeBenchmark {
+
+// A DK1 report carries up to three samples after its 8 byte header.
+enum { ReportSamples = 3, SampleBytes = 16, ReportBytes = ReportSamples * SampleBytes,
+       MaxReports = 4096 };
+
+#if defined(OVR_SENSOR_UNPACK_SSE2)
+static const char* UnpackName = "Sensor.UnpackSensorSamples(SSE2)";
+#elif defined(OVR_SENSOR_UNPACK_NEON)
+static const char* UnpackName = "Sensor.UnpackSensorSamples(NEON)";
+#else
+static const char* UnpackName = "Sensor.UnpackSensorSamples(scalar)";
+#endif
+
+// The decode the reports had before UnpackSensorSamples.
+static void unpackEach(const UByte* buffer, unsigned count, float scale, TrackerSample* samples)
+{
+    for (unsigned i = 0; i < count; i++, buffer += SampleBytes)
+    {
+        SInt32 x, y, z;
+        UnpackSensor(buffer, &x, &y, &z);
+        samples[i].Accel = Vector3f((float)x, (float)y, (float)z) * scale;
+        UnpackSensor(buffer + 8, &x, &y, &z);
+        samples[i].Gyro  = Vector3f((float)x, (float)y, (float)z) * scale;
+    }
+}
+
+struct DecodeReports
+{
+    const ArrayPOD<UByte>* Reports;
+    void                 (*Unpack)(const UByte* buffer, unsigned count, float scale, TrackerSample* samples);
+
+    void operator()()
+    {
+        TrackerSample samples[ReportSamples];
+        UPInt         count = Reports->GetSize() / ReportBytes;
+        for (UPInt i = 0; i < count; i++)
+        {
+            Unpack(&(*Reports)[i * ReportBytes], ReportSamples, 0.0001f, samples);
+            Benchmark::Consume((UPInt)(SInt32)(samples[i % ReportSamples].Gyro.x * 1e4f));
+        }
+    }
+};
+
+// Packs a value the way the tracker does, in units of 10^-4 in 21 bits.
+static SInt32 packValue(float value)
+{
+    const float limit = (float)((1 << 20) - 1);
+    return (SInt32)Alg::Clamp(value * 1e4f, -limit, limit);
+}
+
+} // namespace SensorDecodeBenchmark
+
+void RunSensorDecodeBenchmarks(const char* tracePath)
+{
+    using namespace SensorDecodeBenchmark;
+
+    SensorTracePlayer player;
+    if (!player.Open(tracePath))
+        return;
+
+    ArrayPOD<UByte>  reports;
+    MessageBodyFrame frame;
+    UPInt            sampleCount = 0;
+    while ((reports.GetSize() < MaxReports * ReportBytes) && player.ReadBodyFrame(&frame))
+    {
+        UPInt offset = reports.GetSize();
+        reports.Resize(offset + SampleBytes);
+        PackSensor(&reports[offset], packValue(frame.Acceleration.x), packValue(frame.Acceleration.y),
+                   packValue(frame.Acceleration.z));
+        PackSensor(&reports[offset + 8], packValue(frame.RotationRate.x), packValue(frame.RotationRate.y),
+                   packValue(frame.RotationRate.z));
+        sampleCount++;
+    }
+    // Only whole reports are decoded.
+    sampleCount -= sampleCount % ReportSamples;
+    reports.Resize(sampleCount * SampleBytes);
+    if (sampleCount == 0)
+    {
+        LogText("Benchmark: '%s' has no body frames to decode.\n", tracePath);
+        return;
+    }
+
+    UPInt mismatches = 0;
+    for (UPInt i = 0; i < reports.GetSize(); i += ReportBytes)
+    {
+        TrackerSample a[ReportSamples], b[ReportSamples];
+        UnpackSensorSamples(&reports[i], ReportSamples, 0.0001f, a);
+        unpackEach(&reports[i], ReportSamples, 0.0001f, b);
+        for (int j = 0; j < ReportSamples; j++)
+        {
+            if (!(a[j].Accel == b[j].Accel) || !(a[j].Gyro == b[j].Gyro))
+                mismatches++;
+        }
+    }
+    LogText("Benchmark: %u samples of '%s', %u decoded differently.\n",
+            (unsigned)sampleCount, tracePath, (unsigned)mismatches);
+
+    Benchmark     bench;
+    DecodeReports unpackSamples = { &reports, &UnpackSensorSamples };
+    DecodeReports unpackSensor  = { &reports, &unpackEach };
+    bench.Run(UnpackName,           sampleCount, unpackSamples);
+    bench.Run("Sensor.UnpackSensor", sampleCount, unpackSensor);
+}
+
+#endif // OVR_KERNEL_BENCHMARK
+
 } // namespace OVR
@@ -28,14 +28,22 @@ limitations under the License.
 #define OVR_SensorImpl_Common_h
 
 #include "Kernel/OVR_System.h"
+#include "Kernel/OVR_Benchmark.h"
 #include "OVR_Device.h"
 
 namespace OVR 
 {
 
+struct TrackerSample;
+
 void UnpackSensor(const UByte* buffer, SInt32* x, SInt32* y, SInt32* z);
 void PackSensor(UByte* buffer, SInt32 x, SInt32 y, SInt32 z);
 
+// Unpacks count IMU samples of a tracker report, each 16 bytes holding the packed
+// accelerometer and gyro values, converting them to float and multiplying by scale.
+// Uses SSE2 or NEON where available; results are the same as UnpackSensor's.
+void UnpackSensorSamples(const UByte* buffer, unsigned count, float scale, TrackerSample* samples);
+
 // Sensor HW only accepts specific maximum range values, used to maximize
 // the 16-bit sensor outputs. Use these ramps to specify and report appropriate values.
 const UInt16 AccelRangeRamp[] = { 2, 4, 8, 16 };
@@ -133,10 +141,11 @@ struct SensorKeepAliveImpl
     void Unpack();
 };
 
+// An IMU sample in the sensor's coordinate frame, already scaled to SI units.
 struct TrackerSample
 {
-    SInt32 AccelX, AccelY, AccelZ;
-    SInt32 GyroX, GyroY, GyroZ;
+    Vector3f Accel;
+    Vector3f Gyro;
 };
 
 enum LastCommandIdFlags
@@ -145,6 +154,14 @@ enum LastCommandIdFlags
     LastCommandId_LEDs    = 2
 };
 
+#ifdef OVR_KERNEL_BENCHMARK
+// Times UnpackSensorSamples against decoding each value with UnpackSensor, on the
+// IMU samples of a trace recorded with OVR_SENSOR_TRACE packed into DK1 reports,
+// with the Benchmark harness of RunKernelBenchmarks. Also logs whether the two
+// decode every sample the same. Call after System::Init.
+void RunSensorDecodeBenchmarks(const char* tracePath);
+#endif
+
 } // namespace OVR
 
 #endif // OVR_SensorImpl_Common_h
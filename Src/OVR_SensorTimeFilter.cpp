@@ -27,7 +27,9 @@ limitations under the License.
 ************************************************************************************/
 
 #include "OVR_SensorTimeFilter.h"
+#include "OVR_Device.h"
 #include "Kernel/OVR_Log.h"
+#include "Kernel/OVR_PerfCounters.h"
 
 
 #include <stdio.h>
@@ -86,14 +88,26 @@ SensorTimeFilter::SensorTimeFilter(const Settings& settings)
     MinWindowDuration    = 0; // assigned later
     MinWindowLastTime    = 0;
     MinWindowSamples     = settings.MinSamples; // Force initialization
+    MinWindowClockDelta    = 0;
+    MinWindowMaxClockDelta = 0;
+
+    StatsWindows = 0;
+    StatsResets  = 0;
+    LastJitter   = 0;
+    MaxJitter    = 0;
+    JitterSum    = 0;
 
     OVR_TIMEFILTER_LOG_CODE( pTFLogFile = fopen(OVR_TIMEFILTER_LOG_FILENAME, "w+"); )
 }
 
 
+static PerfCounter SampleToSystemTimeCounter("perf.timeFilter.sampleToSystemTime");
+
 double SensorTimeFilter::SampleToSystemTime(double sampleDeviceTime, double systemTime,
                                             double prevResult, const char* debugTag)
 {
+    PerfCounterScope perfScope(SampleToSystemTimeCounter);
+
     double clockDelta      = systemTime - sampleDeviceTime + FilterSettings.ClockDeltaAdjust;
     double deviceTimeDelta = sampleDeviceTime - LastLargestDeviceTime;       
     double result;
@@ -125,6 +139,7 @@ double SensorTimeFilter::SampleToSystemTime(double sampleDeviceTime, double syst
             {
                 OVR_DEBUG_LOG(("SensorTimeFilter - Filtering reset due to samples in the past!\n"));
                 initClockSampling(sampleDeviceTime, clockDelta);
+                StatsResets++;
                 // Fall through to below, to ' PastSampleResetTime = 0.0; '
             }
             else
@@ -141,6 +156,8 @@ double SensorTimeFilter::SampleToSystemTime(double sampleDeviceTime, double syst
             // Pick minimum ClockDelta sample.
             if (clockDelta < MinWindowClockDelta)
                 MinWindowClockDelta = clockDelta;
+            if (clockDelta > MinWindowMaxClockDelta)
+                MinWindowMaxClockDelta = clockDelta;
             MinWindowSamples++;        
         }
         else
@@ -239,6 +256,7 @@ void SensorTimeFilter::initClockSampling(double sampleDeviceTime, double clockDe
     MinWindowsCollected          = 0;
     MinWindowDuration            = 0.25;
     MinWindowClockDelta          = clockDelta;
+    MinWindowMaxClockDelta       = clockDelta;
     MinWindowLastTime            = sampleDeviceTime + MinWindowDuration;
     MinWindowSamples             = 0;
 }
@@ -286,6 +304,8 @@ void SensorTimeFilter::processFinishedMinWindow(double sampleDeviceTime, double
         ClockDeltaCorrectSecondsLeft = 0;
         ClockDeltaCorrectPerSecond   = 0;
 
+        StatsResets++;
+
         // Reset buffers, we'll be collecting a new MinWindow.
         MinRecords.Reset();
         MinWindowsCollected = 0;
@@ -298,6 +318,13 @@ void SensorTimeFilter::processFinishedMinWindow(double sampleDeviceTime, double
 
         double timeElapsed = 0;
 
+        // The spread of ClockDelta in the window is how much the delivery of its
+        // samples was delayed beyond the fastest one.
+        LastJitter = MinWindowMaxClockDelta - MinWindowClockDelta;
+        MaxJitter  = Alg::Max(MaxJitter, LastJitter);
+        JitterSum += LastJitter;
+        StatsWindows++;
+
         // If we have older values, use them to update clock drift in 
         // ClockDeltaDriftPerSecond
         if (!MinRecords.IsEmpty() && (sampleDeviceTime > OldClockDeltaDriftExpire))
@@ -375,9 +402,23 @@ void SensorTimeFilter::processFinishedMinWindow(double sampleDeviceTime, double
     if (MinWindowsCollected > 5)
         MinWindowDuration = 0.5; 
 
-    MinWindowClockDelta = clockDelta;
-    MinWindowLastTime   = sampleDeviceTime + MinWindowDuration;
-    MinWindowSamples    = 0;
+    MinWindowClockDelta    = clockDelta;
+    MinWindowMaxClockDelta = clockDelta;
+    MinWindowLastTime      = sampleDeviceTime + MinWindowDuration;
+    MinWindowSamples       = 0;
+}
+
+
+void SensorTimeFilter::GetStats(SensorTimeSyncStats* stats) const
+{
+    stats->ClockDelta          = ClockDelta;
+    stats->DriftPerSecond      = ClockDeltaDriftPerSecond;
+    stats->CorrectionPerSecond = (ClockDeltaCorrectSecondsLeft > 0.000001) ? ClockDeltaCorrectPerSecond : 0;
+    stats->LastJitter          = LastJitter;
+    stats->MeanJitter          = StatsWindows ? JitterSum / StatsWindows : 0;
+    stats->MaxJitter           = MaxJitter;
+    stats->Windows             = StatsWindows;
+    stats->Resets              = StatsResets;
 }
 
 
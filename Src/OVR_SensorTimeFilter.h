@@ -32,6 +32,8 @@ limitations under the License.
 #include "Kernel/OVR_Types.h"
 
 namespace OVR {  
+
+struct SensorTimeSyncStats;
     
 
 //-----------------------------------------------------------------------------------
@@ -123,6 +125,9 @@ public:
 
     // Return currently estimated difference between the clocks.
     double GetClockDelta() const { return ClockDelta; }
+
+    // Reports the drift and jitter estimates, to monitor the quality of the sync.
+    void   GetStats(SensorTimeSyncStats* stats) const;
     
 
 private:
@@ -151,46 +156,43 @@ private:
     // Oldest value here is used to help estimate drift.
     class MinRecordBuffer
     {
-        enum { BufferSize = 60*6 }; // 3 min
+        // Storage is a power of two, so that indices wrap with a mask.
+        enum
+        {
+            MaxRecords = 60*6 - 1, // 3 min
+            BufferSize = 512,
+            IndexMask  = BufferSize - 1
+        };
     public:
 
-        MinRecordBuffer() : Head(0), Tail(0) { }
+        MinRecordBuffer() : Head(0), Count(0) { }
 
-        void      Reset()         { Head = Tail = 0; }
-        bool      IsEmpty() const { return Head == Tail; }
+        void      Reset()         { Head = Count = 0; }
+        bool      IsEmpty() const { return Count == 0; }
 
         const MinRecord& GetOldest() const
         {
             OVR_ASSERT(!IsEmpty());
-            return Records[Tail];
+            return Records[(Head - Count) & IndexMask];
         }
         const MinRecord& GetNewest() const
         {
             OVR_ASSERT(!IsEmpty());
-            return Records[(BufferSize + Head - 1) % BufferSize];
+            return Records[(Head - 1) & IndexMask];
         }
 
         void     AddRecord(const MinRecord& rec)
         {
             Records[Head] = rec;
-            Head = advanceIndex(Head);
-            if (Head == Tail)
-                Tail = advanceIndex(Tail);
+            Head = (Head + 1) & IndexMask;
+            if (Count < MaxRecords)
+                Count++;
         }
 
     private:
-
-        static int advanceIndex(int index)
-        {
-            index++;
-            if (index >= BufferSize)
-                index = 0;
-            return index;
-        }
-
         MinRecord Records[BufferSize];
         int       Head;  // Location we will most recent entry, unused.
-        int       Tail;  // Oldest entry.
+        int       Count; // Entries before Head.
     };
 
 
@@ -215,8 +217,17 @@ private:
     double      MinWindowDuration; // Device sample seconds
     double      MinWindowLastTime;
     double      MinWindowClockDelta;
+    // Largest ClockDelta of the window; its distance from the minimum is the jitter.
+    double      MinWindowMaxClockDelta;
     int         MinWindowSamples;
 
+    // Statistics reported by GetStats.
+    UInt32      StatsWindows;
+    UInt32      StatsResets;
+    double      LastJitter;
+    double      MaxJitter;
+    double      JitterSum;
+
     // Historic buffer used to determine rate of clock change over time.
     MinRecordBuffer MinRecords;
 };
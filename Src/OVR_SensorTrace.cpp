@@ -0,0 +1,425 @@
+/************************************************************************************
+
+Filename    :   OVR_SensorTrace.cpp
+Content     :   Recording of sensor message streams and their deterministic playback
+Created     :   October 14, 2026
+Notes       :   
+
+Copyright   :   Copyright 2014 Oculus VR, Inc. All Rights reserved.
+
+Licensed under the Oculus VR Rift SDK License Version 3.1 (the "License");
+you may not use the Oculus VR Rift SDK except in compliance with the License,
+which is provided at the time of installation or download, or which
+otherwise accompanies this software in either electronic or hard copy form.
+
+You may obtain a copy of the License at
+
+http://www.oculusvr.com/licenses/LICENSE-3.1
+
+Unless required by applicable law or agreed to in writing, the Oculus VR SDK
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+*************************************************************************************/
+
+#include "OVR_SensorTrace.h"
+#include "OVR_SensorFusion.h"
+#include "Kernel/OVR_SysFile.h"
+#include "Kernel/OVR_Alg.h"
+#include "Kernel/OVR_Log.h"
+#include "Kernel/OVR_Timer.h"
+
+namespace OVR {
+
+// "OVRT", little-endian.
+static const UInt32 SensorTraceMagic   = 0x5452564F;
+static const UInt32 SensorTraceVersion = 1;
+
+static const UPInt  RecordHeaderSize      = 3;
+static const UPInt  BodyFrameSize         = 11 * 4 + 8;
+static const UPInt  ExposureFrameSize     = 1 + 4 + 8;
+static const UPInt  PositionReportSize    = 6 + 7 * 8;
+static const UPInt  MaxPositionReports    = (0xFFFF - 3) / PositionReportSize;
+
+static UByte* encodeVector3f(UByte* p, const Vector3f& v)
+{
+    Alg::EncodeFloat(p, v.x);
+    Alg::EncodeFloat(p + 4, v.y);
+    Alg::EncodeFloat(p + 8, v.z);
+    return p + 12;
+}
+
+static UByte* encodeVector3d(UByte* p, const Vector3d& v)
+{
+    Alg::EncodeDouble(p, v.x);
+    Alg::EncodeDouble(p + 8, v.y);
+    Alg::EncodeDouble(p + 16, v.z);
+    return p + 24;
+}
+
+static const UByte* decodeVector3f(const UByte* p, Vector3f* v)
+{
+    v->x = Alg::DecodeFloat(p);
+    v->y = Alg::DecodeFloat(p + 4);
+    v->z = Alg::DecodeFloat(p + 8);
+    return p + 12;
+}
+
+static const UByte* decodeVector3d(const UByte* p, Vector3d* v)
+{
+    v->x = Alg::DecodeDouble(p);
+    v->y = Alg::DecodeDouble(p + 8);
+    v->z = Alg::DecodeDouble(p + 16);
+    return p + 24;
+}
+
+static void decodeBodyFrame(const UByte* payload, MessageBodyFrame* msg)
+{
+    const UByte* p = decodeVector3f(payload, &msg->Acceleration);
+    p = decodeVector3f(p, &msg->RotationRate);
+    p = decodeVector3f(p, &msg->MagneticField);
+    msg->Temperature         = Alg::DecodeFloat(p);
+    msg->TimeDelta           = Alg::DecodeFloat(p + 4);
+    msg->AbsoluteTimeSeconds = Alg::DecodeDouble(p + 8);
+}
+
+
+//-------------------------------------------------------------------------------------
+// ***** SensorTraceWriter
+
+SensorTraceWriter::SensorTraceWriter()
+{
+}
+
+SensorTraceWriter::~SensorTraceWriter()
+{
+    Stop();
+}
+
+bool SensorTraceWriter::Start(SensorDevice* sensor, const char* path)
+{
+    Stop();
+    if (!sensor)
+        return false;
+
+    // Small records are gathered by the buffer, and written by the background thread.
+    bool append = (TracePath == path);
+    pFile = *new SysFile(path, File::Open_Write | File::Open_Create |
+                               (append ? 0 : File::Open_Truncate) |
+                               File::Open_Buffered | File::Open_WriteBehind);
+    if (!pFile->IsValid())
+    {
+        LogError("OVR::SensorTraceWriter - can't write '%s'\n", path);
+        pFile.Clear();
+        return false;
+    }
+    TracePath = path;
+
+    // A trace left without its header, or removed meanwhile, is started over.
+    if (append && pFile->GetLength() >= 8)
+    {
+        pFile->SeekToEnd();
+    }
+    else
+    {
+        UByte header[8];
+        Alg::EncodeUInt32(header, SensorTraceMagic);
+        Alg::EncodeUInt32(header + 4, SensorTraceVersion);
+        pFile->Write(header, sizeof(header));
+    }
+
+    Array<PositionCalibrationReport> reports;
+    if (!sensor->GetAllPositionCalibrationReports(&reports))
+        reports.Clear();
+    if (reports.GetSize() > MaxPositionReports)
+        reports.Resize(MaxPositionReports);
+
+    Array<UByte> calibration;
+    calibration.Resize(3 + reports.GetSize() * PositionReportSize);
+    UByte* p = &calibration[0];
+    p[0] = sensor->IsMagCalibrated() ? 1 : 0;
+    Alg::EncodeUInt16(p + 1, (UInt16)reports.GetSize());
+    p += 3;
+    for (UPInt i = 0; i < reports.GetSize(); i++)
+    {
+        const PositionCalibrationReport& report = reports[i];
+        p[0] = report.Version;
+        p[1] = (UByte)report.PositionType;
+        Alg::EncodeUInt16(p + 2, report.PositionIndex);
+        Alg::EncodeUInt16(p + 4, report.NumPositions);
+        p = encodeVector3d(p + 6, report.Position);
+        p = encodeVector3d(p, report.Normal);
+        Alg::EncodeDouble(p, report.Angle);
+        p += 8;
+    }
+    writeRecord(SensorTrace_Calibration, &calibration[0], calibration.GetSize());
+
+    sensor->AddMessageHandler(this);
+    return true;
+}
+
+void SensorTraceWriter::Stop()
+{
+    // Once removed, the handler is no longer being called.
+    RemoveHandlerFromDevices();
+    if (pFile)
+    {
+        pFile->Close();
+        pFile.Clear();
+    }
+}
+
+bool SensorTraceWriter::SupportsMessageType(MessageType type) const
+{
+    return (type == Message_BodyFrame || type == Message_BodyFrameBatch || type == Message_ExposureFrame);
+}
+
+void SensorTraceWriter::OnMessage(const Message& msg)
+{
+    if (!pFile)
+        return;
+
+    if (msg.Type == Message_BodyFrameBatch)
+    {
+        const MessageBodyFrameBatch& batch = static_cast<const MessageBodyFrameBatch&>(msg);
+        for (unsigned i = 0; i < batch.Count; i++)
+            writeBodyFrame(batch.pFrames[i]);
+    }
+    else if (msg.Type == Message_BodyFrame)
+    {
+        writeBodyFrame(static_cast<const MessageBodyFrame&>(msg));
+    }
+    else if (msg.Type == Message_ExposureFrame)
+    {
+        const MessageExposureFrame& exposure = static_cast<const MessageExposureFrame&>(msg);
+        UByte payload[ExposureFrameSize];
+        payload[0] = exposure.CameraPattern;
+        Alg::EncodeUInt32(payload + 1, exposure.CameraFrameCount);
+        Alg::EncodeDouble(payload + 5, exposure.CameraTimeSeconds);
+        writeRecord(SensorTrace_ExposureFrame, payload, sizeof(payload));
+    }
+}
+
+void SensorTraceWriter::writeBodyFrame(const MessageBodyFrame& msg)
+{
+    UByte  payload[BodyFrameSize];
+    UByte* p = encodeVector3f(payload, msg.Acceleration);
+    p = encodeVector3f(p, msg.RotationRate);
+    p = encodeVector3f(p, msg.MagneticField);
+    Alg::EncodeFloat(p, msg.Temperature);
+    Alg::EncodeFloat(p + 4, msg.TimeDelta);
+    Alg::EncodeDouble(p + 8, msg.AbsoluteTimeSeconds);
+    writeRecord(SensorTrace_BodyFrame, payload, sizeof(payload));
+}
+
+void SensorTraceWriter::writeRecord(UByte type, const UByte* payload, UPInt size)
+{
+    UByte header[RecordHeaderSize];
+    header[0] = type;
+    Alg::EncodeUInt16(header + 1, (UInt16)size);
+    pFile->Write(header, sizeof(header));
+    pFile->Write(payload, (int)size);
+}
+
+
+//-------------------------------------------------------------------------------------
+// ***** SensorTracePlayer
+
+SensorTracePlayer::SensorTracePlayer()
+    : TraceLength(0), Position(0), BodyFrameCount(0), FusionNanos(0)
+{
+}
+
+bool SensorTracePlayer::Open(const char* path)
+{
+    Close();
+    if (!TraceFile.Open(path))
+        return false;
+
+    const UByte* data = TraceFile.GetData();
+    if (TraceFile.GetLength() < 8 ||
+        Alg::DecodeUInt32(data) != SensorTraceMagic ||
+        Alg::DecodeUInt32(data + 4) != SensorTraceVersion)
+    {
+        LogError("OVR::SensorTracePlayer - '%s' isn't a sensor trace\n", path);
+        TraceFile.Close();
+        return false;
+    }
+
+    TraceLength = (UPInt)TraceFile.GetLength();
+    Rewind();
+    return true;
+}
+
+void SensorTracePlayer::Close()
+{
+    TraceFile.Close();
+    TraceLength    = 0;
+    Position       = 0;
+    BodyFrameCount = 0;
+    FusionNanos    = 0;
+}
+
+void SensorTracePlayer::Rewind()
+{
+    Position       = 8;
+    BodyFrameCount = 0;
+    FusionNanos    = 0;
+}
+
+bool SensorTracePlayer::IsAtEnd() const
+{
+    UByte        type;
+    const UByte* payload;
+    UPInt        size;
+    return !peekRecord(Position, &type, &payload, &size);
+}
+
+bool SensorTracePlayer::peekRecord(UPInt pos, UByte* type, const UByte** payload, UPInt* size) const
+{
+    if (!TraceFile.GetData())
+        return false;
+
+    if (pos + RecordHeaderSize > TraceLength)
+        return false;
+
+    const UByte* p = TraceFile.GetData() + pos;
+    *type    = p[0];
+    *size    = Alg::DecodeUInt16(p + 1);
+    *payload = p + RecordHeaderSize;
+    // A trace cut short while recording ends at its last whole record.
+    return pos + RecordHeaderSize + *size <= TraceLength;
+}
+
+// Records shorter than this version writes them are skipped, like unknown ones.
+static bool isTimedRecord(UByte type, UPInt size)
+{
+    return (type == SensorTrace_BodyFrame && size >= BodyFrameSize) ||
+           (type == SensorTrace_ExposureFrame && size >= ExposureFrameSize);
+}
+
+double SensorTracePlayer::GetNextTimeSeconds() const
+{
+    UByte        type;
+    const UByte* payload;
+    UPInt        size;
+
+    // Calibration records take effect at once, so look past them.
+    for (UPInt pos = Position; peekRecord(pos, &type, &payload, &size); pos += RecordHeaderSize + size)
+    {
+        if (isTimedRecord(type, size))
+        {
+            // Both end with their time.
+            UPInt timeOffset = (type == SensorTrace_BodyFrame ? BodyFrameSize : ExposureFrameSize) - 8;
+            return Alg::DecodeDouble(payload + timeOffset);
+        }
+    }
+    return -1.0;
+}
+
+bool SensorTracePlayer::PlayNext(SensorFusion* fusion)
+{
+    bool timed;
+    return playRecord(fusion, &timed);
+}
+
+bool SensorTracePlayer::playRecord(SensorFusion* fusion, bool* timed)
+{
+    UByte        type;
+    const UByte* payload;
+    UPInt        size;
+    if (!peekRecord(Position, &type, &payload, &size))
+        return false;
+    Position += RecordHeaderSize + size;
+
+    *timed = isTimedRecord(type, size);
+    if (*timed && type == SensorTrace_BodyFrame)
+    {
+        MessageBodyFrame msg;
+        decodeBodyFrame(payload, &msg);
+
+        UInt64 start = Timer::GetTicksNanos();
+        fusion->OnMessage(msg);
+        FusionNanos += Timer::GetTicksNanos() - start;
+        BodyFrameCount++;
+    }
+    else if (*timed)
+    {
+        MessageExposureFrame msg(NULL);
+        msg.CameraPattern     = payload[0];
+        msg.CameraFrameCount  = Alg::DecodeUInt32(payload + 1);
+        msg.CameraTimeSeconds = Alg::DecodeDouble(payload + 5);
+
+        fusion->OnMessage(msg);
+    }
+    else if (type == SensorTrace_Calibration && size >= 3 &&
+             size >= 3 + Alg::DecodeUInt16(payload + 1) * PositionReportSize)
+    {
+        bool  magCalibrated = payload[0] != 0;
+        UPInt count         = Alg::DecodeUInt16(payload + 1);
+
+        Array<PositionCalibrationReport> reports;
+        reports.Resize(count);
+        const UByte* p = payload + 3;
+        for (UPInt i = 0; i < count; i++)
+        {
+            PositionCalibrationReport& report = reports[i];
+            report.Version       = p[0];
+            report.PositionType  = (PositionCalibrationReport::PositionTypeEnum)p[1];
+            report.PositionIndex = Alg::DecodeUInt16(p + 2);
+            report.NumPositions  = Alg::DecodeUInt16(p + 4);
+            p = decodeVector3d(p + 6, &report.Position);
+            p = decodeVector3d(p, &report.Normal);
+            report.Angle = Alg::DecodeDouble(p);
+            p += 8;
+        }
+        fusion->SetSensorCalibration(reports, magCalibrated);
+    }
+    return true;
+}
+
+unsigned SensorTracePlayer::PlayUntil(SensorFusion* fusion, double absoluteTimeSeconds)
+{
+    unsigned count = 0;
+    for (;;)
+    {
+        double time = GetNextTimeSeconds();
+        if (time < 0.0 || time > absoluteTimeSeconds)
+            return count;
+
+        // Plays the records before the message as well.
+        bool timed = false;
+        while (!timed && playRecord(fusion, &timed))
+            count++;
+    }
+}
+
+unsigned SensorTracePlayer::PlayAll(SensorFusion* fusion)
+{
+    unsigned count = 0;
+    while (PlayNext(fusion))
+        count++;
+    return count;
+}
+
+bool SensorTracePlayer::ReadBodyFrame(MessageBodyFrame* frame)
+{
+    UByte        type;
+    const UByte* payload;
+    UPInt        size;
+    while (peekRecord(Position, &type, &payload, &size))
+    {
+        Position += RecordHeaderSize + size;
+        if (type == SensorTrace_BodyFrame && isTimedRecord(type, size))
+        {
+            decodeBodyFrame(payload, frame);
+            BodyFrameCount++;
+            return true;
+        }
+    }
+    return false;
+}
+
+} // namespace OVR
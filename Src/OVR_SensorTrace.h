@@ -0,0 +1,149 @@
+/************************************************************************************
+
+Filename    :   OVR_SensorTrace.h
+Content     :   Recording of sensor message streams and their deterministic playback
+Created     :   October 14, 2026
+Notes       :   
+
+Copyright   :   Copyright 2014 Oculus VR, Inc. All Rights reserved.
+
+Licensed under the Oculus VR Rift SDK License Version 3.1 (the "License");
+you may not use the Oculus VR Rift SDK except in compliance with the License,
+which is provided at the time of installation or download, or which
+otherwise accompanies this software in either electronic or hard copy form.
+
+You may obtain a copy of the License at
+
+http://www.oculusvr.com/licenses/LICENSE-3.1
+
+Unless required by applicable law or agreed to in writing, the Oculus VR SDK
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+*************************************************************************************/
+
+#ifndef OVR_SensorTrace_h
+#define OVR_SensorTrace_h
+
+#include "OVR_Device.h"
+#include "Kernel/OVR_File.h"
+#include "Kernel/OVR_MappedFile.h"
+
+// Setting the OVR_SENSOR_TRACE environment variable to a file path makes the C API
+// record the head tracker's messages to that file while its sensor is running.
+
+namespace OVR {
+
+class SensorFusion;
+
+// Sensor traces are a sequence of records following an 8 byte header (magic and
+// version), all little-endian. Each record is a type byte and a 16-bit payload
+// size, so that readers can skip records they don't know.
+enum SensorTraceRecordType
+{
+    SensorTrace_Calibration   = 1,  // Mag calibration flag, then position reports.
+    SensorTrace_BodyFrame     = 2,
+    SensorTrace_ExposureFrame = 3
+};
+
+
+//-------------------------------------------------------------------------------------
+// ***** SensorTraceWriter
+
+// Records the body frames, exposure frames and calibration of a sensor to a trace
+// file. The writer is installed as a message handler on the sensor; records are
+// only copied there, and written to the disk by a background thread, so the
+// device thread isn't slowed down.
+
+class SensorTraceWriter : public NewOverrideBase, public MessageHandler
+{
+public:
+    SensorTraceWriter();
+    ~SensorTraceWriter();
+
+    // Opens the trace file, records the sensor's calibration and starts recording
+    // its messages, stopping any previous recording. Starting again on the path
+    // recorded last, as when the sensor reconnects, appends to that trace; the new
+    // calibration record takes effect from there on when it is played.
+    bool            Start(SensorDevice* sensor, const char* path);
+    // Stops recording and writes out the rest of the trace.
+    void            Stop();
+
+    bool            IsRecording() const         { return pFile != 0; }
+
+    // MessageHandler
+    virtual void    OnMessage(const Message& msg);
+    virtual bool    SupportsMessageType(MessageType type) const;
+
+private:
+    void            writeRecord(UByte type, const UByte* payload, UPInt size);
+    void            writeBodyFrame(const MessageBodyFrame& msg);
+
+    Ptr<File>       pFile;
+    // Path of the last trace started, appended to by a later Start on it.
+    String          TracePath;
+};
+
+
+//-------------------------------------------------------------------------------------
+// ***** SensorTracePlayer
+
+// Plays a recorded trace into a SensorFusion that isn't attached to a sensor, by
+// passing its messages to SensorFusion::OnMessage in their recorded order. Playback
+// runs as fast as the fusion takes the messages, and always gives the same results
+// for the same trace, so fusion changes can be checked without a headset.
+// Messages are delivered on the calling thread.
+
+class SensorTracePlayer : public NewOverrideBase
+{
+public:
+    SensorTracePlayer();
+
+    // Maps the trace file; returns false if it can't be read or isn't a trace.
+    bool            Open(const char* path);
+    void            Close();
+
+    // Starts playing again from the first record.
+    void            Rewind();
+    bool            IsAtEnd() const;
+
+    // Time of the next message, or a negative value at the end of the trace.
+    double          GetNextTimeSeconds() const;
+
+    // Plays the next record, returning false at the end of the trace.
+    bool            PlayNext(SensorFusion* fusion);
+    // Plays every message up to and including the given time, returning the number
+    // of records played; it lets the fusion be queried at points in the trace.
+    unsigned        PlayUntil(SensorFusion* fusion, double absoluteTimeSeconds);
+    unsigned        PlayAll(SensorFusion* fusion);
+
+    // Reads the next body frame without playing it, skipping other records, for
+    // replaying the trace's samples through a sensor; false at the end of the trace.
+    bool            ReadBodyFrame(MessageBodyFrame* frame);
+
+    // Number of body frames played since the trace was opened or rewound.
+    unsigned        GetBodyFrameCount() const   { return BodyFrameCount; }
+    // Time spent in SensorFusion::OnMessage for those frames, without the trace
+    // decoding, to measure the cost of fusion per sample.
+    double          GetFusionSeconds() const    { return FusionNanos * 1e-9; }
+    double          GetNanosPerBodyFrame() const
+    { return BodyFrameCount ? (double)FusionNanos / BodyFrameCount : 0.0; }
+
+private:
+    // Finds the record at pos; false at the end, or if the rest is truncated.
+    bool            peekRecord(UPInt pos, UByte* type, const UByte** payload, UPInt* size) const;
+    // Plays the record at Position; timed is set for body and exposure frames.
+    bool            playRecord(SensorFusion* fusion, bool* timed);
+
+    MappedFile      TraceFile;
+    UPInt           TraceLength;
+    UPInt           Position;
+    unsigned        BodyFrameCount;
+    UInt64          FusionNanos;
+};
+
+} // namespace OVR
+
+#endif // OVR_SensorTrace_h
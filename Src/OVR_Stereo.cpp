@@ -163,40 +163,37 @@ void SetEyeCup(HmdRenderInfo* renderInfo, const char* cup)
 
 
 // The result is a scaling applied to the distance.
-float LensConfig::DistortionFnScaleRadiusSquared (float rsq) const
+template<>
+float LensConfig::DistortionFnScaleRadiusSquared<LensEval_Table> (float rsq) const
 {
-    float scale = 1.0f;
     switch ( Eqn )
     {
     case Distortion_Poly4:
-        // This version is deprecated! Prefer one of the other two.
-        scale = ( K[0] + rsq * ( K[1] + rsq * ( K[2] + rsq * K[3] ) ) );
-        break;
+        return DistortionFnScaleRadiusSquared<LensEval_Table, Distortion_Poly4> ( rsq );
     case Distortion_RecipPoly4:
-        scale = 1.0f / ( K[0] + rsq * ( K[1] + rsq * ( K[2] + rsq * K[3] ) ) );
-        break;
-    case Distortion_CatmullRom10:{
-        // A Catmull-Rom spline through the values 1.0, K[1], K[2] ... K[10]
-        // evenly spaced in R^2 from 0.0 to MaxR^2
-        // K[0] controls the slope at radius=0.0, rather than the actual value.
-        const int NumSegments = LensConfig::NumCoefficients;
-        OVR_ASSERT ( NumSegments <= NumCoefficients );
-        float scaledRsq = (float)(NumSegments-1) * rsq / ( MaxR * MaxR );
-        scale = EvalCatmullRom10Spline ( K, scaledRsq );
-
-
-		//Intercept, and overrule if needed
-		if (CustomDistortion)
-		{
-			scale = CustomDistortion(rsq);
-		}
+        return DistortionFnScaleRadiusSquared<LensEval_Table, Distortion_RecipPoly4> ( rsq );
+    case Distortion_CatmullRom10:
+        return DistortionFnScaleRadiusSquared<LensEval_Table, Distortion_CatmullRom10> ( rsq );
+    default:
+        // Asserts, and leaves the radius unscaled.
+        return DistortionFnScaleRadiusSquared<LensEval_Table, Distortion_LAST> ( rsq );
+    }
+}
 
-        }break;
+template<>
+float LensConfig::DistortionFnScaleRadiusSquared<LensEval_Exact> (float rsq) const
+{
+    switch ( Eqn )
+    {
+    case Distortion_Poly4:
+        return DistortionFnScaleRadiusSquared<LensEval_Exact, Distortion_Poly4> ( rsq );
+    case Distortion_RecipPoly4:
+        return DistortionFnScaleRadiusSquared<LensEval_Exact, Distortion_RecipPoly4> ( rsq );
+    case Distortion_CatmullRom10:
+        return DistortionFnScaleRadiusSquared<LensEval_Exact, Distortion_CatmullRom10> ( rsq );
     default:
-        OVR_ASSERT ( false );
-        break;
+        return DistortionFnScaleRadiusSquared<LensEval_Exact, Distortion_LAST> ( rsq );
     }
-    return scale;
 }
 
 // x,y,z components map to r,g,b
@@ -211,42 +208,36 @@ Vector3f LensConfig::DistortionFnScaleRadiusSquaredChroma (float rsq) const
 }
 
 // DistortionFnInverse computes the inverse of the distortion function on an argument.
-float LensConfig::DistortionFnInverse(float r) const
-{    
-    OVR_ASSERT((r <= 20.0f));
-
-    float s, d;
-    float delta = r * 0.25f;
-
-    // Better to start guessing too low & take longer to converge than too high
-    // and hit singularities. Empirically, r * 0.5f is too high in some cases.
-    s = r * 0.25f;
-    d = fabs(r - DistortionFn(s));
-
-    for (int i = 0; i < 20; i++)
+template<>
+float LensConfig::DistortionFnInverse<LensEval_Table>(float r) const
+{
+    switch ( Eqn )
     {
-        float sUp   = s + delta;
-        float sDown = s - delta;
-        float dUp   = fabs(r - DistortionFn(sUp));
-        float dDown = fabs(r - DistortionFn(sDown));
-
-        if (dUp < d)
-        {
-            s = sUp;
-            d = dUp;
-        }
-        else if (dDown < d)
-        {
-            s = sDown;
-            d = dDown;
-        }
-        else
-        {
-            delta *= 0.5f;
-        }
+    case Distortion_Poly4:
+        return DistortionFnInverse<LensEval_Table, Distortion_Poly4> ( r );
+    case Distortion_RecipPoly4:
+        return DistortionFnInverse<LensEval_Table, Distortion_RecipPoly4> ( r );
+    case Distortion_CatmullRom10:
+        return DistortionFnInverse<LensEval_Table, Distortion_CatmullRom10> ( r );
+    default:
+        return DistortionFnInverse<LensEval_Table, Distortion_LAST> ( r );
     }
+}
 
-    return s;
+template<>
+float LensConfig::DistortionFnInverse<LensEval_Exact>(float r) const
+{
+    switch ( Eqn )
+    {
+    case Distortion_Poly4:
+        return DistortionFnInverse<LensEval_Exact, Distortion_Poly4> ( r );
+    case Distortion_RecipPoly4:
+        return DistortionFnInverse<LensEval_Exact, Distortion_RecipPoly4> ( r );
+    case Distortion_CatmullRom10:
+        return DistortionFnInverse<LensEval_Exact, Distortion_CatmullRom10> ( r );
+    default:
+        return DistortionFnInverse<LensEval_Exact, Distortion_LAST> ( r );
+    }
 }
 
 
@@ -289,6 +280,8 @@ float LensConfig::DistortionFnInverseApprox(float r) const
 
 void LensConfig::SetUpInverseApprox()
 {
+    setUpTables();
+
     float maxR = MaxInvR;
 
     switch ( Eqn )
@@ -312,7 +305,7 @@ void LensConfig::SetUpInverseApprox()
         for ( int i = 0; i < 4; i++ )
         {
             sampleRSq[i] = sampleR[i] * sampleR[i];
-            sampleInv[i] = DistortionFnInverse ( sampleR[i] );
+            sampleInv[i] = DistortionFnInverse<LensEval_Exact> ( sampleR[i] );
             sampleFit[i] = sampleR[i] / sampleInv[i];
         }
         sampleFit[0] = 1.0f;
@@ -346,7 +339,7 @@ void LensConfig::SetUpInverseApprox()
             float scaledRsq = (float)i;
             float rsq = scaledRsq * MaxInvR * MaxInvR / (float)( NumSegments - 1);
             float r = sqrtf ( rsq );
-            float inv = DistortionFnInverse ( r );
+            float inv = DistortionFnInverse<LensEval_Exact> ( r );
             InvK[i] = inv / r;
             InvK[0] = 1.0f;     // TODO: fix this.
         }
@@ -371,8 +364,71 @@ void LensConfig::SetUpInverseApprox()
 }
 
 
+void LensConfig::setUpTables()
+{
+    HasScaleTable   = false;
+    HasInverseTable = false;
+    if ( Eqn != Distortion_CatmullRom10 || MaxR <= 0.0f )
+    {
+        // The other equations are cheap to evaluate directly.
+        return;
+    }
+
+    float maxRsq = MaxR * MaxR;
+    for ( int i = 0; i <= TableSize; i++ )
+    {
+        ScaleTable[i] = DistortionFnScaleRadiusSquared<LensEval_Exact> ( maxRsq * (float)i / (float)TableSize );
+    }
+    ScaleTableRsqToIndex = (float)TableSize / maxRsq;
+    HasScaleTable        = true;
+
+    // The inverse only exists if the function keeps increasing up to MaxR. Each
+    // entry is found by bisection between the samples of the function around it.
+    float distorted[TableSize+1];
+    for ( int i = 0; i <= TableSize; i++ )
+    {
+        distorted[i] = DistortionFn<LensEval_Exact> ( MaxR * (float)i / (float)TableSize );
+        if ( i > 0 && distorted[i] <= distorted[i-1] )
+        {
+            return;
+        }
+    }
+
+    int segment = 0;
+    for ( int i = 0; i <= TableSize; i++ )
+    {
+        float r = distorted[TableSize] * (float)i / (float)TableSize;
+        while ( segment < TableSize - 1 && distorted[segment+1] < r )
+        {
+            segment++;
+        }
+
+        float lo = MaxR * (float)segment       / (float)TableSize;
+        float hi = MaxR * (float)(segment + 1) / (float)TableSize;
+        for ( int j = 0; j < 16; j++ )
+        {
+            float mid = 0.5f * ( lo + hi );
+            if ( DistortionFn<LensEval_Exact> ( mid ) < r )
+            {
+                lo = mid;
+            }
+            else
+            {
+                hi = mid;
+            }
+        }
+        InverseTable[i] = 0.5f * ( lo + hi );
+    }
+    InverseTable[0]      = 0.0f;
+    InverseTableRToIndex = (float)TableSize / distorted[TableSize];
+    HasInverseTable      = true;
+}
+
+
 void LensConfig::SetToIdentity()
 {
+    HasScaleTable   = false;
+    HasInverseTable = false;
     for ( int i = 0; i < NumCoefficients; i++ )
     {
         K[i] = 0.0f;
@@ -1767,11 +1823,9 @@ Vector2f TransformTanFovSpaceToScreenNDC( DistortionRenderDesc const &distortion
                                           const Vector2f &tanEyeAngle, bool usePolyApprox /*= false*/ )
 {
     float tanEyeAngleRadius = tanEyeAngle.Length();
-    float tanEyeAngleDistortedRadius = distortion.Lens.DistortionFnInverseApprox ( tanEyeAngleRadius );
-    if ( !usePolyApprox )
-    {
-        tanEyeAngleDistortedRadius = distortion.Lens.DistortionFnInverse ( tanEyeAngleRadius );
-    }
+    float tanEyeAngleDistortedRadius = usePolyApprox ?
+                                       distortion.Lens.DistortionFnInverseApprox ( tanEyeAngleRadius ) :
+                                       distortion.Lens.DistortionFnInverse ( tanEyeAngleRadius );
     Vector2f tanEyeAngleDistorted = tanEyeAngle;
     if ( tanEyeAngleRadius > 0.0f )
     {   
@@ -34,6 +34,9 @@ limitations under the License.
 typedef struct ovrFovPort_ ovrFovPort;
 typedef struct ovrRecti_ ovrRecti;
 
+// Overrides the CatmullRom10 lens equation when set; see OVR_Stereo.cpp.
+extern float (*CustomDistortion)(float);
+
 namespace OVR {
 
 //-----------------------------------------------------------------------------------
@@ -171,9 +174,28 @@ bool FitCubicPolynomial ( float *pResult, const float *pFitX, const float *pFitY
 // - ChromaticAberration is an array of parameters for controlling
 //   additional Red and Blue scaling in order to reduce chromatic aberration
 //   caused by the Rift lenses.
+//
+// For Distortion_CatmullRom10 lenses, SetUpInverseApprox also bakes lookup tables
+// of the distortion function and its inverse up to MaxR, which the distortion
+// functions use by default. Table results are within 1e-4 in tan(angle) of the
+// exact ones (about 0.05 pixels on a DK2); the inverse table is more accurate than
+// the exact numeric inverse, which is only good to about 3e-4. The exact results
+// are available through the LensEval_Exact versions of the functions. Anything
+// changing the lens parameters must call SetUpInverseApprox again, or
+// SetToIdentity, which drops the tables.
+enum LensEvalType
+{
+    LensEval_Table,     // Use the lookup tables where there are any.
+    LensEval_Exact      // Always evaluate the lens equation.
+};
+
 struct LensConfig
 {
+    LensConfig() : HasScaleTable(false), HasInverseTable(false) { }
+
     // The result is a scaling applied to the distance from the center of the lens.
+    template<LensEvalType evalType>
+    float    DistortionFnScaleRadiusSquared (float rsq) const;
     float    DistortionFnScaleRadiusSquared (float rsq) const;
     // x,y,z components map to r,g,b scales.
     Vector3f DistortionFnScaleRadiusSquaredChroma (float rsq) const;
@@ -181,22 +203,42 @@ struct LensConfig
     // DistortionFn applies distortion to the argument.
     // Input: the distance in TanAngle/NIC space from the optical center to the input pixel.
     // Output: the resulting distance after distortion.
+    template<LensEvalType evalType>
     float DistortionFn(float r) const
     {
-        return r * DistortionFnScaleRadiusSquared ( r * r );
+        return r * DistortionFnScaleRadiusSquared<evalType> ( r * r );
     }
+    float DistortionFn(float r) const;
 
     // DistortionFnInverse computes the inverse of the distortion function on an argument.
+    template<LensEvalType evalType>
+    float DistortionFnInverse(float r) const;
     float DistortionFnInverse(float r) const;
 
     // Also computes the inverse, but using a polynomial approximation. Warning - it's just an approximation!
     float DistortionFnInverseApprox(float r) const;
-    // Sets up InvK[].
+    // Sets up InvK[] and the lookup tables.
     void SetUpInverseApprox();
 
     // Sets a bunch of sensible defaults.
     void SetToIdentity();
 
+    // The same functions for one equation, which must be Eqn. They don't switch on
+    // Eqn, so that loops over many points pick the equation once and inline the rest;
+    // see the templated TransformTanFovSpaceToScreenNDC. The results match the
+    // functions above exactly.
+    template<LensEvalType evalType, DistortionEqnType eqn>
+    float    DistortionFnScaleRadiusSquared (float rsq) const;
+    template<DistortionEqnType eqn>
+    Vector3f DistortionFnScaleRadiusSquaredChroma (float rsq) const;
+    template<LensEvalType evalType, DistortionEqnType eqn>
+    float DistortionFn(float r) const
+    {
+        return r * DistortionFnScaleRadiusSquared<evalType, eqn> ( r * r );
+    }
+    template<LensEvalType evalType, DistortionEqnType eqn>
+    float DistortionFnInverse(float r) const;
+
 
 
     enum { NumCoefficients = 11 };
@@ -216,8 +258,162 @@ struct LensConfig
 
     float               InvK[NumCoefficients];
     float               MaxInvR;
+
+    // Lookup tables, linearly interpolated: the scale at rsq = i * MaxR^2 / TableSize,
+    // and the inverse at r = i * DistortionFn(MaxR) / TableSize. The inverse table
+    // is only made if the function increases up to MaxR.
+    enum { TableSize = 512 };
+    bool                HasScaleTable;
+    bool                HasInverseTable;
+    float               ScaleTableRsqToIndex;
+    float               InverseTableRToIndex;
+    float               ScaleTable[TableSize+1];
+    float               InverseTable[TableSize+1];
+
+private:
+    void                setUpTables();
+
+    // The lens equation itself. Values other than the three equations assert and
+    // leave the radius unscaled.
+    template<DistortionEqnType eqn>
+    float               scaleRadiusSquaredExact (float rsq) const
+    {
+        OVR_ASSERT ( false );
+        OVR_UNUSED ( rsq );
+        return 1.0f;
+    }
 };
 
+float EvalCatmullRom10Spline ( float const *K, float scaledVal );
+
+template<>
+inline float LensConfig::scaleRadiusSquaredExact<Distortion_Poly4> (float rsq) const
+{
+    // This version is deprecated! Prefer one of the other two.
+    return ( K[0] + rsq * ( K[1] + rsq * ( K[2] + rsq * K[3] ) ) );
+}
+
+template<>
+inline float LensConfig::scaleRadiusSquaredExact<Distortion_RecipPoly4> (float rsq) const
+{
+    return 1.0f / ( K[0] + rsq * ( K[1] + rsq * ( K[2] + rsq * K[3] ) ) );
+}
+
+template<>
+inline float LensConfig::scaleRadiusSquaredExact<Distortion_CatmullRom10> (float rsq) const
+{
+    // A Catmull-Rom spline through the values 1.0, K[1], K[2] ... K[10]
+    // evenly spaced in R^2 from 0.0 to MaxR^2
+    // K[0] controls the slope at radius=0.0, rather than the actual value.
+    const int NumSegments = LensConfig::NumCoefficients;
+    float scaledRsq = (float)(NumSegments-1) * rsq / ( MaxR * MaxR );
+    float scale = EvalCatmullRom10Spline ( K, scaledRsq );
+
+    //Intercept, and overrule if needed
+    if (CustomDistortion)
+    {
+        scale = CustomDistortion(rsq);
+    }
+    return scale;
+}
+
+template<LensEvalType evalType, DistortionEqnType eqn>
+inline float LensConfig::DistortionFnScaleRadiusSquared (float rsq) const
+{
+    if ( evalType == LensEval_Table && HasScaleTable && !CustomDistortion )
+    {
+        float scaledRsq = rsq * ScaleTableRsqToIndex;
+        if ( scaledRsq >= 0.0f && scaledRsq < (float)TableSize )
+        {
+            int   i = (int)scaledRsq;
+            float t = scaledRsq - (float)i;
+            return ScaleTable[i] + ( ScaleTable[i+1] - ScaleTable[i] ) * t;
+        }
+    }
+    return scaleRadiusSquaredExact<eqn> ( rsq );
+}
+
+template<DistortionEqnType eqn>
+inline Vector3f LensConfig::DistortionFnScaleRadiusSquaredChroma (float rsq) const
+{
+    float scale = DistortionFnScaleRadiusSquared<LensEval_Table, eqn> ( rsq );
+    Vector3f scaleRGB;
+    scaleRGB.x = scale * ( 1.0f + ChromaticAberration[0] + rsq * ChromaticAberration[1] );     // Red
+    scaleRGB.y = scale;                                                                        // Green
+    scaleRGB.z = scale * ( 1.0f + ChromaticAberration[2] + rsq * ChromaticAberration[3] );     // Blue
+    return scaleRGB;
+}
+
+template<LensEvalType evalType, DistortionEqnType eqn>
+inline float LensConfig::DistortionFnInverse(float r) const
+{
+    if ( evalType == LensEval_Table && HasInverseTable && !CustomDistortion )
+    {
+        float scaledR = r * InverseTableRToIndex;
+        if ( scaledR >= 0.0f && scaledR < (float)TableSize )
+        {
+            int   i = (int)scaledR;
+            float t = scaledR - (float)i;
+            return InverseTable[i] + ( InverseTable[i+1] - InverseTable[i] ) * t;
+        }
+    }
+
+    OVR_ASSERT((r <= 20.0f));
+
+    float s, d;
+    float delta = r * 0.25f;
+
+    // Better to start guessing too low & take longer to converge than too high
+    // and hit singularities. Empirically, r * 0.5f is too high in some cases.
+    s = r * 0.25f;
+    d = fabs(r - DistortionFn<LensEval_Exact, eqn>(s));
+
+    for (int i = 0; i < 20; i++)
+    {
+        float sUp   = s + delta;
+        float sDown = s - delta;
+        float dUp   = fabs(r - DistortionFn<LensEval_Exact, eqn>(sUp));
+        float dDown = fabs(r - DistortionFn<LensEval_Exact, eqn>(sDown));
+
+        if (dUp < d)
+        {
+            s = sUp;
+            d = dUp;
+        }
+        else if (dDown < d)
+        {
+            s = sDown;
+            d = dDown;
+        }
+        else
+        {
+            delta *= 0.5f;
+        }
+    }
+
+    return s;
+}
+
+template<> float LensConfig::DistortionFnScaleRadiusSquared<LensEval_Table> (float rsq) const;
+template<> float LensConfig::DistortionFnScaleRadiusSquared<LensEval_Exact> (float rsq) const;
+template<> float LensConfig::DistortionFnInverse<LensEval_Table> (float r) const;
+template<> float LensConfig::DistortionFnInverse<LensEval_Exact> (float r) const;
+
+inline float LensConfig::DistortionFnScaleRadiusSquared (float rsq) const
+{
+    return DistortionFnScaleRadiusSquared<LensEval_Table> ( rsq );
+}
+
+inline float LensConfig::DistortionFn(float r) const
+{
+    return DistortionFn<LensEval_Table> ( r );
+}
+
+inline float LensConfig::DistortionFnInverse(float r) const
+{
+    return DistortionFnInverse<LensEval_Table> ( r );
+}
+
 
 // For internal use - storing and loading lens config data
 
@@ -455,6 +651,46 @@ Vector2f TransformTanFovSpaceToScreenNDC( DistortionRenderDesc const &distortion
 Vector2f TransformRendertargetNDCToTanFovSpace( const ScaleAndOffset2D &eyeToSourceNDC,
                                                 const Vector2f &textureNDC );
 
+// The same as TransformScreenNDCToTanFovSpaceChroma and TransformTanFovSpaceToScreenNDC
+// (without the approximation) for the lens equation eqn, which must be distortion.Lens.Eqn.
+// The distortion mesh picks the equation once per mesh and calls these for each vertex.
+template<DistortionEqnType eqn>
+inline void TransformScreenNDCToTanFovSpaceChroma ( Vector2f *resultR, Vector2f *resultG, Vector2f *resultB,
+                                                    DistortionRenderDesc const &distortion,
+                                                    const Vector2f &framebufferNDC )
+{
+    // Scale to TanHalfFov space, but still distorted.
+    Vector2f tanEyeAngleDistorted;
+    tanEyeAngleDistorted.x = ( framebufferNDC.x - distortion.LensCenter.x ) * distortion.TanEyeAngleScale.x;
+    tanEyeAngleDistorted.y = ( framebufferNDC.y - distortion.LensCenter.y ) * distortion.TanEyeAngleScale.y;
+    // Distort.
+    float radiusSquared = ( tanEyeAngleDistorted.x * tanEyeAngleDistorted.x )
+                        + ( tanEyeAngleDistorted.y * tanEyeAngleDistorted.y );
+    Vector3f distortionScales = distortion.Lens.DistortionFnScaleRadiusSquaredChroma<eqn> ( radiusSquared );
+    *resultR = tanEyeAngleDistorted * distortionScales.x;
+    *resultG = tanEyeAngleDistorted * distortionScales.y;
+    *resultB = tanEyeAngleDistorted * distortionScales.z;
+}
+
+template<DistortionEqnType eqn>
+inline Vector2f TransformTanFovSpaceToScreenNDC( DistortionRenderDesc const &distortion,
+                                                 const Vector2f &tanEyeAngle )
+{
+    float tanEyeAngleRadius = tanEyeAngle.Length();
+    float tanEyeAngleDistortedRadius = distortion.Lens.DistortionFnInverse<LensEval_Table, eqn> ( tanEyeAngleRadius );
+    Vector2f tanEyeAngleDistorted = tanEyeAngle;
+    if ( tanEyeAngleRadius > 0.0f )
+    {
+        tanEyeAngleDistorted = tanEyeAngle * ( tanEyeAngleDistortedRadius / tanEyeAngleRadius );
+    }
+
+    Vector2f framebufferNDC;
+    framebufferNDC.x = ( tanEyeAngleDistorted.x / distortion.TanEyeAngleScale.x ) + distortion.LensCenter.x;
+    framebufferNDC.y = ( tanEyeAngleDistorted.y / distortion.TanEyeAngleScale.y ) + distortion.LensCenter.y;
+
+    return framebufferNDC;
+}
+
 } //namespace OVR
 
 #endif // OVR_Stereo_h
\ No newline at end of file
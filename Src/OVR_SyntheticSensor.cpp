@@ -0,0 +1,500 @@
+/************************************************************************************
+
+Filename    :   OVR_SyntheticSensor.cpp
+Content     :   Sensor that generates head motion, for running without hardware
+Created     :   October 14, 2026
+Notes       :
+
+Copyright   :   Copyright 2014 Oculus VR, Inc. All Rights reserved.
+
+Licensed under the Oculus VR Rift SDK License Version 3.1 (the "License");
+you may not use the Oculus VR Rift SDK except in compliance with the License,
+which is provided at the time of installation or download, or which
+otherwise accompanies this software in either electronic or hard copy form.
+
+You may obtain a copy of the License at
+
+http://www.oculusvr.com/licenses/LICENSE-3.1
+
+Unless required by applicable law or agreed to in writing, the Oculus VR SDK
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+*************************************************************************************/
+
+#include "OVR_SyntheticSensor.h"
+#include "OVR_SensorTrace.h"
+#include "Kernel/OVR_Alg.h"
+#include "Kernel/OVR_Log.h"
+#include "Kernel/OVR_Timer.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+namespace OVR {
+
+using namespace Alg;
+
+// Field the motion is measured in, world frame: gravity's reaction, and a field
+// pointing north (-Z) and down, as in the northern hemisphere.
+static const Vector3d SyntheticGravity(0.0, 9.81, 0.0);
+static const Vector3d SyntheticMagneticField(0.0, -0.4, -0.2);
+
+// Report ids of the DK1 firmware.
+enum
+{
+    SyntheticReport_Sensors         = 1,
+    SyntheticReport_Config          = 2,
+    SyntheticReport_Calibration     = 3,
+    SyntheticReport_Range           = 4,
+    SyntheticReport_KeepAlive       = 8,
+    SyntheticReport_DisplayInfo     = 9
+};
+
+// Parses up to count numbers separated by ':', leaving the rest of values as they
+// are; returns false if args has anything else.
+static bool parseSyntheticArgs(const char* args, double* values, int count)
+{
+    for (int i = 0; i < count && *args; i++)
+    {
+        char* end;
+        values[i] = strtod(args, &end);
+        if (end == args || (*end && *end != ':'))
+            return false;
+        args = *end ? end + 1 : end;
+    }
+    return *args == 0;
+}
+
+
+//-------------------------------------------------------------------------------------
+// ***** SyntheticMotion
+
+SyntheticMotion::SyntheticMotion()
+    : Profile(Profile_Sine), Amplitude(0), Frequency(0), pTrace(0)
+{
+}
+
+SyntheticMotion::~SyntheticMotion()
+{
+    delete pTrace;
+}
+
+bool SyntheticMotion::Configure(const char* spec)
+{
+    const char* args       = strchr(spec, ':');
+    UPInt       nameLength = args ? (UPInt)(args - spec) : strlen(spec);
+    args = args ? args + 1 : "";
+
+    delete pTrace;
+    pTrace = 0;
+
+    if (nameLength == 4 && strncmp(spec, "sine", 4) == 0)
+    {
+        double values[2] = { 30.0, 0.25 };
+        if (!parseSyntheticArgs(args, values, 2))
+            return false;
+        Profile   = Profile_Sine;
+        Amplitude = DegreeToRad(values[0]);
+        Frequency = values[1];
+        return true;
+    }
+    if (nameLength == 6 && strncmp(spec, "stress", 6) == 0)
+    {
+        double values[1] = { 1000.0 };
+        if (!parseSyntheticArgs(args, values, 1))
+            return false;
+        Profile   = Profile_Stress;
+        Amplitude = DegreeToRad(values[0]);
+        Frequency = 8.0;
+        return true;
+    }
+    if (nameLength == 5 && strncmp(spec, "trace", 5) == 0)
+    {
+        pTrace = new SensorTracePlayer;
+        if (!pTrace->Open(args))
+        {
+            delete pTrace;
+            pTrace = 0;
+            return false;
+        }
+        Profile = Profile_Trace;
+        return true;
+    }
+    return false;
+}
+
+Quatd SyntheticMotion::getOrientation(double t) const
+{
+    double yaw, pitch, roll;
+    if (Profile == Profile_Stress)
+    {
+        // Yaw goes back and forth at the full rate, every half second.
+        double phase = t - floor(t);
+        yaw   = Amplitude * ((phase < 0.5) ? phase : 1.0 - phase);
+        pitch = DegreeToRad(10.0) * sin(Mathd::TwoPi * Frequency * t);
+        roll  = 0;
+    }
+    else
+    {
+        // Independent frequencies, so that the pattern doesn't repeat quickly.
+        yaw   = Amplitude * sin(Mathd::TwoPi * Frequency * t);
+        pitch = Amplitude * 0.5 * sin(Mathd::TwoPi * Frequency * 1.6 * t);
+        roll  = Amplitude * 0.2 * sin(Mathd::TwoPi * Frequency * 2.7 * t);
+    }
+    return Quatd(Axis_Y, yaw) * Quatd(Axis_X, pitch) * Quatd(Axis_Z, roll);
+}
+
+void SyntheticMotion::GetSample(double t, TrackerSample* sample, Vector3f* magneticField)
+{
+    if (Profile == Profile_Trace)
+    {
+        MessageBodyFrame frame;
+        if (pTrace->ReadBodyFrame(&frame) ||
+            (pTrace->Rewind(), pTrace->ReadBodyFrame(&frame)))
+        {
+            sample->Accel  = frame.Acceleration;
+            sample->Gyro   = frame.RotationRate;
+            *magneticField = frame.MagneticField;
+        }
+        else
+        {
+            // No body frames: a head at rest.
+            sample->Accel  = Vector3f(SyntheticGravity);
+            sample->Gyro   = Vector3f(0);
+            *magneticField = Vector3f(SyntheticMagneticField);
+        }
+        return;
+    }
+
+    // Body rotation rate from the orientations just before and after; the angle
+    // is taken with atan2, which stays accurate for the small ones.
+    const double h  = 0.25 / SyntheticTracker::SampleRate;
+    Quatd        q  = getOrientation(t);
+    Quatd        dq = getOrientation(t - h).Inverted() * getOrientation(t + h);
+    if (dq.w < 0)
+        dq = dq * -1.0;
+    Vector3d     axis(dq.x, dq.y, dq.z);
+    double       sinHalfAngle = axis.Length();
+    Vector3d     rate = (sinHalfAngle > 0) ?
+                        axis * (2.0 * atan2(sinHalfAngle, dq.w) / (sinHalfAngle * 2.0 * h)) :
+                        Vector3d(0);
+
+    Quatd bodyFromWorld = q.Inverted();
+    sample->Accel  = Vector3f(bodyFromWorld.Rotate(SyntheticGravity));
+    sample->Gyro   = Vector3f(rate);
+    *magneticField = Vector3f(bodyFromWorld.Rotate(SyntheticMagneticField));
+}
+
+
+//-------------------------------------------------------------------------------------
+// ***** SyntheticTracker
+
+SyntheticTracker::SyntheticTracker()
+    : pTicks(0),
+      // The firmware's defaults: 4 G, 1000 deg/s and 1.3 Gauss.
+      Range(SensorRange(4 * 9.81f, 17.0f, 1.3f)),
+      LastCommandId(0),
+      KeepAliveDeadline(0),
+      Streaming(false),
+      StreamStart(0),
+      SampleIndex(0)
+{
+    Config.PacketInterval = 1;
+    Config.SampleRate     = SampleRate;
+    Config.Pack();
+
+    // All zero calibration unpacks to no offsets and identity matrices.
+    GetDisplayInfo(&DisplayInfo);
+}
+
+SyntheticTracker::~SyntheticTracker()
+{
+    Stop();
+}
+
+bool SyntheticTracker::Start(const char* spec, DeviceManagerImpl* manager, const String& path)
+{
+    if (!Motion.Configure(spec))
+    {
+        LogError("OVR::SyntheticTracker - invalid motion '%s'\n", spec);
+        return false;
+    }
+    if (!startTicks(manager, path))
+        return false;
+
+    LogText("OVR::SyntheticTracker - generating '%s' motion\n", spec);
+    return true;
+}
+
+void SyntheticTracker::Stop()
+{
+    stopTicks();
+}
+
+void SyntheticTracker::GetDisplayInfo(SensorDisplayInfoImpl* displayInfo)
+{
+    // DK1 screen; sizes are in micrometers.
+    UByte* p = displayInfo->Buffer;
+    memset(p, 0, SensorDisplayInfoImpl::PacketSize);
+    p[0] = SyntheticReport_DisplayInfo;
+    p[3] = SensorDisplayInfoImpl::Base_ScreenOnly;
+    EncodeUInt16(p + 4, 1280);
+    EncodeUInt16(p + 6, 800);
+    EncodeUInt32(p + 8, 149760);
+    EncodeUInt32(p + 12, 93600);
+    EncodeUInt32(p + 16, 46800);
+    EncodeUInt32(p + 20, 63500);
+    displayInfo->Unpack();
+}
+
+bool SyntheticTracker::SetFeatureReport(UByte* data, UInt32 length)
+{
+    if (length < 3)
+        return false;
+
+    switch (data[0])
+    {
+    case SyntheticReport_Config:
+        if (length < SensorConfigImpl::PacketSize)
+            return false;
+        memcpy(Config.Buffer, data, SensorConfigImpl::PacketSize);
+        Config.Unpack();
+        break;
+
+    case SyntheticReport_Range:
+        if (length < SensorRangeImpl::PacketSize)
+            return false;
+        {
+            // The firmware picks the ranges it supports, as SensorRangeImpl does.
+            SensorRangeImpl requested((SensorRange()));
+            memcpy(requested.Buffer, data, SensorRangeImpl::PacketSize);
+            requested.Unpack();
+            SensorRange range;
+            requested.GetSensorRange(&range);
+            Range.SetSensorRange(range, requested.CommandId);
+        }
+        break;
+
+    case SyntheticReport_KeepAlive:
+        if (length < SensorKeepAliveImpl::PacketSize)
+            return false;
+        {
+            SensorKeepAliveImpl keepAlive;
+            memcpy(keepAlive.Buffer, data, SensorKeepAliveImpl::PacketSize);
+            keepAlive.Unpack();
+            KeepAliveDeadline = Timer::GetSeconds() + keepAlive.KeepAliveIntervalMs * 0.001;
+        }
+        break;
+
+    default:
+        return false;
+    }
+
+    LastCommandId = DecodeUInt16(data + 1);
+    return true;
+}
+
+bool SyntheticTracker::GetFeatureReport(UByte* data, UInt32 length)
+{
+    const UByte* report;
+    UInt32       size;
+    switch (data[0])
+    {
+    case SyntheticReport_Config:
+        report = Config.Buffer;         size = SensorConfigImpl::PacketSize;                break;
+    case SyntheticReport_Calibration:
+        report = Calibration.Buffer;    size = SensorFactoryCalibrationImpl::PacketSize;    break;
+    case SyntheticReport_Range:
+        report = Range.Buffer;          size = SensorRangeImpl::PacketSize;                 break;
+    case SyntheticReport_DisplayInfo:
+        report = DisplayInfo.Buffer;    size = SensorDisplayInfoImpl::PacketSize;           break;
+    default:
+        return false;
+    }
+
+    memcpy(data, report, Alg::Min(size, length));
+    return true;
+}
+
+double SyntheticTracker::OnTicks(double tickSeconds)
+{
+    double wait = Handler ? Handler->OnTicks(tickSeconds) : 1000.0;
+
+    if (tickSeconds >= KeepAliveDeadline)
+    {
+        Streaming = false;
+        return wait;
+    }
+    if (!Streaming)
+    {
+        // The sample clock runs on while the tracker isn't kept alive.
+        if (StreamStart == 0)
+            StreamStart = tickSeconds;
+        else
+            SampleIndex = (UInt32)((tickSeconds - StreamStart) * SampleRate);
+        Streaming = true;
+    }
+
+    // Drop the samples that no longer fit the backlog.
+    double available = (tickSeconds - StreamStart) * SampleRate;
+    if (available > SampleIndex + MaxBacklogSamples)
+        SampleIndex = (UInt32)available - MaxBacklogSamples;
+
+    UByte  reports[MaxBatchReports * ReportSize];
+    UInt32 lengths[MaxBatchReports];
+    double receiveTimes[MaxBatchReports];
+    UInt32 count = 0;
+
+    for (;;)
+    {
+        // A report goes out once its last sample has been taken.
+        double reportTime = StreamStart +
+                            (SampleIndex + getSamplesPerReport() - 1) * (1.0 / SampleRate);
+        if (reportTime > tickSeconds)
+        {
+            wait = Alg::Min(wait, reportTime - tickSeconds);
+            break;
+        }
+
+        makeReport(reports + count * ReportSize);
+        lengths[count]      = ReportSize;
+        receiveTimes[count] = reportTime;
+        if (++count == MaxBatchReports)
+        {
+            if (Handler)
+                Handler->OnInputReports(reports, ReportSize, lengths, receiveTimes, count);
+            count = 0;
+        }
+    }
+
+    if (count && Handler)
+        Handler->OnInputReports(reports, ReportSize, lengths, receiveTimes, count);
+    return wait;
+}
+
+void SyntheticTracker::makeReport(UByte* report)
+{
+    unsigned count        = getSamplesPerReport();
+    bool     coordsSensor = Config.IsUsingSensorCoordinates();
+
+    memset(report, 0, ReportSize);
+    report[0] = SyntheticReport_Sensors;
+    report[1] = (UByte)Alg::Min(count, 255u);
+    EncodeUInt16(report + 2, (UInt16)SampleIndex);
+    EncodeUInt16(report + 4, LastCommandId);
+    EncodeSInt16(report + 6, 2500);
+
+    // Up to three samples fit; of more, the first holds the average of all but
+    // the last two. Samples start zeroed, as Vector3f does.
+    TrackerSample samples[3];
+    unsigned      slots    = Alg::Min(count, 3u);
+    unsigned      averaged = count - slots + 1;
+    Vector3f      magneticField;
+
+    for (unsigned i = 0; i < count; i++)
+    {
+        TrackerSample sample;
+        Motion.GetSample((SampleIndex + i) * (1.0 / SampleRate), &sample, &magneticField);
+
+        unsigned slot = (i < averaged) ? 0 : i - averaged + 1;
+        samples[slot].Accel += sample.Accel / (float)((slot == 0) ? averaged : 1);
+        samples[slot].Gyro  += sample.Gyro / (float)((slot == 0) ? averaged : 1);
+    }
+    SampleIndex += count;
+
+    for (unsigned i = 0; i < slots; i++)
+    {
+        // Motion is in HMD coordinates; the sensor's own has Y and Z swapped.
+        Vector3f a = samples[i].Accel;
+        Vector3f g = samples[i].Gyro;
+        if (coordsSensor)
+        {
+            a = Vector3f(a.x, a.z, -a.y);
+            g = Vector3f(g.x, g.z, -g.y);
+        }
+
+        // Units of 10^-4, in 21 bits.
+        const float limit = (float)((1 << 20) - 1);
+        PackSensor(report + 8 + 16 * i,
+                   (SInt32)Alg::Clamp(a.x * 1e4f, -limit, limit),
+                   (SInt32)Alg::Clamp(a.y * 1e4f, -limit, limit),
+                   (SInt32)Alg::Clamp(a.z * 1e4f, -limit, limit));
+        PackSensor(report + 16 + 16 * i,
+                   (SInt32)Alg::Clamp(g.x * 1e4f, -limit, limit),
+                   (SInt32)Alg::Clamp(g.y * 1e4f, -limit, limit),
+                   (SInt32)Alg::Clamp(g.z * 1e4f, -limit, limit));
+    }
+
+    // The DK1 magnetometer reports Y and Z swapped in either frame.
+    Vector3f m = magneticField * 1e4f;
+    EncodeSInt16(report + 56, (SInt16)Alg::Clamp(m.x, -32767.0f, 32767.0f));
+    EncodeSInt16(report + 58, (SInt16)Alg::Clamp(m.z, -32767.0f, 32767.0f));
+    EncodeSInt16(report + 60, (SInt16)Alg::Clamp(m.y, -32767.0f, 32767.0f));
+}
+
+
+//-------------------------------------------------------------------------------------
+// ***** SyntheticSensorCreateDesc
+
+static HIDDeviceDesc makeSyntheticHIDDesc()
+{
+    HIDDeviceDesc desc;
+    desc.VendorId      = Oculus_VendorId;
+    desc.ProductId     = Device_Tracker_ProductId;
+    desc.VersionNumber = 0x0118;
+    desc.Usage         = 0;
+    desc.UsagePage     = 0;
+    desc.Path          = "synthetic";
+    desc.Manufacturer  = "Oculus VR, Inc.";
+    desc.Product       = "Synthetic Tracker";
+    desc.SerialNumber  = "SYNTHETIC0001";
+    return desc;
+}
+
+SyntheticSensorCreateDesc::SyntheticSensorCreateDesc(DeviceFactory* factory, const char* spec)
+    : SensorDeviceCreateDesc(factory, makeSyntheticHIDDesc()), MotionSpec(spec)
+{
+}
+
+DeviceBase* SyntheticSensorCreateDesc::NewDeviceInstance()
+{
+    return new SyntheticSensorDevice(this);
+}
+
+
+//-------------------------------------------------------------------------------------
+// ***** SyntheticSensorDevice
+
+SyntheticSensorDevice::SyntheticSensorDevice(SyntheticSensorCreateDesc* createDesc)
+    : SensorDeviceImpl(createDesc), pTracker(0)
+{
+}
+
+HIDDevice* SyntheticSensorDevice::openHIDDevice(const HIDDeviceDesc& hidDesc)
+{
+    SyntheticSensorCreateDesc* desc    = static_cast<SyntheticSensorCreateDesc*>(getCreateDesc());
+    SyntheticTracker*          tracker = new SyntheticTracker;
+
+    if (!tracker->Start(desc->MotionSpec.ToCStr(), GetManagerImpl(), hidDesc.Path))
+    {
+        tracker->Release();
+        return NULL;
+    }
+
+    pTracker = tracker;
+    return tracker;
+}
+
+void SyntheticSensorDevice::Shutdown()
+{
+    // No reports after the handler is gone.
+    if (pTracker)
+        pTracker->Stop();
+
+    SensorDeviceImpl::Shutdown();
+}
+
+} // namespace OVR
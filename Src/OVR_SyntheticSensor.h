@@ -0,0 +1,202 @@
+/************************************************************************************
+
+Filename    :   OVR_SyntheticSensor.h
+Content     :   Sensor that generates head motion, for running without hardware
+Created     :   October 14, 2026
+Notes       :
+
+Copyright   :   Copyright 2014 Oculus VR, Inc. All Rights reserved.
+
+Licensed under the Oculus VR Rift SDK License Version 3.1 (the "License");
+you may not use the Oculus VR Rift SDK except in compliance with the License,
+which is provided at the time of installation or download, or which
+otherwise accompanies this software in either electronic or hard copy form.
+
+You may obtain a copy of the License at
+
+http://www.oculusvr.com/licenses/LICENSE-3.1
+
+Unless required by applicable law or agreed to in writing, the Oculus VR SDK
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+*************************************************************************************/
+
+#ifndef OVR_SyntheticSensor_h
+#define OVR_SyntheticSensor_h
+
+#include "OVR_SensorImpl.h"
+#include "OVR_SensorImpl_Common.h"
+
+// Setting the OVR_SYNTHETIC_SENSOR environment variable adds a DK1 sensor whose
+// head motion is generated instead of measured, with a headset to go with it, so
+// that tracking, prediction and timewarp run without hardware. It is one of:
+//
+//   sine[:amplitude[:frequency]]  Swaying motion, yaw amplitude in degrees (30) and
+//                                 frequency in Hz (0.25); pitch and roll are smaller
+//                                 and faster.
+//   stress[:rate]                 Yaw spinning at rate degrees per second (1000),
+//                                 turning back every half second, under an 8 Hz
+//                                 pitch shake.
+//   trace:<path>                  The body frames of a trace recorded with
+//                                 OVR_SENSOR_TRACE, one per sample, looped.
+
+namespace OVR {
+
+class SensorTracePlayer;
+class SyntheticTrackerTicks;
+
+//-------------------------------------------------------------------------------------
+// ***** SyntheticMotion
+
+// Generates the IMU samples of a head following one of the profiles above. The
+// head only rotates; the accelerometer reads gravity.
+
+class SyntheticMotion : public NewOverrideBase
+{
+public:
+    enum ProfileType
+    {
+        Profile_Sine,
+        Profile_Stress,
+        Profile_Trace
+    };
+
+    SyntheticMotion();
+    ~SyntheticMotion();
+
+    // Returns false if spec isn't a profile, or its trace can't be read.
+    bool        Configure(const char* spec);
+
+    ProfileType GetProfile() const { return Profile; }
+
+    // Gets the sample taken at time t, in seconds, in the HMD frame; the magnetic
+    // field is in Gauss. Samples are asked for in order, and a trace plays one
+    // body frame per call.
+    void        GetSample(double t, TrackerSample* sample, Vector3f* magneticField);
+
+private:
+    // Head orientation of the generated profiles.
+    Quatd       getOrientation(double t) const;
+
+    ProfileType         Profile;
+    // Yaw amplitude in radians, or for stress the yaw rate in rad/s.
+    double              Amplitude;
+    double              Frequency;
+    SensorTracePlayer*  pTrace;
+};
+
+
+//-------------------------------------------------------------------------------------
+// ***** SyntheticTracker
+
+// Stands in for the HID device of a DK1 tracker, answering its feature reports and
+// streaming sensor reports at the configured rate while kept alive, so that
+// SensorDeviceImpl drives it as it does the hardware. Samples are taken at 1 kHz;
+// a report carries the samples since the previous one the way the firmware packs
+// them. Reports are made on the device thread, the thread that reads a real one.
+
+class SyntheticTracker : public HIDDevice
+{
+public:
+    enum
+    {
+        SampleRate      = 1000,
+        ReportSize      = 62,
+        // Reports handed to the handler in one OnInputReports call.
+        MaxBatchReports = 16,
+        // Samples the transport holds while the device thread is held up; older
+        // ones are lost, as they are when a hidraw queue overflows.
+        MaxBacklogSamples = 256
+    };
+
+    SyntheticTracker();
+    ~SyntheticTracker();
+
+    // Configures the motion and starts taking ticks from the device thread of
+    // path; must be called on that thread.
+    bool            Start(const char* spec, DeviceManagerImpl* manager, const String& path);
+    void            Stop();
+
+    // Display info of the emulated headset, for creating its HMD device.
+    static void     GetDisplayInfo(SensorDisplayInfoImpl* displayInfo);
+
+    // HIDDevice interface
+    virtual bool    SetFeatureReport(UByte* data, UInt32 length);
+    virtual bool    GetFeatureReport(UByte* data, UInt32 length);
+
+    // Sends the reports that are due; returns the seconds until the next one.
+    double          OnTicks(double tickSeconds);
+
+private:
+    // Implemented by the platform's device manager.
+    bool            startTicks(DeviceManagerImpl* manager, const String& path);
+    void            stopTicks();
+
+    unsigned        getSamplesPerReport() const { return Config.PacketInterval + 1; }
+    // Builds the report for the next samples.
+    void            makeReport(UByte* report);
+
+    SyntheticMotion         Motion;
+    SyntheticTrackerTicks*  pTicks;
+
+    SensorConfigImpl                Config;
+    SensorRangeImpl                 Range;
+    SensorFactoryCalibrationImpl    Calibration;
+    SensorDisplayInfoImpl           DisplayInfo;
+    UInt16                          LastCommandId;
+
+    // Reports stream until this time, set by keep-alives.
+    double          KeepAliveDeadline;
+    bool            Streaming;
+    // System time of sample 0, once streaming has started, and the number of the
+    // next sample; the report timestamp is its low 16 bits, in milliseconds.
+    double          StreamStart;
+    UInt32          SampleIndex;
+};
+
+
+//-------------------------------------------------------------------------------------
+// ***** SyntheticSensorCreateDesc
+
+class SyntheticSensorCreateDesc : public SensorDeviceCreateDesc
+{
+public:
+    SyntheticSensorCreateDesc(DeviceFactory* factory, const char* spec);
+
+    virtual DeviceCreateDesc* Clone() const
+    {
+        return new SyntheticSensorCreateDesc(*this);
+    }
+
+    virtual DeviceBase* NewDeviceInstance();
+
+    // The OVR_SYNTHETIC_SENSOR profile.
+    String  MotionSpec;
+};
+
+
+//-------------------------------------------------------------------------------------
+// ***** SyntheticSensorDevice
+
+// A SensorDeviceImpl attached to a SyntheticTracker instead of a HID device.
+
+class SyntheticSensorDevice : public SensorDeviceImpl
+{
+public:
+    SyntheticSensorDevice(SyntheticSensorCreateDesc* createDesc);
+
+    virtual void Shutdown();
+
+protected:
+    virtual HIDDevice* openHIDDevice(const HIDDeviceDesc& hidDesc);
+
+    // Held by the base class as its internal device.
+    SyntheticTracker* pTracker;
+};
+
+} // namespace OVR
+
+#endif // OVR_SyntheticSensor_h
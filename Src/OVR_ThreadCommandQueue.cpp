@@ -25,121 +25,13 @@ limitations under the License.
 ************************************************************************************/
 
 #include "OVR_ThreadCommandQueue.h"
+#include "Kernel/OVR_Alg.h"
+#include "Kernel/OVR_ObjectPool.h"
+#include "Kernel/OVR_PerfCounters.h"
 
 namespace OVR {
 
 
-//------------------------------------------------------------------------
-// ***** CircularBuffer
-
-// CircularBuffer is a FIFO buffer implemented in a single block of memory,
-// which allows writing and reading variable-size data chucks. Write fails
-// if buffer is full.
-
-class CircularBuffer
-{
-    enum {
-        AlignSize = 16,
-        AlignMask = AlignSize - 1
-    };
-
-    UByte*  pBuffer;
-    UPInt   Size;
-    UPInt   Tail;   // Byte offset of next item to be popped.
-    UPInt   Head;   // Byte offset of where next push will take place.
-    UPInt   End;    // When Head < Tail, this is used instead of Size.    
-
-    inline UPInt roundUpSize(UPInt size)
-    { return (size + AlignMask) & ~(UPInt)AlignMask; }
-
-public:
-
-    CircularBuffer(UPInt size)
-        : Size(size), Tail(0), Head(0), End(0)
-    {
-        pBuffer = (UByte*)OVR_ALLOC_ALIGNED(roundUpSize(size), AlignSize);
-    }
-    ~CircularBuffer()
-    {
-        // For ThreadCommands, we must consume everything before shutdown.
-        OVR_ASSERT(IsEmpty());
-        OVR_FREE_ALIGNED(pBuffer);
-    }
-
-    bool    IsEmpty() const { return (Head == Tail); }
-
-    // Allocates a state block of specified size and advances pointers,
-    // returning 0 if buffer is full.
-    UByte*  Write(UPInt size);
-
-    // Returns a pointer to next available data block; 0 if none available.
-    UByte*  ReadBegin()
-    { return (Head != Tail) ? (pBuffer + Tail) : 0; }
-    // Consumes data of specified size; this must match size passed to Write.
-    void    ReadEnd(UPInt size);
-};
-
-
-// Allocates a state block of specified size and advances pointers,
-// returning 0 if buffer is full.
-UByte* CircularBuffer::Write(UPInt size)
-{
-    UByte* p = 0;
-
-    size = roundUpSize(size);
-    // Since this is circular buffer, always allow at least one item.
-    OVR_ASSERT(size < Size/2);
-
-    if (Head >= Tail)
-    {
-        OVR_ASSERT(End == 0);
-        
-        if (size <= (Size - Head))
-        {
-            p    = pBuffer + Head;
-            Head += size;
-        }
-        else if (size < Tail)
-        {
-            p    = pBuffer;
-            End  = Head;
-            Head = size;
-            OVR_ASSERT(Head != Tail);
-        }
-    }
-    else
-    {
-        OVR_ASSERT(End != 0);
-
-        if ((Tail - Head) > size)
-        {
-            p    = pBuffer + Head;
-            Head += size;
-            OVR_ASSERT(Head != Tail);
-        }
-    }
-
-    return p;
-}
-
-void CircularBuffer::ReadEnd(UPInt size)
-{
-    OVR_ASSERT(Head != Tail);
-    size = roundUpSize(size);
-    
-    Tail += size;        
-    if (Tail == End)
-    {
-        Tail = End = 0;
-    }
-    else if (Tail == Head)
-    {        
-        OVR_ASSERT(End == 0);
-        Tail = Head = 0;
-    }
-}
-
-
 //-------------------------------------------------------------------------------------
 // ***** ThreadCommand
 
@@ -171,6 +63,18 @@ void ThreadCommand::PopBuffer::Execute()
 
 //-------------------------------------------------------------------------------------
 
+// Commands are kept in a ring of fixed-size slots. A producer claims the next ticket
+// with one atomic add and owns the slot ticket % SlotCount once the slot's Sequence
+// equals the ticket; it copies the command in and sets Sequence to ticket + 1 to
+// publish it. The consumer pops slots in ticket order and hands each back to the
+// producers of the next round by setting its Sequence to ticket + SlotCount. No
+// locks are taken; a producer only waits when the ring is full.
+//
+// The low bit of Tail is set once the exit command has been pushed, so that the
+// claim of a ticket and the check for exit are a single compare-and-set; pushes
+// refused after exit don't claim one.
+// Tickets count modulo 2^(bits - 1).
+
 class ThreadCommandQueueImpl : public NewOverrideBase
 {
     typedef ThreadCommand::NotifyEvent NotifyEvent;
@@ -178,15 +82,31 @@ class ThreadCommandQueueImpl : public NewOverrideBase
     
 public:
 
+    enum
+    {
+        SlotCount   = 32,
+        SlotSize    = 256,
+        // Producers blocked on a full ring check it again at least this often.
+        FullWaitMs  = 1
+    };
+
     ThreadCommandQueueImpl(ThreadCommandQueue* queue)
-        : pQueue(queue), ExitEnqueued(false), ExitProcessed(false), CommandBuffer(2048)
+        : pQueue(queue), Tail(0), Head(0), Idle(0), HighWaterMark(0),
+          BlockedProducers(0), ExitProcessed(false)
     {
+        OVR_COMPILER_ASSERT((SlotCount & (SlotCount - 1)) == 0);
+        for (UPInt i = 0; i < SlotCount; i++)
+            Slots[i].Sequence.Store_Relaxed(i);
     }
     ~ThreadCommandQueueImpl();
 
 
     bool PushCommand(const ThreadCommand& command);
     bool PopCommand(ThreadCommand::PopBuffer* popBuffer);
+    void PushExitCommand(bool wait);
+
+    UPInt GetDepth() const
+    { return committedFrom(Head.Load_Acquire()); }
 
 
     // ExitCommand is used by notify us that Thread is shutting down.
@@ -199,7 +119,6 @@ public:
 
         virtual void Execute() const
         {
-            Lock::Locker lock(&pImpl->QueueLock);
             pImpl->ExitProcessed = true;
         }
         virtual ThreadCommand* CopyConstruct(void* p) const 
@@ -207,128 +126,200 @@ public:
     };
 
 
-    NotifyEvent* AllocNotifyEvent_NTS()
+    // Events come from an inline pool; the heap is only touched if more than
+    // EventPoolSize producers are waiting at once.
+    NotifyEvent* AllocNotifyEvent()
     {
-        NotifyEvent* p = AvailableEvents.GetFirst();
+        return EventPool.New();
+    }
 
-        if (!AvailableEvents.IsNull(p))
-            p->RemoveNode();        
-        else
-            p = new NotifyEvent;
-        return p;
+    void         FreeNotifyEvent(NotifyEvent* p)
+    {
+        EventPool.Delete(p);
     }
 
-    void         FreeNotifyEvent_NTS(NotifyEvent* p)
+private:
+    static const UPInt TicketMask = ~(UPInt)0 >> 1;
+
+    struct Slot
     {
-        AvailableEvents.PushBack(p);
+        AtomicInt<UPInt>    Sequence;
+        union {
+            UByte           Data[SlotSize];
+            UPInt           Align;
+        };
+    };
+
+    // Number of tickets from first to end, or 0 if end isn't after first.
+    static UPInt ticketsBetween(UPInt first, UPInt end)
+    {
+        UPInt count = (end - first) & TicketMask;
+        return (count > TicketMask / 2) ? 0 : count;
     }
 
-    void        FreeNotifyEvents_NTS()
+    // Number of slots published from ticket first on, and not yet popped; tickets
+    // claimed by producers still copying their command aren't counted.
+    UPInt committedFrom(UPInt first) const
     {
-        while(!AvailableEvents.IsEmpty())
+        UPInt claimed = Alg::Min(ticketsBetween(first, Tail.Load_Acquire() / 2), (UPInt)SlotCount);
+        UPInt count   = 0;
+        for (UPInt i = 0; i < claimed; i++)
         {
-            NotifyEvent* p = AvailableEvents.GetFirst();
-            p->RemoveNode();
-            delete p;
+            UPInt ticket = (first + i) & TicketMask;
+            if (Slots[ticket & (SlotCount - 1)].Sequence.Load_Acquire() == ((ticket + 1) & TicketMask))
+                count++;
         }
+        return count;
     }
 
+    // Copies the command into the slot of ticket, once the consumer is done with
+    // it, and publishes it.
+    ThreadCommand* writeSlot(UPInt ticket, const ThreadCommand& command, NotifyEvent* completeEvent);
+
     ThreadCommandQueue* pQueue;
-    Lock                QueueLock;
-    volatile bool       ExitEnqueued;
+    // Next ticket to claim, times two, plus the exit bit.
+    AtomicInt<UPInt>    Tail;
+    // Next ticket to pop; only written by the consumer.
+    AtomicInt<UPInt>    Head;
+    // Set by the consumer when it finds the queue empty; the first producer to
+    // clear it wakes the consumer.
+    AtomicInt<UInt32>   Idle;
+    AtomicInt<UPInt>    HighWaterMark;
+    // Producers waiting for a slot to be freed.
+    AtomicInt<UInt32>   BlockedProducers;
+    Event               SlotFreed;
     volatile bool       ExitProcessed;
-    List<NotifyEvent>   AvailableEvents;
-    List<NotifyEvent>   BlockedProducers;
-    CircularBuffer      CommandBuffer;
+    enum { EventPoolSize = 16 };
+
+    ObjectPool<NotifyEvent, EventPoolSize> EventPool;
+    Slot                Slots[SlotCount];
 };
 
 
 
 ThreadCommandQueueImpl::~ThreadCommandQueueImpl()
 {
-    Lock::Locker lock(&QueueLock);
-    OVR_ASSERT(BlockedProducers.IsEmpty());
-    FreeNotifyEvents_NTS();
+    OVR_ASSERT(BlockedProducers == 0);
 }
 
-bool ThreadCommandQueueImpl::PushCommand(const ThreadCommand& command)
+ThreadCommand* ThreadCommandQueueImpl::writeSlot(UPInt ticket, const ThreadCommand& command,
+                                                 NotifyEvent* completeEvent)
 {
-    ThreadCommand::NotifyEvent* completeEvent = 0;
-    ThreadCommand::NotifyEvent* queueAvailableEvent = 0;
+    Slot& slot = Slots[ticket & (SlotCount - 1)];
 
-    // Repeat  writing command into buffer until it is available.    
-    do {
+    if (slot.Sequence.Load_Acquire() != ticket)
+    {
+        // The ring is full; wait for the consumer to free this slot.
+        BlockedProducers.Increment_Sync();
+        while (slot.Sequence.Load_Acquire() != ticket)
+            SlotFreed.Wait(FullWaitMs);
+        BlockedProducers.ExchangeAdd_Sync((UInt32)-1);
+    }
 
-        { // Lock Scope
-            Lock::Locker lock(&QueueLock);
+    ThreadCommand* c = command.CopyConstruct(slot.Data);
+    c->pEvent = completeEvent;
+    slot.Sequence.Store_Release((ticket + 1) & TicketMask);
+
+    // Only wake the consumer if it is waiting for commands. The fence orders the
+    // publication before the load of Idle, pairing with the exchange in PopCommand.
+    AtomicFence_Full();
+    if (Idle.Load_Relaxed() && Idle.Exchange_Sync(0))
+        pQueue->OnPushNonEmpty();
+
+    // The consumer may already be past our ticket.
+    UPInt depth = ticketsBetween(Head.Load_Acquire(), ticket + 1);
+    UPInt mark  = HighWaterMark.Load_Relaxed();
+    while (depth > mark && !HighWaterMark.CompareAndSet_NoSync(mark, depth))
+        mark = HighWaterMark.Load_Relaxed();
+    return c;
+}
 
-            if (queueAvailableEvent)
-            {
-                FreeNotifyEvent_NTS(queueAvailableEvent);
-                queueAvailableEvent = 0;
-            }
+bool ThreadCommandQueueImpl::PushCommand(const ThreadCommand& command)
+{
+    OVR_ASSERT(command.GetSize() <= SlotSize);
+    if (command.GetSize() > SlotSize)
+        return false;
 
-            // Don't allow any commands after PushExitCommand() is called.
-            if (ExitEnqueued && !command.ExitFlag)
-                return false;
+    // Don't allow any commands after PushExitCommand() is called.
+    UPInt tail;
+    do
+    {
+        tail = Tail.Load_Acquire();
+        if (tail & 1)
+            return false;
+    } while (!Tail.CompareAndSet_Sync(tail, tail + 2));
 
+    NotifyEvent* completeEvent = command.NeedsWait() ? AllocNotifyEvent() : 0;
+    writeSlot((tail / 2) & TicketMask, command, completeEvent);
 
-            bool   bufferWasEmpty = CommandBuffer.IsEmpty();
-            UByte* buffer = CommandBuffer.Write(command.GetSize());
-            if  (buffer)
-            {
-                ThreadCommand* c = command.CopyConstruct(buffer);
-                if (c->NeedsWait())
-                    completeEvent = c->pEvent = AllocNotifyEvent_NTS();
-                // Signal-waker consumer when we add data to buffer.
-                if (bufferWasEmpty)
-                    pQueue->OnPushNonEmpty_Locked();
-                break;
-            }
+    // Command was enqueued, wait if necessary.
+    if (completeEvent)
+    {
+        completeEvent->Wait();
+        FreeNotifyEvent(completeEvent);
+    }
 
-            queueAvailableEvent = AllocNotifyEvent_NTS();
-            BlockedProducers.PushBack(queueAvailableEvent);
-        } // Lock Scope
+    return true;
+}
 
-        queueAvailableEvent->Wait();
+void ThreadCommandQueueImpl::PushExitCommand(bool wait)
+{
+    // Exit is processed in two stages:
+    //  - First, the exit bit is set to block further commands from queuing up.
+    //  - Second, the actual exit call is processed on the consumer thread, flushing
+    //    any prior commands.
+    //    IsExiting() only returns true after exit has flushed.
+    UPInt tail;
+    do
+    {
+        tail = Tail.Load_Acquire();
+        if (tail & 1)
+            return;
+    } while (!Tail.CompareAndSet_Sync(tail, (tail + 2) | 1));
 
-    } while(1);
+    ExitCommand  command(this, wait);
+    NotifyEvent* completeEvent = wait ? AllocNotifyEvent() : 0;
+    writeSlot((tail / 2) & TicketMask, command, completeEvent);
 
-    // Command was enqueued, wait if necessary.
     if (completeEvent)
     {
         completeEvent->Wait();
-        Lock::Locker lock(&QueueLock);
-        FreeNotifyEvent_NTS(completeEvent);
+        FreeNotifyEvent(completeEvent);
     }
-
-    return true;
 }
 
 
+// Commands queued when one is popped, counting that one.
+static PerfCounter QueueDepthCounter("perf.commandQueue.depth");
+
 // Pops the next command from the thread queue, if any is available.
 bool ThreadCommandQueueImpl::PopCommand(ThreadCommand::PopBuffer* popBuffer)
 {    
-    Lock::Locker lock(&QueueLock);
+    UPInt head = Head.Load_Relaxed();
+    Slot& slot = Slots[head & (SlotCount - 1)];
 
-    UByte* buffer = CommandBuffer.ReadBegin();
-    if (!buffer)
+    if (slot.Sequence.Load_Acquire() != ((head + 1) & TicketMask))
     {
-        // Notify thread while in lock scope, enabling initialization of wait.
-        pQueue->OnPopEmpty_Locked();
-        return false;
+        // Going idle; check again afterwards, since a producer that published
+        // before seeing Idle won't wake us.
+        Idle.Exchange_Sync(1);
+        if (slot.Sequence.Load_Acquire() != ((head + 1) & TicketMask))
+        {
+            pQueue->OnPopEmpty();
+            return false;
+        }
+        Idle.Store_Relaxed(0);
     }
 
-    popBuffer->InitFromBuffer(buffer);
-    CommandBuffer.ReadEnd(popBuffer->GetSize());
+    QueueDepthCounter.Record((double)committedFrom(head));
 
-    if (!BlockedProducers.IsEmpty())
-    {
-        ThreadCommand::NotifyEvent* queueAvailableEvent = BlockedProducers.GetFirst();
-        queueAvailableEvent->RemoveNode();
-        queueAvailableEvent->PulseEvent();
-        // Event is freed later by waiter.
-    }    
+    popBuffer->InitFromBuffer(slot.Data);
+    Head.Store_Release((head + 1) & TicketMask);
+    slot.Sequence.Store_Release((head + SlotCount) & TicketMask);
+
+    // Not fenced; a producer whose wake is missed finds its slot on its next check.
+    if (BlockedProducers.Load_Relaxed())
+        SlotFreed.PulseEvent();
     return true;
 }
 
@@ -344,6 +335,21 @@ ThreadCommandQueue::~ThreadCommandQueue()
     delete pImpl;
 }
 
+UInt32 ThreadCommandQueue::GetEventHeapAllocCount() const
+{
+    return pImpl->EventPool.GetHeapAllocCount();
+}
+
+UPInt ThreadCommandQueue::GetDepth() const
+{
+    return pImpl->GetDepth();
+}
+
+UPInt ThreadCommandQueue::GetHighWaterMark() const
+{
+    return pImpl->HighWaterMark.Load_Relaxed();
+}
+
 bool ThreadCommandQueue::PushCommand(const ThreadCommand& command)
 {
     return pImpl->PushCommand(command);
@@ -356,19 +362,7 @@ bool ThreadCommandQueue::PopCommand(ThreadCommand::PopBuffer* popBuffer)
 
 void ThreadCommandQueue::PushExitCommand(bool wait)
 {
-    // Exit is processed in two stages:
-    //  - First, ExitEnqueued flag is set to block further commands from queuing up.
-    //  - Second, the actual exit call is processed on the consumer thread, flushing
-    //    any prior commands.
-    //    IsExiting() only returns true after exit has flushed.
-    {
-        Lock::Locker lock(&pImpl->QueueLock);
-        if (pImpl->ExitEnqueued)
-            return;
-        pImpl->ExitEnqueued = true;
-    }
-
-    PushCommand(ThreadCommandQueueImpl::ExitCommand(pImpl, wait));
+    pImpl->PushExitCommand(wait);
 }
 
 bool ThreadCommandQueue::IsExiting() const
@@ -220,7 +220,7 @@ public:
 // ThreadCommandQueue is a queue of executable function-call commands intended to be
 // serviced by a single consumer thread. Commands are added to the queue with PushCall
 // and removed with PopCall; they are processed in FIFO order. Multiple producer threads
-// are supported and will be blocked if internal data buffer is full.
+// are supported; pushing is lock-free and only blocks while the queue is full.
 
 class ThreadCommandQueue
 {
@@ -236,6 +236,8 @@ public:
     bool PopCommand(ThreadCommand::PopBuffer* popBuffer);
 
     // Generic implementaion of PushCommand; enqueues a command for execution.
+    // Returns false if the queue is exiting, or if the command is larger than a
+    // queue slot.
     // Returns 'false' if push failed, usually indicating thread shutdown.
     bool PushCommand(const ThreadCommand& command);
 
@@ -245,11 +247,22 @@ public:
     // Returns 'true' once ExitCommand has been processed, so the thread can shut down.
     bool IsExiting() const;
 
+    // Number of NotifyEvents that could not be served by the queue's inline
+    // event pool and were heap-allocated; stays 0 in steady-state operation.
+    UInt32 GetEventHeapAllocCount() const;
+
+    // Number of commands currently queued and not yet popped, and the most that
+    // have been queued at once since the queue was created.
+    UPInt  GetDepth() const;
+    UPInt  GetHighWaterMark() const;
+
 
     // These two virtual functions serve as notifications for derived
-    // thread waiting.    
-    virtual void OnPushNonEmpty_Locked() { }
-    virtual void OnPopEmpty_Locked()     { }
+    // thread waiting. OnPopEmpty is called on the consumer thread when PopCommand
+    // finds the queue empty; OnPushNonEmpty is called on a producer thread, once
+    // after each OnPopEmpty that is followed by a push.
+    virtual void OnPushNonEmpty() { }
+    virtual void OnPopEmpty()     { }
 
 
     // *** PushCall with no result
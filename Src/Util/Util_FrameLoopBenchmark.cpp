@@ -0,0 +1,391 @@
+/************************************************************************************
+
+Filename    :   Util_FrameLoopBenchmark.cpp
+Content     :   Headless benchmark of the C API frame loop
+Created     :   October 14, 2026
+Notes       :
+
+Copyright   :   Copyright 2014 Oculus VR, Inc. All Rights reserved.
+
+Licensed under the Oculus VR Rift SDK License Version 3.1 (the "License");
+you may not use the Oculus VR Rift SDK except in compliance with the License,
+which is provided at the time of installation or download, or which
+otherwise accompanies this software in either electronic or hard copy form.
+
+You may obtain a copy of the License at
+
+http://www.oculusvr.com/licenses/LICENSE-3.1
+
+Unless required by applicable law or agreed to in writing, the Oculus VR SDK
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+*************************************************************************************/
+
+#include "Util_FrameLoopBenchmark.h"
+
+#if defined(OVR_FRAMELOOP_BENCHMARK) && defined(OVR_OS_LINUX)
+
+#include "../OVR_CAPI_GL.h"
+#include "../OVR_JSON.h"
+#include "../Kernel/OVR_Alg.h"
+#include "../Kernel/OVR_Allocator.h"
+#include "../Kernel/OVR_Atomic.h"
+#include "../Kernel/OVR_Log.h"
+#include "../Kernel/OVR_PerfCounters.h"
+#include "../Kernel/OVR_System.h"
+
+#include <stdlib.h>
+#include <time.h>
+
+namespace OVR { namespace Util {
+
+namespace FrameLoopBenchmark {
+
+enum { WarmupFrames = 60 };
+
+// The default allocator, counting what passes through it.
+class CountingAllocator : public Allocator_SingletonSupport<CountingAllocator>
+{
+public:
+    virtual void* Alloc(UPInt size)
+    {
+        count(size);
+        return malloc(size);
+    }
+    virtual void* AllocDebug(UPInt size, const char* file, unsigned line)
+    {
+        OVR_UNUSED2(file, line);
+        return Alloc(size);
+    }
+    virtual void* Realloc(void* p, UPInt newSize)
+    {
+        count(newSize);
+        return realloc(p, newSize);
+    }
+    virtual void  Free(void* p)
+    {
+        free(p);
+    }
+
+    static AtomicInt<UInt32> Allocs;
+    static AtomicInt<UInt32> Bytes;
+
+private:
+    static void count(UPInt size)
+    {
+        Allocs.ExchangeAdd_NoSync(1);
+        Bytes.ExchangeAdd_NoSync((UInt32)size);
+    }
+};
+
+AtomicInt<UInt32> CountingAllocator::Allocs;
+AtomicInt<UInt32> CountingAllocator::Bytes;
+
+
+// Thread CPU and wall time of one SDK call, over the measured frames.
+struct CallTimes
+{
+    const char* Name;
+    double      CpuSum, CpuMax;
+    double      WallSum, WallMax;
+    unsigned    Count;
+
+    CallTimes(const char* name)
+        : Name(name), CpuSum(0), CpuMax(0), WallSum(0), WallMax(0), Count(0) { }
+
+    void Record(double cpu, double wall)
+    {
+        CpuSum  += cpu;
+        WallSum += wall;
+        CpuMax  = Alg::Max(CpuMax, cpu);
+        WallMax = Alg::Max(WallMax, wall);
+        Count++;
+    }
+
+    JSON* ToJSON() const
+    {
+        JSON* call = JSON::CreateObject();
+        call->AddNumberItem("cpuMeanUs",  Count ? CpuSum * 1e6 / Count : 0.0);
+        call->AddNumberItem("cpuMaxUs",   CpuMax * 1e6);
+        call->AddNumberItem("wallMeanUs", Count ? WallSum * 1e6 / Count : 0.0);
+        call->AddNumberItem("wallMaxUs",  WallMax * 1e6);
+        return call;
+    }
+};
+
+// Times the calls made between its construction and Stop.
+class CallTimer
+{
+public:
+    CallTimer() : CpuStart(getThreadCpuSeconds()), WallStart(Timer::GetSeconds()) { }
+
+    void Stop(CallTimes* times, bool measured)
+    {
+        double cpu  = getThreadCpuSeconds() - CpuStart;
+        double wall = Timer::GetSeconds() - WallStart;
+        if (measured)
+            times->Record(cpu, wall);
+    }
+
+private:
+    static double getThreadCpuSeconds()
+    {
+        timespec ts;
+        clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+        return ts.tv_sec + ts.tv_nsec * 1e-9;
+    }
+
+    double CpuStart;
+    double WallStart;
+};
+
+// An offscreen GL context the size of the HMD screen, for the distortion
+// renderer to draw and swap in place of the headset window.
+struct PbufferContext
+{
+    Display*    Disp;
+    GLXPbuffer  Pbuffer;
+    GLXContext  Context;
+
+    PbufferContext() : Disp(0), Pbuffer(0), Context(0) { }
+    ~PbufferContext()
+    {
+        if (!Disp)
+            return;
+        glXMakeContextCurrent(Disp, None, None, 0);
+        if (Context)
+            glXDestroyContext(Disp, Context);
+        if (Pbuffer)
+            glXDestroyPbuffer(Disp, Pbuffer);
+        XCloseDisplay(Disp);
+    }
+
+    bool Create(int width, int height)
+    {
+        Disp = XOpenDisplay(0);
+        if (!Disp)
+            return false;
+
+        static const int configAttribs[] =
+        {
+            GLX_DRAWABLE_TYPE,  GLX_PBUFFER_BIT,
+            GLX_RENDER_TYPE,    GLX_RGBA_BIT,
+            GLX_RED_SIZE,       8,
+            GLX_GREEN_SIZE,     8,
+            GLX_BLUE_SIZE,      8,
+            GLX_DEPTH_SIZE,     24,
+            GLX_DOUBLEBUFFER,   True,
+            None
+        };
+        int          configCount = 0;
+        GLXFBConfig* configs = glXChooseFBConfig(Disp, DefaultScreen(Disp), configAttribs, &configCount);
+        if (!configs)
+            return false;
+
+        const int pbufferAttribs[] =
+        {
+            GLX_PBUFFER_WIDTH,  width,
+            GLX_PBUFFER_HEIGHT, height,
+            None
+        };
+        if (configCount > 0)
+        {
+            Pbuffer = glXCreatePbuffer(Disp, configs[0], pbufferAttribs);
+            Context = glXCreateNewContext(Disp, configs[0], GLX_RGBA_TYPE, 0, True);
+        }
+        XFree(configs);
+
+        return Pbuffer && Context &&
+               glXMakeContextCurrent(Disp, Pbuffer, Pbuffer, Context);
+    }
+};
+
+// Runs the frames on hmd and reports them.
+bool runFrames(ovrHmd hmd, const char* outputPath, unsigned frameCount)
+{
+    ovrHmdDesc hmdDesc;
+    ovrHmd_GetDesc(hmd, &hmdDesc);
+
+    PbufferContext context;
+    if (!context.Create(hmdDesc.Resolution.w, hmdDesc.Resolution.h))
+    {
+        LogError("FrameLoopBenchmark: Failed to create a GLX pbuffer context.\n");
+        return false;
+    }
+
+    ovrHmd_StartSensor(hmd, ovrSensorCap_Orientation | ovrSensorCap_YawCorrection, 0);
+
+    ovrGLConfig config;
+    config.OGL.Header.API         = ovrRenderAPI_OpenGL;
+    config.OGL.Header.RTSize      = hmdDesc.Resolution;
+    config.OGL.Header.Multisample = 0;
+    config.OGL.Disp               = context.Disp;
+    config.OGL.Win                = context.Pbuffer;
+
+    ovrEyeRenderDesc eyeRenderDesc[ovrEye_Count];
+    unsigned         distortionCaps = ovrDistortionCap_Chromatic | ovrDistortionCap_TimeWarp |
+                                      ovrDistortionCap_Vignette;
+
+    if (!ovrHmd_ConfigureRendering(hmd, &config.Config, distortionCaps,
+                                   hmdDesc.DefaultEyeFov, eyeRenderDesc))
+    {
+        LogError("FrameLoopBenchmark: ovrHmd_ConfigureRendering failed.\n");
+        ovrHmd_StopSensor(hmd);
+        return false;
+    }
+
+    // The eyes aren't drawn into; the textures only need to exist.
+    GLuint       eyeTextureIds[ovrEye_Count];
+    ovrGLTexture eyeTextures[ovrEye_Count];
+    glGenTextures(ovrEye_Count, eyeTextureIds);
+    for (int eye = 0; eye < ovrEye_Count; eye++)
+    {
+        ovrSizei size = ovrHmd_GetFovTextureSize(hmd, (ovrEyeType)eye, hmdDesc.DefaultEyeFov[eye], 1.0f);
+        glBindTexture(GL_TEXTURE_2D, eyeTextureIds[eye]);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, size.w, size.h, 0, GL_RGBA, GL_UNSIGNED_BYTE, 0);
+
+        ovrTextureHeader& header = eyeTextures[eye].OGL.Header;
+        header.API                  = ovrRenderAPI_OpenGL;
+        header.TextureSize          = size;
+        header.RenderViewport.Pos.x = 0;
+        header.RenderViewport.Pos.y = 0;
+        header.RenderViewport.Size  = size;
+        eyeTextures[eye].OGL.TexId  = eyeTextureIds[eye];
+    }
+    glBindTexture(GL_TEXTURE_2D, 0);
+
+    CallTimes beginFrame("ovrHmd_BeginFrame");
+    CallTimes beginEyeRender("ovrHmd_BeginEyeRender");
+    CallTimes endEyeRender("ovrHmd_EndEyeRender");
+    CallTimes endFrame("ovrHmd_EndFrame");
+
+    PerfCounter*     gpuTimeCounter = PerfCounter::Find("perf.distortion.gpuTime");
+    PerfCounterValue gpuTimeStart;
+    UInt32           allocsStart = 0, bytesStart = 0;
+    double           loopStart   = 0;
+
+    for (unsigned frame = 0; frame < WarmupFrames + frameCount; frame++)
+    {
+        bool measured = (frame >= WarmupFrames);
+        if (frame == WarmupFrames)
+        {
+            if (gpuTimeCounter)
+                gpuTimeStart = gpuTimeCounter->GetValue();
+            allocsStart = CountingAllocator::Allocs;
+            bytesStart  = CountingAllocator::Bytes;
+            loopStart   = Timer::GetSeconds();
+        }
+
+        CallTimer beginFrameTimer;
+        ovrHmd_BeginFrame(hmd, frame);
+        beginFrameTimer.Stop(&beginFrame, measured);
+
+        for (int i = 0; i < ovrEye_Count; i++)
+        {
+            ovrEyeType eye = hmdDesc.EyeRenderOrder[i];
+
+            CallTimer beginEyeTimer;
+            ovrPosef  pose = ovrHmd_BeginEyeRender(hmd, eye);
+            beginEyeTimer.Stop(&beginEyeRender, measured);
+
+            CallTimer endEyeTimer;
+            ovrHmd_EndEyeRender(hmd, eye, pose, &eyeTextures[eye].Texture);
+            endEyeTimer.Stop(&endEyeRender, measured);
+        }
+
+        CallTimer endFrameTimer;
+        ovrHmd_EndFrame(hmd);
+        endFrameTimer.Stop(&endFrame, measured);
+    }
+
+    double loopTime = Timer::GetSeconds() - loopStart;
+    UInt32 allocs   = CountingAllocator::Allocs - allocsStart;
+    UInt32 bytes    = CountingAllocator::Bytes - bytesStart;
+    double gpuTime  = 0;
+    if (gpuTimeCounter)
+    {
+        PerfCounterValue gpuTimeEnd = gpuTimeCounter->GetValue();
+        if (gpuTimeEnd.Count > gpuTimeStart.Count)
+            gpuTime = (gpuTimeEnd.Sum - gpuTimeStart.Sum) / (gpuTimeEnd.Count - gpuTimeStart.Count);
+    }
+
+    ovrHmd_ConfigureRendering(hmd, 0, 0, hmdDesc.DefaultEyeFov, eyeRenderDesc);
+    glDeleteTextures(ovrEye_Count, eyeTextureIds);
+    ovrHmd_StopSensor(hmd);
+
+    JSON* report = JSON::CreateObject();
+    report->AddStringItem("benchmark", "frameLoop");
+    report->AddStringItem("motion", getenv("OVR_SYNTHETIC_SENSOR"));
+    report->AddNumberItem("frames", frameCount);
+    report->AddNumberItem("frameMeanUs", frameCount ? loopTime * 1e6 / frameCount : 0.0);
+
+    JSON* calls = JSON::CreateObject();
+    calls->AddItem(beginFrame.Name,     beginFrame.ToJSON());
+    calls->AddItem(beginEyeRender.Name, beginEyeRender.ToJSON());
+    calls->AddItem(endEyeRender.Name,   endEyeRender.ToJSON());
+    calls->AddItem(endFrame.Name,       endFrame.ToJSON());
+    report->AddItem("calls", calls);
+
+    report->AddNumberItem("allocsPerFrame", frameCount ? (double)allocs / frameCount : 0.0);
+    report->AddNumberItem("bytesPerFrame",  frameCount ? (double)bytes / frameCount : 0.0);
+    report->AddNumberItem("gpuTimeMs",      gpuTime * 1000.0);
+
+    bool result = true;
+    if (outputPath)
+    {
+        result = report->Save(outputPath);
+        if (!result)
+            LogError("FrameLoopBenchmark: Failed to save %s.\n", outputPath);
+    }
+    else
+    {
+        ArrayPOD<char> text;
+        report->Print(&text, false);
+        text.PushBack(0);
+        LogText("FrameLoopBenchmark: %s\n", &text[0]);
+    }
+    report->Release();
+    return result;
+}
+
+} // FrameLoopBenchmark
+
+
+bool RunFrameLoopBenchmark(const char* outputPath, unsigned frameCount)
+{
+    using namespace FrameLoopBenchmark;
+
+    if (System::IsInitialized())
+        return false;
+
+    // Without hardware the head motion is generated; a profile set by the caller
+    // is kept.
+    setenv("OVR_SYNTHETIC_SENSOR", "sine", 0);
+
+    System::Init(Log::ConfigureDefaultLog(LogMask_All), CountingAllocator::InitSystemSingleton());
+    ovr_Initialize();
+
+    bool   result = false;
+    ovrHmd hmd    = ovrHmd_Create(0);
+    if (hmd)
+    {
+        result = runFrames(hmd, outputPath, frameCount);
+        ovrHmd_Destroy(hmd);
+    }
+    else
+    {
+        LogError("FrameLoopBenchmark: No HMD.\n");
+    }
+
+    ovr_Shutdown();
+    System::Destroy();
+    return result;
+}
+
+}} // namespace OVR::Util
+
+#endif // OVR_FRAMELOOP_BENCHMARK
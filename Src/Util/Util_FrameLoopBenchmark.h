@@ -0,0 +1,62 @@
+/************************************************************************************
+
+Filename    :   Util_FrameLoopBenchmark.h
+Content     :   Headless benchmark of the C API frame loop
+Created     :   October 14, 2026
+Notes       :
+
+Copyright   :   Copyright 2014 Oculus VR, Inc. All Rights reserved.
+
+Licensed under the Oculus VR Rift SDK License Version 3.1 (the "License");
+you may not use the Oculus VR Rift SDK except in compliance with the License,
+which is provided at the time of installation or download, or which
+otherwise accompanies this software in either electronic or hard copy form.
+
+You may obtain a copy of the License at
+
+http://www.oculusvr.com/licenses/LICENSE-3.1
+
+Unless required by applicable law or agreed to in writing, the Oculus VR SDK
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+*************************************************************************************/
+
+#ifndef OVR_Util_FrameLoopBenchmark_h
+#define OVR_Util_FrameLoopBenchmark_h
+
+#include "../Kernel/OVR_Types.h"
+
+// Define to build RunFrameLoopBenchmark, which times the SDK calls of an
+// application's frame loop without a headset or a window. Linux only.
+//#define OVR_FRAMELOOP_BENCHMARK
+
+#if defined(OVR_FRAMELOOP_BENCHMARK) && defined(OVR_OS_LINUX)
+
+namespace OVR { namespace Util {
+
+// Runs frameCount frames of ovrHmd_BeginFrame, ovrHmd_BeginEyeRender and
+// ovrHmd_EndEyeRender for each eye, and ovrHmd_EndFrame, with distortion rendered
+// by GL into an offscreen GLX pbuffer and the head moved by the synthetic sensor
+// (OVR_SYNTHETIC_SENSOR, "sine" unless set). Reports, as one JSON object:
+//
+//   "calls"         Thread CPU and wall time of each call, mean and max, in
+//                   microseconds.
+//   "allocsPerFrame", "bytesPerFrame"
+//                   Allocations made through the OVR allocator, on any thread,
+//                   per frame.
+//   "gpuTimeMs"     Mean distortion GPU time, from perf.distortion.gpuTime.
+//
+// The object is saved to outputPath, or logged on one line if it is null.
+// Call instead of ovr_Initialize, before System::Init; the benchmark sets up the
+// system itself, to count allocations. Returns false if no GL context or HMD
+// could be set up.
+bool RunFrameLoopBenchmark(const char* outputPath, unsigned frameCount = 1000);
+
+}} // namespace OVR::Util
+
+#endif // OVR_FRAMELOOP_BENCHMARK
+
+#endif // OVR_Util_FrameLoopBenchmark_h
@@ -96,8 +96,19 @@ LRESULT CALLBACK MainWndProc(
 }
 
 ImageWindow::ImageWindow( uint32_t width, uint32_t height ) :
-	frontBufferMutex( new Mutex() )
+	drawIndex( 0 ),
+	paintIndex( 2 ),
+	nextFrameNumber( 0 )
 {
+	readyState.Store_Release( 1 );
+
+	// Buffers are made for the resolution up front; larger images grow them once.
+	for( int i = 0; i < FramePoolSize; ++i )
+	{
+		framePool[i] = *new Frame( 0 );
+		framePool[i]->ReserveImage( false, width * height );
+		framePool[i]->ReserveImage( true, width * height * 4 );
+	}
 
 	HINSTANCE hInst = LoadLibrary( L"d2d1.dll" );
 	HINSTANCE hInstWrite = LoadLibrary( L"Dwrite.dll" );
@@ -166,16 +177,9 @@ ImageWindow::~ImageWindow()
 	if( pRT )
 		pRT->Release();
 
-	{
-		Mutex::Locker locker( frontBufferMutex  );
-
-		while( frames.GetSize() )
-		{
-			Ptr<Frame> aFrame = frames.PopBack();
-		}
-	}
-
-	delete frontBufferMutex;
+	// Gives wrapped images back.
+	for( int i = 0; i < FramePoolSize; ++i )
+		framePool[i].Clear();
 
 	ShowWindow( hWindow, SW_HIDE );
 	DestroyWindow( hWindow );
@@ -266,53 +270,39 @@ void ImageWindow::Process()
 
 void ImageWindow::Complete()
 {
-	Mutex::Locker locker( frontBufferMutex  );
-
-	if( frames.IsEmpty() )
-		return;
+	Frame* frame = drawingFrame();
 
-	if( frames.PeekBack(0)->ready )
+	// Nothing was drawn since the last frame
+	if( !frame->greyImage && !frame->colorImage &&
+		frame->plots.GetSize() == 0 && frame->textLines.GetSize() == 0 )
 		return;
 
-	Ptr<Frame> frame = frames.PeekBack(0);
-
+	frame->frameNumber = nextFrameNumber++;
 	frame->ready = true;
+
+	// Takes back the ready frame, painted or not, to draw the next one in.
+	drawIndex = readyState.Exchange_Sync( drawIndex | ReadyFresh ) & ~ReadyFresh;
+	framePool[drawIndex]->Recycle();
 }
 
 void ImageWindow::OnPaint()
 {
-	Mutex::Locker locker( frontBufferMutex  );
+	Mutex::Locker locker( &paintMutex );
 
 	// Nothing to do
-	if( frames.IsEmpty() )
+	if( !( readyState.Load_Acquire() & ReadyFresh ) )
 		return;
 
-	if( !frames.PeekFront(0)->ready )
-		return;
-
-	Ptr<Frame> currentFrame = frames.PopFront();
-
-	Ptr<Frame> nextFrame = NULL;
-
-	if( !frames.IsEmpty() )
-		nextFrame = frames.PeekFront(0);
-	
-	while( nextFrame && nextFrame->ready )
-	{
-		// Free up the current frame since it's been removed from the deque
-		currentFrame = frames.PopFront();
+	// The frame painted last goes back to be recycled by the drawing thread.
+	paintIndex = readyState.Exchange_Sync( paintIndex ) & ~ReadyFresh;
 
-		if( frames.IsEmpty() )
-			break;
-
-		nextFrame = frames.PeekFront(0);
-	}
+	Frame* currentFrame = framePool[paintIndex];
 
-	if( currentFrame->imageData )
-		greyBitmap->CopyFromMemory( NULL, currentFrame->imageData, currentFrame->width );
+	if( currentFrame->greyImage )
+		greyBitmap->CopyFromMemory( NULL, currentFrame->greyImage, currentFrame->width );
 
-	if( currentFrame->colorImageData )
-		colorBitmap->CopyFromMemory( NULL, currentFrame->colorImageData, currentFrame->colorPitch );
+	if( currentFrame->colorImage )
+		colorBitmap->CopyFromMemory( NULL, currentFrame->colorImage, currentFrame->colorPitch );
 
 	pRT->BeginDraw();
 
@@ -331,7 +321,7 @@ void ImageWindow::OnPaint()
 
 	pRT->CreateSolidColorBrush( D2D1::ColorF(D2D1::ColorF::White, 1.0f), &whiteBrush );
 
-	if( currentFrame->imageData )
+	if( currentFrame->greyImage )
 	{
 		pRT->FillOpacityMask( greyBitmap, whiteBrush, 
 			D2D1_OPACITY_MASK_CONTENT_TEXT_NATURAL, 
@@ -339,7 +329,7 @@ void ImageWindow::OnPaint()
 			//D2D1::RectF( 0.0f, 0.0f, (FLOAT)0.0f, (FLOAT)resolution.height ), 
 			D2D1::RectF( 0.0f, 0.0f, (FLOAT)resolution.width, (FLOAT)resolution.height ) );
 	}
-	else if( currentFrame->colorImageData )
+	else if( currentFrame->colorImage )
 	{
 		pRT->DrawBitmap( colorBitmap,
 			D2D1::RectF( -(FLOAT)resolution.width, 0.0f, (FLOAT)0.0f, (FLOAT)resolution.height ) );
@@ -420,48 +410,67 @@ void ImageWindow::OnPaint()
 	pRT->Flush();
 }
 
-Ptr<Frame> ImageWindow::lastUnreadyFrame()
+void ImageWindow::UpdateImageBW( const uint8_t* imageData, uint32_t width, uint32_t height )
 {
-	static int framenumber = 0;
-
-	if( frames.GetSize() && !frames.PeekBack( 0 )->ready )
-		return frames.PeekBack( 0 );
-
-	// Create a new frame if an unready one doesn't already exist
-	Ptr<Frame> tmpFrame = *new Frame( framenumber );
-	frames.PushBack( tmpFrame );
-
-	++framenumber;
+	if( pRT && greyBitmap )
+	{
+		Frame* frame = drawingFrame();
+		void* buffer = frame->ReserveImage( false, width * height );
+		if( !buffer )
+			return;
+		memcpy( buffer, imageData, width * height );
+		frame->greyImage = buffer;
+		frame->width = width;
+		frame->height = height;
+	}
+}
 
-	return tmpFrame;
+void ImageWindow::UpdateImageRGBA( const uint8_t* imageData, uint32_t width, uint32_t height, uint32_t pitch )
+{
+	if( pRT && colorBitmap )
+	{
+		Frame* frame = drawingFrame();
+		void* buffer = frame->ReserveImage( true, pitch * height );
+		if( !buffer )
+			return;
+		memcpy( buffer, imageData, pitch * height );
+		frame->colorImage = buffer;
+		frame->width = width;
+		frame->height = height;
+		frame->colorPitch = pitch;
+	}
 }
 
-void ImageWindow::UpdateImageBW( const uint8_t* imageData, uint32_t width, uint32_t height )
+void ImageWindow::WrapImageBW( const uint8_t* imageData, uint32_t width, uint32_t height,
+							   ImageReleaseFn release, void* userData )
 {
 	if( pRT && greyBitmap )
 	{
-		Mutex::Locker locker( frontBufferMutex );
-
-		Ptr<Frame> frame = lastUnreadyFrame();
-		frame->imageData = malloc( width * height );
+		Frame* frame = drawingFrame();
+		frame->WrapImage( false, imageData, release, userData );
 		frame->width = width;
 		frame->height = height;
-		memcpy( frame->imageData, imageData, width * height );
+	}
+	else if( release )
+	{
+		release( imageData, userData );
 	}
 }
 
-void ImageWindow::UpdateImageRGBA( const uint8_t* imageData, uint32_t width, uint32_t height, uint32_t pitch )
+void ImageWindow::WrapImageRGBA( const uint8_t* imageData, uint32_t width, uint32_t height, uint32_t pitch,
+								 ImageReleaseFn release, void* userData )
 {
 	if( pRT && colorBitmap )
 	{
-		Mutex::Locker locker( frontBufferMutex );
-
-		Ptr<Frame> frame = lastUnreadyFrame();
-		frame->colorImageData = malloc( pitch * height );
+		Frame* frame = drawingFrame();
+		frame->WrapImage( true, imageData, release, userData );
 		frame->width = width;
 		frame->height = height;
 		frame->colorPitch = pitch;
-		memcpy( frame->colorImageData, imageData, pitch * height );
+	}
+	else if( release )
+	{
+		release( imageData, userData );
 	}
 }
 
@@ -479,10 +488,7 @@ void ImageWindow::addCircle( float x, float y, float radius, float r, float g, f
 		cp.b = b;
 		cp.fill = fill;
 
-		Mutex::Locker locker( frontBufferMutex );
-
-		Ptr<Frame> frame = lastUnreadyFrame();
-		frame->plots.PushBack( cp );
+		drawingFrame()->plots.PushBack( cp );
 	}
 
 }
@@ -500,9 +506,7 @@ void ImageWindow::addText( float x, float y, float r, float g, float b, OVR::Str
 		tp.b = b;
 		tp.text = text;
 
-		Mutex::Locker locker( frontBufferMutex );
-		Ptr<Frame> frame = lastUnreadyFrame();
-		frame->textLines.PushBack( tp );
+		drawingFrame()->textLines.PushBack( tp );
 	}
 }
 
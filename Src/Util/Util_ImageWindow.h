@@ -38,7 +38,7 @@ limitations under the License.
 #include "../Kernel/OVR_Hash.h"
 #include "../Kernel/OVR_Array.h"
 #include "../Kernel/OVR_Threads.h"
-#include "../Kernel/OVR_Deque.h"
+#include "../Kernel/OVR_Atomic.h"
 
 #include <stdint.h>
 
@@ -65,26 +65,41 @@ namespace OVR { namespace Util {
 	OVR::String text;
 	} TextPlot;
 
+	// Called when a frame showing a caller's image is recycled, after which the
+	// image is no longer read.
+	typedef void (*ImageReleaseFn)( const void* imageData, void* userData );
+
+// Frames are pooled by ImageWindow: their image buffers and plot arrays are kept
+// when they are recycled, so that steady updates don't allocate.
 class Frame : virtual public RefCountBaseV<Frame>
 	{
 public:
 
 	Frame( int frame ) :
 		frameNumber( frame ),
-		imageData( NULL ),
-		colorImageData( NULL ),
 		plots(),
 		textLines(),
+		imageData( NULL ),
+		colorImageData( NULL ),
+		imageCapacity( 0 ),
+		colorImageCapacity( 0 ),
+		greyImage( NULL ),
+		colorImage( NULL ),
 		width( 0 ),
 		height( 0 ),
 		colorPitch( 0 ),
-		ready( false )
+		ready( false ),
+		wrappedImage( NULL ),
+		releaseWrappedImage( NULL ),
+		releaseUserData( NULL )
 	{
 
 	}
 
 	~Frame()
 	{
+		Recycle();
+
 		if( imageData )
 			free( imageData );
 		if( colorImageData )
@@ -94,16 +109,81 @@ public:
 		textLines.ClearAndRelease();
 	}
 
+	// Empties the frame for drawing again, keeping its buffers, and gives a
+	// wrapped image back to its owner.
+	void Recycle()
+	{
+		if( wrappedImage && releaseWrappedImage )
+			releaseWrappedImage( wrappedImage, releaseUserData );
+		wrappedImage        = NULL;
+		releaseWrappedImage = NULL;
+		releaseUserData     = NULL;
+
+		greyImage  = NULL;
+		colorImage = NULL;
+		plots.Clear();
+		textLines.Clear();
+		ready = false;
+	}
+
+	// Makes the grey or color buffer hold at least size bytes; returns it.
+	void* ReserveImage( bool color, size_t size )
+	{
+		void*&  buffer   = color ? colorImageData : imageData;
+		size_t& capacity = color ? colorImageCapacity : imageCapacity;
+		if( size > capacity )
+		{
+			if( buffer )
+				free( buffer );
+			buffer   = malloc( size );
+			capacity = buffer ? size : 0;
+		}
+		return buffer;
+	}
+
+	// Shows the caller's image, which must stay unchanged until release is called.
+	void WrapImage( bool color, const void* image, ImageReleaseFn release, void* userData )
+	{
+		// A frame wraps one image at a time.
+		if( wrappedImage )
+		{
+			if( greyImage == wrappedImage )
+				greyImage = NULL;
+			if( colorImage == wrappedImage )
+				colorImage = NULL;
+			if( releaseWrappedImage )
+				releaseWrappedImage( wrappedImage, releaseUserData );
+		}
+		wrappedImage        = image;
+		releaseWrappedImage = release;
+		releaseUserData     = userData;
+		if( color )
+			colorImage = image;
+		else
+			greyImage = image;
+	}
+
 	int						frameNumber;
 
 		Array<CirclePlot> plots;
 	Array<TextPlot>			textLines;
+		// Buffers owned by the frame, kept across recycling.
 		void*			  imageData;
 		void*			  colorImageData;
+		size_t			  imageCapacity;
+		size_t			  colorImageCapacity;
+		// Images shown by the frame, in the buffers or wrapped; NULL for none.
+		const void*		  greyImage;
+		const void*		  colorImage;
 		int				  width;
 		int				  height;
 		int				  colorPitch;
 		bool			  ready;
+
+private:
+		const void*		  wrappedImage;
+		ImageReleaseFn	  releaseWrappedImage;
+		void*			  releaseUserData;
 };
 
 #if defined(OVR_OS_WIN32)
@@ -113,9 +193,20 @@ class ImageWindow
 	ID2D1RenderTarget* pRT;
 	D2D1_SIZE_U resolution;
 
-	Mutex*						frontBufferMutex;
-
-	InPlaceMutableDeque< Ptr<Frame> >	frames;
+	// Frames are triple buffered without locking between the drawing thread and
+	// the painting one. The drawing thread fills framePool[drawIndex] and Complete
+	// swaps it with the ready frame in readyState, flagged ReadyFresh; OnPaint swaps
+	// the frame it last painted for a fresh ready one. A ready frame replaced before
+	// it's painted is recycled, so only the latest is shown, as it was with a queue.
+	enum { FramePoolSize = 3, ReadyFresh = 4 };
+	Ptr<Frame>					framePool[FramePoolSize];
+	int							drawIndex;
+	int							paintIndex;
+	AtomicInt<int>				readyState;
+	int							nextFrameNumber;
+	// OnPaint is called both by Process and for WM_PAINT; the drawing thread
+	// never takes it.
+	Mutex						paintMutex;
 
 	ID2D1Bitmap*				greyBitmap;
 	ID2D1Bitmap*				colorBitmap;
@@ -133,6 +224,13 @@ public:
 	void UpdateImage( const uint8_t* imageData, uint32_t width, uint32_t height ) { UpdateImageBW( imageData, width, height ); }
 	void UpdateImageBW( const uint8_t* imageData, uint32_t width, uint32_t height );
 	void UpdateImageRGBA( const uint8_t* imageData, uint32_t width, uint32_t height, uint32_t pitch );
+	// As UpdateImageBW and UpdateImageRGBA, but show imageData without copying it.
+	// It must stay unchanged until release, if given, is called with userData on the
+	// drawing thread, when the frame is recycled.
+	void WrapImageBW( const uint8_t* imageData, uint32_t width, uint32_t height,
+					  ImageReleaseFn release = NULL, void* userData = NULL );
+	void WrapImageRGBA( const uint8_t* imageData, uint32_t width, uint32_t height, uint32_t pitch,
+						ImageReleaseFn release = NULL, void* userData = NULL );
 	void Complete(); // Called by drawing thread to submit a frame
 
 	void Process(); // Called by rendering thread to do window processing
@@ -147,7 +245,7 @@ public:
 
 private:
 
-	Ptr<Frame>					lastUnreadyFrame();
+	Frame*						drawingFrame() { return framePool[drawIndex]; }
 
 	static const int			MaxWindows = 4;
 	static ImageWindow*			globalWindow[MaxWindows];
@@ -173,6 +271,13 @@ public:
 	void UpdateImage( const uint8_t* imageData, uint32_t width, uint32_t height ) { UpdateImageBW( imageData, width, height ); }
 	void UpdateImageBW( const uint8_t* imageData, uint32_t width, uint32_t height ) { }
 	void UpdateImageRGBA( const uint8_t* imageData, uint32_t width, uint32_t height, uint32_t pitch ) { }
+	// Nothing is shown, so wrapped images are released right away.
+	void WrapImageBW( const uint8_t* imageData, uint32_t width, uint32_t height,
+					  ImageReleaseFn release = NULL, void* userData = NULL )
+	{ OVR_UNUSED2( width, height ); if( release ) release( imageData, userData ); }
+	void WrapImageRGBA( const uint8_t* imageData, uint32_t width, uint32_t height, uint32_t pitch,
+						ImageReleaseFn release = NULL, void* userData = NULL )
+	{ OVR_UNUSED3( width, height, pitch ); if( release ) release( imageData, userData ); }
 	void Complete() { }
 
 	void Process() { }
@@ -28,6 +28,8 @@ limitations under the License.
 
 #include "../Kernel/OVR_Log.h"
 #include "../Kernel/OVR_Timer.h"
+#include "../Kernel/OVR_Alg.h"
+#include <string.h>
 
 namespace OVR { namespace Util {
 
@@ -51,8 +53,14 @@ static const float      SMALL_FLOAT = -1000000.0f;
 // ***** LatencyTest
 
 LatencyTest::LatencyTest(LatencyTestDevice* device)
- :  Handler(getThis())
+ :  Handler(getThis()),
+    Continuous(false),
+    ContinuousMeasurements(0),
+    WindowCount(0),
+    WindowNext(0)
 {
+    memset(WindowBuckets, 0, sizeof(WindowBuckets));
+
     if (device != NULL)
     {
         SetDevice(device);
@@ -88,6 +96,9 @@ bool LatencyTest::SetDevice(LatencyTestDevice* device)
             // Set display to initial (3 dashes).
             LatencyTestDisplay ltd(2, 0x40400040);
             Device->SetDisplay(ltd);
+
+            if (Continuous)
+                BeginTest();
         }
     }
 
@@ -106,6 +117,7 @@ void LatencyTest::BeginTest()
     {
         // Set color to black and wait a while.
         RenderColor = CALIBRATE_BLACK;
+        ContinuousMeasurements = 0;
 
         State = State_WaitingForSettlePreCalibrationColorBlack;
         OVR_DEBUG_LOG(("State_WaitingForButton -> State_WaitingForSettlePreCalibrationColorBlack."));
@@ -195,6 +207,8 @@ void LatencyTest::handleMessage(const Message& msg, LatencyTestMessageType laten
         {
             // We timed out waiting for 'TestStarted'. Abandon this measurement and setup for the next.
             getActiveResult()->TimedOutWaitingForTestStarted = true;
+            if (Continuous)
+                clearMeasurementResults();
 
             State = State_WaitingForSettlePostMeasurement;
             OVR_DEBUG_LOG(("** Timed out waiting for 'TestStarted'."));
@@ -207,6 +221,8 @@ void LatencyTest::handleMessage(const Message& msg, LatencyTestMessageType laten
         {
             // We timed out waiting for 'ColorDetected'. Abandon this measurement and setup for the next.
             getActiveResult()->TimedOutWaitingForColorDetected = true;
+            if (Continuous)
+                clearMeasurementResults();
 
             State = State_WaitingForSettlePostMeasurement;
             OVR_DEBUG_LOG(("** Timed out waiting for 'ColorDetected'."));
@@ -282,7 +298,14 @@ void LatencyTest::handleMessage(const Message& msg, LatencyTestMessageType laten
             
             getActiveResult()->DeviceMeasuredElapsedMilliS = elapsedTime;
 
-            if (areResultsComplete())
+            if (Continuous)
+            {
+                // Continuous tests keep only the rolling window.
+                addContinuousSample(*getActiveResult());
+                clearMeasurementResults();
+            }
+
+            if (!Continuous && areResultsComplete())
             {
                 // We're done.
                 processResults();
@@ -383,6 +406,113 @@ const char*	LatencyTest::GetResultsString()
 	return NULL;
 }
 
+void LatencyTest::SetContinuous(bool continuous)
+{
+    if (continuous == Continuous)
+        return;
+
+    Continuous = continuous;
+    if (Continuous)
+    {
+        if (Device)
+            BeginTest();
+    }
+    else
+    {
+        reset();
+    }
+}
+
+void LatencyTest::OnColorSubmitted(double seconds)
+{
+    // Only the first submission of the target color counts.
+    if ((State == State_WaitingForTestStarted || State == State_WaitingForColorDetected) &&
+        !Results.IsEmpty() && getActiveResult()->SubmitSeconds == 0.0)
+    {
+        getActiveResult()->SubmitSeconds = seconds;
+    }
+}
+
+// Histogram bucket of a latency, one per millisecond. The latency is clamped before
+// the conversion, which is undefined for negative or huge values; a negative one
+// can come from clock skew between the device and the host.
+static UInt32 latencyBucket(float latencyMilliS)
+{
+    return (UInt32)Alg::Clamp(latencyMilliS, 0.0f, (float)(LatencyTestStats::HistogramBuckets - 1));
+}
+
+void LatencyTest::addContinuousSample(const MeasurementResult& result)
+{
+    if (++ContinuousMeasurements <= INITIAL_SAMPLES_TO_IGNORE)
+        return;
+
+    // As in processResults: the time the device measured plus the USB round trip.
+    float usbRoundTripMilliS = Timer::MsPerSecond * (float)(result.TestStartedSeconds - result.StartTestSeconds);
+    float latencyMilliS      = (float)result.DeviceMeasuredElapsedMilliS + usbRoundTripMilliS;
+    float submitMilliS       = -1.0f;
+    if (result.SubmitSeconds != 0.0)
+    {
+        submitMilliS = latencyMilliS -
+                       Timer::MsPerSecond * (float)(result.SubmitSeconds - result.StartTestSeconds);
+        submitMilliS = Alg::Max(submitMilliS, 0.0f);
+    }
+
+    Lock::Locker lock(&ContinuousLock);
+
+    if (WindowCount == ContinuousWindow)
+        WindowBuckets[latencyBucket(WindowMs[WindowNext])]--;
+    else
+        WindowCount++;
+
+    WindowMs[WindowNext]       = latencyMilliS;
+    WindowSubmitMs[WindowNext] = submitMilliS;
+    WindowBuckets[latencyBucket(latencyMilliS)]++;
+    WindowNext = (WindowNext + 1) % ContinuousWindow;
+}
+
+void LatencyTest::GetContinuousStats(LatencyTestStats* stats) const
+{
+    memset(stats, 0, sizeof(LatencyTestStats));
+
+    float  sorted[ContinuousWindow];
+    float  submitTotal = 0.0f;
+    UInt32 submitCount = 0;
+    {
+        Lock::Locker lock(&ContinuousLock);
+
+        stats->Count = WindowCount;
+        memcpy(stats->Buckets, WindowBuckets, sizeof(WindowBuckets));
+        for (UInt32 i = 0; i < WindowCount; i++)
+        {
+            sorted[i] = WindowMs[i];
+            if (WindowSubmitMs[i] >= 0.0f)
+            {
+                submitTotal += WindowSubmitMs[i];
+                submitCount++;
+            }
+        }
+    }
+
+    if (stats->Count == 0)
+        return;
+
+    // The window is short, so it's sorted in place rather than through
+    // RadixSort's heap buffer.
+    Alg::ArrayAdaptor<float> window(sorted, stats->Count);
+    Alg::IntroSort(window);
+
+    float total = 0.0f;
+    for (UInt32 i = 0; i < stats->Count; i++)
+        total += sorted[i];
+
+    stats->MinMs            = sorted[0];
+    stats->MaxMs            = sorted[stats->Count - 1];
+    stats->MeanMs           = total / stats->Count;
+    stats->MedianMs         = sorted[stats->Count / 2];
+    stats->Percentile99Ms   = sorted[(stats->Count * 99) / 100];
+    stats->SubmitToPhotonMs = submitCount ? submitTotal / submitCount : 0.0f;
+}
+
 bool LatencyTest::areResultsComplete()
 {
     UInt32 initialMeasurements = 0;
@@ -32,6 +32,7 @@ limitations under the License.
 
 #include "../Kernel/OVR_String.h"
 #include "../Kernel/OVR_List.h"
+#include "../Kernel/OVR_Atomic.h"
 
 namespace OVR { namespace Util {
 
@@ -61,6 +62,29 @@ namespace OVR { namespace Util {
 //							The string pointer will remain valid until the next time this 
 //							method is called.
 //
+// In continuous mode (SetContinuous) the test starts as soon as a device is set, without
+// the button, and measures indefinitely. Each measurement goes into a rolling histogram,
+// read with GetContinuousStats, instead of the results string. Callers that draw the
+// test color should pass the time it was submitted to OnColorSubmitted, which splits
+// the latency into the part before submission and the part after.
+//
+
+// Rolling statistics of the latest continuous measurements, in milliseconds.
+struct LatencyTestStats
+{
+    enum { HistogramBuckets = 64 }; // 1 ms each; the last one also counts longer latencies.
+
+    UInt32  Count;
+    float   MinMs;
+    float   MaxMs;
+    float   MeanMs;
+    float   MedianMs;
+    float   Percentile99Ms;
+    // Mean time from the color being submitted to it being detected, for the
+    // measurements whose submission time is known; 0 otherwise.
+    float   SubmitToPhotonMs;
+    UInt32  Buckets[HistogramBuckets];
+};
 
 class LatencyTest : public NewOverrideBase
 {
@@ -85,6 +109,13 @@ public:
     // Begin test. Equivalent to pressing the button on the latency tester.
     void BeginTest();
 
+    void        SetContinuous(bool continuous);
+    bool        IsContinuous() const { return Continuous; }
+    // Time, in Timer::GetSeconds, at which the color returned by DisplayScreenColor
+    // was submitted for display.
+    void        OnColorSubmitted(double seconds);
+    void        GetContinuousStats(LatencyTestStats* stats) const;
+
 private:
     LatencyTest* getThis()  { return this; }
 
@@ -145,7 +176,8 @@ private:
             TimedOutWaitingForTestStarted(false),
             TimedOutWaitingForColorDetected(false),
             StartTestSeconds(0.0),
-            TestStartedSeconds(0.0)
+            TestStartedSeconds(0.0),
+            SubmitSeconds(0.0)
         {}
 
         Color                   TargetColor;
@@ -157,15 +189,32 @@ private:
 
         double                  StartTestSeconds;
         double                  TestStartedSeconds;
+        double                  SubmitSeconds;
     };
 
     List<MeasurementResult>     Results;
     void clearMeasurementResults();
 
     MeasurementResult*          getActiveResult();
+    void                        addContinuousSample(const MeasurementResult& result);
 
-    StringBuffer			    ResultsString;
+    StringBufferInline<256>     ResultsString;
 	String					    ReturnedResultString;
+
+    enum { ContinuousWindow = 128 };
+
+    bool                        Continuous;
+    // Measurements made since the test started, so that the first ones can be ignored.
+    UInt32                      ContinuousMeasurements;
+
+    // Guards the rolling window; stats are read from other threads than the one
+    // handling device messages.
+    mutable Lock                ContinuousLock;
+    float                       WindowMs[ContinuousWindow];
+    float                       WindowSubmitMs[ContinuousWindow];
+    UInt32                      WindowCount;
+    UInt32                      WindowNext;
+    UInt32                      WindowBuckets[LatencyTestStats::HistogramBuckets];
 };
 
 }} // namespace OVR::Util
@@ -122,12 +122,8 @@ void LatencyTest2::BeginTest(double startTime)
 
 void LatencyTest2::handleMessage(const MessagePixelRead& msg)
 {
-    Lock::Locker devLocker(&TesterLock);
-
-    // Hold onto the last message as we will use this when we start a new test
-    LastPixelReadMsg = msg;
-
-    // If color readback index is valid, store it in the lock-less queue.
+    // If color readback index is valid, store it in the lock-less queue. Only this
+    // thread writes the records, so they are published without waiting on the lock.
     int readbackIndex = 0;
     if (FrameTimeRecord::ColorToReadbackIndex(&readbackIndex, msg.PixelReadValue))
     {
@@ -135,6 +131,11 @@ void LatencyTest2::handleMessage(const MessagePixelRead& msg)
         LockessRecords.SetState(RecentFrameSet);
     }
 
+    Lock::Locker devLocker(&TesterLock);
+
+    // Hold onto the last message as we will use this when we start a new test
+    LastPixelReadMsg = msg;
+
     NumMsgsBeforeSettle++;
 
     if (TestActive)
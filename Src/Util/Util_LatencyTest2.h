@@ -77,12 +77,13 @@ struct FrameTimeRecord
 };
 
 // FrameTimeRecordSet is a container holding multiple consecutive frame timing records
-// returned from the lock-less state. Used by FrameTimeManager. 
+// returned from the lock-less state. Used by FrameTimeManager, which reads it once a
+// frame, so it holds enough records for an app at a fraction of the refresh rate.
 
 struct FrameTimeRecordSet
 {
     enum {
-        RecordCount = 4,
+        RecordCount = 8,
         RecordMask  = RecordCount - 1
     };
     FrameTimeRecord Records[RecordCount];    
@@ -115,24 +116,6 @@ struct FrameTimeRecordSet
         return Records[(NextWriteIndex - 1) & RecordMask];
     }
 
-    // Advances I to  absolute color index
-    bool FindReadbackIndex(int* i, int readbackIndex) const
-    {
-        for (; *i < RecordCount; (*i)++)
-        {
-            if ((*this)[*i].ReadbackIndex == readbackIndex)
-                return true;
-        }
-        return false;
-    }
-
-    bool IsAllZeroes() const
-    {
-        for (int i = 0; i < RecordCount; i++)
-            if (Records[i].ReadbackIndex != 0)
-                return false;
-        return true;
-    }
 };
 
 
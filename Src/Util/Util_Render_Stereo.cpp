@@ -26,6 +26,13 @@ limitations under the License.
 
 #include "Util_Render_Stereo.h"
 #include "../OVR_SensorFusion.h"
+#include "../Kernel/OVR_ThreadPool.h"
+#include "../Kernel/OVR_MappedFile.h"
+#include "../Kernel/OVR_SysFile.h"
+#include "../Kernel/OVR_Log.h"
+#include <stdio.h>
+#include <stddef.h>
+#include <string.h>
 
 namespace OVR { namespace Util { namespace Render {
 
@@ -363,7 +370,7 @@ ViewportScaleAndOffset ModifyRenderDensity ( StereoEyeParams const &params,
 
 StereoConfig::StereoConfig(StereoMode mode)
     : Mode(mode),
-      DirtyFlag(true)
+      DirtyFlags(Dirty_All)
 {
     // Initialize "fake" default HMD values for testing without HMD plugged in.
     // These default values match those returned by DK1
@@ -426,18 +433,18 @@ StereoConfig::StereoConfig(StereoMode mode)
 void StereoConfig::SetHmdRenderInfo(const HmdRenderInfo& hmd)
 {
     Hmd = hmd;
-    DirtyFlag = true;
+    DirtyFlags = Dirty_All;
 }
 
 void StereoConfig::Set2DAreaFov(float fovRadians)
 {
     Area2DFov = fovRadians;
-    DirtyFlag = true;
+    DirtyFlags |= Dirty_Ortho;
 }
 
 const StereoEyeParamsWithOrtho& StereoConfig::GetEyeRenderParams(StereoEye eye)
 {
-    if ( DirtyFlag )
+    if ( DirtyFlags )
     {
         UpdateComputedState();
     }
@@ -465,7 +472,7 @@ void StereoConfig::SetLensOverride ( LensConfig const *pLensOverrideLeft  /*= NU
             LensOverrideRight = *pLensOverrideRight;
         }
     }
-    DirtyFlag = true;
+    DirtyFlags |= Dirty_DistortionAndFov;
 }
 
 void StereoConfig::SetRendertargetSize (Size<int> const rendertargetSize,
@@ -473,13 +480,13 @@ void StereoConfig::SetRendertargetSize (Size<int> const rendertargetSize,
 {
     RendertargetSize = rendertargetSize;
     IsRendertargetSharedByBothEyes = rendertargetIsSharedByBothEyes;
-    DirtyFlag = true;
+    DirtyFlags |= Dirty_Viewports;
 }
 
 void StereoConfig::SetFov ( FovPort const *pfovLeft  /*= NULL*/,
                             FovPort const *pfovRight /*= NULL*/ )
 {
-    DirtyFlag = true;
+    DirtyFlags |= Dirty_DistortionAndFov;
     if ( pfovLeft == NULL )
     {
         OverrideTanHalfFov = false;
@@ -499,14 +506,14 @@ void StereoConfig::SetFov ( FovPort const *pfovLeft  /*= NULL*/,
 
 void StereoConfig::SetZeroVirtualIpdOverride ( bool enableOverride )
 {
-    DirtyFlag = true;
+    DirtyFlags |= Dirty_DistortionAndFov;
     OverrideZeroIpd = enableOverride;
 }
 
 
 void StereoConfig::SetZClipPlanesAndHandedness ( float zNear /*= 0.01f*/, float zFar /*= 10000.0f*/, bool rightHandedProjection /*= true*/ )
 {
-    DirtyFlag = true;
+    DirtyFlags |= Dirty_Projection;
     ZNear = zNear;
     ZFar = zFar;
     RightHandedProjection = rightHandedProjection;
@@ -514,7 +521,7 @@ void StereoConfig::SetZClipPlanesAndHandedness ( float zNear /*= 0.01f*/, float
 
 void StereoConfig::SetExtraEyeRotation ( float extraEyeRotationInRadians )
 {
-    DirtyFlag = true;
+    DirtyFlags |= Dirty_DistortionAndFov;
     ExtraEyeRotationInRadians = extraEyeRotationInRadians;
 }
 
@@ -552,94 +559,102 @@ void StereoConfig::UpdateComputedState()
     OVR_ASSERT ( RendertargetSize.w > 0 );
     OVR_ASSERT ( RendertargetSize.h > 0 );
 
-    for ( int eyeNum = 0; eyeNum < numEyes; eyeNum++ )
+    if ( DirtyFlags & Dirty_DistortionAndFov )
     {
-        StereoEye eyeType = eyeTypes[eyeNum];
-        LensConfig *pLensOverride = NULL;
-        if ( OverrideLens )
+        for ( int eyeNum = 0; eyeNum < numEyes; eyeNum++ )
         {
-            if ( eyeType == StereoEye_Right )
+            StereoEye eyeType = eyeTypes[eyeNum];
+            LensConfig *pLensOverride = NULL;
+            if ( OverrideLens )
             {
-                pLensOverride = &LensOverrideRight;
+                if ( eyeType == StereoEye_Right )
+                {
+                    pLensOverride = &LensOverrideRight;
+                }
+                else
+                {
+                    pLensOverride = &LensOverrideLeft;
+                }
             }
-            else
+
+            FovPort *pTanHalfFovOverride = NULL;
+            if ( OverrideTanHalfFov )
             {
-                pLensOverride = &LensOverrideLeft;
+                if ( eyeType == StereoEye_Right )
+                {
+                    pTanHalfFovOverride = &FovOverrideRight;
+                }
+                else
+                {
+                    pTanHalfFovOverride = &FovOverrideLeft;
+                }
             }
+
+            DistortionAndFov distortionAndFov =
+                CalculateDistortionAndFovInternal ( eyeType, Hmd,
+                                                    pLensOverride, pTanHalfFovOverride,
+                                                    ExtraEyeRotationInRadians );
+
+            EyeRenderParams[eyeNum].StereoEye.Distortion = distortionAndFov.Distortion;
+            EyeRenderParams[eyeNum].StereoEye.Fov        = distortionAndFov.Fov;
         }
 
-        FovPort *pTanHalfFovOverride = NULL;
-        if ( OverrideTanHalfFov )
+        if ( OverrideZeroIpd )
         {
-            if ( eyeType == StereoEye_Right )
-            {
-                pTanHalfFovOverride = &FovOverrideRight;
-            }
-            else
-            {
-                pTanHalfFovOverride = &FovOverrideLeft;
-            }
+            // Take the union of the calculated eye FOVs.
+            FovPort fov;
+            fov.UpTan    = Alg::Max ( EyeRenderParams[0].StereoEye.Fov.UpTan   , EyeRenderParams[1].StereoEye.Fov.UpTan    );
+            fov.DownTan  = Alg::Max ( EyeRenderParams[0].StereoEye.Fov.DownTan , EyeRenderParams[1].StereoEye.Fov.DownTan  );
+            fov.LeftTan  = Alg::Max ( EyeRenderParams[0].StereoEye.Fov.LeftTan , EyeRenderParams[1].StereoEye.Fov.LeftTan  );
+            fov.RightTan = Alg::Max ( EyeRenderParams[0].StereoEye.Fov.RightTan, EyeRenderParams[1].StereoEye.Fov.RightTan );
+            EyeRenderParams[0].StereoEye.Fov = fov;
+            EyeRenderParams[1].StereoEye.Fov = fov;
         }
 
-        DistortionAndFov distortionAndFov =
-            CalculateDistortionAndFovInternal ( eyeType, Hmd,
-                                                pLensOverride, pTanHalfFovOverride,
-                                                ExtraEyeRotationInRadians );
+        for ( int eyeNum = 0; eyeNum < numEyes; eyeNum++ )
+        {
+            StereoEye eyeType = eyeTypes[eyeNum];
 
-        EyeRenderParams[eyeNum].StereoEye.Distortion = distortionAndFov.Distortion;
-        EyeRenderParams[eyeNum].StereoEye.Fov        = distortionAndFov.Fov;
-    }
+            DistortionRenderDesc localDistortion = EyeRenderParams[eyeNum].StereoEye.Distortion;
+            FovPort              fov             = EyeRenderParams[eyeNum].StereoEye.Fov;
 
-    if ( OverrideZeroIpd )
+            // Use a placeholder - will be overridden later.
+            Recti tempViewport = Recti ( 0, 0, 1, 1 );
+
+            EyeRenderParams[eyeNum].StereoEye = CalculateStereoEyeParamsInternal (
+                                            eyeType, Hmd, localDistortion, fov,
+                                            RendertargetSize, tempViewport,
+                                            RightHandedProjection, ZNear, ZFar,
+                                            OverrideZeroIpd );
+        }
+
+        // Everything else is derived from the eye parameters.
+        DirtyFlags |= Dirty_Ortho | Dirty_Viewports;
+    }
+    else if ( DirtyFlags & Dirty_Projection )
     {
-        // Take the union of the calculated eye FOVs.
-        FovPort fov;
-        fov.UpTan    = Alg::Max ( EyeRenderParams[0].StereoEye.Fov.UpTan   , EyeRenderParams[1].StereoEye.Fov.UpTan    );
-        fov.DownTan  = Alg::Max ( EyeRenderParams[0].StereoEye.Fov.DownTan , EyeRenderParams[1].StereoEye.Fov.DownTan  );
-        fov.LeftTan  = Alg::Max ( EyeRenderParams[0].StereoEye.Fov.LeftTan , EyeRenderParams[1].StereoEye.Fov.LeftTan  );
-        fov.RightTan = Alg::Max ( EyeRenderParams[0].StereoEye.Fov.RightTan, EyeRenderParams[1].StereoEye.Fov.RightTan );
-        EyeRenderParams[0].StereoEye.Fov = fov;
-        EyeRenderParams[1].StereoEye.Fov = fov;
+        // Same as CalculateStereoEyeParamsInternal does.
+        for ( int eyeNum = 0; eyeNum < numEyes; eyeNum++ )
+        {
+            EyeRenderParams[eyeNum].StereoEye.RenderedProjection =
+                CreateProjection ( RightHandedProjection, EyeRenderParams[eyeNum].StereoEye.Fov, ZNear, ZFar );
+        }
+        DirtyFlags |= Dirty_Ortho;
     }
 
-    for ( int eyeNum = 0; eyeNum < numEyes; eyeNum++ )
+    if ( DirtyFlags & Dirty_Ortho )
     {
-        StereoEye eyeType = eyeTypes[eyeNum];
-
-        DistortionRenderDesc localDistortion = EyeRenderParams[eyeNum].StereoEye.Distortion;
-        FovPort              fov             = EyeRenderParams[eyeNum].StereoEye.Fov;
-
-        // Use a placeholder - will be overridden later.
-        Recti tempViewport = Recti ( 0, 0, 1, 1 );
-
-        EyeRenderParams[eyeNum].StereoEye = CalculateStereoEyeParamsInternal (
-                                        eyeType, Hmd, localDistortion, fov,
-                                        RendertargetSize, tempViewport,
-                                        RightHandedProjection, ZNear, ZFar,
-                                        OverrideZeroIpd );
-
-        // We want to create a virtual 2D surface we can draw debug text messages to.
-        // We'd like it to be a fixed distance (OrthoDistance) away,
-        // and to cover a specific FOV (Area2DFov). We need to find the projection matrix for this,
-        // and also to know how large it is in pixels to achieve a 1:1 mapping at the center of the screen.
-        float orthoDistance = 0.8f;
-        float orthoHalfFov = tanf ( Area2DFov * 0.5f );
-        Vector2f unityOrthoPixelSize = localDistortion.PixelsPerTanAngleAtCenter * ( orthoHalfFov * 2.0f );
-        float localInterpupillaryDistance = Hmd.EyeLeft.NoseToPupilInMeters + Hmd.EyeRight.NoseToPupilInMeters;
-        if ( OverrideZeroIpd )
+        for ( int eyeNum = 0; eyeNum < numEyes; eyeNum++ )
         {
-            localInterpupillaryDistance = 0.0f;
+            setupOrthoProjection ( eyeNum, eyeTypes[eyeNum] );
         }
-        Matrix4f ortho = CreateOrthoSubProjection ( true, eyeType,
-                                                    orthoHalfFov, orthoHalfFov,
-                                                    unityOrthoPixelSize.x, unityOrthoPixelSize.y,
-                                                    orthoDistance, localInterpupillaryDistance,
-                                                    EyeRenderParams[eyeNum].StereoEye.RenderedProjection );
-        EyeRenderParams[eyeNum].OrthoProjection = ortho;
     }
 
-    // ...and now set up the viewport, scale & offset the way the app wanted.
-    setupViewportScaleAndOffsets();
+    if ( DirtyFlags & Dirty_Viewports )
+    {
+        // ...and now set up the viewport, scale & offset the way the app wanted.
+        setupViewportScaleAndOffsets();
+    }
 
     if ( OverrideZeroIpd )
     {
@@ -663,7 +678,30 @@ void StereoConfig::UpdateComputedState()
         OVR_ASSERT ( EyeRenderParams[0].OrthoProjection.M[1][2]               == EyeRenderParams[1].OrthoProjection.M[1][2] );
     }
 
-    DirtyFlag = false;
+    DirtyFlags = 0;
+}
+
+
+void StereoConfig::setupOrthoProjection ( int eyeNum, StereoEye eyeType )
+{
+    // We want to create a virtual 2D surface we can draw debug text messages to.
+    // We'd like it to be a fixed distance (OrthoDistance) away,
+    // and to cover a specific FOV (Area2DFov). We need to find the projection matrix for this,
+    // and also to know how large it is in pixels to achieve a 1:1 mapping at the center of the screen.
+    float orthoDistance = 0.8f;
+    float orthoHalfFov = tanf ( Area2DFov * 0.5f );
+    Vector2f unityOrthoPixelSize = EyeRenderParams[eyeNum].StereoEye.Distortion.PixelsPerTanAngleAtCenter * ( orthoHalfFov * 2.0f );
+    float localInterpupillaryDistance = Hmd.EyeLeft.NoseToPupilInMeters + Hmd.EyeRight.NoseToPupilInMeters;
+    if ( OverrideZeroIpd )
+    {
+        localInterpupillaryDistance = 0.0f;
+    }
+    Matrix4f ortho = CreateOrthoSubProjection ( true, eyeType,
+                                                orthoHalfFov, orthoHalfFov,
+                                                unityOrthoPixelSize.x, unityOrthoPixelSize.y,
+                                                orthoDistance, localInterpupillaryDistance,
+                                                EyeRenderParams[eyeNum].StereoEye.RenderedProjection );
+    EyeRenderParams[eyeNum].OrthoProjection = ortho;
 }
 
 
@@ -776,21 +814,23 @@ Matrix4f StereoConfig::GetProjectionWithZoom ( StereoEye eye, float fovZoom ) co
 // *****  Distortion Mesh Rendering
 
 
-// Pow2 for the Morton order to work!
-// 4 is too low - it is easy to see the "wobbles" in the HMD.
-// 5 is realllly close but you can see pixel differences with even/odd frame checking.
-// 6 is indistinguishable on a monitor on even/odd frames.
-static const int DMA_GridSizeLog2   = 6;
-static const int DMA_GridSize       = 1<<DMA_GridSizeLog2;
-static const int DMA_NumVertsPerEye = (DMA_GridSize+1)*(DMA_GridSize+1);
-static const int DMA_NumTrisPerEye  = (DMA_GridSize)*(DMA_GridSize)*2;
+// The grid size is 1 << gridSizeLog2; see DistortionMeshGridSizeLog2_Default.
+static const int DMA_GridSizeMax    = 1<<DistortionMeshGridSizeLog2_Max;
+// Rows per ThreadPool task; a row is a few tens of microseconds of work.
+static const int DMA_RowsPerTask    = 4;
+// Points along each axis at which the adaptive grid measures the distortion.
+static const int DMA_AdaptiveSamples = 256;
+// Width in cells of the bands a strip mesh walks down, so that the vertices shared
+// with the previous row are still in the post-transform vertex cache.
+static const int DMA_StripBandWidth = 8;
 
 
 
 void DistortionMeshDestroy ( DistortionMeshVertexData *pVertices, UInt16 *pTriangleMeshIndices )
 {
-    OVR_FREE ( pVertices );
-    OVR_FREE ( pTriangleMeshIndices );
+    // Freed in reverse allocation order, for arena allocators.
+    OVR_SUBSYSTEM_FREE(AllocSubsystem_DistortionMesh, pTriangleMeshIndices);
+    OVR_SUBSYSTEM_FREE(AllocSubsystem_DistortionMesh, pVertices);
 }
 
 void DistortionMeshCreate ( DistortionMeshVertexData **ppVertices, UInt16 **ppTriangleListIndices,
@@ -810,81 +850,127 @@ void DistortionMeshCreate ( DistortionMeshVertexData **ppVertices, UInt16 **ppTr
 }
 
 
-// Generate distortion mesh for a eye.
-void DistortionMeshCreate( DistortionMeshVertexData **ppVertices, UInt16 **ppTriangleListIndices,
-                           int *pNumVertices, int *pNumTriangles,
-                           bool rightEye,
-                           const HmdRenderInfo &hmdRenderInfo, 
-                           const DistortionRenderDesc &distortion, const ScaleAndOffset2D &eyeToSourceNDC )
+DistortionMeshVertexLayout::DistortionMeshVertexLayout()
+    : Stride           ( sizeof(DistortionMeshVertexData) ),
+      ScreenPosNDC     ( offsetof(DistortionMeshVertexData, ScreenPosNDC) ),
+      TimewarpLerp     ( offsetof(DistortionMeshVertexData, TimewarpLerp) ),
+      Shade            ( offsetof(DistortionMeshVertexData, Shade) ),
+      TanEyeAnglesR    ( offsetof(DistortionMeshVertexData, TanEyeAnglesR) ),
+      TanEyeAnglesG    ( offsetof(DistortionMeshVertexData, TanEyeAnglesG) ),
+      TanEyeAnglesB    ( offsetof(DistortionMeshVertexData, TanEyeAnglesB) ),
+      EyeIndex         ( -1 ),
+      TimewarpLerpByte ( false ),
+      ShadeBytes       ( 0 )
 {
-    *pNumVertices  = DMA_NumVertsPerEye;
-    *pNumTriangles = DMA_NumTrisPerEye;
-
-    *ppVertices = (DistortionMeshVertexData*)
-                      OVR_ALLOC( sizeof(DistortionMeshVertexData) * (*pNumVertices) );
-    *ppTriangleListIndices  = (UInt16*) OVR_ALLOC( sizeof(UInt16) * (*pNumTriangles) * 3 );
+}
 
-    if (!*ppVertices || !*ppTriangleListIndices)
+// Copies size bytes to offset in a vertex, unless the layout leaves them out.
+// Vertices may be in write-combined memory, so they are written once and in order.
+static inline void distortionMeshStoreBytes ( UByte *pVertex, int offset, const void *pValue, UPInt size )
+{
+    if ( offset >= 0 )
     {
-        if (*ppVertices)
-        {
-            OVR_FREE(*ppVertices);
-        }
-        if (*ppTriangleListIndices)
-        {
-            OVR_FREE(*ppTriangleListIndices);
-        }
-        *ppVertices             = NULL;
-        *ppTriangleListIndices  = NULL;
-        *pNumTriangles          = 0;
-        *pNumVertices           = 0;
-        return;
+        memcpy ( pVertex + offset, pValue, size );
     }
+}
 
-    // When does the fade-to-black edge start? Chosen heuristically.
-    const float fadeOutBorderFraction = 0.075f;
-      
-    
-    // Populate vertex buffer info
-    float xOffset = 0.0f;
-    float uOffset = 0.0f;
-    OVR_UNUSED(uOffset);
+// Converts [0.0f,1.0f] to [0,255].
+static inline UByte distortionMeshUnitToByte ( float value )
+{
+    return (UByte)( Alg::Clamp ( value, 0.0f, 1.0f ) * 255.99f );
+}
 
-    if (rightEye)
+// Stores vertex number index of pVertices in pLayout, or as DistortionMeshVertexData
+// if pLayout is null.
+static void distortionMeshStoreVertex ( void *pVertices, const DistortionMeshVertexLayout *pLayout, int index,
+                                        const DistortionMeshVertexData &vertex, bool rightEye )
+{
+    if ( !pLayout )
     {
-        xOffset = 1.0f;
-        uOffset = 0.5f;
+        ((DistortionMeshVertexData*)pVertices)[index] = vertex;
+        return;
     }
 
-    // First pass - build up raw vertex data.
-    DistortionMeshVertexData* pcurVert = *ppVertices;
+    UByte* pVertex = (UByte*)pVertices + index * pLayout->Stride;
+    distortionMeshStoreBytes ( pVertex, pLayout->ScreenPosNDC,  &vertex.ScreenPosNDC,  sizeof(Vector2f) );
+    distortionMeshStoreBytes ( pVertex, pLayout->TanEyeAnglesR, &vertex.TanEyeAnglesR, sizeof(Vector2f) );
+    distortionMeshStoreBytes ( pVertex, pLayout->TanEyeAnglesG, &vertex.TanEyeAnglesG, sizeof(Vector2f) );
+    distortionMeshStoreBytes ( pVertex, pLayout->TanEyeAnglesB, &vertex.TanEyeAnglesB, sizeof(Vector2f) );
+    if ( pLayout->TimewarpLerpByte )
+    {
+        UByte timewarpLerp = distortionMeshUnitToByte ( vertex.TimewarpLerp );
+        distortionMeshStoreBytes ( pVertex, pLayout->TimewarpLerp, &timewarpLerp, 1 );
+    }
+    else
+    {
+        distortionMeshStoreBytes ( pVertex, pLayout->TimewarpLerp, &vertex.TimewarpLerp, sizeof(float) );
+    }
+    if ( pLayout->ShadeBytes > 0 )
+    {
+        UByte shade[4];
+        int   shadeBytes = Alg::Min ( pLayout->ShadeBytes, 4 );
+        memset ( shade, distortionMeshUnitToByte ( vertex.Shade ), sizeof(shade) );
+        distortionMeshStoreBytes ( pVertex, pLayout->Shade, shade, shadeBytes );
+    }
+    else
+    {
+        distortionMeshStoreBytes ( pVertex, pLayout->Shade, &vertex.Shade, sizeof(float) );
+    }
+    float eyeIndex = rightEye ? 1.0f : 0.0f;
+    distortionMeshStoreBytes ( pVertex, pLayout->EyeIndex, &eyeIndex, sizeof(float) );
+}
 
-    for ( int y = 0; y <= DMA_GridSize; y++ )
+// Builds the vertices of one grid row at a time, so that rows can be
+// generated in parallel; see DistortionMeshCreate. eqn is the lens equation.
+template<DistortionEqnType eqn>
+struct DistortionMeshRowBuilder
+{
+    // Written as distortionMeshStoreVertex does.
+    void*                             pVertices;
+    const DistortionMeshVertexLayout* pLayout;
+    int                         GridSize;
+    // Source NDC of each grid column and row.
+    const float*                pColumnNDC;
+    const float*                pRowNDC;
+    bool                        RightEye;
+    const HmdRenderInfo*        pHmdRenderInfo;
+    const DistortionRenderDesc* pDistortion;
+    const ScaleAndOffset2D*     pEyeToSourceNDC;
+
+    void operator () (int y) const
     {
-        for ( int x = 0; x <= DMA_GridSize; x++ )
+        // When does the fade-to-black edge start? Chosen heuristically.
+        const float fadeOutBorderFraction = 0.075f;
+
+        // Populate vertex buffer info
+        float xOffset = RightEye ? 1.0f : 0.0f;
+
+        for ( int x = 0; x <= GridSize; x++ )
         {
+            DistortionMeshVertexData  vertex;
+            DistortionMeshVertexData* pcurVert = &vertex;
 
             Vector2f sourceCoordNDC;
             // NDC texture coords [-1,+1]
-            sourceCoordNDC.x = 2.0f * ( (float)x / (float)DMA_GridSize ) - 1.0f;
-            sourceCoordNDC.y = 2.0f * ( (float)y / (float)DMA_GridSize ) - 1.0f;
-            Vector2f tanEyeAngle = TransformRendertargetNDCToTanFovSpace ( eyeToSourceNDC, sourceCoordNDC );
+            sourceCoordNDC.x = pColumnNDC[x];
+            sourceCoordNDC.y = pRowNDC[y];
+            Vector2f tanEyeAngle = TransformRendertargetNDCToTanFovSpace ( *pEyeToSourceNDC, sourceCoordNDC );
 
             // This is the function that does the really heavy lifting.
-            Vector2f screenNDC = TransformTanFovSpaceToScreenNDC ( distortion, tanEyeAngle, false );
+            Vector2f screenNDC = TransformTanFovSpaceToScreenNDC<eqn> ( *pDistortion, tanEyeAngle );
 
             // We then need RGB UVs. Since chromatic aberration is generated from screen coords, not
             // directly from texture NDCs, we can't just use tanEyeAngle, we need to go the long way round.
             Vector2f tanEyeAnglesR, tanEyeAnglesG, tanEyeAnglesB;
-            TransformScreenNDCToTanFovSpaceChroma ( &tanEyeAnglesR, &tanEyeAnglesG, &tanEyeAnglesB,
-                                                    distortion, screenNDC );
-			
-			pcurVert->TanEyeAnglesR = tanEyeAnglesR;
-			pcurVert->TanEyeAnglesG = tanEyeAnglesG;
-			pcurVert->TanEyeAnglesB = tanEyeAnglesB;
-			
+            TransformScreenNDCToTanFovSpaceChroma<eqn> ( &tanEyeAnglesR, &tanEyeAnglesG, &tanEyeAnglesB,
+                                                         *pDistortion, screenNDC );
 
-            HmdShutterTypeEnum shutterType = hmdRenderInfo.Shutter.Type;
+            pcurVert->TanEyeAnglesR = tanEyeAnglesR;
+            pcurVert->TanEyeAnglesG = tanEyeAnglesG;
+            pcurVert->TanEyeAnglesB = tanEyeAnglesB;
+
+
+            HmdShutterTypeEnum shutterType = pHmdRenderInfo->Shutter.Type;
             switch ( shutterType )
             {
             case HmdShutter_Global:
@@ -893,7 +979,7 @@ void DistortionMeshCreate( DistortionMeshVertexData **ppVertices, UInt16 **ppTri
             case HmdShutter_RollingLeftToRight:
                 // Retrace is left to right - left eye goes 0.0 -> 0.5, then right goes 0.5 -> 1.0
                 pcurVert->TimewarpLerp = screenNDC.x * 0.25f + 0.25f;
-                if (rightEye)
+                if (RightEye)
                 {
                     pcurVert->TimewarpLerp += 0.5f;
                 }
@@ -901,7 +987,7 @@ void DistortionMeshCreate( DistortionMeshVertexData **ppVertices, UInt16 **ppTri
             case HmdShutter_RollingRightToLeft:
                 // Retrace is right to left - right eye goes 0.0 -> 0.5, then left goes 0.5 -> 1.0
                 pcurVert->TimewarpLerp = 0.75f - screenNDC.x * 0.25f;
-                if (rightEye)
+                if (RightEye)
                 {
                     pcurVert->TimewarpLerp -= 0.5f;
                 }
@@ -929,19 +1015,238 @@ void DistortionMeshCreate( DistortionMeshVertexData **ppVertices, UInt16 **ppTri
             pcurVert->ScreenPosNDC.x = 0.5f * screenNDC.x - 0.5f + xOffset;
             pcurVert->ScreenPosNDC.y = -screenNDC.y;
 
-            pcurVert++;
+            distortionMeshStoreVertex ( pVertices, pLayout, y * (GridSize+1) + x, vertex, RightEye );
+        }
+    }
+};
+
+// Fills coords[0, gridSize] with the source NDC of the grid lines along one axis.
+// The adaptive grid puts them where the mesh's linear interpolation of the inverse
+// distortion is least accurate: the error over a cell of width h is about
+// h^2 |s''| / 8, with s the screen position, so lines are spaced inversely to
+// sqrt(|s''|), plus a floor that keeps mostly linear areas from being left with
+// too few. s'' is the largest found along the lines through the lens center and
+// along both edges of the grid.
+template<DistortionEqnType eqn>
+static void distortionMeshAxis ( float *coords, int gridSize, bool adaptive, int axis,
+                                 const DistortionRenderDesc &distortion, const ScaleAndOffset2D &eyeToSourceNDC )
+{
+    for ( int i = 0; i <= gridSize; i++ )
+    {
+        coords[i] = 2.0f * ( (float)i / (float)gridSize ) - 1.0f;
+    }
+    if ( !adaptive )
+    {
+        return;
+    }
+
+    const float centerNDC    = ( axis == 0 ) ? eyeToSourceNDC.Offset.y : eyeToSourceNDC.Offset.x;
+    const float acrossNDC[3] = { -1.0f, centerNDC, 1.0f };
+
+    float curvature[DMA_AdaptiveSamples+1];
+    for ( int j = 0; j <= DMA_AdaptiveSamples; j++ )
+    {
+        curvature[j] = 0.0f;
+    }
+    for ( int line = 0; line < 3; line++ )
+    {
+        Vector2f screen[DMA_AdaptiveSamples+1];
+        for ( int j = 0; j <= DMA_AdaptiveSamples; j++ )
+        {
+            float    alongNDC  = 2.0f * ( (float)j / (float)DMA_AdaptiveSamples ) - 1.0f;
+            Vector2f sourceNDC = ( axis == 0 ) ? Vector2f ( alongNDC, acrossNDC[line] ) :
+                                                 Vector2f ( acrossNDC[line], alongNDC );
+            Vector2f tanEyeAngle = TransformRendertargetNDCToTanFovSpace ( eyeToSourceNDC, sourceNDC );
+            screen[j] = TransformTanFovSpaceToScreenNDC<eqn> ( distortion, tanEyeAngle );
+        }
+        for ( int j = 1; j < DMA_AdaptiveSamples; j++ )
+        {
+            float c = ( screen[j-1] - screen[j] * 2.0f + screen[j+1] ).Length();
+            curvature[j] = Alg::Max ( curvature[j], c );
+        }
+    }
+
+    float meanCurvature = 0.0f;
+    for ( int j = 1; j < DMA_AdaptiveSamples; j++ )
+    {
+        meanCurvature += curvature[j];
+    }
+    curvature[0]                   = curvature[1];
+    curvature[DMA_AdaptiveSamples] = curvature[DMA_AdaptiveSamples-1];
+    meanCurvature /= (float)( DMA_AdaptiveSamples - 1 );
+    if ( meanCurvature <= 0.0f )
+    {
+        return;
+    }
+
+    // Integrate the line density and place the lines at equal steps of it.
+    float cumulative[DMA_AdaptiveSamples+1];
+    cumulative[0] = 0.0f;
+    float density = sqrtf ( curvature[0] + meanCurvature );
+    for ( int j = 1; j <= DMA_AdaptiveSamples; j++ )
+    {
+        float nextDensity = sqrtf ( curvature[j] + meanCurvature );
+        cumulative[j] = cumulative[j-1] + 0.5f * ( density + nextDensity );
+        density = nextDensity;
+    }
+
+    int j = 0;
+    for ( int i = 1; i < gridSize; i++ )
+    {
+        float target = cumulative[DMA_AdaptiveSamples] * (float)i / (float)gridSize;
+        while ( j < DMA_AdaptiveSamples - 1 && cumulative[j+1] < target )
+        {
+            j++;
+        }
+        float f = ( target - cumulative[j] ) / ( cumulative[j+1] - cumulative[j] );
+        coords[i] = 2.0f * ( ( (float)j + f ) / (float)DMA_AdaptiveSamples ) - 1.0f;
+    }
+}
+
+// Collects triangle strip indices, offset by Base, or only counts them when pIndices
+// is null. The indices are never read back, since they may be in GPU memory.
+struct DistortionMeshStripWriter
+{
+    UInt16* pIndices;
+    int     Base;
+    int     Count;
+    int     First;
+    int     Last;
+
+    void emit ( int vertex )
+    {
+        if ( pIndices )
+        {
+            pIndices[Count] = (UInt16)( Base + vertex );
+        }
+        if ( Count == 0 )
+        {
+            First = vertex;
+        }
+        Last = vertex;
+        Count++;
+    }
+
+    // Starts a new run of the strip at vertex. Its first triangle has to be at an
+    // even position for clockwise-first winding and at an odd one otherwise; the
+    // repeated indices only form degenerate triangles.
+    void startRun ( int vertex, bool oddStart )
+    {
+        if ( Count > 0 )
+        {
+            emit ( Last );
+            emit ( vertex );
+        }
+        if ( ( Count & 1 ) != ( oddStart ? 1 : 0 ) )
+        {
+            emit ( vertex );
+        }
+        emit ( vertex );
+    }
+};
+
+// Writes the grid as one triangle strip with the same triangles and winding as
+// the triangle list. Cells are walked in bands DMA_StripBandWidth wide, row by row,
+// with a run per row and band, split where the diagonal direction flips. Sets the
+// index counts of pInfo; pIndices may be null to only count them.
+static void distortionMeshStrip ( UInt16 *pIndices, int gridSize, int indexBase, DistortionMeshWriteInfo *pInfo )
+{
+    DistortionMeshStripWriter writer;
+    writer.pIndices = pIndices;
+    writer.Base     = indexBase;
+    writer.Count    = 0;
+    writer.First    = 0;
+    writer.Last     = 0;
+
+    for ( int band = 0; band < gridSize; band += DMA_StripBandWidth )
+    {
+        int bandEnd = Alg::Min ( band + DMA_StripBandWidth, gridSize );
+        for ( int a = 0; a < gridSize; a++ )
+        {
+            int b = band;
+            while ( b < bandEnd )
+            {
+                // Cells whose diagonal joins (a,b) and (a+1,b+1); see the triangle list.
+                bool mainDiagonal = ( ( a < gridSize/2 ) != ( b < gridSize/2 ) );
+                int  runEnd       = bandEnd;
+                if ( b < gridSize/2 && runEnd > gridSize/2 )
+                {
+                    runEnd = gridSize/2;
+                }
+
+                // Each run alternates between the grid lines a and a+1; taking
+                // a+1 first gives the main diagonal.
+                int first  = mainDiagonal ? a + 1 : a;
+                int second = mainDiagonal ? a : a + 1;
+                writer.startRun ( first * (gridSize+1) + b, !mainDiagonal );
+                writer.emit ( second * (gridSize+1) + b );
+                for ( int c = b + 1; c <= runEnd; c++ )
+                {
+                    writer.emit ( first  * (gridSize+1) + c );
+                    writer.emit ( second * (gridSize+1) + c );
+                }
+                b = runEnd;
+            }
         }
     }
 
+    pInfo->NumIndices   = writer.Count;
+    pInfo->NumTriangles = writer.Count - 2;
+    pInfo->FirstIndex   = (UInt16)( indexBase + writer.First );
+    pInfo->LastIndex    = (UInt16)( indexBase + writer.Last );
+}
 
-    // Populate index buffer info  
-    UInt16 *pcurIndex = *ppTriangleListIndices;
+// Fills in the vertices of a mesh for the lens equation eqn.
+template<DistortionEqnType eqn>
+static void distortionMeshVertices ( void *pVertices, const DistortionMeshVertexLayout *pLayout,
+                                     int gridSize, bool adaptive, bool rightEye,
+                                     const HmdRenderInfo &hmdRenderInfo,
+                                     const DistortionRenderDesc &distortion, const ScaleAndOffset2D &eyeToSourceNDC,
+                                     ThreadPool* pool )
+{
+    float columnNDC[DMA_GridSizeMax+1];
+    float rowNDC[DMA_GridSizeMax+1];
+    distortionMeshAxis<eqn> ( columnNDC, gridSize, adaptive, 0, distortion, eyeToSourceNDC );
+    distortionMeshAxis<eqn> ( rowNDC,    gridSize, adaptive, 1, distortion, eyeToSourceNDC );
+
+    DistortionMeshRowBuilder<eqn> rowBuilder;
+    rowBuilder.pVertices       = pVertices;
+    rowBuilder.pLayout         = pLayout;
+    rowBuilder.GridSize        = gridSize;
+    rowBuilder.pColumnNDC      = columnNDC;
+    rowBuilder.pRowNDC         = rowNDC;
+    rowBuilder.RightEye        = rightEye;
+    rowBuilder.pHmdRenderInfo  = &hmdRenderInfo;
+    rowBuilder.pDistortion     = &distortion;
+    rowBuilder.pEyeToSourceNDC = &eyeToSourceNDC;
+
+#ifdef OVR_ENABLE_THREADS
+    if (pool)
+    {
+        pool->ParallelFor(0, gridSize + 1, rowBuilder, DMA_RowsPerTask);
+    }
+    else
+#else
+    OVR_UNUSED(pool);
+#endif
+    {
+        for ( int y = 0; y <= gridSize; y++ )
+            rowBuilder(y);
+    }
+}
 
-    for ( int triNum = 0; triNum < DMA_GridSize * DMA_GridSize; triNum++ )
+// Writes the grid as a triangle list, offset by indexBase, and sets the index counts
+// of pInfo.
+static void distortionMeshTriangleList ( UInt16 *pIndices, int gridSize, int indexBase, DistortionMeshWriteInfo *pInfo )
+{
+    UInt16 *pcurIndex = pIndices;
+    int     lastIndex = indexBase;
+
+    for ( int triNum = 0; triNum < gridSize * gridSize; triNum++ )
     {
         // Use a Morton order to help locality of FB, texture and vertex cache.
         // (0.325ms raster order -> 0.257ms Morton order)
-        OVR_ASSERT ( DMA_GridSize <= 256 );
+        OVR_ASSERT ( gridSize <= 256 );
         int x = ( ( triNum & 0x0001 ) >> 0 ) |
                 ( ( triNum & 0x0004 ) >> 1 ) |
                 ( ( triNum & 0x0010 ) >> 2 ) |
@@ -958,7 +1263,7 @@ void DistortionMeshCreate( DistortionMeshVertexData **ppVertices, UInt16 **ppTri
                 ( ( triNum & 0x0800 ) >> 6 ) |
                 ( ( triNum & 0x2000 ) >> 7 ) |
                 ( ( triNum & 0x8000 ) >> 8 );
-        int FirstVertex = x * (DMA_GridSize+1) + y;
+        int FirstVertex = indexBase + x * (gridSize+1) + y;
         // Another twist - we want the top-left and bottom-right quadrants to
         // have the triangles split one way, the other two split the other.
         // +---+---+---+---+
@@ -980,27 +1285,548 @@ void DistortionMeshCreate( DistortionMeshVertexData **ppVertices, UInt16 **ppTri
         // +---+---+---+---+
         // This way triangle edges don't span long distances over the distortion function,
         // so linear interpolation works better & we can use fewer tris.
-        if ( ( x < DMA_GridSize/2 ) != ( y < DMA_GridSize/2 ) )       // != is logical XOR
+        if ( ( x < gridSize/2 ) != ( y < gridSize/2 ) )       // != is logical XOR
         {
             *pcurIndex++ = (UInt16)FirstVertex;
-            *pcurIndex++ = (UInt16)FirstVertex+1;
-            *pcurIndex++ = (UInt16)FirstVertex+(DMA_GridSize+1)+1;
+            *pcurIndex++ = (UInt16)(FirstVertex+1);
+            *pcurIndex++ = (UInt16)(FirstVertex+(gridSize+1)+1);
 
-            *pcurIndex++ = (UInt16)FirstVertex+(DMA_GridSize+1)+1;
-            *pcurIndex++ = (UInt16)FirstVertex+(DMA_GridSize+1);
+            *pcurIndex++ = (UInt16)(FirstVertex+(gridSize+1)+1);
+            *pcurIndex++ = (UInt16)(FirstVertex+(gridSize+1));
             *pcurIndex++ = (UInt16)FirstVertex;
+            lastIndex    = FirstVertex;
         }
         else
         {
             *pcurIndex++ = (UInt16)FirstVertex;
-            *pcurIndex++ = (UInt16)FirstVertex+1;
-            *pcurIndex++ = (UInt16)FirstVertex+(DMA_GridSize+1);
+            *pcurIndex++ = (UInt16)(FirstVertex+1);
+            *pcurIndex++ = (UInt16)(FirstVertex+(gridSize+1));
+
+            *pcurIndex++ = (UInt16)(FirstVertex+1);
+            *pcurIndex++ = (UInt16)(FirstVertex+(gridSize+1)+1);
+            *pcurIndex++ = (UInt16)(FirstVertex+(gridSize+1));
+            lastIndex    = FirstVertex+(gridSize+1);
+        }
+    }
+
+    pInfo->NumTriangles = gridSize * gridSize * 2;
+    pInfo->NumIndices   = pInfo->NumTriangles * 3;
+    pInfo->FirstIndex   = (UInt16)indexBase;
+    pInfo->LastIndex    = (UInt16)lastIndex;
+}
+
+// Writes the mesh of DistortionMeshCreate and DistortionMeshWrite, its vertices as
+// distortionMeshStoreVertex does.
+static void distortionMeshWrite ( void *pVertices, const DistortionMeshVertexLayout *pLayout,
+                                  UInt16 *pIndices, UInt16 indexBase, DistortionMeshWriteInfo *pInfo,
+                                  bool rightEye,
+                                  const HmdRenderInfo &hmdRenderInfo,
+                                  const DistortionRenderDesc &distortion, const ScaleAndOffset2D &eyeToSourceNDC,
+                                  int gridSizeLog2, unsigned meshFlags, ThreadPool* pool )
+{
+    gridSizeLog2 = Alg::Clamp ( gridSizeLog2, (int)DistortionMeshGridSizeLog2_Min, (int)DistortionMeshGridSizeLog2_Max );
+    const int  gridSize      = 1 << gridSizeLog2;
+
+    // First pass - build up raw vertex data. Each vertex inverts the distortion
+    // function numerically, so with a pool the rows are split across its threads.
+    // The lens equation is picked here, once, rather than at every evaluation.
+    bool adaptive = ( meshFlags & DistortionMesh_Adaptive ) != 0;
+    switch ( distortion.Lens.Eqn )
+    {
+    case Distortion_Poly4:
+        distortionMeshVertices<Distortion_Poly4> ( pVertices, pLayout, gridSize, adaptive, rightEye,
+                                                   hmdRenderInfo, distortion, eyeToSourceNDC, pool );
+        break;
+    case Distortion_RecipPoly4:
+        distortionMeshVertices<Distortion_RecipPoly4> ( pVertices, pLayout, gridSize, adaptive, rightEye,
+                                                        hmdRenderInfo, distortion, eyeToSourceNDC, pool );
+        break;
+    case Distortion_CatmullRom10:
+        distortionMeshVertices<Distortion_CatmullRom10> ( pVertices, pLayout, gridSize, adaptive, rightEye,
+                                                          hmdRenderInfo, distortion, eyeToSourceNDC, pool );
+        break;
+    default:
+        distortionMeshVertices<Distortion_LAST> ( pVertices, pLayout, gridSize, adaptive, rightEye,
+                                                  hmdRenderInfo, distortion, eyeToSourceNDC, pool );
+        break;
+    }
+    pInfo->NumVertices = (gridSize+1)*(gridSize+1);
+
+    // Populate index buffer info
+    if ( meshFlags & DistortionMesh_TriangleStrip )
+    {
+        distortionMeshStrip ( pIndices, gridSize, indexBase, pInfo );
+    }
+    else
+    {
+        distortionMeshTriangleList ( pIndices, gridSize, indexBase, pInfo );
+    }
+}
+
+// Writes a mesh made by DistortionMeshCreate in layout, as DistortionMeshWrite would.
+static void distortionMeshConvert ( const DistortionMeshVertexData *pSourceVertices, const UInt16 *pSourceIndices,
+                                    int numVertices, int numTriangles, int numIndices,
+                                    void *pVertices, const DistortionMeshVertexLayout &layout,
+                                    UInt16 *pIndices, UInt16 indexBase, DistortionMeshWriteInfo *pInfo,
+                                    bool rightEye )
+{
+    for ( int i = 0; i < numVertices; i++ )
+    {
+        distortionMeshStoreVertex ( pVertices, &layout, i, pSourceVertices[i], rightEye );
+    }
+    for ( int i = 0; i < numIndices; i++ )
+    {
+        pIndices[i] = (UInt16)( indexBase + pSourceIndices[i] );
+    }
+
+    pInfo->NumVertices  = numVertices;
+    pInfo->NumTriangles = numTriangles;
+    pInfo->NumIndices   = numIndices;
+    pInfo->FirstIndex   = (UInt16)( indexBase + ( numIndices ? pSourceIndices[0] : 0 ) );
+    pInfo->LastIndex    = (UInt16)( indexBase + ( numIndices ? pSourceIndices[numIndices-1] : 0 ) );
+}
+
+void DistortionMeshGetSize ( int *pNumVertices, int *pNumIndices, int gridSizeLog2, unsigned meshFlags )
+{
+    gridSizeLog2 = Alg::Clamp ( gridSizeLog2, (int)DistortionMeshGridSizeLog2_Min, (int)DistortionMeshGridSizeLog2_Max );
+    const int gridSize = 1 << gridSizeLog2;
+
+    *pNumVertices = (gridSize+1)*(gridSize+1);
+    if ( meshFlags & DistortionMesh_TriangleStrip )
+    {
+        DistortionMeshWriteInfo info;
+        distortionMeshStrip ( NULL, gridSize, 0, &info );
+        *pNumIndices = info.NumIndices;
+    }
+    else
+    {
+        *pNumIndices = gridSize * gridSize * 6;
+    }
+}
+
+// Generate distortion mesh for a eye.
+void DistortionMeshCreate( DistortionMeshVertexData **ppVertices, UInt16 **ppTriangleListIndices,
+                           int *pNumVertices, int *pNumTriangles,
+                           bool rightEye,
+                           const HmdRenderInfo &hmdRenderInfo, 
+                           const DistortionRenderDesc &distortion, const ScaleAndOffset2D &eyeToSourceNDC,
+                           int gridSizeLog2, unsigned meshFlags, ThreadPool* pool )
+{
+    int vertexCount;
+    int indexCount;
+    DistortionMeshGetSize ( &vertexCount, &indexCount, gridSizeLog2, meshFlags );
+
+    *ppVertices = (DistortionMeshVertexData*)
+                      OVR_SUBSYSTEM_ALLOC(AllocSubsystem_DistortionMesh, sizeof(DistortionMeshVertexData) * vertexCount);
+    *ppTriangleListIndices  = (UInt16*) OVR_SUBSYSTEM_ALLOC(AllocSubsystem_DistortionMesh, sizeof(UInt16) * indexCount);
+
+    if (!*ppVertices || !*ppTriangleListIndices)
+    {
+        if (*ppTriangleListIndices)
+        {
+            OVR_SUBSYSTEM_FREE(AllocSubsystem_DistortionMesh, *ppTriangleListIndices);
+        }
+        if (*ppVertices)
+        {
+            OVR_SUBSYSTEM_FREE(AllocSubsystem_DistortionMesh, *ppVertices);
+        }
+        *ppVertices             = NULL;
+        *ppTriangleListIndices  = NULL;
+        *pNumTriangles          = 0;
+        *pNumVertices           = 0;
+        return;
+    }
+
+    DistortionMeshWriteInfo info;
+    distortionMeshWrite ( *ppVertices, NULL, *ppTriangleListIndices, 0, &info,
+                          rightEye, hmdRenderInfo, distortion, eyeToSourceNDC,
+                          gridSizeLog2, meshFlags, pool );
+    *pNumVertices  = info.NumVertices;
+    *pNumTriangles = info.NumTriangles;
+}
+
+void DistortionMeshWrite ( void *pVertices, const DistortionMeshVertexLayout &layout,
+                           UInt16 *pIndices, UInt16 indexBase, DistortionMeshWriteInfo *pInfo,
+                           bool rightEye,
+                           const HmdRenderInfo &hmdRenderInfo,
+                           const DistortionRenderDesc &distortion, const ScaleAndOffset2D &eyeToSourceNDC,
+                           int gridSizeLog2, unsigned meshFlags, ThreadPool* pool )
+{
+    distortionMeshWrite ( pVertices, &layout, pIndices, indexBase, pInfo,
+                          rightEye, hmdRenderInfo, distortion, eyeToSourceNDC,
+                          gridSizeLog2, meshFlags, pool );
+}
+
+//-----------------------------------------------------------------------------------
+// *****  Distortion Mesh Cache
+
+// "OVRM", little-endian. Bump DistortionMeshCache::FileVersion whenever the meshes
+// DistortionMeshCreate makes change, so that files written earlier are ignored.
+static const UInt32 DMC_FileMagic = 0x4D52564F;
+
+static void distortionMeshCacheAppend ( Array<UByte>* data, const void* bytes, UPInt size )
+{
+    UPInt pos = data->GetSize();
+    data->Resize ( pos + size );
+    memcpy ( &(*data)[pos], bytes, size );
+}
+
+static void distortionMeshCacheAppendUInt32 ( Array<UByte>* data, UInt32 value )
+{
+    UByte bytes[4];
+    Alg::EncodeUInt32 ( bytes, value );
+    distortionMeshCacheAppend ( data, bytes, 4 );
+}
+
+static UInt32 distortionMeshCacheHash ( const Array<UByte>& key )
+{
+    // FNV-1a.
+    UInt32 hash = 2166136261u;
+    for ( UPInt i = 0; i < key.GetSize(); i++ )
+    {
+        hash = ( hash ^ key[i] ) * 16777619u;
+    }
+    return hash;
+}
+
+DistortionMeshCache::DistortionMeshCache ( int maxEntries )
+    : MaxEntries(Alg::Max(maxEntries, 1)), UseCounter(0)
+{
+}
+
+DistortionMeshCache::~DistortionMeshCache()
+{
+    Clear();
+}
+
+void DistortionMeshCache::makeKey ( Entry* entry, bool rightEye, const HmdRenderInfo &hmdRenderInfo,
+                                    const DistortionRenderDesc &distortion, const ScaleAndOffset2D &eyeToSourceNDC,
+                                    int gridSizeLog2, unsigned meshFlags )
+{
+    gridSizeLog2 = Alg::Clamp ( gridSizeLog2, (int)DistortionMeshGridSizeLog2_Min, (int)DistortionMeshGridSizeLog2_Max );
+
+    // Everything DistortionMeshCreate reads. Floats are compared bit for bit.
+    const LensConfig& lens    = distortion.Lens;
+    UByte             eye     = rightEye ? 1 : 0;
+    UInt32            shutter = (UInt32)hmdRenderInfo.Shutter.Type;
+    UInt32            eqn     = (UInt32)lens.Eqn;
+    distortionMeshCacheAppend ( &entry->Key, &eye, 1 );
+    distortionMeshCacheAppendUInt32 ( &entry->Key, shutter );
+    distortionMeshCacheAppendUInt32 ( &entry->Key, eqn );
+    distortionMeshCacheAppend ( &entry->Key, lens.K, sizeof(lens.K) );
+    distortionMeshCacheAppend ( &entry->Key, &lens.MaxR, sizeof(lens.MaxR) );
+    distortionMeshCacheAppend ( &entry->Key, &lens.MetersPerTanAngleAtCenter, sizeof(lens.MetersPerTanAngleAtCenter) );
+    distortionMeshCacheAppend ( &entry->Key, lens.ChromaticAberration, sizeof(lens.ChromaticAberration) );
+    distortionMeshCacheAppend ( &entry->Key, lens.InvK, sizeof(lens.InvK) );
+    distortionMeshCacheAppend ( &entry->Key, &lens.MaxInvR, sizeof(lens.MaxInvR) );
+    distortionMeshCacheAppend ( &entry->Key, &distortion.LensCenter, sizeof(Vector2f) );
+    distortionMeshCacheAppend ( &entry->Key, &distortion.TanEyeAngleScale, sizeof(Vector2f) );
+    distortionMeshCacheAppend ( &entry->Key, &eyeToSourceNDC.Scale, sizeof(Vector2f) );
+    distortionMeshCacheAppend ( &entry->Key, &eyeToSourceNDC.Offset, sizeof(Vector2f) );
+    distortionMeshCacheAppendUInt32 ( &entry->Key, (UInt32)gridSizeLog2 );
+    distortionMeshCacheAppendUInt32 ( &entry->Key, (UInt32)meshFlags );
+    entry->Hash = distortionMeshCacheHash ( entry->Key );
+}
+
+DistortionMeshCache::Entry* DistortionMeshCache::findEntry_NeedsLock ( const Entry& entry )
+{
+    for ( UPInt i = 0; i < Entries.GetSize(); i++ )
+    {
+        Entry& cached = Entries[i];
+        if ( cached.Hash == entry.Hash && cached.Key.GetSize() == entry.Key.GetSize() &&
+             memcmp ( &cached.Key[0], &entry.Key[0], entry.Key.GetSize() ) == 0 )
+        {
+            cached.LastUse = ++UseCounter;
+            return &cached;
+        }
+    }
+    return NULL;
+}
 
-            *pcurIndex++ = (UInt16)FirstVertex+1;
-            *pcurIndex++ = (UInt16)FirstVertex+(DMA_GridSize+1)+1;
-            *pcurIndex++ = (UInt16)FirstVertex+(DMA_GridSize+1);
+bool DistortionMeshCache::buildEntry ( Entry* entry, bool rightEye, const HmdRenderInfo &hmdRenderInfo,
+                                       const DistortionRenderDesc &distortion, const ScaleAndOffset2D &eyeToSourceNDC,
+                                       int gridSizeLog2, unsigned meshFlags, ThreadPool* pool )
+{
+    DistortionMeshCreate ( &entry->pVertices, &entry->pIndices, &entry->NumVertices, &entry->NumTriangles,
+                           rightEye, hmdRenderInfo, distortion, eyeToSourceNDC,
+                           gridSizeLog2, meshFlags, pool );
+    entry->NumIndices = ( meshFlags & DistortionMesh_TriangleStrip ) ? entry->NumTriangles + 2 : entry->NumTriangles * 3;
+    return entry->pVertices != NULL;
+}
+
+void DistortionMeshCache::Create ( DistortionMeshVertexData **ppVertices, UInt16 **ppTriangleListIndices,
+                                   int *pNumVertices, int *pNumTriangles,
+                                   bool rightEye,
+                                   const HmdRenderInfo &hmdRenderInfo,
+                                   const DistortionRenderDesc &distortion, const ScaleAndOffset2D &eyeToSourceNDC,
+                                   int gridSizeLog2, unsigned meshFlags, ThreadPool* pool )
+{
+    Entry entry;
+    makeKey ( &entry, rightEye, hmdRenderInfo, distortion, eyeToSourceNDC, gridSizeLog2, meshFlags );
+
+    {
+        Lock::Locker lock ( &CacheLock );
+        if ( Entry* cached = findEntry_NeedsLock ( entry ) )
+        {
+            *ppVertices = (DistortionMeshVertexData*)
+                              OVR_SUBSYSTEM_ALLOC(AllocSubsystem_DistortionMesh, sizeof(DistortionMeshVertexData) * cached->NumVertices);
+            *ppTriangleListIndices = (UInt16*) OVR_SUBSYSTEM_ALLOC(AllocSubsystem_DistortionMesh, sizeof(UInt16) * cached->NumIndices);
+            if ( !*ppVertices || !*ppTriangleListIndices )
+            {
+                DistortionMeshDestroy ( *ppVertices, *ppTriangleListIndices );
+                *ppVertices             = NULL;
+                *ppTriangleListIndices  = NULL;
+                *pNumTriangles          = 0;
+                *pNumVertices           = 0;
+                return;
+            }
+            memcpy ( *ppVertices, cached->pVertices, sizeof(DistortionMeshVertexData) * cached->NumVertices );
+            memcpy ( *ppTriangleListIndices, cached->pIndices, sizeof(UInt16) * cached->NumIndices );
+            *pNumVertices  = cached->NumVertices;
+            *pNumTriangles = cached->NumTriangles;
+            return;
+        }
+    }
+
+    // Not cached; generate it without holding the lock, then keep a copy.
+    DistortionMeshCreate ( ppVertices, ppTriangleListIndices, pNumVertices, pNumTriangles,
+                           rightEye, hmdRenderInfo, distortion, eyeToSourceNDC,
+                           gridSizeLog2, meshFlags, pool );
+    if ( !*ppVertices )
+    {
+        return;
+    }
+
+    entry.NumVertices  = *pNumVertices;
+    entry.NumTriangles = *pNumTriangles;
+    entry.NumIndices   = ( meshFlags & DistortionMesh_TriangleStrip ) ? entry.NumTriangles + 2 : entry.NumTriangles * 3;
+    entry.pVertices    = (DistortionMeshVertexData*)
+                             OVR_SUBSYSTEM_ALLOC(AllocSubsystem_DistortionMesh, sizeof(DistortionMeshVertexData) * entry.NumVertices);
+    entry.pIndices     = (UInt16*) OVR_SUBSYSTEM_ALLOC(AllocSubsystem_DistortionMesh, sizeof(UInt16) * entry.NumIndices);
+    if ( !entry.pVertices || !entry.pIndices )
+    {
+        DistortionMeshDestroy ( entry.pVertices, entry.pIndices );
+        return;
+    }
+    memcpy ( entry.pVertices, *ppVertices, sizeof(DistortionMeshVertexData) * entry.NumVertices );
+    memcpy ( entry.pIndices, *ppTriangleListIndices, sizeof(UInt16) * entry.NumIndices );
+
+    Lock::Locker lock ( &CacheLock );
+    addEntry ( entry );
+    if ( !FilePath.IsEmpty() )
+    {
+        save();
+    }
+}
+
+void DistortionMeshCache::Write ( void *pVertices, const DistortionMeshVertexLayout &layout,
+                                  UInt16 *pIndices, UInt16 indexBase, DistortionMeshWriteInfo *pInfo,
+                                  bool rightEye,
+                                  const HmdRenderInfo &hmdRenderInfo,
+                                  const DistortionRenderDesc &distortion, const ScaleAndOffset2D &eyeToSourceNDC,
+                                  int gridSizeLog2, unsigned meshFlags, ThreadPool* pool )
+{
+    Entry entry;
+    makeKey ( &entry, rightEye, hmdRenderInfo, distortion, eyeToSourceNDC, gridSizeLog2, meshFlags );
+
+    {
+        // Converted under the lock, which keeps the entry from being evicted.
+        Lock::Locker lock ( &CacheLock );
+        if ( Entry* cached = findEntry_NeedsLock ( entry ) )
+        {
+            distortionMeshConvert ( cached->pVertices, cached->pIndices,
+                                    cached->NumVertices, cached->NumTriangles, cached->NumIndices,
+                                    pVertices, layout, pIndices, indexBase, pInfo, rightEye );
+            return;
+        }
+    }
+
+    // Not cached; generate it into a new entry without holding the lock.
+    if ( !buildEntry ( &entry, rightEye, hmdRenderInfo, distortion, eyeToSourceNDC, gridSizeLog2, meshFlags, pool ) )
+    {
+        // Out of memory; write the mesh without keeping it.
+        DistortionMeshWrite ( pVertices, layout, pIndices, indexBase, pInfo,
+                              rightEye, hmdRenderInfo, distortion, eyeToSourceNDC,
+                              gridSizeLog2, meshFlags, pool );
+        return;
+    }
+    distortionMeshConvert ( entry.pVertices, entry.pIndices, entry.NumVertices, entry.NumTriangles, entry.NumIndices,
+                            pVertices, layout, pIndices, indexBase, pInfo, rightEye );
+
+    Lock::Locker lock ( &CacheLock );
+    addEntry ( entry );
+    if ( !FilePath.IsEmpty() )
+    {
+        save();
+    }
+}
+
+void DistortionMeshCache::SetFile ( const String& path )
+{
+    Lock::Locker lock ( &CacheLock );
+    FilePath = path;
+    if ( !FilePath.IsEmpty() )
+    {
+        load();
+    }
+}
+
+void DistortionMeshCache::Clear()
+{
+    Lock::Locker lock ( &CacheLock );
+    for ( UPInt i = 0; i < Entries.GetSize(); i++ )
+    {
+        DistortionMeshDestroy ( Entries[i].pVertices, Entries[i].pIndices );
+    }
+    Entries.Clear();
+}
+
+void DistortionMeshCache::addEntry ( const Entry& entry )
+{
+    // Another thread may have made the same mesh meanwhile.
+    if ( findEntry_NeedsLock ( entry ) )
+    {
+        DistortionMeshDestroy ( entry.pVertices, entry.pIndices );
+        return;
+    }
+
+    if ( (int)Entries.GetSize() >= MaxEntries )
+    {
+        UPInt oldest = 0;
+        for ( UPInt i = 1; i < Entries.GetSize(); i++ )
+        {
+            if ( (SInt32)( Entries[i].LastUse - Entries[oldest].LastUse ) < 0 )
+            {
+                oldest = i;
+            }
+        }
+        DistortionMeshDestroy ( Entries[oldest].pVertices, Entries[oldest].pIndices );
+        Entries.RemoveAt ( oldest );
+    }
+
+    Entries.PushBack ( entry );
+    Entries.Back().LastUse = ++UseCounter;
+}
+
+// File layout: magic, file version, vertex size and entry count, then for each
+// entry its key size, key, vertex, triangle and index counts, vertices and indices.
+// Counts are little-endian; vertex data is stored as in memory, and the vertex
+// size in the header gates it.
+bool DistortionMeshCache::load()
+{
+    MappedFile file;
+    if ( !file.Open ( FilePath ) )
+    {
+        return false;
+    }
+    const UByte* data = file.GetData();
+    UPInt        size = (UPInt)file.GetLength();
+
+    if ( size < 16 ||
+         Alg::DecodeUInt32 ( data )      != DMC_FileMagic ||
+         Alg::DecodeUInt32 ( data + 4 )  != FileVersion ||
+         Alg::DecodeUInt32 ( data + 8 )  != sizeof(DistortionMeshVertexData) )
+    {
+        return false;
+    }
+    UInt32 count = Alg::DecodeUInt32 ( data + 12 );
+    UPInt  pos   = 16;
+
+    for ( UInt32 i = 0; i < count; i++ )
+    {
+        if ( size - pos < 16 )
+        {
+            return false;
+        }
+        UPInt keySize = Alg::DecodeUInt32 ( data + pos );
+        int   numVertices  = (int)Alg::DecodeUInt32 ( data + pos + 4 );
+        int   numTriangles = (int)Alg::DecodeUInt32 ( data + pos + 8 );
+        int   numIndices   = (int)Alg::DecodeUInt32 ( data + pos + 12 );
+        pos += 16;
+
+        UPInt vertexBytes = sizeof(DistortionMeshVertexData) * (UPInt)numVertices;
+        UPInt indexBytes  = sizeof(UInt16) * (UPInt)numIndices;
+        if ( keySize == 0 || numVertices <= 0 || numIndices <= 0 ||
+             numVertices > 0x10000 || numIndices > 0x100000 ||
+             ( numIndices != numTriangles * 3 && numIndices != numTriangles + 2 ) ||
+             size - pos < keySize + vertexBytes + indexBytes )
+        {
+            return false;
+        }
+
+        Entry entry;
+        distortionMeshCacheAppend ( &entry.Key, data + pos, keySize );
+        entry.Hash         = distortionMeshCacheHash ( entry.Key );
+        entry.NumVertices  = numVertices;
+        entry.NumTriangles = numTriangles;
+        entry.NumIndices   = numIndices;
+        entry.pVertices    = (DistortionMeshVertexData*) OVR_SUBSYSTEM_ALLOC(AllocSubsystem_DistortionMesh, vertexBytes);
+        entry.pIndices     = (UInt16*) OVR_SUBSYSTEM_ALLOC(AllocSubsystem_DistortionMesh, indexBytes);
+        if ( !entry.pVertices || !entry.pIndices )
+        {
+            DistortionMeshDestroy ( entry.pVertices, entry.pIndices );
+            return false;
+        }
+        memcpy ( entry.pVertices, data + pos + keySize, vertexBytes );
+        memcpy ( entry.pIndices, data + pos + keySize + vertexBytes, indexBytes );
+        for ( int j = 0; j < numIndices; j++ )
+        {
+            if ( entry.pIndices[j] >= numVertices )
+            {
+                DistortionMeshDestroy ( entry.pVertices, entry.pIndices );
+                return false;
+            }
         }
+        addEntry ( entry );
+        pos += keySize + vertexBytes + indexBytes;
     }
+    return true;
+}
+
+bool DistortionMeshCache::save() const
+{
+    Array<UByte> data;
+    distortionMeshCacheAppendUInt32 ( &data, DMC_FileMagic );
+    distortionMeshCacheAppendUInt32 ( &data, FileVersion );
+    distortionMeshCacheAppendUInt32 ( &data, sizeof(DistortionMeshVertexData) );
+    distortionMeshCacheAppendUInt32 ( &data, (UInt32)Entries.GetSize() );
+    for ( UPInt i = 0; i < Entries.GetSize(); i++ )
+    {
+        const Entry& entry = Entries[i];
+        distortionMeshCacheAppendUInt32 ( &data, (UInt32)entry.Key.GetSize() );
+        distortionMeshCacheAppendUInt32 ( &data, (UInt32)entry.NumVertices );
+        distortionMeshCacheAppendUInt32 ( &data, (UInt32)entry.NumTriangles );
+        distortionMeshCacheAppendUInt32 ( &data, (UInt32)entry.NumIndices );
+        distortionMeshCacheAppend ( &data, &entry.Key[0], entry.Key.GetSize() );
+        distortionMeshCacheAppend ( &data, entry.pVertices, sizeof(DistortionMeshVertexData) * entry.NumVertices );
+        distortionMeshCacheAppend ( &data, entry.pIndices, sizeof(UInt16) * entry.NumIndices );
+    }
+
+    // Write a new file and move it over the old one, so that another process
+    // loading the cache meanwhile never sees it half written.
+    String tempPath = FilePath + ".tmp";
+    SysFile file;
+    if ( !file.Open ( tempPath, File::Open_Write | File::Open_Create | File::Open_Truncate ) )
+    {
+        LogError ( "OVR::DistortionMeshCache - can't write '%s'\n", tempPath.ToCStr() );
+        return false;
+    }
+    bool written = file.Write ( &data[0], (int)data.GetSize() ) == (int)data.GetSize();
+    file.Close();
+
+#if defined(OVR_OS_WIN32)
+    // rename doesn't replace existing files on Windows.
+    if ( written )
+    {
+        remove ( FilePath.ToCStr() );
+    }
+#endif
+    if ( !written || rename ( tempPath.ToCStr(), FilePath.ToCStr() ) != 0 )
+    {
+        remove ( tempPath.ToCStr() );
+        return false;
+    }
+    return true;
 }
 
 //-----------------------------------------------------------------------------------
@@ -1015,8 +1841,9 @@ static const int HMA_NumTrisPerEye  = (HMA_GridSize)*(HMA_GridSize)*2;
 
 void HeightmapMeshDestroy ( HeightmapMeshVertexData *pVertices, UInt16 *pTriangleMeshIndices )
 {
-    OVR_FREE ( pVertices );
-    OVR_FREE ( pTriangleMeshIndices );
+    // Freed in reverse allocation order, for arena allocators.
+    OVR_SUBSYSTEM_FREE(AllocSubsystem_DistortionMesh, pTriangleMeshIndices);
+    OVR_SUBSYSTEM_FREE(AllocSubsystem_DistortionMesh, pVertices);
 }
 
 void HeightmapMeshCreate ( HeightmapMeshVertexData **ppVertices, UInt16 **ppTriangleListIndices,
@@ -1036,35 +1863,37 @@ void HeightmapMeshCreate ( HeightmapMeshVertexData **ppVertices, UInt16 **ppTria
 }
 
 
-// Generate heightmap mesh for one eye.
-void HeightmapMeshCreate( HeightmapMeshVertexData **ppVertices, UInt16 **ppTriangleListIndices,
-    int *pNumVertices, int *pNumTriangles, bool rightEye,
-    const HmdRenderInfo &hmdRenderInfo,
-    const ScaleAndOffset2D &eyeToSourceNDC )
+HeightmapMeshVertexLayout::HeightmapMeshVertexLayout()
+    : Stride       ( sizeof(HeightmapMeshVertexData) ),
+      ScreenPosNDC ( offsetof(HeightmapMeshVertexData, ScreenPosNDC) ),
+      TimewarpLerp ( offsetof(HeightmapMeshVertexData, TimewarpLerp) ),
+      TanEyeAngles ( offsetof(HeightmapMeshVertexData, TanEyeAngles) )
 {
-    *pNumVertices  = HMA_NumVertsPerEye;
-    *pNumTriangles = HMA_NumTrisPerEye;
-
-    *ppVertices = (HeightmapMeshVertexData*) OVR_ALLOC( sizeof(HeightmapMeshVertexData) * (*pNumVertices) );
-    *ppTriangleListIndices  = (UInt16*) OVR_ALLOC( sizeof(UInt16) * (*pNumTriangles) * 3 );
+}
 
-    if (!*ppVertices || !*ppTriangleListIndices)
+// Stores vertex number index of pVertices in pLayout, or as HeightmapMeshVertexData
+// if pLayout is null.
+static void heightmapMeshStoreVertex ( void *pVertices, const HeightmapMeshVertexLayout *pLayout, int index,
+                                       const HeightmapMeshVertexData &vertex )
+{
+    if ( !pLayout )
     {
-        if (*ppVertices)
-        {
-            OVR_FREE(*ppVertices);
-        }
-        if (*ppTriangleListIndices)
-        {
-            OVR_FREE(*ppTriangleListIndices);
-        }
-        *ppVertices             = NULL;
-        *ppTriangleListIndices  = NULL;
-        *pNumTriangles          = 0;
-        *pNumVertices           = 0;
+        ((HeightmapMeshVertexData*)pVertices)[index] = vertex;
         return;
     }
 
+    UByte* pVertex = (UByte*)pVertices + index * pLayout->Stride;
+    distortionMeshStoreBytes ( pVertex, pLayout->ScreenPosNDC, &vertex.ScreenPosNDC, sizeof(Vector2f) );
+    distortionMeshStoreBytes ( pVertex, pLayout->TimewarpLerp, &vertex.TimewarpLerp, sizeof(float) );
+    distortionMeshStoreBytes ( pVertex, pLayout->TanEyeAngles, &vertex.TanEyeAngles, sizeof(Vector2f) );
+}
+
+// Writes the mesh of HeightmapMeshCreate and HeightmapMeshWrite, its vertices as
+// heightmapMeshStoreVertex does.
+static void heightmapMeshWrite ( void *pVertices, const HeightmapMeshVertexLayout *pLayout,
+                                 UInt16 *pIndices, UInt16 indexBase, bool rightEye,
+                                 const HmdRenderInfo &hmdRenderInfo, const ScaleAndOffset2D &eyeToSourceNDC )
+{
     // Populate vertex buffer info
     float xOffset = 0.0f;
     float uOffset = 0.0f;
@@ -1076,12 +1905,13 @@ void HeightmapMeshCreate( HeightmapMeshVertexData **ppVertices, UInt16 **ppTrian
     }
 
     // First pass - build up raw vertex data.
-    HeightmapMeshVertexData* pcurVert = *ppVertices;
-
     for ( int y = 0; y <= HMA_GridSize; y++ )
     {
         for ( int x = 0; x <= HMA_GridSize; x++ )
         {
+            HeightmapMeshVertexData  vertex;
+            HeightmapMeshVertexData* pcurVert = &vertex;
+
             Vector2f sourceCoordNDC;
             // NDC texture coords [-1,+1]
             sourceCoordNDC.x = 2.0f * ( (float)x / (float)HMA_GridSize ) - 1.0f;
@@ -1127,78 +1957,59 @@ void HeightmapMeshCreate( HeightmapMeshVertexData **ppVertices, UInt16 **ppTrian
             pcurVert->ScreenPosNDC.x = sourceCoordNDC.x;
             pcurVert->ScreenPosNDC.y = -sourceCoordNDC.y;
 
-            pcurVert++;
+            heightmapMeshStoreVertex ( pVertices, pLayout, y * (HMA_GridSize+1) + x, vertex );
         }
     }
 
 
-    // Populate index buffer info  
-    UInt16 *pcurIndex = *ppTriangleListIndices;
+    // Populate index buffer info; the grid is split as the distortion mesh's is.
+    DistortionMeshWriteInfo info;
+    distortionMeshTriangleList ( pIndices, HMA_GridSize, indexBase, &info );
+}
+
+void HeightmapMeshGetSize ( int *pNumVertices, int *pNumIndices )
+{
+    *pNumVertices = HMA_NumVertsPerEye;
+    *pNumIndices  = HMA_NumTrisPerEye * 3;
+}
+
+// Generate heightmap mesh for one eye.
+void HeightmapMeshCreate( HeightmapMeshVertexData **ppVertices, UInt16 **ppTriangleListIndices,
+    int *pNumVertices, int *pNumTriangles, bool rightEye,
+    const HmdRenderInfo &hmdRenderInfo,
+    const ScaleAndOffset2D &eyeToSourceNDC )
+{
+    *pNumVertices  = HMA_NumVertsPerEye;
+    *pNumTriangles = HMA_NumTrisPerEye;
+
+    *ppVertices = (HeightmapMeshVertexData*) OVR_SUBSYSTEM_ALLOC(AllocSubsystem_DistortionMesh, sizeof(HeightmapMeshVertexData) * (*pNumVertices));
+    *ppTriangleListIndices  = (UInt16*) OVR_SUBSYSTEM_ALLOC(AllocSubsystem_DistortionMesh, sizeof(UInt16) * (*pNumTriangles) * 3);
 
-    for ( int triNum = 0; triNum < HMA_GridSize * HMA_GridSize; triNum++ )
+    if (!*ppVertices || !*ppTriangleListIndices)
     {
-        // Use a Morton order to help locality of FB, texture and vertex cache.
-        // (0.325ms raster order -> 0.257ms Morton order)
-        OVR_ASSERT ( HMA_GridSize < 256 );
-        int x = ( ( triNum & 0x0001 ) >> 0 ) |
-                ( ( triNum & 0x0004 ) >> 1 ) |
-                ( ( triNum & 0x0010 ) >> 2 ) |
-                ( ( triNum & 0x0040 ) >> 3 ) |
-                ( ( triNum & 0x0100 ) >> 4 ) |
-                ( ( triNum & 0x0400 ) >> 5 ) |
-                ( ( triNum & 0x1000 ) >> 6 ) |
-                ( ( triNum & 0x4000 ) >> 7 );
-        int y = ( ( triNum & 0x0002 ) >> 1 ) |
-                ( ( triNum & 0x0008 ) >> 2 ) |
-                ( ( triNum & 0x0020 ) >> 3 ) |
-                ( ( triNum & 0x0080 ) >> 4 ) |
-                ( ( triNum & 0x0200 ) >> 5 ) |
-                ( ( triNum & 0x0800 ) >> 6 ) |
-                ( ( triNum & 0x2000 ) >> 7 ) |
-                ( ( triNum & 0x8000 ) >> 8 );
-        int FirstVertex = x * (HMA_GridSize+1) + y;
-        // Another twist - we want the top-left and bottom-right quadrants to
-        // have the triangles split one way, the other two split the other.
-        // +---+---+---+---+
-        // |  /|  /|\  |\  |
-        // | / | / | \ | \ |
-        // |/  |/  |  \|  \|
-        // +---+---+---+---+
-        // |  /|  /|\  |\  |
-        // | / | / | \ | \ |
-        // |/  |/  |  \|  \|
-        // +---+---+---+---+
-        // |\  |\  |  /|  /|
-        // | \ | \ | / | / |
-        // |  \|  \|/  |/  |
-        // +---+---+---+---+
-        // |\  |\  |  /|  /|
-        // | \ | \ | / | / |
-        // |  \|  \|/  |/  |
-        // +---+---+---+---+
-        // This way triangle edges don't span long distances over the distortion function,
-        // so linear interpolation works better & we can use fewer tris.
-        if ( ( x < HMA_GridSize/2 ) != ( y < HMA_GridSize/2 ) )       // != is logical XOR
+        if (*ppTriangleListIndices)
         {
-            *pcurIndex++ = (UInt16)FirstVertex;
-            *pcurIndex++ = (UInt16)FirstVertex+1;
-            *pcurIndex++ = (UInt16)FirstVertex+(HMA_GridSize+1)+1;
-
-            *pcurIndex++ = (UInt16)FirstVertex+(HMA_GridSize+1)+1;
-            *pcurIndex++ = (UInt16)FirstVertex+(HMA_GridSize+1);
-            *pcurIndex++ = (UInt16)FirstVertex;
+            OVR_SUBSYSTEM_FREE(AllocSubsystem_DistortionMesh, *ppTriangleListIndices);
         }
-        else
+        if (*ppVertices)
         {
-            *pcurIndex++ = (UInt16)FirstVertex;
-            *pcurIndex++ = (UInt16)FirstVertex+1;
-            *pcurIndex++ = (UInt16)FirstVertex+(HMA_GridSize+1);
-
-            *pcurIndex++ = (UInt16)FirstVertex+1;
-            *pcurIndex++ = (UInt16)FirstVertex+(HMA_GridSize+1)+1;
-            *pcurIndex++ = (UInt16)FirstVertex+(HMA_GridSize+1);
+            OVR_SUBSYSTEM_FREE(AllocSubsystem_DistortionMesh, *ppVertices);
         }
+        *ppVertices             = NULL;
+        *ppTriangleListIndices  = NULL;
+        *pNumTriangles          = 0;
+        *pNumVertices           = 0;
+        return;
     }
+
+    heightmapMeshWrite ( *ppVertices, NULL, *ppTriangleListIndices, 0, rightEye, hmdRenderInfo, eyeToSourceNDC );
+}
+
+void HeightmapMeshWrite ( void *pVertices, const HeightmapMeshVertexLayout &layout,
+                          UInt16 *pIndices, UInt16 indexBase, bool rightEye,
+                          const HmdRenderInfo &hmdRenderInfo, const ScaleAndOffset2D &eyeToSourceNDC )
+{
+    heightmapMeshWrite ( pVertices, &layout, pIndices, indexBase, rightEye, hmdRenderInfo, eyeToSourceNDC );
 }
 
 //-----------------------------------------------------------------------------------
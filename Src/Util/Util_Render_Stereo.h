@@ -34,6 +34,7 @@ limitations under the License.
 namespace OVR {
 
 class SensorFusion;
+class ThreadPool;
 
 namespace Util { namespace Render {
 
@@ -181,7 +182,7 @@ public:
 
     // Sets a stereo rendering mode and updates internal cached
     // state (matrices, per-eye view) based on it.
-    void        SetStereoMode(StereoMode mode)  { Mode = mode; DirtyFlag = true; }
+    void        SetStereoMode(StereoMode mode)  { Mode = mode; DirtyFlags = Dirty_All; }
     StereoMode  GetStereoMode() const           { return Mode; }
 
     // Sets the fieldOfView that the 2D coordinate area stretches to.
@@ -230,12 +231,14 @@ public:
 
     // The dirty flag is set by any of the above calls. Just handy for the app to know
     // if e.g. the distortion mesh needs regeneration.
-    void        SetDirty() { DirtyFlag = true; }
-    bool        IsDirty() { return DirtyFlag; }
+    void        SetDirty() { DirtyFlags = Dirty_All; }
+    bool        IsDirty() { return DirtyFlags != 0; }
 
     // An app never needs to call this - GetEyeRenderParams will call it internally if
     // the state is dirty. However apps can call this explicitly to control when and where
     // computation is performed (e.g. not inside critical loops)
+    // Only the parts of the state the calls since the last update affect are recomputed,
+    // so e.g. changing the clip planes every frame just rebuilds the projections.
     void        UpdateComputedState();
 
     // This returns the projection matrix with a "zoom". Does not modify any internal state.
@@ -297,10 +300,22 @@ private:
     bool               IsRendertargetSharedByBothEyes;
     bool               RightHandedProjection;
 
-    bool               DirtyFlag;   // Set when any if the modifiable state changed. Does NOT get set by SetRender*()
+    // Parts of the computed state that are out of date; set when any of the modifiable
+    // state changed. Does NOT get set by SetRender*(). Recomputing the distortion and
+    // FOV recomputes everything after it, and recomputing the projections the ortho ones.
+    enum DirtyFlagBits
+    {
+        Dirty_DistortionAndFov  = 0x01,
+        Dirty_Projection        = 0x02,
+        Dirty_Ortho             = 0x04,
+        Dirty_Viewports         = 0x08,
+        Dirty_All               = 0x0F
+    };
+    unsigned           DirtyFlags;
 
-    // Utility function.
+    // Utility functions.
     ViewportScaleAndOffsetBothEyes setupViewportScaleAndOffsets();
+    void               setupOrthoProjection ( int eyeNum, StereoEye eyeType );
 
     // *** Computed State
 
@@ -334,21 +349,175 @@ struct DistortionMeshVertexData
 };
 
 
+// A distortion mesh is a grid of (1 << gridSizeLog2) cells on each side.
+enum
+{
+    // Evenly spaced, 4 is too low - it is easy to see the "wobbles" in the HMD.
+    // 5 is realllly close but you can see pixel differences with even/odd frame checking.
+    // 6 is indistinguishable on a monitor on even/odd frames.
+    DistortionMeshGridSizeLog2_Min     = 2,
+    DistortionMeshGridSizeLog2_Default = 6,
+    // 129x129 vertices; larger grids can't be indexed with 16 bits.
+    DistortionMeshGridSizeLog2_Max     = 7
+};
+
+// Options for DistortionMeshCreate.
+enum DistortionMeshFlags
+{
+    // Spaces the grid lines by the curvature of the distortion instead of evenly,
+    // so that a coarser grid is as accurate as a finer even one.
+    DistortionMesh_Adaptive      = 0x01,
+    // Returns the indices as a single triangle strip, walked in narrow bands for
+    // the vertex cache, instead of a triangle list. pNumTriangles then counts
+    // the strip's triangles, including degenerate ones, so there are
+    // pNumTriangles + 2 indices.
+    DistortionMesh_TriangleStrip = 0x02
+};
+
 void DistortionMeshCreate ( DistortionMeshVertexData **ppVertices, UInt16 **ppTriangleListIndices,
                             int *pNumVertices, int *pNumTriangles,
                             const StereoEyeParams &stereoParams, const HmdRenderInfo &hmdRenderInfo );
 
 // Generate distortion mesh for a eye. This version requires less data then stereoParms, supporting
-// dynamic change in render target viewport.
+// dynamic change in render target viewport. gridSizeLog2 is clamped to the range above and
+// meshFlags combines DistortionMeshFlags. If pool is given, the vertex rows are built by its
+// threads together with the calling one.
 void DistortionMeshCreate( DistortionMeshVertexData **ppVertices, UInt16 **ppTriangleListIndices,
                            int *pNumVertices, int *pNumTriangles,
                            bool rightEye,
                            const HmdRenderInfo &hmdRenderInfo, 
-                           const DistortionRenderDesc &distortion, const ScaleAndOffset2D &eyeToSourceNDC );
+                           const DistortionRenderDesc &distortion, const ScaleAndOffset2D &eyeToSourceNDC,
+                           int gridSizeLog2 = DistortionMeshGridSizeLog2_Default, unsigned meshFlags = 0,
+                           ThreadPool* pool = NULL );
 
 void DistortionMeshDestroy ( DistortionMeshVertexData *pVertices, UInt16 *pTriangleMeshIndices );
 
 
+// A caller's vertex format for DistortionMeshWrite: the byte offset of each attribute
+// in a vertex of Stride bytes, or -1 to leave it out. Positions and tan(angle) values
+// are two floats. TimewarpLerp and Shade are floats, or unsigned bytes scaled to [0,255]
+// with TimewarpLerpByte and ShadeBytes, Shade then being repeated ShadeBytes times (such
+// as for the RGB of a color). EyeIndex is a float, 0 for the left eye and 1 for the right.
+struct DistortionMeshVertexLayout
+{
+    int     Stride;
+    int     ScreenPosNDC;
+    int     TimewarpLerp;
+    int     Shade;
+    int     TanEyeAnglesR;
+    int     TanEyeAnglesG;
+    int     TanEyeAnglesB;
+    int     EyeIndex;
+    bool    TimewarpLerpByte;
+    int     ShadeBytes;
+
+    // The layout of DistortionMeshVertexData.
+    DistortionMeshVertexLayout();
+};
+
+// Sizes of a mesh written by DistortionMeshWrite.
+struct DistortionMeshWriteInfo
+{
+    int     NumVertices;
+    int     NumTriangles;
+    int     NumIndices;
+    // The first and last index written, indexBase included, for joining strips.
+    UInt16  FirstIndex;
+    UInt16  LastIndex;
+};
+
+// Returns the vertex and index counts of the meshes made with these options.
+void DistortionMeshGetSize ( int *pNumVertices, int *pNumIndices,
+                             int gridSizeLog2 = DistortionMeshGridSizeLog2_Default, unsigned meshFlags = 0 );
+
+// Same as DistortionMeshCreate, but writes the mesh into buffers of the caller, such as
+// mapped GPU buffers, with room for the counts from DistortionMeshGetSize. Vertices are
+// written in layout and indexBase is added to each index, so that meshes can share
+// buffers. The buffers are only written to, never read.
+void DistortionMeshWrite ( void *pVertices, const DistortionMeshVertexLayout &layout,
+                           UInt16 *pIndices, UInt16 indexBase, DistortionMeshWriteInfo *pInfo,
+                           bool rightEye,
+                           const HmdRenderInfo &hmdRenderInfo,
+                           const DistortionRenderDesc &distortion, const ScaleAndOffset2D &eyeToSourceNDC,
+                           int gridSizeLog2 = DistortionMeshGridSizeLog2_Default, unsigned meshFlags = 0,
+                           ThreadPool* pool = NULL );
+
+
+// Keeps the most recently generated distortion meshes, so that switching back to
+// an earlier FOV, render density or set of options doesn't generate them again.
+// Meshes are keyed by all the inputs of DistortionMeshCreate that affect its
+// output; the key bytes are compared, so a hash collision can't return the
+// wrong mesh. Thread-safe.
+//
+// With SetFile, the meshes in the file are loaded and the file is rewritten
+// whenever a mesh is added, so they can also be reused by later processes.
+class DistortionMeshCache : public NewOverrideBase
+{
+public:
+    enum { DefaultMaxEntries = 16, FileVersion = 2 };
+
+    DistortionMeshCache ( int maxEntries = DefaultMaxEntries );
+    ~DistortionMeshCache();
+
+    // Same as DistortionMeshCreate, but copies a cached mesh if one was made with
+    // the same parameters. The result is freed with DistortionMeshDestroy.
+    void Create ( DistortionMeshVertexData **ppVertices, UInt16 **ppTriangleListIndices,
+                  int *pNumVertices, int *pNumTriangles,
+                  bool rightEye,
+                  const HmdRenderInfo &hmdRenderInfo,
+                  const DistortionRenderDesc &distortion, const ScaleAndOffset2D &eyeToSourceNDC,
+                  int gridSizeLog2 = DistortionMeshGridSizeLog2_Default, unsigned meshFlags = 0,
+                  ThreadPool* pool = NULL );
+    // Same as DistortionMeshWrite, writing a cached mesh if there is one.
+    void Write ( void *pVertices, const DistortionMeshVertexLayout &layout,
+                 UInt16 *pIndices, UInt16 indexBase, DistortionMeshWriteInfo *pInfo,
+                 bool rightEye,
+                 const HmdRenderInfo &hmdRenderInfo,
+                 const DistortionRenderDesc &distortion, const ScaleAndOffset2D &eyeToSourceNDC,
+                 int gridSizeLog2 = DistortionMeshGridSizeLog2_Default, unsigned meshFlags = 0,
+                 ThreadPool* pool = NULL );
+
+    // Loads the meshes stored in path, if any, and saves there from now on.
+    void SetFile ( const String& path );
+    void Clear();
+
+private:
+    struct Entry
+    {
+        UInt32                      Hash;
+        Array<UByte>                Key;
+        DistortionMeshVertexData*   pVertices;
+        UInt16*                     pIndices;
+        int                         NumVertices;
+        int                         NumTriangles;
+        int                         NumIndices;
+        // Value of UseCounter when last returned; the least recent is evicted.
+        UInt32                      LastUse;
+    };
+
+    // Sets the key of entry from everything DistortionMeshCreate reads.
+    static void makeKey ( Entry* entry, bool rightEye, const HmdRenderInfo &hmdRenderInfo,
+                          const DistortionRenderDesc &distortion, const ScaleAndOffset2D &eyeToSourceNDC,
+                          int gridSizeLog2, unsigned meshFlags );
+    // Returns the entry with the key of entry, marking it used, or null.
+    Entry* findEntry_NeedsLock ( const Entry& entry );
+    // Builds the mesh of an entry keyed by makeKey; returns false if out of memory.
+    static bool buildEntry ( Entry* entry, bool rightEye, const HmdRenderInfo &hmdRenderInfo,
+                             const DistortionRenderDesc &distortion, const ScaleAndOffset2D &eyeToSourceNDC,
+                             int gridSizeLog2, unsigned meshFlags, ThreadPool* pool );
+    // Adds an entry, taking ownership of its mesh, and evicts the oldest if full.
+    void addEntry ( const Entry& entry );
+    bool load();
+    bool save() const;
+
+    Lock            CacheLock;
+    int             MaxEntries;
+    UInt32          UseCounter;
+    Array<Entry>    Entries;
+    String          FilePath;
+};
+
+
 //-----------------------------------------------------------------------------------
 // *****  Heightmap Mesh Rendering
 //
@@ -380,6 +549,28 @@ void HeightmapMeshCreate( HeightmapMeshVertexData **ppVertices, UInt16 **ppTrian
 
 void HeightmapMeshDestroy ( HeightmapMeshVertexData *pVertices, UInt16 *pTriangleMeshIndices );
 
+// A caller's vertex format for HeightmapMeshWrite, as for DistortionMeshVertexLayout;
+// TimewarpLerp is a float.
+struct HeightmapMeshVertexLayout
+{
+    int     Stride;
+    int     ScreenPosNDC;
+    int     TimewarpLerp;
+    int     TanEyeAngles;
+
+    // The layout of HeightmapMeshVertexData.
+    HeightmapMeshVertexLayout();
+};
+
+// Returns the vertex and index counts of heightmap meshes.
+void HeightmapMeshGetSize ( int *pNumVertices, int *pNumIndices );
+
+// Same as HeightmapMeshCreate, but writes the mesh into buffers of the caller, as
+// DistortionMeshWrite does. The mesh is a triangle list.
+void HeightmapMeshWrite ( void *pVertices, const HeightmapMeshVertexLayout &layout,
+                          UInt16 *pIndices, UInt16 indexBase, bool rightEye,
+                          const HmdRenderInfo &hmdRenderInfo, const ScaleAndOffset2D &eyeToSourceNDC );
+
 
 
 //-----------------------------------------------------------------------------------